@@ -48,6 +48,13 @@
 
 #define CHANNELNAME   "chan"
 
+/* Record types written to the export file */
+#define EXPORT_SWIT (1) /* Software (stimulus port) packet, addr is the port */
+#define EXPORT_HW   (2) /* Hardware source (DWT) packet, addr is the discriminator ID */
+#define EXPORT_LTS  (3) /* Local timestamp, addr is the TC bits and value the delta */
+#define EXPORT_GTS1 (4) /* Global timestamp bits [25:0], addr carries the wrap and clock change bits */
+#define EXPORT_GTS2 (5) /* Global timestamp bits [57:26], truncated to 32 bits */
+
 #define BOOL       char
 #define FALSE      (0)
 #define TRUE       (!FALSE)
@@ -61,13 +68,27 @@ struct
   char *chanPath;
   char *port;
   int speed;
+  char *exportFile;
 } options = {.nChannels=NUM_FIFOS, .chanPath="", .speed=115200};
 
 // Runtime state
 struct
 {
   int fifo[MAX_FIFOS];
-} _r;
+  int exportFd;
+  uint64_t timestamp;
+} _r = {.exportFd=-1};
+
+// Fixed size record written to the export file for each decoded packet, in host byte order
+struct exportRecord
+{
+  uint8_t type;       // One of the EXPORT_* record types
+  uint8_t addr;       // Stimulus port, DWT discriminator ID or timestamp control bits
+  uint8_t length;     // Number of payload bytes that were in the packet
+  uint8_t reserved;
+  uint32_t value;     // Packet payload
+  uint64_t timestamp; // Sum of the local timestamp deltas seen so far
+} __attribute__((packed));
 
 // ====================================================================================================
 // ====================================================================================================
@@ -183,20 +204,119 @@ static void _removeFifoTasks(void)
 // ====================================================================================================
 // ====================================================================================================
 // ====================================================================================================
+void _export(uint8_t type, uint8_t addr, uint8_t length, uint32_t value)
+
+/* Append a record to the export file, if there is one */
+
+{
+  if (_r.exportFd<0)
+    return;
+
+  struct exportRecord r={.type=type, .addr=addr, .length=length, .value=value, .timestamp=_r.timestamp};
+  if (write(_r.exportFd,&r,sizeof(r))!=sizeof(r))
+    {
+      fprintf(stderr,"Export write failed, stopping export\n");
+      close(_r.exportFd);
+      _r.exportFd=-1;
+    }
+}
+// ====================================================================================================
+static uint32_t _packetValue(uint8_t length, uint8_t *d)
+
+/* Source packet payloads are little endian */
+
+{
+  uint32_t value=0;
+  for (int i=length-1; i>=0; i--)
+    value=(value<<8)|d[i];
+  return value;
+}
+// ====================================================================================================
 void _handleSWIT(uint8_t addr, uint8_t length, uint8_t *d)
 
 {
   if (addr<options.nChannels)
     write(_r.fifo[addr],d,length);
 
-  //  if (addr==0)
-  //  fprintf(stdout,"%c",*d);
+  _export(EXPORT_SWIT,addr,length,_packetValue(length,d));
+}
+// ====================================================================================================
+void _handleHW(uint8_t addr, uint8_t length, uint8_t *d)
+
+/* Hardware source packets come from the DWT, see ARMv7-M ARM (DDI0403) Appendix D4.3 */
+
+{
+  uint32_t value=_packetValue(length,d);
+
+  _export(EXPORT_HW,addr,length,value);
+
+  if (!options.verbose)
+    return;
+
+  if (addr==0)
+    {
+      /* Event counter packet - a bit is set for each counter that wrapped */
+      fprintf(stderr,"Event counter wrap:%s%s%s%s%s%s\n",(value&0x20)?" CYC":"",(value&0x10)?" FOLD":"",
+	      (value&0x08)?" LSU":"",(value&0x04)?" SLEEP":"",(value&0x02)?" EXC":"",(value&0x01)?" CPI":"");
+    }
+  else if (addr==1)
+    {
+      static const char *functions[]={"?","Entered","Exited","Returned to"};
+      fprintf(stderr,"%s exception %u\n",functions[(value>>12)&3],(unsigned int)(value&0x1FF));
+    }
+  else if (addr==2)
+    {
+      /* A one byte PC sample means the core was sleeping */
+      if (length==4)
+	fprintf(stderr,"PC sample 0x%08X\n",value);
+      else
+	fprintf(stderr,"PC sample: sleeping\n");
+    }
+  else if ((addr>=8) && (addr<=23))
+    {
+      /* Data trace - bits [2:1] of the discriminator are the comparator, bits [4:3] and 0 the packet kind */
+      unsigned int comparator=(addr>>1)&3;
+      if ((addr&0x18)==0x08)
+	fprintf(stderr,"Comparator %u %s 0x%08X\n",comparator,(addr&1)?"address offset":"PC",value);
+      else
+	fprintf(stderr,"Comparator %u data %s 0x%08X\n",comparator,(addr&1)?"write":"read",value);
+    }
 }
 // ====================================================================================================
 void _handleTS(uint8_t length, uint8_t *d)
 
+/* Handle timestamps, d[0] being the header and any continuation bytes following it */
+
 {
+  uint32_t value=0;
 
+  for (int i=length-1; i>0; i--)
+    value=(value<<7)|(d[i]&0x7F);
+
+  if (!(d[0]&0x0F))
+    {
+      /* Local timestamp - LTS1 has the delta in the continuation bytes, LTS2 in the header */
+      if (!(d[0]&0x80))
+	value=(d[0]>>4)&0x07;
+      _r.timestamp+=value;
+      _export(EXPORT_LTS,(d[0]>>4)&0x03,length,value);
+    }
+  else if (d[0]==0x94)
+    {
+      /* GTS1 - the last byte's bits [6:5] are the clock change and wrap flags, which are not timestamp bits */
+      if (length==5)
+	{
+	  _export(EXPORT_GTS1,(d[4]>>5)&0x03,length,value&0x03FFFFFF);
+	}
+      else
+	{
+	  _export(EXPORT_GTS1,0,length,value);
+	}
+    }
+  else if (d[0]==0xB4)
+    {
+      _export(EXPORT_GTS2,0,length,value);
+    }
 }
 // ====================================================================================================
 // ====================================================================================================
@@ -205,10 +325,10 @@ void _handleTS(uint8_t length, uint8_t *d)
 // ====================================================================================================
 // ====================================================================================================
 // ====================================================================================================
-enum _protoState {ITM_IDLE, ITM_SYNCING, ITM_TS, ITM_SWIT};
+enum _protoState {ITM_IDLE, ITM_SYNCING, ITM_TS, ITM_SWIT, ITM_HW};
 
 #ifdef PRINT_TRANSITIONS
-static char *_protoNames[]={"IDLE", "SYNCING","TS","SWIT"};
+static char *_protoNames[]={"IDLE", "SYNCING","TS","SWIT","HW"};
 #endif
 
 void _protocolPump(uint8_t *c)
@@ -216,7 +336,7 @@ void _protocolPump(uint8_t *c)
 {
   static enum _protoState p;
   static int targetCount, currentCount, srcAddr;
-  static uint8_t rxPacket[5];
+  static uint8_t rxPacket[8];
 
 #ifdef PRINT_TRANSITIONS
   printf("%02x %s --> ",*c,_protoNames[p]);
@@ -243,10 +363,21 @@ void _protocolPump(uint8_t *c)
 	  break;
 	}
       // **********
-      if (!(*c&0x0F))
+      if (*c&0x03)
+	{
+	  /* This is a source packet, SWIT if bit 2 is clear, otherwise from a hardware source (DWT) */
+	  if ((targetCount=*c&0x03)==3)
+	    targetCount=4;
+	  srcAddr=(*c&0xF8)>>3;
+	  currentCount=0;
+	  p=(*c&0x04)?ITM_HW:ITM_SWIT;
+	  break;
+	}
+      // **********
+      if ((!(*c&0x0F)) || (*c==0x94) || (*c==0xB4))
 	{
 	  currentCount=1;
-	  /* This is a timestamp packet */
+	  /* This is a local or global timestamp packet */
 	  rxPacket[0]=*c;
 
 	  if (!(*c&0x80))
@@ -261,20 +392,21 @@ void _protocolPump(uint8_t *c)
 	  break;
 	}
       // **********
-      if ((*c&0x0F) == 0x04)
+      if ((*c&0x0B) == 0x08)
 	{
-	  /* This is a reserved packet */
+	  /* This is an extension packet, skip any continuation bytes */
+	  if (*c&0x80)
+	    {
+	      currentCount=1;
+	      rxPacket[0]=*c;
+	      p=ITM_TS;
+	    }
 	  break;
 	}
       // **********
-      if (!(*c&0x04))
+      if ((*c&0x0F) == 0x04)
 	{
-	  /* This is a SWIT packet */
-	  if ((targetCount=*c&0x03)==3)
-	    targetCount=4;
-	  srcAddr=(*c&0xF8)>>3;
-	  currentCount=0;
-	  p=ITM_SWIT;
+	  /* This is a reserved packet */
 	  break;
 	}
       // **********
@@ -293,22 +425,35 @@ void _protocolPump(uint8_t *c)
 	    }
 	  break;
       // -----------------------------------------------------
+    case ITM_HW:
+	  rxPacket[currentCount]=*c;
+	  currentCount++;
+
+	  if (currentCount>=targetCount)
+	    {
+	      p=ITM_IDLE;
+	      _handleHW(srcAddr, targetCount, rxPacket);
+	    }
+	  break;
+      // -----------------------------------------------------
     case ITM_TS:
       rxPacket[currentCount++]=*c;
       if (!(*c&0x80))
 	{
-	  /* We are done */
-	  _handleTS(currentCount,rxPacket);
+	  /* We are done, extension packets are only skipped */
+	  p=ITM_IDLE;
+	  if ((rxPacket[0]&0x0B)!=0x08)
+	    _handleTS(currentCount,rxPacket);
 	}
       else
 	{
-	  if (currentCount>4)
+	  if (currentCount>=(int)sizeof(rxPacket))
 	    {
 	      /* Something went badly wrong */
 	      p=ITM_IDLE;
 	    }
-	  break;
 	}
+      break;
 
       // -----------------------------------------------------
     case ITM_SYNCING:
@@ -345,8 +490,9 @@ void intHandler(int dummy)
 void _printHelp(char *progName)
 
 {
-  printf("Useage: %s <dhnv> <b basedir> <p port> <s speed>\n",progName);
+  printf("Useage: %s <dhnv> <b basedir> <e exportfile> <p port> <s speed>\n",progName);
   printf("        b: <basedir> for channels\n");
+  printf("        e: Also write every decoded packet as a binary record to <exportfile>\n");
   printf("        h: This help\n");
   printf("        d: Dump received data without further processing\n");
   printf("        n: <Number> of channels to populate\n");
@@ -359,7 +505,7 @@ int _processOptions(int argc, char *argv[])
 
 {
   int c;
-  while ((c = getopt (argc, argv, "vdn:b:hp:s:")) != -1)
+  while ((c = getopt (argc, argv, "vdn:b:e:hp:s:")) != -1)
     switch (c)
       {
       case 'v':
@@ -388,6 +534,9 @@ int _processOptions(int argc, char *argv[])
       case 'b':
         options.chanPath = optarg;
         break;
+      case 'e':
+        options.exportFile = optarg;
+        break;
       case '?':
         if (optopt == 'b')
           fprintf (stderr, "Option '%c' requires an argument.\n", optopt);
@@ -562,6 +711,15 @@ int main(int argc, char *argv[])
       exit(-1);
     }
 
+  if (options.exportFile)
+    {
+      if ((_r.exportFd=open(options.exportFile,O_WRONLY|O_CREAT|O_TRUNC,0644))<0)
+	{
+	  perror("Opening export file");
+	  exit(-1);
+	}
+    }
+
   /* Using the exit construct rather than return ensures the atexit gets called */
   if (!options.port)
     exit(usbFeeder());
@@ -30,11 +30,16 @@
 #include "exception.h"
 #include "command.h"
 #include "gdb_packet.h"
+#include "gdb_main.h"
 #include "target.h"
 #include "target_internal.h"
 #include "morse.h"
 #include "version.h"
 #include "jtagtap.h"
+#include "live_watch.h"
+#include "adiv5.h"
+#include "bench.h"
+#include "stats.h"
 
 #if CONFIG_BMDA == 0
 #include "jtag_scan.h"
@@ -45,11 +50,25 @@
 #include "hex_utils.h"
 #endif
 
+#ifdef SEMIHOSTING_RAMFS_SIZE
+#include "semihosting_ramfs.h"
+#endif
+
+#ifdef ENABLE_RTOS
+#include "rtos.h"
+#endif
+
+#if CONFIG_BMDA == 1
+#include "coredump.h"
+#endif
+
 #ifdef PLATFORM_HAS_TRACESWO
-#include "serialno.h"
 #include "swo.h"
+#if CONFIG_BMDA == 0
+#include "serialno.h"
 #include "usb.h"
 #endif
+#endif
 
 static bool cmd_version(target_s *target, int argc, const char **argv);
 static bool cmd_help(target_s *target, int argc, const char **argv);
@@ -61,7 +80,13 @@ static bool cmd_frequency(target_s *target, int argc, const char **argv);
 static bool cmd_targets(target_s *target, int argc, const char **argv);
 static bool cmd_morse(target_s *target, int argc, const char **argv);
 static bool cmd_halt_timeout(target_s *target, int argc, const char **argv);
+static bool cmd_halt_poll(target_s *target, int argc, const char **argv);
 static bool cmd_connect_reset(target_s *target, int argc, const char **argv);
+static bool cmd_flash_differential(target_s *target, int argc, const char **argv);
+static bool cmd_flash_blank_check(target_s *target, int argc, const char **argv);
+static bool cmd_flash_session(target_s *target, int argc, const char **argv);
+static bool cmd_flash_report(target_s *target, int argc, const char **argv);
+static bool cmd_mem_cache(target_s *target, int argc, const char **argv);
 static bool cmd_reset(target_s *target, int argc, const char **argv);
 static bool cmd_tdi_low_reset(target_s *target, int argc, const char **argv);
 #ifdef PLATFORM_HAS_POWER_SWITCH
@@ -77,13 +102,23 @@ static bool cmd_wifi(target_s *t, int argc, const char **argv);
 static bool cmd_swo(target_s *target, int argc, const char **argv);
 #endif
 static bool cmd_heapinfo(target_s *target, int argc, const char **argv);
+static bool cmd_live_watch(target_s *target, int argc, const char **argv);
+static bool cmd_bench(target_s *target, int argc, const char **argv);
+static bool cmd_stats(target_s *target, int argc, const char **argv);
+#ifdef SEMIHOSTING_RAMFS_SIZE
+static bool cmd_semihosting_fs(target_s *target, int argc, const char **argv);
+#endif
 #ifdef ENABLE_RTT
 static bool cmd_rtt(target_s *target, int argc, const char **argv);
 #endif
+#ifdef ENABLE_RTOS
+static bool cmd_rtos(target_s *target, int argc, const char **argv);
+#endif
 #if defined(PLATFORM_HAS_DEBUG) && CONFIG_BMDA == 0
 static bool cmd_debug_bmp(target_s *target, int argc, const char **argv);
 #endif
 #if CONFIG_BMDA == 1
+static bool cmd_coredump(target_s *target, int argc, const char **argv);
 static bool cmd_shutdown_bmda(target_s *target, int argc, const char **argv);
 #endif
 
@@ -98,11 +133,19 @@ const command_s cmd_list[] = {
 	{"swd_scan", cmd_swd_scan, "Scan SWD interface for devices: [TARGET_ID]"},
 	{"swdp_scan", cmd_swd_scan, "Deprecated: use swd_scan instead"},
 	{"auto_scan", cmd_auto_scan, "Automatically scan all chain types for devices"},
-	{"frequency", cmd_frequency, "set minimum high and low times: [FREQ]"},
+	{"frequency", cmd_frequency, "set minimum high and low times: [FREQ|auto]"},
 	{"targets", cmd_targets, "Display list of available targets"},
 	{"morse", cmd_morse, "Display morse error message"},
 	{"halt_timeout", cmd_halt_timeout, "Timeout to wait until Cortex-M is halted: [TIMEOUT, default 2000ms]"},
+	{"halt_poll", cmd_halt_poll, "Longest interval to back off to polling a running target: [MS, 0 polls tightly]"},
 	{"connect_rst", cmd_connect_reset, "Configure connect under reset: [enable|disable]"},
+	{"flash_differential", cmd_flash_differential,
+		"Skip erasing and writing Flash blocks that already hold the data GDB loads: [enable|disable]"},
+	{"flash_blank_check", cmd_flash_blank_check, "Skip erasing Flash blocks that are already blank: [enable|disable]"},
+	{"flash_session", cmd_flash_session,
+		"Stay in Flash mode across GDB loads until the target is resumed or detached: [enable|disable]"},
+	{"flash_report", cmd_flash_report, "Show where the time went in the last Flash load"},
+	{"mem_cache", cmd_mem_cache, "Cache RAM and Flash reads while the target is halted: [SIZE, 0 disables]"},
 	{"reset", cmd_reset, "Pulse the nRST line - disconnects target: [PULSE_LEN, default 0ms]"},
 	{"tdi_low_reset", cmd_tdi_low_reset,
 		"Pulse nRST with TDI set low to attempt to wake certain targets up (eg LPC82x)"},
@@ -118,23 +161,36 @@ const command_s cmd_list[] = {
 #ifdef ENABLE_RTT
 	{"rtt", cmd_rtt,
 		"[enable|disable|status|channel [0..15 ...]|ident [STR]|cblock|ram [RAM_START RAM_END]|poll [MAXMS MINMS "
-		"MAXERR]]"},
+		"MAXERR]|coalesce [enable|disable]]"},
+#endif
+#ifdef ENABLE_RTOS
+	{"rtos", cmd_rtos, "Report FreeRTOS and Zephyr threads to GDB as threads: [enable|disable]"},
 #endif
 #ifdef PLATFORM_HAS_TRACESWO
 #if SWO_ENCODING == 1
-	{"swo", cmd_swo, "Start SWO capture, Manchester mode: <enable|disable> [decode [CHANNEL_NR ...]]"},
+	{"swo", cmd_swo, "Start SWO capture, Manchester mode: <enable|disable|stats> [decode [CHANNEL_NR ...]]"},
 #elif SWO_ENCODING == 2
-	{"swo", cmd_swo, "Start SWO capture, UART mode: <enable|disable> [BAUDRATE] [decode [CHANNEL_NR ...]]"},
+	{"swo", cmd_swo, "Start SWO capture, UART mode: <enable|disable|stats> [BAUDRATE] [decode [CHANNEL_NR ...]]"},
 #elif SWO_ENCODING == 3
-	{"swo", cmd_swo, "Start SWO capture: <enable|disable> [manchester|uart] [BAUDRATE] [decode [CHANNEL_NR ...]]"},
+	{"swo", cmd_swo,
+		"Start SWO capture: <enable|disable|stats> [manchester|uart] [BAUDRATE] [decode [CHANNEL_NR ...]]"},
 #endif
 	{"traceswo", cmd_swo, "Deprecated: use swo instead"},
 #endif
 	{"heapinfo", cmd_heapinfo, "Set semihosting heapinfo: HEAP_BASE HEAP_LIMIT STACK_BASE STACK_LIMIT"},
+	{"live_watch", cmd_live_watch,
+		"Report changes to watched addresses while the target runs: [add ADDR [1|2|4]|clear|rate MS]"},
+	{"bench", cmd_bench, "Measure link and target access performance: [flash - also rewrites the end of Flash]"},
+	{"stats", cmd_stats, "Show the GDB, SWD, memory, Flash and RTT counters and timings: [reset]"},
+#ifdef SEMIHOSTING_RAMFS_SIZE
+	{"semihosting_fs", cmd_semihosting_fs,
+		"Capture semihosted files written by the target in probe RAM: [enable|disable|list|dump NAME|clear]"},
+#endif
 #if defined(PLATFORM_HAS_DEBUG) && CONFIG_BMDA == 0
 	{"debug_bmp", cmd_debug_bmp, "Output BMP \"debug\" strings to the second vcom: [enable|disable]"},
 #endif
 #if CONFIG_BMDA == 1
+	{"coredump", cmd_coredump, "Write registers, RAM and extra regions to an ELF core file: FILE [ADDR:LENGTH ...]"},
 	{"shutdown_bmda", cmd_shutdown_bmda, "Tell the BMDA server to shut down when the GDB connection closes"},
 #endif
 	{NULL, NULL, NULL},
@@ -378,8 +434,17 @@ bool cmd_auto_scan(target_s *target, int argc, const char **argv)
 
 bool cmd_frequency(target_s *target, int argc, const char **argv)
 {
-	(void)target;
-	if (argc == 2) {
+	if (argc == 2 && !strcmp(argv[1], "auto")) {
+		/* Calibration needs an attached target to check the link against */
+		if (!target) {
+			gdb_out("Adaptive clocking needs an attached target\n");
+			return false;
+		}
+		if (!adiv5_clock_calibrate(target))
+			return false;
+	} else if (argc == 2) {
+		/* Setting a frequency by hand takes the adaptive clock out of the picture */
+		adiv5_clock_adaptive_disable();
 		char *multiplier = NULL;
 		uint32_t frequency = strtoul(argv[1], &multiplier, 10);
 		if (!multiplier) {
@@ -402,7 +467,7 @@ bool cmd_frequency(target_s *target, int argc, const char **argv)
 	if (freq == FREQ_FIXED)
 		gdb_outf("Debug iface frequency is fixed.\n");
 	else
-		gdb_outf("Debug iface frequency set to %" PRIu32 "Hz\n", freq);
+		gdb_outf("Debug iface frequency set to %" PRIu32 "Hz%s\n", freq, adiv5_clock_adaptive ? ", adaptive" : "");
 	return true;
 }
 
@@ -478,6 +543,86 @@ static bool cmd_connect_reset(target_s *target, int argc, const char **argv)
 	return true;
 }
 
+static bool cmd_flash_differential(target_s *target, int argc, const char **argv)
+{
+	(void)target;
+	bool print_status = false;
+	if (argc == 1)
+		print_status = true;
+	else if (argc == 2) {
+		if (parse_enable_or_disable(argv[1], &flash_differential))
+			print_status = true;
+	} else
+		gdb_out("Unrecognized command format\n");
+
+	if (print_status)
+		gdb_outf("Differential flashing: %s\n", flash_differential ? "enabled" : "disabled");
+	return true;
+}
+
+static bool cmd_flash_blank_check(target_s *target, int argc, const char **argv)
+{
+	(void)target;
+	bool print_status = false;
+	if (argc == 1)
+		print_status = true;
+	else if (argc == 2) {
+		if (parse_enable_or_disable(argv[1], &flash_blank_check))
+			print_status = true;
+	} else
+		gdb_out("Unrecognized command format\n");
+
+	if (print_status)
+		gdb_outf("Blank check before erase: %s\n", flash_blank_check ? "enabled" : "disabled");
+	return true;
+}
+
+static bool cmd_flash_session(target_s *target, int argc, const char **argv)
+{
+	bool print_status = false;
+	if (argc == 1)
+		print_status = true;
+	else if (argc == 2) {
+		if (parse_enable_or_disable(argv[1], &flash_session_persist))
+			print_status = true;
+	} else
+		gdb_out("Unrecognized command format\n");
+
+	/* Turning it off also ends any session currently holding the target in Flash mode */
+	if (!flash_session_persist && target && target->flash_mode_held)
+		target_flash_session_end(target);
+	if (print_status)
+		gdb_outf("Persistent Flash session: %s\n", flash_session_persist ? "enabled" : "disabled");
+	return true;
+}
+
+static bool cmd_flash_report(target_s *target, int argc, const char **argv)
+{
+	(void)target;
+	(void)argc;
+	(void)argv;
+	/* GDB takes console output in reply to vFlashDone as the reply itself, so this is only ever had on request */
+	char report[192U];
+	if (target_flash_report(report, sizeof(report)))
+		gdb_out(report);
+	else
+		gdb_out("No Flash load has completed yet\n");
+	return true;
+}
+
+static bool cmd_mem_cache(target_s *target, int argc, const char **argv)
+{
+	(void)target;
+	/* The new size takes effect the next time a target halts */
+	if (argc > 1)
+		target_mem_cache_size = strtoul(argv[1], NULL, 0);
+	if (target_mem_cache_size)
+		gdb_outf("Memory read cache: %" PRIu32 " bytes\n", target_mem_cache_size);
+	else
+		gdb_out("Memory read cache: disabled\n");
+	return true;
+}
+
 static bool cmd_halt_timeout(target_s *target, int argc, const char **argv)
 {
 	(void)target;
@@ -487,6 +632,15 @@ static bool cmd_halt_timeout(target_s *target, int argc, const char **argv)
 	return true;
 }
 
+static bool cmd_halt_poll(target_s *target, int argc, const char **argv)
+{
+	(void)target;
+	if (argc > 1)
+		gdb_halt_poll_max_ms = strtoul(argv[1], NULL, 0);
+	gdb_outf("Longest interval between running target halt polls: %" PRIu32 "ms\n", gdb_halt_poll_max_ms);
+	return true;
+}
+
 static bool cmd_reset(target_s *target, int argc, const char **argv)
 {
 	(void)target;
@@ -529,6 +683,11 @@ static bool cmd_target_power(target_s *target, int argc, const char **argv)
 				if (!platform_target_set_power(want_enable))
 					DEBUG_ERROR("%s target power failed\n", want_enable ? "Enabling" : "Disabling");
 				gdb_outf("%s target power\n", want_enable ? "Enabling" : "Disabling");
+#if CONFIG_BMDA == 1
+				/* Nothing known about the targets survives them losing power, so have the next connection rescan */
+				if (gdb_persist && !want_enable)
+					target_list_free();
+#endif
 			}
 		}
 	} else
@@ -588,8 +747,8 @@ static bool cmd_rtt(target_s *target, int argc, const char **argv)
 		}
 		if (rtt_flag_ram)
 			gdb_outf("ram: 0x%08" PRIx32 " 0x%08" PRIx32, rtt_ram_start, rtt_ram_end);
-		gdb_outf("\nmax poll ms: %" PRIu32 " min poll ms: %" PRIu32 " max errs: %" PRIu32 "\n", rtt_max_poll_ms,
-			rtt_min_poll_ms, rtt_max_poll_errs);
+		gdb_outf("\nmax poll ms: %" PRIu32 " min poll ms: %" PRIu32 " max errs: %" PRIu32 " coalesce: %s\n",
+			rtt_max_poll_ms, rtt_min_poll_ms, rtt_max_poll_errs, on_or_off(rtt_flag_coalesce));
 	} else if (argc >= 2 && strncmp(argv[1], "channel", command_len) == 0) {
 		/* mon rtt channel switches to auto rtt channel selection
 		   mon rtt channel number... selects channels given */
@@ -638,12 +797,44 @@ static bool cmd_rtt(target_s *target, int argc, const char **argv)
 		rtt_max_poll_ms = strtoul(argv[2], NULL, 0);
 		rtt_min_poll_ms = strtoul(argv[3], NULL, 0);
 		rtt_max_poll_errs = strtoul(argv[4], NULL, 0);
+	} else if (argc == 2 && strncmp(argv[1], "coalesce", command_len) == 0)
+		gdb_outf("%s\n", on_or_off(rtt_flag_coalesce));
+	else if (argc == 3 && strncmp(argv[1], "coalesce", command_len) == 0) {
+		if (!parse_enable_or_disable(argv[2], &rtt_flag_coalesce))
+			return false;
 	} else
 		gdb_out("what?\n");
 	return true;
 }
 #endif
 
+#ifdef ENABLE_RTOS
+static bool cmd_rtos(target_s *target, int argc, const char **argv)
+{
+	bool print_status = false;
+	if (argc == 1)
+		print_status = true;
+	else if (argc == 2) {
+		if (parse_enable_or_disable(argv[1], &rtos_enabled)) {
+			/* Drop whatever was seen of the thread lists so the change shows up at once */
+			rtos_invalidate();
+			print_status = true;
+		}
+	} else
+		gdb_out("Unrecognized command format\n");
+
+	if (print_status) {
+		gdb_outf("RTOS awareness: %s\n", rtos_enabled ? "enabled" : "disabled");
+		const char *const name = rtos_name();
+		if (rtos_enabled && name && target && rtos_current_thread(target))
+			gdb_outf("%s running, %u threads\n", name, (unsigned)rtos_thread_count(target));
+		else if (rtos_enabled && name)
+			gdb_outf("%s found, scheduler not running\n", name);
+	}
+	return true;
+}
+#endif
+
 #ifdef PLATFORM_HAS_TRACESWO
 static bool cmd_swo_enable(int argc, const char **argv)
 {
@@ -707,6 +898,11 @@ static bool cmd_swo_enable(int argc, const char **argv)
 
 	/* Now enable SWO data recovery */
 	swo_init(capture_mode, baudrate, itm_stream_mask);
+#if CONFIG_BMDA == 1
+	/* BMDA relies on the probe to do the capture, which it might not be able to, and has already said why */
+	if (swo_current_mode == swo_none)
+		return false;
+#endif
 	/* And show the user what we've done - first the channel mask from MSb to LSb */
 	gdb_outf("Channel mask: ");
 	for (size_t i = 0; i < 32U; ++i) {
@@ -714,8 +910,12 @@ static bool cmd_swo_enable(int argc, const char **argv)
 		gdb_outf("%c", bit);
 	}
 	gdb_outf("\n");
+#if CONFIG_BMDA == 1
+	gdb_out("Trace enabled\n");
+#else
 	/* Then the connection information for programs that are scraping BMD's output to know what to connect to */
 	gdb_outf("Trace enabled for BMP serial %s, USB EP %u\n", serial_no, SWO_ENDPOINT);
+#endif
 	return true;
 }
 
@@ -726,12 +926,24 @@ static bool cmd_swo_disable(void)
 	return true;
 }
 
+/* Report how well the capture has been keeping up, to see whether a trace configuration fits the link */
+static bool cmd_swo_stats(void)
+{
+	gdb_outf("Buffer: %" PRIu32 " bytes, high water mark %" PRIu32 "\n", swo_stats.buffer_size, swo_stats.fill_max);
+	gdb_outf("Captured: %" PRIu32 " bytes, sent: %" PRIu32 " bytes\n", swo_stats.bytes_captured, swo_stats.bytes_sent);
+	gdb_outf("Dropped: %" PRIu32 " bytes in %" PRIu32 " overflows\n", swo_stats.bytes_dropped, swo_stats.overflows);
+	gdb_outf("USB endpoint busy: %" PRIu32 " times\n", swo_stats.endpoint_busy);
+	return true;
+}
+
 static bool cmd_swo(target_s *target, int argc, const char **argv)
 {
 	(void)target;
+	if (argc == 2 && strcmp(argv[1], "stats") == 0)
+		return cmd_swo_stats();
 	bool enable_swo = false;
 	if (argc >= 2 && !parse_enable_or_disable(argv[1], &enable_swo)) {
-		gdb_out("Usage: traceswo <enable|disable> [2000000] [decode [0 1 3 31]]\n");
+		gdb_out("Usage: traceswo <enable|disable|stats> [2000000] [decode [0 1 3 31]]\n");
 		return false;
 	}
 
@@ -758,6 +970,19 @@ static bool cmd_debug_bmp(target_s *target, int argc, const char **argv)
 #endif
 
 #if CONFIG_BMDA == 1
+static bool cmd_coredump(target_s *target, int argc, const char **argv)
+{
+	if (!target) {
+		gdb_out("not attached\n");
+		return false;
+	}
+	if (argc < 2) {
+		gdb_out("usage: monitor coredump FILE [ADDR:LENGTH ...]\n");
+		return false;
+	}
+	return coredump_write(target, argv[1], argv + 2, (size_t)argc - 2U);
+}
+
 static bool cmd_shutdown_bmda(target_s *target, int argc, const char **argv)
 {
 	(void)target;
@@ -793,3 +1018,79 @@ static bool cmd_heapinfo(target_s *target, int argc, const char **argv)
 		gdb_outf("%s\n", "Set semihosting heapinfo: HEAP_BASE HEAP_LIMIT STACK_BASE STACK_LIMIT");
 	return true;
 }
+
+#ifdef SEMIHOSTING_RAMFS_SIZE
+static bool cmd_semihosting_fs(target_s *target, int argc, const char **argv)
+{
+	(void)target;
+	const size_t command_len = argc > 1 ? strlen(argv[1]) : 0;
+	if (argc == 1 || (argc == 2 && strncmp(argv[1], "list", command_len) == 0))
+		semihosting_ramfs_list();
+	else if (argc == 3 && strncmp(argv[1], "dump", command_len) == 0) {
+		if (!semihosting_ramfs_dump(argv[2])) {
+			gdb_outf("No such file: %s\n", argv[2]);
+			return false;
+		}
+	} else if (argc == 2 && strncmp(argv[1], "clear", command_len) == 0)
+		semihosting_ramfs_clear();
+	else if (argc == 2) {
+		if (parse_enable_or_disable(argv[1], &semihosting_ramfs_enabled))
+			semihosting_ramfs_list();
+	} else
+		gdb_out("Unrecognized command format\n");
+	return true;
+}
+#endif
+
+static bool cmd_live_watch(target_s *target, int argc, const char **argv)
+{
+	const size_t command_len = argc > 1 ? strlen(argv[1]) : 0;
+	if (argc >= 3 && argc <= 4 && strncmp(argv[1], "add", command_len) == 0) {
+		const target_addr_t addr = strtoul(argv[2], NULL, 0);
+		const uint32_t size = argc == 4 ? strtoul(argv[3], NULL, 0) : 4U;
+		if (size > 4U || !live_watch_add(addr, (uint8_t)size, LIVE_WATCH_OWNER_GDB)) {
+			gdb_out("Watch must be 1, 2 or 4 bytes, naturally aligned, and the table not full\n");
+			return false;
+		}
+	} else if (argc == 2 && strncmp(argv[1], "clear", command_len) == 0)
+		live_watch_clear(LIVE_WATCH_OWNER_GDB);
+	else if (argc == 3 && strncmp(argv[1], "rate", command_len) == 0)
+		live_watch_rate_ms = MAX(strtoul(argv[2], NULL, 0), 1U);
+	else if (argc != 1) {
+		gdb_out("what?\n");
+		return false;
+	}
+	gdb_outf("Reading every %" PRIu32 "ms%s\n", live_watch_rate_ms,
+		target && target_mem_access_needs_halt(target) ? ", briefly halting the target" : "");
+	live_watch_list();
+	return true;
+}
+
+static bool cmd_bench(target_s *target, int argc, const char **argv)
+{
+	if (!target) {
+		gdb_out("not attached\n");
+		return false;
+	}
+	const bool flash = argc == 2 && strncmp(argv[1], "flash", strlen(argv[1])) == 0;
+	if (argc > 2 || (argc == 2 && !flash)) {
+		gdb_out("what?\n");
+		return false;
+	}
+	return bench_run(target, flash);
+}
+
+static bool cmd_stats(target_s *target, int argc, const char **argv)
+{
+	(void)target;
+	if (argc == 2 && strncmp(argv[1], "reset", strlen(argv[1])) == 0) {
+		stats_reset();
+		return true;
+	}
+	if (argc != 1) {
+		gdb_out("what?\n");
+		return false;
+	}
+	stats_dump();
+	return true;
+}
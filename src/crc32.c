@@ -20,10 +20,35 @@
 
 #include "general.h"
 #include "target.h"
+#include "target_internal.h"
 #include "gdb_if.h"
 
+/* How much memory to hand to the target's own CRC32 routine at a time, to keep the GDB connection alive */
+#define TARGET_CRC32_CHUNK_SIZE 65536U
+
+static bool target_crc32(target_s *const target, uint32_t *const result, const uint32_t base, const size_t len)
+{
+	if (!target->crc32)
+		return false;
+
+	uint32_t crc = 0xffffffffU;
+	uint32_t last_time = platform_time_ms();
+	for (size_t offset = 0; offset < len; offset += TARGET_CRC32_CHUNK_SIZE) {
+		const uint32_t actual_time = platform_time_ms();
+		if (actual_time > last_time + 1000U) {
+			last_time = actual_time;
+			gdb_if_putchar(0, true);
+		}
+		if (!target->crc32(target, &crc, base + offset, MIN(TARGET_CRC32_CHUNK_SIZE, len - offset)))
+			return false;
+	}
+	*result = crc;
+	return true;
+}
+
 #if !defined(STM32F0) && !defined(STM32F1) && !defined(STM32F2) && !defined(STM32F3) && !defined(STM32F4) && \
 	!defined(STM32F7) && !defined(STM32L0) && !defined(STM32L1) && !defined(STM32G0) && !defined(STM32G4)
+#include "buffer_utils.h"
 
 /* clang-format off */
 static const uint32_t crc32_table[] = {
@@ -100,6 +125,54 @@ static uint32_t crc32_calc(const uint32_t crc, const uint8_t data)
 	return (crc << 8U) ^ crc32_table[((crc >> 24U) ^ data) & 0xffU];
 }
 
+#if CONFIG_BMDA == 1
+/*
+ * Slicing-by-8: crc32_slice_table[n - 1][x] is the CRC of byte x followed by n zero bytes, which lets 8 bytes
+ * be folded in per step with independent table lookups rather than 8 dependent ones. The 7 KiB of extra tables
+ * is nothing on the host, so they're built from crc32_table on first use rather than living in the source.
+ */
+static uint32_t crc32_slice_table[7][256];
+static bool crc32_slice_table_valid = false;
+
+static void crc32_slice_table_init(void)
+{
+	for (size_t i = 0; i < 256U; ++i) {
+		uint32_t crc = crc32_table[i];
+		for (size_t slice = 0; slice < 7U; ++slice) {
+			crc = crc32_calc(crc, 0U);
+			crc32_slice_table[slice][i] = crc;
+		}
+	}
+	crc32_slice_table_valid = true;
+}
+
+static uint32_t crc32_calc_block(uint32_t crc, const uint8_t *const data, const size_t len)
+{
+	if (!crc32_slice_table_valid)
+		crc32_slice_table_init();
+
+	size_t offset = 0;
+	for (; offset + 8U <= len; offset += 8U) {
+		crc ^= read_be4(data, offset);
+		const uint32_t next = read_be4(data, offset + 4U);
+		crc = crc32_slice_table[6][crc >> 24U] ^ crc32_slice_table[5][(crc >> 16U) & 0xffU] ^
+			crc32_slice_table[4][(crc >> 8U) & 0xffU] ^ crc32_slice_table[3][crc & 0xffU] ^
+			crc32_slice_table[2][next >> 24U] ^ crc32_slice_table[1][(next >> 16U) & 0xffU] ^
+			crc32_slice_table[0][(next >> 8U) & 0xffU] ^ crc32_table[next & 0xffU];
+	}
+	for (; offset < len; ++offset)
+		crc = crc32_calc(crc, data[offset]);
+	return crc;
+}
+#else
+static uint32_t crc32_calc_block(uint32_t crc, const uint8_t *const data, const size_t len)
+{
+	for (size_t i = 0; i < len; i++)
+		crc = crc32_calc(crc, data[i]);
+	return crc;
+}
+#endif
+
 static bool generic_crc32(target_s *const target, uint32_t *const result, const uint32_t base, const size_t len)
 {
 	uint32_t crc = 0xffffffffU;
@@ -126,17 +199,46 @@ static bool generic_crc32(target_s *const target, uint32_t *const result, const
 			return false;
 		}
 
-		for (size_t i = 0; i < read_len; i++)
-			crc = crc32_calc(crc, bytes[i]);
+		crc = crc32_calc_block(crc, bytes, read_len);
 	}
 	*result = crc;
 	return true;
 }
 
+static uint32_t generic_crc32_buffer(const uint8_t *const data, const size_t len)
+{
+	return crc32_calc_block(0xffffffffU, data, len);
+}
+
+static uint32_t generic_crc32_fill(const uint8_t value, const size_t len)
+{
+	uint8_t bytes[64U];
+	memset(bytes, value, sizeof(bytes));
+	uint32_t crc = 0xffffffffU;
+	for (size_t offset = 0; offset < len; offset += sizeof(bytes))
+		crc = crc32_calc_block(crc, bytes, MIN(sizeof(bytes), len - offset));
+	return crc;
+}
+
 #else
 #include <libopencm3/stm32/crc.h>
 #include "buffer_utils.h"
 
+/* Software CRC for the trailing bytes the (word-wide) hardware unit can't handle */
+static uint32_t stm32_crc32_bytes(uint32_t crc, const uint8_t *const bytes, const size_t len)
+{
+	for (size_t offset = 0; offset < len; ++offset) {
+		crc ^= bytes[offset] << 24U;
+		for (size_t i = 0; i < 8U; i++) {
+			if (crc & 0x80000000U)
+				crc = (crc << 1U) ^ 0x4c11db7U;
+			else
+				crc <<= 1U;
+		}
+	}
+	return crc;
+}
+
 static bool stm32_crc32(target_s *const target, uint32_t *const result, const uint32_t base, const size_t len)
 {
 	uint8_t bytes[1024U]; /* ADIv5 MEM-AP AutoInc range */
@@ -169,19 +271,35 @@ static bool stm32_crc32(target_s *const target, uint32_t *const result, const ui
 			DEBUG_ERROR("%s: error around address 0x%08" PRIx32 "\n", __func__, (uint32_t)(base + adjusted_len));
 			return false;
 		}
-		for (size_t offset = 0; offset < remainder; ++offset) {
-			crc ^= bytes[offset] << 24U;
-			for (size_t i = 0; i < 8U; i++) {
-				if (crc & 0x80000000U)
-					crc = (crc << 1U) ^ 0x4c11db7U;
-				else
-					crc <<= 1U;
-			}
-		}
+		crc = stm32_crc32_bytes(crc, bytes, remainder);
 	}
 	*result = crc;
 	return true;
 }
+
+static uint32_t stm32_crc32_buffer(const uint8_t *const data, const size_t len)
+{
+	CRC_CR |= CRC_CR_RESET;
+
+	const size_t adjusted_len = len & ~3U;
+	for (size_t offset = 0; offset < adjusted_len; offset += 4U)
+		CRC_DR = read_be4(data, offset);
+
+	return stm32_crc32_bytes(CRC_DR, data + adjusted_len, len - adjusted_len);
+}
+
+static uint32_t stm32_crc32_fill(const uint8_t value, const size_t len)
+{
+	CRC_CR |= CRC_CR_RESET;
+
+	const uint32_t word = value * 0x01010101U;
+	const size_t adjusted_len = len & ~3U;
+	for (size_t offset = 0; offset < adjusted_len; offset += 4U)
+		CRC_DR = word;
+
+	const uint8_t bytes[3U] = {value, value, value};
+	return stm32_crc32_bytes(CRC_DR, bytes, len - adjusted_len);
+}
 #endif
 
 /* Shim to dispatch host-specific implementation (and keep the `__func__` meaningful) */
@@ -192,9 +310,10 @@ bool bmd_crc32(target_s *const target, uint32_t *const result, const uint32_t ba
 #endif
 #if !defined(STM32F0) && !defined(STM32F1) && !defined(STM32F2) && !defined(STM32F3) && !defined(STM32F4) && \
 	!defined(STM32F7) && !defined(STM32L0) && !defined(STM32L1) && !defined(STM32G0) && !defined(STM32G4)
-	const bool status = generic_crc32(target, result, base, len);
+	/* Prefer having the target compute the CRC itself, only shipping the result back */
+	const bool status = target_crc32(target, result, base, len) || generic_crc32(target, result, base, len);
 #else
-	const bool status = stm32_crc32(target, result, base, len);
+	const bool status = target_crc32(target, result, base, len) || stm32_crc32(target, result, base, len);
 #endif
 #ifndef DEBUG_INFO_IS_NOOP
 	/* "generic_crc32: 08000110+75272 -> 1353ms, 54 KiB/s" */
@@ -210,3 +329,23 @@ bool bmd_crc32(target_s *const target, uint32_t *const result, const uint32_t ba
 #endif
 	return status;
 }
+
+uint32_t bmd_crc32_buffer(const void *const buffer, const size_t len)
+{
+#if !defined(STM32F0) && !defined(STM32F1) && !defined(STM32F2) && !defined(STM32F3) && !defined(STM32F4) && \
+	!defined(STM32F7) && !defined(STM32L0) && !defined(STM32L1) && !defined(STM32G0) && !defined(STM32G4)
+	return generic_crc32_buffer((const uint8_t *)buffer, len);
+#else
+	return stm32_crc32_buffer((const uint8_t *)buffer, len);
+#endif
+}
+
+uint32_t bmd_crc32_fill(const uint8_t value, const size_t len)
+{
+#if !defined(STM32F0) && !defined(STM32F1) && !defined(STM32F2) && !defined(STM32F3) && !defined(STM32F4) && \
+	!defined(STM32F7) && !defined(STM32L0) && !defined(STM32L1) && !defined(STM32G0) && !defined(STM32G4)
+	return generic_crc32_fill(value, len);
+#else
+	return stm32_crc32_fill(value, len);
+#endif
+}
@@ -43,6 +43,7 @@
 #ifdef ENABLE_RTT
 #include "rtt.h"
 #endif
+#include "rtos.h"
 
 #if ADVERTISE_NOACKMODE == 1
 /*
@@ -61,6 +62,7 @@
 #include <stdlib.h>
 
 typedef enum gdb_signal {
+	GDB_SIG0 = 0,
 	GDB_SIGINT = 2,
 	GDB_SIGTRAP = 5,
 	GDB_SIGSEGV = 11,
@@ -83,7 +85,56 @@ target_s *last_target;
 bool gdb_target_running = false;
 static bool gdb_needs_detach_notify = false;
 
+/*
+ * Non-stop mode (enabled by GDB with `QNonStop:1`) keeps GDB talking to us while the target runs.
+ * Stops are then reported asynchronously with a `%Stop` notification, which GDB acknowledges with
+ * `vStopped` - so the stop reply is kept here both for that and so `?` can report it again.
+ * gdb_stop_reply_sync is set when a `?` is waiting on the next stop reply as an ordinary packet.
+ */
+#define GDB_STOP_REPLY_SIZE 48U
+bool gdb_non_stop = false;
+static char gdb_stop_reply[GDB_STOP_REPLY_SIZE] = "";
+static bool gdb_stop_reply_sync = false;
+
+/*
+ * Halt poll scheduling. For the first few rounds after the target starts running (when a step or a short
+ * run is most likely to finish) the target is polled back-to-back. After that, the interval between polls
+ * backs off exponentially to gdb_halt_poll_max_ms so it stops competing with RTT and live watch for the bus.
+ */
+#define GDB_HALT_POLL_TIGHT_ROUNDS 32U
+uint32_t gdb_halt_poll_max_ms = 16U;
+static uint32_t gdb_halt_poll_rounds = 0U;
+static uint32_t gdb_halt_poll_interval_ms = 0U;
+static uint32_t gdb_halt_poll_last_ms = 0U;
+
+/* The address range GDB asked to have stepped through with `vCont;r`, empty when not range stepping */
+static target_addr_t gdb_range_step_start = 0U;
+static target_addr_t gdb_range_step_end = 0U;
+static target_s *gdb_range_step_target = NULL;
+
+/*
+ * The cores of a multi-core device are presented to GDB as the threads of one process. gdb_threads[0] is
+ * the core GDB attached to and the rest are the other cores of the same device, attached alongside it.
+ * Thread IDs are 1-based indices into this, and cur_target is whichever core GDB last selected with `Hg`.
+ * Each core keeps its own target_s, and so its own register cache, so switching between them is free.
+ * gdb_threads_polled has a bit set for each thread that's been set going and needs watching for a halt.
+ */
+#define GDB_MAX_THREADS            4U
+#define GDB_THREAD_HALT_TIMEOUT_MS 500U
+static target_s *gdb_threads[GDB_MAX_THREADS];
+static size_t gdb_thread_count = 0U;
+static uint8_t gdb_threads_polled = 0U;
+
+#ifdef ENABLE_RTOS
+/* The RTOS thread GDB selected with `Hg`, 0 while that's whichever thread is running */
+static uint32_t gdb_rtos_thread = 0U;
+/* How far through the thread list qsThreadInfo has got, and how many thread IDs go in each reply */
+#define GDB_THREAD_INFO_BATCH 16U
+static size_t gdb_thread_info_next = 0U;
+#endif
+
 static void handle_q_packet(const gdb_packet_s *packet);
+static void gdb_stop_notify(void);
 static void handle_v_packet(const gdb_packet_s *packet);
 static void handle_z_packet(const gdb_packet_s *packet);
 static void handle_kill_target(void);
@@ -91,8 +142,18 @@ static void handle_kill_target(void);
 static void gdb_target_destroy_callback(target_controller_s *tc, target_s *t)
 {
 	(void)tc;
+	/* Drop the core from the thread list, keeping the rest in order */
+	for (size_t idx = 0U; idx < gdb_thread_count; ++idx) {
+		if (gdb_threads[idx] != t)
+			continue;
+		--gdb_thread_count;
+		memmove(gdb_threads + idx, gdb_threads + idx + 1U, (gdb_thread_count - idx) * sizeof(*gdb_threads));
+		gdb_threads_polled = 0U;
+		break;
+	}
+
 	if (cur_target == t) {
-		gdb_put_notification_str("%Stop:W00");
+		gdb_put_notification_str("Stop:W00");
 		gdb_out("You are now detached from the previous target.\n");
 		cur_target = NULL;
 		gdb_needs_detach_notify = true;
@@ -113,6 +174,208 @@ target_controller_s gdb_controller = {
 	.printf = gdb_target_printf,
 };
 
+/* Thread ID of a core, or 0 if it isn't one of GDB's threads */
+static size_t gdb_thread_id(const target_s *const target)
+{
+	for (size_t idx = 0U; idx < gdb_thread_count; ++idx) {
+		if (gdb_threads[idx] == target)
+			return idx + 1U;
+	}
+	return 0U;
+}
+
+static uint8_t gdb_thread_bit(const target_s *const target)
+{
+	const size_t thread_id = gdb_thread_id(target);
+	return thread_id ? 1U << (thread_id - 1U) : 0U;
+}
+
+static void gdb_thread_sibling_attach(const size_t index, target_s *const target, void *const context)
+{
+	(void)index;
+	if (gdb_thread_count == GDB_MAX_THREADS || !target_same_device((target_s *)context, target))
+		return;
+	/* Cores that are locked, or otherwise refuse the attach, just don't show up as threads */
+	if (target_attach(target, &gdb_controller))
+		gdb_threads[gdb_thread_count++] = target;
+}
+
+/*
+ * On a single core device running a kernel that GDB has told us the symbols for, the kernel's threads stand
+ * in for the core's one thread, with the addresses of their control blocks as their thread IDs.
+ */
+static bool gdb_rtos_active(void)
+{
+#ifdef ENABLE_RTOS
+	return gdb_thread_count == 1U && !gdb_target_running && rtos_current_thread(cur_target);
+#else
+	return false;
+#endif
+}
+
+/* Forget the RTOS thread snapshot and selection, which no longer hold once the target resumes or resets */
+static void gdb_rtos_invalidate(void)
+{
+#ifdef ENABLE_RTOS
+	rtos_invalidate();
+	gdb_rtos_thread = 0U;
+#endif
+}
+
+/* Whether GDB has selected an RTOS thread other than the one running */
+static bool gdb_rtos_thread_selected(void)
+{
+#ifdef ENABLE_RTOS
+	return gdb_rtos_thread && gdb_rtos_active();
+#else
+	return false;
+#endif
+}
+
+/* Fetch the registers the kernel saved for the selected RTOS thread, false if there isn't one selected */
+static bool gdb_rtos_thread_regs(uint32_t *const regs)
+{
+#ifdef ENABLE_RTOS
+	return gdb_rtos_thread_selected() && rtos_thread_regs_read(cur_target, gdb_rtos_thread, regs);
+#else
+	(void)regs;
+	return false;
+#endif
+}
+
+/* The ID of the thread GDB has selected */
+static uint32_t gdb_current_thread_id(void)
+{
+#ifdef ENABLE_RTOS
+	if (gdb_rtos_active())
+		return gdb_rtos_thread ? gdb_rtos_thread : rtos_current_thread(cur_target);
+#endif
+	return MAX(gdb_thread_id(cur_target), 1U);
+}
+
+/* Whether a thread ID is one of the threads we've told GDB about */
+static bool gdb_thread_valid(const uint32_t thread_id)
+{
+#ifdef ENABLE_RTOS
+	if (gdb_rtos_active())
+		return rtos_thread_valid(cur_target, thread_id);
+#endif
+	return thread_id && thread_id <= gdb_thread_count;
+}
+
+/* Make the given thread the one register and memory accesses go to, thread 0 meaning any will do */
+static void gdb_thread_select(const uint32_t thread_id)
+{
+	if (!thread_id)
+		return;
+#ifdef ENABLE_RTOS
+	if (gdb_rtos_active()) {
+		gdb_rtos_thread = thread_id == rtos_current_thread(cur_target) ? 0U : thread_id;
+		return;
+	}
+#endif
+	if (gdb_threads[thread_id - 1U] != cur_target) {
+		cur_target = gdb_threads[thread_id - 1U];
+		/* The other core may well have written to memory this one has cached */
+		target_mem_cache_flush(cur_target);
+	}
+}
+
+/* Make the freshly attached cur_target thread 1, and attach the other cores of its device as further threads */
+static void gdb_threads_attach(void)
+{
+	gdb_rtos_invalidate();
+	gdb_thread_count = 0U;
+	gdb_threads_polled = 0U;
+	if (!cur_target)
+		return;
+	gdb_threads[gdb_thread_count++] = cur_target;
+	target_foreach(gdb_thread_sibling_attach, cur_target);
+	if (gdb_thread_count > 1U)
+		DEBUG_INFO("Attached %u cores as GDB threads\n", (unsigned)gdb_thread_count);
+}
+
+/* Detach from all of GDB's threads, remembering the core it attached to so that can be reattached later */
+static void gdb_threads_detach(void)
+{
+	if (gdb_thread_count)
+		last_target = gdb_threads[0];
+	else if (cur_target) {
+		last_target = cur_target;
+		target_detach(cur_target);
+	}
+	for (size_t idx = 0U; idx < gdb_thread_count; ++idx)
+		target_detach(gdb_threads[idx]);
+	gdb_thread_count = 0U;
+	gdb_threads_polled = 0U;
+	cur_target = NULL;
+}
+
+#if CONFIG_BMDA == 1
+bool gdb_persist = false;
+
+/* Give a new connection to a persistent server the target the last one had, finding it first if need be */
+static void gdb_persist_attach(void)
+{
+	if (last_target) {
+		cur_target = target_attach(last_target, &gdb_controller);
+		/* The target may have been reset or power cycled out from under us since, so have another look for it */
+		if (!cur_target) {
+			DEBUG_WARN("Could not reattach to the previous target, scanning again\n");
+			target_list_free();
+		}
+	}
+	if (!cur_target) {
+		const size_t number = bmda_persist_target();
+		if (number)
+			cur_target = target_attach_n(number, &gdb_controller);
+	}
+	gdb_threads_attach();
+	if (cur_target)
+		morse(NULL, false);
+}
+#endif
+
+/* Set the threads in resume_mask going, single stepping those also in step_mask, and watch them for a halt */
+static void gdb_threads_resume(const uint8_t resume_mask, const uint8_t step_mask)
+{
+	gdb_rtos_invalidate();
+	for (size_t idx = 0U; idx < gdb_thread_count; ++idx) {
+		const uint8_t bit = 1U << idx;
+		if (resume_mask & bit)
+			target_halt_resume(gdb_threads[idx], step_mask & bit);
+	}
+	gdb_threads_polled = resume_mask;
+	SET_RUN_STATE(true);
+	gdb_target_running = true;
+}
+
+/*
+ * Once one core halts, bring the others to a halt too so GDB gets the consistent all-stop view it expects.
+ * This is done from the probe rather than through the device's CTIs, so the other cores run on a little
+ * way past the point the first one stopped at.
+ */
+static void gdb_threads_halt(const target_s *const stopped)
+{
+	for (size_t idx = 0U; idx < gdb_thread_count; ++idx) {
+		if ((gdb_threads_polled & (1U << idx)) && gdb_threads[idx] != stopped)
+			target_halt_request(gdb_threads[idx]);
+	}
+	for (size_t idx = 0U; idx < gdb_thread_count; ++idx) {
+		if (!(gdb_threads_polled & (1U << idx)) || gdb_threads[idx] == stopped)
+			continue;
+		platform_timeout_s timeout;
+		platform_timeout_set(&timeout, GDB_THREAD_HALT_TIMEOUT_MS);
+		while (target_halt_poll(gdb_threads[idx], NULL) == TARGET_HALT_RUNNING) {
+			if (platform_timeout_is_expired(&timeout)) {
+				DEBUG_WARN("Core %u failed to halt\n", (unsigned)(idx + 1U));
+				break;
+			}
+		}
+	}
+	gdb_threads_polled = 0U;
+}
+
 /* execute gdb remote command stored in 'pbuf'. returns immediately, no busy waiting. */
 int32_t gdb_main_loop(target_controller_s *const tc, const gdb_packet_s *const packet, const bool in_syscall)
 {
@@ -127,8 +390,13 @@ int32_t gdb_main_loop(target_controller_s *const tc, const gdb_packet_s *const p
 		const size_t reg_size = target_regs_size(cur_target);
 		if (reg_size) {
 			uint8_t *gp_regs = alloca(reg_size);
-			target_regs_read(cur_target, gp_regs);
-			gdb_put_packet_hex(gp_regs, reg_size);
+			/* A short reply is fine, GDB then asks for any registers it left out with 'p' as it needs them */
+			const size_t length = target_regs_read_core(cur_target, gp_regs);
+			/* For an RTOS thread that isn't running, the core registers are the ones its kernel saved */
+			uint32_t thread_regs[RTOS_THREAD_REG_COUNT];
+			if (gdb_rtos_thread_regs(thread_regs))
+				memcpy(gp_regs, thread_regs, MIN(sizeof(thread_regs), length));
+			gdb_put_packet_hex(gp_regs, length);
 		} else {
 			/**
 			 * Register data is unavailable
@@ -159,8 +427,32 @@ int32_t gdb_main_loop(target_controller_s *const tc, const gdb_packet_s *const p
 			gdb_put_packet_error(0xffU);
 		break;
 	}
+	case 'x': { /* 'x addr,len': Read len bytes from addr, replying in binary */
+		uint32_t addr, len;
+		ERROR_IF_NO_TARGET();
+		if (read_hex32(packet->data + 1, &rest, &addr, ',') && read_hex32(rest, NULL, &len, READ_HEX_NO_FOLLOW)) {
+			/* The reply is allowed to be short, so clamp the request to what the 'b' reply could ever hold */
+			len = MIN(len, GDB_PACKET_BUFFER_SIZE - 1U);
+			DEBUG_GDB("x packet: addr = %" PRIx32 ", len = %" PRIx32 "\n", addr, len);
+			uint8_t *mem = alloca(len);
+			if (target_mem32_read(cur_target, mem, addr, len))
+				gdb_put_packet_error(1U);
+			else {
+				/* Trim the data to what fits in the packet once its reserved characters are escaped */
+				const size_t amount = gdb_packet_escaped_fit((const char *)mem, len, GDB_PACKET_BUFFER_SIZE - 1U);
+				gdb_put_packet("b", 1U, (const char *)mem, amount, false);
+			}
+		} else
+			gdb_put_packet_error(0xffU);
+		break;
+	}
 	case 'G': { /* 'G XX': Write general registers */
 		ERROR_IF_NO_TARGET();
+		/* The registers of an RTOS thread that isn't running are only ever read back from its stack */
+		if (gdb_rtos_thread_selected()) {
+			gdb_put_packet_error(1U);
+			break;
+		}
 		const size_t reg_size = target_regs_size(cur_target);
 		if (reg_size) {
 			uint8_t *gp_regs = alloca(reg_size);
@@ -200,7 +492,19 @@ int32_t gdb_main_loop(target_controller_s *const tc, const gdb_packet_s *const p
 		 * Since we don't care about the operation just skip it but check there is at least 3 characters
 		 * in the packet.
 		 */
-		if (packet->size >= 3 && read_hex32(packet->data + 2, NULL, &thread_id, READ_HEX_NO_FOLLOW) && thread_id <= 1)
+		if (packet->size >= 3 && read_hex32(packet->data + 2, NULL, &thread_id, READ_HEX_NO_FOLLOW) &&
+			(thread_id <= 1U || gdb_thread_valid(thread_id))) {
+			/* `Hg` picks the thread that register and memory accesses go to */
+			if (packet->data[1] == 'g' && gdb_thread_valid(thread_id))
+				gdb_thread_select(thread_id);
+			gdb_put_packet_ok();
+		} else
+			gdb_put_packet_error(1U);
+		break;
+	}
+	case 'T': { /* 'T thread-id': Check if the thread is alive */
+		uint32_t thread_id = 0;
+		if (read_hex32(packet->data + 1, NULL, &thread_id, READ_HEX_NO_FOLLOW) && gdb_thread_valid(thread_id))
 			gdb_put_packet_ok();
 		else
 			gdb_put_packet_error(1U);
@@ -216,10 +520,17 @@ int32_t gdb_main_loop(target_controller_s *const tc, const gdb_packet_s *const p
 			break;
 		}
 
-		target_halt_resume(cur_target, single_step);
-		SET_RUN_STATE(true);
+		/* A step only steps the selected core, while a continue sets all of them going */
+		if (single_step)
+			gdb_threads_resume(gdb_thread_bit(cur_target), gdb_thread_bit(cur_target));
+		else
+			gdb_threads_resume((1U << gdb_thread_count) - 1U, 0U);
 		BMD_FALLTHROUGH
 	case '?': { /* '?': Request reason for target halt */
+#if CONFIG_BMDA == 1
+		if (!cur_target && gdb_persist)
+			gdb_persist_attach();
+#endif
 		/*
 		 * This packet isn't documented as being mandatory,
 		 * but GDB doesn't work without it.
@@ -229,6 +540,23 @@ int32_t gdb_main_loop(target_controller_s *const tc, const gdb_packet_s *const p
 			break;
 		}
 
+		/* In non-stop mode, `?` is answered straight away with OK if the target's running, or the last stop */
+		if (gdb_non_stop && packet->data[0] == '?') {
+			if (gdb_target_running) {
+				gdb_put_packet_ok();
+				break;
+			}
+			if (gdb_stop_reply[0]) {
+				gdb_put_packet_str(gdb_stop_reply);
+				break;
+			}
+			/* Nothing's been reported yet, so have the halt poll work out why it's stopped and reply normally */
+			gdb_stop_reply_sync = true;
+		}
+		/* A bare `?` only needs to find out why the selected core stopped */
+		if (packet->data[0] == '?')
+			gdb_threads_polled = gdb_thread_bit(cur_target);
+
 		/*
 		 * The target is running, so there is no response to give.
 		 * The calling function will poll the state of the target
@@ -248,7 +576,12 @@ int32_t gdb_main_loop(target_controller_s *const tc, const gdb_packet_s *const p
 				gdb_put_packet_error(0xffU);
 			else {
 				uint8_t val[8];
-				const size_t length = target_reg_read(cur_target, reg, val, sizeof(val));
+				size_t length = target_reg_read(cur_target, reg, val, sizeof(val));
+				uint32_t thread_regs[RTOS_THREAD_REG_COUNT];
+				if (reg < RTOS_THREAD_REG_COUNT && gdb_rtos_thread_regs(thread_regs)) {
+					memcpy(val, &thread_regs[reg], sizeof(uint32_t));
+					length = sizeof(uint32_t);
+				}
 				if (length != 0)
 					gdb_put_packet_hex(val, length);
 				else
@@ -268,6 +601,10 @@ int32_t gdb_main_loop(target_controller_s *const tc, const gdb_packet_s *const p
 	}
 	case 'P': { /* Write single register */
 		ERROR_IF_NO_TARGET();
+		if (gdb_rtos_thread_selected()) {
+			gdb_put_packet_error(1U);
+			break;
+		}
 		if (cur_target->reg_write) {
 			/*
 			 * P packets are in the form P[reg]=<value> where [reg] is a hexadecimal-encoded register number
@@ -322,22 +659,27 @@ int32_t gdb_main_loop(target_controller_s *const tc, const gdb_packet_s *const p
 		break;
 
 	case '\x04':
-	case 'D': /* GDB 'detach' command. */
+	case 'D': { /* GDB 'detach' command. */
 #if CONFIG_BMDA == 1
 		if (shutdown_bmda)
 			return 0;
 #endif
-		if (cur_target) {
+		bool detach = cur_target || gdb_thread_count;
+#if CONFIG_BMDA == 1
+		/* A persistent server stays attached when the connection goes, ready for the next one */
+		if (gdb_persist && packet->data[0] == '\x04')
+			detach = false;
+#endif
+		if (detach) {
 			SET_RUN_STATE(true);
-			target_detach(cur_target);
-			last_target = cur_target;
-			cur_target = NULL;
+			gdb_threads_detach();
 		}
 		if (packet->data[0] == 'D')
 			gdb_put_packet_ok();
 		else /* packet->data[0] == '\x04' */
 			gdb_set_noackmode(false);
 		break;
+	}
 
 	case 'k': /* Kill the target */
 		handle_kill_target();
@@ -345,10 +687,12 @@ int32_t gdb_main_loop(target_controller_s *const tc, const gdb_packet_s *const p
 
 	case 'r': /* Reset the target system */
 	case 'R': /* Restart the target program */
+		gdb_rtos_invalidate();
 		if (cur_target)
 			target_reset(cur_target);
 		else if (last_target) {
 			cur_target = target_attach(last_target, &gdb_controller);
+			gdb_threads_attach();
 			if (cur_target)
 				morse(NULL, false);
 			target_reset(cur_target);
@@ -432,29 +776,30 @@ static void exec_q_rcmd(const char *packet, const size_t length)
 	}
 }
 
-static void handle_q_string_reply(const char *reply, const char *param)
+/* Serve a chunk of a qXfer document, returning true once the end of it has been reported */
+static bool handle_q_string_reply(const char *reply, const size_t reply_length, const char *param)
 {
-	const size_t reply_length = strlen(reply);
 	uint32_t addr = 0;
 	uint32_t len = 0;
 	const char *rest = NULL;
 
 	if (!read_hex32(param, &rest, &addr, ',') || !read_hex32(rest, NULL, &len, READ_HEX_NO_FOLLOW)) {
 		gdb_put_packet_error(1U);
-		return;
+		return false;
 	}
 	if (addr > reply_length) {
 		gdb_put_packet_error(1U);
-		return;
+		return true;
 	}
 	if (addr == reply_length) {
 		gdb_put_packet_str("l");
-		return;
+		return true;
 	}
 	size_t output_len = reply_length - addr;
 	if (output_len > len)
 		output_len = len;
-	gdb_put_packet("m", 1U, reply + addr, output_len, false);
+	gdb_put_packet_compressed("m", 1U, reply + addr, output_len, false);
+	return false;
 }
 
 static void exec_q_supported(const char *packet, const size_t length)
@@ -472,6 +817,10 @@ static void exec_q_supported(const char *packet, const size_t length)
 	 */
 	if (gdb_noackmode())
 		gdb_packet_ack(true);
+	/* Likewise a new session starts out in all-stop mode until GDB asks otherwise */
+	gdb_non_stop = false;
+	gdb_stop_reply[0] = '\0';
+	gdb_stop_reply_sync = false;
 
 	/*
 	 * The Remote Protocol documentation is not clear on what format the PacketSize feature should be in,
@@ -479,7 +828,7 @@ static void exec_q_supported(const char *packet, const size_t length)
 	 * to be parsed by strtoul() with a base of 16.
 	 */
 	gdb_putpacket_str_f("PacketSize=%x;qXfer:memory-map:read+;qXfer:features:read+;"
-						"vContSupported+" GDB_QSUPPORTED_NOACKMODE,
+						"vContSupported+;binary-upload+;QNonStop+" GDB_QSUPPORTED_NOACKMODE,
 		GDB_PACKET_BUFFER_SIZE);
 
 	/*
@@ -505,9 +854,15 @@ static void exec_q_memory_map(const char *packet, const size_t length)
 		gdb_put_packet_error(1U);
 		return;
 	}
-	char buf[1024];
-	target_mem_map(target, buf, sizeof(buf)); /* Fixme: Check size!*/
-	handle_q_string_reply(buf, packet);
+	/* The map is generated on the first chunk and served from the cache until GDB has read all of it */
+	size_t map_length = 0U;
+	const char *const map = target_mem_map_xml(target, &map_length);
+	if (!map) {
+		gdb_put_packet_error(1U);
+		return;
+	}
+	if (handle_q_string_reply(map, map_length, packet))
+		target_xml_release(target);
 }
 
 static void exec_q_feature_read(const char *packet, const size_t length)
@@ -522,12 +877,31 @@ static void exec_q_feature_read(const char *packet, const size_t length)
 		gdb_put_packet_error(1U);
 		return;
 	}
-	const char *const description = target_regs_description(target);
-	handle_q_string_reply(description ? description : "", packet);
-#pragma GCC diagnostic push
-#pragma GCC diagnostic ignored "-Wcast-qual"
-	free((void *)description);
-#pragma GCC diagnostic pop
+	uint32_t addr = 0;
+	uint32_t len = 0;
+	const char *rest = NULL;
+	if (!read_hex32(packet, &rest, &addr, ',') || !read_hex32(rest, NULL, &len, READ_HEX_NO_FOLLOW)) {
+		gdb_put_packet_error(1U);
+		return;
+	}
+	/*
+	 * The description is generated straight into the packet buffer just after the 'm' it goes out with,
+	 * which is safe as the request that was in there has been parsed already
+	 */
+	char *const reply = gdb_packet_buffer();
+	size_t total = 0U;
+	const size_t amount =
+		target_description_read(target, reply + 1U, addr, MIN(len, GDB_PACKET_BUFFER_SIZE - 1U), &total);
+	if (addr > total) {
+		gdb_put_packet_error(1U);
+		target_xml_release(target);
+	} else if (!amount) {
+		gdb_put_packet_str("l");
+		target_xml_release(target);
+	} else {
+		reply[0] = 'm';
+		gdb_put_packet_compressed(reply, amount + 1U, NULL, 0U, false);
+	}
 }
 
 static void exec_q_crc(const char *packet, const size_t length)
@@ -557,25 +931,82 @@ static void exec_q_c(const char *packet, const size_t length)
 {
 	(void)packet;
 	(void)length;
-	gdb_put_packet_str("QC1");
+	gdb_putpacket_str_f("QC%" PRIx32, gdb_current_thread_id());
 }
 
 /*
  * qfThreadInfo queries are required in GDB 11 and 12 as these GDBs require the server to support
  * threading even when there's only the possibility for one thread to exist. In this instance,
- * we have to tell GDB that there is a single active thread so it doesn't think the "thread" died.
+ * we have to tell GDB that there is at least a single active thread so it doesn't think the "thread" died.
+ * With a multi-core device, each core is listed as a thread.
  * qsThreadInfo will always follow qfThreadInfo when we reply as we have to specify 'l' at the
  * end to terminate the list.. GDB doesn't like this not happening.
  */
 static void exec_q_thread_info(const char *packet, const size_t length)
 {
 	(void)length;
-	if (packet[-11] == 'f' && cur_target)
-		gdb_put_packet_str("m1");
-	else
+#ifdef ENABLE_RTOS
+	/* RTOS thread lists can be long, so they're handed out a batch at a time */
+	if (cur_target && gdb_rtos_active()) {
+		if (packet[-11] == 'f')
+			gdb_thread_info_next = 0U;
+		const size_t count = rtos_thread_count(cur_target);
+		if (gdb_thread_info_next >= count) {
+			gdb_put_packet_str("l");
+			return;
+		}
+		char reply[GDB_THREAD_INFO_BATCH * 9U + 2U] = "m";
+		size_t offset = 1U;
+		for (size_t idx = 0U; idx < GDB_THREAD_INFO_BATCH && gdb_thread_info_next < count; ++idx) {
+			offset += (size_t)snprintf(reply + offset, sizeof(reply) - offset, "%s%" PRIx32, idx ? "," : "",
+				rtos_thread_id(gdb_thread_info_next++));
+		}
+		gdb_put_packet_str(reply);
+		return;
+	}
+#endif
+	if (packet[-11] == 'f' && cur_target) {
+		/* Thread IDs are all a single hex digit, so this is 'm' followed by a comma separated list of digits */
+		char reply[GDB_MAX_THREADS * 2U + 1U];
+		size_t offset = 0U;
+		reply[offset++] = 'm';
+		for (size_t idx = 0U; idx < MAX(gdb_thread_count, 1U); ++idx) {
+			if (idx)
+				reply[offset++] = ',';
+			reply[offset++] = hex_digit(idx + 1U);
+		}
+		reply[offset] = '\0';
+		gdb_put_packet_str(reply);
+	} else
 		gdb_put_packet_str("l");
 }
 
+/*
+ * qThreadExtraInfo queries give GDB a description of the thread to show in `info threads` -
+ * the core's name, or for an RTOS thread its name and state.
+ */
+static void exec_q_thread_extra_info(const char *packet, const size_t length)
+{
+	(void)length;
+	uint32_t thread_id = 0U;
+	if (!read_hex32(packet, NULL, &thread_id, READ_HEX_NO_FOLLOW) || !gdb_thread_valid(thread_id)) {
+		gdb_put_packet_error(1U);
+		return;
+	}
+	char info[64U];
+#ifdef ENABLE_RTOS
+	if (gdb_rtos_active())
+		rtos_thread_describe(cur_target, thread_id, info, sizeof(info));
+	else
+#endif
+	{
+		const target_s *const target = gdb_threads[thread_id - 1U];
+		snprintf(
+			info, sizeof(info), "%s%s%s", target->driver, target->core ? " " : "", target->core ? target->core : "");
+	}
+	gdb_put_packet_hex(info, strlen(info));
+}
+
 /*
  * GDB will send the packet 'QStartNoAckMode' to enable NoAckMode
  *
@@ -597,6 +1028,23 @@ static void exec_q_noackmode(const char *packet, const size_t length)
 	gdb_put_packet_ok();
 }
 
+/*
+ * GDB sends `QNonStop:1` to switch to non-stop mode, and `QNonStop:0` to go back to all-stop.
+ * As there's only ever the one thread, non-stop mostly changes how stops are reported and that
+ * we carry on servicing packets (memory reads especially) while the target runs.
+ */
+static void exec_q_non_stop(const char *packet, const size_t length)
+{
+	if (length != 1U || (packet[0] != '0' && packet[0] != '1')) {
+		gdb_put_packet_error(1U);
+		return;
+	}
+	gdb_non_stop = packet[0] == '1';
+	gdb_stop_reply[0] = '\0';
+	gdb_stop_reply_sync = false;
+	gdb_put_packet_ok();
+}
+
 /*
  * qAttached queries determine if GDB attached to an existing process, or a new one.
  * What that means in practical terms, is whether the session ending should `k` or `D`
@@ -623,6 +1071,97 @@ static void exec_q_attached(const char *packet, const size_t length)
 		gdb_put_packet_str("0"); /* It does tolelrate reset */
 }
 
+#if defined(ENABLE_RTT) || defined(ENABLE_RTOS)
+#define GDB_SYMBOL_NAME_MAX 32U
+
+#ifdef ENABLE_RTT
+static const char gdb_rtt_symbol[] = "_SEGGER_RTT";
+#endif
+
+/* The symbols we want GDB to look up, in the order they're asked for, NULL past the last */
+static const char *gdb_symbol_name(size_t index)
+{
+#ifdef ENABLE_RTT
+	if (index == 0U)
+		return gdb_rtt_symbol;
+	--index;
+#endif
+#ifdef ENABLE_RTOS
+	return rtos_symbol_name(index);
+#else
+	return NULL;
+#endif
+}
+
+static void gdb_symbol_value(size_t index, const uint32_t value)
+{
+	DEBUG_GDB("Symbol %s: 0x%08" PRIx32 "\n", gdb_symbol_name(index), value);
+#ifdef ENABLE_RTT
+	if (index == 0U) {
+		rtt_cbaddr_hint = value;
+		return;
+	}
+	--index;
+#endif
+#ifdef ENABLE_RTOS
+	rtos_symbol_value(index, value);
+#endif
+}
+
+/* Ask GDB to look up the symbol at index, or tell it we're done once past the last one */
+static void gdb_symbol_request(const size_t index)
+{
+	const char *const name = gdb_symbol_name(index);
+	if (name)
+		gdb_put_packet("qSymbol:", 8U, name, strlen(name), true);
+	else
+		gdb_put_packet_ok();
+}
+
+/*
+ * qSymbol packets let us look up symbols in the program GDB has loaded. GDB sends "qSymbol::"
+ * whenever it has new symbols to offer, we reply asking for the first symbol we want, and GDB
+ * answers with "qSymbol:VALUE:NAME", or "qSymbol::NAME" if the program doesn't have it. We then
+ * ask for the next one, and so on, until replying OK once there's nothing more we want to know.
+ * Having the address of the RTT control block means find_rtt() can go straight to it instead of
+ * scanning, and the kernel's symbols are what the RTOS awareness works from.
+ */
+static void exec_q_symbol(const char *packet, const size_t length)
+{
+	/* GDB is offering to look symbols up, so start asking from the top */
+	if (length == 1U && packet[0] == ':') {
+#ifdef ENABLE_RTOS
+		rtos_reset();
+#endif
+		gdb_symbol_request(0U);
+		return;
+	}
+
+	/* Otherwise this is an answer, work out which of our symbols it's for and if it has a value */
+	const char *const name_hex = memchr(packet, ':', length);
+	const size_t name_length = name_hex ? (size_t)(packet + length - (name_hex + 1U)) / 2U : 0U;
+	if (!name_length || name_length > GDB_SYMBOL_NAME_MAX) {
+		gdb_put_packet_ok();
+		return;
+	}
+	char name[GDB_SYMBOL_NAME_MAX + 1U] = {0};
+	unhexify(name, name_hex + 1U, name_length);
+	uint32_t value = 0;
+	if (name_hex == packet || !read_hex32(packet, NULL, &value, ':'))
+		value = 0;
+
+	for (size_t index = 0U; gdb_symbol_name(index); ++index) {
+		if (strcmp(gdb_symbol_name(index), name) == 0) {
+			gdb_symbol_value(index, value);
+			gdb_symbol_request(index + 1U);
+			return;
+		}
+	}
+	/* Not one of ours, so there's nothing more to ask */
+	gdb_put_packet_ok();
+}
+#endif
+
 static const cmd_executer_s q_commands[] = {
 	{"qRcmd,", exec_q_rcmd},
 	{"qSupported", exec_q_supported},
@@ -632,8 +1171,13 @@ static const cmd_executer_s q_commands[] = {
 	{"qC", exec_q_c},
 	{"qfThreadInfo", exec_q_thread_info},
 	{"qsThreadInfo", exec_q_thread_info},
+	{"qThreadExtraInfo,", exec_q_thread_extra_info},
 	{"QStartNoAckMode", exec_q_noackmode},
+	{"QNonStop:", exec_q_non_stop},
 	{"qAttached", exec_q_attached},
+#if defined(ENABLE_RTT) || defined(ENABLE_RTOS)
+	{"qSymbol:", exec_q_symbol},
+#endif
 	{NULL, NULL},
 };
 
@@ -641,9 +1185,7 @@ static void handle_kill_target(void)
 {
 	if (cur_target) {
 		target_reset(cur_target);
-		target_detach(cur_target);
-		last_target = cur_target;
-		cur_target = NULL;
+		gdb_threads_detach();
 	}
 }
 
@@ -663,10 +1205,11 @@ static void exec_v_attach(const char *const packet, const size_t length)
 	if (read_hex32(packet, NULL, &addr, READ_HEX_NO_FOLLOW)) {
 		/* Attach to remote target processor */
 		cur_target = target_attach_n(addr, &gdb_controller);
+		gdb_threads_attach();
 		if (cur_target) {
 			morse(NULL, false);
 			/*
-			 * We don't actually support threads, but GDB 11 and 12 can't work without
+			 * The core attached to is always thread 1, and GDB 11 and 12 can't work without
 			 * us saying we attached to thread 1.. see the following for the low-down of this:
 			 * https://sourceware.org/bugzilla/show_bug.cgi?id=28405
 			 * https://sourceware.org/bugzilla/show_bug.cgi?id=28874
@@ -737,12 +1280,14 @@ static void exec_v_run(const char *packet, const size_t length)
 	rtt_found = false;
 #endif
 	/* Run target program. For us (embedded) this means reset. */
+	gdb_rtos_invalidate();
 	if (cur_target) {
 		target_set_cmdline(cur_target, cmdline, offset);
 		target_reset(cur_target);
 		gdb_put_packet_str("T05");
 	} else if (last_target) {
 		cur_target = target_attach(last_target, &gdb_controller);
+		gdb_threads_attach();
 
 		/* If we were able to attach to the target again */
 		if (cur_target) {
@@ -765,15 +1310,13 @@ static void exec_v_cont(const char *packet, const size_t length)
 		/*
 		 * It is, so reply with what we support doing when receiving the command version of this packet.
 		 *
-		 * We support 'c' (continue), 'C' (continue + signal), and 's' (step) actions.
+		 * We support 'c' (continue), 'C' (continue + signal), 's' (step) and 'r' (range step) actions.
 		 * If we didn't support both 'c' and 'C', then GDB would disable vCont usage even though
 		 * 'C' doesn't make any sense in our context.
 		 * See https://github.com/bminor/binutils-gdb/blob/de2efa143e3652d69c278dd1eb10a856593917c0/gdb/remote.c#L6526
-		 * for more details.
-		 *
-		 * TODO: Support the 't' (stop) action needed for non-stop debug so GDB can request a halt.
+		 * for more details. The 't' (stop) action is how GDB requests a halt in non-stop mode.
 		 */
-		gdb_put_packet_str("vCont;c;C;s;t");
+		gdb_put_packet_str("vCont;c;C;s;t;r");
 		return;
 	}
 
@@ -783,25 +1326,97 @@ static void exec_v_cont(const char *packet, const size_t length)
 		return;
 	}
 
-	bool single_step = false;
-	switch (packet[1]) {
-	case 's': /* 's': Single step */
-		single_step = true;
-		BMD_FALLTHROUGH
-	case 'c': /* 'c': Continue */
-	case 'C': /* 'C sig': Continue with signal */
-		if (!cur_target) {
-			gdb_put_packet_str("X1D");
+	/*
+	 * Work out what each thread is to do. The packet is a list of `;action[:thread-id]`, where an action
+	 * without a thread ID applies to every thread that an earlier action didn't already cover.
+	 */
+	char actions[GDB_MAX_THREADS] = {0};
+	gdb_range_step_start = 0U;
+	gdb_range_step_end = 0U;
+	gdb_range_step_target = NULL;
+	for (const char *action = packet; action && action[0] == ';'; action = strchr(action + 1U, ';')) {
+		const char kind = action[1U];
+		const char *rest = action + 2U;
+		if (kind == 'r') { /* 'r start,end': Step while the PC stays in [start, end) */
+			uint32_t start = 0U;
+			uint32_t end = 0U;
+			if (!read_hex32(rest, &rest, &start, ',') || !read_hex32(rest, &rest, &end, READ_HEX_NO_FOLLOW)) {
+				gdb_put_packet_error(1U);
+				return;
+			}
+			/* The step loop in gdb_poll_target() handles stepping the rest of the range */
+			gdb_range_step_start = start;
+			gdb_range_step_end = end;
+		} else if (kind == 'C') {
+			/* Skip over the signal, which doesn't make any sense in our context */
+			while (is_hex(rest[0]))
+				++rest;
+		}
+		/* A thread ID of -1 means all threads, just like leaving it off */
+		uint32_t thread_id = rest[0] == ':' && rest[1U] != '-' ? strtoul(rest + 1U, NULL, 16) : 0U;
+		/* RTOS threads all run on the one core */
+		if (thread_id && gdb_rtos_active())
+			thread_id = 1U;
+		for (size_t idx = 0U; idx < gdb_thread_count; ++idx) {
+			if (!actions[idx] && (!thread_id || thread_id == idx + 1U))
+				actions[idx] = kind;
+		}
+	}
+
+	uint8_t resume_mask = 0U;
+	uint8_t step_mask = 0U;
+	uint8_t stop_mask = 0U;
+	for (size_t idx = 0U; idx < gdb_thread_count; ++idx) {
+		const uint8_t bit = 1U << idx;
+		switch (actions[idx]) {
+		case 'r': /* 'r start,end': Range step */
+			gdb_range_step_target = gdb_threads[idx];
+			BMD_FALLTHROUGH
+		case 's': /* 's': Single step */
+			step_mask |= bit;
+			BMD_FALLTHROUGH
+		case 'c': /* 'c': Continue */
+		case 'C': /* 'C sig': Continue with signal */
+			resume_mask |= bit;
+			break;
+		case 't': /* 't': Stop, only valid in non-stop mode */
+			stop_mask |= bit;
+			break;
+		default:
 			break;
 		}
+	}
 
-		target_halt_resume(cur_target, single_step);
-		SET_RUN_STATE(true);
-		gdb_target_running = true;
-		break;
-	default:
-		break;
+	if (stop_mask) {
+		if (!gdb_non_stop) {
+			gdb_put_packet_error(1U);
+			return;
+		}
+		gdb_put_packet_ok();
+		if (gdb_target_running) {
+			/* Halting any one of the running cores brings the rest to a halt with it */
+			for (size_t idx = 0U; idx < gdb_thread_count; ++idx) {
+				if (stop_mask & gdb_threads_polled & (1U << idx))
+					target_halt_request(gdb_threads[idx]);
+			}
+			gdb_halt_poll_reset();
+		} else {
+			/* Already stopped, but GDB still expects to be told so with a stop for signal 0 */
+			snprintf(gdb_stop_reply, sizeof(gdb_stop_reply), "T%02Xthread:%" PRIx32 ";", GDB_SIG0,
+				gdb_current_thread_id());
+			gdb_stop_notify();
+		}
+		return;
+	}
+
+	if (!resume_mask) {
+		gdb_put_packet_error(1U);
+		return;
 	}
+	gdb_threads_resume(resume_mask, step_mask);
+	/* In non-stop mode the resume is acknowledged now, and the stop comes later as a notification */
+	if (gdb_non_stop)
+		gdb_put_packet_ok();
 }
 
 static void exec_v_flash_erase(const char *packet, const size_t length)
@@ -819,10 +1434,15 @@ static void exec_v_flash_erase(const char *packet, const size_t length)
 			return;
 		}
 
-		if (target_flash_erase(cur_target, addr, len))
+		/* Every load starts with an erase, so that's where a persistent Flash session gets (re)started */
+		if (flash_session_persist)
+			target_flash_session_begin(cur_target);
+		/* GDB always follows up with vFlashDone, so the erase can be done as the data is written */
+		const target_flash_range_s range = {.addr = addr, .length = len};
+		if (target_flash_for_addr(cur_target, addr) && target_flash_erase_on_write(cur_target, &range, 1U))
 			gdb_put_packet_ok();
 		else {
-			target_flash_complete(cur_target);
+			target_flash_session_end(cur_target);
 			gdb_put_packet_error(0xffU);
 		}
 	} else
@@ -840,7 +1460,8 @@ static void exec_v_flash_write(const char *packet, const size_t length)
 		if (cur_target && target_flash_write(cur_target, addr, (const uint8_t *)rest, count))
 			gdb_put_packet_ok();
 		else {
-			target_flash_complete(cur_target);
+			if (cur_target)
+				target_flash_session_end(cur_target);
 			gdb_put_packet_error(0xffU);
 		}
 	} else
@@ -858,6 +1479,11 @@ static void exec_v_flash_done(const char *packet, const size_t length)
 		gdb_put_packet_error(0xffU);
 }
 
+/*
+ * vStopped acknowledges a `%Stop` notification and asks for the next queued stop reply, replying OK
+ * once there are none. With a single thread only the one stop can ever be outstanding, and that was
+ * given in the notification itself, so only the detach notification has anything further to report.
+ */
 static void exec_v_stopped(const char *packet, const size_t length)
 {
 	(void)packet;
@@ -941,6 +1567,28 @@ void gdb_halt_target(void)
 		gdb_put_packet_str("W00");
 }
 
+/* Start polling tightly again, as the target is likely to halt soon */
+void gdb_halt_poll_reset(void)
+{
+	gdb_halt_poll_rounds = 0U;
+	gdb_halt_poll_interval_ms = 0U;
+}
+
+/* Poll a running core, range stepping it on through the range without involving GDB as necessary */
+static target_halt_reason_e gdb_thread_poll(target_s *const target, target_addr64_t *const watch)
+{
+	const target_halt_reason_e reason = target_halt_poll(target, watch);
+	if (reason == TARGET_HALT_STEPPING && target == gdb_range_step_target &&
+		gdb_range_step_start != gdb_range_step_end) {
+		target_addr_t pc = 0U;
+		if (target_pc_read(target, &pc) && pc >= gdb_range_step_start && pc < gdb_range_step_end) {
+			target_halt_resume(target, true);
+			return TARGET_HALT_RUNNING;
+		}
+	}
+	return reason;
+}
+
 /* Poll the running target to see if it halted yet */
 void gdb_poll_target(void)
 {
@@ -950,33 +1598,83 @@ void gdb_poll_target(void)
 		return;
 	}
 
-	/* poll target */
-	target_addr64_t watch;
-	target_halt_reason_e reason = target_halt_poll(cur_target, &watch);
-	if (!reason)
+	/* Check if it's time to look at the target again yet */
+	const uint32_t now = platform_time_ms();
+	if (gdb_halt_poll_interval_ms && now - gdb_halt_poll_last_ms < gdb_halt_poll_interval_ms)
+		return;
+	gdb_halt_poll_last_ms = now;
+
+	/* Poll each of the cores that's been set going, stopping at the first to have halted */
+	target_addr64_t watch = 0U;
+	target_halt_reason_e reason = TARGET_HALT_RUNNING;
+	target_s *stopped = cur_target;
+	if (!gdb_threads_polled)
+		reason = gdb_thread_poll(cur_target, &watch);
+	for (size_t idx = 0U; idx < gdb_thread_count && !reason; ++idx) {
+		if (gdb_threads_polled & (1U << idx)) {
+			stopped = gdb_threads[idx];
+			reason = gdb_thread_poll(stopped, &watch);
+		}
+	}
+	if (!reason) {
+		/* Still running, so back off a bit once the tight polling rounds are used up */
+		if (gdb_halt_poll_rounds < GDB_HALT_POLL_TIGHT_ROUNDS)
+			++gdb_halt_poll_rounds;
+		else
+			gdb_halt_poll_interval_ms = MIN(MAX(gdb_halt_poll_interval_ms * 2U, 1U), gdb_halt_poll_max_ms);
 		return;
+	}
+	/* Make the next run start off polling tightly again */
+	gdb_halt_poll_reset();
+	gdb_range_step_start = 0U;
+	gdb_range_step_end = 0U;
+	gdb_range_step_target = NULL;
+	/* Stop the rest of the cores, and make the one that halted the selected thread, as GDB will assume it is */
+	gdb_threads_halt(stopped);
+	cur_target = stopped;
+	/* Make sure any console output the target produced before halting gets to GDB first */
+	semihosting_console_flush(cur_target);
 
 	/* switch polling off */
 	gdb_target_running = false;
 	SET_RUN_STATE(0);
+	/* With the target halted, an RTOS's running thread can be reported in place of the core */
+	const uint32_t thread_id = gdb_current_thread_id();
 
 	/* Translate reason to GDB signal */
 	switch (reason) {
 	case TARGET_HALT_ERROR:
-		gdb_putpacket_str_f("X%02X", GDB_SIGLOST);
+		snprintf(gdb_stop_reply, sizeof(gdb_stop_reply), "X%02X", GDB_SIGLOST);
 		morse("TARGET LOST.", true);
 		break;
 	case TARGET_HALT_REQUEST:
-		gdb_putpacket_str_f("T%02Xthread:1;", GDB_SIGINT);
+		/* A `vCont;t` stop is reported as signal 0, unlike an interrupt from ^C */
+		snprintf(gdb_stop_reply, sizeof(gdb_stop_reply), "T%02Xthread:%" PRIx32 ";",
+			gdb_non_stop ? GDB_SIG0 : GDB_SIGINT, thread_id);
 		break;
 	case TARGET_HALT_WATCHPOINT:
-		gdb_putpacket_str_f(
-			"T%02Xwatch:%0" PRIX32 "%08" PRIX32 ";", GDB_SIGTRAP, (uint32_t)(watch >> 32U), (uint32_t)watch);
+		snprintf(gdb_stop_reply, sizeof(gdb_stop_reply), "T%02Xwatch:%0" PRIX32 "%08" PRIX32 ";thread:%" PRIx32 ";",
+			GDB_SIGTRAP, (uint32_t)(watch >> 32U), (uint32_t)watch, thread_id);
 		break;
 	case TARGET_HALT_FAULT:
-		gdb_putpacket_str_f("T%02Xthread:1;", GDB_SIGSEGV);
+		snprintf(gdb_stop_reply, sizeof(gdb_stop_reply), "T%02Xthread:%" PRIx32 ";", GDB_SIGSEGV, thread_id);
 		break;
 	default:
-		gdb_putpacket_str_f("T%02Xthread:1;", GDB_SIGTRAP);
+		snprintf(gdb_stop_reply, sizeof(gdb_stop_reply), "T%02Xthread:%" PRIx32 ";", GDB_SIGTRAP, thread_id);
 	}
+
+	/* In all-stop mode, or if a `?` is waiting on it, this is the reply to the packet that set the target going */
+	if (!gdb_non_stop || gdb_stop_reply_sync) {
+		gdb_stop_reply_sync = false;
+		gdb_put_packet_str(gdb_stop_reply);
+	} else
+		gdb_stop_notify();
+}
+
+/* Send the current stop reply to GDB as an asynchronous `%Stop` notification */
+static void gdb_stop_notify(void)
+{
+	char notification[GDB_STOP_REPLY_SIZE + 5U];
+	snprintf(notification, sizeof(notification), "Stop:%s", gdb_stop_reply);
+	gdb_put_notification_str(notification);
 }
@@ -27,7 +27,9 @@
 #include "gdb_if.h"
 #include "gdb_packet.h"
 #include "hex_utils.h"
+#include "buffer_utils.h"
 #include "remote.h"
+#include "stats.h"
 
 #include <stdarg.h>
 
@@ -39,8 +41,26 @@ typedef enum packet_state {
 	PACKET_GDB_CHECKSUM_LOWER,
 } packet_state_e;
 
+/*
+ * Run-length encoding, see https://sourceware.org/gdb/current/onlinedocs/gdb.html/Overview.html#Binary-Data
+ * A character followed by '*' and a count character repeats it (count - 29) more times. Runs shorter than
+ * the minimum aren't worth encoding, and the count character has to stay printable
+ */
+#define GDB_PACKET_RUNLENGTH_MIN    3U
+#define GDB_PACKET_RUNLENGTH_MAX    97U
+#define GDB_PACKET_RUNLENGTH_OFFSET 29U
+
 static bool noackmode = false;
 
+/*
+ * In acknowledgement mode, console output is streamed - sent without stopping to wait for GDB to acknowledge
+ * it, so the programs and monitor commands producing lots of it aren't held up by a round trip per packet.
+ * GDB acknowledges every packet in order, so the acknowledgements still to come for streamed packets are
+ * counted, and skipped over wherever they turn up: when receiving, in the target run loop, or ahead of the
+ * acknowledgement for the next packet we do wait on. A NACK for a streamed packet just loses that output.
+ */
+static size_t acks_pending = 0U;
+
 #ifdef EXTERNAL_PACKET_BUFFER
 extern gdb_packet_s *gdb_full_packet_buffer(void);
 #else
@@ -105,18 +125,17 @@ static inline bool gdb_packet_is_reserved(const char character)
 		character == GDB_PACKET_RUNLENGTH_START;
 }
 
-static uint8_t gdb_packet_checksum(const gdb_packet_s *const packet)
+size_t gdb_packet_escaped_fit(const char *const data, const size_t data_size, const size_t space)
 {
-	/* Calculate the checksum of the packet */
-	uint8_t checksum = 0;
-	for (size_t i = 0; i < packet->size; i++) {
-		const char character = packet->data[i];
-		if (gdb_packet_is_reserved(character))
-			checksum += GDB_PACKET_ESCAPE + (character ^ GDB_PACKET_ESCAPE_XOR);
-		else
-			checksum += character;
+	/* Each reserved character takes two bytes on the wire, everything else takes one */
+	size_t used = 0U;
+	size_t amount = 0U;
+	for (; amount < data_size; ++amount) {
+		used += gdb_packet_is_reserved(data[amount]) ? 2U : 1U;
+		if (used > space)
+			break;
 	}
-	return checksum;
+	return amount;
 }
 
 packet_state_e consume_remote_packet(char *const packet, const size_t size)
@@ -174,11 +193,39 @@ packet_state_e consume_remote_packet(char *const packet, const size_t size)
 #endif
 }
 
-gdb_packet_s *gdb_packet_receive(void)
+#if CONFIG_BMDA == 0
+static void consume_remote_binary_packet(uint8_t *const packet, const size_t size)
+{
+	/* Read the frame header, which gives us the sequence tag, command and payload length */
+	uint8_t header[REMOTE_BINARY_HEADER_LENGTH];
+	for (size_t idx = 0; idx < REMOTE_BINARY_HEADER_LENGTH; ++idx)
+		header[idx] = (uint8_t)gdb_if_getchar();
+	const size_t length = read_le2(header, 2U);
+
+	/* Consume the whole payload so we stay in sync with the host, even if it will not fit in the buffer */
+	for (size_t offset = 0; offset < length; ++offset) {
+		const uint8_t value = (uint8_t)gdb_if_getchar();
+		if (offset < size)
+			packet[offset] = value;
+	}
+	/* Oversized payloads are rejected by the frame handler, which is told the length the host sent */
+	remote_binary_packet_process(header[0], (char)header[1], packet, length);
+}
+#endif
+
+static gdb_packet_s *gdb_packet_capture(packet_state_e state)
 {
-	packet_state_e state = PACKET_IDLE; /* State of the packet capture */
 	uint8_t rx_checksum = 0;
+	/*
+	 * The checksum covers the packet as it was sent, so it's summed up from the characters as they arrive
+	 * rather than afterwards from the unescaped data, which is left in the packet buffer ready to use as-is
+	 */
+	uint8_t checksum = 0;
 	gdb_packet_s *packet = gdb_full_packet_buffer();
+	packet->size = 0;
+	packet->notification = false;
+	packet->run_length_encode = false;
+	packet->streamed = false;
 
 	while (true) {
 		const char rx_char = gdb_if_getchar();
@@ -186,11 +233,15 @@ gdb_packet_s *gdb_packet_receive(void)
 		switch (state) {
 		case PACKET_IDLE:
 			packet->data[0U] = rx_char;
+			gdb_packet_stream_ack(rx_char);
 			if (rx_char == GDB_PACKET_START) {
 				/* Start of GDB packet */
 				state = PACKET_GDB_CAPTURE;
 				packet->size = 0;
+				checksum = 0;
 				packet->notification = false;
+				packet->run_length_encode = false;
+				packet->streamed = false;
 			}
 #if CONFIG_BMDA == 0
 			else if (rx_char == REMOTE_SOM) {
@@ -201,10 +252,16 @@ gdb_packet_s *gdb_packet_receive(void)
 				 */
 				state = consume_remote_packet(packet->data, GDB_PACKET_BUFFER_SIZE);
 				packet->size = 0;
+			} else if (rx_char == REMOTE_BINARY_SOM) {
+				/* Start of BMP remote binary frame */
+				consume_remote_binary_packet((uint8_t *)packet->data, GDB_PACKET_BUFFER_SIZE);
+				packet->size = 0;
 			}
 #endif
 			/* EOT (end of transmission) - connection was closed */
 			else if (rx_char == '\x04') {
+				/* Whatever was still to be acknowledged won't be now */
+				acks_pending = 0U;
 				packet->data[1U] = '\0'; /* Null terminate */
 				packet->size = 1U;
 				return packet;
@@ -215,6 +272,7 @@ gdb_packet_s *gdb_packet_receive(void)
 			if (rx_char == GDB_PACKET_START) {
 				/* Restart GDB packet capture */
 				packet->size = 0;
+				checksum = 0;
 				break;
 			}
 			if (rx_char == GDB_PACKET_END) {
@@ -225,6 +283,7 @@ gdb_packet_s *gdb_packet_receive(void)
 				break;
 			}
 
+			checksum += (uint8_t)rx_char;
 			/* Add to packet buffer, unless it is an escape char */
 			if (rx_char == GDB_PACKET_ESCAPE)
 				/* GDB Escaped char */
@@ -236,6 +295,7 @@ gdb_packet_s *gdb_packet_receive(void)
 
 		case PACKET_GDB_ESCAPE:
 			/* Resolve escaped char */
+			checksum += (uint8_t)rx_char;
 			packet->data[packet->size++] = rx_char ^ GDB_PACKET_ESCAPE_XOR;
 
 			/* Return to normal packet capture */
@@ -257,7 +317,7 @@ gdb_packet_s *gdb_packet_receive(void)
 				rx_checksum |= unhex_digit(rx_char); /* BITWISE OR lower nibble with upper nibble */
 
 				/* (N)Acknowledge packet */
-				const bool checksum_ok = gdb_packet_checksum(packet) == rx_checksum;
+				const bool checksum_ok = checksum == rx_checksum;
 				gdb_packet_ack(checksum_ok);
 				if (!checksum_ok) {
 					/* Checksum error, restart packet capture */
@@ -275,6 +335,7 @@ gdb_packet_s *gdb_packet_receive(void)
 #endif
 
 			/* Return captured packet */
+			stats_event(STATS_GDB_RX, 1U);
 			return packet;
 
 		default:
@@ -289,6 +350,16 @@ gdb_packet_s *gdb_packet_receive(void)
 	}
 }
 
+gdb_packet_s *gdb_packet_receive(void)
+{
+	return gdb_packet_capture(PACKET_IDLE);
+}
+
+gdb_packet_s *gdb_packet_receive_started(void)
+{
+	return gdb_packet_capture(PACKET_GDB_CAPTURE);
+}
+
 void gdb_packet_ack(const bool ack)
 {
 	/* Send ACK/NACK */
@@ -298,36 +369,105 @@ void gdb_packet_ack(const bool ack)
 
 bool gdb_packet_get_ack(const uint32_t timeout)
 {
-	/* Wait for ACK/NACK */
-	const bool ack = gdb_if_getchar_to(timeout) == GDB_PACKET_ACK;
+	/* Wait for ACK/NACK, skipping over those still to come for streamed packets */
+	char response = gdb_if_getchar_to(timeout);
+	for (; acks_pending && (response == GDB_PACKET_ACK || response == GDB_PACKET_NACK); --acks_pending)
+		response = gdb_if_getchar_to(timeout);
+	const bool ack = response == GDB_PACKET_ACK;
 	DEBUG_GDB("%s: %s\n", __func__, ack ? "ACK" : "NACK");
 	return ack;
 }
 
-static inline void gdb_if_putchar_escaped(const char value)
+void gdb_packet_stream_ack(const char character)
+{
+	if (acks_pending && (character == GDB_PACKET_ACK || character == GDB_PACKET_NACK))
+		--acks_pending;
+}
+
+/* Write a character, escaping it if needed, and return what it adds to the checksum */
+static inline uint8_t gdb_if_putchar_escaped(const char value)
 {
 	/* Escape reserved characters */
 	if (gdb_packet_is_reserved(value)) {
+		const char escaped = (char)((uint8_t)value ^ GDB_PACKET_ESCAPE_XOR);
 		gdb_if_putchar(GDB_PACKET_ESCAPE, false);
-		gdb_if_putchar((char)((uint8_t)value ^ GDB_PACKET_ESCAPE_XOR), false);
-	} else {
-		gdb_if_putchar(value, false);
+		gdb_if_putchar(escaped, false);
+		return (uint8_t)(GDB_PACKET_ESCAPE + escaped);
 	}
+	gdb_if_putchar(value, false);
+	return (uint8_t)value;
 }
 
-void gdb_packet_send(const gdb_packet_s *const packet)
+/*
+ * Write out the packet data, run-length encoding it if requested, and return the checksum of what was sent
+ *
+ * Characters that go out as-is are collected into spans which are handed to gdb_if_write() in one go,
+ * so only escapes and run-length markers take the per-character path
+ */
+static uint8_t gdb_packet_write_data(const gdb_packet_s *const packet)
 {
-	/* Calculate checksum first to avoid re-calculation */
-	const uint8_t checksum = gdb_packet_checksum(packet);
+	uint8_t checksum = 0;
+	size_t span_start = 0U;
+	for (size_t i = 0; i < packet->size;) {
+		const char value = packet->data[i];
+		/* Escaped characters can't be run-length encoded */
+		if (gdb_packet_is_reserved(value)) {
+			gdb_if_write(packet->data + span_start, i - span_start, false);
+			checksum += gdb_if_putchar_escaped(value);
+			span_start = ++i;
+			continue;
+		}
+		checksum += (uint8_t)value;
+		++i;
+		if (!packet->run_length_encode)
+			continue;
+
+		/* Count how many more times the character repeats */
+		size_t repeats = 0U;
+		while (i + repeats < packet->size && packet->data[i + repeats] == value)
+			++repeats;
+		/* Short runs go out as-is as part of the span */
+		if (repeats < GDB_PACKET_RUNLENGTH_MIN) {
+			checksum += (uint8_t)((uint8_t)value * repeats);
+			i += repeats;
+			continue;
+		}
+		gdb_if_write(packet->data + span_start, i - span_start, false);
+		i += repeats;
+		span_start = i;
+
+		while (repeats) {
+			/* Short runs go out as-is */
+			if (repeats < GDB_PACKET_RUNLENGTH_MIN) {
+				for (; repeats; --repeats)
+					checksum += gdb_if_putchar_escaped(value);
+				break;
+			}
+			/* The count mustn't come out as a reserved character ('#', '$' etc), so step it down if it does */
+			size_t count = MIN(repeats, GDB_PACKET_RUNLENGTH_MAX);
+			while (gdb_packet_is_reserved((char)(count + GDB_PACKET_RUNLENGTH_OFFSET)))
+				--count;
+			const char count_char = (char)(count + GDB_PACKET_RUNLENGTH_OFFSET);
+			gdb_if_putchar(GDB_PACKET_RUNLENGTH_START, false);
+			gdb_if_putchar(count_char, false);
+			checksum += (uint8_t)(GDB_PACKET_RUNLENGTH_START + count_char);
+			repeats -= count;
+		}
+	}
+	gdb_if_write(packet->data + span_start, packet->size - span_start, false);
+	return checksum;
+}
 
+void gdb_packet_send(const gdb_packet_s *const packet)
+{
+	const uint32_t start = stats_timestamp();
 	/* Attempt packet transmission up to retries */
 	for (size_t attempt = 0U; attempt < GDB_PACKET_RETRIES; attempt++) {
 		/* Write start of packet */
 		gdb_if_putchar(packet->notification ? GDB_PACKET_NOTIFICATION_START : GDB_PACKET_START, false);
 
 		/* Write packet data */
-		for (size_t i = 0; i < packet->size; i++)
-			gdb_if_putchar_escaped(packet->data[i]);
+		const uint8_t checksum = gdb_packet_write_data(packet);
 
 		/* Write end of packet */
 		gdb_if_putchar(GDB_PACKET_END, false);
@@ -341,13 +481,20 @@ void gdb_packet_send(const gdb_packet_s *const packet)
 		gdb_packet_debug(__func__, packet);
 #endif
 
+		/* Streamed packets have their ACK/NACK picked up later */
+		if (packet->streamed && !noackmode && !packet->notification) {
+			++acks_pending;
+			break;
+		}
 		/* Wait for ACK/NACK on standard packets */
 		if (packet->notification || noackmode || gdb_packet_get_ack(2000U))
 			break;
 	}
+	stats_record(STATS_GDB_TX, start);
 }
 
-void gdb_put_packet(const char *preamble, size_t preamble_size, const char *data, size_t data_size, bool hex_data)
+static void gdb_packet_build_and_send(const char *preamble, size_t preamble_size, const char *data,
+	size_t data_size, const bool hex_data, const bool run_length_encode, const bool streamed)
 {
 	gdb_packet_s *packet = gdb_full_packet_buffer();
 
@@ -357,6 +504,8 @@ void gdb_put_packet(const char *preamble, size_t preamble_size, const char *data
 	 * any packets obtained from gdb_packet_receive() will be invalidated
 	 */
 	packet->notification = false;
+	packet->run_length_encode = run_length_encode;
+	packet->streamed = streamed;
 	packet->size = 0;
 
 	/*
@@ -369,7 +518,9 @@ void gdb_put_packet(const char *preamble, size_t preamble_size, const char *data
 	 */
 	if (preamble != NULL && preamble_size > 0) {
 		preamble_size = MIN(preamble_size, GDB_PACKET_BUFFER_SIZE);
-		memcpy(packet->data, preamble, preamble_size);
+		/* A reply can be built in place in the packet buffer and handed over as the preamble */
+		if (preamble != packet->data)
+			memcpy(packet->data, preamble, preamble_size);
 		packet->size = preamble_size;
 	}
 
@@ -395,6 +546,18 @@ void gdb_put_packet(const char *preamble, size_t preamble_size, const char *data
 	gdb_packet_send(packet);
 }
 
+void gdb_put_packet(const char *const preamble, const size_t preamble_size, const char *const data,
+	const size_t data_size, const bool hex_data)
+{
+	gdb_packet_build_and_send(preamble, preamble_size, data, data_size, hex_data, false, false);
+}
+
+void gdb_put_packet_compressed(const char *const preamble, const size_t preamble_size, const char *const data,
+	const size_t data_size, const bool hex_data)
+{
+	gdb_packet_build_and_send(preamble, preamble_size, data, data_size, hex_data, true, false);
+}
+
 void gdb_putpacket_str_f(const char *const fmt, ...)
 {
 	gdb_packet_s *packet = gdb_full_packet_buffer();
@@ -404,6 +567,8 @@ void gdb_putpacket_str_f(const char *const fmt, ...)
 	 * any packets obtained from gdb_packet_receive() will be invalidated
 	 */
 	packet->notification = false;
+	packet->run_length_encode = false;
+	packet->streamed = false;
 
 	/*
 	 * Format the string directly into the packet buffer
@@ -433,6 +598,8 @@ void gdb_put_notification_str(const char *const str)
 	 * any packets obtained from gdb_packet_receive() will be invalidated
 	 */
 	packet->notification = true;
+	packet->run_length_encode = false;
+	packet->streamed = false;
 
 	packet->size = strnlen(str, GDB_PACKET_BUFFER_SIZE);
 	memcpy(packet->data, str, packet->size);
@@ -453,7 +620,7 @@ void gdb_out(const char *const str)
      * Can happen at any time while the program is running and the debugger should continue to wait for ‘W’, ‘T’, etc.
      * This reply is not permitted in non-stop mode.
      */
-	gdb_put_packet("O", 1U, str, strnlen(str, GDB_OUT_PACKET_MAX_SIZE), true);
+	gdb_packet_build_and_send("O", 1U, str, strnlen(str, GDB_OUT_PACKET_MAX_SIZE), true, false, true);
 }
 
 void gdb_voutf(const char *const fmt, va_list ap)
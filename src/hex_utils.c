@@ -25,32 +25,52 @@
 #include "general.h"
 #include "hex_utils.h"
 
+/*
+ * hexify() and unhexify() see every byte of every GDB memory packet and remote protocol payload. Both work
+ * from a table of the 256 digit pairs or branch-free arithmetic on each digit, and on BMDA (which runs on
+ * 64-bit, little endian hosts) convert 4 bytes to or from 8 digits at a time, operating on all the nibbles
+ * in parallel in a uint64_t. That's left out of the firmware as 64-bit arithmetic is a poor fit for its cores.
+ */
+#if CONFIG_BMDA == 1 && (defined(_MSC_VER) || (defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__))
+#define HEX_UTILS_WORDWISE
+#endif
+
+static const char hex_digit_pairs[513] =
+	"000102030405060708090A0B0C0D0E0F101112131415161718191A1B1C1D1E1F"
+	"202122232425262728292A2B2C2D2E2F303132333435363738393A3B3C3D3E3F"
+	"404142434445464748494A4B4C4D4E4F505152535455565758595A5B5C5D5E5F"
+	"606162636465666768696A6B6C6D6E6F707172737475767778797A7B7C7D7E7F"
+	"808182838485868788898A8B8C8D8E8F909192939495969798999A9B9C9D9E9F"
+	"A0A1A2A3A4A5A6A7A8A9AAABACADAEAFB0B1B2B3B4B5B6B7B8B9BABBBCBDBEBF"
+	"C0C1C2C3C4C5C6C7C8C9CACBCCCDCECFD0D1D2D3D4D5D6D7D8D9DADBDCDDDEDF"
+	"E0E1E2E3E4E5E6E7E8E9EAEBECEDEEEFF0F1F2F3F4F5F6F7F8F9FAFBFCFDFEFF";
+
 char hex_digit(const uint8_t value)
 {
-	char digit = (char)value;
-	if (value > 9U)
-		digit += 'A' - '0' - 10U;
-	digit += '0';
-	return digit;
+	return hex_digit_pairs[(value & 0xfU) * 2U + 1U];
 }
 
 char *hexify(char *const dst, const void *const buf, const size_t size)
 {
-	/*
-	 * Convert the source buffer to something we can work with and define a
-	 * counter for the destination buffer indexing
-	 */
 	const uint8_t *const src = (const uint8_t *)buf;
-	size_t dst_idx = 0U;
-
-	/*
-	 * Loop through each byte in the input buffer and convert it to hex,
-	 * writing it to consecutive pairs of bytes in the destination
-	 */
-	for (size_t src_idx = 0U; src_idx < size; ++src_idx) {
-		dst[dst_idx++] = hex_digit(src[src_idx] >> 4U);
-		dst[dst_idx++] = hex_digit(src[src_idx] & 0xfU);
+	size_t idx = 0U;
+#ifdef HEX_UTILS_WORDWISE
+	for (; idx + 4U <= size; idx += 4U) {
+		uint32_t word;
+		memcpy(&word, src + idx, sizeof(word));
+		/* Spread the bytes out to one per 16 bits, then split each into its high nibble and, above that, its low */
+		uint64_t value = word;
+		value = (value | (value << 16U)) & 0x0000ffff0000ffffU;
+		value = (value | (value << 8U)) & 0x00ff00ff00ff00ffU;
+		value = ((value >> 4U) & 0x000f000f000f000fU) | ((value & 0x000f000f000f000fU) << 8U);
+		/* Every byte now holds one nibble, the digits for those past 9 being a further 7 on from '0' + value */
+		const uint64_t letters = ((value + 0x0606060606060606U) >> 4U) & 0x0101010101010101U;
+		value += 0x3030303030303030U + letters * 7U;
+		memcpy(dst + idx * 2U, &value, sizeof(value));
 	}
+#endif
+	for (; idx < size; ++idx)
+		memcpy(dst + idx * 2U, hex_digit_pairs + src[idx] * 2U, 2U);
 
 	/* The hexifued string is *NOT* NUL terminated */
 	return dst;
@@ -58,18 +78,29 @@ char *hexify(char *const dst, const void *const buf, const size_t size)
 
 uint8_t unhex_digit(const char hex)
 {
-	uint8_t tmp = hex - '0';
-	if (tmp > 9U)
-		tmp -= 'A' - '0' - 10U;
-	if (tmp > 16U)
-		tmp -= 'a' - 'A';
-	return tmp;
+	/* Letters (in either case) have bit 6 set, and are 9 on from the value in their low nibble */
+	const uint8_t digit = (uint8_t)hex;
+	return (digit & 0xfU) + ((digit >> 6U) & 1U) * 9U;
 }
 
 char *unhexify(void *const buf, const char *hex, const size_t size)
 {
 	uint8_t *const dst = buf;
-	for (size_t idx = 0; idx < size; ++idx, hex += 2U)
+	size_t idx = 0U;
+#ifdef HEX_UTILS_WORDWISE
+	for (; idx + 4U <= size; idx += 4U, hex += 8U) {
+		uint64_t digits;
+		memcpy(&digits, hex, sizeof(digits));
+		uint64_t value = (digits & 0x0f0f0f0f0f0f0f0fU) + ((digits >> 6U) & 0x0101010101010101U) * 9U;
+		/* Pair the nibbles back up into bytes, one per 16 bits, then pack those together */
+		value = ((value & 0x000f000f000f000fU) << 4U) | ((value >> 8U) & 0x000f000f000f000fU);
+		value = (value | (value >> 8U)) & 0x0000ffff0000ffffU;
+		value = (value | (value >> 16U)) & 0x00000000ffffffffU;
+		const uint32_t word = (uint32_t)value;
+		memcpy(dst + idx, &word, sizeof(word));
+	}
+#endif
+	for (; idx < size; ++idx, hex += 2U)
 		dst[idx] = (unhex_digit(hex[0]) << 4U) | unhex_digit(hex[1]);
 	return buf;
 }
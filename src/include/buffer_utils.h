@@ -36,6 +36,7 @@
 
 #include <stdint.h>
 #include <stddef.h>
+#include <stdbool.h>
 
 static inline void write_le2(uint8_t *const buffer, const size_t offset, const uint16_t value)
 {
@@ -70,6 +71,11 @@ static inline uint32_t read_le4(const uint8_t *const buffer, const size_t offset
 		((uint32_t)buffer[offset + 3U] << 24U);
 }
 
+static inline uint16_t read_be2(const uint8_t *const buffer, const size_t offset)
+{
+	return ((uint16_t)buffer[offset + 0U] << 8U) | buffer[offset + 1U];
+}
+
 static inline uint32_t read_be4(const uint8_t *const buffer, const size_t offset)
 {
 	return ((uint32_t)buffer[offset + 0U] << 24U) | ((uint32_t)buffer[offset + 1U] << 16U) |
@@ -84,6 +90,25 @@ static inline uint64_t read_be8(const uint8_t *const buffer, const size_t offset
 		((uint64_t)buffer[offset + 6] << 8U) | buffer[offset + 7];
 }
 
+static inline bool read_bit(const uint8_t *const buffer, const size_t bit)
+{
+	return buffer[bit >> 3U] & (1U << (bit & 7U));
+}
+
+/* Copy a run of bits between two LSb-first bit streams, starting from arbitrary bit offsets in each */
+static inline void copy_bits(
+	uint8_t *const dest, const size_t dest_offset, const uint8_t *const src, const size_t src_offset, const size_t bits)
+{
+	for (size_t bit = 0U; bit < bits; ++bit) {
+		const size_t dest_bit = dest_offset + bit;
+		const uint8_t mask = 1U << (dest_bit & 7U);
+		if (read_bit(src, src_offset + bit))
+			dest[dest_bit >> 3U] |= mask;
+		else
+			dest[dest_bit >> 3U] &= (uint8_t)~mask;
+	}
+}
+
 static inline size_t write_char(char *const buffer, const size_t buffer_size, const size_t offset, const char c)
 {
 	if (buffer && offset < buffer_size)
@@ -25,5 +25,9 @@
 #include <target.h>
 
 bool bmd_crc32(target_s *target, uint32_t *crc, uint32_t base, size_t len);
+/* Compute the same CRC as bmd_crc32() but over a buffer in probe memory */
+uint32_t bmd_crc32_buffer(const void *buffer, size_t len);
+/* Compute the same CRC as bmd_crc32_buffer() would over len bytes all of the given value */
+uint32_t bmd_crc32_fill(uint8_t value, size_t len);
 
 #endif /* INCLUDE_CRC32_H */
@@ -32,6 +32,8 @@ char gdb_if_getchar_to(uint32_t timeout);
 
 /* sending gdb_if_putchar(0, true) seems to work as keep alive */
 void gdb_if_putchar(char c, bool flush);
+/* Send a block of characters in one go, which avoids the per-character overhead of gdb_if_putchar() */
+void gdb_if_write(const void *data, size_t length, bool flush);
 void gdb_if_flush(bool force);
 
 #endif /* INCLUDE_GDB_IF_H */
@@ -25,8 +25,15 @@
 #include "gdb_packet.h"
 
 extern bool gdb_target_running;
+extern bool gdb_non_stop;
 extern target_s *cur_target;
+extern uint32_t gdb_halt_poll_max_ms;
+#if CONFIG_BMDA == 1
+/* Stay attached from one GDB connection to the next, finding and attaching the target for each that needs it */
+extern bool gdb_persist;
+#endif
 
+void gdb_halt_poll_reset(void);
 void gdb_poll_target(void);
 void gdb_main(const gdb_packet_s *packet);
 int32_t gdb_main_loop(target_controller_s *tc, const gdb_packet_s *packet, bool in_syscall);
@@ -26,13 +26,20 @@
 #include <stdbool.h>
 #include <string.h>
 
-/* Allow override in other platforms if needed */
+/*
+ * Allow override in other platforms if needed
+ * This must be done from the build system (not platform.h) so every translation unit agrees on the size.
+ * The PacketSize advertised to GDB follows this value, so larger buffers cut round trips on bulk transfers.
+ */
 #ifndef GDB_PACKET_BUFFER_SIZE
 #define GDB_PACKET_BUFFER_SIZE 1024U
 #endif
 
-/* Limit out packet string size to the maximum packet size before hexifying */
-#define GDB_OUT_PACKET_MAX_SIZE ((GDB_PACKET_BUFFER_SIZE - 1U) / 2U)
+/*
+ * Limit out packet string size to the maximum packet size before hexifying
+ * This is formatted on the stack, so it stays capped at the default size even if the packet buffer is larger
+ */
+#define GDB_OUT_PACKET_MAX_SIZE ((MIN(GDB_PACKET_BUFFER_SIZE, 1024U) - 1U) / 2U)
 
 #define GDB_PACKET_START              '$'
 #define GDB_PACKET_END                '#'
@@ -66,6 +73,8 @@ typedef struct gdb_packet {
 	char data[GDB_PACKET_BUFFER_SIZE + 1U]; /* Packet data */
 	size_t size;                            /* Packet data size */
 	bool notification;                      /* Notification packet */
+	bool run_length_encode;                 /* Compress runs of repeated characters when sending */
+	bool streamed;                          /* Send without waiting for the acknowledgement (see gdb_packet.c) */
 } gdb_packet_s;
 
 /* GDB packet transmission configuration */
@@ -74,15 +83,24 @@ bool gdb_noackmode(void);
 
 /* Raw GDB packet transmission */
 gdb_packet_s *gdb_packet_receive(void);
+/* Receive the rest of a packet whose start character has already been consumed */
+gdb_packet_s *gdb_packet_receive_started(void);
 void gdb_packet_send(const gdb_packet_s *packet);
 
 void gdb_packet_ack(bool ack);
 bool gdb_packet_get_ack(uint32_t timeout);
+/* Account for a character read outside the packet routines, in case it acknowledges a streamed packet */
+void gdb_packet_stream_ack(char character);
 
 char *gdb_packet_buffer(void);
+/* Returns how many bytes of data fit in space bytes of packet once reserved characters are escaped */
+size_t gdb_packet_escaped_fit(const char *data, size_t data_size, size_t space);
 
 /* Convenience wrappers */
 void gdb_put_packet(const char *preamble, size_t preamble_size, const char *data, size_t data_size, bool hex_data);
+/* As gdb_put_packet(), but run-length encoded on the wire for replies likely to contain long runs */
+void gdb_put_packet_compressed(
+	const char *preamble, size_t preamble_size, const char *data, size_t data_size, bool hex_data);
 
 static inline void gdb_put_packet_empty(void)
 {
@@ -102,7 +120,8 @@ static inline void gdb_put_packet_str(const char *const str)
 
 static inline void gdb_put_packet_hex(const void *const data, const size_t size)
 {
-	gdb_put_packet(NULL, 0, (const char *)data, size, true);
+	/* Memory and register dumps are often full of 0x00 and 0xff runs, so compress them */
+	gdb_put_packet_compressed(NULL, 0, (const char *)data, size, true);
 }
 
 static inline void gdb_put_packet_ok(void)
@@ -51,6 +51,13 @@ typedef struct jtag_proc {
 	void (*jtagtap_tdi_seq)(const bool final_tms, const uint8_t *data_in, size_t clock_cycles);
 	void (*jtagtap_cycle)(const bool tms, const bool tdi, const size_t clock_cycles);
 
+	/*
+	 * Optional: run a raw sequence of clock cycles in a single go from bit streams giving TMS and TDI
+	 * for each cycle, capturing TDO for every cycle into tdo if that's not NULL. Adaptors providing
+	 * this get the JTAG queue handed over in as few transfers as they can manage.
+	 */
+	void (*jtagtap_sequence)(const uint8_t *tms, const uint8_t *tdi, uint8_t *tdo, size_t clock_cycles);
+
 	/*
 	 * Some debug controllers such as the RISC-V debug controller use idle
 	 * cycles during operations as part of their function, while others
@@ -73,6 +80,22 @@ extern jtag_proc_s jtag_proc;
 /* Goto Run-test/Idle: 1, 1, 0 */
 #define jtagtap_return_idle(cycles) jtag_proc.jtagtap_tms_seq(0x01, (cycles) + 1U)
 
+/*
+ * Queued forms of the jtag_proc operations. When the adaptor provides jtagtap_sequence, these are collected
+ * up and only run on jtag_queue_flush(), deferring the filling of any data_out buffers until then.
+ * Otherwise they run immediately, so jtag_queue_flush() must always be called before using captured data.
+ */
+void jtag_queue_tms_seq(uint32_t tms_states, size_t clock_cycles);
+void jtag_queue_tdi_tdo_seq(uint8_t *data_out, bool final_tms, const uint8_t *data_in, size_t clock_cycles);
+void jtag_queue_tdi_seq(bool final_tms, const uint8_t *data_in, size_t clock_cycles);
+void jtag_queue_cycle(bool tms, bool tdi, size_t clock_cycles);
+void jtag_queue_flush(void);
+
+/* Queued forms of the state transitions above */
+#define jtag_queue_shift_ir()          jtag_queue_tms_seq(0x03U, 4U)
+#define jtag_queue_shift_dr()          jtag_queue_tms_seq(0x01U, 3U)
+#define jtag_queue_return_idle(cycles) jtag_queue_tms_seq(0x01U, (cycles) + 1U)
+
 #if CONFIG_BMDA == 1
 bool bmda_jtag_init(void);
 #endif
@@ -50,6 +50,11 @@ void platform_timeout_set(platform_timeout_s *target, uint32_t ms);
 bool platform_timeout_is_expired(const platform_timeout_s *target);
 void platform_delay(uint32_t ms);
 
+typedef struct platform_timeout_us platform_timeout_us_s;
+void platform_timeout_us_set(platform_timeout_us_s *target, uint32_t us);
+bool platform_timeout_us_is_expired(const platform_timeout_us_s *target);
+void platform_delay_us(uint32_t us);
+
 #define POWER_CONFLICT_THRESHOLD 5U /* in 0.1V, so 5 stands for 0.5V */
 
 extern bool connect_assert_nrst;
@@ -80,6 +85,11 @@ bool platform_spi_chip_select(uint8_t device_select);
 uint8_t platform_spi_xfer(spi_bus_e bus, uint8_t value);
 #endif
 
+#ifdef PLATFORM_HAS_JTAG_SPI
+/* Shift the leading 16-bit units of a JTAG scan via SPI, returning how many clock cycles were consumed */
+size_t platform_jtag_spi_shift(const uint8_t *data_in, uint8_t *data_out, size_t clock_cycles);
+#endif
+
 #ifdef PLATFORM_IDENT_DYNAMIC
 const char *platform_ident(void);
 #endif
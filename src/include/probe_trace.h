@@ -0,0 +1,82 @@
+/*
+ * This file is part of the Black Magic Debug project.
+ *
+ * Copyright (C) 2026 1BitSquared <info@1bitsquared.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef INCLUDE_PROBE_TRACE_H
+#define INCLUDE_PROBE_TRACE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+typedef enum probe_trace_op {
+	PROBE_TRACE_DP_READ,
+	PROBE_TRACE_DP_WRITE,
+	PROBE_TRACE_LOW_ACCESS, /* Raw DP/AP register access, address has the APnDP bit set for AP accesses */
+	PROBE_TRACE_AP_READ,
+	PROBE_TRACE_AP_WRITE,
+	PROBE_TRACE_MEM_READ, /* Memory accesses record the length of the access as their value */
+	PROBE_TRACE_MEM_WRITE,
+	PROBE_TRACE_JTAG_IR, /* JTAG shifts record the device index as their address */
+	PROBE_TRACE_JTAG_DR, /* DR shifts record the number of clock cycles as their value */
+	PROBE_TRACE_OP_COUNT,
+} probe_trace_op_e;
+
+#if CONFIG_BMDA == 1
+extern bool probe_trace_enabled;
+
+/* Start recording transactions, to be written out to filename by probe_trace_dump() */
+bool probe_trace_enable(const char *filename);
+/* Write out the recorded transactions to the file given to probe_trace_enable() */
+void probe_trace_dump(void);
+void probe_trace_record_access(
+	probe_trace_op_e op, uint32_t start, uint32_t addr, uint32_t value, uint8_t apsel, uint8_t ack);
+uint32_t probe_trace_timestamp(void);
+
+/* Take the start time for a transaction, or nothing if the trace is off */
+static inline uint32_t probe_trace_begin(void)
+{
+	return probe_trace_enabled ? probe_trace_timestamp() : 0U;
+}
+
+/* Record a transaction that started at start (from probe_trace_begin()) and has just completed */
+static inline void probe_trace_record(const probe_trace_op_e op, const uint32_t start, const uint32_t addr,
+	const uint32_t value, const uint8_t apsel, const uint8_t ack)
+{
+	if (probe_trace_enabled)
+		probe_trace_record_access(op, start, addr, value, apsel, ack);
+}
+#else
+/* The firmware has nowhere near the RAM needed for a useful trace ring, so tracing is BMDA only */
+static inline uint32_t probe_trace_begin(void)
+{
+	return 0U;
+}
+
+static inline void probe_trace_record(const probe_trace_op_e op, const uint32_t start, const uint32_t addr,
+	const uint32_t value, const uint8_t apsel, const uint8_t ack)
+{
+	(void)op;
+	(void)start;
+	(void)addr;
+	(void)value;
+	(void)apsel;
+	(void)ack;
+}
+#endif
+
+#endif /* INCLUDE_PROBE_TRACE_H */
@@ -0,0 +1,53 @@
+/*
+ * This file is part of the Black Magic Debug project.
+ *
+ * Copyright (C) 2026 1BitSquared <info@1bitsquared.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef INCLUDE_RTOS_H
+#define INCLUDE_RTOS_H
+
+#include "target.h"
+
+/* The Cortex-M registers recovered for a thread that isn't running: r0-r15 and xPSR */
+#define RTOS_THREAD_REG_COUNT 17U
+
+extern bool rtos_enabled;
+
+/* Kernel symbols for GDB to look up through qSymbol, by index, NULL past the last of them */
+const char *rtos_symbol_name(size_t index);
+/* Record the value GDB gave for a symbol, 0 if the program doesn't have it */
+void rtos_symbol_value(size_t index, uint32_t value);
+/* Forget the kernel symbols and everything learnt through them, ready for a new program */
+void rtos_reset(void);
+
+/* Drop the snapshot of the kernel's threads, which must be done whenever the target is resumed */
+void rtos_invalidate(void);
+/* The kernel found via the symbols, NULL if there isn't one */
+const char *rtos_name(void);
+/* The thread running on the (halted) target, 0 if there's no kernel or its scheduler isn't running yet */
+uint32_t rtos_current_thread(target_s *target);
+/* The number of threads, taking a snapshot of the kernel's thread lists if there isn't one for this halt */
+size_t rtos_thread_count(target_s *target);
+/* Thread IDs are the addresses of the kernel's thread control blocks, and so are never 0 */
+uint32_t rtos_thread_id(size_t index);
+bool rtos_thread_valid(target_s *target, uint32_t thread_id);
+/* Describe the thread for GDB's `info threads`, its name and state */
+void rtos_thread_describe(target_s *target, uint32_t thread_id, char *buffer, size_t length);
+/* Recover the registers of a thread that isn't running from the context its kernel saved on its stack */
+bool rtos_thread_regs_read(target_s *target, uint32_t thread_id, uint32_t *regs);
+
+#endif /* INCLUDE_RTOS_H */
@@ -35,6 +35,7 @@ extern char rtt_ident[16];                     // string
 extern bool rtt_enabled;                       // rtt on/off
 extern bool rtt_found;                         // control block found
 extern uint32_t rtt_cbaddr;                    // control block address
+extern uint32_t rtt_cbaddr_hint;               // control block address from GDB's symbols, 0 if unknown
 extern uint32_t rtt_num_up_chan;               // number of 'up' channels
 extern uint32_t rtt_num_down_chan;             // number of 'down' channels
 extern uint32_t rtt_min_poll_ms;               // min time between polls (ms)
@@ -47,6 +48,7 @@ extern uint32_t rtt_ram_end;                   // if rtt_flag_ram set, upper lim
 extern bool rtt_auto_channel;                  // manual or auto channel selection
 extern bool rtt_flag_skip;                     // skip if host-to-target fifo full
 extern bool rtt_flag_block;                    // block if host-to-target fifo full
+extern bool rtt_flag_coalesce;                 // read all up channels' data together
 extern bool rtt_channel_enabled[MAX_RTT_CHAN]; // true if user wants to see channel
 
 typedef struct rtt_channel {
@@ -39,6 +39,8 @@
 
 /* usb rx callback */
 void rtt_serial_receive_callback(usbd_device *dev, uint8_t ep);
+/* usb tx complete callback, false if rtt had nothing to send */
+bool rtt_serial_send_callback(usbd_device *dev, uint8_t ep);
 #endif
 
 /* default buffer sizes, 8 bytes added to up buffer for alignment and padding */
@@ -60,10 +62,21 @@ void rtt_serial_receive_callback(usbd_device *dev, uint8_t ep);
 #endif
 #endif
 
+/* firmware: size of the usb transmit ring for up channel data, by default enough for a full up buffer read */
+#ifndef RTT_SEND_BUF_SIZE
+#define RTT_SEND_BUF_SIZE (RTT_UP_BUF_SIZE - 8U)
+#endif
+
 /* hosted initialisation */
 int rtt_if_init(void);
 /* hosted teardown */
 int rtt_if_exit(void);
+/* hosted: send up channel 0 to the file at path and channel N to "<path>.N", NULL or "-" for stdout */
+bool rtt_if_set_output(const char *path);
+#if CONFIG_BMDA == 1 && !defined(_WIN32)
+/* hosted: serve each channel N on its own TCP port, port + N, instead of on the terminal */
+void rtt_if_set_port(uint16_t port);
+#endif
 
 /* target to host: write len bytes from the buffer on the channel starting at buf. return number bytes written */
 uint32_t rtt_write(const uint32_t channel, const char *buf, uint32_t len);
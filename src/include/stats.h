@@ -0,0 +1,55 @@
+/*
+ * This file is part of the Black Magic Debug project.
+ *
+ * Copyright (C) 2026 1BitSquared <info@1bitsquared.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef INCLUDE_STATS_H
+#define INCLUDE_STATS_H
+
+#include <stdint.h>
+
+typedef enum stats_id {
+	STATS_GDB_RX,              /* GDB packets received */
+	STATS_GDB_TX,              /* GDB packets sent, timed until acknowledged */
+	STATS_SWD_ACCESS,          /* Raw SWD transactions, timed */
+	STATS_SWD_WAIT,            /* WAIT acknowledgements, each one causing a retry */
+	STATS_SWD_FAULT,           /* FAULT acknowledgements */
+	STATS_SWD_NO_RESPONSE,     /* Transactions that got no acknowledgement at all */
+	STATS_MEM_READ,            /* target_mem32_read() calls, timed */
+	STATS_MEM_READ_BYTES,      /* Bytes asked for by those calls */
+	STATS_FLASH_PREPARE,       /* Flash driver callbacks, each timed */
+	STATS_FLASH_ERASE,
+	STATS_FLASH_WRITE,
+	STATS_FLASH_DONE,
+	STATS_FLASH_WAIT,          /* Waits for erases and writes left running by the driver, timed */
+	STATS_FLASH_HOST,          /* Gaps between Flash API calls in an operation, timed */
+	STATS_FLASH_BYTES_WRITTEN, /* Bytes programmed */
+	STATS_FLASH_BYTES_SKIPPED, /* Bytes not programmed as the Flash already held them */
+	STATS_RTT_POLL,            /* RTT polls that did any work, timed */
+	STATS_COUNT,
+} stats_id_e;
+
+/* Current value of the time base used for the timed counters (see stats_dump() for its unit) */
+uint32_t stats_timestamp(void);
+/* Count amount events against a counter */
+void stats_event(stats_id_e id, uint32_t amount);
+/* Count one event against a counter, accumulating the time since start (from stats_timestamp()) */
+void stats_record(stats_id_e id, uint32_t start);
+void stats_reset(void);
+void stats_dump(void);
+
+#endif /* INCLUDE_STATS_H */
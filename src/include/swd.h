@@ -40,5 +40,7 @@ typedef struct swd_proc {
 extern swd_proc_s swd_proc;
 
 void swdptap_init(void);
+/* Re-pick the bitbanged SWD routines to suit the current clock divider, called whenever it changes */
+void swdptap_speed_update(void);
 
 #endif /*INCLUDE_SWD_H*/
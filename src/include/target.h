@@ -42,9 +42,17 @@ typedef uint64_t target_addr64_t;
 typedef target_addr32_t target_addr_t;
 typedef struct target_controller target_controller_s;
 
+/* A range of memory to erase - lists of these must be sorted by address */
+typedef struct target_flash_range {
+	target_addr_t addr;
+	size_t length;
+} target_flash_range_s;
+
 #if CONFIG_BMDA == 1
 bool bmda_swd_scan(uint32_t targetid);
 bool bmda_jtag_scan(void);
+/* Scan the way the command line asks if there are no targets yet, returning the number of the one to use or 0 */
+size_t bmda_persist_target(void);
 #endif
 bool adiv5_swd_scan(uint32_t targetid);
 bool jtag_scan(void);
@@ -58,27 +66,60 @@ target_s *target_new(void);
 target_s *target_attach(target_s *target, target_controller_s *controller);
 target_s *target_attach_n(size_t n, target_controller_s *controller);
 void target_detach(target_s *target);
+/* Whether two targets are cores of the same multi-core device */
+bool target_same_device(target_s *target, target_s *other);
 
 /* Memory access functions */
 bool target_mem_map(target_s *target, char *buf, size_t len);
+/* Cached XML documents for GDB, returning NULL if one can't be generated - target_xml_release() drops them */
+const char *target_mem_map_xml(target_s *target, size_t *length);
+/*
+ * Copy up to length bytes of the XML register description from offset on into buffer, returning how many
+ * that was and setting *total to the length of the whole document (0 if the target doesn't have one)
+ */
+size_t target_description_read(target_s *target, char *buffer, size_t offset, size_t length, size_t *total);
+void target_xml_release(target_s *target);
 bool target_mem32_read(target_s *target, void *dest, target_addr_t src, size_t len);
 bool target_mem64_read(target_s *target, void *dest, target_addr64_t src, size_t len);
 bool target_mem32_write(target_s *target, target_addr_t dest, const void *src, size_t len);
 bool target_mem64_write(target_s *target, target_addr64_t dest, const void *src, size_t len);
+/* Fill a region with a repeated 32-bit value, its byte lanes following the address as for word writes */
+bool target_mem32_fill(target_s *target, target_addr_t dest, uint32_t value, size_t len);
 bool target_mem_access_needs_halt(target_s *target);
+extern uint32_t target_mem_cache_size; /* Bytes of RAM/Flash reads to cache while halted, 0 disables it */
 /* Flash memory access functions */
+extern bool flash_differential; /* Skip erasing/programming blocks that already contain the data being written */
+extern bool flash_blank_check;  /* Skip erasing blocks that are already blank */
+/* Keep GDB's loads in one Flash session, left only when the target is resumed, reset or detached from */
+extern bool flash_session_persist;
 bool target_flash_erase(target_s *target, target_addr_t addr, size_t len);
+bool target_flash_erase_ranges(target_s *target, const target_flash_range_s *ranges, size_t count);
+/* As above, but erasing each block just ahead of the first data written to it, finished by target_flash_complete() */
+bool target_flash_erase_on_write(target_s *target, const target_flash_range_s *ranges, size_t count);
 bool target_flash_write(target_s *target, target_addr_t dest, const void *src, size_t len);
 bool target_flash_complete(target_s *target);
+/* Describe where the time in the last completed Flash operation went, returning false if there hasn't been one */
+bool target_flash_report(char *buffer, size_t size);
 bool target_flash_mass_erase(target_s *target);
+/*
+ * Hold the target in Flash mode from the first Flash operation until target_flash_session_end(), rather than
+ * entering and leaving it around each one, so a run of erases and writes pays for that (and any reset) only once
+ */
+void target_flash_session_begin(target_s *target);
+bool target_flash_session_end(target_s *target);
 
 /* Register access functions */
 size_t target_regs_size(target_s *target);
-const char *target_regs_description(target_s *target);
 void target_regs_read(target_s *target, void *data);
+/*
+ * Read the leading registers that are worth reading all at once, returning how many bytes of them there are.
+ * The rest are left to be read one at a time with target_reg_read() as they're needed
+ */
+size_t target_regs_read_core(target_s *target, void *data);
 void target_regs_write(target_s *target, const void *data);
 size_t target_reg_read(target_s *target, uint32_t reg, void *data, size_t max);
 size_t target_reg_write(target_s *target, uint32_t reg, const void *data, size_t size);
+bool target_pc_read(target_s *target, target_addr_t *pc);
 
 /* Halt/resume functions */
 typedef enum target_halt_reason {
@@ -34,7 +34,14 @@ struct platform_timeout {
 	uint32_t time;
 };
 
+struct platform_timeout_us {
+	uint32_t start;
+	uint32_t duration;
+};
+
 extern uint32_t target_clk_divider;
 uint32_t platform_time_ms(void);
+/* Free-running microsecond counter, wrapping every ~71 minutes - only differences between readings are meaningful */
+uint32_t platform_time_us(void);
 
 #endif /* INCLUDE_TIMING_H */
@@ -29,6 +29,7 @@
 #include "gdb_packet.h"
 #include "morse.h"
 #include "command.h"
+#include "live_watch.h"
 #ifdef ENABLE_RTT
 #include "rtt.h"
 #endif
@@ -44,13 +45,19 @@ static void bmp_poll_loop(void)
 		if (!gdb_target_running || !cur_target)
 			break;
 		char c = gdb_if_getchar_to(0);
-		if (c == '\x03' || c == '\x04')
+		gdb_packet_stream_ack(c);
+		if (c == '\x03' || c == '\x04') {
 			target_halt_request(cur_target);
+			gdb_halt_poll_reset();
+		} else if (c == '$' && gdb_non_stop)
+			/* In non-stop mode GDB carries on sending packets while the target runs, so service them */
+			gdb_main(gdb_packet_receive_started());
 		platform_pace_poll();
 #ifdef ENABLE_RTT
 		if (rtt_enabled)
 			poll_rtt(cur_target);
 #endif
+		live_watch_poll(cur_target);
 	}
 
 	SET_IDLE_STATE(true);
@@ -314,6 +314,28 @@ extern bool debug_bmp;
 #define SWO_TRIG_IN         PINOUT_SWITCH(TIM_SMCR_TS_TI2FP2, TIM_SMCR_TS_TI1FP1, TIM_SMCR_TS_TI2FP2)
 #define SWO_TIM_PIN_AF      PINOUT_SWITCH(GPIO_AF2, GPIO_AF2, GPIO_AF1)
 
+/*
+ * Capture the Manchester cycle timings via the rising edge channel's DMA request - TIM4_CH2 is on DMA1 Stream 3
+ * and TIM4_CH1 on DMA1 Stream 0, both channel 2. TIM2_CH2 shares DMA1 Stream 6 with USART2_TX, so the third
+ * pinout decodes from the capture interrupt instead.
+ */
+#if ALTERNATIVE_PINOUT < 2
+#define SWO_TIM_DMA_BUS DMA1
+#define SWO_TIM_DMA_CLK RCC_DMA1
+#define SWO_TIM_DMA_TRG DMA_SxCR_CHSEL_2
+#if ALTERNATIVE_PINOUT == 0
+#define SWO_TIM_DMA_CHAN   DMA_STREAM3
+#define SWO_TIM_DMA_REQ    TIM_DIER_CC2DE
+#define SWO_TIM_DMA_IRQ    NVIC_DMA1_STREAM3_IRQ
+#define SWO_TIM_DMA_ISR(x) dma1_stream3_isr(x)
+#else
+#define SWO_TIM_DMA_CHAN   DMA_STREAM0
+#define SWO_TIM_DMA_REQ    TIM_DIER_CC1DE
+#define SWO_TIM_DMA_IRQ    NVIC_DMA1_STREAM0_IRQ
+#define SWO_TIM_DMA_ISR(x) dma1_stream0_isr(x)
+#endif
+#endif
+
 /* On F411 use USART1_RX mapped on PB7/PB6/PB3 for async capture */
 #define SWO_UART        USBUSART1
 #define SWO_UART_CLK    USBUSART1_CLK
@@ -254,8 +254,15 @@ static void jtagtap_tdi_tdo_seq(
 	gpio_clear(TDI_PORT, TDI_PIN);
 	if (target_clk_divider != UINT32_MAX)
 		jtagtap_tdi_tdo_seq_clk_delay(data_in, data_out, final_tms, clock_cycles);
-	else
+	else {
+#ifdef PLATFORM_HAS_JTAG_SPI
+		/* Run the bulk of the scan through the SPI engine, the GPIO path then finishes it off including final_tms */
+		const size_t offset = platform_jtag_spi_shift(data_in, data_out, clock_cycles) >> 3U;
+		jtagtap_tdi_tdo_seq_no_delay(data_in + offset, data_out + offset, final_tms, clock_cycles - (offset << 3U));
+#else
 		jtagtap_tdi_tdo_seq_no_delay(data_in, data_out, final_tms, clock_cycles);
+#endif
+	}
 }
 
 static void jtagtap_tdi_seq_clk_delay(const uint8_t *const data_in, const bool final_tms, size_t clock_cycles)
@@ -313,8 +320,14 @@ static void jtagtap_tdi_seq(const bool final_tms, const uint8_t *const data_in,
 	gpio_clear(TMS_PORT, TMS_PIN);
 	if (target_clk_divider != UINT32_MAX)
 		jtagtap_tdi_seq_clk_delay(data_in, final_tms, clock_cycles);
-	else
+	else {
+#ifdef PLATFORM_HAS_JTAG_SPI
+		const size_t offset = platform_jtag_spi_shift(data_in, NULL, clock_cycles) >> 3U;
+		jtagtap_tdi_seq_no_delay(data_in + offset, final_tms, clock_cycles - (offset << 3U));
+#else
 		jtagtap_tdi_seq_no_delay(data_in, final_tms, clock_cycles);
+#endif
+	}
 }
 
 static void jtagtap_cycle_clk_delay(const size_t clock_cycles)
@@ -71,9 +71,9 @@ uint32_t dfu_poll_timeout(uint8_t cmd, uint32_t addr, uint16_t blocknum)
 	 * Programming times:
 	 * STM32F103CB: 40 us (min), 52.5 us (typ), 70 us (max) -- for 16-bit half-word
 	 *  GD32F103CB: 37.5 us (typ), 105 us (max) -- for 32-bit word
-	 * 52.5 us * 512 half-words, or 105 us * 256 words, gives 26.88 ms estimate (typ)
+	 * 52.5 us per half-word, or 105 us per word, gives 26.88 ms (typ) for each KiB of a block
 	 */
-	return 27U;
+	return ((DFU_TRANSFER_SIZE / 2U) * 525U + 9999U) / 10000U;
 }
 
 void dfu_protect(bool enable)
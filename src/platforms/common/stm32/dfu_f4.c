@@ -140,8 +140,8 @@ uint32_t dfu_poll_timeout(uint8_t cmd, uint32_t addr, uint16_t blocknum)
 			return sector_erase_time[sector_num];
 	}
 
-	/* Programming 256 words (32-bit) with 16 us(typ), 100 us(max) per word */
-	return 16U * 1024U / 4U / 1000U;
+	/* Programming a block's worth of words (32-bit) with 16 us(typ), 100 us(max) per word, rounded up */
+	return ((16U * (DFU_TRANSFER_SIZE / 4U)) + 999U) / 1000U;
 }
 
 void dfu_protect(bool enable)
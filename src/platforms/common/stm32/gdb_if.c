@@ -34,11 +34,18 @@
 static uint32_t count_out;
 static uint32_t count_in;
 static uint32_t out_ptr;
-static char buffer_out[CDCACM_PACKET_SIZE];
 static char buffer_in[CDCACM_PACKET_SIZE];
 #if defined(STM32F4) || defined(STM32F7)
 static volatile uint32_t count_new;
-static char double_buffer_out[CDCACM_PACKET_SIZE];
+/*
+ * Inbound packets ping-pong between these two buffers - the OUT callback fills the one
+ * not being consumed and gdb_if_update_buf() just swaps them over, so nothing gets copied
+ */
+static char double_buffer_out[2][CDCACM_PACKET_SIZE];
+static char *buffer_out = double_buffer_out[0];
+static char *buffer_out_next = double_buffer_out[1];
+#else
+static char buffer_out[CDCACM_PACKET_SIZE];
 #endif
 
 void gdb_if_putchar(const char c, const bool flush)
@@ -48,6 +55,22 @@ void gdb_if_putchar(const char c, const bool flush)
 		gdb_if_flush(flush);
 }
 
+void gdb_if_write(const void *const data, const size_t length, const bool flush)
+{
+	const char *const buffer = (const char *)data;
+	for (size_t offset = 0U; offset < length;) {
+		/* Copy as much as fits in the packet being built, sending it on if that fills it */
+		const size_t amount = MIN(length - offset, CDCACM_PACKET_SIZE - count_in);
+		memcpy(buffer_in + count_in, buffer + offset, amount);
+		count_in += amount;
+		offset += amount;
+		if (count_in == CDCACM_PACKET_SIZE)
+			gdb_if_flush(flush && offset == length);
+	}
+	if (flush)
+		gdb_if_flush(true);
+}
+
 void gdb_if_flush(const bool force)
 {
 	/* Flush only if there is data to flush */
@@ -81,7 +104,7 @@ void gdb_usb_out_cb(usbd_device *dev, uint8_t ep)
 {
 	(void)ep;
 	usbd_ep_nak_set(dev, CDCACM_GDB_ENDPOINT, 1);
-	count_new = usbd_ep_read_packet(dev, CDCACM_GDB_ENDPOINT, double_buffer_out, CDCACM_PACKET_SIZE);
+	count_new = usbd_ep_read_packet(dev, CDCACM_GDB_ENDPOINT, buffer_out_next, CDCACM_PACKET_SIZE);
 	if (!count_new)
 		usbd_ep_nak_set(dev, CDCACM_GDB_ENDPOINT, 0);
 }
@@ -100,7 +123,10 @@ static void gdb_if_update_buf(void)
 	/* count_new will become 0 by the time of decision to WFI, so save a copy at entry */
 	const uint32_t count_new_saved = count_new;
 	if (count_new) {
-		memcpy(buffer_out, double_buffer_out, count_new);
+		/* The previous buffer has been fully consumed, so hand it back to the OUT callback */
+		char *const buffer = buffer_out_next;
+		buffer_out_next = buffer_out;
+		buffer_out = buffer;
 		count_out = count_new;
 		count_new = 0;
 		out_ptr = 0;
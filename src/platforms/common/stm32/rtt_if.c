@@ -31,6 +31,8 @@
 #include "rtt.h"
 #include "rtt_if.h"
 
+#include <libopencm3/cm3/nvic.h>
+
 /*********************************************************************
 *
 *       rtt terminal i/o
@@ -119,24 +121,80 @@ bool rtt_nodata(const uint32_t channel)
 	return recv_head == recv_tail;
 }
 
+/*
+ * usb uart transmit ring. Data read from the target goes in here and is sent on from the endpoint's
+ * completion interrupt a packet at a time, so the next target read overlaps the USB transfer of the
+ * last one rather than the poll loop waiting on the endpoint. The head is only moved by rtt_write()
+ * and the tail only by rtt_serial_send(), which runs in, or with, the USB interrupt masked.
+ */
+static char send_buf[RTT_SEND_BUF_SIZE];
+static volatile uint32_t send_head = 0;
+static volatile uint32_t send_tail = 0;
+/* true while one of our packets is in the endpoint */
+static volatile bool send_busy = false;
+/* true if the last packet was a full one, so the transfer must be ended with a zero length packet */
+static bool send_zlp = false;
+
+/* rtt target to host: start the next packet from the ring, returning false if there was nothing to send */
+static bool rtt_serial_send(void)
+{
+	if (send_head == send_tail) {
+		if (!send_zlp)
+			return false;
+		send_zlp = false;
+		/* a zero length write can't report the endpoint being busy, so assume it went */
+		usbd_ep_write_packet(usbdev, CDCACM_UART_ENDPOINT, NULL, 0);
+		return true;
+	}
+	const uint32_t end = send_head > send_tail ? send_head : RTT_SEND_BUF_SIZE;
+	const uint16_t len = MIN(end - send_tail, CDCACM_PACKET_SIZE);
+	const uint16_t written = usbd_ep_write_packet(usbdev, CDCACM_UART_ENDPOINT, send_buf + send_tail, len);
+	/* The endpoint may still be busy with aux serial data, in which case its completion comes back here */
+	if (!written)
+		return false;
+	send_tail = (send_tail + written) % RTT_SEND_BUF_SIZE;
+	send_zlp = written == CDCACM_PACKET_SIZE;
+	return true;
+}
+
+/* called from the uart endpoint's IN completion when rtt is enabled, false if the endpoint is free for aux serial */
+bool rtt_serial_send_callback(usbd_device *dev, uint8_t ep)
+{
+	(void)dev;
+	(void)ep;
+	send_busy = rtt_serial_send();
+	return send_busy;
+}
+
 /* rtt target to host: write string */
 uint32_t rtt_write(const uint32_t channel, const char *buf, uint32_t len)
 {
 	/* only support writing to up channel 0 */
 	if (channel != 0U)
 		return len;
-	if (len != 0 && usbdev && usb_get_config() && gdb_serial_get_dtr()) {
-		for (uint32_t p = 0; p < len; p += CDCACM_PACKET_SIZE) {
-			uint32_t plen = MIN(CDCACM_PACKET_SIZE, len - p);
-			uint32_t start_ms = platform_time_ms();
-			while (usbd_ep_write_packet(usbdev, CDCACM_UART_ENDPOINT, buf + p, plen) <= 0) {
-				if (platform_time_ms() - start_ms >= 25)
-					return 0; /* drop silently */
-			}
-		}
-		/* flush 64-byte packet on full-speed */
-		if (CDCACM_PACKET_SIZE == 64 && (len % CDCACM_PACKET_SIZE) == 0)
-			usbd_ep_write_packet(usbdev, CDCACM_UART_ENDPOINT, NULL, 0);
+	if (len == 0 || !usbdev || !usb_get_config() || !gdb_serial_get_dtr())
+		return len;
+
+	const uint32_t start_ms = platform_time_ms();
+	for (uint32_t offset = 0; offset < len;) {
+		/* copy as much as fits contiguously, up to the end of the ring or the free slot before the tail */
+		const uint32_t head = send_head;
+		const uint32_t tail = send_tail;
+		const uint32_t limit = tail > head ? tail - 1U : RTT_SEND_BUF_SIZE - (tail ? 0U : 1U);
+		const uint32_t amount = MIN(len - offset, limit - head);
+		memcpy(send_buf + head, buf + offset, amount);
+		send_head = (head + amount) % RTT_SEND_BUF_SIZE;
+		offset += amount;
+
+		/* get the data moving if the endpoint is idle */
+		nvic_disable_irq(USB_IRQ);
+		if (!send_busy)
+			send_busy = rtt_serial_send();
+		nvic_enable_irq(USB_IRQ);
+
+		/* the ring is full, wait for the host to take some, but not forever */
+		if (!amount && platform_time_ms() - start_ms >= 25U)
+			return offset; /* drop silently */
 	}
 	return len;
 }
@@ -0,0 +1,176 @@
+/*
+ * This file is part of the Black Magic Debug project.
+ *
+ * Copyright (C) 2026 1BitSquared <info@1bitsquared.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * This file implements a timer and DMA driven engine for the bulk SW-DP bit sequences used at the top SWD speed.
+ *
+ * Each half SWCLK period, a TIM1 compare event has DMA2 write the next precomputed pin state into the SWD port's
+ * BSRR, and a second compare event part way through the period has DMA2 sample the SWDIO port's IDR. This lets
+ * whole 32-bit words be shifted at a fixed rate set by the timer, rather than by how fast the CPU can toggle the
+ * pins. Turnaround and parity bits are still handled by the CPU in swdptap.c.
+ *
+ * The DMA request mapping used is from RM0090 and RM0383 (DMA2 request mapping tables), with TIM1_CH1 being
+ * stream 1 channel 6 and TIM1_CH2 being stream 2 channel 6. Only DMA2 can reach the GPIO ports on the STM32F4.
+ */
+
+#include "general.h"
+#include "platform.h"
+#include "swdptap_dma.h"
+
+#include <libopencm3/stm32/rcc.h>
+#include <libopencm3/stm32/gpio.h>
+#include <libopencm3/stm32/timer.h>
+#include <libopencm3/stm32/dma.h>
+
+#if !defined(SWDIO_IN_PORT)
+#define SWDIO_IN_PORT SWDIO_PORT
+#endif
+#if !defined(SWDIO_IN_PIN)
+#define SWDIO_IN_PIN SWDIO_PIN
+#endif
+
+#define SWD_DMA_TIM        TIM1
+#define SWD_DMA_TIM_CLK    RCC_TIM1
+#define SWD_DMA_BUS        DMA2
+#define SWD_DMA_CLK        RCC_DMA2
+#define SWD_DMA_IN_STREAM  DMA_STREAM1
+#define SWD_DMA_OUT_STREAM DMA_STREAM2
+#define SWD_DMA_TRG        DMA_SxCR_CHSEL_6
+
+/* How many timer ticks make up half an SWCLK period, platforms may pick a value to suit their clocks */
+#ifndef SWD_DMA_HALF_PERIOD
+#define SWD_DMA_HALF_PERIOD 8U
+#endif
+
+/* Pin states are written 1 tick into each half period, and SWDIO is sampled half way through it */
+#define SWD_DMA_OUT_TICK 1U
+#define SWD_DMA_IN_TICK  (SWD_DMA_HALF_PERIOD / 2U)
+
+#define SWD_DMA_CLK_LOW    ((uint32_t)SWCLK_PIN << 16U)
+#define SWD_DMA_CLK_HIGH   ((uint32_t)SWCLK_PIN)
+#define SWD_DMA_SWDIO_LOW  ((uint32_t)SWDIO_PIN << 16U)
+#define SWD_DMA_SWDIO_HIGH ((uint32_t)SWDIO_PIN)
+
+/* The DMA engine writes both SWCLK and SWDIO in one BSRR access, so they must be on the same port */
+_Static_assert(SWCLK_PORT == SWDIO_PORT, "SWD DMA engine requires SWCLK and SWDIO to share a GPIO port");
+_Static_assert(SWD_DMA_HALF_PERIOD >= 4U, "SWD DMA half period too short to order the pin writes and samples");
+
+/* Two pin states per clock cycle, plus the final falling edge */
+static uint32_t swd_dma_pin_states[(32U * 2U) + 1U];
+/* One SWDIO sample per half clock cycle, of which the ones taken while SWCLK is low get used */
+static uint32_t swd_dma_samples[32U * 2U];
+
+static void swdptap_dma_stream_setup(const uint8_t stream, const uint32_t direction, const uint32_t peripheral)
+{
+	dma_stream_reset(SWD_DMA_BUS, stream);
+	// NOLINTNEXTLINE(clang-diagnostic-pointer-to-int-cast,performance-no-int-to-ptr)
+	dma_set_peripheral_address(SWD_DMA_BUS, stream, peripheral);
+	dma_set_transfer_mode(SWD_DMA_BUS, stream, direction);
+	dma_channel_select(SWD_DMA_BUS, stream, SWD_DMA_TRG);
+	dma_enable_direct_mode(SWD_DMA_BUS, stream);
+	dma_enable_memory_increment_mode(SWD_DMA_BUS, stream);
+	dma_set_peripheral_size(SWD_DMA_BUS, stream, DMA_SxCR_PSIZE_32BIT);
+	dma_set_memory_size(SWD_DMA_BUS, stream, DMA_SxCR_MSIZE_32BIT);
+	dma_set_priority(SWD_DMA_BUS, stream, DMA_SxCR_PL_VERY_HIGH);
+}
+
+void swdptap_dma_init(void)
+{
+	rcc_periph_clock_enable(SWD_DMA_CLK);
+	rcc_periph_clock_enable(SWD_DMA_TIM_CLK);
+
+	/* Run the timer at the full timer clock, wrapping every half SWCLK period */
+	timer_set_prescaler(SWD_DMA_TIM, 0U);
+	timer_set_period(SWD_DMA_TIM, SWD_DMA_HALF_PERIOD - 1U);
+	timer_set_oc_value(SWD_DMA_TIM, TIM_OC1, SWD_DMA_IN_TICK);
+	timer_set_oc_value(SWD_DMA_TIM, TIM_OC2, SWD_DMA_OUT_TICK);
+
+	swdptap_dma_stream_setup(SWD_DMA_IN_STREAM, DMA_SxCR_DIR_PERIPHERAL_TO_MEM, (uintptr_t)&GPIO_IDR(SWDIO_IN_PORT));
+	swdptap_dma_stream_setup(SWD_DMA_OUT_STREAM, DMA_SxCR_DIR_MEM_TO_PERIPHERAL, (uintptr_t)&GPIO_BSRR(SWCLK_PORT));
+	// NOLINTNEXTLINE(clang-diagnostic-pointer-to-int-cast)
+	dma_set_memory_address(SWD_DMA_BUS, SWD_DMA_IN_STREAM, (uintptr_t)swd_dma_samples);
+	// NOLINTNEXTLINE(clang-diagnostic-pointer-to-int-cast)
+	dma_set_memory_address(SWD_DMA_BUS, SWD_DMA_OUT_STREAM, (uintptr_t)swd_dma_pin_states);
+}
+
+/* Play out the first `states` pin states, sampling SWDIO for the first `samples` half periods */
+static void swdptap_dma_run(const size_t states, const size_t samples)
+{
+	/* Make sure nothing is left pending from the previous run before arming the streams */
+	timer_disable_irq(SWD_DMA_TIM, TIM_DIER_CC1DE | TIM_DIER_CC2DE);
+	timer_set_counter(SWD_DMA_TIM, 0U);
+	timer_clear_flag(SWD_DMA_TIM, TIM_SR_CC1IF | TIM_SR_CC2IF | TIM_SR_UIF);
+	dma_clear_interrupt_flags(SWD_DMA_BUS, SWD_DMA_OUT_STREAM, DMA_TCIF | DMA_TEIF | DMA_FEIF);
+	dma_clear_interrupt_flags(SWD_DMA_BUS, SWD_DMA_IN_STREAM, DMA_TCIF | DMA_TEIF | DMA_FEIF);
+
+	dma_set_number_of_data(SWD_DMA_BUS, SWD_DMA_OUT_STREAM, states);
+	dma_enable_stream(SWD_DMA_BUS, SWD_DMA_OUT_STREAM);
+	uint32_t dma_requests = TIM_DIER_CC2DE;
+	if (samples) {
+		dma_set_number_of_data(SWD_DMA_BUS, SWD_DMA_IN_STREAM, samples);
+		dma_enable_stream(SWD_DMA_BUS, SWD_DMA_IN_STREAM);
+		dma_requests |= TIM_DIER_CC1DE;
+	}
+
+	/* Start the sequence and wait for the last pin state to be written out */
+	timer_enable_irq(SWD_DMA_TIM, dma_requests);
+	timer_enable_counter(SWD_DMA_TIM);
+	while (!dma_get_interrupt_flag(SWD_DMA_BUS, SWD_DMA_OUT_STREAM, DMA_TCIF))
+		continue;
+	timer_disable_counter(SWD_DMA_TIM);
+	/* The final sample is taken before the final pin state is written, so the input stream is done by now too */
+	dma_disable_stream(SWD_DMA_BUS, SWD_DMA_OUT_STREAM);
+	if (samples)
+		dma_disable_stream(SWD_DMA_BUS, SWD_DMA_IN_STREAM);
+}
+
+uint32_t swdptap_dma_seq_in(const size_t clock_cycles)
+{
+	if (!clock_cycles)
+		return 0U;
+	/* Clock out the cycles with SWDIO left alone as the target is driving it */
+	for (size_t cycle = 0U; cycle < clock_cycles; ++cycle) {
+		swd_dma_pin_states[cycle * 2U] = SWD_DMA_CLK_LOW;
+		swd_dma_pin_states[(cycle * 2U) + 1U] = SWD_DMA_CLK_HIGH;
+	}
+	swd_dma_pin_states[clock_cycles * 2U] = SWD_DMA_CLK_LOW;
+	swdptap_dma_run((clock_cycles * 2U) + 1U, clock_cycles * 2U);
+
+	/* Pick out the samples taken just before each rising edge */
+	uint32_t value = 0U;
+	for (size_t cycle = 0U; cycle < clock_cycles; ++cycle) {
+		if (swd_dma_samples[cycle * 2U] & SWDIO_IN_PIN)
+			value |= 1U << cycle;
+	}
+	return value;
+}
+
+void swdptap_dma_seq_out(const uint32_t tms_states, const size_t clock_cycles)
+{
+	if (!clock_cycles)
+		return;
+	/* Drive each bit after the falling edge, then raise SWCLK to have the target sample it */
+	for (size_t cycle = 0U; cycle < clock_cycles; ++cycle) {
+		const bool bit = tms_states & (1U << cycle);
+		swd_dma_pin_states[cycle * 2U] = SWD_DMA_CLK_LOW | (bit ? SWD_DMA_SWDIO_HIGH : SWD_DMA_SWDIO_LOW);
+		swd_dma_pin_states[(cycle * 2U) + 1U] = SWD_DMA_CLK_HIGH;
+	}
+	swd_dma_pin_states[clock_cycles * 2U] = SWD_DMA_CLK_LOW;
+	swdptap_dma_run((clock_cycles * 2U) + 1U, 0U);
+}
@@ -0,0 +1,30 @@
+/*
+ * This file is part of the Black Magic Debug project.
+ *
+ * Copyright (C) 2026 1BitSquared <info@1bitsquared.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef PLATFORMS_COMMON_STM32_SWDPTAP_DMA_H
+#define PLATFORMS_COMMON_STM32_SWDPTAP_DMA_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+void swdptap_dma_init(void);
+uint32_t swdptap_dma_seq_in(size_t clock_cycles);
+void swdptap_dma_seq_out(uint32_t tms_states, size_t clock_cycles);
+
+#endif /* PLATFORMS_COMMON_STM32_SWDPTAP_DMA_H */
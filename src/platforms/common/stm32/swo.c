@@ -24,6 +24,7 @@
 #include "swo.h"
 #include "swo_internal.h"
 
+#include <assert.h>
 #include <stdatomic.h>
 #include <malloc.h>
 #include <libopencmsis/core_cm3.h>
@@ -60,6 +61,23 @@ uint16_t swo_buffer_read_index = 0U;
 uint16_t swo_buffer_write_index = 0U;
 _Atomic uint16_t swo_buffer_bytes_available = 0U;
 
+swo_stats_s swo_stats;
+
+static_assert((SWO_BUFFER_SIZE & (SWO_BUFFER_SIZE - 1U)) == 0U, "SWO buffer size must be a power of two");
+static_assert(SWO_BUFFER_SIZE >= 2U * SWO_ENDPOINT_SIZE, "SWO buffer must hold at least 2 endpoint buffers");
+/* The indicies and fill level are 16-bit, and the fill level has to be able to count a completely full buffer */
+static_assert(SWO_BUFFER_SIZE <= 32768U, "SWO buffer size must be no more than 32KiB");
+
+void swo_buffer_note_captured(const uint16_t captured, const uint16_t dropped)
+{
+	swo_stats.bytes_captured += captured;
+	if (dropped) {
+		swo_stats.bytes_dropped += dropped;
+		++swo_stats.overflows;
+	}
+	swo_stats.fill_max = MAX(swo_stats.fill_max, (uint32_t)swo_buffer_bytes_available);
+}
+
 void swo_init(const swo_coding_e swo_mode, const uint32_t baudrate, const uint32_t itm_stream_bitmask)
 {
 #if SWO_ENCODING == 1
@@ -83,6 +101,10 @@ void swo_init(const swo_coding_e swo_mode, const uint32_t baudrate, const uint32
 		}
 	}
 
+	/* Start the counters afresh for this capture */
+	memset(&swo_stats, 0, sizeof(swo_stats));
+	swo_stats.buffer_size = SWO_BUFFER_SIZE;
+
 	/* Configure the ITM decoder and state */
 	swo_itm_decode_set_mask(itm_stream_bitmask);
 	swo_itm_decoding = itm_stream_bitmask != 0;
@@ -156,8 +178,12 @@ void swo_send_buffer(usbd_device *const dev, const uint8_t ep)
 			result = usbd_ep_write_packet(
 				dev, ep, swo_buffer + swo_buffer_read_index, MIN(bytes_available, SWO_ENDPOINT_SIZE));
 
+		/* The endpoint is still holding the last packet, so the host isn't keeping up */
+		if (!result && !swo_itm_decoding)
+			++swo_stats.endpoint_busy;
 		/* If we actually queued/processed some data, update indicies etc */
 		if (result) {
+			swo_stats.bytes_sent += result;
 			/*
 			 * Update the amount read and consumed */
 			swo_buffer_read_index += result;
@@ -24,10 +24,12 @@
 #include "usb.h"
 
 /*
- * Total buffer size for the dynamic buffer
+ * Total buffer size for the dynamic buffer, which may be overridden from the build system (swo_buffer_size)
  * NB: This *must* result in a value that is a power of two.
  */
+#ifndef SWO_BUFFER_SIZE
 #define SWO_BUFFER_SIZE (NUM_SWO_USB_PACKETS * SWO_ENDPOINT_SIZE)
+#endif
 
 /* Control variables shared between decoders */
 extern bool swo_itm_decoding;
@@ -38,6 +40,9 @@ extern uint16_t swo_buffer_read_index;
 extern uint16_t swo_buffer_write_index;
 extern _Atomic uint16_t swo_buffer_bytes_available;
 
+/* Account for newly captured data, and for the data (new or already buffered) dropped for lack of buffer space */
+void swo_buffer_note_captured(uint16_t captured, uint16_t dropped);
+
 /* Manchester-mode implementation functions */
 void swo_manchester_init(void);
 void swo_manchester_deinit(void);
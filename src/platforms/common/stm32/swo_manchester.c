@@ -38,6 +38,12 @@
  *
  * We use the first capture channel of a pair to capture the cycle time and
  * thee second to capture the high time (mark period).
+ *
+ * On platforms that have a DMA request free for the rising edge capture channel (they define SWO_TIM_DMA_BUS),
+ * the interrupt per cycle is replaced by a DMA burst that copies both capture registers into a ring of cycle
+ * timings. The ring is decoded a block at a time from the DMA half and full transfer interrupts, and when the
+ * timer overflows for lack of edges, as happens once the line goes idle at the end of a burst of trace data.
+ * This takes the per-cycle interrupt overhead out of the picture, allowing for much higher SWO bit rates.
  */
 
 #include "general.h"
@@ -49,6 +55,9 @@
 #include <libopencm3/cm3/nvic.h>
 #include <libopencm3/stm32/timer.h>
 #include <libopencm3/stm32/rcc.h>
+#if defined(SWO_TIM_DMA_BUS)
+#include <libopencm3/stm32/dma.h>
+#endif
 
 /* How many timer clock cycles the half period of a cycle of the SWO signal is allowed to be off by */
 #define ALLOWED_PERIOD_ERROR 5U
@@ -57,11 +66,100 @@
 	(TIM_SR_UIF | TIM_SR_CC1IF | TIM_SR_CC2IF | TIM_SR_CC3IF | TIM_SR_CC4IF | TIM_SR_TIF | TIM_SR_CC1OF | \
 		TIM_SR_CC2OF | TIM_SR_CC3OF | TIM_SR_CC4OF)
 
+#if defined(SWO_TIM_DMA_BUS)
+/* Number of cycle timings the DMA ring holds, each being the pair of capture register values for a cycle */
+#define SWO_CYCLE_BUFFER_ENTRIES 256U
+#define SWO_CYCLE_BUFFER_WORDS   (SWO_CYCLE_BUFFER_ENTRIES * 2U)
+/* DMA burst length of 2 transfers (DBL = 1) for the TIMx_DCR register */
+#define SWO_TIM_DCR_BURST_2 (1U << 8U)
+
+#if defined(DMA_STREAM0)
+#define dma_channel_reset(dma, channel)   dma_stream_reset(dma, channel)
+#define dma_enable_channel(dma, channel)  dma_enable_stream(dma, channel)
+#define dma_disable_channel(dma, channel) dma_disable_stream(dma, channel)
+
+#define DMA_PSIZE_32BIT DMA_SxCR_PSIZE_32BIT
+#define DMA_MSIZE_32BIT DMA_SxCR_MSIZE_32BIT
+#define DMA_PL_HIGH     DMA_SxCR_PL_HIGH
+#else
+#define DMA_PSIZE_32BIT DMA_CCR_PSIZE_32BIT
+#define DMA_MSIZE_32BIT DMA_CCR_MSIZE_32BIT
+#define DMA_PL_HIGH     DMA_CCR_PL_HIGH
+#endif
+
+/* Cycle timing ring, filled by DMA, and the index of the next entry to decode */
+static uint32_t swo_cycles[SWO_CYCLE_BUFFER_ENTRIES][2U];
+static uint16_t swo_cycle_read_index = 0U;
+/* Which of the pair of words in each entry is the rising edge (cycle period) capture register */
+static uint8_t swo_cycle_rising = 0U;
+#endif
+
+typedef enum swo_manchester_result {
+	SWO_MANCHESTER_CONTINUE, /* Keep going with the next cycle */
+	SWO_MANCHESTER_LOCKED,   /* The bit timing was just determined from a start bit */
+	SWO_MANCHESTER_RESET,    /* Sync was lost or a STOP seen, the captured data was flushed */
+} swo_manchester_result_e;
+
 /* Manchester bit capture buffer and current bit index */
 static uint8_t swo_data[16U];
 static uint8_t swo_data_bit_index = 0;
 /* Number of timer clock cycles that describe half a bit period as detected */
 static uint32_t swo_half_bit_period = 0U;
+/* Value of the bit started by the most recent cycle, which is stored once the next cycle is seen */
+static uint8_t swo_bit_value = 0U;
+
+#if defined(SWO_TIM_DMA_BUS)
+static void swo_manchester_dma_init(void)
+{
+	rcc_periph_clock_enable(SWO_TIM_DMA_CLK);
+
+	/*
+	 * Have each rising edge capture DMA request copy both capture registers, which the two channels being a
+	 * cross-linked pair makes adjacent, via a TIMx_DMAR burst starting from whichever of the pair comes first
+	 */
+	const uintptr_t rising = (uintptr_t)&SWO_CC_RISING;
+	const uintptr_t falling = (uintptr_t)&SWO_CC_FALLING;
+	swo_cycle_rising = rising < falling ? 0U : 1U;
+	TIM_DCR(SWO_TIM) = SWO_TIM_DCR_BURST_2 | (uint32_t)((MIN(rising, falling) - SWO_TIM) / 4U);
+
+	/* Set up the DMA channel to stream pairs of captures from the timer round the cycle timing ring */
+	dma_channel_reset(SWO_TIM_DMA_BUS, SWO_TIM_DMA_CHAN);
+	// NOLINTNEXTLINE(clang-diagnostic-pointer-to-int-cast,performance-no-int-to-ptr)
+	dma_set_peripheral_address(SWO_TIM_DMA_BUS, SWO_TIM_DMA_CHAN, (uintptr_t)&TIM_DMAR(SWO_TIM));
+	// NOLINTNEXTLINE(clang-diagnostic-pointer-to-int-cast)
+	dma_set_memory_address(SWO_TIM_DMA_BUS, SWO_TIM_DMA_CHAN, (uintptr_t)swo_cycles);
+	dma_set_number_of_data(SWO_TIM_DMA_BUS, SWO_TIM_DMA_CHAN, SWO_CYCLE_BUFFER_WORDS);
+#if defined(DMA_STREAM0)
+	dma_set_transfer_mode(SWO_TIM_DMA_BUS, SWO_TIM_DMA_CHAN, DMA_SxCR_DIR_PERIPHERAL_TO_MEM);
+	dma_channel_select(SWO_TIM_DMA_BUS, SWO_TIM_DMA_CHAN, SWO_TIM_DMA_TRG);
+	dma_set_dma_flow_control(SWO_TIM_DMA_BUS, SWO_TIM_DMA_CHAN);
+	dma_enable_direct_mode(SWO_TIM_DMA_BUS, SWO_TIM_DMA_CHAN);
+#else
+	dma_set_read_from_peripheral(SWO_TIM_DMA_BUS, SWO_TIM_DMA_CHAN);
+#endif
+	dma_enable_memory_increment_mode(SWO_TIM_DMA_BUS, SWO_TIM_DMA_CHAN);
+	dma_set_peripheral_size(SWO_TIM_DMA_BUS, SWO_TIM_DMA_CHAN, DMA_PSIZE_32BIT);
+	dma_set_memory_size(SWO_TIM_DMA_BUS, SWO_TIM_DMA_CHAN, DMA_MSIZE_32BIT);
+	dma_set_priority(SWO_TIM_DMA_BUS, SWO_TIM_DMA_CHAN, DMA_PL_HIGH);
+	dma_enable_circular_mode(SWO_TIM_DMA_BUS, SWO_TIM_DMA_CHAN);
+	/* Decode the ring a half at a time as it fills */
+	dma_enable_transfer_complete_interrupt(SWO_TIM_DMA_BUS, SWO_TIM_DMA_CHAN);
+	dma_enable_half_transfer_interrupt(SWO_TIM_DMA_BUS, SWO_TIM_DMA_CHAN);
+	swo_cycle_read_index = 0U;
+
+	/*
+	 * The DMA and timer interrupts both run the decoder, so must be at the same priority so neither preempts
+	 * the other part way through a block
+	 */
+	nvic_set_priority(SWO_TIM_DMA_IRQ, IRQ_PRI_SWO_DMA);
+	nvic_enable_irq(SWO_TIM_DMA_IRQ);
+	nvic_set_priority(SWO_TIM_IRQ, IRQ_PRI_SWO_DMA);
+	nvic_enable_irq(SWO_TIM_IRQ);
+
+	dma_enable_channel(SWO_TIM_DMA_BUS, SWO_TIM_DMA_CHAN);
+	timer_enable_irq(SWO_TIM, SWO_TIM_DMA_REQ);
+}
+#endif
 
 void swo_manchester_init(void)
 {
@@ -95,18 +193,32 @@ void swo_manchester_init(void)
 	timer_slave_set_trigger(SWO_TIM, SWO_TRIG_IN);
 	timer_slave_set_mode(SWO_TIM, TIM_SMCR_SMS_RM);
 
+#if defined(SWO_TIM_DMA_BUS)
+	swo_manchester_dma_init();
+#else
 	/* Enable capture interrupt */
 	nvic_set_priority(SWO_TIM_IRQ, IRQ_PRI_SWO_TIM);
 	nvic_enable_irq(SWO_TIM_IRQ);
 	timer_enable_irq(SWO_TIM, SWO_ITR_RISING);
+#endif
 
 	/* Enable the capture channels */
 	timer_ic_enable(SWO_TIM, SWO_IC_RISING);
 	timer_ic_enable(SWO_TIM, SWO_IC_FALLING);
 	/* Make sure all the status register bits are cleared prior to enabling the counter */
 	timer_clear_flag(SWO_TIM, TIM_SR_MASK);
+#if defined(SWO_TIM_DMA_BUS)
+	/*
+	 * Set the period to the most a 16-bit timer can do, as the timer overflowing is how the line going idle is
+	 * noticed, and only take update events from that rather than from each rising edge resetting the counter
+	 */
+	timer_set_period(SWO_TIM, UINT16_MAX);
+	timer_update_on_overflow(SWO_TIM);
+	timer_enable_irq(SWO_TIM, TIM_DIER_UIE);
+#else
 	/* Set the period to an improbable value */
 	timer_set_period(SWO_TIM, UINT32_MAX);
+#endif
 
 	/* Now we've got everything configured and ready, enable the timer */
 	timer_enable_counter(SWO_TIM);
@@ -117,6 +229,13 @@ void swo_manchester_deinit(void)
 	/* Disable the timer capturing the incomming data stream */
 	timer_disable_counter(SWO_TIM);
 	timer_slave_set_mode(SWO_TIM, TIM_SMCR_SMS_OFF);
+#if defined(SWO_TIM_DMA_BUS)
+	/* Stop the DMA and the interrupts that drive the decoder */
+	timer_disable_irq(SWO_TIM, SWO_TIM_DMA_REQ | TIM_DIER_UIE);
+	dma_disable_channel(SWO_TIM_DMA_BUS, SWO_TIM_DMA_CHAN);
+	nvic_disable_irq(SWO_TIM_DMA_IRQ);
+	nvic_disable_irq(SWO_TIM_IRQ);
+#endif
 
 	/* Reset state so that when init is called we wind up in a fresh capture state */
 	swo_data_bit_index = 0U;
@@ -132,43 +251,48 @@ void swo_manchester_deinit(void)
 
 void swo_buffer_data(void)
 {
-	const uint8_t byte_count = swo_data_bit_index >> 3U;
+	const uint8_t bytes_captured = swo_data_bit_index >> 3U;
+	/* Anything that doesn't fit in what's free of the buffer has to be dropped rather than overwrite unsent data */
+	const uint8_t byte_count = MIN(bytes_captured, SWO_BUFFER_SIZE - swo_buffer_bytes_available);
 	/* First, see how much space we have in the buffer and move what we can */
 	const uint16_t amount = MIN(byte_count, SWO_BUFFER_SIZE - swo_buffer_write_index);
 	memcpy(swo_buffer + swo_buffer_write_index, swo_data, amount);
 	swo_buffer_write_index += amount;
 	swo_buffer_write_index &= SWO_BUFFER_SIZE - 1U;
 	swo_buffer_bytes_available += amount;
+	/* If we have anything left to move, put that at the start of the buffer */
+	if (amount != byte_count) {
+		const uint16_t remainder = byte_count - amount;
+		memcpy(swo_buffer, swo_data + amount, remainder);
+		swo_buffer_write_index = remainder;
+		swo_buffer_bytes_available += remainder;
+	}
+	swo_buffer_note_captured(bytes_captured, bytes_captured - byte_count);
 	/* Make sure we're sending the data if we've got more than an endpoint buffer's worth */
-	if (swo_buffer_bytes_available >= SWO_ENDPOINT_SIZE) {
+	if (swo_buffer_bytes_available >= SWO_ENDPOINT_SIZE)
 		swo_send_buffer(usbdev, SWO_ENDPOINT);
-		/* If we have anything left to move, put that at the start of the buffer */
-		if (amount != byte_count) {
-			const uint16_t remainder = byte_count - amount;
-			memcpy(swo_buffer, swo_data + amount, remainder);
-			swo_buffer_write_index = remainder;
-			swo_buffer_bytes_available += remainder;
-		}
-	}
 	swo_data_bit_index = 0U;
 }
 
-void SWO_TIM_ISR(void)
+/* Store the value of the bit last started in the buffer and move along, as long as there's space for it */
+static void swo_manchester_store_bit(void)
 {
-	static uint8_t bit_value;
-	const uint16_t status = TIM_SR(SWO_TIM);
-
-	const uint32_t cycle_period = SWO_CC_RISING;
-	/* Check that we entered the handler because of a fresh trigger but have not yet had a chance to capture data */
-	if ((status & SWO_STATUS_RISING) && cycle_period == 0U) {
-		/* Clear the rising edge flag and wait for it to set again */
-		timer_clear_flag(SWO_TIM, SWO_STATUS_RISING | SWO_STATUS_FALLING | SWO_STATUS_OVERFLOW);
+	if (swo_data_bit_index >= 128U)
 		return;
-	}
-
-	timer_clear_flag(SWO_TIM, SWO_STATUS_RISING | SWO_STATUS_FALLING | SWO_STATUS_OVERFLOW | TIM_SR_UIF);
+	/* If this would start a new byte in the data buffer, zero it to start with */
+	if ((swo_data_bit_index & 7U) == 0U)
+		swo_data[swo_data_bit_index >> 3U] = 0U;
+	swo_data[swo_data_bit_index >> 3U] |= swo_bit_value << (swo_data_bit_index & 7U);
+	++swo_data_bit_index;
+}
 
-	const uint32_t mark_period = SWO_CC_FALLING;
+/*
+ * Decode one cycle of the SWO signal from its cycle and mark periods. rising says whether the rising edge that
+ * completes a cycle was actually seen, rather than this being a look at the captures for some other reason.
+ */
+static swo_manchester_result_e swo_manchester_decode(
+	const uint32_t cycle_period, const uint32_t mark_period, const bool rising)
+{
 	const uint32_t space_period = cycle_period - mark_period;
 
 	/* Reset decoder state if crazy things happened */
@@ -178,9 +302,9 @@ void SWO_TIM_ISR(void)
 	/* If the bit time is not yet known */
 	if (swo_half_bit_period == 0U) {
 		/* Are we here because we got an interrupt but not for the rising edge capture channel? */
-		if (!(status & SWO_STATUS_RISING))
+		if (!rising)
 			/* We're are, so leave early */
-			return;
+			return SWO_MANCHESTER_CONTINUE;
 		/*
 		 * We're here because of the rising edge, so we've got our first (start) bit.
 		 * Calculate the ratio of the mark period to the space period within a cycle
@@ -197,105 +321,163 @@ void SWO_TIM_ISR(void)
 		 * the double space bit time caused by start + 0
 		 */
 		if (duty_ratio < 2U || duty_ratio > 3U)
-			return;
+			return SWO_MANCHESTER_CONTINUE;
 		/*
 		 * Now we've established a valid duty cycle ratio, store the mark period as the bit timing and
 		 * initialise the capture engine: check whether we captured, the start of a 0 bit to set the next
-		 * bit value, and configure the timer maximum period to 6x the current max half bit period, enabling
-		 * overflow checking now we have an overflow target for the timer
+		 * bit value
 		 */
 		swo_half_bit_period = adjusted_mark_period;
-		bit_value = space_period >= swo_half_bit_period * 2U ? 0U : 1U;
-		/* XXX: Need to make sure that this isn't setting a value outside the range of the timer */
-		timer_set_period(SWO_TIM, mark_period * 6U);
-		timer_clear_flag(SWO_TIM, TIM_SR_UIF | SWO_STATUS_OVERFLOW);
-		timer_enable_irq(SWO_TIM, TIM_DIER_UIE);
-	} else {
+		swo_bit_value = space_period >= swo_half_bit_period * 2U ? 0U : 1U;
+		return SWO_MANCHESTER_LOCKED;
+	}
+
+	/*
+	 * We start off needing to store a newly captured bit - the value of which is determined in the *previous*
+	 * traversal of this function. We don't yet worry about whether we're starting half way through a bit or not.
+	 */
+	swo_manchester_store_bit();
+
+	/*
+	 * Having stored a bit, check if we've got a long cycle period - this can happen due to any sequence
+	 * involving at least one bit transition (0 -> 1, 1 -> 0), or a 1 -> STOP sequence:
+	 * 0 -> 1:    ▁▁╱▔┊▔▔╲▁
+	 * 1 -> 0:    ▔▔╲▁┊▁▁╱▔
+	 * 1 -> STOP: ▔▔╲▁┊▁▁▁▁
+	 *
+	 * An even longer non-stop cycle time occurs when a 0 -> 1 -> 0 sequence is encountered:
+	 * ▁▁╱▔┊▔▔╲▁┊▁▁╱▔
+	 *
+	 * All of these cases need special handling and can appear to this decoder as part of one of the following:
+	 * 0 -> 1 -> 0:    ▁▁╱▔┊▔▔╲▁┊▁▁╱▔ (4x half bit periods)
+	 * 0 -> 1 -> 1:    ▁▁╱▔┊▔▔╲▁┊╱▔╲▁ (3x half bit periods)
+	 * 0 -> 1 -> STOP: ▁▁╱▔┊▔▔╲▁┊▁▁▁▁
+	 * 1 -> 1 -> 0:    ▔▔╲▁┊╱▔╲▁┊▁▁╱▔ (3x half bit periods)
+	 * 1 -> 1 -> STOP: ▔▔╲▁┊╱▔╲▁┊▁▁▁▁
+	 * 1 -> 0 -> STOP: ▔▔╲▁┊▁▁╱▔┊╲▁▁▁
+	 *
+	 * The bit write that has already occured deals with the lead-in part of all of these.
+	 */
+	if (cycle_period >= swo_half_bit_period * 3U) {
 		/*
-		 * We start off needing to store a newly captured bit - the value of which is determined in the *previous*
-		 * traversal of this function. We don't yet worry about whether we're starting half way through a bit or not.
-		 *
-		 * If this would start a new byte in the data buffer, zero it to start with
+		 * Having determined that we're in a long cycle, we need to figure out which kind.
+		 * If the mark period is short, then whether we're starting half way into a bit determines
+		 * if the next is a 1 (not half way in) or a 0 (half way in). This copies the current bit value.
+		 * If the mark period is long, then this can only occur from a 0 -> 1 transition where we're
+		 * half way into the cycle. Anything else indicates a fault occured.
 		 */
-		if ((swo_data_bit_index & 7U) == 0U)
-			swo_data[swo_data_bit_index >> 3U] = 0U;
-		/* Store the new bit in the buffer and move along */
-		swo_data[swo_data_bit_index >> 3U] |= bit_value << (swo_data_bit_index & 7U);
-		++swo_data_bit_index;
+		if (mark_period >= swo_half_bit_period * 2U) {
+			if (swo_bit_value == 1U)
+				goto flush_and_reset; /* Something bad happened and we lost sync */
+			swo_bit_value = 1U;
+		}
 
 		/*
-		 * Having stored a bit, check if we've got a long cycle period - this can happen due to any sequence
-		 * involving at least one bit transition (0 -> 1, 1 -> 0), or a 1 -> STOP sequence:
-		 * 0 -> 1:    ▁▁╱▔┊▔▔╲▁
-		 * 1 -> 0:    ▔▔╲▁┊▁▁╱▔
-		 * 1 -> STOP: ▔▔╲▁┊▁▁▁▁
-		 *
-		 * An even longer non-stop cycle time occurs when a 0 -> 1 -> 0 sequence is encountered:
-		 * ▁▁╱▔┊▔▔╲▁┊▁▁╱▔
-		 *
-		 * All of these cases need special handling and can appear to this decoder as part of one of the following:
-		 * 0 -> 1 -> 0:    ▁▁╱▔┊▔▔╲▁┊▁▁╱▔ (4x half bit periods)
-		 * 0 -> 1 -> 1:    ▁▁╱▔┊▔▔╲▁┊╱▔╲▁ (3x half bit periods)
-		 * 0 -> 1 -> STOP: ▁▁╱▔┊▔▔╲▁┊▁▁▁▁
-		 * 1 -> 1 -> 0:    ▔▔╲▁┊╱▔╲▁┊▁▁╱▔ (3x half bit periods)
-		 * 1 -> 1 -> STOP: ▔▔╲▁┊╱▔╲▁┊▁▁▁▁
-		 * 1 -> 0 -> STOP: ▔▔╲▁┊▁▁╱▔┊╲▁▁▁
-		 *
-		 * The bit write that has already occured deals with the lead-in part of all of these.
+		 * We now know the value of the extra bit, if it's from anything other than a short mark, long space,
+		 * then we need to store that next bit.
 		 */
-		if (cycle_period >= swo_half_bit_period * 3U) {
-			/*
-			 * Having determined that we're in a long cycle, we need to figure out which kind.
-			 * If the mark period is short, then whether we're starting half way into a bit determines
-			 * if the next is a 1 (not half way in) or a 0 (half way in). This copies the current bit value.
-			 * If the mark period is long, then this can only occur from a 0 -> 1 transition where we're
-			 * half way into the cycle. Anything else indicates a fault occured.
-			 */
-			if (mark_period >= swo_half_bit_period * 2U) {
-				if (bit_value == 1U)
-					goto flush_and_reset; /* Something bad happened and we lost sync */
-				bit_value = 1U;
-			}
-
-			/*
-			 * We now know the value of the extra bit, if it's from anything other than a short mark, long space,
-			 * then we need to store that next bit.
-			 */
-			if (mark_period >= swo_half_bit_period * 2U || space_period < swo_half_bit_period * 2U) {
-				/* If this would overflow the buffer, then do nothing */
-				if (swo_data_bit_index < 128U) {
-					/* If this would start a new byte in the data buffer, zero it to start with */
-					if ((swo_data_bit_index & 7U) == 0U)
-						swo_data[swo_data_bit_index >> 3U] = 0U;
-					/* Store the new bit in the buffer and move along */
-					swo_data[swo_data_bit_index >> 3U] |= bit_value << (swo_data_bit_index & 7U);
-					++swo_data_bit_index;
-				}
-			}
-			/* If it's a long space, we just saw a 1 -> 0 transition */
-			if (space_period >= swo_half_bit_period * 2U) {
-				/* Unless of course this was acompanied by a short mark period, in which case it's a STOP bit */
-				if (bit_value == 0U)
-					goto flush_and_reset;
-				bit_value = 0U;
-			}
-
-			/*
-			 * We've now written enough data to the buffer, so we have one final check:
-			 * If the cycle has a long space, we need to determine how long to check for STOP bits.
-			 */
-			if (space_period >= swo_half_bit_period * 3U)
+		if (mark_period >= swo_half_bit_period * 2U || space_period < swo_half_bit_period * 2U)
+			swo_manchester_store_bit();
+		/* If it's a long space, we just saw a 1 -> 0 transition */
+		if (space_period >= swo_half_bit_period * 2U) {
+			/* Unless of course this was acompanied by a short mark period, in which case it's a STOP bit */
+			if (swo_bit_value == 0U)
 				goto flush_and_reset;
+			swo_bit_value = 0U;
 		}
+
+		/*
+		 * We've now written enough data to the buffer, so we have one final check:
+		 * If the cycle has a long space, we need to determine how long to check for STOP bits.
+		 */
+		if (space_period >= swo_half_bit_period * 3U)
+			goto flush_and_reset;
 	}
 
 	/* If the buffer is not full, and we haven't encountered a STOP bit, we're done here */
 	if (swo_data_bit_index < 128U)
-		return;
+		return SWO_MANCHESTER_CONTINUE;
 
 flush_and_reset:
-	timer_set_period(SWO_TIM, UINT32_MAX);
-	timer_disable_irq(SWO_TIM, TIM_DIER_UIE);
 	swo_buffer_data();
 	swo_half_bit_period = 0;
+	return SWO_MANCHESTER_RESET;
 }
+
+#if defined(SWO_TIM_DMA_BUS)
+/* Decode all the cycle timings the DMA has completely written into the ring since the last time */
+static void swo_manchester_decode_block(void)
+{
+	const uint16_t written =
+		((SWO_CYCLE_BUFFER_WORDS - dma_get_number_of_data(SWO_TIM_DMA_BUS, SWO_TIM_DMA_CHAN)) / 2U) %
+		SWO_CYCLE_BUFFER_ENTRIES;
+	while (swo_cycle_read_index != written) {
+		const uint32_t *const cycle = swo_cycles[swo_cycle_read_index];
+		/* Every entry comes from a rising edge capture DMA request */
+		(void)swo_manchester_decode(cycle[swo_cycle_rising], cycle[swo_cycle_rising ^ 1U], true);
+		swo_cycle_read_index = (swo_cycle_read_index + 1U) % SWO_CYCLE_BUFFER_ENTRIES;
+	}
+}
+
+void SWO_TIM_DMA_ISR(void)
+{
+	if (dma_get_interrupt_flag(SWO_TIM_DMA_BUS, SWO_TIM_DMA_CHAN, DMA_HTIF))
+		dma_clear_interrupt_flags(SWO_TIM_DMA_BUS, SWO_TIM_DMA_CHAN, DMA_HTIF);
+	if (dma_get_interrupt_flag(SWO_TIM_DMA_BUS, SWO_TIM_DMA_CHAN, DMA_TCIF))
+		dma_clear_interrupt_flags(SWO_TIM_DMA_BUS, SWO_TIM_DMA_CHAN, DMA_TCIF);
+	swo_manchester_decode_block();
+}
+
+/*
+ * The timer overflowed, so there's not been a rising edge for a whole timer period and the line has gone idle.
+ * Decode what's left in the ring, then as the final cycle of the burst never gets completed by another rising
+ * edge, store the bit it started and flush everything captured through, just as seeing a STOP would.
+ */
+void SWO_TIM_ISR(void)
+{
+	timer_clear_flag(SWO_TIM, TIM_SR_UIF);
+	swo_manchester_decode_block();
+	if (!swo_half_bit_period && !swo_data_bit_index)
+		return;
+	if (swo_half_bit_period)
+		swo_manchester_store_bit();
+	swo_buffer_data();
+	swo_half_bit_period = 0U;
+	swo_send_buffer(usbdev, SWO_ENDPOINT);
+}
+#else
+void SWO_TIM_ISR(void)
+{
+	const uint16_t status = TIM_SR(SWO_TIM);
+
+	const uint32_t cycle_period = SWO_CC_RISING;
+	/* Check that we entered the handler because of a fresh trigger but have not yet had a chance to capture data */
+	if ((status & SWO_STATUS_RISING) && cycle_period == 0U) {
+		/* Clear the rising edge flag and wait for it to set again */
+		timer_clear_flag(SWO_TIM, SWO_STATUS_RISING | SWO_STATUS_FALLING | SWO_STATUS_OVERFLOW);
+		return;
+	}
+
+	timer_clear_flag(SWO_TIM, SWO_STATUS_RISING | SWO_STATUS_FALLING | SWO_STATUS_OVERFLOW | TIM_SR_UIF);
+
+	const uint32_t mark_period = SWO_CC_FALLING;
+	switch (swo_manchester_decode(cycle_period, mark_period, status & SWO_STATUS_RISING)) {
+	case SWO_MANCHESTER_LOCKED:
+		/*
+		 * Configure the timer maximum period to 6x the current max half bit period, enabling
+		 * overflow checking now we have an overflow target for the timer
+		 */
+		/* XXX: Need to make sure that this isn't setting a value outside the range of the timer */
+		timer_set_period(SWO_TIM, mark_period * 6U);
+		timer_clear_flag(SWO_TIM, TIM_SR_UIF | SWO_STATUS_OVERFLOW);
+		timer_enable_irq(SWO_TIM, TIM_DIER_UIE);
+		break;
+	case SWO_MANCHESTER_RESET:
+		timer_set_period(SWO_TIM, UINT32_MAX);
+		timer_disable_irq(SWO_TIM, TIM_DIER_UIE);
+		break;
+	default:
+		break;
+	}
+}
+#endif
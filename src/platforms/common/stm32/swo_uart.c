@@ -151,15 +151,33 @@ uint32_t swo_uart_get_baudrate(void)
 	return usart_get_baudrate(SWO_UART);
 }
 
+/*
+ * Account for the half of the buffer the DMA just finished filling, which starts at half_start. The DMA
+ * runs continuously, so if USB hadn't taken the previous contents of that half yet, they've been overwritten,
+ * and the DMA is already on to the other half. Drop all the older data and pick up from the new half.
+ */
+static void swo_uart_half_filled(const uint16_t half_start)
+{
+	const uint16_t half = SWO_BUFFER_SIZE / 2U;
+	uint16_t dropped = 0U;
+	if (swo_buffer_bytes_available > half) {
+		dropped = swo_buffer_bytes_available;
+		swo_buffer_read_index = half_start;
+		swo_buffer_bytes_available = half;
+	} else
+		swo_buffer_bytes_available += half;
+	swo_buffer_note_captured(half, dropped);
+}
+
 void SWO_DMA_ISR(void)
 {
 	if (dma_get_interrupt_flag(SWO_DMA_BUS, SWO_DMA_CHAN, DMA_HTIF)) {
 		dma_clear_interrupt_flags(SWO_DMA_BUS, SWO_DMA_CHAN, DMA_HTIF);
-		swo_buffer_bytes_available += SWO_BUFFER_SIZE / 2U;
+		swo_uart_half_filled(0U);
 	}
 	if (dma_get_interrupt_flag(SWO_DMA_BUS, SWO_DMA_CHAN, DMA_TCIF)) {
 		dma_clear_interrupt_flags(SWO_DMA_BUS, SWO_DMA_CHAN, DMA_TCIF);
-		swo_buffer_bytes_available += SWO_BUFFER_SIZE / 2U;
+		swo_uart_half_filled(SWO_BUFFER_SIZE / 2U);
 	}
 	swo_send_buffer(usbdev, SWO_ENDPOINT);
 }
@@ -22,6 +22,7 @@
 #include "platform.h"
 #include "morse.h"
 #include "usb.h"
+#include "swd.h"
 
 #include <libopencm3/cm3/systick.h>
 #include <libopencm3/cm3/nvic.h>
@@ -78,6 +79,14 @@ void platform_delay(uint32_t ms)
 		continue;
 }
 
+void platform_delay_us(const uint32_t us)
+{
+	platform_timeout_us_s timeout;
+	platform_timeout_us_set(&timeout, us);
+	while (!platform_timeout_us_is_expired(&timeout))
+		continue;
+}
+
 void sys_tick_handler(void)
 {
 	time_ms += SYSTICKMS;
@@ -141,6 +150,20 @@ uint32_t platform_time_ms(void)
 	return time_ms;
 }
 
+uint32_t platform_time_us(void)
+{
+	uint32_t ms;
+	uint32_t count;
+	/* Re-read if the tick fired part way through, so the ms count and SysTick value agree with each other */
+	do {
+		ms = time_ms;
+		count = systick_get_value();
+	} while (ms != time_ms);
+	/* SysTick counts down from its reload value once per tick, so turn how far it's got into microseconds */
+	const uint32_t reload = systick_get_reload();
+	return (ms * 1000U) + (((reload - count) * (SYSTICKMS * 1000U)) / (reload + 1U));
+}
+
 __attribute__((weak)) void platform_ospeed_update(const uint32_t frequency)
 {
 	(void)frequency;
@@ -180,15 +203,17 @@ void platform_max_frequency_set(const uint32_t frequency)
 #else
 	uint32_t divisor = rcc_ahb_frequency - USED_SWD_CYCLES * frequency;
 	/* If we now have an insanely big divisor, the above operation wrapped to a negative signed number. */
-	if (divisor >= 0x80000000U) {
+	if (divisor >= 0x80000000U)
 		target_clk_divider = UINT32_MAX;
-		return;
+	else {
+		divisor /= 2U;
+		target_clk_divider = divisor / (CYCLES_PER_CNT * frequency);
+		if (target_clk_divider * (CYCLES_PER_CNT * frequency) < divisor)
+			++target_clk_divider;
 	}
-	divisor /= 2U;
-	target_clk_divider = divisor / (CYCLES_PER_CNT * frequency);
-	if (target_clk_divider * (CYCLES_PER_CNT * frequency) < divisor)
-		++target_clk_divider;
 #endif
+	/* Switch the SWD routines over between their delayed and flat-out forms as needed */
+	swdptap_speed_update();
 }
 
 uint32_t platform_max_frequency_get(void)
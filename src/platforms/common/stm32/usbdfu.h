@@ -28,6 +28,16 @@
 #define CMD_ERASE   0x41U
 extern uintptr_t app_address;
 
+/*
+ * How much data each DFU_DNLOAD/DFU_UPLOAD request carries. Every block costs a DFU_GETSTATUS round trip and
+ * the host waiting out the poll timeout, so go as big as the bootloader's RAM comfortably allows.
+ */
+#if defined(STM32F4) || defined(STM32F7)
+#define DFU_TRANSFER_SIZE 4096U
+#else
+#define DFU_TRANSFER_SIZE 1024U
+#endif
+
 /* dfucore.c - DFU core, common to libopencm3 platforms. */
 void dfu_init(const usbd_driver *driver);
 void dfu_main(void);
@@ -25,6 +25,9 @@
 #include "timing.h"
 #include "swd.h"
 #include "maths_utils.h"
+#ifdef PLATFORM_HAS_SWD_DMA
+#include "swdptap_dma.h"
+#endif
 
 #if !defined(SWDIO_IN_PORT)
 #define SWDIO_IN_PORT SWDIO_PORT
@@ -40,11 +43,32 @@ typedef enum swdio_status_e {
 
 swd_proc_s swd_proc;
 
+static bool swdptap_active = false;
+
 static void swdptap_turnaround(swdio_status_t dir) __attribute__((optimize(3)));
-static uint32_t swdptap_seq_in(size_t clock_cycles) __attribute__((optimize(3)));
-static bool swdptap_seq_in_parity(uint32_t *ret, size_t clock_cycles) __attribute__((optimize(3)));
-static void swdptap_seq_out(uint32_t tms_states, size_t clock_cycles) __attribute__((optimize(3)));
-static void swdptap_seq_out_parity(uint32_t tms_states, size_t clock_cycles) __attribute__((optimize(3)));
+static uint32_t swdptap_seq_in_delay(size_t clock_cycles) __attribute__((optimize(3)));
+static bool swdptap_seq_in_parity_delay(uint32_t *ret, size_t clock_cycles) __attribute__((optimize(3)));
+static void swdptap_seq_out_delay(uint32_t tms_states, size_t clock_cycles) __attribute__((optimize(3)));
+static void swdptap_seq_out_parity_delay(uint32_t tms_states, size_t clock_cycles) __attribute__((optimize(3)));
+static uint32_t swdptap_seq_in_fast(size_t clock_cycles) __attribute__((optimize(3)));
+static bool swdptap_seq_in_parity_fast(uint32_t *ret, size_t clock_cycles) __attribute__((optimize(3)));
+static void swdptap_seq_out_fast(uint32_t tms_states, size_t clock_cycles) __attribute__((optimize(3)));
+static void swdptap_seq_out_parity_fast(uint32_t tms_states, size_t clock_cycles) __attribute__((optimize(3)));
+
+/* The routines for when there's a clock divider to honour, and for when the clock is running flat out */
+static const swd_proc_s swdptap_delay_proc = {
+	.seq_in = swdptap_seq_in_delay,
+	.seq_in_parity = swdptap_seq_in_parity_delay,
+	.seq_out = swdptap_seq_out_delay,
+	.seq_out_parity = swdptap_seq_out_parity_delay,
+};
+
+static const swd_proc_s swdptap_fast_proc = {
+	.seq_in = swdptap_seq_in_fast,
+	.seq_in_parity = swdptap_seq_in_parity_fast,
+	.seq_out = swdptap_seq_out_fast,
+	.seq_out_parity = swdptap_seq_out_parity_fast,
+};
 
 /*
  * Overall strategy for timing consistency:
@@ -60,10 +84,18 @@ static void swdptap_seq_out_parity(uint32_t tms_states, size_t clock_cycles) __a
 
 void swdptap_init(void)
 {
-	swd_proc.seq_in = swdptap_seq_in;
-	swd_proc.seq_in_parity = swdptap_seq_in_parity;
-	swd_proc.seq_out = swdptap_seq_out;
-	swd_proc.seq_out_parity = swdptap_seq_out_parity;
+#ifdef PLATFORM_HAS_SWD_DMA
+	swdptap_dma_init();
+#endif
+	swdptap_active = true;
+	swdptap_speed_update();
+}
+
+void swdptap_speed_update(void)
+{
+	/* Until swdptap_init() is called, something else may own swd_proc */
+	if (swdptap_active)
+		swd_proc = target_clk_divider == UINT32_MAX ? swdptap_fast_proc : swdptap_delay_proc;
 }
 
 static void swdptap_turnaround(const swdio_status_t dir)
@@ -125,6 +157,26 @@ static uint32_t swdptap_seq_in_clk_delay(const size_t clock_cycles)
 	return value;
 }
 
+#ifndef PLATFORM_HAS_SWD_DMA
+static inline uint32_t swdptap_in_bit_no_delay(uint32_t value) __attribute__((always_inline));
+
+static inline uint32_t swdptap_in_bit_no_delay(uint32_t value)
+{
+	/* Reordering barrier */
+	__asm__("" ::: "memory");
+	const bool bit = gpio_get(SWDIO_IN_PORT, SWDIO_IN_PIN);
+	gpio_set(SWCLK_PORT, SWCLK_PIN);
+	__asm__("nop" ::: "memory");
+	value >>= 1U;
+	value |= (uint32_t)bit << 31U;
+	/* Reordering barrier */
+	__asm__("" ::: "memory");
+	gpio_clear(SWCLK_PORT, SWCLK_PIN);
+	/* Reordering barrier */
+	__asm__("" ::: "memory");
+	return value;
+}
+
 static uint32_t swdptap_seq_in_no_delay(size_t clock_cycles) __attribute__((optimize(3)));
 
 static uint32_t swdptap_seq_in_no_delay(const size_t clock_cycles)
@@ -132,41 +184,48 @@ static uint32_t swdptap_seq_in_no_delay(const size_t clock_cycles)
 	if (!clock_cycles)
 		return 0;
 	uint32_t value = 0;
+	/*
+	 * The 32-bit data phase makes up the bulk of every transfer, so unroll it fully
+	 * to spend the clock on the pins rather than on loop control
+	 */
+	if (clock_cycles == 32U) {
+#pragma GCC unroll 32
+		for (size_t cycle = 0; cycle < 32U; ++cycle)
+			value = swdptap_in_bit_no_delay(value);
+		return value;
+	}
 	/*
 	 * Count down instead of up, because with an up-count, some ARM-GCC
 	 * versions use an explicit CMP, missing the optimization of converting
 	 * to a faster down-count that uses SUBS followed by BCS/BCC.
 	 */
-	for (size_t cycle = clock_cycles; cycle--;) {
-		/* Reordering barrier */
-		__asm__("" ::: "memory");
-		bool bit = gpio_get(SWDIO_IN_PORT, SWDIO_IN_PIN);
-		gpio_set(SWCLK_PORT, SWCLK_PIN);
-		__asm__("nop" ::: "memory");
-		value >>= 1U;
-		value |= (uint32_t)bit << 31U;
-		/* Reordering barrier */
-		__asm__("" ::: "memory");
-		gpio_clear(SWCLK_PORT, SWCLK_PIN);
-		/* Reordering barrier */
-		__asm__("" ::: "memory");
-	}
+	for (size_t cycle = clock_cycles; cycle--;)
+		value = swdptap_in_bit_no_delay(value);
 	value >>= (32U - clock_cycles);
 	return value;
 }
+#endif
+
+static uint32_t swdptap_seq_in_delay(const size_t clock_cycles)
+{
+	swdptap_turnaround(SWDIO_STATUS_FLOAT);
+	return swdptap_seq_in_clk_delay(clock_cycles);
+}
 
-static uint32_t swdptap_seq_in(size_t clock_cycles)
+static uint32_t swdptap_seq_in_fast(const size_t clock_cycles)
 {
 	swdptap_turnaround(SWDIO_STATUS_FLOAT);
-	if (target_clk_divider != UINT32_MAX)
-		return swdptap_seq_in_clk_delay(clock_cycles);
-	else // NOLINT(readability-else-after-return)
-		return swdptap_seq_in_no_delay(clock_cycles);
+	/* At the top speed, have the hardware shift the bits if the platform can */
+#ifdef PLATFORM_HAS_SWD_DMA
+	return swdptap_dma_seq_in(clock_cycles);
+#else
+	return swdptap_seq_in_no_delay(clock_cycles);
+#endif
 }
 
-static bool swdptap_seq_in_parity(uint32_t *ret, size_t clock_cycles)
+static bool swdptap_seq_in_parity_delay(uint32_t *const ret, const size_t clock_cycles)
 {
-	const uint32_t result = swdptap_seq_in(clock_cycles);
+	const uint32_t result = swdptap_seq_in_delay(clock_cycles);
 	for (volatile uint32_t counter = target_clk_divider + 1; counter > 0; --counter)
 		continue;
 
@@ -185,6 +244,21 @@ static bool swdptap_seq_in_parity(uint32_t *ret, size_t clock_cycles)
 	return parity == bit;
 }
 
+static bool swdptap_seq_in_parity_fast(uint32_t *const ret, const size_t clock_cycles)
+{
+	const uint32_t result = swdptap_seq_in_fast(clock_cycles);
+	const bool bit = gpio_get(SWDIO_IN_PORT, SWDIO_IN_PIN);
+	gpio_set(SWCLK_PORT, SWCLK_PIN);
+	__asm__("nop" ::: "memory");
+	gpio_clear(SWCLK_PORT, SWCLK_PIN);
+	/* Terminate the read cycle now */
+	swdptap_turnaround(SWDIO_STATUS_DRIVE);
+
+	const bool parity = calculate_odd_parity(result);
+	*ret = result;
+	return parity == bit;
+}
+
 static void swdptap_seq_out_clk_delay(uint32_t tms_states, size_t clock_cycles) __attribute__((optimize(3)));
 
 static void swdptap_seq_out_clk_delay(const uint32_t tms_states, const size_t clock_cycles)
@@ -216,47 +290,69 @@ static void swdptap_seq_out_clk_delay(const uint32_t tms_states, const size_t cl
 	}
 }
 
+#ifndef PLATFORM_HAS_SWD_DMA
+static inline uint32_t swdptap_out_bit_no_delay(uint32_t value) __attribute__((always_inline));
+
+static inline uint32_t swdptap_out_bit_no_delay(uint32_t value)
+{
+	/* Reordering barrier */
+	__asm__("" ::: "memory");
+	gpio_clear(SWCLK_PORT, SWCLK_PIN);
+	gpio_set_val(SWDIO_PORT, SWDIO_PIN, value & 1U);
+	gpio_set(SWCLK_PORT, SWCLK_PIN);
+	__asm__("nop" ::: "memory");
+	value >>= 1U;
+	/* Reordering barrier */
+	__asm__("" ::: "memory");
+	return value;
+}
+
 static void swdptap_seq_out_no_delay(uint32_t tms_states, size_t clock_cycles) __attribute__((optimize(3)));
 
 static void swdptap_seq_out_no_delay(const uint32_t tms_states, const size_t clock_cycles)
 {
 	uint32_t value = tms_states;
-	bool bit = value & 1U;
 	if (!clock_cycles)
 		return;
-	/*
-	 * Count down instead of up, because with an up-count, some ARM-GCC
-	 * versions use an explicit CMP, missing the optimization of converting
-	 * to a faster down-count that uses SUBS followed by BCS/BCC.
-	 */
-	for (size_t cycle = clock_cycles; cycle--;) {
-		/* Reordering barrier */
-		__asm__("" ::: "memory");
-		gpio_clear(SWCLK_PORT, SWCLK_PIN);
-		gpio_set_val(SWDIO_PORT, SWDIO_PIN, bit);
-		gpio_set(SWCLK_PORT, SWCLK_PIN);
-		__asm__("nop" ::: "memory");
-		value >>= 1U;
-		bit = value & 1U;
-		/* Reordering barrier */
-		__asm__("" ::: "memory");
+	/* As with reads, unroll the 32-bit data phase fully */
+	if (clock_cycles == 32U) {
+#pragma GCC unroll 32
+		for (size_t cycle = 0; cycle < 32U; ++cycle)
+			value = swdptap_out_bit_no_delay(value);
+	} else {
+		/*
+		 * Count down instead of up, because with an up-count, some ARM-GCC
+		 * versions use an explicit CMP, missing the optimization of converting
+		 * to a faster down-count that uses SUBS followed by BCS/BCC.
+		 */
+		for (size_t cycle = clock_cycles; cycle--;)
+			value = swdptap_out_bit_no_delay(value);
 	}
 	gpio_clear(SWCLK_PORT, SWCLK_PIN);
 }
+#endif
 
-static void swdptap_seq_out(const uint32_t tms_states, const size_t clock_cycles)
+static void swdptap_seq_out_delay(const uint32_t tms_states, const size_t clock_cycles)
 {
 	swdptap_turnaround(SWDIO_STATUS_DRIVE);
-	if (target_clk_divider != UINT32_MAX)
-		swdptap_seq_out_clk_delay(tms_states, clock_cycles);
-	else
-		swdptap_seq_out_no_delay(tms_states, clock_cycles);
+	swdptap_seq_out_clk_delay(tms_states, clock_cycles);
 }
 
-static void swdptap_seq_out_parity(const uint32_t tms_states, const size_t clock_cycles)
+static void swdptap_seq_out_fast(const uint32_t tms_states, const size_t clock_cycles)
+{
+	swdptap_turnaround(SWDIO_STATUS_DRIVE);
+	/* At the top speed, have the hardware shift the bits if the platform can */
+#ifdef PLATFORM_HAS_SWD_DMA
+	swdptap_dma_seq_out(tms_states, clock_cycles);
+#else
+	swdptap_seq_out_no_delay(tms_states, clock_cycles);
+#endif
+}
+
+static void swdptap_seq_out_parity_delay(const uint32_t tms_states, const size_t clock_cycles)
 {
 	const bool parity = calculate_odd_parity(tms_states);
-	swdptap_seq_out(tms_states, clock_cycles);
+	swdptap_seq_out_delay(tms_states, clock_cycles);
 	gpio_set_val(SWDIO_PORT, SWDIO_PIN, parity);
 	for (volatile uint32_t counter = target_clk_divider + 1; counter > 0; --counter)
 		continue;
@@ -265,3 +361,13 @@ static void swdptap_seq_out_parity(const uint32_t tms_states, const size_t clock
 		continue;
 	gpio_clear(SWCLK_PORT, SWCLK_PIN);
 }
+
+static void swdptap_seq_out_parity_fast(const uint32_t tms_states, const size_t clock_cycles)
+{
+	const bool parity = calculate_odd_parity(tms_states);
+	swdptap_seq_out_fast(tms_states, clock_cycles);
+	gpio_set_val(SWDIO_PORT, SWDIO_PIN, parity);
+	gpio_set(SWCLK_PORT, SWCLK_PIN);
+	__asm__("nop" ::: "memory");
+	gpio_clear(SWCLK_PORT, SWCLK_PIN);
+}
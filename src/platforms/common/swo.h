@@ -23,7 +23,7 @@
 #ifndef PLATFORMS_COMMON_SWO_H
 #define PLATFORMS_COMMON_SWO_H
 
-#if !defined(NO_LIBOPENCM3)
+#if CONFIG_BMDA == 0 && !defined(NO_LIBOPENCM3)
 #include <libopencm3/usb/usbd.h>
 #endif
 
@@ -38,11 +38,37 @@ typedef enum swo_coding {
 
 extern swo_coding_e swo_current_mode;
 
+/* Counters for how well the capture keeps up, reset each time SWO is enabled */
+typedef struct swo_stats {
+	uint32_t bytes_captured; /* Received off the SWO pin */
+	uint32_t bytes_sent;     /* Handed on to USB or the ITM decoder */
+	uint32_t bytes_dropped;  /* Lost because the buffer was full */
+	uint32_t overflows;      /* Times the buffer overflowed */
+	uint32_t endpoint_busy;  /* Times data was waiting but the USB endpoint hadn't been read by the host yet */
+	uint32_t buffer_size;    /* Capture buffer size */
+	uint32_t fill_max;       /* High water mark of the buffer */
+} swo_stats_s;
+
+extern swo_stats_s swo_stats;
+
 /* Initialisation and deinitialisation functions (ties into command.c) */
 void swo_init(swo_coding_e swo_mode, uint32_t baudrate, uint32_t itm_stream_bitmask);
 void swo_deinit(bool deallocate);
 
-#if !defined(NO_LIBOPENCM3)
+/* Set a bitmask of SWO ITM streams to be decoded */
+void swo_itm_decode_set_mask(uint32_t mask);
+
+/* Decode a new block of ITM data from SWO */
+uint16_t swo_itm_decode(const uint8_t *data, uint16_t len);
+
+#if CONFIG_BMDA == 1
+/* Drain whatever SWO data the probe has captured since the last call through to the decoder or capture file */
+void swo_poll(void);
+/* Write the raw SWO data to this file rather than discarding it when not decoding */
+void swo_set_capture_file(const char *path);
+#endif
+
+#if CONFIG_BMDA == 0 && !defined(NO_LIBOPENCM3)
 
 /* UART mode baudate functions */
 uint32_t swo_uart_get_baudrate(void);
@@ -51,12 +77,6 @@ void bmd_usart_set_baudrate(uint32_t usart, uint32_t baud_rate);
 /* USB callback for the raw data endpoint to ask for a new buffer of data */
 void swo_send_buffer(usbd_device *dev, uint8_t ep);
 
-/* Set a bitmask of SWO ITM streams to be decoded */
-void swo_itm_decode_set_mask(uint32_t mask);
-
-/* Decode a new block of ITM data from SWO */
-uint16_t swo_itm_decode(const uint8_t *data, uint16_t len);
-
-#endif /* !NO_LIBOPENCM3 */
+#endif /* CONFIG_BMDA == 0 && !NO_LIBOPENCM3 */
 
 #endif /* PLATFORMS_COMMON_SWO_H */
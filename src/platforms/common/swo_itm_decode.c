@@ -0,0 +1,137 @@
+/*
+ * This file is part of the Black Magic Debug project.
+ *
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.	 See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.	 If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * This file implements decoding of SWO data when that data is an ITM SWIT data stream.
+ * It puts the decoded data onto the aux USB serial interface for consumption, or in BMDA onto stdout.
+ */
+
+#include "general.h"
+#include "swo.h"
+#if CONFIG_BMDA == 1
+#include <stdio.h>
+
+#define ITM_DECODE_BUFFER_SIZE 64U
+#else
+#include "usb_serial.h"
+
+#define ITM_DECODE_BUFFER_SIZE CDCACM_PACKET_SIZE
+#endif
+
+/*
+ * Decoding is driven by a table indexed by packet header byte. Each entry gives the number of
+ * payload bytes that follow the header, whether that payload should be displayed (folding in the
+ * stream bitmask), and whether the header is instead followed by continuation bytes - bytes with
+ * bit 7 set until the last one, as used by timestamp and extension packets.
+ *
+ * References:
+ * DDI0403 - ARMv7-M Architecture Reference Manual, version E.e, Appendix D4 "Debug ITM and DWT Packet Protocol"
+ * - https://developer.arm.com/documentation/ddi0403/latest/
+ */
+#define ITM_DECODE_LENGTH_MASK 0x07U
+#define ITM_DECODE_DISPLAY     0x08U
+#define ITM_DECODE_CONTINUE    0x10U
+
+static uint8_t itm_header_table[256U];
+static uint8_t itm_decoded_buffer[ITM_DECODE_BUFFER_SIZE];
+static uint16_t itm_decoded_buffer_index = 0;
+static uint8_t itm_packet_length = 0; /* decoder state */
+static bool itm_decode_packet = false;
+static bool itm_continuation = false;
+
+static void swo_itm_decode_flush(void)
+{
+#if CONFIG_BMDA == 1
+	fwrite(itm_decoded_buffer, 1U, itm_decoded_buffer_index, stdout);
+	fflush(stdout);
+#else
+	/* However, if the link is not yet up, drop the packet data silently */
+	if (usb_get_config() && gdb_serial_get_dtr())
+		debug_serial_send_stdout(itm_decoded_buffer, itm_decoded_buffer_index);
+#endif
+	itm_decoded_buffer_index = 0U;
+}
+
+/* Put decoded payload bytes into the output buffer, flushing it out each time it fills up */
+static void swo_itm_decode_output(const uint8_t *data, uint16_t len)
+{
+	while (len) {
+		const uint16_t amount = MIN(len, sizeof(itm_decoded_buffer) - itm_decoded_buffer_index);
+		memcpy(itm_decoded_buffer + itm_decoded_buffer_index, data, amount);
+		itm_decoded_buffer_index += amount;
+		data += amount;
+		len -= amount;
+		if (itm_decoded_buffer_index == sizeof(itm_decoded_buffer))
+			swo_itm_decode_flush();
+	}
+}
+
+uint16_t swo_itm_decode(const uint8_t *data, uint16_t len)
+{
+	for (uint16_t idx = 0; idx < len;) {
+		/* If we're part way through a packet's payload, consume as much of the rest of it as we have */
+		if (itm_packet_length) {
+			const uint16_t amount = MIN(itm_packet_length, len - idx);
+			if (itm_decode_packet)
+				swo_itm_decode_output(data + idx, amount);
+			itm_packet_length -= amount;
+			idx += amount;
+			continue;
+		}
+
+		const uint8_t value = data[idx++];
+		/* Skip continuation bytes, the last of which has bit 7 clear */
+		if (itm_continuation) {
+			itm_continuation = (value & 0x80U) != 0U;
+			continue;
+		}
+
+		/* Otherwise this is a new packet header, so look up what follows it */
+		const uint8_t entry = itm_header_table[value];
+		itm_packet_length = entry & ITM_DECODE_LENGTH_MASK;
+		itm_decode_packet = (entry & ITM_DECODE_DISPLAY) != 0U;
+		itm_continuation = (entry & ITM_DECODE_CONTINUE) != 0U;
+	}
+#if CONFIG_BMDA == 1
+	/* There's no packet to fill on stdout, so don't hold partial lines back waiting for more data */
+	if (itm_decoded_buffer_index)
+		swo_itm_decode_flush();
+#endif
+	return len;
+}
+
+void swo_itm_decode_set_mask(uint32_t mask)
+{
+	for (size_t header = 0; header < sizeof(itm_header_table); ++header) {
+		const uint8_t size = header & 0x03U;
+		uint8_t entry = 0U;
+		if (size) {
+			/* Source packet - map the size bits 1 -> 1, 2 -> 2, and 3 -> 4 bytes of payload */
+			entry = 1U << (size - 1U);
+			/* Only software source (SWIT) packets, which have bit 2 clear, are for display */
+			if ((header & 0x04U) == 0U && (mask & (1U << (header >> 3U))))
+				entry |= ITM_DECODE_DISPLAY;
+		} else if (header != 0x80U && (header & 0x80U))
+			/* Protocol packet with its C bit set - continuation bytes follow (the 0x80 that ends a sync doesn't) */
+			entry = ITM_DECODE_CONTINUE;
+		itm_header_table[header] = entry;
+	}
+	/* Start over from a packet boundary */
+	itm_packet_length = 0U;
+	itm_continuation = false;
+}
@@ -41,6 +41,22 @@ void gdb_if_putchar(const char c, const bool flush)
 		gdb_if_flush(flush);
 }
 
+void gdb_if_write(const void *const data, const size_t length, const bool flush)
+{
+	const char *const buffer = (const char *)data;
+	for (size_t offset = 0U; offset < length;) {
+		/* Copy as much as fits in the packet being built, sending it on if that fills it */
+		const size_t amount = MIN(length - offset, CDCACM_PACKET_SIZE - count_in);
+		memcpy(buffer_in + count_in, buffer + offset, amount);
+		count_in += amount;
+		offset += amount;
+		if (count_in == CDCACM_PACKET_SIZE)
+			gdb_if_flush(flush && offset == length);
+	}
+	if (flush)
+		gdb_if_flush(true);
+}
+
 void gdb_if_flush(const bool force)
 {
 	/* Flush only if there is data to flush */
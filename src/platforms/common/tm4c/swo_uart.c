@@ -38,12 +38,20 @@
 #include <libopencm3/lm4f/nvic.h>
 #include <libopencm3/lm4f/uart.h>
 
+#define FIFO_SIZE 256U
+
+swo_stats_s swo_stats;
+
 void swo_init(const swo_coding_e swo_mode, const uint32_t baudrate, const uint32_t itm_stream_bitmask)
 {
 	/* Neither mode switching nor ITM decoding is implemented on this platform (yet) */
 	(void)swo_mode;
 	(void)itm_stream_bitmask;
 
+	/* Start the counters afresh for this capture */
+	memset(&swo_stats, 0, sizeof(swo_stats));
+	swo_stats.buffer_size = FIFO_SIZE;
+
 	/* Ensure required peripherals are spun up */
 	/* TODO: Move this into platform_init()! */
 	periph_clock_enable(RCC_GPIOD);
@@ -102,8 +110,6 @@ uint32_t swo_uart_get_baudrate(void)
 	return uart_get_baudrate(SWO_UART);
 }
 
-#define FIFO_SIZE 256U
-
 /* RX Fifo buffer */
 static uint8_t buf_rx[FIFO_SIZE];
 /* Fifo in pointer, writes assumed to be atomic, should be only incremented within RX ISR */
@@ -129,7 +135,9 @@ void trace_buf_push(void)
 	if (usbd_ep_write_packet(usbdev, SWO_ENDPOINT, (uint8_t *)&buf_rx[buf_rx_out], len) == len) {
 		buf_rx_out += len;
 		buf_rx_out %= FIFO_SIZE;
-	}
+		swo_stats.bytes_sent += len;
+	} else
+		++swo_stats.endpoint_busy;
 }
 
 void swo_send_buffer(usbd_device *dev, uint8_t ep)
@@ -157,11 +165,16 @@ void SWO_UART_ISR(void)
 		if ((buf_rx_in + 1U) % FIFO_SIZE != buf_rx_out) {
 			/* insert into FIFO */
 			buf_rx[buf_rx_in++] = c;
+			++swo_stats.bytes_captured;
 
 			/* wrap out pointer */
 			if (buf_rx_in >= FIFO_SIZE)
 				buf_rx_in = 0;
+			swo_stats.fill_max = MAX(swo_stats.fill_max, (uint32_t)((buf_rx_in + FIFO_SIZE - buf_rx_out) % FIFO_SIZE));
 		} else {
+			/* The character just read has nowhere to go */
+			++swo_stats.bytes_dropped;
+			++swo_stats.overflows;
 			flush = 1;
 			break;
 		}
@@ -236,9 +236,22 @@ uint32_t debug_serial_fifo_send(const char *const fifo, const uint32_t fifo_begi
 	 * To avoid the need of sending ZLP don't transmit full packet.
 	 * Also reserve space for copy function overrun.
 	 */
+	const uint32_t packet_max = CDCACM_PACKET_SIZE - 1U;
+	/*
+	 * When the data doesn't wrap, send it straight out of the FIFO rather than copying it a byte at a time,
+	 * so long as the copy function's overrun past the end of it (at most a word) stays inside the FIFO
+	 */
+	if (fifo_end > fifo_begin) {
+		const uint32_t direct_len = MIN(fifo_end - fifo_begin, packet_max);
+		if (fifo_begin + direct_len + sizeof(uint32_t) <= AUX_UART_BUFFER_SIZE) {
+			const uint16_t written = usbd_ep_write_packet(usbdev, CDCACM_UART_ENDPOINT, fifo + fifo_begin, direct_len);
+			return (fifo_begin + written) % AUX_UART_BUFFER_SIZE;
+		}
+	}
+
 	char packet[CDCACM_PACKET_SIZE - 1U];
 	uint32_t packet_len = 0;
-	for (uint32_t fifo_index = fifo_begin; fifo_index != fifo_end && packet_len < CDCACM_PACKET_SIZE - 1U;
+	for (uint32_t fifo_index = fifo_begin; fifo_index != fifo_end && packet_len < packet_max;
 		 fifo_index %= AUX_UART_BUFFER_SIZE)
 		packet[packet_len++] = fifo[fifo_index++];
 
@@ -302,6 +315,11 @@ void debug_serial_run(void)
 
 static void debug_serial_send_callback(usbd_device *dev, uint8_t ep)
 {
+#ifdef ENABLE_RTT
+	/* RTT shares the endpoint, aux serial data going out only when it has none */
+	if (rtt_enabled && rtt_serial_send_callback(dev, ep))
+		return;
+#endif
 	(void)ep;
 	(void)dev;
 #if defined(STM32F0) || defined(STM32F1) || defined(STM32F3) || defined(STM32F4) || defined(STM32F7)
@@ -56,17 +56,21 @@ void trace_send_data(void);
 
 #define TIMEOUT_TICK_COUNT 1000
 
-#define INPUT_BUFFER_SIZE 2048
+/* The receive ring has room for a couple of full size GDB packets, filled a TCP segment's worth at a time */
+#define INPUT_BUFFER_SIZE 4096
+#define RECV_BUFFER_SIZE  1460
+/* Replies are gathered up into a TCP segment's worth, the most the WINC1500 takes in a single send */
+#define SEND_BUFFER_SIZE 1400U
 
 static uint8_t input_buffer[INPUT_BUFFER_SIZE] = {0}; ///< The input buffer[ input buffer size]
 static volatile uint32_t input_index = 0;             ///< Zero-based index of the input
 static volatile uint32_t output_index = 0;            ///< Zero-based index of the output
 static volatile uint32_t buffer_count = 0;            ///< Number of buffers
 
-static uint8_t local_buffer[INPUT_BUFFER_SIZE] = {0}; ///< The local buffer[ input buffer size]
+static uint8_t local_buffer[RECV_BUFFER_SIZE] = {0}; ///< The local buffer[ recv buffer size]
 
-static uint8_t send_buffer[1024] = {0}; ///< The send buffer[ 1024]
-static uint32_t send_count = 0;         ///< Number of sends
+static uint8_t send_buffer[SEND_BUFFER_SIZE] = {0}; ///< The send buffer[ send buffer size]
+static uint32_t send_count = 0;                     ///< Number of sends
 
 static uint32_t timeout_seconds = 0;      // Used to perform a countdown in seconds for app tasks
 static uint32_t timeout_tick_counter = 0; // counts Timer1 ticks (1mS) for an active timeout
@@ -982,7 +986,7 @@ static void app_socket_callback(SOCKET sock, uint8_t msg_type, void *msg)
 				//
 				// Start another receive operation so we always get data
 				//
-				recv(gdb_client_socket, &local_buffer[0], INPUT_BUFFER_SIZE, 0);
+				recv(gdb_client_socket, &local_buffer[0], RECV_BUFFER_SIZE, 0);
 			} else
 				process_recv_error(sock, recv_data, msg_type);
 		} else if (sock == uart_debug_client_socket) {
@@ -1417,7 +1421,7 @@ void app_task(void)
 			//
 			// Set up a recv call
 			//
-			recv(gdb_client_socket, &local_buffer[0], INPUT_BUFFER_SIZE, 0);
+			recv(gdb_client_socket, &local_buffer[0], RECV_BUFFER_SIZE, 0);
 		}
 		if (new_uart_debug_client_conncted) {
 			new_uart_debug_client_conncted = false;
@@ -1615,6 +1619,20 @@ void send_uart_data(uint8_t *buffer, uint8_t length)
 void send_swo_trace_data(uint8_t *buffer, uint8_t length)
 {
 	m2mStub_EintDisable();
+	/*
+	 * The entry at the head of the queue is the one in flight, but anything queued up behind it can still be
+	 * added to, so tack the new data onto the last of those if it fits rather than using up another entry
+	 */
+	if (swo_trace_send_queue_length > 1U) {
+		send_queue_entry_s *const last =
+			&swo_trace_send_queue[(swo_trace_send_queue_in + SEND_QUEUE_SIZE - 1U) % SEND_QUEUE_SIZE];
+		if (last->len + length <= SEND_QUEUE_BUFFER_SIZE) {
+			memcpy(last->packet + last->len, buffer, length);
+			last->len += length;
+			m2mStub_EintEnable();
+			return;
+		}
+	}
 	memcpy(swo_trace_send_queue[swo_trace_send_queue_in].packet, buffer, length);
 	swo_trace_send_queue[swo_trace_send_queue_in].len = length;
 	swo_trace_send_queue_in = (swo_trace_send_queue_in + 1) % SEND_QUEUE_SIZE;
@@ -1633,6 +1651,22 @@ void wifi_gdb_putchar(const uint8_t ch, const bool flush)
 		wifi_gdb_flush(flush);
 }
 
+void wifi_gdb_write(const void *const data, const size_t length, const bool flush)
+{
+	const uint8_t *const buffer = (const uint8_t *)data;
+	for (size_t offset = 0U; offset < length;) {
+		/* Copy as much as fits in the segment being built, sending it on if that fills it */
+		const size_t amount = MIN(length - offset, sizeof(send_buffer) - send_count);
+		memcpy(send_buffer + send_count, buffer + offset, amount);
+		send_count += amount;
+		offset += amount;
+		if (send_count == sizeof(send_buffer))
+			wifi_gdb_flush(false);
+	}
+	if (flush)
+		wifi_gdb_flush(true);
+}
+
 void wifi_gdb_flush(const bool force)
 {
 	(void)force;
@@ -1641,13 +1675,9 @@ void wifi_gdb_flush(const bool force)
 	if (send_count == 0U)
 		return;
 
-	// TODO is this check required now, looks like a debug test left in place?
-	if (send_count <= 0U)
-		DEBUG_WARN("WiFi_putchar bad count\r\n");
-	DEBUG_WARN("Wifi_putchar %c\r\n", send_buffer[0]);
+	DEBUG_WARN("WiFi send -> %" PRIu32 "\r\n", send_count);
 	send(gdb_client_socket, &send_buffer[0], send_count, 0);
 
 	/* Reset the buffer */
 	send_count = 0U;
-	memset(&send_buffer[0], 0x00, sizeof(send_buffer));
 }
@@ -40,6 +40,7 @@ bool is_swo_trace_client_connected(void);
 void send_swo_trace_data(uint8_t *buffer, uint8_t length);
 
 void wifi_gdb_putchar(uint8_t ch, bool flush);
+void wifi_gdb_write(const void *data, size_t length, bool flush);
 void wifi_gdb_flush(bool force);
 bool wifi_got_client(void);
 uint8_t wifi_get_next(void);
@@ -160,6 +160,20 @@ void gdb_if_putchar(const char ch, const bool flush)
 		gdb_usb_putchar(ch, flush);
 }
 
+void gdb_if_write(const void *const data, const size_t length, const bool flush)
+{
+	if (is_gdb_client_connected()) {
+		wifi_gdb_write(data, length, flush);
+		return;
+	}
+	/* The USB side doesn't take blocks, so feed the characters through one at a time */
+	const char *const buffer = (const char *)data;
+	for (size_t offset = 0U; offset < length; ++offset)
+		gdb_if_putchar(buffer[offset], false);
+	if (flush)
+		gdb_if_flush(true);
+}
+
 void gdb_if_flush(const bool force)
 {
 	if (is_gdb_client_connected())
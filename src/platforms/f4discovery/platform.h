@@ -130,6 +130,7 @@
 #define IRQ_PRI_USBUSART     (2U << 4U)
 #define IRQ_PRI_USBUSART_DMA (2U << 4U)
 #define IRQ_PRI_SWO_TIM      (0U << 4U)
+#define IRQ_PRI_SWO_DMA      (0U << 4U)
 
 /* Use TIM3 Input 1 (from PC6/TDO) */
 #define SWO_TIM             TIM3
@@ -148,6 +149,15 @@
 #define SWO_TRIG_IN         TIM_SMCR_TS_TI1FP1
 #define SWO_TIM_PIN_AF      GPIO_AF2
 
+/* Capture the Manchester cycle timings via TIM3_CH1's DMA request on DMA1 Stream 4, channel 5 */
+#define SWO_TIM_DMA_BUS    DMA1
+#define SWO_TIM_DMA_CLK    RCC_DMA1
+#define SWO_TIM_DMA_CHAN   DMA_STREAM4
+#define SWO_TIM_DMA_TRG    DMA_SxCR_CHSEL_5
+#define SWO_TIM_DMA_REQ    TIM_DIER_CC1DE
+#define SWO_TIM_DMA_IRQ    NVIC_DMA1_STREAM4_IRQ
+#define SWO_TIM_DMA_ISR(x) dma1_stream4_isr(x)
+
 #define SET_RUN_STATE(state)      \
 	{                             \
 		running_status = (state); \
@@ -0,0 +1,222 @@
+/*
+ * This file is part of the Black Magic Debug project.
+ *
+ * Copyright (C) 2026 1BitSquared <info@1bitsquared.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * This file implements a benchmark suite for the host side encoders and decoders that sit on every GDB,
+ * remote protocol and SWO transfer, so changes to them can be measured without a probe or target in the
+ * loop. Each benchmark repeats one operation over a fixed buffer for BENCH_CODEC_DURATION_MS and reports
+ *   bench <name> bytes=<count> ms=<elapsed> rate=<bytes per second>
+ * in the same form as the target benchmarks (see target/bench.c), counting the bytes of unencoded data.
+ *
+ * With no GDB connected, gdb_if drops everything it is handed, so the GDB packet benchmarks time the
+ * escaping, run-length encoding and checksumming without any socket I/O. Likewise the ITM stream is
+ * decoded with every stimulus port masked off so nothing ends up on stdout.
+ */
+
+#include "general.h"
+#include "hex_utils.h"
+#include "crc32.h"
+#include "gdb_packet.h"
+#include "bmp_hosted.h"
+#include "bmp_remote.h"
+#include "swo.h"
+#include "bench_codec.h"
+
+#define BENCH_CODEC_DURATION_MS 250U
+#define BENCH_CODEC_BUFFER_SIZE 1024U
+/* How many runs to do between looking at the clock, so reading it doesn't dominate the short operations */
+#define BENCH_CODEC_BATCH 64U
+
+/*
+ * Keep the packets inside the GDB packet buffer, the received one strictly so as the packet code treats
+ * filling the buffer as an overflow
+ */
+#define BENCH_CODEC_GDB_TX_SIZE MIN(BENCH_CODEC_BUFFER_SIZE, GDB_PACKET_BUFFER_SIZE)
+#define BENCH_CODEC_GDB_RX_SIZE MIN(BENCH_CODEC_BUFFER_SIZE, GDB_PACKET_BUFFER_SIZE - 1U)
+/* The digits in a remote protocol response carrying a 64-bit value */
+#define BENCH_CODEC_RESPONSE_DIGITS 16U
+
+typedef struct bench_codec_state {
+	uint8_t data[BENCH_CODEC_BUFFER_SIZE];
+	char hex[(BENCH_CODEC_BUFFER_SIZE * 2U) + 1U];
+	/* The GDB packet built from data, escaped and with its checksum, for the receive benchmark */
+	char packet[(BENCH_CODEC_BUFFER_SIZE * 2U) + 4U];
+	size_t packet_len;
+	uint8_t itm[BENCH_CODEC_BUFFER_SIZE];
+	volatile uint64_t sink;
+} bench_codec_state_s;
+
+typedef struct bench_codec {
+	const char *name;
+	/* How many bytes of unencoded data each run handles */
+	size_t amount;
+	void (*run)(bench_codec_state_s *state);
+} bench_codec_s;
+
+static void bench_codec_hexify(bench_codec_state_s *const state)
+{
+	hexify(state->hex, state->data, BENCH_CODEC_BUFFER_SIZE);
+}
+
+static void bench_codec_unhexify(bench_codec_state_s *const state)
+{
+	unhexify(state->data, state->hex, BENCH_CODEC_BUFFER_SIZE);
+}
+
+static void bench_codec_crc32(bench_codec_state_s *const state)
+{
+	state->sink = bmd_crc32_buffer(state->data, BENCH_CODEC_BUFFER_SIZE);
+}
+
+static void bench_codec_crc32_fill(bench_codec_state_s *const state)
+{
+	state->sink = bmd_crc32_fill(0xffU, BENCH_CODEC_BUFFER_SIZE);
+}
+
+static void bench_codec_gdb_tx_binary(bench_codec_state_s *const state)
+{
+	/* Binary data goes out as-is apart from the reserved characters, which need escaping */
+	gdb_put_packet(NULL, 0U, (const char *)state->data, BENCH_CODEC_GDB_TX_SIZE, false);
+}
+
+static void bench_codec_gdb_tx_hex(bench_codec_state_s *const state)
+{
+	/* Memory reads are hexified into the packet, then run-length encoded on the way out */
+	gdb_put_packet_hex(state->data, BENCH_CODEC_GDB_TX_SIZE / 2U);
+}
+
+static void bench_codec_gdb_rx(bench_codec_state_s *const state)
+{
+	gdb_if_replay(state->packet, state->packet_len);
+	state->sink = gdb_packet_receive()->size;
+}
+
+static void bench_codec_remote_decode(bench_codec_state_s *const state)
+{
+	/* Decode the hex as a run of responses, each carrying a 64-bit value */
+	uint64_t value = 0U;
+	for (size_t offset = 0U; offset < BENCH_CODEC_BUFFER_SIZE * 2U; offset += BENCH_CODEC_RESPONSE_DIGITS)
+		value ^= remote_decode_response(state->hex + offset, BENCH_CODEC_RESPONSE_DIGITS);
+	state->sink = value;
+}
+
+static void bench_codec_itm_decode(bench_codec_state_s *const state)
+{
+	swo_itm_decode(state->itm, sizeof(state->itm));
+}
+
+static const bench_codec_s bench_codec_list[] = {
+	{"hexify", BENCH_CODEC_BUFFER_SIZE, bench_codec_hexify},
+	{"unhexify", BENCH_CODEC_BUFFER_SIZE, bench_codec_unhexify},
+	{"crc32", BENCH_CODEC_BUFFER_SIZE, bench_codec_crc32},
+	{"crc32_fill", BENCH_CODEC_BUFFER_SIZE, bench_codec_crc32_fill},
+	{"gdb_tx_binary", BENCH_CODEC_GDB_TX_SIZE, bench_codec_gdb_tx_binary},
+	{"gdb_tx_hex", BENCH_CODEC_GDB_TX_SIZE / 2U, bench_codec_gdb_tx_hex},
+	{"gdb_rx", BENCH_CODEC_GDB_RX_SIZE, bench_codec_gdb_rx},
+	{"remote_decode", BENCH_CODEC_BUFFER_SIZE, bench_codec_remote_decode},
+	{"itm_decode", BENCH_CODEC_BUFFER_SIZE, bench_codec_itm_decode},
+};
+
+static void bench_codec_append(bench_codec_state_s *const state, const char value, uint8_t *const checksum)
+{
+	state->packet[state->packet_len++] = value;
+	*checksum += (uint8_t)value;
+}
+
+/* Fill the buffers with data that exercises both the fast paths and the escapes, runs and packet headers */
+static void bench_codec_setup(bench_codec_state_s *const state)
+{
+	/* A mix of counting bytes, which include every reserved GDB character, and runs like erased Flash */
+	for (size_t idx = 0U; idx < BENCH_CODEC_BUFFER_SIZE; ++idx)
+		state->data[idx] = (idx & 0x100U) ? 0xffU : (uint8_t)(idx * 7U);
+	hexify(state->hex, state->data, BENCH_CODEC_BUFFER_SIZE);
+
+	uint8_t checksum = 0U;
+	state->packet[state->packet_len++] = GDB_PACKET_START;
+	for (size_t idx = 0U; idx < BENCH_CODEC_GDB_RX_SIZE; ++idx) {
+		const char value = (char)state->data[idx];
+		if (value == GDB_PACKET_START || value == GDB_PACKET_END || value == GDB_PACKET_ESCAPE ||
+			value == GDB_PACKET_RUNLENGTH_START) {
+			bench_codec_append(state, GDB_PACKET_ESCAPE, &checksum);
+			bench_codec_append(state, (char)(value ^ GDB_PACKET_ESCAPE_XOR), &checksum);
+		} else
+			bench_codec_append(state, value, &checksum);
+	}
+	state->packet[state->packet_len++] = GDB_PACKET_END;
+	state->packet[state->packet_len++] = hex_digit(checksum >> 4U);
+	state->packet[state->packet_len++] = hex_digit(checksum & 0xfU);
+
+	/* 32-bit stimulus port writes, with a sync and a single byte timestamp packet every so often */
+	for (size_t idx = 0U, count = 0U; idx < BENCH_CODEC_BUFFER_SIZE; ++count) {
+		const char *item = "\x03" "abcd";
+		size_t length = 5U;
+		if ((count % 32U) == 0U) {
+			item = "\x00\x00\x00\x00\x00\x80";
+			length = 6U;
+		} else if ((count % 4U) == 0U) {
+			item = "\x10";
+			length = 1U;
+		}
+		length = MIN(length, BENCH_CODEC_BUFFER_SIZE - idx);
+		memcpy(state->itm + idx, item, length);
+		idx += length;
+	}
+	swo_itm_decode_set_mask(0U);
+}
+
+static void bench_codec_one(const bench_codec_s *const bench, bench_codec_state_s *const state)
+{
+	uint64_t amount = 0U;
+	const uint32_t start = platform_time_ms();
+	uint32_t elapsed = 0U;
+	while (elapsed < BENCH_CODEC_DURATION_MS) {
+		for (size_t run = 0U; run < BENCH_CODEC_BATCH; ++run)
+			bench->run(state);
+		amount += BENCH_CODEC_BATCH * bench->amount;
+		elapsed = platform_time_ms() - start;
+	}
+	const uint32_t ms = elapsed ? elapsed : 1U;
+	printf("bench %s bytes=%" PRIu64 " ms=%" PRIu32 " rate=%" PRIu64 "\n", bench->name, amount, elapsed,
+		(amount * 1000U) / ms);
+	fflush(stdout);
+}
+
+bool bench_codec_run(void)
+{
+	bench_codec_state_s *const state = calloc(1U, sizeof(*state));
+	if (!state) { /* calloc failed: heap exhaustion */
+		DEBUG_ERROR("calloc: failed in %s\n", __func__);
+		return false;
+	}
+	bench_codec_setup(state);
+
+	for (size_t idx = 0U; idx < ARRAY_LENGTH(bench_codec_list); ++idx) {
+		const bench_codec_s *const bench = &bench_codec_list[idx];
+		/*
+		 * Nothing is there to acknowledge the packets sent, so don't wait around for it, but do stay in
+		 * acknowledgement mode for receiving as only then are the checksums checked
+		 */
+		gdb_set_noackmode(bench->run != bench_codec_gdb_rx);
+		bench_codec_one(bench, state);
+	}
+	gdb_set_noackmode(false);
+
+	free(state);
+	return true;
+}
@@ -41,6 +41,9 @@
 #include <string.h>
 #include <limits.h>
 #include <stdbool.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
 
 #include "bmda_gpiod.h"
 
@@ -58,6 +61,69 @@ bool bmda_gpiod_swd_ok = false;
 
 uint32_t target_clk_divider = UINT32_MAX;
 
+/*
+ * Each pin access through libgpiod is a syscall, which limits bit-banging to a few hundred kHz. For the SoCs
+ * where the GPIO block can be memory mapped from userspace, "mmio=<soc>" in the GPIO mapping switches pin
+ * access over to poking the registers directly once the lines have been requested (and so muxed as GPIOs)
+ * through libgpiod. The lines must then be on the SoC's own GPIO bank, numbered as its GPIOs are.
+ */
+typedef enum bmda_gpiod_mmio {
+	BMDA_GPIOD_MMIO_NONE,
+	BMDA_GPIOD_MMIO_BCM2711, /* Raspberry Pi 4 and CM4 */
+	BMDA_GPIOD_MMIO_RP1,     /* Raspberry Pi 5 and CM5, bank 0 (the 40-pin header) */
+} bmda_gpiod_mmio_e;
+
+/* BCM2711 GPIO register word offsets into /dev/gpiomem */
+#define BCM2711_GPIOMEM      "/dev/gpiomem"
+#define BCM2711_GPIOMEM_SIZE 4096U
+#define BCM2711_GPIO_COUNT   58U
+#define BCM2711_GPFSEL0      0U
+#define BCM2711_GPSET0       7U
+#define BCM2711_GPCLR0       10U
+#define BCM2711_GPLEV0       13U
+#define BCM2711_FSEL_MASK    7U
+#define BCM2711_FSEL_OUTPUT  1U
+
+/* RP1 bank 0 registered IO (RIO) word offsets into /dev/gpiomem0, which maps from IO_BANK0 */
+#define RP1_GPIOMEM      "/dev/gpiomem0"
+#define RP1_GPIOMEM_SIZE 0x30000U
+#define RP1_GPIO_COUNT   28U
+#define RP1_RIO          (0x10000U / 4U)
+#define RP1_RIO_OUT      0U
+#define RP1_RIO_OE       1U
+#define RP1_RIO_SYNC_IN  2U
+#define RP1_RIO_SET      (0x2000U / 4U)
+#define RP1_RIO_CLR      (0x3000U / 4U)
+
+static bmda_gpiod_mmio_e bmda_gpiod_mmio_type = BMDA_GPIOD_MMIO_NONE;
+static volatile uint32_t *bmda_gpiod_mmio = NULL;
+
+static void bmda_gpiod_mmio_set(const unsigned int offset, const bool val)
+{
+	if (bmda_gpiod_mmio_type == BMDA_GPIOD_MMIO_BCM2711)
+		bmda_gpiod_mmio[(val ? BCM2711_GPSET0 : BCM2711_GPCLR0) + (offset >> 5U)] = 1U << (offset & 31U);
+	else
+		bmda_gpiod_mmio[RP1_RIO + (val ? RP1_RIO_SET : RP1_RIO_CLR) + RP1_RIO_OUT] = 1U << offset;
+}
+
+static bool bmda_gpiod_mmio_get(const unsigned int offset)
+{
+	if (bmda_gpiod_mmio_type == BMDA_GPIOD_MMIO_BCM2711)
+		return (bmda_gpiod_mmio[BCM2711_GPLEV0 + (offset >> 5U)] >> (offset & 31U)) & 1U;
+	return (bmda_gpiod_mmio[RP1_RIO + RP1_RIO_SYNC_IN] >> offset) & 1U;
+}
+
+static void bmda_gpiod_mmio_direction(const unsigned int offset, const bool output)
+{
+	if (bmda_gpiod_mmio_type == BMDA_GPIOD_MMIO_BCM2711) {
+		/* Function selects are packed 10 pins to a register, so this has to be a read-modify-write */
+		volatile uint32_t *const fsel = &bmda_gpiod_mmio[BCM2711_GPFSEL0 + (offset / 10U)];
+		const uint32_t shift = (offset % 10U) * 3U;
+		*fsel = (*fsel & ~(BCM2711_FSEL_MASK << shift)) | ((output ? BCM2711_FSEL_OUTPUT : 0U) << shift);
+	} else
+		bmda_gpiod_mmio[RP1_RIO + (output ? RP1_RIO_SET : RP1_RIO_CLR) + RP1_RIO_OE] = 1U << offset;
+}
+
 static void bmda_gpiod_debug_pin(struct gpiod_line *line, const char *op, bool print, bool val)
 {
 #ifdef DEBUG
@@ -77,7 +143,9 @@ void bmda_gpiod_set_pin(struct gpiod_line *pin, bool val)
 {
 	if (pin) {
 		bmda_gpiod_debug_pin(pin, "set", true, val);
-		if (gpiod_line_set_value(pin, val ? 1 : 0)) {
+		if (bmda_gpiod_mmio)
+			bmda_gpiod_mmio_set(gpiod_line_offset(pin), val);
+		else if (gpiod_line_set_value(pin, val ? 1 : 0)) {
 			DEBUG_ERROR("Failed to set pin to value %d errno: %d", val, errno);
 			exit(1);
 		}
@@ -88,6 +156,8 @@ void bmda_gpiod_set_pin(struct gpiod_line *pin, bool val)
 bool bmda_gpiod_get_pin(struct gpiod_line *pin)
 {
 	if (pin) {
+		if (bmda_gpiod_mmio)
+			return bmda_gpiod_mmio_get(gpiod_line_offset(pin));
 		int ret = gpiod_line_get_value(pin);
 		if (ret < 0) {
 			DEBUG_ERROR("Failed to get pin value errno: %d", errno);
@@ -105,7 +175,9 @@ void bmda_gpiod_mode_input(struct gpiod_line *pin)
 {
 	if (pin) {
 		bmda_gpiod_debug_pin(pin, "input", false, false);
-		if (gpiod_line_set_direction_input(pin)) {
+		if (bmda_gpiod_mmio)
+			bmda_gpiod_mmio_direction(gpiod_line_offset(pin), false);
+		else if (gpiod_line_set_direction_input(pin)) {
 			DEBUG_ERROR("Failed to set pin to input errno: %d", errno);
 			exit(1);
 		}
@@ -117,7 +189,9 @@ void bmda_gpiod_mode_output(struct gpiod_line *pin)
 {
 	if (pin) {
 		bmda_gpiod_debug_pin(pin, "output", false, false);
-		if (gpiod_line_set_direction_output(pin, 0)) {
+		if (bmda_gpiod_mmio)
+			bmda_gpiod_mmio_direction(gpiod_line_offset(pin), true);
+		else if (gpiod_line_set_direction_output(pin, 0)) {
 			DEBUG_ERROR("Failed to set pin to output errno: %d", errno);
 			exit(1);
 		}
@@ -209,7 +283,17 @@ static bool bmda_gpiod_parse_gpiomap(const char *gpio_map)
 		}
 		*val = '\0';
 		val++;
-		if (!bmda_gpiod_parse_gpio(token, val)) {
+		if (!strcmp("mmio", token)) {
+			if (!strcmp("bcm2711", val))
+				bmda_gpiod_mmio_type = BMDA_GPIOD_MMIO_BCM2711;
+			else if (!strcmp("rp1", val))
+				bmda_gpiod_mmio_type = BMDA_GPIOD_MMIO_RP1;
+			else {
+				DEBUG_ERROR("Unrecognised GPIO MMIO SoC: %s, expected bcm2711 or rp1\n", val);
+				ret = false;
+				break;
+			}
+		} else if (!bmda_gpiod_parse_gpio(token, val)) {
 			ret = false;
 			break;
 		}
@@ -221,6 +305,41 @@ static bool bmda_gpiod_parse_gpiomap(const char *gpio_map)
 	return ret;
 }
 
+static bool bmda_gpiod_mmio_pin_ok(struct gpiod_line *const pin, const unsigned int count)
+{
+	return !pin || gpiod_line_offset(pin) < count;
+}
+
+/* Map the SoC's GPIO registers, having checked every requested line is one it can reach */
+static bool bmda_gpiod_mmio_init(void)
+{
+	const bool bcm2711 = bmda_gpiod_mmio_type == BMDA_GPIOD_MMIO_BCM2711;
+	const unsigned int count = bcm2711 ? BCM2711_GPIO_COUNT : RP1_GPIO_COUNT;
+	if (!bmda_gpiod_mmio_pin_ok(bmda_gpiod_tck_pin, count) || !bmda_gpiod_mmio_pin_ok(bmda_gpiod_tms_pin, count) ||
+		!bmda_gpiod_mmio_pin_ok(bmda_gpiod_tdi_pin, count) || !bmda_gpiod_mmio_pin_ok(bmda_gpiod_tdo_pin, count) ||
+		!bmda_gpiod_mmio_pin_ok(bmda_gpiod_swdio_pin, count) || !bmda_gpiod_mmio_pin_ok(bmda_gpiod_swclk_pin, count)) {
+		DEBUG_ERROR("GPIO MMIO only reaches offsets 0 to %u of the SoC's GPIO bank\n", count - 1U);
+		return false;
+	}
+
+	const char *const path = bcm2711 ? BCM2711_GPIOMEM : RP1_GPIOMEM;
+	const size_t size = bcm2711 ? BCM2711_GPIOMEM_SIZE : RP1_GPIOMEM_SIZE;
+	const int fd = open(path, O_RDWR | O_SYNC);
+	if (fd == -1) {
+		DEBUG_ERROR("Couldn't open %s, error %d: %s\n", path, errno, strerror(errno));
+		return false;
+	}
+	void *const mapping = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	close(fd);
+	if (mapping == MAP_FAILED) {
+		DEBUG_ERROR("Couldn't map %s, error %d: %s\n", path, errno, strerror(errno));
+		return false;
+	}
+	bmda_gpiod_mmio = mapping;
+	DEBUG_INFO("Using memory mapped GPIO through %s\n", path);
+	return true;
+}
+
 bool bmda_gpiod_init(bmda_cli_options_s *const cl_opts)
 {
 	if (!cl_opts->opt_gpio_map)
@@ -229,6 +348,9 @@ bool bmda_gpiod_init(bmda_cli_options_s *const cl_opts)
 	if (!bmda_gpiod_parse_gpiomap(cl_opts->opt_gpio_map))
 		return false;
 
+	if (bmda_gpiod_mmio_type != BMDA_GPIOD_MMIO_NONE && !bmda_gpiod_mmio_init())
+		return false;
+
 	if (bmda_gpiod_swclk_pin && bmda_gpiod_swdio_pin)
 		bmda_gpiod_swd_ok = true;
 
@@ -88,6 +88,8 @@ typedef struct bmda_probe {
 	uint8_t interface_num;
 	uint8_t in_ep;
 	uint8_t out_ep;
+	/* CMSIS-DAP v2 SWO streaming endpoint, 0 if the interface doesn't have one */
+	uint8_t swo_ep;
 	uint16_t max_packet_length;
 #endif
 } bmda_probe_s;
@@ -97,13 +99,34 @@ typedef struct timeval timeval_s;
 extern bmda_probe_s bmda_probe_info;
 void bmp_ident(bmda_probe_s *info);
 bool find_debuggers(bmda_cli_options_s *cl_opts, bmda_probe_s *info);
+void gdb_if_set_port(uint16_t port);
+/* Wait up to timeout milliseconds for something from GDB, returning as soon as it arrives */
+bool gdb_if_wait_ready(uint32_t timeout);
+/* Queue data up to be read back by gdb_if_getchar() as though GDB had sent it, used to benchmark the packet code */
+void gdb_if_replay(const char *data, size_t length);
+#if !defined(_WIN32) && !defined(__CYGWIN__)
+/* Listen for GDB on a Unix domain socket at the given path instead of on TCP */
+void gdb_if_set_unix_socket(const char *path);
+#endif
 void libusb_exit_function(bmda_probe_s *info);
 
 #if HOSTED_BMP_ONLY == 1
 bool device_is_bmp_gdb_port(const char *device);
 #else
+size_t list_debugger_serials(char ***serials);
 int bmda_usb_transfer(
 	usb_link_s *link, const void *tx_buffer, size_t tx_len, void *rx_buffer, size_t rx_len, uint16_t timeout);
+
+typedef struct bmda_usb_request {
+	const void *tx_buffer;
+	size_t tx_len;
+	void *rx_buffer;
+	size_t rx_len;
+	int result; /* The number of bytes received, or a libusb error code */
+} bmda_usb_request_s;
+
+int bmda_usb_transfer_pipelined(
+	usb_link_s *link, bmda_usb_request_s *requests, size_t count, size_t depth, uint16_t timeout);
 #endif
 
 #endif /* PLATFORMS_HOSTED_BMP_HOSTED_H */
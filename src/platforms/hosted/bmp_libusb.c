@@ -385,6 +385,30 @@ static void process_cmsis_interface(const libusb_device_descriptor_s *const devi
 		device_descriptor->idProduct, manufacturer, product, serial, version);
 }
 
+/*
+ * Check if an interface could be CMSIS-DAP from its descriptor alone: v1 interfaces are HID, v2 interfaces
+ * vendor-specific with 2 or 3 endpoints, and both must have a description string saying they're CMSIS-DAP
+ */
+static bool cmsis_interface_candidate(const libusb_interface_descriptor_s *const descriptor)
+{
+	return descriptor->iInterface != 0U &&
+		(descriptor->bInterfaceClass == LIBUSB_CLASS_HID ||
+			(descriptor->bInterfaceClass == LIBUSB_CLASS_VENDOR_SPEC &&
+				(descriptor->bNumEndpoints == 2U || descriptor->bNumEndpoints == 3U)));
+}
+
+static bool cmsis_config_candidate(const libusb_config_descriptor_s *const config)
+{
+	for (uint8_t iface = 0; iface < config->bNumInterfaces; ++iface) {
+		const libusb_interface_s *interface = &config->interface[iface];
+		for (int altmode = 0; altmode < interface->num_altsetting; ++altmode) {
+			if (cmsis_interface_candidate(&interface->altsetting[altmode]))
+				return true;
+		}
+	}
+	return false;
+}
+
 static bool process_cmsis_interface_probe(
 	libusb_device_descriptor_s *device_descriptor, libusb_device *device, probe_info_s **probe_list, bmda_probe_s *info)
 {
@@ -394,6 +418,15 @@ static bool process_cmsis_interface_probe(
 	if (libusb_get_active_config_descriptor(device, &config) != LIBUSB_SUCCESS)
 		return false;
 
+	/*
+	 * libusb keeps the descriptors cached, so checking them costs no USB traffic. Opening a device and reading
+	 * its strings does, so only do that for devices with an interface that could be CMSIS-DAP
+	 */
+	if (!cmsis_config_candidate(config)) {
+		libusb_free_config_descriptor(config);
+		return false;
+	}
+
 	/* Try to open the device */
 	libusb_device_handle *handle;
 	if (libusb_open(device, &handle) != LIBUSB_SUCCESS) {
@@ -408,8 +441,8 @@ static bool process_cmsis_interface_probe(
 		for (int altmode = 0; altmode < interface->num_altsetting; ++altmode) {
 			const libusb_interface_descriptor_s *descriptor = &interface->altsetting[altmode];
 			uint8_t string_index = descriptor->iInterface;
-			/* If we've found an interface without a description string, ignore it */
-			if (string_index == 0)
+			/* If we've found an interface that can't be CMSIS-DAP, ignore it */
+			if (!cmsis_interface_candidate(descriptor))
 				continue;
 			char interface_string[128];
 			/* Read out the string */
@@ -467,16 +500,24 @@ static void check_cmsis_interface_type(libusb_device *const device, bmda_probe_s
 			for (uint8_t index = 0; index < descriptor->bNumEndpoints; ++index)
 				info->max_packet_length = MIN(descriptor->endpoint[index].wMaxPacketSize, info->max_packet_length);
 
-			/* Check if it's a CMSIS-DAP v2 interface */
-			if (descriptor->bInterfaceClass == 0xffU && descriptor->bNumEndpoints == 2U) {
+			/*
+			 * Check if it's a CMSIS-DAP v2 interface. These have the command OUT and response IN endpoints,
+			 * in that order, optionally followed by a second IN endpoint for streaming SWO data
+			 */
+			if (descriptor->bInterfaceClass == 0xffU &&
+				(descriptor->bNumEndpoints == 2U || descriptor->bNumEndpoints == 3U)) {
 				info->interface_num = descriptor->bInterfaceNumber;
+				info->in_ep = 0U;
+				info->swo_ep = 0U;
 				/* Extract the endpoints required */
 				for (uint8_t index = 0; index < descriptor->bNumEndpoints; ++index) {
 					const uint8_t ep = descriptor->endpoint[index].bEndpointAddress;
-					if (ep & 0x80U)
+					if (!(ep & 0x80U))
+						info->out_ep = ep;
+					else if (!info->in_ep)
 						info->in_ep = ep;
 					else
-						info->out_ep = ep;
+						info->swo_ep = ep;
 				}
 				/* If we've found a CMSIS-DAP v2 interface, look no further - we want to prefer these to v1. */
 				break;
@@ -558,6 +599,9 @@ static const probe_info_s *scan_for_devices(bmda_probe_s *info)
 			DEBUG_ERROR("Failed to get device descriptor (%d): %s\n", result, libusb_error_name(result));
 			return NULL;
 		}
+		/* Hubs can never be probes, and there tend to be a lot of them */
+		if (device_descriptor.bDeviceClass == LIBUSB_CLASS_HUB)
+			continue;
 		if (device_descriptor.idVendor != VENDOR_ID_FTDI || !skip_ftdi) {
 			if (!process_vid_pid_table_probe(&device_descriptor, device, &probe_list))
 				process_cmsis_interface_probe(&device_descriptor, device, &probe_list, info);
@@ -567,6 +611,34 @@ static const probe_info_s *scan_for_devices(bmda_probe_s *info)
 	return probe_info_correct_order(probe_list);
 }
 
+/*
+ * List the serial numbers of the probes attached to the system, in the order that positions refer to them,
+ * leaving libusb as it was found. Returns how many probes there are, the caller frees the serial numbers.
+ */
+size_t list_debugger_serials(char ***const serials)
+{
+	bmda_probe_s info = {0};
+	const int result = libusb_init(&info.libusb_ctx);
+	if (result != LIBUSB_SUCCESS) {
+		DEBUG_ERROR("Failed to initialise libusb (%d): %s\n", result, libusb_error_name(result));
+		return 0U;
+	}
+	const probe_info_s *const probe_list = scan_for_devices(&info);
+	size_t probes = probe_info_count(probe_list);
+	*serials = calloc(probes ? probes : 1U, sizeof(**serials));
+	if (!*serials) { /* calloc failed: heap exhaustion */
+		DEBUG_ERROR("calloc: failed in %s\n", __func__);
+		probes = 0U;
+	} else {
+		size_t idx = 0U;
+		for (const probe_info_s *probe = probe_list; probe; probe = probe->next, ++idx)
+			(*serials)[idx] = strdup(probe->serial ? probe->serial : "");
+	}
+	probe_info_list_free(probe_list);
+	libusb_exit(info.libusb_ctx);
+	return probes;
+}
+
 bool find_debuggers(bmda_cli_options_s *cl_opts, bmda_probe_s *info)
 {
 	if (cl_opts->opt_device)
@@ -691,3 +763,167 @@ int bmda_usb_transfer(
 	}
 	return LIBUSB_SUCCESS;
 }
+
+typedef struct bmda_usb_pipeline_slot {
+	struct libusb_transfer *tx;
+	struct libusb_transfer *rx;
+	bool tx_busy;
+	bool rx_busy;
+	size_t request;
+} bmda_usb_pipeline_slot_s;
+
+static void LIBUSB_CALL bmda_usb_pipeline_callback(struct libusb_transfer *const transfer)
+{
+	/* Mark the transfer as no longer in flight so the engine can pick up its result */
+	bool *const busy = (bool *)transfer->user_data;
+	*busy = false;
+}
+
+static bool bmda_usb_pipeline_submit(
+	usb_link_s *const link, bmda_usb_pipeline_slot_s *const slot, bmda_usb_request_s *const request, uint16_t timeout)
+{
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wcast-qual"
+	if (request->tx_len) {
+		libusb_fill_bulk_transfer(slot->tx, link->device_handle, link->ep_tx | LIBUSB_ENDPOINT_OUT,
+			(uint8_t *)request->tx_buffer, (int)request->tx_len, bmda_usb_pipeline_callback, &slot->tx_busy, timeout);
+		slot->tx_busy = true;
+		const int result = libusb_submit_transfer(slot->tx);
+		if (result != LIBUSB_SUCCESS) {
+			slot->tx_busy = false;
+			request->result = result;
+			return false;
+		}
+	}
+#pragma GCC diagnostic pop
+	if (request->rx_len) {
+		libusb_fill_bulk_transfer(slot->rx, link->device_handle, link->ep_rx | LIBUSB_ENDPOINT_IN,
+			(uint8_t *)request->rx_buffer, (int)request->rx_len, bmda_usb_pipeline_callback, &slot->rx_busy, timeout);
+		slot->rx_busy = true;
+		const int result = libusb_submit_transfer(slot->rx);
+		if (result != LIBUSB_SUCCESS) {
+			slot->rx_busy = false;
+			request->result = result;
+			return false;
+		}
+	}
+	return true;
+}
+
+static int bmda_usb_pipeline_status(const struct libusb_transfer *const transfer)
+{
+	switch (transfer->status) {
+	case LIBUSB_TRANSFER_COMPLETED:
+		return LIBUSB_SUCCESS;
+	case LIBUSB_TRANSFER_TIMED_OUT:
+		return LIBUSB_ERROR_TIMEOUT;
+	case LIBUSB_TRANSFER_STALL:
+		return LIBUSB_ERROR_PIPE;
+	case LIBUSB_TRANSFER_NO_DEVICE:
+		return LIBUSB_ERROR_NO_DEVICE;
+	case LIBUSB_TRANSFER_OVERFLOW:
+		return LIBUSB_ERROR_OVERFLOW;
+	default:
+		return LIBUSB_ERROR_IO;
+	}
+}
+
+/*
+ * Run a sequence of independent request/response exchanges with the debug adaptor, keeping up to
+ * depth of them in flight at once using libusb's asynchronous API.
+ *
+ * The adaptor must process requests strictly in order, as responses are matched up to requests by position.
+ * Each request's result member is filled in as for bmda_usb_transfer(). The return value is LIBUSB_SUCCESS
+ * if every exchange completed, or the libusb error code of the first one that didn't, in which case the
+ * remaining exchanges are cancelled and their results left as LIBUSB_ERROR_OTHER.
+ */
+int bmda_usb_transfer_pipelined(usb_link_s *const link, bmda_usb_request_s *const requests, const size_t count,
+	const size_t depth, const uint16_t timeout)
+{
+	const size_t slot_count = MAX(MIN(depth, count), 1U);
+	bmda_usb_pipeline_slot_s *const slots = calloc(slot_count, sizeof(*slots));
+	if (!slots) { /* calloc failed: heap exhaustion */
+		DEBUG_ERROR("calloc: failed in %s\n", __func__);
+		return LIBUSB_ERROR_NO_MEM;
+	}
+
+	int status = LIBUSB_SUCCESS;
+	for (size_t idx = 0; idx < slot_count; ++idx) {
+		slots[idx].tx = libusb_alloc_transfer(0);
+		slots[idx].rx = libusb_alloc_transfer(0);
+		if (!slots[idx].tx || !slots[idx].rx)
+			status = LIBUSB_ERROR_NO_MEM;
+	}
+	for (size_t idx = 0; idx < count; ++idx)
+		requests[idx].result = LIBUSB_ERROR_OTHER;
+
+	/* Fill the pipeline */
+	size_t submitted = 0;
+	for (; status == LIBUSB_SUCCESS && submitted < slot_count; ++submitted) {
+		slots[submitted].request = submitted;
+		if (!bmda_usb_pipeline_submit(link, &slots[submitted], &requests[submitted], timeout))
+			status = requests[submitted].result;
+	}
+
+	/* Now retire requests in order, refilling each slot as its request completes */
+	size_t completed = 0;
+	while (status == LIBUSB_SUCCESS && completed < count) {
+		bmda_usb_pipeline_slot_s *const slot = &slots[completed % slot_count];
+		if (slot->tx_busy || slot->rx_busy) {
+			const int result = libusb_handle_events(link->context);
+			if (result != LIBUSB_SUCCESS && result != LIBUSB_ERROR_INTERRUPTED)
+				status = result;
+			continue;
+		}
+
+		bmda_usb_request_s *const request = &requests[slot->request];
+		if (request->tx_len && (request->result = bmda_usb_pipeline_status(slot->tx)) != LIBUSB_SUCCESS) {
+			DEBUG_ERROR("%s: Sending request to adaptor failed (%d): %s\n", __func__, request->result,
+				libusb_error_name(request->result));
+			status = request->result;
+			break;
+		}
+		if (request->rx_len) {
+			if ((request->result = bmda_usb_pipeline_status(slot->rx)) != LIBUSB_SUCCESS) {
+				DEBUG_ERROR("%s: Receiving response from adaptor failed (%d): %s\n", __func__, request->result,
+					libusb_error_name(request->result));
+				status = request->result;
+				break;
+			}
+			request->result = slot->rx->actual_length;
+		} else
+			request->result = LIBUSB_SUCCESS;
+		++completed;
+
+		if (submitted < count) {
+			slot->request = submitted;
+			if (!bmda_usb_pipeline_submit(link, slot, &requests[submitted], timeout))
+				status = requests[submitted].result;
+			++submitted;
+		}
+	}
+
+	/* If something went wrong, cancel whatever is still in flight and wait for it to drain */
+	for (size_t idx = 0; idx < slot_count; ++idx) {
+		if (slots[idx].tx_busy)
+			libusb_cancel_transfer(slots[idx].tx);
+		if (slots[idx].rx_busy)
+			libusb_cancel_transfer(slots[idx].rx);
+	}
+	for (size_t idx = 0; idx < slot_count; ++idx) {
+		while (slots[idx].tx_busy || slots[idx].rx_busy) {
+			const int result = libusb_handle_events(link->context);
+			if (result != LIBUSB_SUCCESS && result != LIBUSB_ERROR_INTERRUPTED)
+				break;
+		}
+		libusb_free_transfer(slots[idx].tx);
+		libusb_free_transfer(slots[idx].rx);
+	}
+	free(slots);
+
+	if (status == LIBUSB_ERROR_PIPE) {
+		libusb_clear_halt(link->device_handle, link->ep_tx | LIBUSB_ENDPOINT_OUT);
+		libusb_clear_halt(link->device_handle, link->ep_rx | LIBUSB_ENDPOINT_IN);
+	}
+	return status;
+}
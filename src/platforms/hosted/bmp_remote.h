@@ -43,12 +43,16 @@ typedef struct bmp_remote_protocol {
 	uint32_t (*get_comms_frequency)(void);
 	bool (*set_comms_frequency)(uint32_t freq);
 	void (*target_clk_output_enable)(bool enable);
+	void (*flash_offload_setup)(bool jtag, uint32_t targetid);
+	/* What the probe said it can accelerate, for the later protocol versions to build on */
+	uint64_t accelerations;
 } bmp_remote_protocol_s;
 
 extern bmp_remote_protocol_s remote_funcs;
 
 bool platform_buffer_write(const void *data, size_t size);
 int platform_buffer_read(void *data, size_t size);
+int platform_buffer_read_binary(void *data, size_t size);
 
 bool remote_init(bool power_up);
 bool remote_swd_init(void);
@@ -66,6 +70,8 @@ void remote_adiv5_dp_init(adiv5_debug_port_s *dp);
 void remote_adiv6_dp_init(adiv5_debug_port_s *dp);
 void remote_riscv_jtag_dtm_init(riscv_dmi_s *dmi);
 void remote_add_jtag_dev(uint32_t dev_index, const jtag_dev_s *jtag_dev);
+/* Let the probe do the Flashing for the targets just found by a scan of the given kind, if it can */
+void remote_flash_offload_setup(bool jtag, uint32_t targetid);
 
 uint64_t remote_decode_response(const char *response, size_t digits);
 
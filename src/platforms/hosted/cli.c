@@ -39,6 +39,7 @@
 #endif
 #else
 #include <sys/mman.h>
+#include <pthread.h>
 #define O_BINARY         0
 #define BMDA_NORMAL_MODE S_IRUSR | S_IWUSR
 #endif
@@ -49,6 +50,15 @@
 #include "command.h"
 #include "cli.h"
 #include "bmp_hosted.h"
+#include "buffer_utils.h"
+#include "image.h"
+#include "crc32.h"
+#include "bench.h"
+#include "coredump.h"
+#ifdef ENABLE_RTT
+#include "rtt.h"
+#include "rtt_if.h"
+#endif
 
 typedef struct option getopt_option_s;
 
@@ -131,22 +141,85 @@ static void bmp_munmap(mmap_data_s *map)
 
 #ifdef ENABLE_GPIOD
 #define GPIOD_PROBE_SELECTION " | -g GPIO_MAPPING"
-#define GPIOD_PROBE_SELECTION_HELP                                          \
-	"\t-g, --gpiod      Use gpiod backend using given gpios specified as\n" \
-	"\t                   <signal>=<gpiochip>:<offset> separated by commas\n"
+#define GPIOD_PROBE_SELECTION_HELP                                                   \
+	"\t-g, --gpiod      Use gpiod backend using given gpios specified as\n"          \
+	"\t                   <signal>=<gpiochip>:<offset> separated by commas.\n"       \
+	"\t                   Adding mmio=bcm2711 or mmio=rp1 drives the pins through\n" \
+	"\t                   the Raspberry Pi SoC's memory mapped GPIO registers\n"
 #else
 #define GPIOD_PROBE_SELECTION
 #define GPIOD_PROBE_SELECTION_HELP
 #endif
 
+#if HOSTED_BMP_ONLY == 0 && !defined(_WIN32) && !defined(__CYGWIN__)
+#define ALL_PROBES_SELECTION " | -N"
+#define ALL_PROBES_SELECTION_HELP                                                  \
+	"\t-N, --all-probes Serve every probe found at once, each from its own\n"      \
+	"\t                   worker process with GDB on port 2000 + position - 1.\n"  \
+	"\t                   With a Flash operation (also as --gang), this does it\n" \
+	"\t                   to all the boards in parallel and reports on each\n"
+#define ALL_PROBES_ARG_STR "N"
+#else
+#define ALL_PROBES_SELECTION
+#define ALL_PROBES_SELECTION_HELP
+#define ALL_PROBES_ARG_STR
+#endif
+
+#if defined(ENABLE_RTT) && !defined(_WIN32)
+#define RTT_PORT_HELP                                                                \
+	"\t-X, --rtt-port   Serve RTT channel N on TCP port PORT + N instead, up channel\n" \
+	"\t                   data going to the client there and its input to the down\n"   \
+	"\t                   channel. This also applies while serving GDB\n"
+#define RTT_PORT_ARG_STR "X:"
+#else
+#define RTT_PORT_HELP
+#define RTT_PORT_ARG_STR
+#endif
+
+#ifdef ENABLE_RTT
+#define RTT_STREAM_SELECTION " | -x[FILE]"
+#define RTT_STREAM_HELP                                                             \
+	"RTT streaming options [-x[FILE]] [-X PORT]:\n"                                 \
+	"\t-x, --rtt        Attach without GDB, let the target run and stream its\n"    \
+	"\t                   RTT up channels until aborted by ^C. Channel 0 goes to\n" \
+	"\t                   FILE (or stdout if not given) and channel N to FILE.N\n"  \
+	RTT_PORT_HELP                                                                 \
+	"\n"
+#else
+#define RTT_STREAM_SELECTION
+#define RTT_STREAM_HELP
+#endif
+
+#if !defined(_WIN32) && !defined(__CYGWIN__)
+#define UNIX_SOCKET_HELP                                                           \
+	"\t-U, --unix-socket Serve GDB on a Unix domain socket at the given path\n"   \
+	"\t                   instead of on TCP, for a GDB running on the same machine\n"
+#define UNIX_SOCKET_ARG_STR "U:"
+#else
+#define UNIX_SOCKET_HELP
+#define UNIX_SOCKET_ARG_STR
+#endif
+
+#ifndef _WIN32
+#define OBSERVER_PORT_HELP                                                           \
+	"\t-Y, --observer-port Also serve read-only observers on TCP port PORT, which\n" \
+	"\t                   can read memory, watch addresses and tap RTT alongside\n"  \
+	"\t                   the GDB session but not control the target\n"
+#define OBSERVER_PORT_ARG_STR "Y:"
+#else
+#define OBSERVER_PORT_HELP
+#define OBSERVER_PORT_ARG_STR
+#endif
+
 static void cl_help(char **argv)
 {
 	bmp_ident(NULL);
 	/* clang-format off */
 	DEBUG_INFO("\n"
 			   "Usage: %s [-h | -l | [-v BITMASK] [-O] [-d PATH | -P NUMBER | -s SERIAL | -c TYPE]\n"
-			   "\t[-n NUMBER] [-j | -A] [-C] [-t | -T] [-e] [-p] [-R[h]] [-H] [-M STRING ...]\n"
-			   "\t[-f | -m] [-E | -w | -V | -r] [-a ADDR] [-S number] [file]]\n"
+			   "\t[-n NUMBER] [-j | -A] [-C] [-G] [-t | -T] [-e] [-p] [-R[h]] [-H] [-M STRING ...]\n"
+			   "\t[-f | -m] [-E | -w | -V | -r | -o[MS] | -B[flash|codec] | -K[REGIONS]\n"
+			   "\t| -W FILE" RTT_STREAM_SELECTION "] [-a ADDR] [-S number] [-b number] [file]]\n"
 			   "\n"
 			   "The default is to start a debug server at localhost:2000\n\n"
 			   "Single-shot and verbosity options [-h | -l | -v BITMASK]:\n"
@@ -157,7 +230,8 @@ static void cl_help(char **argv)
 			   "\t-O, --no-stdout  Don't use stdout for debugging output, making it available\n"
 			   "\t                   for use by RTT, Semihosting, or other target output\n"
 			   "\n"
-			   "Probe selection arguments [-d PATH | -P NUMBER | -s SERIAL | -c TYPE" GPIOD_PROBE_SELECTION "]:\n"
+			   "Probe selection arguments [-d PATH | -P NUMBER | -s SERIAL | -c TYPE" GPIOD_PROBE_SELECTION
+			   ALL_PROBES_SELECTION " | -Z[US]]:\n"
 			   "\t-d, --device     Use a serial device at the given path\n"
 			   "\t-P, --probe      Use the <number>th debug probe found while scanning the\n"
 			   "\t                   system, see the output from list for the order\n"
@@ -165,6 +239,10 @@ static void cl_help(char **argv)
 			   "\t-c, --ftdi-type  Select the FTDI-based debug probe with of the given\n"
 			   "\t                   type (cable)\n"
 			   GPIOD_PROBE_SELECTION_HELP
+			   ALL_PROBES_SELECTION_HELP
+			   "\t-Z, --sim        Use a simulated probe and nRF51 target in place of any\n"
+			   "\t                   hardware, with each access taking US microseconds (0 if\n"
+			   "\t                   not given), for measuring BMDA's own overhead\n"
 			   "\n"
 			   "General configuration options: [-n NUMBER] [-j] [-C] [-t | -T] [-e] [-p] [-R[h]]\n"
 			   "\t\t[-H] [-M STRING ...]\n"
@@ -175,6 +253,10 @@ static void cl_help(char **argv)
 			   "\t-C, --hw-reset   Connect to target under hardware reset\n"
 			   "\t-F, --fast-poll  Poll the target for execution status at maximum speed at\n"
 			   "\t                  the expense of increased CPU and USB resource utilisation.\n"
+			   "\t-G, --persist    Keep the scan results and stay attached to the target from\n"
+			   "\t                   one GDB connection to the next, scanning and attaching for\n"
+			   "\t                   the first connection to need it. Powering the target off\n"
+			   "\t                   with 'monitor tpwr' drops the scan results\n"
 			   "\t-t, --list-chain Perform a chain scan and display information about the\n"
 			   "\t                   connected devices\n"
 			   "\t-T, --timing     Perform continues read- or write-back of a value to allow\n"
@@ -190,6 +272,10 @@ static void cl_help(char **argv)
 			   "\t                   If the command contains spaces, use quotes around the\n"
 			   "\t                   complete command\n"
 			   "\t-f, --freq       Set an operating frequency for the debug interface\n"
+			   "\t-u, --swo-file   Write the raw SWO data captured by 'monitor swo enable'\n"
+			   "\t                   to FILE, when not decoding it\n"
+			   UNIX_SOCKET_HELP
+			   OBSERVER_PORT_HELP
 			   "\n"
 			   "SWD-specific configuration options [-f FREQUENCY | -m TARGET]:\n"
 			   "\t-m, --multi-drop  Use the given target ID for selection in SWD multi-drop\n"
@@ -199,14 +285,49 @@ static void cl_help(char **argv)
 			   "\t-w, --write      Write the specified binary file to the target device\n"
 			   "\t                   Flash (the default)\n"
 			   "\t-V, --verify     Verify the target device Flash against the specified\n"
-			   "\t                   binary file\n"
+			   "\t                   binary file, comparing CRCs computed on the target and\n"
+			   "\t                   only reading back the sectors that differ\n"
 			   "\t-r, --read       Read the target device Flash\n"
 			   "\n"
-			   "Flash operation modifiers options: [-a ADDR] [-S number] [FILE]\n"
+			   "Profiling options [-o[MS]] [FILE]:\n"
+			   "\t-o, --profile    Attach without GDB, let the target run for MS milliseconds\n"
+			   "\t                   (10000 if not given) sampling its PC, then write the\n"
+			   "\t                   samples to FILE (or gmon.out) as a gprof histogram\n"
+			   "\n"
+			   "Benchmarking options [-B[flash|codec]]:\n"
+			   "\t-B, --bench      Attach without GDB and measure link and target access\n"
+			   "\t                   performance, one 'bench' line per result. If followed by\n"
+			   "\t                   'flash', also erase and rewrite the end of Flash to time it.\n"
+			   "\t                   If followed by 'codec', don't look for a probe and instead\n"
+			   "\t                   time BMDA's own packet encoding and decoding\n"
+			   "\n"
+			   "Core dump options [-K[REGIONS]] [FILE]:\n"
+			   "\t-K, --dump-core  Attach without GDB and write the halted target's registers,\n"
+			   "\t                   RAM and any extra REGIONS (ADDR:LENGTH[,ADDR:LENGTH...])\n"
+			   "\t                   to FILE (or core) as an ELF core file for loading into GDB\n"
+			   "\n"
+			   "Script options [-W FILE]:\n"
+			   "\t-W, --script     Attach without GDB and run the commands in FILE, one per\n"
+			   "\t                   line, stopping at the first that fails. 'erase [ADDR LEN]',\n"
+			   "\t                   'write FILE [ADDR]', 'verify FILE [ADDR]', 'reset' and\n"
+			   "\t                   'delay MS' are done directly, anything else is run as a\n"
+			   "\t                   monitor command. Flash mode is entered once for the lot\n"
+			   "\n"
+			   "Tracing options [-L FILE]:\n"
+			   "\t-L, --trace      Record every DP, AP, memory and JTAG transaction and write\n"
+			   "\t                   them to FILE on exit, in Chrome trace (Perfetto) format if\n"
+			   "\t                   FILE ends in .json and as binary records otherwise\n"
+			   "\n"
+			   RTT_STREAM_HELP
+			   "Flash operation modifiers options: [-a ADDR] [-S number] [-D] [-b number] [FILE]\n"
 			   "\t-a, --addr       Start address for the given Flash operation (defaults to\n"
 			   "\t                   the start of Flash)\n"
 			   "\t-S, --byte-count Number of bytes to work on in the Flash operation (default\n"
 			   "\t                   is till the operation fails or is complete)\n"
+			   "\t-D, --differential Only erase and write Flash blocks whose contents differ\n"
+			   "\t                   from the file being written\n"
+			   "\t-b, --read-size  Number of bytes to request from the target at a time when\n"
+			   "\t                   reading Flash (default 64k)\n"
 			   "\t<file>           Binary file to use in Flash operations\n",
 		argv[0]);
 	/* clang-format on */
@@ -220,9 +341,14 @@ static const getopt_option_s long_options[] = {
 	{"no-stdout", no_argument, NULL, 'O'},
 	{"device", required_argument, NULL, 'd'},
 	{"probe", required_argument, NULL, 'P'},
+#if HOSTED_BMP_ONLY == 0 && !defined(_WIN32) && !defined(__CYGWIN__)
+	{"all-probes", no_argument, NULL, 'N'},
+	{"gang", no_argument, NULL, 'N'},
+#endif
 	{"serial", required_argument, NULL, 's'},
 	{"ftdi-type", required_argument, NULL, 'c'},
 	{"fast-poll", no_argument, NULL, 'F'},
+	{"persist", no_argument, NULL, 'G'},
 	{"number", required_argument, NULL, 'n'},
 	{"jtag", no_argument, NULL, 'j'},
 	{"auto-scan", no_argument, NULL, 'A'},
@@ -242,10 +368,31 @@ static const getopt_option_s long_options[] = {
 	{"read", no_argument, NULL, 'r'},
 	{"addr", required_argument, NULL, 'a'},
 	{"byte-count", required_argument, NULL, 'S'},
+	{"read-size", required_argument, NULL, 'b'},
+	{"differential", no_argument, NULL, 'D'},
+	{"profile", optional_argument, NULL, 'o'},
+	{"bench", optional_argument, NULL, 'B'},
+	{"dump-core", optional_argument, NULL, 'K'},
+	{"script", required_argument, NULL, 'W'},
+	{"trace", required_argument, NULL, 'L'},
+	{"swo-file", required_argument, NULL, 'u'},
+#if !defined(_WIN32) && !defined(__CYGWIN__)
+	{"unix-socket", required_argument, NULL, 'U'},
+#endif
+#ifndef _WIN32
+	{"observer-port", required_argument, NULL, 'Y'},
+#endif
 #ifdef ENABLE_GPIOD
 	{"gpiod", required_argument, NULL, 'g'},
 #endif
 	{"allow-fallback", no_argument, NULL, 'k'},
+	{"sim", optional_argument, NULL, 'Z'},
+#ifdef ENABLE_RTT
+	{"rtt", optional_argument, NULL, 'x'},
+#ifndef _WIN32
+	{"rtt-port", required_argument, NULL, 'X'},
+#endif
+#endif
 	{NULL, 0, NULL, 0},
 };
 
@@ -255,17 +402,46 @@ static const getopt_option_s long_options[] = {
 #define GPIOD_ARG_STR
 #endif
 
+#ifdef ENABLE_RTT
+#define RTT_ARG_STR "x::"
+#else
+#define RTT_ARG_STR
+#endif
+
+/* Parse a byte count, allowing a k or M suffix for kiB and MiB */
+static size_t cl_parse_size(const char *const arg)
+{
+	char *endptr;
+	size_t size = strtol(arg, &endptr, 0);
+	if (endptr) {
+		switch (endptr[0]) {
+		case 'k':
+		case 'K':
+			size *= 1024U;
+			break;
+		case 'm':
+		case 'M':
+			size *= 1024U * 1024U;
+			break;
+		}
+	}
+	return size;
+}
+
 void cl_init(bmda_cli_options_s *opt, int argc, char **argv)
 {
 	opt->opt_target_dev = 1;
 	opt->opt_flash_size = 0xffffffff;
 	opt->opt_flash_start = 0xffffffff;
+	opt->opt_read_size = CL_READ_SIZE_DEFAULT;
 	opt->opt_max_frequency = 0;
 	opt->opt_scanmode = BMP_SCAN_SWD;
 	opt->opt_mode = BMP_MODE_DEBUG;
 	while (true) {
-		const int option =
-			getopt_long(argc, argv, "eEFhHv:Od:f:s:I:c:Cln:m:M:wVtTa:S:jApP:rR::k" GPIOD_ARG_STR, long_options, NULL);
+		const int option = getopt_long(argc, argv,
+			"eEFGhHv:Od:Df:s:I:c:Cln:m:M:wVtTa:S:b:jApP:rR::ko::B::K::W:L:u:Z::" GPIOD_ARG_STR RTT_ARG_STR
+				ALL_PROBES_ARG_STR UNIX_SOCKET_ARG_STR RTT_PORT_ARG_STR OBSERVER_PORT_ARG_STR,
+			long_options, NULL);
 		if (option == -1)
 			break;
 
@@ -322,6 +498,9 @@ void cl_init(bmda_cli_options_s *opt, int argc, char **argv)
 		case 'F':
 			opt->fast_poll = true;
 			break;
+		case 'G':
+			opt->opt_persist = true;
+			break;
 		case 'f':
 			if (optarg) {
 				char *p;
@@ -399,23 +578,16 @@ void cl_init(bmda_cli_options_s *opt, int argc, char **argv)
 			if (optarg)
 				opt->opt_position = strtol(optarg, NULL, 0);
 			break;
+		case 'N':
+			opt->opt_all_probes = true;
+			break;
 		case 'S':
-			if (optarg) {
-				char *endptr;
-				opt->opt_flash_size = strtol(optarg, &endptr, 0);
-				if (endptr) {
-					switch (endptr[0]) {
-					case 'k':
-					case 'K':
-						opt->opt_flash_size *= 1024U;
-						break;
-					case 'm':
-					case 'M':
-						opt->opt_flash_size *= 1024U * 1024U;
-						break;
-					}
-				}
-			}
+			if (optarg)
+				opt->opt_flash_size = cl_parse_size(optarg);
+			break;
+		case 'b':
+			if (optarg)
+				opt->opt_read_size = cl_parse_size(optarg);
 			break;
 #ifdef ENABLE_GPIOD
 		case 'g':
@@ -426,6 +598,56 @@ void cl_init(bmda_cli_options_s *opt, int argc, char **argv)
 		case 'k':
 			opt->opt_cmsisdap_allow_fallback = true;
 			break;
+		case 'Z':
+			opt->opt_sim = true;
+			opt->opt_sim_latency_us = optarg ? strtoul(optarg, NULL, 0) : 0U;
+			break;
+		case 'D':
+			opt->opt_flash_differential = true;
+			break;
+		case 'o':
+			opt->opt_mode = BMP_MODE_PROFILE;
+			opt->opt_profile_ms = optarg ? strtoul(optarg, NULL, 0) : 10000U;
+			break;
+		case 'B':
+			opt->opt_mode = BMP_MODE_BENCH;
+			opt->opt_bench_flash = optarg && strcmp(optarg, "flash") == 0;
+			opt->opt_bench_codec = optarg && strcmp(optarg, "codec") == 0;
+			break;
+		case 'K':
+			opt->opt_mode = BMP_MODE_CORE_DUMP;
+			opt->opt_core_regions = optarg;
+			break;
+		case 'W':
+			opt->opt_mode = BMP_MODE_SCRIPT;
+			opt->opt_script_file = optarg;
+			break;
+		case 'L':
+			if (optarg)
+				opt->opt_trace_file = optarg;
+			break;
+		case 'U':
+			if (optarg)
+				opt->opt_gdb_socket = optarg;
+			break;
+		case 'Y':
+			if (optarg)
+				opt->opt_observer_port = (uint16_t)strtoul(optarg, NULL, 0);
+			break;
+		case 'u':
+			if (optarg)
+				opt->opt_swo_file = optarg;
+			break;
+#ifdef ENABLE_RTT
+		case 'x':
+			opt->opt_mode = BMP_MODE_RTT;
+			opt->opt_rtt_output = optarg;
+			break;
+		case 'X':
+			if (optarg)
+				opt->opt_rtt_port = (uint16_t)strtoul(optarg, NULL, 0);
+			break;
+#endif
 		}
 	}
 	if (optind && argv[optind]) {
@@ -438,8 +660,8 @@ void cl_init(bmda_cli_options_s *opt, int argc, char **argv)
 	/* Checks */
 	if (opt->opt_flash_file &&
 		(opt->opt_mode == BMP_MODE_TEST || opt->opt_mode == BMP_MODE_SWJ_TEST || opt->opt_mode == BMP_MODE_RESET ||
-			opt->opt_mode == BMP_MODE_RESET_HW)) {
-		DEBUG_WARN("Ignoring filename in reset/test mode\n");
+			opt->opt_mode == BMP_MODE_RESET_HW || opt->opt_mode == BMP_MODE_SCRIPT)) {
+		DEBUG_WARN("Ignoring filename in reset/test/script mode\n");
 		opt->opt_flash_file = NULL;
 	}
 }
@@ -471,6 +693,624 @@ bool scan_for_targets(const bmda_cli_options_s *const opt)
 	return false;
 }
 
+#ifdef ENABLE_RTT
+/*
+ * Stream RTT from a running target without a GDB session. With nothing else to service,
+ * this loop just polls as often as poll_rtt()'s scheduling allows, until aborted by ^C.
+ */
+static int cl_rtt_stream(target_s *const target, const bmda_cli_options_s *const opt)
+{
+	if (!rtt_if_set_output(opt->opt_rtt_output))
+		return -1;
+#ifndef _WIN32
+	rtt_if_set_port(opt->opt_rtt_port);
+#endif
+	rtt_if_init();
+	rtt_enabled = true;
+	rtt_found = false;
+	/* Let the polling rate go as high as the data needs */
+	rtt_min_poll_ms = 1U;
+
+	if (!opt->opt_rtt_port)
+		DEBUG_WARN("Streaming RTT to %s. Abort with ^C\n", opt->opt_rtt_output ? opt->opt_rtt_output : "stdout");
+	target_halt_resume(target, false);
+	while (rtt_enabled) {
+		poll_rtt(target);
+		platform_delay(1U);
+	}
+	DEBUG_ERROR("RTT lost, stopping\n");
+	return -1;
+}
+#endif
+
+typedef struct cl_profile {
+	uint32_t *samples;
+	size_t count;
+	size_t size;
+} cl_profile_s;
+
+/* The histogram is kept to at most this many bins, doubling the bin size until the sampled range fits */
+#define CL_PROFILE_MAX_BINS (1U << 20U)
+/* gmon.out header, followed by the GMON_TAG_TIME_HIST tag and the histogram record header */
+#define CL_PROFILE_HEADER_SIZE 53U
+
+static void cl_profile_sample(void *const ctx, const uint32_t pc)
+{
+	cl_profile_s *const profile = ctx;
+	if (profile->count == profile->size) {
+		const size_t size = profile->size ? profile->size * 2U : 4096U;
+		uint32_t *const samples = realloc(profile->samples, size * sizeof(*samples));
+		if (!samples) /* realloc failed: heap exhaustion, drop the sample */
+			return;
+		profile->samples = samples;
+		profile->size = size;
+	}
+	profile->samples[profile->count++] = pc;
+}
+
+static bool cl_profile_write(const char *const file, const cl_profile_s *const profile, const uint32_t elapsed_ms)
+{
+	uint32_t low = UINT32_MAX;
+	uint32_t high = 0U;
+	for (size_t i = 0; i < profile->count; ++i) {
+		low = MIN(low, profile->samples[i]);
+		high = MAX(high, profile->samples[i]);
+	}
+	/* Bins start out a halfword (one Thumb instruction) wide */
+	uint8_t bin_shift = 1U;
+	while ((((uint64_t)high - low) >> bin_shift) + 1U > CL_PROFILE_MAX_BINS)
+		++bin_shift;
+	low &= ~((1U << bin_shift) - 1U);
+	const size_t bins = ((high - low) >> bin_shift) + 1U;
+	const size_t length = CL_PROFILE_HEADER_SIZE + bins * 2U;
+
+	uint8_t *const histogram = calloc(length, 1U);
+	if (!histogram) { /* calloc failed: heap exhaustion */
+		DEBUG_ERROR("calloc: failed in %s\n", __func__);
+		return false;
+	}
+	/* struct gmon_hdr: the cookie and version, then 12 spare bytes */
+	memcpy(histogram, "gmon", 4U);
+	write_le4(histogram, 4U, 1U);
+	/* GMON_TAG_TIME_HIST followed by struct gmon_hist_hdr, all in the target's (little endian) byte order */
+	histogram[20U] = 0U;
+	write_le4(histogram, 21U, low);
+	write_le4(histogram, 25U, low + (uint32_t)(bins << bin_shift));
+	write_le4(histogram, 29U, (uint32_t)bins);
+	write_le4(histogram, 33U, (uint32_t)(((uint64_t)profile->count * 1000U) / elapsed_ms));
+	memcpy(histogram + 37U, "seconds", 7U);
+	histogram[52U] = 's';
+	/* Then the 16-bit bin counts, which saturate rather than wrap */
+	for (size_t i = 0; i < profile->count; ++i) {
+		const size_t offset = CL_PROFILE_HEADER_SIZE + (((profile->samples[i] - low) >> bin_shift) * 2U);
+		const uint16_t count = read_le2(histogram, offset);
+		if (count != UINT16_MAX)
+			write_le2(histogram, offset, count + 1U);
+	}
+
+	bool result = false;
+	const int fd = open(file, O_TRUNC | O_CREAT | O_WRONLY | O_BINARY, BMDA_NORMAL_MODE);
+	if (fd == -1)
+		DEBUG_ERROR("Error opening %s for writing: %s\n", file, strerror(errno));
+	else {
+		result = write(fd, histogram, length) == (ssize_t)length;
+		if (!result)
+			DEBUG_ERROR("Write to %s failed: %s\n", file, strerror(errno));
+		close(fd);
+	}
+	free(histogram);
+	return result;
+}
+
+/*
+ * Profile the target without a GDB session by sampling DWT_PCSR over the debug link while it
+ * runs, which works on targets that don't have SWO wired out.
+ */
+static int cl_profile(target_s *const target, const bmda_cli_options_s *const opt)
+{
+	if (!target_is_cortexm(target)) {
+		DEBUG_ERROR("PC sampling is only supported on Cortex-M targets\n");
+		return -1;
+	}
+	const char *const file = opt->opt_flash_file ? opt->opt_flash_file : "gmon.out";
+	cl_profile_s profile = {0};
+
+	DEBUG_WARN("Sampling the PC for %" PRIu32 "ms\n", opt->opt_profile_ms);
+	const uint32_t start_time = platform_time_ms();
+	if (!cortexm_pc_sample(target, opt->opt_profile_ms, cl_profile_sample, &profile))
+		DEBUG_WARN("Failed to halt the core again after sampling\n");
+	const uint32_t elapsed = MAX(platform_time_ms() - start_time, 1U);
+
+	int res = -1;
+	if (!profile.count)
+		DEBUG_ERROR("No PC samples taken, does the core implement DWT_PCSR?\n");
+	else if (cl_profile_write(file, &profile, elapsed)) {
+		DEBUG_WARN("Wrote %zu samples taken in %" PRIu32 "ms to %s\n", profile.count, elapsed, file);
+		res = 0;
+	}
+	free(profile.samples);
+	return res;
+}
+
+/* Check that a segment of the image lands in Flash, so it can be erased and written */
+static bool cl_segment_in_flash(target_s *const target, const bmda_image_segment_s *const segment)
+{
+	const uint32_t end = segment->addr + segment->size - 1U;
+	if (target_flash_for_addr(target, segment->addr) && target_flash_for_addr(target, end))
+		return true;
+	DEBUG_WARN("Skipping %zu bytes at 0x%08" PRIx32 " which are not in Flash\n", segment->size, segment->addr);
+	return false;
+}
+
+static bool cl_image_write(target_s *const target, const bmda_image_s *const image)
+{
+	/*
+	 * Erase everything up front in one go so that segments sharing a Flash sector don't wipe out each
+	 * other's data and the erase can be planned as a whole, then write each segment and let the buffered
+	 * write pad as needed
+	 */
+	target_flash_range_s *const ranges = calloc(image->segment_count, sizeof(*ranges));
+	if (!ranges) { /* calloc failed: heap exhaustion */
+		DEBUG_ERROR("calloc: failed in %s\n", __func__);
+		return false;
+	}
+	size_t range_count = 0U;
+	size_t erase_size = 0U;
+	for (size_t idx = 0U; idx < image->segment_count; ++idx) {
+		const bmda_image_segment_s *const segment = &image->segments[idx];
+		if (!cl_segment_in_flash(target, segment))
+			continue;
+		ranges[range_count++] = (target_flash_range_s){.addr = segment->addr, .length = segment->size};
+		erase_size += segment->size;
+	}
+	DEBUG_INFO("Erasing %zu bytes in %zu segments\n", erase_size, range_count);
+	const bool erased = target_flash_erase_on_write(target, ranges, range_count);
+	free(ranges);
+	if (!erased) {
+		DEBUG_ERROR("Flash erase failed!\n");
+		return false;
+	}
+	for (size_t idx = 0U; idx < image->segment_count; ++idx) {
+		const bmda_image_segment_s *const segment = &image->segments[idx];
+		if (!target_flash_for_addr(target, segment->addr) ||
+			!target_flash_for_addr(target, segment->addr + segment->size - 1U))
+			continue;
+		DEBUG_INFO("Flashing %zu bytes at 0x%08" PRIx32 "\n", segment->size, segment->addr);
+		if (!target_flash_write(target, segment->addr, segment->data, segment->size)) {
+			DEBUG_ERROR("Flashing failed!\n");
+			return false;
+		}
+	}
+	if (!target_flash_complete(target)) {
+		DEBUG_ERROR("Flashing failed!\n");
+		return false;
+	}
+	return true;
+}
+
+#define WORKSIZE 0x1000U
+
+/* Read a range back and compare it byte for byte, reporting how much of it differs and where */
+static bool cl_verify_readback(
+	target_s *const target, const uint32_t base, const uint8_t *const expected, const size_t size)
+{
+	uint8_t data[WORKSIZE];
+	size_t mismatches = 0U;
+	uint32_t first_mismatch = 0U;
+	for (size_t offset = 0; offset < size; offset += WORKSIZE) {
+		const size_t worksize = MIN(size - offset, WORKSIZE);
+		const uint32_t addr = base + offset;
+		if (target_mem32_read(target, data, addr, worksize)) {
+			DEBUG_ERROR("Read failed at flash address 0x%08" PRIx32 "\n", addr);
+			return false;
+		}
+		for (size_t idx = 0U; idx < worksize; ++idx) {
+			if (data[idx] == expected[offset + idx])
+				continue;
+			if (!mismatches)
+				first_mismatch = addr + idx;
+			++mismatches;
+		}
+	}
+	if (mismatches)
+		DEBUG_ERROR("Verify failed for %zu of %zu bytes at 0x%08" PRIx32 ", first at 0x%08" PRIx32 "\n", mismatches,
+			size, base, first_mismatch);
+	return !mismatches;
+}
+
+/*
+ * Verify a segment by having the target CRC it and comparing that to the CRC of the image data, so
+ * nothing needs to come back over the link for a good board. On a mismatch, the segment is CRC'd again a
+ * Flash sector at a time and only the sectors that differ are read back to report what's wrong.
+ */
+static bool cl_verify_segment(target_s *const target, const bmda_image_segment_s *const segment)
+{
+	uint32_t crc = 0U;
+	if (!bmd_crc32(target, &crc, segment->addr, segment->size)) {
+		DEBUG_WARN("Could not CRC 0x%08" PRIx32 "+%zu on the target, reading it back\n", segment->addr, segment->size);
+		return cl_verify_readback(target, segment->addr, segment->data, segment->size);
+	}
+	if (crc == bmd_crc32_buffer(segment->data, segment->size))
+		return true;
+
+	const target_flash_s *const flash = target_flash_for_addr(target, segment->addr);
+	const size_t sector_size = flash ? flash->blocksize : WORKSIZE;
+	bool mismatch_found = false;
+	for (size_t offset = 0U; offset < segment->size;) {
+		const uint32_t addr = segment->addr + offset;
+		const size_t length = MIN(sector_size - (addr % sector_size), segment->size - offset);
+		if (!bmd_crc32(target, &crc, addr, length) || crc != bmd_crc32_buffer(segment->data + offset, length))
+			mismatch_found |= !cl_verify_readback(target, addr, segment->data + offset, length);
+		offset += length;
+	}
+	if (!mismatch_found)
+		DEBUG_ERROR("Verify failed for 0x%08" PRIx32 "+%zu, but no sector differs when rechecked\n", segment->addr,
+			segment->size);
+	return false;
+}
+
+static bool cl_image_verify(target_s *const target, const bmda_image_s *const image, size_t *const bytes_verified)
+{
+	bool result = true;
+	for (size_t idx = 0U; idx < image->segment_count; ++idx) {
+		const bmda_image_segment_s *const segment = &image->segments[idx];
+		/* Check every segment so all the bad sectors get reported, not just the first */
+		if (cl_verify_segment(target, segment))
+			*bytes_verified += segment->size;
+		else
+			result = false;
+	}
+	return result;
+}
+
+/*
+ * Flash read-back is streamed: the target is read in opt_read_size chunks into a small ring of buffers,
+ * while a writer thread drains the filled buffers out to the file so the probe link is never left idle
+ * waiting on the disk
+ */
+#define CL_READ_BUFFERS 4U
+
+typedef struct cl_read_stream {
+	int fd;
+	uint8_t *buffers[CL_READ_BUFFERS];
+	size_t lengths[CL_READ_BUFFERS];
+	/* Indexes of the next buffer to fill and the next to write out, and how many are waiting */
+	size_t head;
+	size_t tail;
+	size_t filled;
+	bool done;
+	int error;
+#if defined(_WIN32) && !defined(__CYGWIN__)
+	SRWLOCK lock;
+	CONDITION_VARIABLE cond;
+#else
+	pthread_mutex_t lock;
+	pthread_cond_t cond;
+#endif
+} cl_read_stream_s;
+
+#if defined(_WIN32) && !defined(__CYGWIN__)
+static inline void cl_read_stream_lock(cl_read_stream_s *const stream)
+{
+	AcquireSRWLockExclusive(&stream->lock);
+}
+
+static inline void cl_read_stream_unlock(cl_read_stream_s *const stream)
+{
+	ReleaseSRWLockExclusive(&stream->lock);
+}
+
+static inline void cl_read_stream_signal(cl_read_stream_s *const stream)
+{
+	WakeAllConditionVariable(&stream->cond);
+}
+
+static inline void cl_read_stream_wait(cl_read_stream_s *const stream)
+{
+	SleepConditionVariableSRW(&stream->cond, &stream->lock, INFINITE, 0);
+}
+#else
+static inline void cl_read_stream_lock(cl_read_stream_s *const stream)
+{
+	pthread_mutex_lock(&stream->lock);
+}
+
+static inline void cl_read_stream_unlock(cl_read_stream_s *const stream)
+{
+	pthread_mutex_unlock(&stream->lock);
+}
+
+static inline void cl_read_stream_signal(cl_read_stream_s *const stream)
+{
+	pthread_cond_broadcast(&stream->cond);
+}
+
+static inline void cl_read_stream_wait(cl_read_stream_s *const stream)
+{
+	pthread_cond_wait(&stream->cond, &stream->lock);
+}
+#endif
+
+#if defined(_WIN32) && !defined(__CYGWIN__)
+static DWORD WINAPI cl_read_stream_writer(void *const ctx)
+#else
+static void *cl_read_stream_writer(void *const ctx)
+#endif
+{
+	cl_read_stream_s *const stream = (cl_read_stream_s *)ctx;
+	cl_read_stream_lock(stream);
+	while (true) {
+		while (!stream->filled && !stream->done)
+			cl_read_stream_wait(stream);
+		if (!stream->filled)
+			break;
+		/* The reader never touches a filled buffer, so it can be written out without the lock held */
+		const uint8_t *const buffer = stream->buffers[stream->tail];
+		const size_t length = stream->lengths[stream->tail];
+		cl_read_stream_unlock(stream);
+		int error = 0;
+		for (size_t offset = 0U; !error && offset < length;) {
+			const ssize_t written = write(stream->fd, buffer + offset, length - offset);
+			if (written <= 0)
+				error = written < 0 ? errno : EIO;
+			else
+				offset += (size_t)written;
+		}
+		cl_read_stream_lock(stream);
+		stream->tail = (stream->tail + 1U) % CL_READ_BUFFERS;
+		--stream->filled;
+		if (error) {
+			stream->error = error;
+			stream->done = true;
+		}
+		cl_read_stream_signal(stream);
+	}
+	cl_read_stream_unlock(stream);
+#if defined(_WIN32) && !defined(__CYGWIN__)
+	return 0;
+#else
+	return NULL;
+#endif
+}
+
+static int cl_flash_read(target_s *const target, const bmda_cli_options_s *const opt, const int fd)
+{
+	const size_t read_size = opt->opt_read_size ? opt->opt_read_size : CL_READ_SIZE_DEFAULT;
+	cl_read_stream_s stream = {.fd = fd};
+	for (size_t idx = 0U; idx < CL_READ_BUFFERS; ++idx) {
+		stream.buffers[idx] = malloc(read_size);
+		if (!stream.buffers[idx]) { /* malloc failed: heap exhaustion */
+			DEBUG_ERROR("malloc: failed in %s\n", __func__);
+			for (size_t buffer = 0U; buffer < idx; ++buffer)
+				free(stream.buffers[buffer]);
+			return -1;
+		}
+	}
+
+#if defined(_WIN32) && !defined(__CYGWIN__)
+	InitializeSRWLock(&stream.lock);
+	InitializeConditionVariable(&stream.cond);
+	const HANDLE writer = CreateThread(NULL, 0, cl_read_stream_writer, &stream, 0, NULL);
+	const bool writer_started = writer != NULL;
+#else
+	pthread_mutex_init(&stream.lock, NULL);
+	pthread_cond_init(&stream.cond, NULL);
+	pthread_t writer;
+	const bool writer_started = pthread_create(&writer, NULL, cl_read_stream_writer, &stream) == 0;
+#endif
+	if (!writer_started)
+		DEBUG_WARN("Could not start the file writer thread, writing synchronously\n");
+
+	DEBUG_INFO("Reading flash from 0x%08" PRIx32 " for %zu bytes to %s in %zu byte reads\n", opt->opt_flash_start,
+		opt->opt_flash_size, opt->opt_flash_file, read_size);
+	const target_addr_t flash_src = opt->opt_flash_start;
+	const size_t size = opt->opt_flash_size;
+	size_t bytes_read = 0U;
+	bool read_failed = false;
+	const uint32_t start_time = platform_time_ms();
+	uint32_t report_time = start_time;
+	while (bytes_read < size) {
+		/* Wait for a free buffer, bailing out if the writer hit trouble */
+		cl_read_stream_lock(&stream);
+		while (stream.filled == CL_READ_BUFFERS && !stream.done)
+			cl_read_stream_wait(&stream);
+		const bool failed = stream.done;
+		cl_read_stream_unlock(&stream);
+		if (failed)
+			break;
+
+		const size_t worksize = MIN(size - bytes_read, read_size);
+		uint8_t *const buffer = stream.buffers[stream.head];
+		if (target_mem32_read(target, buffer, flash_src + bytes_read, worksize)) {
+			DEBUG_ERROR("Read failed at flash address 0x%08" PRIx32 "\n", flash_src + (uint32_t)bytes_read);
+			read_failed = true;
+			break;
+		}
+		bytes_read += worksize;
+
+		if (writer_started) {
+			cl_read_stream_lock(&stream);
+			stream.lengths[stream.head] = worksize;
+			stream.head = (stream.head + 1U) % CL_READ_BUFFERS;
+			++stream.filled;
+			cl_read_stream_signal(&stream);
+			cl_read_stream_unlock(&stream);
+		} else {
+			const ssize_t written = write(fd, buffer, worksize);
+			if (written < 0 || (size_t)written < worksize) {
+				stream.error = written < 0 ? errno : EIO;
+				break;
+			}
+		}
+
+		/* Give a running throughput readout for the longer reads */
+		const uint32_t now = platform_time_ms();
+		if (now - report_time >= 1000U) {
+			DEBUG_INFO("Read %zu of %zu kiB, %8.3fkiB/s\n", bytes_read / 1024U, size / 1024U,
+				(double)bytes_read / (now - start_time));
+			report_time = now;
+		}
+	}
+
+	/* Let the writer drain what's left and wait for it to finish */
+	if (writer_started) {
+		cl_read_stream_lock(&stream);
+		stream.done = true;
+		cl_read_stream_signal(&stream);
+		cl_read_stream_unlock(&stream);
+#if defined(_WIN32) && !defined(__CYGWIN__)
+		WaitForSingleObject(writer, INFINITE);
+		CloseHandle(writer);
+#else
+		pthread_join(writer, NULL);
+#endif
+	}
+	const uint32_t end_time = platform_time_ms();
+#if !defined(_WIN32) || defined(__CYGWIN__)
+	pthread_cond_destroy(&stream.cond);
+	pthread_mutex_destroy(&stream.lock);
+#endif
+	for (size_t idx = 0U; idx < CL_READ_BUFFERS; ++idx)
+		free(stream.buffers[idx]);
+
+	if (stream.error) {
+		DEBUG_ERROR("Write to %s failed (%d): %s\n", opt->opt_flash_file, stream.error, strerror(stream.error));
+		return -1;
+	}
+	if (read_failed)
+		return -1;
+	DEBUG_WARN("Read succeeded for %zu bytes, %8.3fkiB/s\n", bytes_read, (double)bytes_read / (end_time - start_time));
+	return 0;
+}
+
+/* Longest script line taken, monitor commands included */
+#define CL_SCRIPT_LINE_MAX 1024U
+
+/* Load an image for a script's write or verify line and do that to it, raw binaries going at addr */
+static bool cl_script_image(target_s *const target, const bool write, char *const file, const uint32_t addr)
+{
+	mmap_data_s map = {0};
+	if (!bmp_mmap(file, &map)) {
+		DEBUG_ERROR("Can not map file: %s\n", strerror(errno));
+		return false;
+	}
+	bmda_image_s image = {0};
+	bool result = bmda_image_load(&image, map.data, map.size, addr, 0xffffffffU);
+	if (!result)
+		DEBUG_ERROR("Can not load image from %s\n", file);
+	else if (write)
+		result = cl_image_write(target, &image);
+	else {
+		size_t bytes_verified = 0U;
+		result = cl_image_verify(target, &image, &bytes_verified);
+		if (result)
+			DEBUG_INFO("Verified %zu bytes\n", bytes_verified);
+	}
+	bmda_image_free(&image);
+	if (map.size)
+		bmp_munmap(&map);
+	return result;
+}
+
+static bool cl_script_line(target_s *const target, const bmda_cli_options_s *const opt, char *const line)
+{
+	const size_t verb_length = strcspn(line, " \t");
+	/* Anything that's not one of the script's own operations is taken to be a monitor command */
+	char *const args = line + verb_length;
+	if (verb_length == 5U && strncmp(line, "erase", 5U) == 0) {
+		const char *const addr = strtok(args, " \t");
+		const char *const length = strtok(NULL, " \t");
+		if (addr && !length) {
+			DEBUG_ERROR("usage: erase [ADDR LEN]\n");
+			return false;
+		}
+		const uint32_t start = addr ? strtoul(addr, NULL, 0) : opt->opt_flash_start;
+		const size_t size = length ? cl_parse_size(length) : opt->opt_flash_size;
+		DEBUG_INFO("Erase %zu bytes at 0x%08" PRIx32 "\n", size, start);
+		return target_flash_erase(target, start, size);
+	}
+	if ((verb_length == 5U && strncmp(line, "write", 5U) == 0) ||
+		(verb_length == 6U && strncmp(line, "verify", 6U) == 0)) {
+		char *const file = strtok(args, " \t");
+		const char *const addr = strtok(NULL, " \t");
+		if (!file) {
+			DEBUG_ERROR("usage: %.*s FILE [ADDR]\n", (int)verb_length, line);
+			return false;
+		}
+		return cl_script_image(target, verb_length == 5U, file, addr ? strtoul(addr, NULL, 0) : opt->opt_flash_start);
+	}
+	if (verb_length == 5U && strncmp(line, "reset", 5U) == 0) {
+		/* Leave Flash mode first so the reset isn't undone by it, then hold it again for what follows */
+		const bool result = target_flash_session_end(target);
+		target_reset(target);
+		target_flash_session_begin(target);
+		return result;
+	}
+	if (verb_length == 5U && strncmp(line, "delay", 5U) == 0) {
+		const char *const delay = strtok(args, " \t");
+		if (!delay) {
+			DEBUG_ERROR("usage: delay MS\n");
+			return false;
+		}
+		platform_delay(strtoul(delay, NULL, 0));
+		return true;
+	}
+	return command_process(target, line) == 0;
+}
+
+/*
+ * Run a script of Flash operations and monitor commands against the attached target, one per line with blank
+ * lines and lines starting with # skipped. The whole script is one Flash session, so the target goes into
+ * and out of Flash mode once rather than around every erase and write
+ */
+static int cl_script(target_s *const target, const bmda_cli_options_s *const opt)
+{
+	FILE *const script = fopen(opt->opt_script_file, "r");
+	if (!script) {
+		DEBUG_ERROR("Error opening script %s: %s\n", opt->opt_script_file, strerror(errno));
+		return -1;
+	}
+	flash_differential = opt->opt_flash_differential;
+	target_flash_session_begin(target);
+	const uint32_t start_time = platform_time_ms();
+	char line[CL_SCRIPT_LINE_MAX];
+	size_t line_number = 0U;
+	bool result = true;
+	while (result && fgets(line, sizeof(line), script)) {
+		++line_number;
+		size_t length = strlen(line);
+		if (length && line[length - 1U] != '\n' && !feof(script)) {
+			DEBUG_ERROR("%s:%zu: line too long\n", opt->opt_script_file, line_number);
+			result = false;
+			break;
+		}
+		while (length && isspace((unsigned char)line[length - 1U]))
+			line[--length] = '\0';
+		char *command = line;
+		while (isspace((unsigned char)*command))
+			++command;
+		if (!*command || *command == '#')
+			continue;
+
+		DEBUG_INFO("%s:%zu: %s\n", opt->opt_script_file, line_number, command);
+		result = cl_script_line(target, opt, command);
+		if (!result)
+			DEBUG_ERROR("%s:%zu: \"%s\" failed\n", opt->opt_script_file, line_number, command);
+	}
+	if (result && ferror(script)) {
+		DEBUG_ERROR("Error reading script %s\n", opt->opt_script_file);
+		result = false;
+	}
+	fclose(script);
+	if (!target_flash_session_end(target) && result) {
+		DEBUG_ERROR("Flashing failed!\n");
+		result = false;
+	}
+	if (result)
+		DEBUG_WARN("Script %s completed in %" PRIu32 "ms\n", opt->opt_script_file, platform_time_ms() - start_time);
+	return result ? 0 : -1;
+}
+
 int cl_execute(bmda_cli_options_s *opt)
 {
 	if (opt->opt_mode == BMP_MODE_RESET_HW) {
@@ -588,9 +1428,15 @@ int cl_execute(bmda_cli_options_s *opt)
 			goto target_detach;
 		}
 	}
-	if (opt->opt_flash_size < map.size)
-		/* restrict to size given on command line */
-		map.size = opt->opt_flash_size;
+	/* Split the file up into the segments to program, raw binaries going at the requested address and size */
+	bmda_image_s image = {0};
+	if (map.size) {
+		if (!bmda_image_load(&image, map.data, map.size, opt->opt_flash_start, opt->opt_flash_size)) {
+			DEBUG_ERROR("Can not load image from %s. Aborting!\n", opt->opt_flash_file);
+			res = -1;
+			goto free_map;
+		}
+	}
 	if (opt->opt_monitor) {
 		res = command_process(target, opt->opt_monitor);
 		if (res)
@@ -598,6 +1444,20 @@ int cl_execute(bmda_cli_options_s *opt)
 	}
 	if (opt->opt_mode == BMP_MODE_RESET)
 		target_reset(target);
+	else if (opt->opt_mode == BMP_MODE_PROFILE)
+		res = cl_profile(target, opt);
+	else if (opt->opt_mode == BMP_MODE_BENCH)
+		res = bench_run(target, opt->opt_bench_flash) ? 0 : -1;
+	else if (opt->opt_mode == BMP_MODE_CORE_DUMP) {
+		const char *const file = opt->opt_flash_file ? opt->opt_flash_file : "core";
+		const char *const regions = opt->opt_core_regions;
+		res = coredump_write(target, file, &regions, regions ? 1U : 0U) ? 0 : -1;
+	} else if (opt->opt_mode == BMP_MODE_SCRIPT)
+		res = cl_script(target, opt);
+#ifdef ENABLE_RTT
+	else if (opt->opt_mode == BMP_MODE_RTT)
+		res = cl_rtt_stream(target, opt);
+#endif
 	else if (opt->opt_mode == BMP_MODE_FLASH_ERASE) {
 		DEBUG_INFO("Erase %zu bytes at 0x%08" PRIx32 "\n", opt->opt_flash_size, opt->opt_flash_start);
 		if (!target_flash_erase(target, opt->opt_flash_start, opt->opt_flash_size)) {
@@ -607,82 +1467,47 @@ int cl_execute(bmda_cli_options_s *opt)
 		}
 		target_reset(target);
 	} else if (opt->opt_mode == BMP_MODE_FLASH_WRITE || opt->opt_mode == BMP_MODE_FLASH_WRITE_VERIFY) {
-		DEBUG_INFO("Erasing %zu bytes at 0x%08" PRIx32 "\n", map.size, opt->opt_flash_start);
 		const uint32_t start_time = platform_time_ms();
-		if (!target_flash_erase(target, opt->opt_flash_start, map.size)) {
-			DEBUG_ERROR("Flash erase failed!\n");
-			res = -1;
-			goto free_map;
-		}
-		DEBUG_INFO("Flashing %zu bytes at 0x%08" PRIx32 "\n", map.size, opt->opt_flash_start);
-		/* Buffered write cares for padding*/
-		if (!target_flash_write(target, opt->opt_flash_start, map.data, map.size) || !target_flash_complete(target)) {
-			DEBUG_ERROR("Flashing failed!\n");
+		flash_differential = opt->opt_flash_differential;
+		if (!cl_image_write(target, &image)) {
 			res = -1;
 			goto free_map;
 		}
 		DEBUG_INFO("Success!\n");
 		const uint32_t end_time = platform_time_ms();
-		DEBUG_WARN(
-			"Flash Write succeeded for %zu bytes, %8.3fkiB/s\n", map.size, (double)map.size / (end_time - start_time));
+		size_t image_size = 0U;
+		for (size_t idx = 0U; idx < image.segment_count; ++idx)
+			image_size += image.segments[idx].size;
+		DEBUG_WARN("Flash Write succeeded for %zu bytes, %8.3fkiB/s\n", image_size,
+			(double)image_size / (end_time - start_time));
+		char report[256U];
+		if (target_flash_report(report, sizeof(report)))
+			DEBUG_WARN("%s", report);
 		if (opt->opt_mode != BMP_MODE_FLASH_WRITE_VERIFY) {
 			target_reset(target);
 			goto free_map;
 		}
 	}
-	if (opt->opt_mode == BMP_MODE_FLASH_READ || opt->opt_mode == BMP_MODE_FLASH_VERIFY ||
-		opt->opt_mode == BMP_MODE_FLASH_WRITE_VERIFY) {
-#define WORKSIZE 0x1000U
-		uint8_t data[WORKSIZE];
-		if (opt->opt_mode == BMP_MODE_FLASH_READ)
-			DEBUG_INFO("Reading flash from 0x%08" PRIx32 " for %zu bytes to %s\n", opt->opt_flash_start,
-				opt->opt_flash_size, opt->opt_flash_file);
-		const uint32_t flash_src = opt->opt_flash_start;
-		const size_t size = opt->opt_mode == BMP_MODE_FLASH_READ ? opt->opt_flash_size : map.size;
-		size_t bytes_read = 0;
-		uint8_t *flash = (uint8_t *)map.data;
+	if (opt->opt_mode == BMP_MODE_FLASH_VERIFY || opt->opt_mode == BMP_MODE_FLASH_WRITE_VERIFY) {
+		size_t bytes_verified = 0U;
 		const uint32_t start_time = platform_time_ms();
-		for (size_t offset = 0; offset < size; offset += WORKSIZE) {
-			const size_t worksize = MIN(size - offset, WORKSIZE);
-			int n_read = target_mem32_read(target, data, flash_src + offset, worksize);
-			if (n_read) {
-				if (opt->opt_flash_size == 0) /* we reached end of flash */
-					DEBUG_INFO("Reached end of flash at size %" PRIu32 "\n", flash_src - opt->opt_flash_start);
-				else
-					DEBUG_ERROR("Read failed at flash address 0x%08" PRIx32 "\n", flash_src);
-				break;
-			}
-			bytes_read += worksize;
-			if (opt->opt_mode == BMP_MODE_FLASH_VERIFY || opt->opt_mode == BMP_MODE_FLASH_WRITE_VERIFY) {
-				if (memcmp(data, flash + offset, worksize) != 0) {
-					DEBUG_ERROR("Verify failed at flash region 0x%08" PRIx32 "\n", flash_src);
-					res = -1;
-					goto free_map;
-				}
-			} else if (read_file != -1) {
-				const ssize_t written = write(read_file, data, worksize);
-				if (written < 0) {
-					const int error = errno;
-					DEBUG_ERROR("Write to %s failed (%d): %s\n", opt->opt_flash_file, error, strerror(error));
-					res = -1;
-					goto free_map;
-				}
-				if ((size_t)written < worksize) {
-					DEBUG_ERROR("Read failed at flash region 0x%08" PRIx32 "\n", flash_src);
-					res = -1;
-					goto free_map;
-				}
-			}
+		if (!cl_image_verify(target, &image, &bytes_verified)) {
+			res = -1;
+			goto free_map;
 		}
 		const uint32_t end_time = platform_time_ms();
-		if (read_file != -1)
-			close(read_file);
-		DEBUG_WARN("Read/Verify succeeded for %zu bytes, %8.3fkiB/s\n", bytes_read,
-			(double)bytes_read / (end_time - start_time));
+		DEBUG_WARN("Read/Verify succeeded for %zu bytes, %8.3fkiB/s\n", bytes_verified,
+			(double)bytes_verified / (end_time - start_time));
 		if (opt->opt_mode == BMP_MODE_FLASH_WRITE_VERIFY)
 			target_reset(target);
 	}
+	if (opt->opt_mode == BMP_MODE_FLASH_READ) {
+		res = cl_flash_read(target, opt, read_file);
+		close(read_file);
+		read_file = -1;
+	}
 free_map:
+	bmda_image_free(&image);
 	if (map.size)
 		bmp_munmap(&map);
 target_detach:
@@ -38,8 +38,16 @@ typedef enum bmda_cli_mode {
 	BMP_MODE_FLASH_VERIFY,
 	BMP_MODE_SWJ_TEST,
 	BMP_MODE_MONITOR,
+	BMP_MODE_RTT,
+	BMP_MODE_PROFILE,
+	BMP_MODE_BENCH,
+	BMP_MODE_CORE_DUMP,
+	BMP_MODE_SCRIPT,
 } bmda_cli_mode_e;
 
+/* How many bytes BMP_MODE_FLASH_READ asks the target for at a time unless told otherwise */
+#define CL_READ_SIZE_DEFAULT 65536U
+
 typedef enum bmp_scan_mode {
 	BMP_SCAN_JTAG,
 	BMP_SCAN_SWD,
@@ -51,10 +59,12 @@ typedef struct bmda_cli_options {
 	bmp_scan_mode_e opt_scanmode;
 	bool opt_tpwr;
 	bool opt_list_only;
+	bool opt_all_probes;
 	bool opt_connect_under_reset;
 	bool external_resistor_swd;
 	bool fast_poll;
 	bool opt_no_hl;
+	bool opt_persist;
 	char *opt_flash_file;
 	char *opt_device;
 	char *opt_serial;
@@ -63,17 +73,37 @@ typedef struct bmda_cli_options {
 	size_t opt_position;
 	char *opt_cable;
 	char *opt_monitor;
+	char *opt_rtt_output;
+	uint32_t opt_profile_ms;
 	uint32_t opt_target_dev;
 	uint32_t opt_flash_start;
 	uint32_t opt_max_frequency;
 	size_t opt_flash_size;
+	size_t opt_read_size;
 	char *opt_gpio_map;
+	bool opt_sim;
+	uint32_t opt_sim_latency_us;
 	bool opt_cmsisdap_allow_fallback;
+	bool opt_flash_differential;
+	bool opt_bench_flash;
+	bool opt_bench_codec;
+	char *opt_trace_file;
+	char *opt_gdb_socket;
+	uint16_t opt_rtt_port;
+	uint16_t opt_observer_port;
+	char *opt_swo_file;
+	char *opt_core_regions;
+	char *opt_script_file;
 } bmda_cli_options_s;
 
 void cl_init(bmda_cli_options_s *opt, int argc, char **argv);
 int cl_execute(bmda_cli_options_s *opt);
+bool scan_for_targets(const bmda_cli_options_s *opt);
 bool serial_open(const bmda_cli_options_s *opt, const char *serial);
 void serial_close(void);
+/* Whether the probe was opened as a hostname:port network device rather than a local serial port */
+bool serial_is_network(void);
+/* Send any remote protocol requests still queued up for the probe */
+void serial_buffer_flush(void);
 
 #endif /* PLATFORMS_HOSTED_CLI_H */
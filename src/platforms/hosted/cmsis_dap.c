@@ -74,6 +74,10 @@
 #include "target.h"
 
 #define TRANSFER_TIMEOUT_MS (100)
+/* The deepest pipeline to try when tuning, even if the adaptor reports it can buffer fewer packets */
+#define DAP_TUNE_MAX_DEPTH 16U
+/* How many exchanges to time at each pipeline depth - enough to swamp platform_time_us() jitter */
+#define DAP_TUNE_EXCHANGES 128U
 
 typedef enum cmsis_type {
 	CMSIS_TYPE_NONE = 0,
@@ -107,9 +111,14 @@ static uint8_t buffer[1025U];
  * https://arm-software.github.io/CMSIS-DAP/latest/group__DAP__Config__Debug__gr.html#gaa28bb1da2661291634c4a8fb3e227404
  */
 static size_t dap_packet_size = 64U;
+/* How many packets the adaptor can buffer for pipelined processing */
+static size_t dap_packet_count = 1U;
+static usb_link_s dap_usb_link;
 bool dap_has_swd_sequence = false;
+bool dap_has_execute_commands = false;
 
 dap_version_s dap_adaptor_version(dap_info_e version_kind);
+static void dap_tune(void);
 
 static size_t mbslen(const char *str)
 {
@@ -156,7 +165,7 @@ static inline bool dap_version_compare_le(const dap_version_s lhs, const dap_ver
  * Return maximum length in bytes that can be sent in the 'data' payload of a
  * DAP transfer, given the interface type and (provided) DAP command header size.
  */
-static inline size_t dap_max_transfer_data(size_t command_header_len)
+size_t dap_max_transfer_data(const size_t command_header_len)
 {
 	const size_t result = dap_packet_size - command_header_len;
 
@@ -259,6 +268,14 @@ static bool dap_init_bulk(void)
 	dap_packet_size = bmda_probe_info.max_packet_length;
 	in_ep = bmda_probe_info.in_ep;
 	out_ep = bmda_probe_info.out_ep;
+	/* Describe the link so the pipelined transfer engine can drive it */
+	dap_usb_link = (usb_link_s){
+		.context = bmda_probe_info.libusb_ctx,
+		.device_handle = usb_handle,
+		.interface = bmda_probe_info.interface_num,
+		.ep_tx = out_ep,
+		.ep_rx = in_ep,
+	};
 	return true;
 }
 
@@ -303,6 +320,8 @@ bool dap_init(bool allow_fallback)
 		adaptor_version = dap_adaptor_version(DAP_INFO_ADAPTOR_VERSION);
 	/* Look for CMSIS-DAP v1.2+ */
 	dap_has_swd_sequence = dap_version_compare_ge(cmsis_version, (dap_version_s){1, 2, 0});
+	/* Look for CMSIS-DAP v1.1+ for the atomic DAP_ExecuteCommands */
+	dap_has_execute_commands = dap_version_compare_ge(cmsis_version, (dap_version_s){1, 1, 0});
 
 	/* Try to get the actual packet size information from the adaptor */
 	uint16_t dap_packet_size;
@@ -312,6 +331,13 @@ bool dap_init(bool allow_fallback)
 	else
 		dap_packet_size = dap_packet_size + (type == CMSIS_TYPE_HID ? 1U : 0U);
 
+	/* Find out how many packets the adaptor can buffer, so we know how deep a pipeline it can take */
+	uint8_t packet_count = 1U;
+	if (dap_info(DAP_INFO_PACKET_COUNT, &packet_count, sizeof(packet_count)) != sizeof(packet_count))
+		DEBUG_WARN("Failed to get adaptor packet count, assuming 1\n");
+	dap_packet_count = packet_count ? packet_count : 1U;
+	DEBUG_INFO("Adaptor packet count: %zu\n", dap_packet_count);
+
 	/* Try to get the device's capabilities */
 	const size_t size = dap_info(DAP_INFO_CAPABILITIES, &dap_caps, sizeof(dap_caps));
 	if (size != sizeof(dap_caps)) {
@@ -334,6 +360,8 @@ bool dap_init(bool allow_fallback)
 		DEBUG_INFO(", Async SWO");
 	if (dap_caps & DAP_CAP_SWO_MANCHESTER)
 		DEBUG_INFO(", Manchester SWO");
+	if (dap_caps & DAP_CAP_SWO_STREAMING)
+		DEBUG_INFO(", Streaming SWO");
 	if (dap_caps & DAP_CAP_ATOMIC_CMDS)
 		DEBUG_INFO(", Atomic commands");
 	DEBUG_INFO(")\n");
@@ -355,6 +383,7 @@ bool dap_init(bool allow_fallback)
 	if (strcmp(bmda_probe_info.product, "Orbtrace") == 0)
 		dap_quirks |= DAP_QUIRK_NEEDS_EXTRA_ZLP_READ;
 
+	dap_tune();
 	return true;
 }
 
@@ -453,6 +482,11 @@ uint32_t dap_dp_read_reg(adiv5_debug_port_s *const target_dp, const uint16_t add
 	return result;
 }
 
+const usb_link_s *dap_bulk_link(void)
+{
+	return type == CMSIS_TYPE_BULK ? &dap_usb_link : NULL;
+}
+
 void dap_exit_function(void)
 {
 	if (type == CMSIS_TYPE_HID) {
@@ -599,6 +633,266 @@ bool dap_run_transfer(const void *const request_data, const size_t request_lengt
 	return *actual_length >= response_length;
 }
 
+static bool dap_can_pipeline(void)
+{
+	/*
+	 * Pipelining is only possible over the bulk interface, as HIDAPI gives us no way to have more than one
+	 * report in flight, and only worthwhile if the adaptor can actually buffer more than one packet.
+	 * Adaptors that need the extra ZLP read are also excluded as that read has to be sequenced by hand.
+	 */
+	return type == CMSIS_TYPE_BULK && dap_packet_count > 1U && !(dap_quirks & DAP_QUIRK_NEEDS_EXTRA_ZLP_READ);
+}
+
+/*
+ * Try to run a sequence of commands as a single DAP_ExecuteCommands packet. This only happens if all the
+ * requests and the largest expected responses fit in one packet. Returns the result through executed,
+ * which is set false if the batch could not be combined and must be run some other way.
+ *
+ * As the response layout is only known from the expected lengths, a short response to one command makes
+ * the responses after it unreliable - callers must stop at the first exchange that failed.
+ */
+static bool dap_run_combined(dap_exchange_s *const commands, const size_t count, bool *const executed)
+{
+	*executed = false;
+	if (!dap_has_execute_commands || count < 2U || count > UINT8_MAX)
+		return false;
+	/* Work out if the batch fits, accounting for the command byte of each response */
+	size_t request_length = 2U;
+	size_t response_length = 2U;
+	for (size_t idx = 0; idx < count; ++idx) {
+		request_length += commands[idx].request_length;
+		response_length += commands[idx].response_length + 1U;
+	}
+	const size_t packet_size = dap_packet_size - (type == CMSIS_TYPE_HID ? 1U : 0U);
+	if (request_length > packet_size || response_length > packet_size)
+		return false;
+
+	uint8_t request[1024U] = {DAP_EXECUTE_COMMANDS, (uint8_t)count};
+	for (size_t idx = 0, offset = 2U; idx < count; ++idx) {
+		memcpy(request + offset, commands[idx].request, commands[idx].request_length);
+		offset += commands[idx].request_length;
+	}
+	*executed = true;
+
+	uint8_t response[1024U];
+	const ssize_t result = dap_run_cmd_raw(request, request_length, response, packet_size);
+	if (result < 2) {
+		for (size_t idx = 0; idx < count; ++idx)
+			commands[idx].actual_length = 0U;
+		return false;
+	}
+	/* Skip the command byte and count then split the remainder back out into the individual responses */
+	size_t remaining = (size_t)result - 2U;
+	const uint8_t *data = response + 1U;
+	bool success = response[0] == count;
+	for (size_t idx = 0; idx < count; ++idx) {
+		dap_exchange_s *const command = &commands[idx];
+		if (!success || !remaining || data[0] != ((const uint8_t *)command->request)[0]) {
+			command->actual_length = 0U;
+			success = false;
+			continue;
+		}
+		command->actual_length = MIN(command->response_length, remaining - 1U);
+		memcpy(command->response, data + 1U, command->actual_length);
+		data += command->actual_length + 1U;
+		remaining -= command->actual_length + 1U;
+		success = command->actual_length >= command->response_length;
+	}
+	return success;
+}
+
+/* Run a sequence of commands through the bulk interface with up to depth of them in flight at once */
+static bool dap_run_pipelined(dap_exchange_s *const commands, const size_t count, const size_t depth)
+{
+	/* Responses carry the command byte which we have to strip, so receive them into scratch first */
+	uint8_t *const responses = calloc(count, dap_packet_size);
+	bmda_usb_request_s *const requests = calloc(count, sizeof(*requests));
+	if (!responses || !requests) { /* calloc failed: heap exhaustion */
+		DEBUG_ERROR("calloc: failed in %s\n", __func__);
+		free(responses);
+		free(requests);
+		return false;
+	}
+	for (size_t idx = 0; idx < count; ++idx) {
+		DEBUG_WIRE(" command: ");
+		for (size_t i = 0; i < commands[idx].request_length; ++i)
+			DEBUG_WIRE("%02x ", ((const uint8_t *)commands[idx].request)[i]);
+		DEBUG_WIRE("\n");
+		requests[idx] = (bmda_usb_request_s){
+			.tx_buffer = commands[idx].request,
+			.tx_len = commands[idx].request_length,
+			.rx_buffer = responses + (idx * dap_packet_size),
+			.rx_len = dap_packet_size,
+		};
+	}
+
+	bmda_usb_transfer_pipelined(&dap_usb_link, requests, count, depth, TRANSFER_TIMEOUT_MS);
+
+	/* Unpack the responses, checking that each one is actually for the command that was sent */
+	bool result = true;
+	for (size_t idx = 0; idx < count; ++idx) {
+		dap_exchange_s *const command = &commands[idx];
+		const uint8_t *const response = responses + (idx * dap_packet_size);
+		const int length = requests[idx].result;
+		if (!result || length < 1 || response[0] != ((const uint8_t *)command->request)[0]) {
+			if (result && length >= 1)
+				DEBUG_ERROR("Response for command %02x was for %02x\n", ((const uint8_t *)command->request)[0],
+					response[0]);
+			command->actual_length = 0U;
+			result = false;
+			continue;
+		}
+		command->actual_length = (size_t)length - 1U;
+		memcpy(command->response, response + 1U, MIN(command->response_length, command->actual_length));
+		result = command->actual_length >= command->response_length;
+	}
+
+	free(responses);
+	free(requests);
+	return result;
+}
+
+bool dap_run_transfers(dap_exchange_s *const commands, const size_t count)
+{
+	/* If the whole batch fits in one packet, running it atomically saves all but one round trip */
+	bool executed = false;
+	const bool combined = dap_run_combined(commands, count, &executed);
+	if (executed)
+		return combined;
+
+	if (!dap_can_pipeline() || count < 2U) {
+		bool result = true;
+		for (size_t idx = 0; idx < count && result; ++idx)
+			result = dap_run_transfer(commands[idx].request, commands[idx].request_length, commands[idx].response,
+				commands[idx].response_length, &commands[idx].actual_length);
+		return result;
+	}
+	return dap_run_pipelined(commands, count, dap_packet_count);
+}
+
+/* Throw away anything left sat in the adaptor's IN endpoint after a failed tuning run */
+static void dap_drain_bulk(void)
+{
+	uint8_t data[1024U];
+	int transferred = 0;
+	while (libusb_bulk_transfer(usb_handle, in_ep, data, (int)MIN(sizeof(data), dap_packet_size), &transferred, 10) ==
+		LIBUSB_SUCCESS)
+		continue;
+}
+
+/*
+ * Check that a packet of the size the adaptor reported really makes it through, by filling a whole response
+ * with a DAP_ExecuteCommands batch of DAP_Info requests. Adaptors that over-report have their packet size
+ * brought back down to the endpoint's max packet size from the USB descriptors.
+ */
+static void dap_tune_packet_size(void)
+{
+	if (!dap_has_execute_commands || dap_packet_size <= bmda_probe_info.max_packet_length)
+		return;
+
+	static const uint8_t request[2U] = {DAP_INFO, DAP_INFO_PACKET_COUNT};
+	/* Each DAP_Info response is the command byte, length and the packet count, after the 2 byte batch header */
+	const size_t count = MIN((dap_packet_size - 2U) / 3U, UINT8_MAX);
+	dap_exchange_s commands[UINT8_MAX];
+	uint8_t responses[UINT8_MAX][2U];
+	for (size_t idx = 0; idx < count; ++idx)
+		commands[idx] = (dap_exchange_s){
+			.request = request,
+			.request_length = sizeof(request),
+			.response = responses[idx],
+			.response_length = sizeof(responses[idx]),
+		};
+
+	bool executed = false;
+	bool result = dap_run_combined(commands, count, &executed) && executed;
+	for (size_t idx = 0; result && idx < count; ++idx)
+		result = responses[idx][0] == 1U;
+	if (result)
+		return;
+	DEBUG_WARN("Adaptor failed a full %zu byte packet, dropping to %u bytes\n", dap_packet_size,
+		bmda_probe_info.max_packet_length);
+	dap_drain_bulk();
+	dap_packet_size = bmda_probe_info.max_packet_length;
+}
+
+/*
+ * Time a run of pipelined DAP_Info requests, alternating between two with differently sized responses so
+ * that dropped or reordered responses are caught. Returns UINT32_MAX if the adaptor didn't cope.
+ */
+static uint32_t dap_time_pipeline(const size_t depth)
+{
+	static const uint8_t requests[2U][2U] = {
+		{DAP_INFO, DAP_INFO_PACKET_COUNT},
+		{DAP_INFO, DAP_INFO_PACKET_SIZE},
+	};
+	dap_exchange_s commands[DAP_TUNE_EXCHANGES];
+	uint8_t responses[DAP_TUNE_EXCHANGES][3U];
+	for (size_t idx = 0; idx < DAP_TUNE_EXCHANGES; ++idx)
+		commands[idx] = (dap_exchange_s){
+			.request = requests[idx & 1U],
+			.request_length = sizeof(requests[0]),
+			.response = responses[idx],
+			/* The length byte followed by a 1 byte packet count or a 2 byte packet size */
+			.response_length = (idx & 1U) ? 3U : 2U,
+		};
+
+	const uint32_t start = platform_time_us();
+	bool result = dap_run_pipelined(commands, DAP_TUNE_EXCHANGES, depth);
+	const uint32_t elapsed = platform_time_us() - start;
+	for (size_t idx = 0; result && idx < DAP_TUNE_EXCHANGES; ++idx)
+		result = responses[idx][0] == commands[idx].response_length - 1U;
+	if (!result) {
+		dap_drain_bulk();
+		return UINT32_MAX;
+	}
+	return elapsed;
+}
+
+/*
+ * Work out how deep a pipeline of packets is worth keeping in flight to the adaptor. Many adaptors report
+ * a packet count that doesn't reflect how they actually behave, and bulk OUT transfers are flow controlled
+ * by the adaptor NAKing them, so it's safe to try deeper than reported. The shallowest depth within 5% of
+ * the best time wins, as anything deeper only adds to how much has to be unwound on an error.
+ */
+static void dap_tune_pipeline(void)
+{
+	uint32_t times[DAP_TUNE_MAX_DEPTH + 1U];
+	uint32_t best = UINT32_MAX;
+	size_t max_depth = 1U;
+	for (size_t depth = 1U; depth <= DAP_TUNE_MAX_DEPTH; depth <<= 1U) {
+		times[depth] = dap_time_pipeline(depth);
+		/* If the adaptor fell over at this depth, don't push it any harder */
+		if (times[depth] == UINT32_MAX)
+			break;
+		best = MIN(best, times[depth]);
+		max_depth = depth;
+	}
+	if (best == UINT32_MAX) {
+		DEBUG_WARN("Adaptor failed pipeline tuning, not pipelining requests\n");
+		dap_packet_count = 1U;
+		return;
+	}
+
+	size_t depth = 1U;
+	while (depth < max_depth && times[depth] > best + (best / 20U))
+		depth <<= 1U;
+	DEBUG_INFO("Tuned pipeline depth to %zu (adaptor reports %zu), %" PRIu32 "us per exchange\n", depth,
+		dap_packet_count, times[depth] / DAP_TUNE_EXCHANGES);
+	dap_packet_count = depth;
+}
+
+/*
+ * Tune the link to the adaptor around how it actually behaves rather than just what it reports. This is only
+ * done on the bulk interface, as HIDAPI gives us no way to recover from an adaptor choking on a request.
+ */
+static void dap_tune(void)
+{
+	if (type != CMSIS_TYPE_BULK || (dap_quirks & DAP_QUIRK_NEEDS_EXTRA_ZLP_READ))
+		return;
+	dap_tune_packet_size();
+	dap_tune_pipeline();
+}
+
 static void dap_adiv5_mem_read(adiv5_access_port_s *ap, void *dest, target_addr64_t src, size_t len)
 {
 	if (len == 0U)
@@ -612,28 +906,35 @@ static void dap_adiv5_mem_read(adiv5_access_port_s *ap, void *dest, target_addr6
 	}
 	/* Otherwise proceed blockwise */
 	const size_t blocks_per_transfer = dap_max_transfer_data(DAP_CMD_BLOCK_READ_HDR_LEN + 1U) >> 2U;
+	const uint32_t tar_wrap = adiv5_ap_tar_wrap(ap);
+	/*
+	 * If the adaptor can take a pipeline and the read spans more than one TAR wrap region, or the adaptor
+	 * can combine the TAR setup with the block read into a single packet, stream it
+	 */
+	if ((dap_can_pipeline() && ((src & (tar_wrap - 1U)) + len) > tar_wrap) || dap_has_execute_commands) {
+		if (!dap_adiv5_mem_read_stream(ap, dest, src, len, align, blocks_per_transfer))
+			DEBUG_WIRE("%s failed: %u\n", __func__, ap->dp->fault);
+		return;
+	}
 	uint8_t *const data = (uint8_t *)dest;
 	for (size_t offset = 0; offset < len;) {
 		/* Setup AP_TAR every loop as failing to do so results in it wrapping */
 		if (!dap_adiv5_mem_access_setup(ap, src + offset, align))
 			return;
 		/*
-		 * src can start out unaligned to a 1024 byte chunk size,
+		 * src can start out unaligned to a TAR auto-increment region,
 		 * so we have to calculate how much is left of the chunk.
 		 * We also have to take into account how much of the chunk the caller
 		 * has requested we fill.
 		 */
-		const size_t chunk_remaining = MIN(1024 - ((src + offset) & 0x3ffU), len - offset);
+		const size_t chunk_remaining = MIN(tar_wrap - ((src + offset) & (tar_wrap - 1U)), len - offset);
 		const size_t blocks = chunk_remaining >> align;
-		for (size_t i = 0; i < blocks; i += blocks_per_transfer) {
-			/* blocks - i gives how many blocks are left to transfer in this 1024 byte chunk */
-			const size_t transfer_length = MIN(blocks - i, blocks_per_transfer) << align;
-			if (!dap_mem_read_block(ap, data + offset, src + offset, transfer_length, align)) {
-				DEBUG_WIRE("%s failed: %u\n", __func__, ap->dp->fault);
-				return;
-			}
-			offset += transfer_length;
+		/* Run the whole chunk as a batch of block transfers so they can be pipelined */
+		if (!dap_mem_read_blocks(ap, data + offset, src + offset, blocks << align, align, blocks_per_transfer)) {
+			DEBUG_WIRE("%s failed: %u\n", __func__, ap->dp->fault);
+			return;
 		}
+		offset += chunk_remaining;
 	}
 	DEBUG_WIRE("%s transferred %zu blocks\n", __func__, len >> align);
 }
@@ -651,28 +952,26 @@ static void dap_adiv5_mem_write(
 	}
 	/* Otherwise proceed blockwise */
 	const size_t blocks_per_transfer = dap_max_transfer_data(DAP_CMD_BLOCK_WRITE_HDR_LEN) >> 2U;
+	const uint32_t tar_wrap = adiv5_ap_tar_wrap(ap);
 	const uint8_t *const data = (const uint8_t *)src;
 	for (size_t offset = 0; offset < len;) {
 		/* Setup AP_TAR every loop as failing to do so results in it wrapping */
 		if (!dap_adiv5_mem_access_setup(ap, dest + offset, align))
 			return;
 		/*
-		 * dest can start out unaligned to a 1024 byte chunk size,
+		 * dest can start out unaligned to a TAR auto-increment region,
 		 * so we have to calculate how much is left of the chunk.
 		 * We also have to take into account how much of the chunk the caller
 		 * has requested we fill.
 		 */
-		const size_t chunk_remaining = MIN(1024 - ((dest + offset) & 0x3ffU), len - offset);
+		const size_t chunk_remaining = MIN(tar_wrap - ((dest + offset) & (tar_wrap - 1U)), len - offset);
 		const size_t blocks = chunk_remaining >> align;
-		for (size_t i = 0; i < blocks; i += blocks_per_transfer) {
-			/* blocks - i gives how many blocks are left to transfer in this 1024 byte chunk */
-			const size_t transfer_length = MIN(blocks - i, blocks_per_transfer) << align;
-			if (!dap_mem_write_block(ap, dest + offset, data + offset, transfer_length, align)) {
-				DEBUG_WIRE("%s failed: %u\n", __func__, ap->dp->fault);
-				return;
-			}
-			offset += transfer_length;
+		/* Run the whole chunk as a batch of block transfers so they can be pipelined */
+		if (!dap_mem_write_blocks(ap, dest + offset, data + offset, blocks << align, align, blocks_per_transfer)) {
+			DEBUG_WIRE("%s failed: %u\n", __func__, ap->dp->fault);
+			return;
 		}
+		offset += chunk_remaining;
 	}
 	DEBUG_WIRE("%s transferred %zu blocks\n", __func__, len >> align);
 
@@ -695,28 +994,35 @@ static void dap_adiv6_mem_read(
 	}
 	/* Otherwise proceed blockwise */
 	const size_t blocks_per_transfer = dap_max_transfer_data(DAP_CMD_BLOCK_READ_HDR_LEN + 1U) >> 2U;
+	const uint32_t tar_wrap = adiv5_ap_tar_wrap(&ap->base);
+	/*
+	 * If the adaptor can take a pipeline and the read spans more than one TAR wrap region, or the adaptor
+	 * can combine the TAR setup with the block read into a single packet, stream it
+	 */
+	if ((dap_can_pipeline() && ((src & (tar_wrap - 1U)) + len) > tar_wrap) || dap_has_execute_commands) {
+		if (!dap_adiv6_mem_read_stream(ap, dest, src, len, align, blocks_per_transfer))
+			DEBUG_WIRE("%s failed: %u\n", __func__, ap->base.dp->fault);
+		return;
+	}
 	uint8_t *const data = (uint8_t *)dest;
 	for (size_t offset = 0; offset < len;) {
 		/* Setup AP_TAR every loop as failing to do so results in it wrapping */
 		if (!dap_adiv6_mem_access_setup(ap, src + offset, align))
 			return;
 		/*
-		 * src can start out unaligned to a 1024 byte chunk size,
+		 * src can start out unaligned to a TAR auto-increment region,
 		 * so we have to calculate how much is left of the chunk.
 		 * We also have to take into account how much of the chunk the caller
 		 * has requested we fill.
 		 */
-		const size_t chunk_remaining = MIN(1024 - ((src + offset) & 0x3ffU), len - offset);
+		const size_t chunk_remaining = MIN(tar_wrap - ((src + offset) & (tar_wrap - 1U)), len - offset);
 		const size_t blocks = chunk_remaining >> align;
-		for (size_t i = 0; i < blocks; i += blocks_per_transfer) {
-			/* blocks - i gives how many blocks are left to transfer in this 1024 byte chunk */
-			const size_t transfer_length = MIN(blocks - i, blocks_per_transfer) << align;
-			if (!dap_mem_read_block(&ap->base, data + offset, src + offset, transfer_length, align)) {
-				DEBUG_WIRE("%s failed: %u\n", __func__, ap->base.dp->fault);
-				return;
-			}
-			offset += transfer_length;
+		/* Run the whole chunk as a batch of block transfers so they can be pipelined */
+		if (!dap_mem_read_blocks(&ap->base, data + offset, src + offset, blocks << align, align, blocks_per_transfer)) {
+			DEBUG_WIRE("%s failed: %u\n", __func__, ap->base.dp->fault);
+			return;
 		}
+		offset += chunk_remaining;
 	}
 	DEBUG_WIRE("%s transferred %zu blocks\n", __func__, len >> align);
 }
@@ -735,28 +1041,27 @@ static void dap_adiv6_mem_write(
 	}
 	/* Otherwise proceed blockwise */
 	const size_t blocks_per_transfer = dap_max_transfer_data(DAP_CMD_BLOCK_WRITE_HDR_LEN) >> 2U;
+	const uint32_t tar_wrap = adiv5_ap_tar_wrap(&ap->base);
 	const uint8_t *const data = (const uint8_t *)src;
 	for (size_t offset = 0; offset < len;) {
 		/* Setup AP_TAR every loop as failing to do so results in it wrapping */
 		if (!dap_adiv6_mem_access_setup(ap, dest + offset, align))
 			return;
 		/*
-		 * dest can start out unaligned to a 1024 byte chunk size,
+		 * dest can start out unaligned to a TAR auto-increment region,
 		 * so we have to calculate how much is left of the chunk.
 		 * We also have to take into account how much of the chunk the caller
 		 * has requested we fill.
 		 */
-		const size_t chunk_remaining = MIN(1024 - ((dest + offset) & 0x3ffU), len - offset);
+		const size_t chunk_remaining = MIN(tar_wrap - ((dest + offset) & (tar_wrap - 1U)), len - offset);
 		const size_t blocks = chunk_remaining >> align;
-		for (size_t i = 0; i < blocks; i += blocks_per_transfer) {
-			/* blocks - i gives how many blocks are left to transfer in this 1024 byte chunk */
-			const size_t transfer_length = MIN(blocks - i, blocks_per_transfer) << align;
-			if (!dap_mem_write_block(&ap->base, dest + offset, data + offset, transfer_length, align)) {
-				DEBUG_WIRE("%s failed: %u\n", __func__, ap->base.dp->fault);
-				return;
-			}
-			offset += transfer_length;
+		/* Run the whole chunk as a batch of block transfers so they can be pipelined */
+		if (!dap_mem_write_blocks(
+				&ap->base, dest + offset, data + offset, blocks << align, align, blocks_per_transfer)) {
+			DEBUG_WIRE("%s failed: %u\n", __func__, ap->base.dp->fault);
+			return;
 		}
+		offset += chunk_remaining;
 	}
 	DEBUG_WIRE("%s transferred %zu blocks\n", __func__, len >> align);
 
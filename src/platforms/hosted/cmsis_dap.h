@@ -25,6 +25,7 @@
 #include "bmp_hosted.h"
 #include "adiv5.h"
 #include "cli.h"
+#include "swo.h"
 
 bool dap_init(bool allow_fallback);
 void dap_exit_function(void);
@@ -37,5 +38,11 @@ uint32_t dap_max_frequency(uint32_t clock);
 void dap_swd_configure(uint8_t cfg);
 bool dap_nrst_get_val(void);
 bool dap_nrst_set_val(bool assert);
+/* The adaptor's bulk interface, or NULL if it's being driven over HID */
+const usb_link_s *dap_bulk_link(void);
+
+bool dap_swo_start(swo_coding_e mode, uint32_t baudrate, uint32_t *actual_baudrate);
+void dap_swo_stop(void);
+size_t dap_swo_read(uint8_t *data, size_t length);
 
 #endif /* PLATFORMS_HOSTED_CMSIS_DAP_H */
@@ -0,0 +1,261 @@
+/*
+ * This file is part of the Black Magic Debug project.
+ *
+ * Copyright (C) 2026 1BitSquared <info@1bitsquared.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * This file implements writing ELF core files of a halted target, so that its state can be captured in the
+ * field and then picked apart offline in GDB without the board having to stay attached.
+ *
+ * The file is an ET_CORE image with a PT_NOTE segment holding a single NT_PRSTATUS note, laid out as the
+ * 32-bit ARM Linux struct elf_prstatus that GDB's ARM core file support reads the registers from, followed by
+ * a PT_LOAD segment for each memory region. The registers go first so a failure part way through reading a
+ * large region still leaves something useful behind.
+ */
+
+#include "general.h"
+#include "target.h"
+#include "target_internal.h"
+#include "cortexm.h"
+#include "buffer_utils.h"
+#include "coredump.h"
+
+#include <errno.h>
+
+#define COREDUMP_MAX_REGIONS 32U
+/* How many bytes to ask the target for at a time, big enough to keep the probe's block read path busy */
+#define COREDUMP_CHUNK_SIZE 65536U
+
+#define ELF_HEADER_SIZE  52U
+#define ELF_PHDR_SIZE    32U
+#define ELF_ET_CORE      4U
+#define ELF_EM_ARM       40U
+#define ELF_PT_LOAD      1U
+#define ELF_PT_NOTE      4U
+#define ELF_PF_RWX       7U
+#define ELF_NT_PRSTATUS  1U
+/* The note header, then its name "CORE" padded out to 4 byte alignment */
+#define ELF_NOTE_HEADER_SIZE 20U
+
+/* struct elf_prstatus for 32-bit ARM, with the general purpose registers and CPSR in pr_reg */
+#define ELF_PRSTATUS_SIZE      148U
+#define ELF_PRSTATUS_CURSIG    12U
+#define ELF_PRSTATUS_PID       24U
+#define ELF_PRSTATUS_REG       72U
+#define ELF_PRSTATUS_REG_COUNT 17U
+#define ELF_SIGTRAP            5U
+
+typedef struct coredump_region {
+	uint32_t start;
+	uint32_t length;
+} coredump_region_s;
+
+typedef struct coredump {
+	coredump_region_s regions[COREDUMP_MAX_REGIONS];
+	size_t count;
+} coredump_s;
+
+static bool coredump_add_region(coredump_s *const dump, const uint32_t start, const uint32_t length)
+{
+	if (!length)
+		return true;
+	if (dump->count == COREDUMP_MAX_REGIONS)
+		return false;
+	dump->regions[dump->count++] = (coredump_region_s){start, length};
+	return true;
+}
+
+/* Add the parts of a RAM region that its memory map policy says are safe to read in bulk */
+static bool coredump_add_ram(target_s *const target, coredump_s *const dump, const target_ram_s *const ram)
+{
+	const target_addr64_t end = (target_addr64_t)ram->start + ram->length;
+	for (target_addr64_t addr = ram->start; addr < end;) {
+		target_addr64_t run_end = 0U;
+		const uint8_t policy = target_mem_policy(target, (uint32_t)addr, &run_end);
+		run_end = MIN(run_end, end);
+		if ((policy & (TARGET_MEM_READ_SAFE | TARGET_MEM_AVOID)) == TARGET_MEM_READ_SAFE &&
+			!coredump_add_region(dump, (uint32_t)addr, (uint32_t)(run_end - addr)))
+			return false;
+		addr = run_end;
+	}
+	return true;
+}
+
+/* Parse a comma separated list of ADDR:LENGTH pairs */
+static bool coredump_parse_regions(coredump_s *const dump, const char *spec)
+{
+	while (*spec) {
+		char *end = NULL;
+		const uint32_t start = strtoul(spec, &end, 0);
+		if (end == spec || *end != ':')
+			return false;
+		spec = end + 1U;
+		const uint32_t length = strtoul(spec, &end, 0);
+		if (end == spec || (*end != ',' && *end != '\0') || !coredump_add_region(dump, start, length))
+			return false;
+		spec = *end ? end + 1U : end;
+	}
+	return true;
+}
+
+static void coredump_write_phdr(uint8_t *const header, const size_t offset, const uint32_t type,
+	const uint32_t file_offset, const uint32_t vaddr, const uint32_t size)
+{
+	write_le4(header, offset, type);
+	write_le4(header, offset + 4U, file_offset);
+	write_le4(header, offset + 8U, vaddr);
+	write_le4(header, offset + 12U, vaddr);
+	write_le4(header, offset + 16U, size);
+	write_le4(header, offset + 20U, size);
+	write_le4(header, offset + 24U, type == ELF_PT_LOAD ? ELF_PF_RWX : 0U);
+	write_le4(header, offset + 28U, type == ELF_PT_LOAD ? 1U : 4U);
+}
+
+/* Build the ELF header, program headers and register note that make up the start of the file */
+static uint8_t *coredump_build_header(target_s *const target, const coredump_s *const dump, size_t *const length)
+{
+	const size_t phdrs = dump->count + 1U;
+	const size_t note_offset = ELF_HEADER_SIZE + (phdrs * ELF_PHDR_SIZE);
+	*length = note_offset + ELF_NOTE_HEADER_SIZE + ELF_PRSTATUS_SIZE;
+	uint8_t *const header = calloc(1U, *length);
+	uint32_t *const regs = calloc(1U, target_regs_size(target));
+	if (!header || !regs) { /* calloc failed: heap exhaustion */
+		DEBUG_ERROR("calloc: failed in %s\n", __func__);
+		free(header);
+		free(regs);
+		return NULL;
+	}
+
+	/* e_ident: 32-bit, little endian, version 1 */
+	memcpy(header, "\x7f" "ELF\x01\x01\x01", 7U);
+	write_le2(header, 16U, ELF_ET_CORE);
+	write_le2(header, 18U, ELF_EM_ARM);
+	write_le4(header, 20U, 1U);
+	write_le4(header, 28U, ELF_HEADER_SIZE);
+	write_le2(header, 40U, ELF_HEADER_SIZE);
+	write_le2(header, 42U, ELF_PHDR_SIZE);
+	write_le2(header, 44U, (uint16_t)phdrs);
+
+	coredump_write_phdr(header, ELF_HEADER_SIZE, ELF_PT_NOTE, (uint32_t)note_offset, 0U,
+		ELF_NOTE_HEADER_SIZE + ELF_PRSTATUS_SIZE);
+	uint32_t offset = (uint32_t)*length;
+	for (size_t idx = 0U; idx < dump->count; ++idx) {
+		const coredump_region_s *const region = &dump->regions[idx];
+		coredump_write_phdr(
+			header, ELF_HEADER_SIZE + ((idx + 1U) * ELF_PHDR_SIZE), ELF_PT_LOAD, offset, region->start, region->length);
+		offset += region->length;
+	}
+
+	uint8_t *const note = header + note_offset;
+	write_le4(note, 0U, 5U);
+	write_le4(note, 4U, ELF_PRSTATUS_SIZE);
+	write_le4(note, 8U, ELF_NT_PRSTATUS);
+	memcpy(note + 12U, "CORE", 4U);
+	uint8_t *const prstatus = note + ELF_NOTE_HEADER_SIZE;
+	write_le2(prstatus, ELF_PRSTATUS_CURSIG, ELF_SIGTRAP);
+	write_le4(prstatus, ELF_PRSTATUS_PID, 1U);
+	/* The Cortex-M register file starts r0-r15 then xPSR, which is where elf_prstatus has CPSR */
+	target_regs_read(target, regs);
+	for (size_t reg = 0U; reg < ELF_PRSTATUS_REG_COUNT; ++reg)
+		write_le4(prstatus, ELF_PRSTATUS_REG + (reg * 4U), regs[reg]);
+	free(regs);
+	return header;
+}
+
+/*
+ * Copy a region of target memory into the file, zero-filling any chunk the target won't give up, and any
+ * part of the region its memory map policy says is known to fault or stall so isn't even tried
+ */
+static bool coredump_write_region(
+	target_s *const target, FILE *const file, const coredump_region_s *const region, uint8_t *const buffer)
+{
+	size_t failed = 0U;
+	for (uint32_t offset = 0U; offset < region->length;) {
+		target_addr64_t run_end = 0U;
+		const uint8_t policy = target_mem_policy(target, region->start + offset, &run_end);
+		const uint32_t amount =
+			(uint32_t)MIN(MIN(region->length - offset, COREDUMP_CHUNK_SIZE), run_end - (region->start + offset));
+		if ((policy & TARGET_MEM_AVOID) || target_mem32_read(target, buffer, region->start + offset, amount)) {
+			memset(buffer, 0, amount);
+			failed += amount;
+		}
+		if (fwrite(buffer, 1U, amount, file) != amount)
+			return false;
+		offset += amount;
+	}
+	if (failed)
+		tc_printf(target, "Failed to read %zu bytes of the region at 0x%08" PRIx32 ", zero-filled\n", failed,
+			region->start);
+	return true;
+}
+
+bool coredump_write(
+	target_s *const target, const char *const file, const char *const *const regions, const size_t region_count)
+{
+	if (!target_is_cortexm(target)) {
+		tc_printf(target, "Core dumps are only supported on Cortex-M targets\n");
+		return false;
+	}
+
+	coredump_s dump = {0};
+	for (const target_ram_s *ram = target->ram; ram; ram = ram->next) {
+		if (!coredump_add_ram(target, &dump, ram)) {
+			tc_printf(target, "Too many memory regions to dump\n");
+			return false;
+		}
+	}
+	for (size_t idx = 0U; idx < region_count; ++idx) {
+		if (!coredump_parse_regions(&dump, regions[idx])) {
+			tc_printf(target, "Invalid region list '%s', expected ADDR:LENGTH[,ADDR:LENGTH...]\n", regions[idx]);
+			return false;
+		}
+	}
+
+	size_t header_length = 0U;
+	uint8_t *const header = coredump_build_header(target, &dump, &header_length);
+	uint8_t *const buffer = malloc(COREDUMP_CHUNK_SIZE);
+	FILE *const core = header && buffer ? fopen(file, "wb") : NULL;
+	bool result = core != NULL;
+	if (header && buffer && !core)
+		tc_printf(target, "Error opening %s for writing: %s\n", file, strerror(errno));
+	if (!header || !buffer)
+		DEBUG_ERROR("malloc: failed in %s\n", __func__);
+
+	const uint32_t start_time = platform_time_ms();
+	size_t total = 0U;
+	if (result)
+		result = fwrite(header, 1U, header_length, core) == header_length;
+	for (size_t idx = 0U; result && idx < dump.count; ++idx) {
+		result = coredump_write_region(target, core, &dump.regions[idx], buffer);
+		total += dump.regions[idx].length;
+	}
+	if (core) {
+		if (fclose(core) != 0)
+			result = false;
+		if (!result)
+			tc_printf(target, "Write to %s failed: %s\n", file, strerror(errno));
+	}
+	free(buffer);
+	free(header);
+
+	if (result) {
+		const uint32_t elapsed = MAX(platform_time_ms() - start_time, 1U);
+		tc_printf(target, "Wrote %zu bytes from %zu regions to %s, %8.3fkiB/s\n", total, dump.count, file,
+			(double)total / elapsed);
+	}
+	return result;
+}
@@ -0,0 +1,33 @@
+/*
+ * This file is part of the Black Magic Debug project.
+ *
+ * Copyright (C) 2026 1BitSquared <info@1bitsquared.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef PLATFORMS_HOSTED_COREDUMP_H
+#define PLATFORMS_HOSTED_COREDUMP_H
+
+#include "target.h"
+
+/*
+ * Write an ELF core file of an attached, halted Cortex-M target to file: its registers as an NT_PRSTATUS note,
+ * then all of its RAM and any extra regions given. Each of the region_count strings in regions is a comma
+ * separated list of ADDR:LENGTH pairs, for picking out peripherals to include. Progress and errors are
+ * reported through tc_printf().
+ */
+bool coredump_write(target_s *target, const char *file, const char *const *regions, size_t region_count);
+
+#endif /* PLATFORMS_HOSTED_COREDUMP_H */
@@ -37,6 +37,7 @@
 #include "dap_command.h"
 #include "jtag_scan.h"
 #include "buffer_utils.h"
+#include "adi.h"
 
 #define DAP_TRANSFER_APnDP (1U << 0U)
 #define DAP_TRANSFER_RnW   (1U << 1U)
@@ -268,6 +269,37 @@ void dap_write_reg(adiv5_debug_port_s *target_dp, const uint8_t reg, const uint3
 	} while (target_dp->fault == DAP_TRANSFER_WAIT);
 }
 
+bool dap_dp_transfers(adiv5_debug_port_s *const target_dp, const adiv5_transfer_s *const transfers, const size_t count)
+{
+	if (count > ADIV5_TRANSFER_QUEUE_DEPTH)
+		return false;
+
+	/* Translate the queued accesses into DAP_Transfer requests, counting how many reads there are */
+	dap_transfer_request_s requests[ADIV5_TRANSFER_QUEUE_DEPTH];
+	uint32_t results[ADIV5_TRANSFER_QUEUE_DEPTH];
+	size_t reads = 0U;
+	for (size_t idx = 0; idx < count; ++idx) {
+		const adiv5_transfer_s *const transfer = &transfers[idx];
+		requests[idx].request =
+			(transfer->addr & 0xcU) | ((transfer->addr & ADIV5_APnDP) ? DAP_TRANSFER_APnDP : 0U) |
+			(transfer->rnw == ADIV5_LOW_READ ? DAP_TRANSFER_RnW : 0U);
+		requests[idx].data = transfer->value;
+		if (transfer->rnw == ADIV5_LOW_READ)
+			++reads;
+	}
+
+	/* Run the whole batch as a single DAP_Transfer, which also takes care of AP read posting for us */
+	if (!perform_dap_transfer_recoverable(target_dp, requests, count, results, reads))
+		return false;
+
+	/* Deliver the read results back to where they were requested */
+	for (size_t idx = 0, result = 0; idx < count; ++idx) {
+		if (transfers[idx].rnw == ADIV5_LOW_READ)
+			*transfers[idx].result = results[result++];
+	}
+	return true;
+}
+
 bool dap_mem_read_block(
 	adiv5_access_port_s *const target_ap, void *dest, target_addr64_t src, const size_t len, const align_e align)
 {
@@ -316,6 +348,71 @@ bool dap_mem_write_block(
 	return result;
 }
 
+/*
+ * Read a chunk of up to one TAR auto-increment region from the target's memory as a batch of DAP_TransferBlock
+ * requests of at most blocks_per_transfer blocks each, allowing the adaptor to process them back to back
+ */
+bool dap_mem_read_blocks(adiv5_access_port_s *const target_ap, void *dest, target_addr64_t src, const size_t len,
+	const align_e align, const size_t blocks_per_transfer)
+{
+	const size_t blocks = len >> MIN(align, 2U);
+	uint16_t block_counts[DAP_CHUNK_BLOCKS_MAX];
+	uint32_t data[DAP_CHUNK_BLOCKS_MAX] = {0U};
+	if (blocks > ARRAY_LENGTH(data) || !blocks_per_transfer)
+		return false;
+	size_t transfers = 0;
+	for (size_t i = 0; i < blocks; i += blocks_per_transfer)
+		block_counts[transfers++] = (uint16_t)MIN(blocks - i, blocks_per_transfer);
+
+	const bool result = perform_dap_transfer_block_reads(target_ap->dp, SWD_AP_DRW, block_counts, transfers, data);
+
+	/* Unpack the data from those blocks */
+	if (align > ALIGN_16BIT)
+		memcpy(dest, data, len);
+	else {
+		for (size_t i = 0; i < blocks; ++i) {
+			dest = adiv5_unpack_data(dest, src, data[i], align);
+			src += 1U << align;
+		}
+	}
+
+	/* Report if it actually failed and then propagate the failure up accordingly */
+	if (!result)
+		DEBUG_ERROR("dap_read_blocks failed\n");
+	return result;
+}
+
+/* As dap_mem_read_blocks(), but for writing a chunk of up to one TAR auto-increment region to the target's memory */
+bool dap_mem_write_blocks(adiv5_access_port_s *const target_ap, target_addr64_t dest, const void *src,
+	const size_t len, const align_e align, const size_t blocks_per_transfer)
+{
+	const size_t blocks = len >> MIN(align, 2U);
+	uint16_t block_counts[DAP_CHUNK_BLOCKS_MAX];
+	uint32_t data[DAP_CHUNK_BLOCKS_MAX];
+	if (blocks > ARRAY_LENGTH(data) || !blocks_per_transfer)
+		return false;
+	size_t transfers = 0;
+	for (size_t i = 0; i < blocks; i += blocks_per_transfer)
+		block_counts[transfers++] = (uint16_t)MIN(blocks - i, blocks_per_transfer);
+
+	/* Pack the data to send into 32-bit blocks */
+	if (align > ALIGN_16BIT)
+		memcpy(data, src, len);
+	else {
+		for (size_t i = 0; i < blocks; ++i) {
+			src = adiv5_pack_data(dest, src, data + i, align);
+			dest += 1U << align;
+		}
+	}
+
+	/* Try to write the blocks to the target's memory */
+	const bool result = perform_dap_transfer_block_writes(target_ap->dp, SWD_AP_DRW, block_counts, transfers, data);
+	/* Report if it actually failed and then propagate the failure up accordingly */
+	if (!result)
+		DEBUG_ERROR("dap_write_blocks failed\n");
+	return result;
+}
+
 static size_t dap_adiv5_mem_access_build(const adiv5_access_port_s *const target_ap,
 	dap_transfer_request_s *const transfer_requests, const target_addr64_t addr, const align_e align)
 {
@@ -362,6 +459,37 @@ bool dap_adiv5_mem_access_setup(adiv5_access_port_s *const target_ap, const targ
 	return perform_dap_transfer_recoverable(target_dp, requests, requests_count, NULL, 0U);
 }
 
+/*
+ * Build the SELECT1 and SELECT writes needed to address the bank holding addr on an ADIv6 AP, leaving out any
+ * the DP's shadows say are already in place. The shadows are updated as if the writes have been done, so the
+ * caller must invalidate them if the transfer these are part of then fails.
+ */
+static size_t dap_adiv6_select_build(
+	const adiv6_access_port_s *const target_ap, const uint16_t addr, dap_transfer_request_s *const transfer_requests)
+{
+	adiv5_debug_port_s *const target_dp = target_ap->base.dp;
+	uint32_t select1 = 0U;
+	uint32_t select = 0U;
+	const uint8_t writes = adi_ap_select_writes(&target_ap->base, addr, &select1, &select);
+	size_t count = 0U;
+	/* Set SELECT1 in the DP up first */
+	if (writes & ADIV5_SHADOW_SELECT1) {
+		transfer_requests[count].request = SWD_DP_W_SELECT;
+		transfer_requests[count++].data = ADIV5_DP_BANK5;
+		transfer_requests[count].request = SWD_DP_W_SELECT1;
+		transfer_requests[count++].data = select1;
+	}
+	/* Now set up SELECT in the DP */
+	if (writes & ADIV5_SHADOW_SELECT) {
+		transfer_requests[count].request = SWD_DP_W_SELECT;
+		transfer_requests[count++].data = select;
+	}
+	target_dp->select1_shadow = select1;
+	target_dp->select_shadow = select;
+	target_dp->shadow_valid |= ADIV5_SHADOW_SELECT1 | ADIV5_SHADOW_SELECT;
+	return count;
+}
+
 static size_t dap_adiv6_mem_access_build(const adiv6_access_port_s *const target_ap,
 	dap_transfer_request_s *const transfer_requests, const target_addr64_t addr, const align_e align)
 {
@@ -378,29 +506,19 @@ static size_t dap_adiv6_mem_access_build(const adiv6_access_port_s *const target
 		csw |= ADIV5_AP_CSW_SIZE_WORD;
 		break;
 	}
-	/* Select the AP base address via SELECT1 */
-	transfer_requests[0].request = SWD_DP_W_SELECT;
-	transfer_requests[0].data = ADIV5_DP_BANK5;
-	transfer_requests[1].request = SWD_DP_W_SELECT1;
-	transfer_requests[1].data = (uint32_t)(target_ap->ap_address >> 32U);
-	/* Select the bank for the CSW register */
-	transfer_requests[2].request = SWD_DP_W_SELECT;
-	transfer_requests[2].data = (uint32_t)target_ap->ap_address | (ADIV5_AP_CSW & ADIV6_AP_BANK_MASK);
+	/* Select the AP base address and the bank for the CSW register */
+	size_t count = dap_adiv6_select_build(target_ap, ADIV5_AP_CSW, transfer_requests);
 	/* Then write the CSW register to the new value */
-	transfer_requests[3].request = SWD_AP_CSW;
-	transfer_requests[3].data = csw;
+	transfer_requests[count].request = SWD_AP_CSW;
+	transfer_requests[count++].data = csw;
 	/* Finally write the TAR register to its new value */
 	if (target_ap->base.flags & ADIV5_AP_FLAGS_64BIT) {
-		transfer_requests[4].request = SWD_AP_TAR_HIGH;
-		transfer_requests[4].data = (uint32_t)(addr >> 32U);
-		transfer_requests[5].request = SWD_AP_TAR_LOW;
-		transfer_requests[5].data = (uint32_t)addr;
-		return 6U;
-	} else {
-		transfer_requests[4].request = SWD_AP_TAR_LOW;
-		transfer_requests[4].data = (uint32_t)addr;
-		return 5U;
+		transfer_requests[count].request = SWD_AP_TAR_HIGH;
+		transfer_requests[count++].data = (uint32_t)(addr >> 32U);
 	}
+	transfer_requests[count].request = SWD_AP_TAR_LOW;
+	transfer_requests[count++].data = (uint32_t)addr;
+	return count;
 }
 
 bool dap_adiv6_mem_access_setup(adiv6_access_port_s *const target_ap, const target_addr64_t addr, const align_e align)
@@ -410,7 +528,73 @@ bool dap_adiv6_mem_access_setup(adiv6_access_port_s *const target_ap, const targ
 	const size_t requests_count = dap_adiv6_mem_access_build(target_ap, requests, addr, align);
 	adiv5_debug_port_s *const target_dp = target_ap->base.dp;
 	/* The result of this call is then fed up the stack for proper handling */
-	return perform_dap_transfer_recoverable(target_dp, requests, requests_count, NULL, 0U);
+	const bool result = perform_dap_transfer_recoverable(target_dp, requests, requests_count, NULL, 0U);
+	if (!result)
+		adiv5_dp_shadow_invalidate(target_dp);
+	return result;
+}
+
+/*
+ * Plan out and stream a read of any length as one batch. The span is split up front at every
+ * TAR auto-increment boundary, and each chunk gets its own CSW and TAR setup ahead of its block reads.
+ */
+static bool dap_mem_read_stream(adiv5_access_port_s *const target_ap, const adiv6_access_port_s *const adiv6_ap,
+	void *dest, target_addr64_t src, const size_t len, const align_e align, const size_t blocks_per_transfer)
+{
+	const uint32_t tar_wrap = adiv5_ap_tar_wrap(target_ap);
+	const size_t chunk_count = ((src & (tar_wrap - 1U)) + len + tar_wrap - 1U) / tar_wrap;
+	const size_t blocks = len >> MIN(align, 2U);
+	dap_stream_chunk_s *const chunks = calloc(chunk_count, sizeof(*chunks));
+	uint32_t *const data = calloc(blocks, sizeof(*data));
+	if (!chunks || !data) { /* calloc failed: heap exhaustion */
+		DEBUG_ERROR("calloc: failed in %s\n", __func__);
+		free(chunks);
+		free(data);
+		return false;
+	}
+
+	for (size_t chunk = 0, offset = 0; offset < len; ++chunk) {
+		const target_addr64_t addr = src + offset;
+		const size_t chunk_length = MIN(tar_wrap - (addr & (tar_wrap - 1U)), len - offset);
+		chunks[chunk].setup_count = adiv6_ap ? dap_adiv6_mem_access_build(adiv6_ap, chunks[chunk].setup, addr, align) :
+											   dap_adiv5_mem_access_build(target_ap, chunks[chunk].setup, addr, align);
+		chunks[chunk].block_count = (uint16_t)(chunk_length >> align);
+		offset += chunk_length;
+	}
+
+	const bool result = perform_dap_transfer_block_read_stream(
+		target_ap->dp, SWD_AP_DRW, chunks, chunk_count, blocks_per_transfer, data);
+
+	/* Unpack the data from those blocks */
+	if (align > ALIGN_16BIT)
+		memcpy(dest, data, len);
+	else {
+		for (size_t i = 0; i < blocks; ++i) {
+			dest = adiv5_unpack_data(dest, src, data[i], align);
+			src += 1U << align;
+		}
+	}
+
+	free(chunks);
+	free(data);
+	/* Report if it actually failed and then propagate the failure up accordingly */
+	if (!result) {
+		DEBUG_ERROR("dap_read_stream failed\n");
+		adiv5_dp_shadow_invalidate(target_ap->dp);
+	}
+	return result;
+}
+
+bool dap_adiv5_mem_read_stream(adiv5_access_port_s *const target_ap, void *const dest, const target_addr64_t src,
+	const size_t len, const align_e align, const size_t blocks_per_transfer)
+{
+	return dap_mem_read_stream(target_ap, NULL, dest, src, len, align, blocks_per_transfer);
+}
+
+bool dap_adiv6_mem_read_stream(adiv6_access_port_s *const target_ap, void *const dest, const target_addr64_t src,
+	const size_t len, const align_e align, const size_t blocks_per_transfer)
+{
+	return dap_mem_read_stream(&target_ap->base, target_ap, dest, src, len, align, blocks_per_transfer);
 }
 
 uint32_t dap_adiv5_ap_read(adiv5_access_port_s *const target_ap, const uint16_t addr)
@@ -451,20 +635,15 @@ uint32_t dap_adiv6_ap_read(adiv5_access_port_s *const base_ap, const uint16_t ad
 	adiv6_access_port_s *const target_ap = (adiv6_access_port_s *)base_ap;
 	dap_transfer_request_s requests[4];
 	DEBUG_PROBE("%s addr %x\n", __func__, addr);
-	/* Set SELECT1 in the DP up first */
-	requests[0].request = SWD_DP_W_SELECT;
-	requests[0].data = ADIV5_DP_BANK5;
-	requests[1].request = SWD_DP_W_SELECT1;
-	requests[1].data = (uint32_t)(target_ap->ap_address >> 32U);
-	/* Now set up SELECT in the DP */
-	requests[2].request = SWD_DP_W_SELECT;
-	requests[2].data = (uint32_t)target_ap->ap_address | (addr & ADIV6_AP_BANK_MASK);
+	/* Set SELECT1 and SELECT in the DP up to address the AP register, if they aren't already */
+	const size_t count = dap_adiv6_select_build(target_ap, addr, requests);
 	/* Read the register */
-	requests[3].request = (addr & 0x0cU) | DAP_TRANSFER_RnW | (addr & ADIV5_APnDP ? DAP_TRANSFER_APnDP : 0);
+	requests[count].request = (addr & 0x0cU) | DAP_TRANSFER_RnW | (addr & ADIV5_APnDP ? DAP_TRANSFER_APnDP : 0);
 	uint32_t result = 0;
 	adiv5_debug_port_s *const target_dp = base_ap->dp;
-	if (!perform_dap_transfer(target_dp, requests, 4U, &result, 1U)) {
+	if (!perform_dap_transfer(target_dp, requests, count + 1U, &result, 1U)) {
 		DEBUG_ERROR("%s failed (fault = %u)\n", __func__, target_dp->fault);
+		adiv5_dp_shadow_invalidate(target_dp);
 		return 0U;
 	}
 	return result;
@@ -475,20 +654,16 @@ void dap_adiv6_ap_write(adiv5_access_port_s *const base_ap, const uint16_t addr,
 	adiv6_access_port_s *const target_ap = (adiv6_access_port_s *)base_ap;
 	dap_transfer_request_s requests[4];
 	DEBUG_PROBE("%s addr %04x value %08" PRIx32 "\n", __func__, addr, value);
-	/* Set SELECT1 in the DP up first */
-	requests[0].request = SWD_DP_W_SELECT;
-	requests[0].data = ADIV5_DP_BANK5;
-	requests[1].request = SWD_DP_W_SELECT1;
-	requests[1].data = (uint32_t)(target_ap->ap_address >> 32U);
-	/* Now set up SELECT in the DP */
-	requests[2].request = SWD_DP_W_SELECT;
-	requests[2].data = (uint32_t)target_ap->ap_address | (addr & ADIV6_AP_BANK_MASK);
+	/* Set SELECT1 and SELECT in the DP up to address the AP register, if they aren't already */
+	const size_t count = dap_adiv6_select_build(target_ap, addr, requests);
 	/* Write the register */
-	requests[3].request = (addr & 0x0cU) | (addr & ADIV5_APnDP ? DAP_TRANSFER_APnDP : 0);
-	requests[3].data = value;
+	requests[count].request = (addr & 0x0cU) | (addr & ADIV5_APnDP ? DAP_TRANSFER_APnDP : 0);
+	requests[count].data = value;
 	adiv5_debug_port_s *const target_dp = base_ap->dp;
-	if (!perform_dap_transfer(target_dp, requests, 4U, NULL, 0U))
+	if (!perform_dap_transfer(target_dp, requests, count + 1U, NULL, 0U)) {
 		DEBUG_ERROR("%s failed (fault = %u)\n", __func__, target_dp->fault);
+		adiv5_dp_shadow_invalidate(target_dp);
+	}
 }
 
 void dap_adiv5_mem_read_single(
@@ -531,6 +706,7 @@ void dap_adiv6_mem_read_single(
 	adiv5_debug_port_s *target_dp = target_ap->base.dp;
 	if (!perform_dap_transfer_recoverable(target_dp, requests, requests_count + 1U, &result, 1U)) {
 		DEBUG_ERROR("dap_read_single failed (fault = %u)\n", target_dp->fault);
+		adiv5_dp_shadow_invalidate(target_dp);
 		memset(dest, 0, 1U << align);
 		return;
 	}
@@ -547,6 +723,8 @@ void dap_adiv6_mem_write_single(
 	/* Pack data into correct data lane */
 	adiv5_pack_data(dest, src, &requests[requests_count].data, align);
 	adiv5_debug_port_s *target_dp = target_ap->base.dp;
-	if (!perform_dap_transfer_recoverable(target_dp, requests, requests_count + 1U, NULL, 0U))
+	if (!perform_dap_transfer_recoverable(target_dp, requests, requests_count + 1U, NULL, 0U)) {
 		DEBUG_ERROR("dap_write_single failed (fault = %u)\n", target_dp->fault);
+		adiv5_dp_shadow_invalidate(target_dp);
+	}
 }
@@ -39,6 +39,15 @@
 #include "adiv5.h"
 #include "adiv6.h"
 
+/* A single command/response exchange with the adaptor as part of a pipelined batch */
+typedef struct dap_exchange {
+	const void *request;
+	size_t request_length;
+	void *response;
+	size_t response_length;
+	size_t actual_length;
+} dap_exchange_s;
+
 typedef enum dap_info {
 	DAP_INFO_VENDOR = 0x01U,
 	DAP_INFO_PRODUCT = 0x02U,
@@ -78,6 +87,7 @@ extern uint8_t dap_caps;
 extern dap_cap_e dap_mode;
 extern uint8_t dap_quirks;
 extern bool dap_has_swd_sequence;
+extern bool dap_has_execute_commands;
 
 bool dap_connect(void);
 bool dap_disconnect(void);
@@ -99,13 +109,24 @@ bool dap_adiv6_mem_access_setup(adiv6_access_port_s *target_ap, target_addr64_t
 bool dap_mem_read_block(adiv5_access_port_s *target_ap, void *dest, target_addr64_t src, size_t len, align_e align);
 bool dap_mem_write_block(
 	adiv5_access_port_s *target_ap, target_addr64_t dest, const void *src, size_t len, align_e align);
+bool dap_adiv5_mem_read_stream(adiv5_access_port_s *target_ap, void *dest, target_addr64_t src, size_t len,
+	align_e align, size_t blocks_per_transfer);
+bool dap_adiv6_mem_read_stream(adiv6_access_port_s *target_ap, void *dest, target_addr64_t src, size_t len,
+	align_e align, size_t blocks_per_transfer);
+bool dap_mem_read_blocks(adiv5_access_port_s *target_ap, void *dest, target_addr64_t src, size_t len, align_e align,
+	size_t blocks_per_transfer);
+bool dap_mem_write_blocks(adiv5_access_port_s *target_ap, target_addr64_t dest, const void *src, size_t len,
+	align_e align, size_t blocks_per_transfer);
+size_t dap_max_transfer_data(size_t command_header_len);
 bool dap_run_cmd(const void *request_data, size_t request_length, void *response_data, size_t response_length);
 bool dap_run_transfer(const void *request_data, size_t request_length, void *response_data, size_t response_length,
 	size_t *actual_length);
+bool dap_run_transfers(dap_exchange_s *commands, size_t count);
 bool dap_jtag_configure(void);
 
 void dap_dp_abort(adiv5_debug_port_s *target_dp, uint32_t abort);
 uint32_t dap_dp_raw_access(adiv5_debug_port_s *target_dp, uint8_t rnw, uint16_t addr, uint32_t value);
 uint32_t dap_dp_read_reg(adiv5_debug_port_s *target_dp, uint16_t addr);
+bool dap_dp_transfers(adiv5_debug_port_s *target_dp, const adiv5_transfer_s *transfers, size_t count);
 
 #endif /* PLATFORMS_HOSTED_DAP_H */
@@ -50,6 +50,9 @@
 
 #define DAP_TRANSFER_STATUS_MASK 0x7U
 
+/* Large enough for a DAP_Transfer carrying all 6 of a streamed chunk's setup accesses */
+#define DAP_STREAM_REQUEST_LEN (3U + (6U * 5U))
+
 static size_t dap_encode_transfer(
 	const dap_transfer_request_s *const transfer, uint8_t *const buffer, const size_t offset)
 {
@@ -235,6 +238,234 @@ bool perform_dap_transfer_block_write(
 	return false;
 }
 
+/*
+ * Run a sequence of block reads of the same register back to back, letting the adaptor pipeline them.
+ * block_counts gives the number of blocks for each DAP_TransferBlock, and the data is stored consecutively in blocks
+ */
+bool perform_dap_transfer_block_reads(adiv5_debug_port_s *const target_dp, const uint8_t reg,
+	const uint16_t *const block_counts, const size_t transfers, uint32_t *const blocks)
+{
+	dap_transfer_block_request_read_s *const requests = calloc(transfers, sizeof(*requests));
+	dap_transfer_block_response_read_s *const responses = calloc(transfers, sizeof(*responses));
+	dap_exchange_s *const commands = calloc(transfers, sizeof(*commands));
+	if (!requests || !responses || !commands) { /* calloc failed: heap exhaustion */
+		DEBUG_ERROR("calloc: failed in %s\n", __func__);
+		free(requests);
+		free(responses);
+		free(commands);
+		return false;
+	}
+
+	DEBUG_PROBE("-> dap_transfer_block (%zu pipelined block reads)\n", transfers);
+	for (size_t idx = 0; idx < transfers; ++idx) {
+		requests[idx].command = DAP_TRANSFER_BLOCK;
+		requests[idx].index = target_dp->dev_index;
+		write_le2(requests[idx].block_count, 0, block_counts[idx]);
+		requests[idx].request = reg | DAP_TRANSFER_RnW;
+		commands[idx].request = &requests[idx];
+		commands[idx].request_length = sizeof(requests[idx]);
+		commands[idx].response = &responses[idx];
+		commands[idx].response_length = DAP_CMD_BLOCK_READ_HDR_LEN + (size_t)(block_counts[idx] * 4U);
+	}
+	dap_run_transfers(commands, transfers);
+
+	/* Walk the responses in order, stopping at the first one that failed */
+	bool result = true;
+	size_t offset = 0;
+	for (size_t idx = 0; idx < transfers && result; ++idx) {
+		const dap_transfer_block_response_read_s *const response = &responses[idx];
+		if (commands[idx].actual_length < DAP_CMD_BLOCK_READ_HDR_LEN) {
+			result = false;
+			break;
+		}
+		const uint16_t blocks_read = MIN(read_le2(response->count, 0), block_counts[idx]);
+		for (size_t i = 0U; i < blocks_read; ++i)
+			blocks[offset + i] = read_le4(response->data[i], 0);
+		offset += block_counts[idx];
+		const uint8_t status = response->status & DAP_TRANSFER_STATUS_MASK;
+		if (status != DAP_TRANSFER_OK || blocks_read != block_counts[idx]) {
+			/* If the target didn't like something about what we asked it to do, mark the DP with the status code */
+			target_dp->fault = status;
+			DEBUG_PROBE("-> transfer failed with %u after processing %u blocks\n", response->status, blocks_read);
+			/* If this was a WAIT timeout, abort the ongoing transaction to bring the AP back to sanity */
+			if (status == DAP_TRANSFER_WAIT) {
+				DEBUG_ERROR("SWD access resulted in wait, aborting\n");
+				target_dp->abort(target_dp, ADIV5_DP_ABORT_DAPABORT);
+			}
+			result = false;
+		}
+	}
+
+	free(requests);
+	free(responses);
+	free(commands);
+	return result;
+}
+
+/* As perform_dap_transfer_block_reads(), but for writing the data in blocks */
+bool perform_dap_transfer_block_writes(adiv5_debug_port_s *const target_dp, const uint8_t reg,
+	const uint16_t *const block_counts, const size_t transfers, const uint32_t *const blocks)
+{
+	dap_transfer_block_request_write_s *const requests = calloc(transfers, sizeof(*requests));
+	dap_transfer_block_response_write_s *const responses = calloc(transfers, sizeof(*responses));
+	dap_exchange_s *const commands = calloc(transfers, sizeof(*commands));
+	if (!requests || !responses || !commands) { /* calloc failed: heap exhaustion */
+		DEBUG_ERROR("calloc: failed in %s\n", __func__);
+		free(requests);
+		free(responses);
+		free(commands);
+		return false;
+	}
+
+	DEBUG_PROBE("-> dap_transfer_block (%zu pipelined block writes)\n", transfers);
+	size_t offset = 0;
+	for (size_t idx = 0; idx < transfers; ++idx) {
+		requests[idx].command = DAP_TRANSFER_BLOCK;
+		requests[idx].index = target_dp->dev_index;
+		write_le2(requests[idx].block_count, 0, block_counts[idx]);
+		requests[idx].request = reg & ~DAP_TRANSFER_RnW;
+		for (size_t i = 0; i < block_counts[idx]; ++i)
+			write_le4(requests[idx].data[i], 0, blocks[offset + i]);
+		offset += block_counts[idx];
+		commands[idx].request = &requests[idx];
+		commands[idx].request_length = DAP_CMD_BLOCK_WRITE_HDR_LEN + (size_t)(block_counts[idx] * 4U);
+		commands[idx].response = &responses[idx];
+		commands[idx].response_length = sizeof(responses[idx]);
+	}
+	bool result = dap_run_transfers(commands, transfers);
+
+	/* Check the responses over in order, stopping at the first one that failed */
+	for (size_t idx = 0; idx < transfers && result; ++idx) {
+		const dap_transfer_block_response_write_s *const response = &responses[idx];
+		const uint16_t blocks_written = read_le2(response->count, 0);
+		const uint8_t status = response->status & DAP_TRANSFER_STATUS_MASK;
+		if (blocks_written == block_counts[idx] && status == DAP_TRANSFER_OK)
+			continue;
+		/* If the target didn't like something about what we asked it to do, mark the DP with the status code */
+		target_dp->fault = status;
+		DEBUG_PROBE("-> transfer failed with %u after processing %u blocks\n", response->status, blocks_written);
+		result = false;
+	}
+
+	free(requests);
+	free(responses);
+	free(commands);
+	return result;
+}
+
+/*
+ * Stream a read spanning several TAR auto-increment regions. The whole plan - a DAP_Transfer to set up
+ * CSW and TAR at the start of each chunk, followed by the DAP_TransferBlock requests to read it - is
+ * issued as a single batch so the adaptor never has to wait on us between packets.
+ * The data read is stored consecutively in blocks.
+ */
+bool perform_dap_transfer_block_read_stream(adiv5_debug_port_s *const target_dp, const uint8_t reg,
+	const dap_stream_chunk_s *const chunks, const size_t chunk_count, const size_t blocks_per_transfer,
+	uint32_t *const blocks)
+{
+	if (!blocks_per_transfer)
+		return false;
+	/* Work out how many packets the plan needs */
+	size_t exchange_count = 0;
+	for (size_t chunk = 0; chunk < chunk_count; ++chunk) {
+		if (chunks[chunk].block_count > DAP_CHUNK_BLOCKS_MAX || chunks[chunk].setup_count > 6U)
+			return false;
+		exchange_count += 1U + ((chunks[chunk].block_count + blocks_per_transfer - 1U) / blocks_per_transfer);
+	}
+
+	/* Each exchange gets a request and response buffer big enough for either kind of packet */
+	uint8_t(*const requests)[DAP_STREAM_REQUEST_LEN] = calloc(exchange_count, sizeof(*requests));
+	dap_transfer_block_response_read_s *const responses = calloc(exchange_count, sizeof(*responses));
+	dap_exchange_s *const exchanges = calloc(exchange_count, sizeof(*exchanges));
+	if (!requests || !responses || !exchanges) { /* calloc failed: heap exhaustion */
+		DEBUG_ERROR("calloc: failed in %s\n", __func__);
+		free(requests);
+		free(responses);
+		free(exchanges);
+		return false;
+	}
+
+	DEBUG_PROBE("-> dap_transfer_block (%zu chunk streamed read in %zu packets)\n", chunk_count, exchange_count);
+	size_t exchange = 0;
+	for (size_t chunk = 0; chunk < chunk_count; ++chunk) {
+		/* Set up the DAP_Transfer that points CSW and TAR at the start of the chunk */
+		uint8_t *const setup = requests[exchange];
+		setup[0] = DAP_TRANSFER;
+		setup[1] = target_dp->dev_index;
+		setup[2] = (uint8_t)chunks[chunk].setup_count;
+		size_t offset = 3U;
+		for (size_t i = 0; i < chunks[chunk].setup_count; ++i)
+			offset += dap_encode_transfer(&chunks[chunk].setup[i], setup, offset);
+		exchanges[exchange].request = setup;
+		exchanges[exchange].request_length = offset;
+		exchanges[exchange].response = &responses[exchange];
+		exchanges[exchange].response_length = 2U;
+		++exchange;
+
+		/* Then the block reads that cover it */
+		for (size_t i = 0; i < chunks[chunk].block_count; i += blocks_per_transfer, ++exchange) {
+			const uint16_t block_count = (uint16_t)MIN(chunks[chunk].block_count - i, blocks_per_transfer);
+			dap_transfer_block_request_read_s *const request = (dap_transfer_block_request_read_s *)requests[exchange];
+			request->command = DAP_TRANSFER_BLOCK;
+			request->index = target_dp->dev_index;
+			write_le2(request->block_count, 0, block_count);
+			request->request = reg | DAP_TRANSFER_RnW;
+			exchanges[exchange].request = request;
+			exchanges[exchange].request_length = sizeof(*request);
+			exchanges[exchange].response = &responses[exchange];
+			exchanges[exchange].response_length = DAP_CMD_BLOCK_READ_HDR_LEN + (size_t)(block_count * 4U);
+		}
+	}
+	dap_run_transfers(exchanges, exchange_count);
+
+	/* Now walk the plan again, checking each response in order and stopping at the first failure */
+	bool result = true;
+	size_t offset = 0;
+	exchange = 0;
+	for (size_t chunk = 0; chunk < chunk_count && result; ++chunk) {
+		const dap_transfer_response_s *const setup_response = (const dap_transfer_response_s *)&responses[exchange];
+		if (exchanges[exchange].actual_length < 2U || setup_response->processed != chunks[chunk].setup_count ||
+			(setup_response->status & DAP_TRANSFER_STATUS_MASK) != DAP_TRANSFER_OK) {
+			DEBUG_PROBE("-> chunk setup failed with %u\n", setup_response->status);
+			dap_dispatch_status(target_dp, setup_response->status);
+			result = false;
+			break;
+		}
+		++exchange;
+
+		for (size_t i = 0; i < chunks[chunk].block_count; i += blocks_per_transfer, ++exchange) {
+			const uint16_t block_count = (uint16_t)MIN(chunks[chunk].block_count - i, blocks_per_transfer);
+			const dap_transfer_block_response_read_s *const response = &responses[exchange];
+			if (exchanges[exchange].actual_length < DAP_CMD_BLOCK_READ_HDR_LEN) {
+				result = false;
+				break;
+			}
+			const uint16_t blocks_read = MIN(read_le2(response->count, 0), block_count);
+			for (size_t block = 0U; block < blocks_read; ++block)
+				blocks[offset + block] = read_le4(response->data[block], 0);
+			offset += block_count;
+			const uint8_t status = response->status & DAP_TRANSFER_STATUS_MASK;
+			if (status != DAP_TRANSFER_OK || blocks_read != block_count) {
+				/* If the target didn't like something about what we asked it to do, mark the DP with the status code */
+				target_dp->fault = status;
+				DEBUG_PROBE("-> transfer failed with %u after processing %u blocks\n", response->status, blocks_read);
+				/* If this was a WAIT timeout, abort the ongoing transaction to bring the AP back to sanity */
+				if (status == DAP_TRANSFER_WAIT) {
+					DEBUG_ERROR("SWD access resulted in wait, aborting\n");
+					target_dp->abort(target_dp, ADIV5_DP_ABORT_DAPABORT);
+				}
+				result = false;
+				break;
+			}
+		}
+	}
+
+	free(requests);
+	free(responses);
+	free(exchanges);
+	return result;
+}
+
 /* https://arm-software.github.io/CMSIS-DAP/latest/group__DAP__SWJ__Sequence.html */
 bool perform_dap_swj_sequence(size_t clock_cycles, const uint8_t *data)
 {
@@ -327,6 +558,66 @@ bool perform_dap_jtag_sequence(
 	return response[0] == DAP_RESPONSE_OK;
 }
 
+/* Find the length of the next run of cycles with constant TMS, up to the 64 a single DAP JTAG sequence can do */
+static size_t dap_jtag_tms_run(const uint8_t *const tms, const size_t cycle, const size_t clock_cycles)
+{
+	const bool tms_state = read_bit(tms, cycle);
+	size_t cycles = 1U;
+	while (cycles < 64U && cycle + cycles < clock_cycles && read_bit(tms, cycle + cycles) == tms_state)
+		++cycles;
+	return cycles;
+}
+
+bool perform_dap_jtag_raw_sequence(
+	const uint8_t *const tms, const uint8_t *const tdi, uint8_t *const tdo, const size_t clock_cycles)
+{
+	DEBUG_PROBE("-> dap_jtag_raw_sequence (%zu cycles)\n", clock_cycles);
+	uint8_t request[512U];
+	uint8_t response[512U];
+	const size_t max_length = MIN(dap_max_transfer_data(0U), sizeof(request));
+	const uint8_t capture_tdo = tdo ? DAP_JTAG_TDO_CAPTURE : 0U;
+	for (size_t cycle = 0U; cycle < clock_cycles;) {
+		/* Pack as many runs of constant TMS into the request as will fit, along with their responses */
+		const size_t start = cycle;
+		size_t offset = 2U;
+		size_t response_length = 1U;
+		uint8_t sequences = 0U;
+		while (cycle < clock_cycles && sequences < UINT8_MAX) {
+			const size_t cycles = dap_jtag_tms_run(tms, cycle, clock_cycles);
+			const size_t bytes = (cycles + 7U) >> 3U;
+			if (offset + 1U + bytes > max_length || (capture_tdo && response_length + bytes > max_length))
+				break;
+			/* The number of clock cycles to run is encoded with 64 remapped to 0 */
+			request[offset++] =
+				(cycles & 63U) | (read_bit(tms, cycle) ? DAP_JTAG_TMS_SET : DAP_JTAG_TMS_CLEAR) | capture_tdo;
+			copy_bits(request + offset, 0U, tdi, cycle, cycles);
+			offset += bytes;
+			if (capture_tdo)
+				response_length += bytes;
+			cycle += cycles;
+			++sequences;
+		}
+		request[0U] = DAP_JTAG_SEQUENCE;
+		request[1U] = sequences;
+		response[0U] = DAP_RESPONSE_OK;
+		if (!dap_run_cmd(request, offset, response, response_length) || response[0U] != DAP_RESPONSE_OK) {
+			DEBUG_PROBE("-> sequence failed with %u\n", response[0U]);
+			return false;
+		}
+		if (!tdo)
+			continue;
+		/* Walk the runs again to copy each one's captured data out into place */
+		size_t response_offset = 1U;
+		for (size_t run_cycle = start; run_cycle < cycle;) {
+			const size_t cycles = dap_jtag_tms_run(tms, run_cycle, cycle);
+			copy_bits(tdo, run_cycle, response + response_offset, 0U, cycles);
+			response_offset += (cycles + 7U) >> 3U;
+			run_cycle += cycles;
+		}
+	}
+	return true;
+}
+
 bool perform_dap_jtag_tms_sequence(const uint64_t tms_states, const size_t clock_cycles)
 {
 	/* Check for any over-long sequences */
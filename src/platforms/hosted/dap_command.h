@@ -53,7 +53,14 @@ typedef enum dap_command {
 	DAP_SWD_CONFIGURE = 0x13U,
 	DAP_JTAG_SEQUENCE = 0x14U,
 	DAP_JTAG_CONFIGURE = 0x15U,
+	DAP_SWO_TRANSPORT = 0x17U,
+	DAP_SWO_MODE = 0x18U,
+	DAP_SWO_BAUDRATE = 0x19U,
+	DAP_SWO_CONTROL = 0x1aU,
+	DAP_SWO_STATUS = 0x1bU,
+	DAP_SWO_DATA = 0x1cU,
 	DAP_SWD_SEQUENCE = 0x1dU,
+	DAP_EXECUTE_COMMANDS = 0x7fU,
 } dap_command_e;
 
 typedef enum dap_response_status {
@@ -91,6 +98,25 @@ typedef enum dap_info_status {
 #define DAP_SWJ_nTRST     (1U << 5U)
 #define DAP_SWJ_nRST      (1U << 7U)
 
+typedef enum dap_swo_transport {
+	DAP_SWO_TRANSPORT_NONE = 0U,
+	DAP_SWO_TRANSPORT_DATA_COMMAND = 1U,
+	DAP_SWO_TRANSPORT_STREAMING = 2U,
+} dap_swo_transport_e;
+
+typedef enum dap_swo_mode {
+	DAP_SWO_MODE_OFF = 0U,
+	DAP_SWO_MODE_UART = 1U,
+	DAP_SWO_MODE_MANCHESTER = 2U,
+} dap_swo_mode_e;
+
+#define DAP_SWO_CONTROL_STOP  0U
+#define DAP_SWO_CONTROL_START 1U
+
+#define DAP_SWO_STATUS_ACTIVE  (1U << 0U)
+#define DAP_SWO_STATUS_ERROR   (1U << 6U)
+#define DAP_SWO_STATUS_OVERRUN (1U << 7U)
+
 typedef struct dap_transfer_request {
 	uint8_t request;
 	uint32_t data;
@@ -145,6 +171,16 @@ typedef struct dap_swj_pins_request {
 	uint8_t wait_time[4];
 } dap_swj_pins_request_s;
 
+/* The most 32-bit blocks one TAR auto-increment region can hold, with the largest region we probe for */
+#define DAP_CHUNK_BLOCKS_MAX ((ADIV5_AP_TAR_WRAP_MIN << ADIV5_AP_TAR_INC_BITS_MAX) >> 2U)
+
+/* One TAR auto-increment region of a streamed read: the accesses to set up CSW and TAR, then the blocks to read */
+typedef struct dap_stream_chunk {
+	dap_transfer_request_s setup[6];
+	size_t setup_count;
+	uint16_t block_count;
+} dap_stream_chunk_s;
+
 bool perform_dap_transfer(adiv5_debug_port_s *target_dp, const dap_transfer_request_s *transfer_requests,
 	size_t requests, uint32_t *response_data, size_t responses);
 bool perform_dap_transfer_recoverable(adiv5_debug_port_s *target_dp, const dap_transfer_request_s *transfer_requests,
@@ -154,9 +190,16 @@ bool perform_dap_transfer_block_read(
 bool perform_dap_transfer_block_write(
 	adiv5_debug_port_s *target_dp, uint8_t reg, uint16_t block_count, const uint32_t *blocks);
 
+bool perform_dap_transfer_block_reads(
+	adiv5_debug_port_s *target_dp, uint8_t reg, const uint16_t *block_counts, size_t transfers, uint32_t *blocks);
+bool perform_dap_transfer_block_writes(adiv5_debug_port_s *target_dp, uint8_t reg, const uint16_t *block_counts,
+	size_t transfers, const uint32_t *blocks);
+bool perform_dap_transfer_block_read_stream(adiv5_debug_port_s *target_dp, uint8_t reg,
+	const dap_stream_chunk_s *chunks, size_t chunk_count, size_t blocks_per_transfer, uint32_t *blocks);
 bool perform_dap_swj_sequence(size_t clock_cycles, const uint8_t *data);
 
 bool perform_dap_jtag_sequence(const uint8_t *data_in, uint8_t *data_out, bool final_tms, size_t clock_cycles);
+bool perform_dap_jtag_raw_sequence(const uint8_t *tms, const uint8_t *tdi, uint8_t *tdo, size_t clock_cycles);
 bool perform_dap_jtag_tms_sequence(uint64_t tms_states, size_t clock_cycles);
 
 bool perform_dap_swd_sequences(dap_swd_sequence_s *sequences, uint8_t sequence_count);
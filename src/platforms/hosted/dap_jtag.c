@@ -41,6 +41,7 @@ static void dap_jtag_tms_seq(uint32_t tms_states, size_t clock_cycles);
 static void dap_jtag_tdi_tdo_seq(uint8_t *data_out, bool final_tms, const uint8_t *data_in, size_t clock_cycles);
 static void dap_jtag_tdi_seq(bool final_tms, const uint8_t *data_in, size_t clock_cycles);
 static bool dap_jtag_next(bool tms, bool tdi);
+static void dap_jtag_sequence(const uint8_t *tms, const uint8_t *tdi, uint8_t *tdo, size_t clock_cycles);
 
 bool dap_jtag_init(void)
 {
@@ -58,6 +59,7 @@ bool dap_jtag_init(void)
 	jtag_proc.jtagtap_tms_seq = dap_jtag_tms_seq;
 	jtag_proc.jtagtap_tdi_tdo_seq = dap_jtag_tdi_tdo_seq;
 	jtag_proc.jtagtap_tdi_seq = dap_jtag_tdi_seq;
+	jtag_proc.jtagtap_sequence = dap_jtag_sequence;
 
 	/* Ensure we're in JTAG mode */
 	for (size_t i = 0; i <= 50U; ++i)
@@ -82,6 +84,7 @@ void dap_jtag_dp_init(adiv5_debug_port_s *target_dp)
 	target_dp->dp_read = dap_dp_read_reg;
 	target_dp->low_access = dap_dp_raw_access;
 	target_dp->abort = dap_dp_abort;
+	target_dp->transfers = dap_dp_transfers;
 }
 
 static void dap_jtag_reset(void)
@@ -123,6 +126,13 @@ static bool dap_jtag_next(const bool tms, const bool tdi)
 	return tdo;
 }
 
+static void dap_jtag_sequence(
+	const uint8_t *const tms, const uint8_t *const tdi, uint8_t *const tdo, const size_t clock_cycles)
+{
+	if (!perform_dap_jtag_raw_sequence(tms, tdi, tdo, clock_cycles))
+		DEBUG_ERROR("jtagtap_sequence failed\n");
+}
+
 bool dap_jtag_configure(void)
 {
 	/* Check if there are no or too many devices */
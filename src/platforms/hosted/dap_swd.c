@@ -88,6 +88,7 @@ bool dap_swd_init(adiv5_debug_port_s *target_dp)
 	target_dp->dp_read = dap_dp_read_reg;
 	target_dp->low_access = dap_dp_raw_access;
 	target_dp->abort = dap_dp_abort;
+	target_dp->transfers = dap_dp_transfers;
 	return true;
 }
 
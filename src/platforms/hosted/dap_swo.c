@@ -0,0 +1,259 @@
+/*
+ * This file is part of the Black Magic Debug project.
+ *
+ * Copyright (C) 2026 1BitSquared <info@1bitsquared.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * This file implements SWO capture on CMSIS-DAP adaptors.
+ *
+ * Adaptors that have the v2 SWO streaming endpoint get a handful of bulk transfers kept in flight on it, so
+ * the data keeps flowing regardless of what else is happening on the command endpoint, and the completions
+ * (which run from whichever libusb event handling call happens next) queue it up for swo_poll() to consume.
+ * All other adaptors buffer the data themselves and are asked for it with DAP_SWO_Data each poll.
+ */
+
+#include "general.h"
+#include "bmp_hosted.h"
+#include "cmsis_dap.h"
+#include "dap.h"
+#include "dap_command.h"
+#include "buffer_utils.h"
+#include "swo.h"
+
+#include <libusb.h>
+
+#define DAP_SWO_TRANSFER_COUNT 4U
+#define DAP_SWO_TRANSFER_SIZE  16384U
+/* Must be a power of two, and has one byte kept free to tell full from empty */
+#define DAP_SWO_QUEUE_SIZE 65536U
+/* Largest DAP_SWO_Data payload asked for in one go, the adaptor's packet size permitting */
+#define DAP_SWO_DATA_MAX 1024U
+/* DAP_SWO_Data responses start with the status byte and the data length ahead of any data */
+#define DAP_SWO_DATA_HDR_LEN 3U
+
+static dap_swo_transport_e dap_swo_transport = DAP_SWO_TRANSPORT_NONE;
+static struct libusb_transfer *dap_swo_transfers[DAP_SWO_TRANSFER_COUNT];
+static size_t dap_swo_transfers_active = 0U;
+static uint8_t dap_swo_queue[DAP_SWO_QUEUE_SIZE];
+static size_t dap_swo_queue_head = 0U;
+static size_t dap_swo_queue_tail = 0U;
+
+static bool dap_swo_command(const dap_command_e command, const uint8_t value)
+{
+	const uint8_t request[2] = {command, value};
+	uint8_t result = DAP_RESPONSE_ERROR;
+	/* Execute it and check if it failed */
+	if (!dap_run_cmd(request, 2U, &result, 1U)) {
+		DEBUG_PROBE("%s failed\n", __func__);
+		return false;
+	}
+	return result == DAP_RESPONSE_OK;
+}
+
+/* Ask for a baud rate, returning the one the adaptor actually set up, or 0 if it can't do anything near it */
+static uint32_t dap_swo_baudrate(const uint32_t baudrate)
+{
+	uint8_t request[5] = {DAP_SWO_BAUDRATE};
+	write_le4(request, 1U, baudrate);
+	uint8_t response[4] = {0};
+	if (!dap_run_cmd(request, 5U, response, 4U)) {
+		DEBUG_PROBE("%s failed\n", __func__);
+		return 0U;
+	}
+	return read_le4(response, 0U);
+}
+
+static void dap_swo_queue_push(const uint8_t *data, size_t length)
+{
+	swo_stats.bytes_captured += length;
+	const size_t used = (dap_swo_queue_head - dap_swo_queue_tail) & (DAP_SWO_QUEUE_SIZE - 1U);
+	const size_t space = DAP_SWO_QUEUE_SIZE - 1U - used;
+	if (length > space) {
+		swo_stats.bytes_dropped += length - space;
+		++swo_stats.overflows;
+		length = space;
+	}
+	swo_stats.fill_max = MAX(swo_stats.fill_max, (uint32_t)(used + length));
+	while (length) {
+		const size_t amount = MIN(length, DAP_SWO_QUEUE_SIZE - dap_swo_queue_head);
+		memcpy(dap_swo_queue + dap_swo_queue_head, data, amount);
+		dap_swo_queue_head = (dap_swo_queue_head + amount) & (DAP_SWO_QUEUE_SIZE - 1U);
+		data += amount;
+		length -= amount;
+	}
+}
+
+static size_t dap_swo_queue_pop(uint8_t *const data, const size_t length)
+{
+	size_t result = 0U;
+	while (result < length && dap_swo_queue_tail != dap_swo_queue_head) {
+		const size_t end = dap_swo_queue_head > dap_swo_queue_tail ? dap_swo_queue_head : DAP_SWO_QUEUE_SIZE;
+		const size_t amount = MIN(length - result, end - dap_swo_queue_tail);
+		memcpy(data + result, dap_swo_queue + dap_swo_queue_tail, amount);
+		dap_swo_queue_tail = (dap_swo_queue_tail + amount) & (DAP_SWO_QUEUE_SIZE - 1U);
+		result += amount;
+	}
+	return result;
+}
+
+static void LIBUSB_CALL dap_swo_stream_callback(struct libusb_transfer *const transfer)
+{
+	if (transfer->status == LIBUSB_TRANSFER_COMPLETED)
+		dap_swo_queue_push(transfer->buffer, (size_t)transfer->actual_length);
+	/* Put the transfer straight back in flight for as long as the capture is running */
+	if (transfer->status == LIBUSB_TRANSFER_COMPLETED && dap_swo_transport == DAP_SWO_TRANSPORT_STREAMING &&
+		libusb_submit_transfer(transfer) == LIBUSB_SUCCESS)
+		return;
+	if (transfer->status != LIBUSB_TRANSFER_COMPLETED && transfer->status != LIBUSB_TRANSFER_CANCELLED)
+		DEBUG_ERROR("SWO streaming transfer failed (%d)\n", transfer->status);
+	--dap_swo_transfers_active;
+}
+
+static void dap_swo_stream_stop(const usb_link_s *const link)
+{
+	for (size_t idx = 0U; idx < DAP_SWO_TRANSFER_COUNT; ++idx) {
+		if (dap_swo_transfers[idx])
+			libusb_cancel_transfer(dap_swo_transfers[idx]);
+	}
+	/* Wait for the cancellations to come back before releasing the transfers */
+	while (dap_swo_transfers_active) {
+		if (libusb_handle_events(link->context) != LIBUSB_SUCCESS)
+			break;
+	}
+	for (size_t idx = 0U; idx < DAP_SWO_TRANSFER_COUNT; ++idx) {
+		libusb_free_transfer(dap_swo_transfers[idx]);
+		dap_swo_transfers[idx] = NULL;
+	}
+}
+
+static bool dap_swo_stream_start(const usb_link_s *const link)
+{
+	dap_swo_queue_head = 0U;
+	dap_swo_queue_tail = 0U;
+	for (size_t idx = 0U; idx < DAP_SWO_TRANSFER_COUNT; ++idx) {
+		struct libusb_transfer *const transfer = libusb_alloc_transfer(0);
+		uint8_t *const buffer = malloc(DAP_SWO_TRANSFER_SIZE);
+		if (!transfer || !buffer) { /* malloc failed: heap exhaustion */
+			DEBUG_ERROR("malloc: failed in %s\n", __func__);
+			libusb_free_transfer(transfer);
+			free(buffer);
+			return false;
+		}
+		/* No timeout, the transfers sit there until the target has something to say */
+		libusb_fill_bulk_transfer(transfer, link->device_handle, bmda_probe_info.swo_ep, buffer,
+			DAP_SWO_TRANSFER_SIZE, dap_swo_stream_callback, NULL, 0U);
+		transfer->flags = LIBUSB_TRANSFER_FREE_BUFFER;
+		dap_swo_transfers[idx] = transfer;
+		if (libusb_submit_transfer(transfer) != LIBUSB_SUCCESS) {
+			DEBUG_ERROR("Failed to start SWO streaming transfers\n");
+			return false;
+		}
+		++dap_swo_transfers_active;
+	}
+	return true;
+}
+
+bool dap_swo_start(const swo_coding_e mode, const uint32_t baudrate, uint32_t *const actual_baudrate)
+{
+	const uint8_t capability = mode == swo_manchester ? DAP_CAP_SWO_MANCHESTER : DAP_CAP_SWO_ASYNC;
+	if (!(dap_caps & capability)) {
+		DEBUG_ERROR("Adaptor does not support %s SWO capture\n", mode == swo_manchester ? "Manchester" : "UART");
+		return false;
+	}
+	dap_swo_stop();
+
+	/* Prefer the streaming endpoint where there is one, as it doesn't hold up the command endpoint */
+	const usb_link_s *const link = dap_bulk_link();
+	const dap_swo_transport_e transport = (dap_caps & DAP_CAP_SWO_STREAMING) && link && bmda_probe_info.swo_ep ?
+		DAP_SWO_TRANSPORT_STREAMING :
+		DAP_SWO_TRANSPORT_DATA_COMMAND;
+	if (!dap_swo_command(DAP_SWO_TRANSPORT, transport) ||
+		!dap_swo_command(DAP_SWO_MODE, mode == swo_manchester ? DAP_SWO_MODE_MANCHESTER : DAP_SWO_MODE_UART)) {
+		DEBUG_ERROR("Failed to configure the adaptor for SWO capture\n");
+		return false;
+	}
+	*actual_baudrate = dap_swo_baudrate(baudrate);
+	if (!*actual_baudrate) {
+		DEBUG_ERROR("Adaptor cannot capture SWO at %" PRIu32 " baud\n", baudrate);
+		dap_swo_command(DAP_SWO_MODE, DAP_SWO_MODE_OFF);
+		return false;
+	}
+
+	uint8_t buffer_size[4] = {0};
+	if (dap_info(DAP_INFO_SWO_BUF_SIZE, buffer_size, sizeof(buffer_size)) == sizeof(buffer_size))
+		swo_stats.buffer_size = read_le4(buffer_size, 0U);
+	dap_swo_transport = transport;
+	if (transport == DAP_SWO_TRANSPORT_STREAMING) {
+		/* The queue here adds to what the adaptor buffers itself */
+		swo_stats.buffer_size += DAP_SWO_QUEUE_SIZE;
+		if (!dap_swo_stream_start(link)) {
+			dap_swo_stop();
+			return false;
+		}
+	}
+	if (!dap_swo_command(DAP_SWO_CONTROL, DAP_SWO_CONTROL_START)) {
+		DEBUG_ERROR("Failed to start SWO capture\n");
+		dap_swo_stop();
+		return false;
+	}
+	DEBUG_INFO("SWO capture running via %s\n",
+		transport == DAP_SWO_TRANSPORT_STREAMING ? "the streaming endpoint" : "DAP_SWO_Data");
+	return true;
+}
+
+void dap_swo_stop(void)
+{
+	if (dap_swo_transport == DAP_SWO_TRANSPORT_NONE)
+		return;
+	const dap_swo_transport_e transport = dap_swo_transport;
+	/* Clear this first so the streaming transfers stop resubmitting themselves */
+	dap_swo_transport = DAP_SWO_TRANSPORT_NONE;
+	dap_swo_command(DAP_SWO_CONTROL, DAP_SWO_CONTROL_STOP);
+	if (transport == DAP_SWO_TRANSPORT_STREAMING)
+		dap_swo_stream_stop(dap_bulk_link());
+	dap_swo_command(DAP_SWO_MODE, DAP_SWO_MODE_OFF);
+}
+
+size_t dap_swo_read(uint8_t *const data, const size_t length)
+{
+	if (dap_swo_transport == DAP_SWO_TRANSPORT_STREAMING) {
+		/* Run any completions that are waiting, without blocking if there aren't any */
+		struct timeval no_wait = {0};
+		libusb_handle_events_timeout_completed(dap_bulk_link()->context, &no_wait, NULL);
+		return dap_swo_queue_pop(data, length);
+	}
+	if (dap_swo_transport != DAP_SWO_TRANSPORT_DATA_COMMAND)
+		return 0U;
+
+	const size_t count = MIN(MIN(length, DAP_SWO_DATA_MAX), dap_max_transfer_data(DAP_SWO_DATA_HDR_LEN + 1U));
+	uint8_t request[3] = {DAP_SWO_DATA};
+	write_le2(request, 1U, (uint16_t)count);
+	uint8_t response[DAP_SWO_DATA_HDR_LEN + DAP_SWO_DATA_MAX] = {0};
+	size_t response_length = 0U;
+	/* The response is only as long as the data the adaptor had, so a short one is the normal case */
+	dap_run_transfer(request, 3U, response, DAP_SWO_DATA_HDR_LEN + count, &response_length);
+	if (response_length < DAP_SWO_DATA_HDR_LEN) {
+		DEBUG_PROBE("%s failed\n", __func__);
+		return 0U;
+	}
+	if (response[0] & DAP_SWO_STATUS_OVERRUN)
+		++swo_stats.overflows;
+	const size_t received = MIN(MIN((size_t)read_le2(response, 1U), count), response_length - DAP_SWO_DATA_HDR_LEN);
+	swo_stats.bytes_captured += received;
+	memcpy(data, response + DAP_SWO_DATA_HDR_LEN, received);
+	return received;
+}
@@ -135,7 +135,7 @@ extern ftdi_port_state_s active_state;
 bool ftdi_bmp_init(bmda_cli_options_s *cl_opts);
 bool ftdi_lookup_adapter_from_vid_pid(bmda_cli_options_s *cl_opts, const probe_info_s *probe);
 bool ftdi_lookup_adaptor_descriptor(bmda_cli_options_s *cl_opts, const probe_info_s *probe);
-bool ftdi_swd_init(void);
+bool ftdi_swd_init(adiv5_debug_port_s *dp);
 bool ftdi_jtag_init(void);
 void ftdi_buffer_flush(void);
 size_t ftdi_buffer_write(const void *buffer, size_t size);
@@ -28,11 +28,17 @@
 #endif
 #include <ftdi.h>
 #include "ftdi_bmp.h"
+#include "buffer_utils.h"
+
+/* Longest run of TMS-low cycles to put in a single data shift, and the most reply data to ask for at once */
+#define FTDI_JTAG_DATA_RUN_MAX 2048U
+#define FTDI_JTAG_REPLY_MAX    512U
 
 static void ftdi_jtag_reset(void);
 static void ftdi_jtag_tms_seq(uint32_t tms_states, size_t clock_cycles);
 static void ftdi_jtag_tdi_seq(bool final_tms, const uint8_t *data_in, size_t clock_cycles);
 static bool ftdi_jtag_next(bool tms, bool tdi);
+static void ftdi_jtag_sequence(const uint8_t *tms, const uint8_t *tdi, uint8_t *tdo, size_t clock_cycles);
 
 /*
  * Throughout this file you will see command buffers being built which have the following basic form:
@@ -78,6 +84,7 @@ bool ftdi_jtag_init(void)
 	jtag_proc.jtagtap_tms_seq = ftdi_jtag_tms_seq;
 	jtag_proc.jtagtap_tdi_tdo_seq = ftdi_jtag_tdi_tdo_seq;
 	jtag_proc.jtagtap_tdi_seq = ftdi_jtag_tdi_seq;
+	jtag_proc.jtagtap_sequence = ftdi_jtag_sequence;
 	jtag_proc.tap_idle_cycles = 1;
 
 	active_state.data[0] |= active_cable.jtag.set_data_low | MPSSE_CS | MPSSE_DI | MPSSE_DO;
@@ -145,3 +152,109 @@ static bool ftdi_jtag_next(const bool tms, const bool tdi)
 	ftdi_buffer_read_val(ret);
 	return ret & 0x80U;
 }
+
+/*
+ * Find the next run of cycles in a raw sequence that can go as a single MPSSE command. Cycles with TMS low
+ * go as data shifts, while those with TMS high have to go as TMS shifts of at most 7 cycles with constant TDI.
+ */
+static size_t ftdi_jtag_sequence_run(
+	const uint8_t *const tms, const uint8_t *const tdi, const size_t cycle, const size_t clock_cycles)
+{
+	size_t cycles = 1U;
+	if (read_bit(tms, cycle)) {
+		const bool tdi_state = read_bit(tdi, cycle);
+		while (cycles < 7U && cycle + cycles < clock_cycles && read_bit(tms, cycle + cycles) &&
+			read_bit(tdi, cycle + cycles) == tdi_state)
+			++cycles;
+	} else {
+		while (cycles < FTDI_JTAG_DATA_RUN_MAX && cycle + cycles < clock_cycles && !read_bit(tms, cycle + cycles))
+			++cycles;
+	}
+	return cycles;
+}
+
+static size_t ftdi_jtag_sequence_reply_length(const bool tms_run, const size_t cycles)
+{
+	return tms_run ? 1U : (cycles + 7U) >> 3U;
+}
+
+static void ftdi_jtag_sequence_queue(const uint8_t *const tms, const uint8_t *const tdi, const bool capture,
+	const size_t cycle, const size_t cycles)
+{
+	const uint8_t read = capture ? MPSSE_DO_READ : 0U;
+	if (read_bit(tms, cycle)) {
+		/* The TMS bits go in the bottom of the data byte, and the constant TDI value for them in the top */
+		const uint8_t command[3U] = {
+			MPSSE_WRITE_TMS | read | MPSSE_LSB | MPSSE_BITMODE | MPSSE_WRITE_NEG,
+			cycles - 1U,
+			(read_bit(tdi, cycle) ? 0x80U : 0U) | ((1U << cycles) - 1U),
+		};
+		ftdi_buffer_write_arr(command);
+		return;
+	}
+	/* Realign the TDI data for the run so it can be shifted out as whole bytes and then any residual bits */
+	uint8_t data[FTDI_JTAG_DATA_RUN_MAX / 8U] = {0};
+	copy_bits(data, 0U, tdi, cycle, cycles);
+	const size_t bytes = cycles >> 3U;
+	const size_t bits = cycles & 7U;
+	const uint8_t cmd = read | MPSSE_DO_WRITE | MPSSE_WRITE_NEG | MPSSE_LSB;
+	if (bytes) {
+		ftdi_mpsse_cmd_s command = {cmd};
+		write_le2(command.length, 0, bytes - 1U);
+		ftdi_buffer_write_val(command);
+		ftdi_buffer_write(data, bytes);
+	}
+	if (bits) {
+		const ftdi_mpsse_cmd_bits_s command = {cmd | MPSSE_BITMODE, bits - 1U};
+		ftdi_buffer_write_val(command);
+		ftdi_buffer_write_val(data[bytes]);
+	}
+}
+
+static void ftdi_jtag_sequence_unpack(
+	uint8_t *const tdo, const uint8_t *const reply, const bool tms_run, const size_t cycle, const size_t cycles)
+{
+	/* Whole bytes come back as they are, but partial bytes are MSb aligned and so need shifting down */
+	const size_t bytes = tms_run ? 0U : cycles >> 3U;
+	const size_t bits = tms_run ? cycles : cycles & 7U;
+	copy_bits(tdo, cycle, reply, 0U, bytes * 8U);
+	if (bits) {
+		const uint8_t value = reply[bytes] >> (8U - bits);
+		copy_bits(tdo, cycle + (bytes * 8U), &value, 0U, bits);
+	}
+}
+
+static void ftdi_jtag_sequence(
+	const uint8_t *const tms, const uint8_t *const tdi, uint8_t *const tdo, const size_t clock_cycles)
+{
+	DEBUG_PROBE("%s: %zu clock cycles\n", __func__, clock_cycles);
+	uint8_t reply[FTDI_JTAG_REPLY_MAX];
+	for (size_t cycle = 0U; cycle < clock_cycles;) {
+		/* Queue up as many runs as we can get the replies for in one go */
+		const size_t start = cycle;
+		size_t reply_length = 0U;
+		while (cycle < clock_cycles) {
+			const bool tms_run = read_bit(tms, cycle);
+			const size_t cycles = ftdi_jtag_sequence_run(tms, tdi, cycle, clock_cycles);
+			const size_t length = ftdi_jtag_sequence_reply_length(tms_run, cycles);
+			if (reply_length + length > sizeof(reply))
+				break;
+			ftdi_jtag_sequence_queue(tms, tdi, tdo != NULL, cycle, cycles);
+			reply_length += length;
+			cycle += cycles;
+		}
+		/* Without any captures, the commands can just be left to go out with the next buffer flush */
+		if (!tdo)
+			continue;
+		/* Now read back everything captured in one go, and walk the same runs again to unpack it into place */
+		ftdi_buffer_read(reply, reply_length);
+		size_t offset = 0U;
+		for (size_t run_cycle = start; run_cycle < cycle;) {
+			const bool tms_run = read_bit(tms, run_cycle);
+			const size_t cycles = ftdi_jtag_sequence_run(tms, tdi, run_cycle, cycle);
+			ftdi_jtag_sequence_unpack(tdo, reply + offset, tms_run, run_cycle, cycles);
+			offset += ftdi_jtag_sequence_reply_length(tms_run, cycles);
+			run_cycle += cycles;
+		}
+	}
+}
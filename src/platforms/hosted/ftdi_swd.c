@@ -30,6 +30,7 @@
 
 #include <ftdi.h>
 #include "ftdi_bmp.h"
+#include "adiv5.h"
 #include "buffer_utils.h"
 #include "maths_utils.h"
 
@@ -51,6 +52,7 @@ static bool ftdi_swd_seq_in_parity(uint32_t *res, size_t clock_cycles);
 static uint32_t ftdi_swd_seq_in(size_t clock_cycles);
 static void ftdi_swd_seq_out(uint32_t tms_states, size_t clock_cycles);
 static void ftdi_swd_seq_out_parity(uint32_t tms_states, size_t clock_cycles);
+static bool ftdi_swd_transfers(adiv5_debug_port_s *dp, const adiv5_transfer_s *transfers, size_t count);
 
 bool ftdi_swd_possible(void)
 {
@@ -83,7 +85,7 @@ static inline uint32_t __builtin_ctz(uint32_t value)
 }
 #endif
 
-bool ftdi_swd_init(void)
+bool ftdi_swd_init(adiv5_debug_port_s *const dp)
 {
 	if (!ftdi_swd_possible()) {
 		DEBUG_ERROR("SWD not possible or missing item in adaptor description.\n");
@@ -132,6 +134,9 @@ bool ftdi_swd_init(void)
 	swd_proc.seq_in_parity = ftdi_swd_seq_in_parity;
 	swd_proc.seq_out = ftdi_swd_seq_out;
 	swd_proc.seq_out_parity = ftdi_swd_seq_out_parity;
+	/* Batched accesses rely on being able to describe the whole transaction in MPSSE commands */
+	if (do_mpsse)
+		dp->transfers = ftdi_swd_transfers;
 	return true;
 }
 
@@ -446,3 +451,121 @@ static void ftdi_swd_seq_out_parity(uint32_t tms_states, size_t clock_cycles)
 	else
 		ftdi_swd_seq_out_parity_raw(tms_states, parity, clock_cycles);
 }
+
+/* Queue an MPSSE read of up to 8 bits, the result of which will be MSb aligned in the response byte */
+static void ftdi_swd_queue_read_bits(const size_t clock_cycles)
+{
+	const ftdi_mpsse_cmd_bits_s cmd = {MPSSE_DO_READ | MPSSE_LSB | MPSSE_BITMODE, clock_cycles - 1U};
+	ftdi_buffer_write_val(cmd);
+}
+
+/*
+ * Queue a complete SWD transaction - request, turnaround, ACK, data phase with parity and the trailing
+ * idle cycles - without waiting on the result. Returns how many response bytes the transaction generates:
+ * one for the ACK, plus five for the data and parity of a read.
+ *
+ * This is only safe because the batch runs with overrun detection enabled, which makes the target expect
+ * the data phase no matter what ACK it gave, rather than treating our data as the start of a new request.
+ */
+static size_t ftdi_swd_queue_transaction(const uint8_t rnw, const uint16_t addr, const uint32_t value)
+{
+	ftdi_swd_turnaround(SWDIO_STATUS_DRIVE);
+	ftdi_swd_seq_out_mpsse(make_packet_request(rnw, addr), 8U);
+	ftdi_swd_turnaround(SWDIO_STATUS_FLOAT);
+	ftdi_swd_queue_read_bits(3U);
+	if (rnw) {
+		/* 32 data bits as whole bytes, then the parity bit */
+		const ftdi_mpsse_cmd_s cmd = {MPSSE_DO_READ | MPSSE_LSB, {3U, 0U}};
+		ftdi_buffer_write_val(cmd);
+		ftdi_swd_queue_read_bits(1U);
+		ftdi_swd_turnaround(SWDIO_STATUS_DRIVE);
+		ftdi_swd_seq_out_mpsse(0U, 8U);
+		return 6U;
+	}
+	ftdi_swd_turnaround(SWDIO_STATUS_DRIVE);
+	ftdi_swd_seq_out_parity_mpsse(value, calculate_odd_parity(value), 32U);
+	return 1U;
+}
+
+/*
+ * Decode the response bytes for one queued transaction, returning false if the ACK was not OK
+ * or the data failed its parity check
+ */
+static bool ftdi_swd_decode_transaction(const uint8_t **const response, const uint8_t rnw, uint32_t *const result)
+{
+	const uint8_t *const data = *response;
+	const uint8_t ack = data[0] >> 5U;
+	*response += rnw ? 6U : 1U;
+	if (ack != SWD_ACK_OK)
+		return false;
+	if (!rnw)
+		return true;
+	const uint32_t value = read_le4(data, 1U);
+	if (calculate_odd_parity(value) != (data[5] >> 7U))
+		return false;
+	if (result)
+		*result = value;
+	return true;
+}
+
+/*
+ * Run a batch of DP and AP accesses as a single MPSSE command stream and a single read of all the results,
+ * rather than waiting on each ACK before carrying on. The batch is bracketed by enabling and disabling
+ * overrun detection. If any transaction in it does not complete cleanly, the DP is recovered and
+ * everything from that transaction on is re-run one access at a time, handling WAITs as normal.
+ */
+static bool ftdi_swd_transfers(
+	adiv5_debug_port_s *const dp, const adiv5_transfer_s *const transfers, const size_t count)
+{
+	if (dp->fault)
+		return false;
+	const uint32_t ctrlstat = ADIV5_DP_CTRLSTAT_CSYSPWRUPREQ | ADIV5_DP_CTRLSTAT_CDBGPWRUPREQ;
+	/* Queue everything, AP reads being followed by a read of RDBUFF to get at the posted result */
+	size_t response_length =
+		ftdi_swd_queue_transaction(ADIV5_LOW_WRITE, ADIV5_DP_CTRLSTAT, ctrlstat | ADIV5_DP_CTRLSTAT_ORUNDETECT);
+	for (size_t idx = 0; idx < count; ++idx) {
+		const adiv5_transfer_s *const transfer = &transfers[idx];
+		response_length += ftdi_swd_queue_transaction(transfer->rnw, transfer->addr, transfer->value);
+		if (transfer->rnw == ADIV5_LOW_READ && (transfer->addr & ADIV5_APnDP))
+			response_length += ftdi_swd_queue_transaction(ADIV5_LOW_READ, ADIV5_DP_RDBUFF, 0U);
+	}
+	response_length += ftdi_swd_queue_transaction(ADIV5_LOW_WRITE, ADIV5_DP_CTRLSTAT, ctrlstat);
+
+	uint8_t response[(1U + ((6U + 6U) * ADIV5_TRANSFER_QUEUE_DEPTH) + 1U)];
+	if (response_length > sizeof(response))
+		return false;
+	ftdi_buffer_read(response, response_length);
+
+	/* Now walk the results, looking for the first transaction that didn't go through */
+	const uint8_t *data = response;
+	size_t failed = 0U;
+	bool result = ftdi_swd_decode_transaction(&data, ADIV5_LOW_WRITE, NULL);
+	for (; result && failed < count; ++failed) {
+		const adiv5_transfer_s *const transfer = &transfers[failed];
+		if (transfer->rnw == ADIV5_LOW_READ && (transfer->addr & ADIV5_APnDP)) {
+			result = ftdi_swd_decode_transaction(&data, ADIV5_LOW_READ, NULL) &&
+				ftdi_swd_decode_transaction(&data, ADIV5_LOW_READ, transfer->result);
+		} else
+			result = ftdi_swd_decode_transaction(&data, transfer->rnw, transfer->result);
+		if (!result)
+			break;
+	}
+	if (result && ftdi_swd_decode_transaction(&data, ADIV5_LOW_WRITE, NULL))
+		return true;
+
+	/*
+	 * Something didn't go through - possibly the enable itself. The target will have faulted everything after
+	 * the failing access, so recover the DP, put overrun detection back the way it was and redo the rest slowly
+	 */
+	DEBUG_PROBE("%s: batch failed at access %zu of %zu, retrying individually\n", __func__, failed, count);
+	dp->error(dp, true);
+	adiv5_dp_low_access(dp, ADIV5_LOW_WRITE, ADIV5_DP_CTRLSTAT, ctrlstat);
+	for (size_t idx = failed; idx < count && !dp->fault; ++idx) {
+		const adiv5_transfer_s *const transfer = &transfers[idx];
+		if (transfer->rnw == ADIV5_LOW_READ)
+			*transfer->result = adiv5_dp_read(dp, transfer->addr);
+		else
+			adiv5_dp_write(dp, transfer->addr, transfer->value);
+	}
+	return !dp->fault;
+}
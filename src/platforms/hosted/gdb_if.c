@@ -20,7 +20,14 @@
 
 /* This file implements a transparent channel over which the GDB Remote
  * Serial Debugging protocol is implemented.  This implementation for Linux
- * uses a TCP server on port 2000.
+ * uses a TCP server on port 2000, or a Unix domain socket if given a path.
+ *
+ * Accepting connections and receiving from the socket is done by a separate
+ * network thread which queues what arrives, so data (including ^C) coming
+ * from GDB is taken off the socket while the main thread talks to the probe.
+ * The main thread takes everything queued at once into a buffer of its own,
+ * and sends whole packets, so it costs a lock or a syscall per packet rather
+ * than per character.
  */
 
 #ifndef __CYGWIN__
@@ -47,7 +54,7 @@ typedef signed int ssize_t;
 #include <arpa/inet.h>
 #include <netinet/in.h>
 #include <netinet/tcp.h>
-#include <sys/select.h>
+#include <sys/un.h>
 #include <fcntl.h>
 
 typedef int32_t socket_t;
@@ -65,14 +72,20 @@ typedef int32_t socket_t;
 #ifndef _MSC_VER
 #include <unistd.h>
 #endif
+#if !defined(_WIN32) || defined(__CYGWIN__)
+#include <pthread.h>
+#include <time.h>
+#endif
 
 #include "gdb_if.h"
 #include "bmp_hosted.h"
 #include "command.h"
+#include "gdb_main.h"
+#include "observer.h"
 
 #define DEFAULT_PORT 2000U
-static const uint16_t default_port = DEFAULT_PORT;
-static const uint16_t max_port = (DEFAULT_PORT + 4U);
+static uint16_t default_port = DEFAULT_PORT;
+static uint16_t max_port = (DEFAULT_PORT + 4U);
 
 #if defined(_WIN32) || defined(__CYGWIN__)
 const int op_would_block = WSAEWOULDBLOCK;
@@ -91,10 +104,105 @@ static socket_t gdb_if_serv = INVALID_SOCKET;
 static socket_t gdb_if_conn = INVALID_SOCKET;
 bool shutdown_bmda = false;
 
-#define GDB_BUFFER_LEN 2048U
+/* Big enough for a whole packet even if every character in it has to be escaped */
+#define GDB_BUFFER_LEN 4096U
 static size_t gdb_buffer_used = 0U;
 static char gdb_buffer[GDB_BUFFER_LEN];
 
+#if !defined(_WIN32) && !defined(__CYGWIN__)
+/* Path to listen on as a Unix domain socket instead of TCP, for a GDB on the same machine */
+static const char *gdb_if_unix_path = NULL;
+#endif
+
+/* State of the connection as seen by the network thread */
+typedef enum gdb_if_rx_state {
+	GDB_IF_RX_LISTENING,
+	GDB_IF_RX_CONNECTED,
+	/* The peer went away, waiting for the main thread to drain the queue and close the socket */
+	GDB_IF_RX_CLOSED,
+} gdb_if_rx_state_e;
+
+/*
+ * Everything below is shared between the network thread and the main thread, and is only touched
+ * with gdb_if_rx_lock held. The queue is a ring buffer with one slot kept free to tell full from empty.
+ */
+#define GDB_RX_QUEUE_LEN 65536U
+static char gdb_if_rx_queue[GDB_RX_QUEUE_LEN];
+static size_t gdb_if_rx_head = 0U;
+static size_t gdb_if_rx_tail = 0U;
+static gdb_if_rx_state_e gdb_if_rx_state = GDB_IF_RX_LISTENING;
+static socket_t gdb_if_rx_conn = INVALID_SOCKET;
+
+/* What the main thread has taken off the queue and not yet consumed, which it owns outright */
+#define GDB_RX_LOCAL_LEN 4096U
+static char gdb_if_rx_local[GDB_RX_LOCAL_LEN];
+static size_t gdb_if_rx_local_used = 0U;
+static size_t gdb_if_rx_local_read = 0U;
+
+#if defined(_WIN32) && !defined(__CYGWIN__)
+static SRWLOCK gdb_if_rx_lock = SRWLOCK_INIT;
+static CONDITION_VARIABLE gdb_if_rx_cond = CONDITION_VARIABLE_INIT;
+
+static inline void gdb_if_rx_lock_take(void)
+{
+	AcquireSRWLockExclusive(&gdb_if_rx_lock);
+}
+
+static inline void gdb_if_rx_lock_release(void)
+{
+	ReleaseSRWLockExclusive(&gdb_if_rx_lock);
+}
+
+static inline void gdb_if_rx_signal(void)
+{
+	WakeAllConditionVariable(&gdb_if_rx_cond);
+}
+
+/* Wait to be signalled with the lock held, returning false on timeout */
+static bool gdb_if_rx_wait(const uint32_t timeout)
+{
+	return SleepConditionVariableSRW(&gdb_if_rx_cond, &gdb_if_rx_lock, timeout, 0);
+}
+
+#define GDB_IF_RX_WAIT_FOREVER INFINITE
+#else
+static pthread_mutex_t gdb_if_rx_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t gdb_if_rx_cond = PTHREAD_COND_INITIALIZER;
+
+static inline void gdb_if_rx_lock_take(void)
+{
+	pthread_mutex_lock(&gdb_if_rx_lock);
+}
+
+static inline void gdb_if_rx_lock_release(void)
+{
+	pthread_mutex_unlock(&gdb_if_rx_lock);
+}
+
+static inline void gdb_if_rx_signal(void)
+{
+	pthread_cond_broadcast(&gdb_if_rx_cond);
+}
+
+/* Wait to be signalled with the lock held, returning false on timeout */
+static bool gdb_if_rx_wait(const uint32_t timeout)
+{
+	if (timeout == UINT32_MAX)
+		return pthread_cond_wait(&gdb_if_rx_cond, &gdb_if_rx_lock) == 0;
+	struct timespec deadline;
+	clock_gettime(CLOCK_REALTIME, &deadline);
+	deadline.tv_sec += timeout / 1000U;
+	deadline.tv_nsec += (long)(timeout % 1000U) * 1000000L;
+	if (deadline.tv_nsec >= 1000000000L) {
+		++deadline.tv_sec;
+		deadline.tv_nsec -= 1000000000L;
+	}
+	return pthread_cond_timedwait(&gdb_if_rx_cond, &gdb_if_rx_lock, &deadline) == 0;
+}
+
+#define GDB_IF_RX_WAIT_FOREVER UINT32_MAX
+#endif
+
 typedef struct sockaddr sockaddr_s;
 typedef struct sockaddr_in sockaddr_in_s;
 typedef struct sockaddr_in6 sockaddr_in6_s;
@@ -229,6 +337,153 @@ static void socket_set_flags(const socket_t socket, const int flags)
 #endif
 }
 
+/* Queue what arrives on the connection until the peer goes away */
+static void gdb_if_rx_receive(const socket_t conn)
+{
+	char data[16384U];
+	while (true) {
+		const ssize_t result = recv(conn, data, sizeof(data), 0);
+		if (result < 0 && socket_error() == op_needs_retry)
+			continue;
+		if (result <= 0) {
+			display_socket_error(socket_error(), conn, "on socket");
+			return;
+		}
+
+		gdb_if_rx_lock_take();
+		for (size_t offset = 0U; offset < (size_t)result;) {
+			/* If the main thread has fallen behind, wait for it to catch up */
+			while ((gdb_if_rx_head + 1U) % GDB_RX_QUEUE_LEN == gdb_if_rx_tail)
+				gdb_if_rx_wait(GDB_IF_RX_WAIT_FOREVER);
+			/* Copy as much as fits contiguously, up to the end of the queue or the free slot before the tail */
+			const size_t limit = gdb_if_rx_tail > gdb_if_rx_head ? gdb_if_rx_tail - 1U :
+				                                                   GDB_RX_QUEUE_LEN - (gdb_if_rx_tail == 0U ? 1U : 0U);
+			const size_t amount = MIN((size_t)result - offset, limit - gdb_if_rx_head);
+			memcpy(gdb_if_rx_queue + gdb_if_rx_head, data + offset, amount);
+			gdb_if_rx_head = (gdb_if_rx_head + amount) % GDB_RX_QUEUE_LEN;
+			offset += amount;
+			gdb_if_rx_signal();
+		}
+		gdb_if_rx_lock_release();
+	}
+}
+
+#if defined(_WIN32) && !defined(__CYGWIN__)
+static DWORD WINAPI gdb_if_rx_thread(void *const context)
+#else
+static void *gdb_if_rx_thread(void *const context)
+#endif
+{
+	(void)context;
+	while (true) {
+		const socket_t conn = accept(gdb_if_serv, NULL, NULL);
+		if (conn == INVALID_SOCKET) {
+			const int error = socket_error();
+			if (error == op_needs_retry)
+				continue;
+			display_socket_error(error, gdb_if_serv, "accepting connection from socket");
+			exit(1);
+		}
+		DEBUG_INFO("Got connection\n");
+		socket_set_flags(conn, socket_get_flags(conn) & ~O_NONBLOCK);
+#if !defined(_WIN32) && !defined(__CYGWIN__)
+		if (!gdb_if_unix_path)
+#endif
+		{
+			/* Packets go out whole, so don't let Nagle hold them back waiting for more */
+			const int nodelay = 1;
+			setsockopt(conn, IPPROTO_TCP, TCP_NODELAY, (const void *)&nodelay, sizeof(nodelay));
+		}
+
+		gdb_if_rx_lock_take();
+		gdb_if_rx_conn = conn;
+		gdb_if_rx_state = GDB_IF_RX_CONNECTED;
+		gdb_if_rx_signal();
+		gdb_if_rx_lock_release();
+
+		gdb_if_rx_receive(conn);
+
+		/* Hand the dead connection back, the main thread closes it once it has read everything queued */
+		gdb_if_rx_lock_take();
+		gdb_if_rx_state = GDB_IF_RX_CLOSED;
+		gdb_if_rx_signal();
+		while (gdb_if_rx_state != GDB_IF_RX_LISTENING)
+			gdb_if_rx_wait(GDB_IF_RX_WAIT_FOREVER);
+		gdb_if_rx_lock_release();
+	}
+#if defined(_WIN32) && !defined(__CYGWIN__)
+	return 0;
+#else
+	return NULL;
+#endif
+}
+
+static bool gdb_if_rx_start(void)
+{
+#if defined(_WIN32) && !defined(__CYGWIN__)
+	const HANDLE thread = CreateThread(NULL, 0, gdb_if_rx_thread, NULL, 0, NULL);
+	if (thread == NULL)
+		return false;
+	CloseHandle(thread);
+	return true;
+#else
+	pthread_t thread;
+	if (pthread_create(&thread, NULL, gdb_if_rx_thread, NULL) != 0)
+		return false;
+	pthread_detach(thread);
+	return true;
+#endif
+}
+
+/* Listen on exactly the given port rather than the first free one from the default */
+void gdb_if_set_port(const uint16_t port)
+{
+	default_port = port;
+	max_port = port + 1U;
+}
+
+#if !defined(_WIN32) && !defined(__CYGWIN__)
+void gdb_if_set_unix_socket(const char *const path)
+{
+	gdb_if_unix_path = path;
+}
+
+static int gdb_if_init_unix(void)
+{
+	struct sockaddr_un addr = {0};
+	addr.sun_family = AF_UNIX;
+	if (strlen(gdb_if_unix_path) >= sizeof(addr.sun_path)) {
+		DEBUG_ERROR("Socket path %s is too long\n", gdb_if_unix_path);
+		return -1;
+	}
+	strncpy(addr.sun_path, gdb_if_unix_path, sizeof(addr.sun_path) - 1U);
+
+	gdb_if_serv = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (gdb_if_serv == INVALID_SOCKET) {
+		display_socket_error(socket_error(), gdb_if_serv, "socket returned");
+		return -1;
+	}
+	/* Clear away the socket left behind by a previous run */
+	unlink(gdb_if_unix_path);
+	if (bind(gdb_if_serv, (const sockaddr_s *)&addr, sizeof(addr)) == -1) {
+		handle_error(gdb_if_serv, "binding socket");
+		return -1;
+	}
+	if (listen(gdb_if_serv, 1) == -1) {
+		handle_error(gdb_if_serv, "listening on socket");
+		return -1;
+	}
+
+	DEBUG_WARN("Listening on Unix socket: %s\n", gdb_if_unix_path);
+	if (!gdb_if_rx_start()) {
+		DEBUG_ERROR("Failed to start the network thread\n");
+		closesocket(gdb_if_serv);
+		return -1;
+	}
+	return 0;
+}
+#endif
+
 int gdb_if_init(void)
 {
 #if defined(_WIN32) || defined(__CYGWIN__)
@@ -238,6 +493,9 @@ int gdb_if_init(void)
 		DEBUG_ERROR("WSAStartup failed with error: %d\n", result);
 		return -1;
 	}
+#else
+	if (gdb_if_unix_path)
+		return gdb_if_init_unix();
 #endif
 	for (uint16_t port = default_port; port < max_port; ++port) {
 		const sockaddr_storage_s addr = sockaddr_prepare(port);
@@ -273,6 +531,11 @@ int gdb_if_init(void)
 		}
 
 		DEBUG_WARN("Listening on TCP port: %d\n", port);
+		if (!gdb_if_rx_start()) {
+			DEBUG_ERROR("Failed to start the network thread\n");
+			closesocket(gdb_if_serv);
+			return -1;
+		}
 		return 0;
 	}
 
@@ -280,74 +543,106 @@ int gdb_if_init(void)
 	return -1;
 }
 
+/* How often to look in on the observers while waiting for GDB */
+#define GDB_IF_OBSERVER_POLL_MS 10U
+
+/* Wait for the network thread with the lock held, answering any observers in the meantime */
+static void gdb_if_rx_idle_wait(void)
+{
+	if (!observer_active()) {
+		gdb_if_rx_wait(GDB_IF_RX_WAIT_FOREVER);
+		return;
+	}
+	if (gdb_if_rx_wait(GDB_IF_OBSERVER_POLL_MS))
+		return;
+	gdb_if_rx_lock_release();
+	observer_poll(cur_target);
+	gdb_if_rx_lock_take();
+}
+
+/* Called with the lock held once the main thread gives up the connection, lets the network thread accept again */
+static char gdb_if_rx_release(void)
+{
+	closesocket(gdb_if_conn);
+	gdb_if_conn = INVALID_SOCKET;
+	gdb_if_rx_conn = INVALID_SOCKET;
+	gdb_if_rx_head = 0U;
+	gdb_if_rx_tail = 0U;
+	gdb_if_rx_local_used = 0U;
+	gdb_if_rx_local_read = 0U;
+	gdb_if_rx_state = GDB_IF_RX_LISTENING;
+	gdb_if_rx_signal();
+	gdb_if_rx_lock_release();
+	/* Return '+' in case we were waiting for an ACK */
+	return '+';
+}
+
 char gdb_if_getchar(void)
 {
+	if (gdb_if_rx_local_read < gdb_if_rx_local_used)
+		return gdb_if_rx_local[gdb_if_rx_local_read++];
+
+	gdb_if_rx_lock_take();
 	if (gdb_if_conn == INVALID_SOCKET) {
-		if (shutdown_bmda)
+		if (shutdown_bmda) {
+			gdb_if_rx_lock_release();
 			return '\x04';
-		const int flags = socket_get_flags(gdb_if_serv);
-		socket_set_flags(gdb_if_serv, flags | O_NONBLOCK);
-		gdb_if_conn = INVALID_SOCKET;
-		while (gdb_if_conn == INVALID_SOCKET) {
-			gdb_if_conn = accept(gdb_if_serv, NULL, NULL);
-			if (gdb_if_conn == INVALID_SOCKET) {
-				const int error = socket_error();
-				if (error == op_would_block) {
-					SET_IDLE_STATE(1);
-					platform_delay(100);
-				} else {
-					display_socket_error(error, gdb_if_serv, "accepting connection from socket");
-					exit(1);
-				}
-				continue;
-			}
 		}
-		DEBUG_INFO("Got connection\n");
-		socket_set_flags(gdb_if_serv, flags);
-		socket_set_flags(gdb_if_conn, socket_get_flags(gdb_if_conn) & ~O_NONBLOCK);
+		SET_IDLE_STATE(1);
+		while (gdb_if_rx_state != GDB_IF_RX_CONNECTED)
+			gdb_if_rx_idle_wait();
+		gdb_if_conn = gdb_if_rx_conn;
 	}
 
-	char value = '\0';
-	int error = op_needs_retry;
-	while (error == op_needs_retry) {
-		const ssize_t result = recv(gdb_if_conn, &value, 1, 0);
-		if (result < 0) {
-			error = socket_error();
-			if (error == op_needs_retry)
-				continue;
-		} else
-			error = 0;
+	while (gdb_if_rx_head == gdb_if_rx_tail) {
+		if (gdb_if_rx_state == GDB_IF_RX_CLOSED)
+			return gdb_if_rx_release();
+		gdb_if_rx_idle_wait();
+	}
+	/* Take everything queued (up to what fits) in one go, so the next characters don't need the lock */
+	gdb_if_rx_local_used = 0U;
+	while (gdb_if_rx_head != gdb_if_rx_tail && gdb_if_rx_local_used < GDB_RX_LOCAL_LEN) {
+		const size_t end = gdb_if_rx_head > gdb_if_rx_tail ? gdb_if_rx_head : GDB_RX_QUEUE_LEN;
+		const size_t amount = MIN(end - gdb_if_rx_tail, GDB_RX_LOCAL_LEN - gdb_if_rx_local_used);
+		memcpy(gdb_if_rx_local + gdb_if_rx_local_used, gdb_if_rx_queue + gdb_if_rx_tail, amount);
+		gdb_if_rx_local_used += amount;
+		gdb_if_rx_tail = (gdb_if_rx_tail + amount) % GDB_RX_QUEUE_LEN;
+	}
+	/* Let the network thread know there's room again */
+	gdb_if_rx_signal();
+	gdb_if_rx_lock_release();
+	gdb_if_rx_local_read = 1U;
+	return gdb_if_rx_local[0U];
+}
 
-		if (result <= 0) {
-			handle_error(gdb_if_conn, "on socket");
-			gdb_if_conn = INVALID_SOCKET;
-			/* Return '+' in case we were waiting for an ACK */
-			return '+';
-		}
+void gdb_if_replay(const char *const data, const size_t length)
+{
+	const size_t amount = MIN(length, GDB_RX_LOCAL_LEN);
+	memcpy(gdb_if_rx_local, data, amount);
+	gdb_if_rx_local_used = amount;
+	gdb_if_rx_local_read = 0U;
+}
+
+bool gdb_if_wait_ready(const uint32_t timeout)
+{
+	if (gdb_if_rx_local_read < gdb_if_rx_local_used)
+		return true;
+	gdb_if_rx_lock_take();
+	bool ready = gdb_if_rx_head != gdb_if_rx_tail || gdb_if_rx_state == GDB_IF_RX_CLOSED;
+	/* The network thread signals as soon as anything arrives, so this wakes early for it */
+	if (!ready && timeout) {
+		gdb_if_rx_wait(timeout);
+		ready = gdb_if_rx_head != gdb_if_rx_tail || gdb_if_rx_state == GDB_IF_RX_CLOSED;
 	}
-	return value;
+	gdb_if_rx_lock_release();
+	return ready;
 }
 
 char gdb_if_getchar_to(uint32_t timeout)
 {
 	if (gdb_if_conn == INVALID_SOCKET)
 		return -1;
-
-#ifndef __CYGWIN__
-	timeval_s select_timeout;
-#else
-	TIMEVAL select_timeout;
-#endif
-	select_timeout.tv_sec = timeout / 1000U;
-	select_timeout.tv_usec = (timeout % 1000U) * 1000U;
-
-	fd_set fds;
-	FD_ZERO(&fds);
-	FD_SET(gdb_if_conn, &fds);
-
-	if (select(FD_SETSIZE, &fds, NULL, NULL, &select_timeout) > 0)
-		return gdb_if_getchar();
-	return -1;
+	return gdb_if_wait_ready(timeout) ? gdb_if_getchar() : -1;
 }
 
 void gdb_if_putchar(const char c, const bool flush)
@@ -359,6 +654,24 @@ void gdb_if_putchar(const char c, const bool flush)
 		gdb_if_flush(flush);
 }
 
+void gdb_if_write(const void *const data, const size_t length, const bool flush)
+{
+	if (gdb_if_conn == INVALID_SOCKET)
+		return;
+	const char *const buffer = (const char *)data;
+	for (size_t offset = 0U; offset < length;) {
+		/* Copy as much as fits in the buffer, sending it on if that fills it */
+		const size_t amount = MIN(length - offset, GDB_BUFFER_LEN - gdb_buffer_used);
+		memcpy(gdb_buffer + gdb_buffer_used, buffer + offset, amount);
+		gdb_buffer_used += amount;
+		offset += amount;
+		if (gdb_buffer_used == GDB_BUFFER_LEN)
+			gdb_if_flush(flush);
+	}
+	if (flush)
+		gdb_if_flush(true);
+}
+
 void gdb_if_flush(const bool force)
 {
 	(void)force;
@@ -373,8 +686,15 @@ void gdb_if_flush(const bool force)
 		return;
 	}
 
-	/* Send the data */
-	send(gdb_if_conn, gdb_buffer, gdb_buffer_used, 0);
+	/* Send the data, which can take more than one go if the socket's send buffer is full */
+	for (size_t offset = 0U; offset < gdb_buffer_used;) {
+		const ssize_t result = send(gdb_if_conn, gdb_buffer + offset, gdb_buffer_used - offset, 0);
+		if (result < 0 && socket_error() == op_needs_retry)
+			continue;
+		if (result <= 0)
+			break;
+		offset += (size_t)result;
+	}
 
 	/* Reset the buffer */
 	gdb_buffer_used = 0;
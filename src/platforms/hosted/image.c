@@ -0,0 +1,301 @@
+/*
+ * This file is part of the Black Magic Debug project.
+ *
+ * Copyright (C) 2026 1BitSquared <info@1bitsquared.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * This file implements the loading of program images for BMDA's Flash modes. ELF files, Intel HEX,
+ * Motorola S-records and raw binaries are all turned into a list of segments so that only the parts
+ * of Flash the image actually covers get erased and written.
+ *
+ * ELF files are used in place from the memory mapping, taking each PT_LOAD program header with file
+ * contents at its physical (load) address. HEX and S-record files are decoded into a single buffer
+ * that holds just the data bytes, with each segment pointing into it.
+ */
+
+#include "general.h"
+#include "image.h"
+#include "buffer_utils.h"
+#include "hex_utils.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define ELF_HEADER_SIZE        52U
+#define ELF_PROGRAM_HEADER_MIN 32U
+#define ELF_CLASS_32           1U
+#define ELF_DATA_LSB           1U
+#define ELF_PT_LOAD            1U
+
+/* Longest HEX or S-record line: a 255 byte payload as hex, plus the framing around it */
+#define IMAGE_RECORD_MAX 255U
+
+typedef struct image_builder {
+	bmda_image_s *image;
+	size_t storage_used;
+	size_t storage_size;
+	size_t segments_size;
+	/* Segment data is referenced by offset until storage stops moving, then turned into pointers */
+	size_t *offsets;
+} image_builder_s;
+
+static bool image_add_segment(bmda_image_s *const image, const uint32_t addr, const uint8_t *const data,
+	const size_t size, size_t *const capacity)
+{
+	if (image->segment_count == *capacity) {
+		const size_t new_capacity = *capacity ? *capacity * 2U : 8U;
+		bmda_image_segment_s *const segments = realloc(image->segments, new_capacity * sizeof(*segments));
+		if (!segments) { /* realloc failed: heap exhaustion */
+			DEBUG_ERROR("realloc: failed in %s\n", __func__);
+			return false;
+		}
+		image->segments = segments;
+		*capacity = new_capacity;
+	}
+	image->segments[image->segment_count++] = (bmda_image_segment_s){.addr = addr, .data = data, .size = size};
+	return true;
+}
+
+static int image_segment_compare(const void *const lhs, const void *const rhs)
+{
+	const uint32_t lhs_addr = ((const bmda_image_segment_s *)lhs)->addr;
+	const uint32_t rhs_addr = ((const bmda_image_segment_s *)rhs)->addr;
+	return lhs_addr < rhs_addr ? -1 : lhs_addr > rhs_addr;
+}
+
+static bool image_load_elf(bmda_image_s *const image, const uint8_t *const data, const size_t size)
+{
+	if (size < ELF_HEADER_SIZE || data[4] != ELF_CLASS_32 || data[5] != ELF_DATA_LSB) {
+		DEBUG_ERROR("Only 32-bit little endian ELF files are supported\n");
+		return false;
+	}
+	const uint32_t phoff = read_le4(data, 28U);
+	const uint16_t phentsize = read_le2(data, 42U);
+	const uint16_t phnum = read_le2(data, 44U);
+	if (phentsize < ELF_PROGRAM_HEADER_MIN || phoff > size || (size - phoff) / phentsize < phnum) {
+		DEBUG_ERROR("ELF program headers are truncated\n");
+		return false;
+	}
+
+	size_t capacity = 0U;
+	for (uint16_t idx = 0U; idx < phnum; ++idx) {
+		const uint8_t *const header = data + phoff + (size_t)idx * phentsize;
+		const uint32_t offset = read_le4(header, 4U);
+		const uint32_t paddr = read_le4(header, 12U);
+		const uint32_t filesz = read_le4(header, 16U);
+		/* Only loadable segments with something in the file need writing, .bss and the like don't */
+		if (read_le4(header, 0U) != ELF_PT_LOAD || !filesz)
+			continue;
+		if (offset > size || size - offset < filesz) {
+			DEBUG_ERROR("ELF segment %u lies outside the file\n", idx);
+			return false;
+		}
+		if (!image_add_segment(image, paddr, data + offset, filesz, &capacity))
+			return false;
+	}
+	return true;
+}
+
+/* Decode a line of hex digit pairs into bytes, returning how many there were or 0 on a malformed line */
+static size_t image_decode_record(const char *const line, const size_t length, uint8_t *const record)
+{
+	if (length & 1U || length / 2U > IMAGE_RECORD_MAX + 5U)
+		return 0U;
+	for (size_t idx = 0U; idx < length; ++idx) {
+		if (!is_hex(line[idx]))
+			return 0U;
+	}
+	unhexify(record, line, length / 2U);
+	return length / 2U;
+}
+
+static bool image_builder_append(
+	image_builder_s *const builder, const uint32_t addr, const uint8_t *const data, const size_t size)
+{
+	bmda_image_s *const image = builder->image;
+	if (builder->storage_used + size > builder->storage_size) {
+		const size_t storage_size = MAX(builder->storage_size * 2U, builder->storage_used + size);
+		uint8_t *const storage = realloc(image->storage, storage_size);
+		if (!storage) { /* realloc failed: heap exhaustion */
+			DEBUG_ERROR("realloc: failed in %s\n", __func__);
+			return false;
+		}
+		image->storage = storage;
+		builder->storage_size = storage_size;
+	}
+
+	/* Extend the last segment if this carries straight on from it, otherwise start a new one */
+	bmda_image_segment_s *const last = image->segment_count ? &image->segments[image->segment_count - 1U] : NULL;
+	if (last && last->addr + last->size == addr &&
+		builder->offsets[image->segment_count - 1U] + last->size == builder->storage_used)
+		last->size += size;
+	else {
+		const size_t segments_size = builder->segments_size;
+		if (!image_add_segment(image, addr, NULL, size, &builder->segments_size))
+			return false;
+		if (builder->segments_size != segments_size) {
+			size_t *const offsets = realloc(builder->offsets, builder->segments_size * sizeof(*offsets));
+			if (!offsets) { /* realloc failed: heap exhaustion */
+				DEBUG_ERROR("realloc: failed in %s\n", __func__);
+				return false;
+			}
+			builder->offsets = offsets;
+		}
+		builder->offsets[image->segment_count - 1U] = builder->storage_used;
+	}
+	memcpy(image->storage + builder->storage_used, data, size);
+	builder->storage_used += size;
+	return true;
+}
+
+/* Handle one Intel HEX record, setting done on the end of file record */
+static bool image_hex_record(image_builder_s *const builder, const uint8_t *const record, const size_t length,
+	uint32_t *const base, bool *const done)
+{
+	if (length < 5U || record[0] + 5U != length) {
+		DEBUG_ERROR("Malformed HEX record\n");
+		return false;
+	}
+	uint8_t checksum = 0U;
+	for (size_t idx = 0U; idx < length; ++idx)
+		checksum += record[idx];
+	if (checksum) {
+		DEBUG_ERROR("HEX record checksum mismatch\n");
+		return false;
+	}
+
+	const uint16_t offset = read_be2(record, 1U);
+	switch (record[3]) {
+	case 0x00U: /* Data */
+		return image_builder_append(builder, *base + offset, record + 4U, record[0]);
+	case 0x01U: /* End of file */
+		*done = true;
+		return true;
+	case 0x02U: /* Extended segment address */
+		*base = (uint32_t)read_be2(record, 4U) << 4U;
+		return true;
+	case 0x04U: /* Extended linear address */
+		*base = (uint32_t)read_be2(record, 4U) << 16U;
+		return true;
+	default: /* Start addresses don't matter for programming */
+		return true;
+	}
+}
+
+/* Handle one S-record, the type having been taken from the line already */
+static bool image_srec_record(
+	image_builder_s *const builder, const char type, const uint8_t *const record, const size_t length)
+{
+	if (length < 1U || record[0] + 1U != length) {
+		DEBUG_ERROR("Malformed S-record\n");
+		return false;
+	}
+	uint8_t checksum = 0U;
+	for (size_t idx = 0U; idx < length; ++idx)
+		checksum += record[idx];
+	if (checksum != 0xffU) {
+		DEBUG_ERROR("S-record checksum mismatch\n");
+		return false;
+	}
+
+	/* S1, S2 and S3 carry data with a 2, 3 or 4 byte address, everything else is informational */
+	if (type < '1' || type > '3')
+		return true;
+	const size_t addr_length = (size_t)(type - '1') + 2U;
+	if (length < addr_length + 2U)
+		return false;
+	uint32_t addr = 0U;
+	for (size_t idx = 0U; idx < addr_length; ++idx)
+		addr = (addr << 8U) | record[1U + idx];
+	return image_builder_append(builder, addr, record + 1U + addr_length, length - addr_length - 2U);
+}
+
+static bool image_load_records(bmda_image_s *const image, const char *const text, const size_t size, const bool hex)
+{
+	image_builder_s builder = {.image = image};
+	uint8_t record[IMAGE_RECORD_MAX + 5U];
+	uint32_t base = 0U;
+	bool done = false;
+	bool result = true;
+
+	for (size_t offset = 0U; result && !done && offset < size;) {
+		/* Find the extent of this line, not counting the line ending */
+		size_t end = offset;
+		while (end < size && text[end] != '\n' && text[end] != '\r')
+			++end;
+		const char *const line = text + offset;
+		const size_t length = end - offset;
+		offset = end + 1U;
+		if (!length)
+			continue;
+
+		if (hex && line[0] == ':') {
+			const size_t record_length = image_decode_record(line + 1U, length - 1U, record);
+			result = record_length && image_hex_record(&builder, record, record_length, &base, &done);
+		} else if (!hex && line[0] == 'S' && length >= 2U) {
+			const size_t record_length = image_decode_record(line + 2U, length - 2U, record);
+			result = record_length && image_srec_record(&builder, line[1], record, record_length);
+		} else
+			result = false;
+		if (!result)
+			DEBUG_ERROR("Bad %s record: %.*s\n", hex ? "HEX" : "S-record", (int)MIN(length, 64U), line);
+	}
+
+	/* Storage is done moving, so point each segment at its data */
+	for (size_t idx = 0U; result && idx < image->segment_count; ++idx)
+		image->segments[idx].data = image->storage + builder.offsets[idx];
+	free(builder.offsets);
+	return result;
+}
+
+bool bmda_image_load(bmda_image_s *const image, const void *const data, const size_t size, const uint32_t bin_start,
+	const size_t bin_size)
+{
+	const uint8_t *const bytes = (const uint8_t *)data;
+	*image = (bmda_image_s){0};
+
+	bool result;
+	if (size >= 4U && memcmp(bytes, "\x7f" "ELF", 4U) == 0)
+		result = image_load_elf(image, bytes, size);
+	else if (size && bytes[0] == ':')
+		result = image_load_records(image, (const char *)data, size, true);
+	else if (size >= 2U && bytes[0] == 'S' && bytes[1] >= '0' && bytes[1] <= '9')
+		result = image_load_records(image, (const char *)data, size, false);
+	else {
+		/* Anything else is a raw binary image to be placed at the requested address, up to the size limit */
+		size_t capacity = 0U;
+		result = image_add_segment(image, bin_start, bytes, MIN(size, bin_size), &capacity);
+	}
+
+	if (result && !image->segment_count) {
+		DEBUG_ERROR("Image contains nothing to program\n");
+		result = false;
+	}
+	if (!result) {
+		bmda_image_free(image);
+		return false;
+	}
+	qsort(image->segments, image->segment_count, sizeof(*image->segments), image_segment_compare);
+	return true;
+}
+
+void bmda_image_free(bmda_image_s *const image)
+{
+	free(image->segments);
+	free(image->storage);
+	*image = (bmda_image_s){0};
+}
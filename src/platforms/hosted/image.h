@@ -0,0 +1,47 @@
+/*
+ * This file is part of the Black Magic Debug project.
+ *
+ * Copyright (C) 2026 1BitSquared <info@1bitsquared.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef PLATFORMS_HOSTED_IMAGE_H
+#define PLATFORMS_HOSTED_IMAGE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* One contiguous run of bytes to be placed at a given target address */
+typedef struct bmda_image_segment {
+	uint32_t addr;
+	const uint8_t *data;
+	size_t size;
+} bmda_image_segment_s;
+
+/*
+ * A program image as a list of segments sorted by address. ELF segments point straight into the
+ * mapped file, HEX and S-record data is decoded into storage. Gaps between segments are left out.
+ */
+typedef struct bmda_image {
+	bmda_image_segment_s *segments;
+	size_t segment_count;
+	uint8_t *storage;
+} bmda_image_s;
+
+bool bmda_image_load(bmda_image_s *image, const void *data, size_t size, uint32_t bin_start, size_t bin_size);
+void bmda_image_free(bmda_image_s *image);
+
+#endif /* PLATFORMS_HOSTED_IMAGE_H */
@@ -704,3 +704,90 @@ bool jlink_target_get_power(void)
 {
 	return jlink_kickstart_power();
 }
+
+/* Work out the baud rate nearest the one asked for that the probe can actually capture at */
+static uint32_t jlink_swo_baudrate(const uint32_t baudrate)
+{
+	uint8_t request[9U] = {JLINK_CMD_SWO, JLINK_SWO_CMD_SPEEDS, 4U, JLINK_SWO_PARAM_MODE};
+	write_le4(request, 4U, JLINK_SWO_MODE_UART);
+	uint8_t buffer[JLINK_SWO_SPEEDS_LENGTH] = {0};
+	/* This replies with the 32 bit length of the whole response, followed by the rest of it */
+	if (bmda_usb_transfer(bmda_probe_info.usb_link, request, sizeof(request), buffer, 4U, JLINK_USB_TIMEOUT) < 0 ||
+		read_le4(buffer, 0U) != JLINK_SWO_SPEEDS_LENGTH ||
+		bmda_usb_transfer(bmda_probe_info.usb_link, NULL, 0U, buffer, JLINK_SWO_SPEEDS_LENGTH - 4U,
+			JLINK_USB_TIMEOUT) < 0) {
+		DEBUG_WARN("Failed to read J-Link SWO speeds, assuming %" PRIu32 " baud is possible\n", baudrate);
+		return baudrate;
+	}
+
+	const uint32_t frequency = read_le4(buffer, JLINK_SWO_SPEEDS_FREQUENCY_OFFSET);
+	const uint32_t min_divisor = MAX(read_le4(buffer, JLINK_SWO_SPEEDS_MIN_DIV_OFFSET), 1U);
+	const uint32_t max_divisor = MAX(read_le4(buffer, JLINK_SWO_SPEEDS_MAX_DIV_OFFSET), min_divisor);
+	/* Round the divisor to the nearest one, then keep it in the range the probe supports */
+	uint32_t divisor = (frequency + (baudrate / 2U)) / baudrate;
+	divisor = MIN(MAX(divisor, min_divisor), max_divisor);
+	return frequency / divisor;
+}
+
+bool jlink_swo_start(const swo_coding_e mode, const uint32_t baudrate, uint32_t *const actual_baudrate)
+{
+	if (!(jlink.capabilities[0] & JLINK_CAPABILITY_SWO)) {
+		DEBUG_ERROR("J-Link does not support SWO capture\n");
+		return false;
+	}
+	if (mode != swo_nrz_uart) {
+		DEBUG_ERROR("J-Link only supports UART SWO capture\n");
+		return false;
+	}
+
+	*actual_baudrate = jlink_swo_baudrate(baudrate);
+	uint8_t request[21U] = {JLINK_CMD_SWO, JLINK_SWO_CMD_START};
+	request[2U] = 4U;
+	request[3U] = JLINK_SWO_PARAM_MODE;
+	write_le4(request, 4U, JLINK_SWO_MODE_UART);
+	request[8U] = 4U;
+	request[9U] = JLINK_SWO_PARAM_BAUDRATE;
+	write_le4(request, 10U, *actual_baudrate);
+	request[14U] = 4U;
+	request[15U] = JLINK_SWO_PARAM_BUFFER_SIZE;
+	write_le4(request, 16U, JLINK_SWO_BUFFER_SIZE);
+	/* The last byte, left 0, ends the parameter list */
+	uint8_t status[4U] = {0};
+	if (bmda_usb_transfer(bmda_probe_info.usb_link, request, sizeof(request), status, sizeof(status),
+			JLINK_USB_TIMEOUT) < 0 ||
+		read_le4(status, 0U) != 0U) {
+		DEBUG_ERROR("Failed to start J-Link SWO capture\n");
+		return false;
+	}
+	swo_stats.buffer_size = JLINK_SWO_BUFFER_SIZE;
+	return true;
+}
+
+void jlink_swo_stop(void)
+{
+	const uint8_t request[3U] = {JLINK_CMD_SWO, JLINK_SWO_CMD_STOP, 0U};
+	uint8_t status[4U] = {0};
+	bmda_usb_transfer(bmda_probe_info.usb_link, request, sizeof(request), status, sizeof(status), JLINK_USB_TIMEOUT);
+}
+
+size_t jlink_swo_read(uint8_t *const data, const size_t length)
+{
+	const uint32_t count = (uint32_t)MIN(length, JLINK_SWO_BUFFER_SIZE);
+	uint8_t request[9U] = {JLINK_CMD_SWO, JLINK_SWO_CMD_READ, 4U, JLINK_SWO_PARAM_READ_SIZE};
+	write_le4(request, 4U, count);
+	/* This replies with the 32 bit status and the 32 bit length of the data, then the data in a packet of its own */
+	uint8_t header[8U] = {0};
+	if (bmda_usb_transfer(bmda_probe_info.usb_link, request, sizeof(request), header, sizeof(header),
+			JLINK_USB_TIMEOUT) < 0)
+		return 0U;
+	if (read_le4(header, 0U) & JLINK_SWO_STATUS_OVERRUN)
+		++swo_stats.overflows;
+	const uint32_t received = MIN(read_le4(header, 4U), count);
+	if (!received)
+		return 0U;
+	const int result = bmda_usb_transfer(bmda_probe_info.usb_link, NULL, 0U, data, received, JLINK_USB_TIMEOUT);
+	if (result < 0)
+		return 0U;
+	swo_stats.bytes_captured += (uint32_t)result;
+	return (size_t)result;
+}
@@ -23,6 +23,7 @@
 #define PLATFORMS_HOSTED_JLINK_H
 
 #include "bmp_hosted.h"
+#include "swo.h"
 
 bool jlink_init(void);
 bool jlink_swd_init(adiv5_debug_port_s *dp);
@@ -35,5 +36,8 @@ void jlink_max_frequency_set(uint32_t frequency);
 uint32_t jlink_max_frequency_get(void);
 bool jlink_target_set_power(bool power);
 bool jlink_target_get_power(void);
+bool jlink_swo_start(swo_coding_e mode, uint32_t baudrate, uint32_t *actual_baudrate);
+void jlink_swo_stop(void);
+size_t jlink_swo_read(uint8_t *data, size_t length);
 
 #endif /* PLATFORMS_HOSTED_JLINK_H */
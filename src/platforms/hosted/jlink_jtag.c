@@ -40,6 +40,7 @@ static void jlink_jtag_tms_seq(uint32_t tms_states, size_t clock_cycles);
 static void jlink_jtag_tdi_tdo_seq(uint8_t *data_out, bool final_tms, const uint8_t *data_in, size_t clock_cycles);
 static void jlink_jtag_tdi_seq(bool final_tms, const uint8_t *data_in, size_t clock_cycles);
 static bool jlink_jtag_next(bool tms, bool tdi);
+static void jlink_jtag_sequence(const uint8_t *tms, const uint8_t *tdi, uint8_t *tdo, size_t clock_cycles);
 
 static const uint8_t jlink_switch_to_jtag_seq[9U] = {0xffU, 0xffU, 0xffU, 0xffU, 0xffU, 0xffU, 0xffU, 0x3cU, 0xe7U};
 
@@ -66,6 +67,7 @@ bool jlink_jtag_init(void)
 	jtag_proc.jtagtap_tms_seq = jlink_jtag_tms_seq;
 	jtag_proc.jtagtap_tdi_tdo_seq = jlink_jtag_tdi_tdo_seq;
 	jtag_proc.jtagtap_tdi_seq = jlink_jtag_tdi_seq;
+	jtag_proc.jtagtap_sequence = jlink_jtag_sequence;
 	return true;
 }
 
@@ -117,3 +119,16 @@ static bool jlink_jtag_next(bool tms, bool tdi)
 		raise_exception(EXCEPTION_ERROR, "jtagtap_next failed");
 	return tdo;
 }
+
+static void jlink_jtag_sequence(
+	const uint8_t *const tms, const uint8_t *const tdi, uint8_t *const tdo, const size_t clock_cycles)
+{
+	/* The adaptor's IO transaction is exactly this operation, so just split it up into the biggest chunks allowed */
+	for (size_t cycle = 0U; cycle < clock_cycles; cycle += 4096U) {
+		const size_t offset = cycle >> 3U;
+		const uint16_t cycles = (uint16_t)MIN(clock_cycles - cycle, 4096U);
+		DEBUG_PROBE("jtagtap_sequence %u clock cycles\n", cycles);
+		if (!jlink_transfer(cycles, tms + offset, tdi + offset, tdo ? tdo + offset : NULL))
+			raise_exception(EXCEPTION_ERROR, "jtagtap_sequence failed");
+	}
+}
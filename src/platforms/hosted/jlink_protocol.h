@@ -185,6 +185,43 @@
 #define JLINK_CMD_CONFIG_READ  0xf2U /* Read the probe configuration */
 #define JLINK_CMD_CONFIG_WRITE 0xf3U /* Write the probe configuration */
 
+/* 
+ * SWO commands
+ *
+ * ┌─────────────────────┬────────────────────────────────┐
+ * │ BMDA J-Link command │ RM08001 J-Link USB Protocol RM │
+ * ├─────────────────────┼────────────────────────────────┤
+ * │ JLINK_CMD_SWO       │    -   EMU_CMD_SWO             │
+ * └─────────────────────┴────────────────────────────────┘
+ *
+ * The SWO command opcodes and parameters were obtained from libjaylink, with no official documentation to back them up
+ */
+#define JLINK_CMD_SWO 0xebU /* SWO capture control and data, with a sub-command */
+
+#define JLINK_SWO_CMD_START  0x64U /* Start capture, followed by parameters */
+#define JLINK_SWO_CMD_STOP   0x65U /* Stop capture */
+#define JLINK_SWO_CMD_READ   0x66U /* Read captured data, followed by parameters */
+#define JLINK_SWO_CMD_SPEEDS 0x6eU /* Get the base frequency and divider range for a mode, followed by parameters */
+
+/* Parameters are each a length byte, an ID byte and then the value, with a 0 length ending the list */
+#define JLINK_SWO_PARAM_MODE        0x01U /* 32 bit capture mode */
+#define JLINK_SWO_PARAM_BAUDRATE    0x02U /* 32 bit baud rate */
+#define JLINK_SWO_PARAM_READ_SIZE   0x03U /* 32 bit maximum amount of data to read */
+#define JLINK_SWO_PARAM_BUFFER_SIZE 0x04U /* 32 bit capture buffer size on the probe */
+
+#define JLINK_SWO_MODE_UART 0x00000000U /* NRZ/UART encoding, the only one J-Links capture */
+
+#define JLINK_SWO_STATUS_OVERRUN (1U << 0U) /* The probe's capture buffer overflowed */
+
+/* How much of the probe's memory to ask for as the capture buffer, which is also the most read at once */
+#define JLINK_SWO_BUFFER_SIZE 4096U
+
+/* SWO speeds - JLINK_SWO_CMD_SPEEDS, after the 32 bit response length */
+#define JLINK_SWO_SPEEDS_LENGTH           28U
+#define JLINK_SWO_SPEEDS_FREQUENCY_OFFSET 0U /* 32 bit base frequency */
+#define JLINK_SWO_SPEEDS_MIN_DIV_OFFSET   4U /* 32 bit minimum divider */
+#define JLINK_SWO_SPEEDS_MAX_DIV_OFFSET   8U /* 32 bit maximum divider */
+
 /* 
  * The hardware version is returned as a 32 bit value with the following format:
  * TTMMmmrr
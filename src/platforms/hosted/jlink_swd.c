@@ -76,6 +76,7 @@ static void jlink_swd_seq_out_parity(uint32_t tms_states, size_t clock_cycles);
 static bool jlink_adiv5_raw_write_no_check(uint16_t addr, uint32_t data);
 static uint32_t jlink_adiv5_raw_read_no_check(uint16_t addr);
 static uint32_t jlink_adiv5_raw_access(adiv5_debug_port_s *dp, uint8_t rnw, uint16_t addr, uint32_t request_value);
+static bool jlink_adiv5_transfers(adiv5_debug_port_s *dp, const adiv5_transfer_s *transfers, size_t count);
 
 bool jlink_swd_init(adiv5_debug_port_s *dp)
 {
@@ -97,6 +98,7 @@ bool jlink_swd_init(adiv5_debug_port_s *dp)
 	dp->write_no_check = jlink_adiv5_raw_write_no_check;
 	dp->read_no_check = jlink_adiv5_raw_read_no_check;
 	dp->low_access = jlink_adiv5_raw_access;
+	dp->transfers = jlink_adiv5_transfers;
 	return true;
 }
 
@@ -299,6 +301,7 @@ static uint32_t jlink_adiv5_raw_access(
 
 	if (ack == SWD_ACK_WAIT) {
 		DEBUG_WARN("SWD access resulted in wait, aborting\n");
+		adiv5_dp_shadow_invalidate(dp);
 		dp->abort(dp, ADIV5_DP_ABORT_DAPABORT);
 		dp->fault = ack;
 		return 0;
@@ -334,3 +337,146 @@ static uint32_t jlink_adiv5_raw_access(
 	DEBUG_PROBE("%s: addr %04x <- %08" PRIx32 "\n", __func__, addr, request_value);
 	return result_value;
 }
+
+/* An IO transaction being built up from several SWD transactions' worth of direction and data bits */
+typedef struct jlink_swd_batch {
+	uint8_t direction[512U];
+	uint8_t data_in[512U];
+	uint8_t data_out[512U];
+	size_t clock_cycles;
+} jlink_swd_batch_s;
+
+/* Append a run of up to 32 bits clocked in the same direction to the batch */
+static void jlink_swd_batch_bits(
+	jlink_swd_batch_s *const batch, const bool out, const uint32_t value, const size_t bits)
+{
+	for (size_t bit = 0; bit < bits; ++bit, ++batch->clock_cycles) {
+		const size_t byte = batch->clock_cycles >> 3U;
+		const uint8_t mask = 1U << (batch->clock_cycles & 7U);
+		if (out)
+			batch->direction[byte] |= mask;
+		if ((value >> bit) & 1U)
+			batch->data_in[byte] |= mask;
+	}
+}
+
+static uint32_t jlink_swd_batch_result(const jlink_swd_batch_s *const batch, const size_t offset, const size_t bits)
+{
+	uint32_t result = 0U;
+	for (size_t bit = 0; bit < bits; ++bit) {
+		const size_t cycle = offset + bit;
+		if (batch->data_out[cycle >> 3U] & (1U << (cycle & 7U)))
+			result |= 1U << bit;
+	}
+	return result;
+}
+
+/*
+ * Append a complete SWD transaction to the batch using the same cycle layout as the single access path,
+ * returning the clock cycle it starts at so the results can be found again afterwards.
+ * Reads always run their data phase, which overrun detection makes the target expect regardless of ACK.
+ */
+static size_t jlink_swd_batch_transaction(
+	jlink_swd_batch_s *const batch, const uint8_t rnw, const uint16_t addr, const uint32_t value)
+{
+	const size_t offset = batch->clock_cycles;
+	jlink_swd_batch_bits(batch, true, make_packet_request(rnw, addr), 8U);
+	if (rnw) {
+		/* Turnaround and ACK, then 32 data bits and parity in, ending with 2 idle cycles out */
+		jlink_swd_batch_bits(batch, false, 0U, 3U);
+		jlink_swd_batch_bits(batch, false, 0U, 32U);
+		jlink_swd_batch_bits(batch, false, 0U, 1U);
+		jlink_swd_batch_bits(batch, true, 0U, 2U);
+	} else {
+		/* Turnaround and ACK, the turnaround back, then 32 data bits, parity and 8 idle cycles out */
+		jlink_swd_batch_bits(batch, false, 0U, 4U);
+		jlink_swd_batch_bits(batch, true, 0U, 1U);
+		jlink_swd_batch_bits(batch, true, value, 32U);
+		jlink_swd_batch_bits(batch, true, calculate_odd_parity(value), 1U);
+		jlink_swd_batch_bits(batch, true, 0U, 8U);
+	}
+	return offset;
+}
+
+/* Check the ACK (and for reads, the parity) of a transaction in a completed batch */
+static bool jlink_swd_batch_check(
+	const jlink_swd_batch_s *const batch, const size_t offset, const uint8_t rnw, uint32_t *const result)
+{
+	if (jlink_swd_batch_result(batch, offset + 8U, 3U) != SWD_ACK_OK)
+		return false;
+	if (!rnw)
+		return true;
+	const uint32_t value = jlink_swd_batch_result(batch, offset + 11U, 32U);
+	if (calculate_odd_parity(value) != jlink_swd_batch_result(batch, offset + 43U, 1U))
+		return false;
+	if (result)
+		*result = value;
+	return true;
+}
+
+/*
+ * Run a batch of DP and AP accesses as a single IO transaction rather than one per access, validating
+ * the ACKs afterwards. The data phase of each access goes out before its ACK is known, so the batch is
+ * bracketed by enabling and disabling overrun detection. If any access fails, the DP is recovered and
+ * everything from that access on is replayed one at a time so WAIT and FAULT get handled as normal.
+ */
+static bool jlink_adiv5_transfers(
+	adiv5_debug_port_s *const dp, const adiv5_transfer_s *const transfers, const size_t count)
+{
+	if (dp->fault)
+		return false;
+	jlink_swd_batch_s *const batch = calloc(1U, sizeof(*batch));
+	size_t *const offsets = calloc(count, sizeof(*offsets));
+	if (!batch || !offsets) { /* calloc failed: heap exhaustion */
+		DEBUG_ERROR("calloc: failed in %s\n", __func__);
+		free(batch);
+		free(offsets);
+		return false;
+	}
+
+	const uint32_t ctrlstat = ADIV5_DP_CTRLSTAT_CSYSPWRUPREQ | ADIV5_DP_CTRLSTAT_CDBGPWRUPREQ;
+	const size_t enable =
+		jlink_swd_batch_transaction(batch, ADIV5_LOW_WRITE, ADIV5_DP_CTRLSTAT, ctrlstat | ADIV5_DP_CTRLSTAT_ORUNDETECT);
+	/* An AP read only returns its result via the next access, so follow each one with a read of RDBUFF */
+	for (size_t idx = 0; idx < count; ++idx) {
+		const adiv5_transfer_s *const transfer = &transfers[idx];
+		offsets[idx] = jlink_swd_batch_transaction(batch, transfer->rnw, transfer->addr, transfer->value);
+		if (transfer->rnw == ADIV5_LOW_READ && (transfer->addr & ADIV5_APnDP))
+			jlink_swd_batch_transaction(batch, ADIV5_LOW_READ, ADIV5_DP_RDBUFF, 0U);
+	}
+	const size_t disable = jlink_swd_batch_transaction(batch, ADIV5_LOW_WRITE, ADIV5_DP_CTRLSTAT, ctrlstat);
+
+	/* The worst case batch is 12 AP reads at 92 cycles each plus the bracketing, well under the 4096 limit */
+	bool result = jlink_transfer(batch->clock_cycles, batch->direction, batch->data_in, batch->data_out) &&
+		jlink_swd_batch_check(batch, enable, ADIV5_LOW_WRITE, NULL);
+	size_t failed = 0U;
+	for (; result && failed < count; ++failed) {
+		const adiv5_transfer_s *const transfer = &transfers[failed];
+		if (transfer->rnw == ADIV5_LOW_READ && (transfer->addr & ADIV5_APnDP)) {
+			/* The RDBUFF read follows straight on from the AP read, 46 cycles on */
+			result = jlink_swd_batch_check(batch, offsets[failed], ADIV5_LOW_READ, NULL) &&
+				jlink_swd_batch_check(batch, offsets[failed] + 46U, ADIV5_LOW_READ, transfer->result);
+		} else
+			result = jlink_swd_batch_check(batch, offsets[failed], transfer->rnw, transfer->result);
+		if (!result)
+			break;
+	}
+	result = result && jlink_swd_batch_check(batch, disable, ADIV5_LOW_WRITE, NULL);
+	free(batch);
+	free(offsets);
+	if (result)
+		return true;
+
+	/* Recover the DP, put overrun detection back the way it was and replay the rest individually */
+	DEBUG_PROBE("%s: batch failed at access %zu of %zu, replaying\n", __func__, failed, count);
+	dp->error(dp, true);
+	adiv5_dp_low_access(dp, ADIV5_LOW_WRITE, ADIV5_DP_CTRLSTAT, ctrlstat);
+	for (size_t idx = failed; idx < count && !dp->fault; ++idx) {
+		const adiv5_transfer_s *const transfer = &transfers[idx];
+		if (transfer->rnw == ADIV5_LOW_READ)
+			*transfer->result = adiv5_dp_read(dp, transfer->addr);
+		else
+			adiv5_dp_write(dp, transfer->addr, transfer->value);
+	}
+	return !dp->fault;
+}
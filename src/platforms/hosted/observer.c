@@ -0,0 +1,385 @@
+/*
+ * This file is part of the Black Magic Debug project.
+ *
+ * Copyright (C) 2026 1BitSquared <info@1bitsquared.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * This file implements read-only observer clients, which share the target session of the controlling GDB so
+ * dashboards and the like can look at a running target without a probe of their own or stealing the session.
+ *
+ * Observers connect over TCP and send one request per line, getting one line back for each:
+ *   read ADDR LEN     -> "ok HEX", served from the memory read cache while halted
+ *   watch ADDR [SIZE] -> "ok", then "watch ADDR VALUE" lines as the value changes while the target runs
+ *   unwatch           -> "ok", dropping all of this client's watches
+ *   rtt on|off        -> "ok", then "rtt CHANNEL HEX" lines with what the target writes to its up channels
+ *   status            -> "ok detached", "ok halted DRIVER" or "ok running DRIVER"
+ * Anything else, including all run control, is refused with an "error" line.
+ *
+ * Watches go into the live watch engine alongside GDB's own, so an address several clients (or GDB) watch is
+ * still only read once per round. While the target runs, reads repeated within a live watch period are answered
+ * from the last one rather than going back to the probe, and ones that would need the target halting are refused.
+ */
+
+#include "general.h"
+#include "target.h"
+#include "target_internal.h"
+#include "gdb_main.h"
+#include "hex_utils.h"
+#include "exception.h"
+#include "live_watch.h"
+#include "observer.h"
+
+#ifndef _WIN32
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdarg.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0
+#endif
+
+#define OBSERVER_MAX_CLIENTS 4U
+#define OBSERVER_LINE_LEN    128U
+#define OBSERVER_WATCHES     16U
+/* Largest single read an observer can ask for */
+#define OBSERVER_READ_MAX 1024U
+/* How many of the reads done while the target runs to remember */
+#define OBSERVER_CACHED_READS 8U
+/* How much RTT data to put on each "rtt" line */
+#define OBSERVER_RTT_CHUNK 256U
+
+typedef struct observer_watch {
+	target_addr_t addr;
+	uint8_t size;
+} observer_watch_s;
+
+typedef struct observer_client {
+	int fd;
+	bool rtt;
+	size_t line_used;
+	char line[OBSERVER_LINE_LEN];
+	size_t watch_count;
+	observer_watch_s watches[OBSERVER_WATCHES];
+} observer_client_s;
+
+typedef struct observer_cached_read {
+	target_s *target;
+	target_addr_t addr;
+	uint32_t length;
+	uint32_t time_ms;
+	uint8_t data[OBSERVER_READ_MAX];
+} observer_cached_read_s;
+
+static int observer_listener = -1;
+static observer_client_s observer_clients[OBSERVER_MAX_CLIENTS];
+static observer_cached_read_s observer_cached_reads[OBSERVER_CACHED_READS];
+static size_t observer_cached_next = 0U;
+/* Set when a client's watches change, the live watch engine's table can't be touched while it reports */
+static bool observer_rewatch_pending = false;
+
+static void observer_live_watch(target_addr_t addr, uint8_t size, uint32_t value);
+
+bool observer_init(const uint16_t port)
+{
+	observer_listener = socket(AF_INET, SOCK_STREAM, 0);
+	if (observer_listener == -1)
+		return false;
+	const int reuse = 1;
+	setsockopt(observer_listener, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+	/* Only local clients, as they get to read anything the target has */
+	struct sockaddr_in addr = {0};
+	addr.sin_family = AF_INET;
+	addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	addr.sin_port = htons(port);
+	if (bind(observer_listener, (const struct sockaddr *)&addr, sizeof(addr)) == -1 ||
+		listen(observer_listener, OBSERVER_MAX_CLIENTS) == -1) {
+		DEBUG_ERROR("Error listening for observers on port %u: %s\n", port, strerror(errno));
+		close(observer_listener);
+		observer_listener = -1;
+		return false;
+	}
+	/* Accepting is polled, so the listener mustn't block */
+	fcntl(observer_listener, F_SETFL, fcntl(observer_listener, F_GETFL, 0) | O_NONBLOCK);
+	for (size_t idx = 0U; idx < OBSERVER_MAX_CLIENTS; ++idx)
+		observer_clients[idx].fd = -1;
+	live_watch_observer = observer_live_watch;
+	DEBUG_WARN("Serving read-only observers on TCP port %u\n", port);
+	return true;
+}
+
+bool observer_active(void)
+{
+	return observer_listener != -1;
+}
+
+/* Put all the watches any client wants back into the live watch engine, once each */
+static void observer_rewatch(void)
+{
+	observer_rewatch_pending = false;
+	live_watch_clear(LIVE_WATCH_OWNER_OBSERVER);
+	for (size_t idx = 0U; idx < OBSERVER_MAX_CLIENTS; ++idx) {
+		const observer_client_s *const client = &observer_clients[idx];
+		for (size_t watch = 0U; client->fd != -1 && watch < client->watch_count; ++watch)
+			live_watch_add(client->watches[watch].addr, client->watches[watch].size, LIVE_WATCH_OWNER_OBSERVER);
+	}
+}
+
+static void observer_drop(observer_client_s *const client)
+{
+	close(client->fd);
+	client->fd = -1;
+	client->rtt = false;
+	client->line_used = 0U;
+	if (client->watch_count) {
+		client->watch_count = 0U;
+		observer_rewatch_pending = true;
+	}
+	DEBUG_INFO("Observer disconnected\n");
+}
+
+static void observer_send(observer_client_s *const client, const char *const fmt, ...)
+{
+	char line[OBSERVER_READ_MAX * 2U + 32U];
+	va_list args;
+	va_start(args, fmt);
+	const int length = vsnprintf(line, sizeof(line) - 1U, fmt, args);
+	va_end(args);
+	if (length < 0)
+		return;
+	size_t used = MIN((size_t)length, sizeof(line) - 2U);
+	line[used++] = '\n';
+	for (size_t offset = 0U; offset < used;) {
+		const ssize_t result = send(client->fd, line + offset, used - offset, MSG_NOSIGNAL);
+		if (result < 0 && errno == EINTR)
+			continue;
+		if (result <= 0) {
+			observer_drop(client);
+			return;
+		}
+		offset += (size_t)result;
+	}
+}
+
+static void observer_live_watch(const target_addr_t addr, const uint8_t size, const uint32_t value)
+{
+	for (size_t idx = 0U; idx < OBSERVER_MAX_CLIENTS; ++idx) {
+		observer_client_s *const client = &observer_clients[idx];
+		for (size_t watch = 0U; client->fd != -1 && watch < client->watch_count; ++watch) {
+			if (client->watches[watch].addr == addr) {
+				observer_send(client, "watch 0x%08" PRIx32 " 0x%0*" PRIx32, addr, size * 2, value);
+				break;
+			}
+		}
+	}
+}
+
+void observer_rtt(const uint32_t channel, const char *const data, const uint32_t length)
+{
+	char hex[OBSERVER_RTT_CHUNK * 2U + 1U];
+	for (size_t idx = 0U; idx < OBSERVER_MAX_CLIENTS; ++idx) {
+		observer_client_s *const client = &observer_clients[idx];
+		for (uint32_t offset = 0U; client->fd != -1 && client->rtt && offset < length;) {
+			const uint32_t amount = MIN(length - offset, OBSERVER_RTT_CHUNK);
+			hexify(hex, data + offset, amount);
+			observer_send(client, "rtt %" PRIu32 " %s", channel, hex);
+			offset += amount;
+		}
+	}
+}
+
+/* Read target memory for an observer, returning why not if it can't be done without disturbing the session */
+static const char *observer_read(target_s *const target, const target_addr_t addr, const uint32_t length,
+	uint8_t **const data)
+{
+	if (!target)
+		return "no target attached";
+	if (target->flash_mode)
+		return "target busy";
+	if (!gdb_target_running) {
+		/* Halted, so the target's own memory read cache takes care of repeats */
+		static uint8_t buffer[OBSERVER_READ_MAX];
+		*data = buffer;
+		return target_mem32_read(target, buffer, addr, length) ? "read failed" : NULL;
+	}
+
+	const uint32_t now = platform_time_ms();
+	for (size_t idx = 0U; idx < OBSERVER_CACHED_READS; ++idx) {
+		observer_cached_read_s *const read = &observer_cached_reads[idx];
+		if (read->target == target && read->addr == addr && read->length >= length &&
+			now - read->time_ms < live_watch_rate_ms) {
+			*data = read->data;
+			return NULL;
+		}
+	}
+	/* Reading now would mean halting the target, which is the controlling GDB's business only */
+	if (target_mem_access_needs_halt(target))
+		return "target running";
+	observer_cached_read_s *const read = &observer_cached_reads[observer_cached_next];
+	observer_cached_next = (observer_cached_next + 1U) % OBSERVER_CACHED_READS;
+	read->target = NULL;
+	if (target_mem32_read(target, read->data, addr, length))
+		return "read failed";
+	*read = (observer_cached_read_s){
+		.target = target,
+		.addr = addr,
+		.length = length,
+		.time_ms = now,
+	};
+	*data = read->data;
+	return NULL;
+}
+
+static void observer_request_read(observer_client_s *const client, target_s *const target, const char *const args)
+{
+	char *end = NULL;
+	const target_addr_t addr = strtoul(args, &end, 0);
+	const uint32_t length = strtoul(end, NULL, 0);
+	if (end == args || !length || length > OBSERVER_READ_MAX) {
+		observer_send(client, "error usage: read ADDR LEN, LEN up to %u", OBSERVER_READ_MAX);
+		return;
+	}
+	uint8_t *data = NULL;
+	const char *const error = observer_read(target, addr, length, &data);
+	if (error) {
+		observer_send(client, "error %s", error);
+		return;
+	}
+	char hex[OBSERVER_READ_MAX * 2U + 1U];
+	hexify(hex, data, length);
+	observer_send(client, "ok %s", hex);
+}
+
+static void observer_request_watch(observer_client_s *const client, const char *const args)
+{
+	char *end = NULL;
+	const target_addr_t addr = strtoul(args, &end, 0);
+	char *size_end = NULL;
+	uint32_t size = strtoul(end, &size_end, 0);
+	if (size_end == end)
+		size = 4U;
+	if (end == args || client->watch_count == OBSERVER_WATCHES || size > 4U ||
+		!live_watch_add(addr, (uint8_t)size, LIVE_WATCH_OWNER_OBSERVER)) {
+		observer_send(client, "error watch must be 1, 2 or 4 bytes, naturally aligned, and the table not full");
+		return;
+	}
+	client->watches[client->watch_count++] = (observer_watch_s){addr, (uint8_t)size};
+	observer_send(client, "ok");
+}
+
+static void observer_request(observer_client_s *const client, target_s *const target, char *const line)
+{
+	char *args = line;
+	while (*args && *args != ' ')
+		++args;
+	if (*args)
+		*args++ = '\0';
+
+	if (strcmp(line, "read") == 0)
+		observer_request_read(client, target, args);
+	else if (strcmp(line, "watch") == 0)
+		observer_request_watch(client, args);
+	else if (strcmp(line, "unwatch") == 0) {
+		client->watch_count = 0U;
+		observer_rewatch_pending = true;
+		observer_send(client, "ok");
+	} else if (strcmp(line, "rtt") == 0 && (strcmp(args, "on") == 0 || strcmp(args, "off") == 0)) {
+		client->rtt = strcmp(args, "on") == 0;
+		observer_send(client, "ok");
+	} else if (strcmp(line, "status") == 0) {
+		if (!target)
+			observer_send(client, "ok detached");
+		else
+			observer_send(client, "ok %s %s", gdb_target_running ? "running" : "halted", target->driver);
+	} else
+		observer_send(client, "error observers are read-only, run control belongs to the GDB session");
+}
+
+/* Take what the client has sent, answering each complete line */
+static void observer_receive(observer_client_s *const client, target_s *const target)
+{
+	char buffer[OBSERVER_LINE_LEN];
+	const ssize_t result = recv(client->fd, buffer, sizeof(buffer), MSG_DONTWAIT);
+	if (result == 0 || (result < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)) {
+		observer_drop(client);
+		return;
+	}
+	for (ssize_t idx = 0; idx < result && client->fd != -1; ++idx) {
+		const char ch = buffer[idx];
+		if (ch == '\r')
+			continue;
+		if (ch != '\n') {
+			/* Overlong lines are cut short rather than split into more requests */
+			if (client->line_used < OBSERVER_LINE_LEN - 1U)
+				client->line[client->line_used++] = ch;
+			continue;
+		}
+		client->line[client->line_used] = '\0';
+		client->line_used = 0U;
+		TRY (EXCEPTION_ALL) {
+			observer_request(client, target, client->line);
+		}
+		CATCH () {
+		default:
+			DEBUG_WARN("Observer request failed: %s\n", exception_frame.msg);
+			observer_send(client, "error target access failed");
+			break;
+		}
+	}
+}
+
+void observer_poll(target_s *const target)
+{
+	if (observer_listener == -1)
+		return;
+
+	struct pollfd fds[OBSERVER_MAX_CLIENTS + 1U];
+	for (size_t idx = 0U; idx < OBSERVER_MAX_CLIENTS; ++idx)
+		fds[idx] = (struct pollfd){.fd = observer_clients[idx].fd, .events = POLLIN};
+	fds[OBSERVER_MAX_CLIENTS] = (struct pollfd){.fd = observer_listener, .events = POLLIN};
+	if (poll(fds, OBSERVER_MAX_CLIENTS + 1U, 0) <= 0)
+		return;
+
+	for (size_t idx = 0U; idx < OBSERVER_MAX_CLIENTS; ++idx) {
+		if (observer_clients[idx].fd != -1 && fds[idx].revents)
+			observer_receive(&observer_clients[idx], target);
+	}
+	if (observer_rewatch_pending)
+		observer_rewatch();
+
+	if (!(fds[OBSERVER_MAX_CLIENTS].revents & POLLIN))
+		return;
+	const int fd = accept(observer_listener, NULL, NULL);
+	if (fd == -1)
+		return;
+	for (size_t idx = 0U; idx < OBSERVER_MAX_CLIENTS; ++idx) {
+		observer_client_s *const client = &observer_clients[idx];
+		if (client->fd == -1) {
+			/* Requests are read without blocking and answers written with blocking, as for RTT's clients */
+			fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) & ~O_NONBLOCK);
+			*client = (observer_client_s){.fd = fd};
+			DEBUG_INFO("Observer connected\n");
+			return;
+		}
+	}
+	DEBUG_WARN("Turning away an observer, already serving %u\n", OBSERVER_MAX_CLIENTS);
+	close(fd);
+}
+#endif
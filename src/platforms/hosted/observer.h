@@ -0,0 +1,59 @@
+/*
+ * This file is part of the Black Magic Debug project.
+ *
+ * Copyright (C) 2026 1BitSquared <info@1bitsquared.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef PLATFORMS_HOSTED_OBSERVER_H
+#define PLATFORMS_HOSTED_OBSERVER_H
+
+#include "target.h"
+
+#ifndef _WIN32
+/* Listen for read-only observer clients on the given TCP port of the loopback interface */
+bool observer_init(uint16_t port);
+/* Whether observers are being served, in which case anything waiting on GDB has to keep calling observer_poll() */
+bool observer_active(void);
+/* Accept new observers and answer what they've asked for, against the target GDB is attached to (if any) */
+void observer_poll(target_s *target);
+/* Copy data the target wrote to an RTT up channel to the observers tapping it */
+void observer_rtt(uint32_t channel, const char *data, uint32_t length);
+#else
+static inline bool observer_init(const uint16_t port)
+{
+	(void)port;
+	return false;
+}
+
+static inline bool observer_active(void)
+{
+	return false;
+}
+
+static inline void observer_poll(target_s *const target)
+{
+	(void)target;
+}
+
+static inline void observer_rtt(const uint32_t channel, const char *const data, const uint32_t length)
+{
+	(void)channel;
+	(void)data;
+	(void)length;
+}
+#endif
+
+#endif /* PLATFORMS_HOSTED_OBSERVER_H */
@@ -38,8 +38,20 @@
 #include "timing.h"
 #include "cli.h"
 #include "gdb_if.h"
+#include "gdb_main.h"
 #include "gdb_packet.h"
+#include "probe_trace.h"
+#include "observer.h"
+#include "sim.h"
+#include "bench_codec.h"
 #include <signal.h>
+#if HOSTED_BMP_ONLY == 0 && !defined(_WIN32) && !defined(__CYGWIN__)
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#endif
 
 #ifdef ENABLE_RTT
 #include "rtt_if.h"
@@ -47,6 +59,7 @@
 
 #include "bmp_remote.h"
 #include "bmp_hosted.h"
+#include "swo.h"
 #if HOSTED_BMP_ONLY == 0
 #include "stlinkv2.h"
 #include "ftdi_bmp.h"
@@ -76,6 +89,8 @@ void bmda_display_probe(void)
 
 static void exit_function(void)
 {
+	/* Take down any SWO capture while the probe is still there to stop it */
+	swo_deinit(true);
 #if HOSTED_BMP_ONLY == 0
 	if (bmda_probe_info.type == PROBE_TYPE_STLINK_V2)
 		stlink_deinit();
@@ -101,6 +116,7 @@ static void exit_function(void)
 	if (bmda_probe_info.libusb_ctx)
 		libusb_exit(bmda_probe_info.libusb_ctx);
 #endif
+	probe_trace_dump();
 	fflush(stdout);
 }
 
@@ -111,6 +127,90 @@ static void sigterm_handler(int sig)
 	exit(0);
 }
 
+#if HOSTED_BMP_ONLY == 0 && !defined(_WIN32) && !defined(__CYGWIN__)
+/* Pass termination on to all the probe workers, which share our process group */
+static void serve_all_sigterm_handler(int sig)
+{
+	signal(sig, SIG_IGN);
+	kill(0, sig);
+}
+
+/* Only the modes that make sense run once per probe can be used across all of them */
+static bool serve_all_mode_valid(const bmda_cli_mode_e mode)
+{
+	return mode == BMP_MODE_DEBUG || mode == BMP_MODE_FLASH_ERASE || mode == BMP_MODE_FLASH_WRITE ||
+		mode == BMP_MODE_FLASH_WRITE_VERIFY || mode == BMP_MODE_FLASH_VERIFY;
+}
+
+/*
+ * Serve every attached probe from a single invocation. The target list, probe backend
+ * and GDB server state are all per process, so each probe gets a forked worker of its own
+ * that carries on with normal start up having selected the probe by position. In debug
+ * server mode, each listens for GDB on a port fixed by that position. For the Flash modes
+ * this gang programs all the boards at once, the image being mapped from the same file by
+ * every worker so that the page cache holds just the one copy. This process waits for the
+ * workers and reports how each of them finished.
+ */
+static void serve_all_probes(void)
+{
+	char **serials = NULL;
+	const size_t probes = list_debugger_serials(&serials);
+	if (!probes) {
+		DEBUG_ERROR("No probes found\n");
+		exit(1);
+	}
+	pid_t *const workers = calloc(probes, sizeof(*workers));
+	if (!workers) { /* calloc failed: heap exhaustion */
+		DEBUG_ERROR("calloc: failed in %s\n", __func__);
+		exit(1);
+	}
+
+	for (size_t position = 1U; position <= probes; ++position) {
+		const uint16_t port = (uint16_t)(2000U + position - 1U);
+		const pid_t pid = fork();
+		if (pid == -1) {
+			DEBUG_ERROR("Failed to start a worker for probe %zu: %s\n", position, strerror(errno));
+			break;
+		}
+		if (pid == 0) {
+			cl_opts.opt_position = position;
+			gdb_if_set_port(port);
+			/* The workers can't all share the terminal for RTT input, so give them none */
+			const int null_fd = open("/dev/null", O_RDONLY);
+			if (null_fd != -1) {
+				dup2(null_fd, STDIN_FILENO);
+				close(null_fd);
+			}
+			free(workers);
+			return;
+		}
+		workers[position - 1U] = pid;
+		if (cl_opts.opt_mode == BMP_MODE_DEBUG)
+			DEBUG_WARN("Probe %zu (%s) served by worker %d on port %u\n", position, serials[position - 1U], (int)pid,
+				port);
+	}
+
+	signal(SIGTERM, serve_all_sigterm_handler);
+	signal(SIGINT, serve_all_sigterm_handler);
+	int status = 0;
+	bool failed = false;
+	for (pid_t pid = wait(&status); pid > 0; pid = wait(&status)) {
+		for (size_t idx = 0U; idx < probes; ++idx) {
+			if (workers[idx] != pid)
+				continue;
+			const bool success = WIFEXITED(status) && WEXITSTATUS(status) == 0;
+			failed |= !success;
+			DEBUG_WARN("Probe %zu (%s): %s\n", idx + 1U, serials[idx], success ? "success" : "FAILED");
+		}
+	}
+	for (size_t idx = 0U; idx < probes; ++idx)
+		free(serials[idx]);
+	free(serials);
+	free(workers);
+	exit(failed ? 1 : 0);
+}
+#endif
+
 void platform_init(int argc, char **argv)
 {
 #if defined(_WIN32) || defined(__CYGWIN__)
@@ -121,14 +221,32 @@ void platform_init(int argc, char **argv)
 	}
 #endif
 	cl_init(&cl_opts, argc, argv);
+	if (cl_opts.opt_trace_file && !probe_trace_enable(cl_opts.opt_trace_file))
+		exit(1);
 	atexit(exit_function);
 	signal(SIGTERM, sigterm_handler);
 	signal(SIGINT, sigterm_handler);
 
+	if (cl_opts.opt_mode == BMP_MODE_BENCH && cl_opts.opt_bench_codec)
+		exit(bench_codec_run() ? 0 : 1);
+
+#if HOSTED_BMP_ONLY == 0 && !defined(_WIN32) && !defined(__CYGWIN__)
+	if (cl_opts.opt_all_probes) {
+		if (!serve_all_mode_valid(cl_opts.opt_mode) || cl_opts.opt_device || cl_opts.opt_gpio_map ||
+			cl_opts.opt_sim) {
+			DEBUG_ERROR("Serving all probes only works for USB probes, in debug server or Flash mode\n");
+			exit(1);
+		}
+		serve_all_probes();
+	}
+#endif
+
 	if (cl_opts.opt_device)
 		bmda_probe_info.type = PROBE_TYPE_BMP;
 	else if (cl_opts.opt_gpio_map)
 		bmda_probe_info.type = PROBE_TYPE_GPIOD;
+	else if (cl_opts.opt_sim)
+		bmda_probe_info.type = PROBE_TYPE_SIM;
 	else if (!find_debuggers(&cl_opts, &bmda_probe_info))
 		exit(1);
 
@@ -172,6 +290,11 @@ void platform_init(int argc, char **argv)
 		break;
 #endif
 
+	case PROBE_TYPE_SIM:
+		if (!sim_init(&cl_opts))
+			exit(1);
+		break;
+
 	default:
 		exit(1);
 	}
@@ -182,21 +305,45 @@ void platform_init(int argc, char **argv)
 	if (cl_opts.opt_mode != BMP_MODE_DEBUG)
 		exit(cl_execute(&cl_opts));
 	else {
+#if !defined(_WIN32) && !defined(__CYGWIN__)
+		if (cl_opts.opt_gdb_socket)
+			gdb_if_set_unix_socket(cl_opts.opt_gdb_socket);
+#endif
 		gdb_if_init();
+		gdb_persist = cl_opts.opt_persist;
+		if (cl_opts.opt_observer_port)
+			observer_init(cl_opts.opt_observer_port);
+		swo_set_capture_file(cl_opts.opt_swo_file);
 
 #ifdef ENABLE_RTT
+#ifndef _WIN32
+		rtt_if_set_port(cl_opts.opt_rtt_port);
+#endif
 		rtt_if_init();
 #endif
 	}
 }
 
+size_t bmda_persist_target(void)
+{
+	if (!target_list && !scan_for_targets(&cl_opts))
+		return 0U;
+	return cl_opts.opt_target_dev;
+}
+
 bool bmda_swd_scan(const uint32_t targetid)
 {
 	bmda_probe_info.is_jtag = false;
 	platform_max_frequency_set(max_frequency);
 
 	switch (bmda_probe_info.type) {
-	case PROBE_TYPE_BMP:
+	case PROBE_TYPE_BMP: {
+		const bool result = adiv5_swd_scan(targetid);
+		if (result)
+			remote_flash_offload_setup(false, targetid);
+		return result;
+	}
+
 	case PROBE_TYPE_FTDI:
 	case PROBE_TYPE_CMSIS_DAP:
 	case PROBE_TYPE_JLINK:
@@ -210,6 +357,9 @@ bool bmda_swd_scan(const uint32_t targetid)
 		return stlink_swd_scan();
 #endif
 
+	case PROBE_TYPE_SIM:
+		return sim_swd_scan();
+
 	default:
 		return false;
 	}
@@ -235,11 +385,12 @@ bool bmda_swd_dp_init(adiv5_debug_port_s *dp)
 		return jlink_swd_init(dp);
 
 	case PROBE_TYPE_FTDI:
-		return ftdi_swd_init();
+		return ftdi_swd_init(dp);
 #endif
 
 #ifdef ENABLE_GPIOD
 	case PROBE_TYPE_GPIOD:
+		dp->transfers = adiv5_swd_transfers;
 		return bmda_gpiod_swd_init();
 #endif
 
@@ -260,7 +411,13 @@ bool bmda_jtag_scan(void)
 	platform_max_frequency_set(max_frequency);
 
 	switch (bmda_probe_info.type) {
-	case PROBE_TYPE_BMP:
+	case PROBE_TYPE_BMP: {
+		const bool result = jtag_scan();
+		if (result)
+			remote_flash_offload_setup(true, 0U);
+		return result;
+	}
+
 	case PROBE_TYPE_FTDI:
 	case PROBE_TYPE_JLINK:
 	case PROBE_TYPE_CMSIS_DAP:
@@ -358,20 +515,28 @@ void bmda_adiv6_dp_init(adiv5_debug_port_s *const dp)
 
 void bmda_jtag_dp_init(adiv5_debug_port_s *const dp)
 {
-#if HOSTED_BMP_ONLY == 0
 	switch (bmda_probe_info.type) {
+#if HOSTED_BMP_ONLY == 0
 	case PROBE_TYPE_STLINK_V2:
 		stlink_jtag_dp_init(dp);
 		break;
 	case PROBE_TYPE_CMSIS_DAP:
 		dap_jtag_dp_init(dp);
 		break;
+	/* These drive the scans through jtag_proc from here, so can pipeline a batch of accesses */
+	case PROBE_TYPE_JLINK:
+	case PROBE_TYPE_FTDI:
+		dp->transfers = adiv5_jtag_transfers;
+		break;
+#endif
+#ifdef ENABLE_GPIOD
+	case PROBE_TYPE_GPIOD:
+		dp->transfers = adiv5_jtag_transfers;
+		break;
+#endif
 	default:
 		break;
 	}
-#else
-	(void)dp;
-#endif
 }
 
 void bmda_riscv_jtag_dtm_init(riscv_dmi_s *const dmi)
@@ -414,6 +579,9 @@ char *bmda_adaptor_ident(void)
 	case PROBE_TYPE_GPIOD:
 		return "GPIOD";
 
+	case PROBE_TYPE_SIM:
+		return "Simulator";
+
 	default:
 		return NULL;
 	}
@@ -466,6 +634,10 @@ void platform_nrst_set_val(const bool assert)
 		break;
 #endif
 
+	case PROBE_TYPE_SIM:
+		sim_nrst_set_val(assert);
+		break;
+
 	default:
 		break;
 	}
@@ -491,6 +663,9 @@ bool platform_nrst_get_val(void)
 		return dap_nrst_get_val();
 #endif
 
+	case PROBE_TYPE_SIM:
+		return sim_nrst_get_val();
+
 	default:
 		return false;
 	}
@@ -528,6 +703,9 @@ void platform_max_frequency_set(const uint32_t freq)
 		break;
 #endif
 
+	case PROBE_TYPE_SIM:
+		break;
+
 	default:
 		DEBUG_WARN("Setting max debug interface frequency not available or not yet implemented\n");
 		break;
@@ -563,6 +741,10 @@ uint32_t platform_max_frequency_get(void)
 		return jlink_max_frequency_get();
 #endif
 
+	/* The simulated link has no clock to speak of, only the fixed latency each access takes */
+	case PROBE_TYPE_SIM:
+		return FREQ_FIXED;
+
 	default:
 		DEBUG_WARN("Reading max debug interface frequency not available or not yet implemented\n");
 		return 0;
@@ -634,6 +816,10 @@ uint32_t platform_target_voltage_sense(void)
 void platform_buffer_flush(void)
 {
 	switch (bmda_probe_info.type) {
+	case PROBE_TYPE_BMP:
+		serial_buffer_flush();
+		break;
+
 #if HOSTED_BMP_ONLY == 0
 	case PROBE_TYPE_FTDI:
 		ftdi_buffer_flush();
@@ -645,10 +831,17 @@ void platform_buffer_flush(void)
 	}
 }
 
+/*
+ * Pace the run loop's target polling, but by waiting on the GDB connection rather than sleeping,
+ * so what GDB sends (^C especially) is acted on the moment it arrives instead of up to a period later.
+ * This is also where any SWO data the probe has captured gets drained each time round the loop.
+ */
 void platform_pace_poll(void)
 {
+	swo_poll();
+	observer_poll(cur_target);
 	if (!cl_opts.fast_poll)
-		platform_delay(8);
+		gdb_if_wait_ready(8U);
 }
 
 void platform_target_clk_output_enable(const bool enable)
@@ -48,6 +48,9 @@ void platform_buffer_flush(void);
 	do {                 \
 	} while (0)
 #define PLATFORM_HAS_POWER_SWITCH
+/* SWO capture is done by the probe, CMSIS-DAP adaptors can do either encoding and J-Links UART */
+#define PLATFORM_HAS_TRACESWO
+#define SWO_ENCODING 3
 
 #define PRODUCT_ID_ANY 0xffffU
 
@@ -85,6 +88,7 @@ typedef enum probe_type {
 	PROBE_TYPE_CMSIS_DAP,
 	PROBE_TYPE_JLINK,
 	PROBE_TYPE_GPIOD,
+	PROBE_TYPE_SIM,
 } probe_type_e;
 
 void bmda_display_probe(void);
@@ -0,0 +1,173 @@
+/*
+ * This file is part of the Black Magic Debug project.
+ *
+ * Copyright (C) 2026 1BitSquared <info@1bitsquared.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * This file implements a binary trace of the DP, AP, memory and JTAG transactions BMDA performs.
+ * Each transaction is recorded into a ring of fixed size records in memory, so recording costs next
+ * to nothing compared to DEBUG_PROTO's text, and the ring is written out once on exit.
+ *
+ * If the trace file name ends in ".json" the trace is written in the Chrome trace event format, which
+ * can be loaded directly into Perfetto or chrome://tracing. Otherwise the file holds a small header
+ * followed by the raw records, oldest first, all little endian:
+ *   header: "BMDTRACE", uint32_t version, uint32_t record count
+ *   record: uint32_t timestamp_us, duration_us, addr, value; uint8_t op, ack, apsel, reserved
+ */
+
+#include <errno.h>
+#include "general.h"
+#include "stats.h"
+#include "probe_trace.h"
+#include "buffer_utils.h"
+
+#define PROBE_TRACE_RING_SIZE   65536U
+#define PROBE_TRACE_VERSION     1U
+#define PROBE_TRACE_RECORD_SIZE 20U
+
+typedef struct probe_trace_record {
+	uint32_t timestamp;
+	uint32_t duration;
+	uint32_t addr;
+	uint32_t value;
+	uint8_t op;
+	uint8_t ack;
+	uint8_t apsel;
+	uint8_t reserved;
+} probe_trace_record_s;
+
+static const char *const probe_trace_op_names[PROBE_TRACE_OP_COUNT] = {
+	[PROBE_TRACE_DP_READ] = "dp_read",
+	[PROBE_TRACE_DP_WRITE] = "dp_write",
+	[PROBE_TRACE_LOW_ACCESS] = "low_access",
+	[PROBE_TRACE_AP_READ] = "ap_read",
+	[PROBE_TRACE_AP_WRITE] = "ap_write",
+	[PROBE_TRACE_MEM_READ] = "mem_read",
+	[PROBE_TRACE_MEM_WRITE] = "mem_write",
+	[PROBE_TRACE_JTAG_IR] = "jtag_ir",
+	[PROBE_TRACE_JTAG_DR] = "jtag_dr",
+};
+
+bool probe_trace_enabled = false;
+
+static const char *probe_trace_filename;
+static probe_trace_record_s *probe_trace_ring;
+/* Total records ever taken, the ring index being this modulo PROBE_TRACE_RING_SIZE */
+static size_t probe_trace_count;
+
+bool probe_trace_enable(const char *const filename)
+{
+	probe_trace_ring = calloc(PROBE_TRACE_RING_SIZE, sizeof(*probe_trace_ring));
+	if (!probe_trace_ring) { /* calloc failed: heap exhaustion */
+		DEBUG_ERROR("calloc: failed in %s\n", __func__);
+		return false;
+	}
+	probe_trace_filename = filename;
+	probe_trace_count = 0U;
+	probe_trace_enabled = true;
+	return true;
+}
+
+uint32_t probe_trace_timestamp(void)
+{
+	return stats_timestamp();
+}
+
+void probe_trace_record_access(const probe_trace_op_e op, const uint32_t start, const uint32_t addr,
+	const uint32_t value, const uint8_t apsel, const uint8_t ack)
+{
+	probe_trace_record_s *const record = &probe_trace_ring[probe_trace_count % PROBE_TRACE_RING_SIZE];
+	record->timestamp = start;
+	record->duration = stats_timestamp() - start;
+	record->addr = addr;
+	record->value = value;
+	record->op = op;
+	record->ack = ack;
+	record->apsel = apsel;
+	record->reserved = 0U;
+	++probe_trace_count;
+}
+
+static bool probe_trace_write_binary(FILE *const file, const size_t first, const size_t records)
+{
+	uint8_t buffer[PROBE_TRACE_RECORD_SIZE];
+	memcpy(buffer, "BMDTRACE", 8U);
+	write_le4(buffer, 8U, PROBE_TRACE_VERSION);
+	write_le4(buffer, 12U, (uint32_t)records);
+	if (fwrite(buffer, 1U, 16U, file) != 16U)
+		return false;
+
+	for (size_t idx = 0U; idx < records; ++idx) {
+		const probe_trace_record_s *const record = &probe_trace_ring[(first + idx) % PROBE_TRACE_RING_SIZE];
+		write_le4(buffer, 0U, record->timestamp);
+		write_le4(buffer, 4U, record->duration);
+		write_le4(buffer, 8U, record->addr);
+		write_le4(buffer, 12U, record->value);
+		buffer[16U] = record->op;
+		buffer[17U] = record->ack;
+		buffer[18U] = record->apsel;
+		buffer[19U] = record->reserved;
+		if (fwrite(buffer, 1U, sizeof(buffer), file) != sizeof(buffer))
+			return false;
+	}
+	return true;
+}
+
+static bool probe_trace_write_json(FILE *const file, const size_t first, const size_t records)
+{
+	fputs("{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n", file);
+	for (size_t idx = 0U; idx < records; ++idx) {
+		const probe_trace_record_s *const record = &probe_trace_ring[(first + idx) % PROBE_TRACE_RING_SIZE];
+		/* Timestamps are put relative to the first record so they stay small and readable in a trace viewer */
+		fprintf(file,
+			"%s{\"name\":\"%s\",\"ph\":\"X\",\"ts\":%" PRIu32 ",\"dur\":%" PRIu32 ",\"pid\":1,\"tid\":1,"
+			"\"args\":{\"addr\":\"0x%08" PRIx32 "\",\"value\":\"0x%08" PRIx32 "\",\"apsel\":%u,\"ack\":%u}}",
+			idx ? ",\n" : "", probe_trace_op_names[record->op],
+			record->timestamp - probe_trace_ring[first % PROBE_TRACE_RING_SIZE].timestamp, record->duration,
+			record->addr, record->value, record->apsel, record->ack);
+	}
+	fputs("\n]}\n", file);
+	return !ferror(file);
+}
+
+void probe_trace_dump(void)
+{
+	if (!probe_trace_ring)
+		return;
+	probe_trace_enabled = false;
+
+	/* If the ring wrapped, the oldest record is the one that is due to be overwritten next */
+	const size_t records = MIN(probe_trace_count, PROBE_TRACE_RING_SIZE);
+	const size_t first = probe_trace_count - records;
+
+	FILE *const file = fopen(probe_trace_filename, "wb");
+	if (!file) {
+		DEBUG_ERROR("Failed to open trace file %s: %s\n", probe_trace_filename, strerror(errno));
+	} else {
+		const size_t name_len = strlen(probe_trace_filename);
+		const bool json = name_len >= 5U && strcmp(probe_trace_filename + name_len - 5U, ".json") == 0;
+		const bool result = json ? probe_trace_write_json(file, first, records) :
+								   probe_trace_write_binary(file, first, records);
+		if (fclose(file) != 0 || !result)
+			DEBUG_ERROR("Failed to write trace file %s\n", probe_trace_filename);
+		else
+			DEBUG_INFO("Wrote %zu transactions (of %zu) to %s\n", records, probe_trace_count, probe_trace_filename);
+	}
+
+	free(probe_trace_ring);
+	probe_trace_ring = NULL;
+}
@@ -68,6 +68,7 @@ bool remote_v4_init(void)
 		.get_comms_frequency = remote_v2_get_comms_frequency,
 		.set_comms_frequency = remote_v2_set_comms_frequency,
 		.target_clk_output_enable = remote_v2_target_clk_output_enable,
+		.accelerations = accelerations,
 	};
 
 	/* Now fill in acceleration-specific functions */
@@ -131,5 +132,8 @@ bool remote_v4_riscv_jtag_init(riscv_dmi_s *const dmi)
 
 	dmi->read = remote_v4_riscv_jtag_dmi_read;
 	dmi->write = remote_v4_riscv_jtag_dmi_write;
+	/* The probe runs each access in one round trip, which beats pipelining scans over the remote JTAG protocol */
+	dmi->read_block = NULL;
+	dmi->write_block = NULL;
 	return true;
 }
@@ -90,6 +90,12 @@ static void remote_v4_adiv5_dp_targetsel(adiv5_debug_port_s *const dp)
 		remote_v4_current_dp_targetsel = dp->targetsel;
 }
 
+void remote_v4_adiv5_dp_sync(adiv5_debug_port_s *const dp)
+{
+	remote_v4_adiv5_dp_version(dp);
+	remote_v4_adiv5_dp_targetsel(dp);
+}
+
 uint32_t remote_v4_adiv5_raw_access(
 	adiv5_debug_port_s *const dp, const uint8_t rnw, const uint16_t addr, const uint32_t request_value)
 {
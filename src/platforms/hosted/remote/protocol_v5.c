@@ -0,0 +1,87 @@
+/*
+ * This file is part of the Black Magic Debug project.
+ *
+ * Copyright (C) 2026 1BitSquared <info@1bitsquared.com>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "bmp_remote.h"
+#include "cli.h"
+
+#include "protocol_v4.h"
+#include "protocol_v5.h"
+#include "protocol_v5_defs.h"
+#include "protocol_v5_adiv5.h"
+#include "protocol_v5_flash.h"
+
+/* How many blocks of a bulk transfer to keep in flight when talking to a probe across the network */
+#define REMOTE_V5_NETWORK_PIPELINE_DEPTH 8U
+
+bool remote_v5_init(void)
+{
+	/* v5 is a superset of v4, so start by setting up everything v4 provides */
+	if (!remote_v4_init())
+		return false;
+
+	/* Now determine how large a binary frame payload the probe can take */
+	platform_buffer_write(REMOTE_HL_PACKET_SIZE_STR, sizeof(REMOTE_HL_PACKET_SIZE_STR));
+
+	char buffer[REMOTE_MAX_MSG_SIZE];
+	const ssize_t length = platform_buffer_read(buffer, REMOTE_MAX_MSG_SIZE);
+	/* Check for communication failures */
+	if (length < 1 || buffer[0] != REMOTE_RESP_OK) {
+		DEBUG_ERROR("%s comms error: %zd\n", __func__, length);
+		return false;
+	}
+	remote_v5_adiv5_set_payload_size(remote_decode_response(buffer + 1, length - 1));
+	/*
+	 * Over a network link every round trip costs a full RTT rather than a USB frame or two, so keep more of
+	 * the blocks of a bulk transfer in flight at once. Ordering is unaffected, as the probe works through its
+	 * requests in order and each response carries the tag of the request it's for
+	 */
+	if (serial_is_network())
+		remote_v5_adiv5_set_pipeline_depth(REMOTE_V5_NETWORK_PIPELINE_DEPTH);
+
+	/* Swap in the binary framed memory I/O if the probe does ADIv5 acceleration */
+	if (remote_funcs.adiv5_init)
+		remote_funcs.adiv5_init = remote_v5_adiv5_init;
+	/* And if the probe can run Flash drivers itself, have it do the Flashing */
+	if (remote_funcs.accelerations & REMOTE_ACCEL_FLASH)
+		remote_funcs.flash_offload_setup = remote_v5_flash_offload_setup;
+	return true;
+}
+
+bool remote_v5_adiv5_init(adiv5_debug_port_s *const dp)
+{
+	remote_v4_adiv5_init(dp);
+	dp->transfers = remote_v5_adiv5_transfers;
+	dp->mem_poll32 = remote_v5_adiv5_mem_poll32;
+	dp->mem_read = remote_v5_adiv5_mem_read_bytes;
+	dp->mem_write = remote_v5_adiv5_mem_write_bytes;
+	return true;
+}
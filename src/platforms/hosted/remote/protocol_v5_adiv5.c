@@ -0,0 +1,313 @@
+/*
+ * This file is part of the Black Magic Debug project.
+ *
+ * Copyright (C) 2026 1BitSquared <info@1bitsquared.com>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "bmp_remote.h"
+#include "protocol_v3_adiv5.h"
+#include "protocol_v4_adiv5.h"
+#include "protocol_v5_defs.h"
+#include "protocol_v5_adiv5.h"
+#include "buffer_utils.h"
+#include "exception.h"
+
+/* Largest binary frame payload we will make use of, regardless of what the probe can take */
+#define REMOTE_V5_MAX_PAYLOAD 4096U
+/* How many requests we allow to be in flight to the probe at once, by default and at most */
+#define REMOTE_V5_PIPELINE_DEPTH     4U
+#define REMOTE_V5_MAX_PIPELINE_DEPTH 16U
+/* Space for a response code and a 64-bit hex error value rendered as a v3 response string */
+#define REMOTE_V5_ERROR_LENGTH 18U
+
+static size_t remote_v5_payload_size = REMOTE_MAX_MSG_SIZE;
+static size_t remote_v5_pipeline_depth = REMOTE_V5_PIPELINE_DEPTH;
+static uint8_t remote_v5_next_tag = 0U;
+/* + 1 for the terminating NUL character platform_buffer_write() expects when wire debugging */
+static uint8_t remote_v5_frame[REMOTE_BINARY_FRAME_OVERHEAD + REMOTE_V5_MAX_PAYLOAD + 1U];
+
+void remote_v5_adiv5_set_payload_size(const size_t payload_size)
+{
+	remote_v5_payload_size = MIN(payload_size, REMOTE_V5_MAX_PAYLOAD);
+}
+
+void remote_v5_adiv5_set_pipeline_depth(const size_t depth)
+{
+	remote_v5_pipeline_depth = MAX(MIN(depth, REMOTE_V5_MAX_PIPELINE_DEPTH), 1U);
+}
+
+uint8_t *remote_v5_request_payload(void)
+{
+	return remote_v5_frame + REMOTE_BINARY_FRAME_OVERHEAD;
+}
+
+size_t remote_v5_request_payload_size(void)
+{
+	return remote_v5_payload_size;
+}
+
+/* Fill in the frame header for a request whose payload has already been written and send it to the probe */
+uint8_t remote_v5_send_request(const char command, const size_t payload_length)
+{
+	const uint8_t tag = remote_v5_next_tag++;
+	remote_v5_frame[0U] = REMOTE_BINARY_SOM;
+	remote_v5_frame[1U] = tag;
+	remote_v5_frame[2U] = (uint8_t)command;
+	write_le2(remote_v5_frame, 3U, (uint16_t)payload_length);
+	remote_v5_frame[REMOTE_BINARY_FRAME_OVERHEAD + payload_length] = 0U;
+	platform_buffer_write(remote_v5_frame, REMOTE_BINARY_FRAME_OVERHEAD + payload_length);
+	return tag;
+}
+
+/* Fill in the parts of the payload common to all the memory I/O requests */
+static void remote_v5_adiv5_request_header(const adiv5_access_port_s *const ap, const target_addr64_t address,
+	const size_t address_offset, uint8_t *const payload)
+{
+	payload[0U] = ap->dp->dev_index;
+	payload[1U] = ap->apsel;
+	write_le4(payload, 2U, ap->csw);
+	write_le4(payload, address_offset, (uint32_t)address);
+	write_le4(payload, address_offset + 4U, (uint32_t)(address >> 32U));
+}
+
+static uint8_t remote_v5_adiv5_mem_read_request(
+	const adiv5_access_port_s *const ap, const target_addr64_t src, const size_t amount)
+{
+	uint8_t *const payload = remote_v5_frame + REMOTE_BINARY_FRAME_OVERHEAD;
+	remote_v5_adiv5_request_header(ap, src, 6U, payload);
+	write_le4(payload, 14U, (uint32_t)amount);
+	return remote_v5_send_request(REMOTE_BINARY_MEM_READ, REMOTE_BINARY_MEM_READ_LENGTH);
+}
+
+static uint8_t remote_v5_adiv5_mem_write_request(const adiv5_access_port_s *const ap, const target_addr64_t dest,
+	const uint8_t *const data, const size_t amount, const align_e align)
+{
+	uint8_t *const payload = remote_v5_frame + REMOTE_BINARY_FRAME_OVERHEAD;
+	remote_v5_adiv5_request_header(ap, dest, 7U, payload);
+	payload[6U] = align;
+	memcpy(payload + REMOTE_BINARY_MEM_WRITE_OVERHEAD, data, amount);
+	return remote_v5_send_request(REMOTE_BINARY_MEM_WRITE, REMOTE_BINARY_MEM_WRITE_OVERHEAD + amount);
+}
+
+/*
+ * Collect the response to the request tagged `tag`, copying up to `length` bytes of returned data to `data`.
+ * Returns 1 on success, 0 if the probe reported an error, and -1 if communications failed. Errors get rendered
+ * into `error` in v3 response form so they can be handled once the rest of the pipeline has been drained, and
+ * any partial results that come with them are copied to `data`.
+ */
+int remote_v5_collect_response(const uint8_t tag, void *const data, const size_t length, char *const error)
+{
+	const int result = platform_buffer_read_binary(remote_v5_frame, sizeof(remote_v5_frame) - 1U);
+	if (result < (int)REMOTE_BINARY_HEADER_LENGTH) {
+		DEBUG_ERROR("%s comms error: %d\n", __func__, result);
+		return -1;
+	}
+	if (remote_v5_frame[0U] != tag) {
+		DEBUG_ERROR("%s: response out of sequence (%02x != %02x)\n", __func__, remote_v5_frame[0U], tag);
+		return -1;
+	}
+	const char response = (char)remote_v5_frame[1U];
+	const uint8_t *const payload = remote_v5_frame + REMOTE_BINARY_HEADER_LENGTH;
+	const size_t payload_length = (size_t)result - REMOTE_BINARY_HEADER_LENGTH;
+	if (response == REMOTE_RESP_OK) {
+		if (data)
+			memcpy(data, payload, MIN(payload_length, length));
+		return 1;
+	}
+	/* Turn any error value supplied back into hex so the v3 error handling can deal with it */
+	uint64_t error_value = 0U;
+	if (payload_length >= 8U) {
+		error_value = read_le4(payload, 0U) | ((uint64_t)read_le4(payload, 4U) << 32U);
+		/* Anything after the error value is partial results, so hand those back too */
+		if (data)
+			memcpy(data, payload + 8U, MIN(payload_length - 8U, length));
+	}
+	if (error)
+		snprintf(error, REMOTE_V5_ERROR_LENGTH, "%c%" PRIx64, response, error_value);
+	return 0;
+}
+
+bool remote_v5_adiv5_transfers(
+	adiv5_debug_port_s *const dp, const adiv5_transfer_s *const transfers, const size_t count)
+{
+	remote_v4_adiv5_dp_sync(dp);
+	/* Turn the queued accesses into a batch of register operations for the probe to run */
+	uint8_t *const payload = remote_v5_frame + REMOTE_BINARY_FRAME_OVERHEAD;
+	payload[0U] = dp->dev_index;
+	size_t length = 1U;
+	size_t results_length = 0U;
+	for (size_t idx = 0U; idx < count; ++idx) {
+		const adiv5_transfer_s *const transfer = &transfers[idx];
+		/* Remap the access from our current format to the remote register address format */
+		const uint16_t addr = (transfer->addr & ADIV5_APnDP ? REMOTE_ADIV5_APnDP : 0U) | (transfer->addr & 0x00ffU);
+		if (transfer->rnw == ADIV5_LOW_READ) {
+			payload[length] = REMOTE_BATCH_REG_READ;
+			write_le2(payload, length + 1U, addr);
+			length += REMOTE_BATCH_REG_READ_LENGTH;
+			results_length += 4U;
+		} else {
+			payload[length] = REMOTE_BATCH_REG_WRITE;
+			write_le2(payload, length + 1U, addr);
+			write_le4(payload, length + 3U, transfer->value);
+			length += REMOTE_BATCH_REG_WRITE_LENGTH;
+		}
+	}
+	const uint8_t tag = remote_v5_send_request(REMOTE_BINARY_ADIV5_BATCH, length);
+
+	/* Read back the results and hand each read's value to its caller */
+	uint8_t results[ADIV5_TRANSFER_QUEUE_DEPTH * 4U];
+	char error[REMOTE_V5_ERROR_LENGTH];
+	const int result = remote_v5_collect_response(tag, results, MIN(results_length, sizeof(results)), error);
+	if (result < 0)
+		return false;
+	if (!result) {
+		remote_v3_adiv5_check_error(__func__, dp, error, (ssize_t)strlen(error));
+		return false;
+	}
+	size_t offset = 0U;
+	for (size_t idx = 0U; idx < count && offset + 4U <= sizeof(results); ++idx) {
+		if (transfers[idx].rnw != ADIV5_LOW_READ)
+			continue;
+		*transfers[idx].result = read_le4(results, offset);
+		offset += 4U;
+	}
+	return true;
+}
+
+uint32_t remote_v5_adiv5_mem_poll32(adiv5_access_port_s *const ap, const target_addr64_t addr, const uint32_t mask,
+	const uint32_t value, const uint32_t timeout_ms)
+{
+	remote_v4_adiv5_dp_sync(ap->dp);
+	/* Build a single operation batch to run the poll probe-side */
+	uint8_t *const payload = remote_v5_frame + REMOTE_BINARY_FRAME_OVERHEAD;
+	payload[0U] = ap->dp->dev_index;
+	payload[1U] = REMOTE_BATCH_MEM_POLL;
+	payload[2U] = ap->apsel;
+	write_le4(payload, 3U, ap->csw);
+	write_le4(payload, 7U, (uint32_t)addr);
+	write_le4(payload, 11U, (uint32_t)(addr >> 32U));
+	write_le4(payload, 15U, mask);
+	write_le4(payload, 19U, value);
+	write_le2(payload, 23U, (uint16_t)MIN(timeout_ms, UINT16_MAX));
+	const uint8_t tag = remote_v5_send_request(REMOTE_BINARY_ADIV5_BATCH, 1U + REMOTE_BATCH_MEM_POLL_LENGTH);
+
+	uint8_t result[4U] = {0};
+	char error[REMOTE_V5_ERROR_LENGTH];
+	const int response = remote_v5_collect_response(tag, result, sizeof(result), error);
+	if (response < 0)
+		return 0U;
+	/* The poll timing out is not a failure as such, the caller gets the last value read and decides what to do */
+	if (!response && (remote_decode_response(error + 1, strlen(error + 1)) & 0xffU) != REMOTE_ERROR_TIMEOUT) {
+		remote_v3_adiv5_check_error(__func__, ap->dp, error, (ssize_t)strlen(error));
+		return 0U;
+	}
+	const uint32_t status = read_le4(result, 0U);
+	DEBUG_PROBE("%s: @%08" PRIx64 " & %08" PRIx32 " == %08" PRIx32 " -> %08" PRIx32 "\n", __func__, addr, mask, value,
+		status);
+	return status;
+}
+
+void remote_v5_adiv5_mem_read_bytes(
+	adiv5_access_port_s *const ap, void *const dest, const target_addr64_t src, const size_t read_length)
+{
+	/* Check if we have anything to do */
+	if (!read_length)
+		return;
+	remote_v4_adiv5_dp_sync(ap->dp);
+	uint8_t *const data = (uint8_t *)dest;
+	DEBUG_PROBE("%s: @%08" PRIx64 "+%zx\n", __func__, src, read_length);
+	/* Binary framing means we get to use the entire payload for data */
+	const size_t blocksize = remote_v5_payload_size;
+	const size_t blocks = (read_length + blocksize - 1U) / blocksize;
+	uint8_t tags[REMOTE_V5_MAX_PIPELINE_DEPTH];
+	char error[REMOTE_V5_ERROR_LENGTH] = {0};
+	size_t failed_offset = 0U;
+	size_t issued = 0U;
+	/* Keep up to remote_v5_pipeline_depth reads in flight, stopping issuing new ones at the first failure */
+	for (size_t completed = 0U; completed < issued || (!error[0] && issued < blocks); ++completed) {
+		for (; !error[0] && issued < blocks && issued - completed < remote_v5_pipeline_depth; ++issued) {
+			const size_t offset = issued * blocksize;
+			tags[issued % REMOTE_V5_MAX_PIPELINE_DEPTH] =
+				remote_v5_adiv5_mem_read_request(ap, src + offset, MIN(read_length - offset, blocksize));
+		}
+		const size_t offset = completed * blocksize;
+		const size_t amount = MIN(read_length - offset, blocksize);
+		const bool already_failed = error[0] != '\0';
+		const int result = remote_v5_collect_response(
+			tags[completed % REMOTE_V5_MAX_PIPELINE_DEPTH], data + offset, amount, already_failed ? NULL : error);
+		if (result < 0)
+			return;
+		if (!result && !already_failed)
+			failed_offset = offset;
+	}
+	/* Now the pipeline is drained, report the first failure seen */
+	if (error[0]) {
+		DEBUG_ERROR("%s error around 0x%08zx\n", __func__, (size_t)src + failed_offset);
+		remote_v3_adiv5_check_error(__func__, ap->dp, error, (ssize_t)strlen(error));
+	}
+}
+
+void remote_v5_adiv5_mem_write_bytes(adiv5_access_port_s *const ap, const target_addr64_t dest, const void *const src,
+	const size_t write_length, const align_e align)
+{
+	/* Check if we have anything to do */
+	if (!write_length)
+		return;
+	remote_v4_adiv5_dp_sync(ap->dp);
+	const uint8_t *const data = (const uint8_t *)src;
+	DEBUG_PROBE("%s: @%08" PRIx64 "+%zx alignment %u\n", __func__, dest, write_length, align);
+	/* As we do, calculate how large a transfer we can do to the firmware */
+	const size_t alignment_mask = ~((1U << align) - 1U);
+	const size_t blocksize = (remote_v5_payload_size - REMOTE_BINARY_MEM_WRITE_OVERHEAD) & alignment_mask;
+	const size_t blocks = (write_length + blocksize - 1U) / blocksize;
+	uint8_t tags[REMOTE_V5_MAX_PIPELINE_DEPTH];
+	char error[REMOTE_V5_ERROR_LENGTH] = {0};
+	size_t failed_offset = 0U;
+	size_t issued = 0U;
+	/* Keep up to remote_v5_pipeline_depth writes in flight, stopping issuing new ones at the first failure */
+	for (size_t completed = 0U; completed < issued || (!error[0] && issued < blocks); ++completed) {
+		for (; !error[0] && issued < blocks && issued - completed < remote_v5_pipeline_depth; ++issued) {
+			const size_t offset = issued * blocksize;
+			tags[issued % REMOTE_V5_MAX_PIPELINE_DEPTH] = remote_v5_adiv5_mem_write_request(
+				ap, dest + offset, data + offset, MIN(write_length - offset, blocksize), align);
+		}
+		const bool already_failed = error[0] != '\0';
+		const int result = remote_v5_collect_response(
+			tags[completed % REMOTE_V5_MAX_PIPELINE_DEPTH], NULL, 0U, already_failed ? NULL : error);
+		if (result < 0)
+			return;
+		if (!result && !already_failed)
+			failed_offset = completed * blocksize;
+	}
+	/* Now the pipeline is drained, report the first failure seen */
+	if (error[0]) {
+		DEBUG_ERROR("%s error around 0x%08zx\n", __func__, (size_t)dest + failed_offset);
+		remote_v3_adiv5_check_error(__func__, ap->dp, error, (ssize_t)strlen(error));
+	}
+}
@@ -0,0 +1,60 @@
+/*
+ * This file is part of the Black Magic Debug project.
+ *
+ * Copyright (C) 2026 1BitSquared <info@1bitsquared.com>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef PLATFORMS_HOSTED_REMOTE_PROTOCOL_V5_ADIV5_H
+#define PLATFORMS_HOSTED_REMOTE_PROTOCOL_V5_ADIV5_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "adiv5.h"
+
+void remote_v5_adiv5_set_payload_size(size_t payload_size);
+/* Where to build a request's payload before sending it, and how large a payload the probe can take */
+uint8_t *remote_v5_request_payload(void);
+size_t remote_v5_request_payload_size(void);
+/* Send the request built in the payload area as a binary frame, returning the tag its response will carry */
+uint8_t remote_v5_send_request(char command, size_t payload_length);
+/*
+ * Collect the response to the request tagged tag, copying up to length bytes of any data to data. Returns 1 on
+ * success, 0 if the probe reported an error (rendered into error, if not NULL) and -1 if communications failed
+ */
+int remote_v5_collect_response(uint8_t tag, void *data, size_t length, char *error);
+/* Set how many memory I/O requests may be outstanding with the probe at once, to hide a slow link's latency */
+void remote_v5_adiv5_set_pipeline_depth(size_t depth);
+bool remote_v5_adiv5_transfers(adiv5_debug_port_s *dp, const adiv5_transfer_s *transfers, size_t count);
+uint32_t remote_v5_adiv5_mem_poll32(
+	adiv5_access_port_s *ap, target_addr64_t addr, uint32_t mask, uint32_t value, uint32_t timeout_ms);
+void remote_v5_adiv5_mem_read_bytes(adiv5_access_port_s *ap, void *dest, target_addr64_t src, size_t read_length);
+void remote_v5_adiv5_mem_write_bytes(
+	adiv5_access_port_s *ap, target_addr64_t dest, const void *src, size_t write_length, align_e align);
+
+#endif /*PLATFORMS_HOSTED_REMOTE_PROTOCOL_V5_ADIV5_H*/
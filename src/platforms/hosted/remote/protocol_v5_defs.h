@@ -0,0 +1,109 @@
+/*
+ * This file is part of the Black Magic Debug project.
+ *
+ * Copyright (C) 2026 1BitSquared <info@1bitsquared.com>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef PLATFORMS_HOSTED_REMOTE_PROTOCOL_V5_DEFS_H
+#define PLATFORMS_HOSTED_REMOTE_PROTOCOL_V5_DEFS_H
+
+/* Bring in the v4 protocol definitions, v5 only adds to them */
+#include "protocol_v4_defs.h"
+
+/* This version of the protocol introduces a command for determining how large a binary frame payload may be */
+#define REMOTE_HL_PACKET_SIZE 'P'
+
+/* High-level protocol message for asking about the maximum binary frame payload size */
+#define REMOTE_HL_PACKET_SIZE_STR                                          \
+	(char[])                                                               \
+	{                                                                      \
+		REMOTE_SOM, REMOTE_HL_PACKET, REMOTE_HL_PACKET_SIZE, REMOTE_EOM, 0 \
+	}
+
+/*
+ * This version of the protocol introduces length-prefixed binary frames for memory I/O. Each frame is the
+ * start of frame byte followed by a sequence tag, the command (or response code), the payload length as a
+ * little endian 16-bit number, and the raw payload itself.
+ */
+#define REMOTE_BINARY_SOM           '%'
+#define REMOTE_BINARY_HEADER_LENGTH 4U
+/* The start of frame byte plus the header gives 5 bytes of frame overhead */
+#define REMOTE_BINARY_FRAME_OVERHEAD (1U + REMOTE_BINARY_HEADER_LENGTH)
+
+/* ADIv5 remote protocol binary memory I/O commands */
+#define REMOTE_BINARY_MEM_READ  'm'
+#define REMOTE_BINARY_MEM_WRITE 'M'
+/* dev_index, apsel, CSW, 64-bit address and 32-bit length */
+#define REMOTE_BINARY_MEM_READ_LENGTH 18U
+/* dev_index, apsel, CSW, alignment and 64-bit address, followed by the raw data to write */
+#define REMOTE_BINARY_MEM_WRITE_OVERHEAD 15U
+
+/* ADIv5 remote protocol binary batch command and the operations a batch may contain */
+#define REMOTE_BINARY_ADIV5_BATCH 'B'
+#define REMOTE_BATCH_REG_READ     'r'
+#define REMOTE_BATCH_REG_WRITE    'w'
+#define REMOTE_BATCH_MEM_READ     'm'
+#define REMOTE_BATCH_MEM_POLL     'p'
+
+/* Operation byte and register address, plus the value for writes */
+#define REMOTE_BATCH_REG_READ_LENGTH  3U
+#define REMOTE_BATCH_REG_WRITE_LENGTH 7U
+/* Operation byte, apsel, CSW, 64-bit address, mask, expected value and 16-bit timeout in milliseconds */
+#define REMOTE_BATCH_MEM_POLL_LENGTH 24U
+
+/* Error code the probe uses for a poll running out of time */
+#define REMOTE_ERROR_TIMEOUT 5
+
+/* Acceleration bit for a probe that can run a target's Flash drivers itself */
+#define REMOTE_ACCEL_FLASH (1U << 4U)
+
+/* Flash offload binary command and its operations */
+#define REMOTE_BINARY_FLASH   'F'
+#define REMOTE_FLASH_ATTACH   'a'
+#define REMOTE_FLASH_ERASE    'e'
+#define REMOTE_FLASH_WRITE    'w'
+#define REMOTE_FLASH_COMPLETE 'c'
+
+#define REMOTE_FLASH_SCAN_SWD          's'
+#define REMOTE_FLASH_SCAN_JTAG         'j'
+#define REMOTE_FLASH_FLAG_DIFFERENTIAL (1U << 0U)
+#define REMOTE_FLASH_FLAG_BLANK_CHECK  (1U << 1U)
+
+/* Operation byte, scan type, SWD targetid, target number and flags */
+#define REMOTE_FLASH_ATTACH_LENGTH 8U
+/* Operation byte and lazy flag, followed by up to REMOTE_FLASH_MAX_RANGES address and length pairs */
+#define REMOTE_FLASH_ERASE_OVERHEAD 2U
+#define REMOTE_FLASH_RANGE_LENGTH   8U
+#define REMOTE_FLASH_MAX_RANGES     16U
+/* Operation byte and address, followed by the raw data to write */
+#define REMOTE_FLASH_WRITE_OVERHEAD 5U
+/* Operation byte and release flag */
+#define REMOTE_FLASH_COMPLETE_LENGTH 2U
+
+#endif /*PLATFORMS_HOSTED_REMOTE_PROTOCOL_V5_DEFS_H*/
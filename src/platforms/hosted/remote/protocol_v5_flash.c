@@ -0,0 +1,165 @@
+/*
+ * This file is part of the Black Magic Debug project.
+ *
+ * Copyright (C) 2026 1BitSquared <info@1bitsquared.com>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * This file implements handing the Flashing of a target over to the probe, which then runs its own copy of the
+ * target's Flash drivers against it so that only the erase ranges and the data to write cross the link rather
+ * than every register access the drivers make.
+ *
+ * The probe does its own scan and attach to get a copy of the target to work with, finding it the same way
+ * (and by the same number) as we did, and checks back with the driver name so that a probe firmware built
+ * without this part's drivers is caught and the Flashing done from here instead.
+ */
+
+#include "bmp_remote.h"
+#include "cortexm.h"
+#include "buffer_utils.h"
+#include "protocol_v5_defs.h"
+#include "protocol_v5_adiv5.h"
+#include "protocol_v5_flash.h"
+
+/* How long to give the probe to carry out an operation, as a large erase can take a good many seconds */
+#define REMOTE_V5_FLASH_TIMEOUT 60000U
+/* Longest driver name we expect back from an attach */
+#define REMOTE_V5_FLASH_DRIVER_LENGTH 64U
+
+static bool remote_v5_flash_begin(target_s *target);
+static bool remote_v5_flash_erase(target_s *target, const target_flash_range_s *ranges, size_t count, bool lazy);
+static bool remote_v5_flash_write(target_s *target, target_addr_t dest, const void *src, size_t len);
+static bool remote_v5_flash_complete(target_s *target, bool release);
+
+static const target_flash_offload_s remote_v5_flash_offload = {
+	.begin = remote_v5_flash_begin,
+	.erase = remote_v5_flash_erase,
+	.write = remote_v5_flash_write,
+	.complete = remote_v5_flash_complete,
+};
+
+/* How the targets were found, so the probe can find them again */
+static bool remote_v5_flash_jtag;
+static uint32_t remote_v5_flash_targetid;
+
+void remote_v5_flash_offload_setup(const bool jtag, const uint32_t targetid)
+{
+	remote_v5_flash_jtag = jtag;
+	remote_v5_flash_targetid = targetid;
+	for (target_s *target = target_list; target; target = target->next)
+		target->flash_offload = &remote_v5_flash_offload;
+}
+
+/* Send the Flash request built in the payload area, and wait for the probe to finish carrying it out */
+static bool remote_v5_flash_request(const size_t payload_length, void *const data, const size_t length)
+{
+	const unsigned timeout = cortexm_wait_timeout;
+	cortexm_wait_timeout = MAX(timeout, REMOTE_V5_FLASH_TIMEOUT);
+	const uint8_t tag = remote_v5_send_request(REMOTE_BINARY_FLASH, payload_length);
+	const int result = remote_v5_collect_response(tag, data, length, NULL);
+	cortexm_wait_timeout = timeout;
+	return result == 1;
+}
+
+static bool remote_v5_flash_begin(target_s *const target)
+{
+	/* The probe numbers the targets its scan finds from 1 in the same order we do */
+	size_t number = 1U;
+	for (const target_s *other = target_list; other && other != target; other = other->next)
+		++number;
+
+	uint8_t *const payload = remote_v5_request_payload();
+	payload[0U] = REMOTE_FLASH_ATTACH;
+	payload[1U] = remote_v5_flash_jtag ? REMOTE_FLASH_SCAN_JTAG : REMOTE_FLASH_SCAN_SWD;
+	write_le4(payload, 2U, remote_v5_flash_targetid);
+	payload[6U] = (uint8_t)number;
+	payload[7U] = (flash_differential ? REMOTE_FLASH_FLAG_DIFFERENTIAL : 0U) |
+		(flash_blank_check ? REMOTE_FLASH_FLAG_BLANK_CHECK : 0U);
+	char driver[REMOTE_V5_FLASH_DRIVER_LENGTH] = {0};
+	if (!remote_v5_flash_request(REMOTE_FLASH_ATTACH_LENGTH, driver, sizeof(driver) - 1U))
+		return false;
+
+	if (strcmp(driver, target->driver) != 0) {
+		DEBUG_INFO("Probe found %s rather than %s\n", driver, target->driver);
+		remote_v5_flash_complete(target, true);
+		return false;
+	}
+	DEBUG_INFO("Probe is Flashing %s itself\n", driver);
+	return true;
+}
+
+static bool remote_v5_flash_erase(
+	target_s *const target, const target_flash_range_s *const ranges, const size_t count, const bool lazy)
+{
+	(void)target;
+	bool result = true;
+	for (size_t offset = 0U; result && offset < count;) {
+		const size_t amount = MIN(count - offset, REMOTE_FLASH_MAX_RANGES);
+		uint8_t *const payload = remote_v5_request_payload();
+		payload[0U] = REMOTE_FLASH_ERASE;
+		payload[1U] = lazy ? 1U : 0U;
+		for (size_t idx = 0U; idx < amount; ++idx) {
+			const size_t range_offset = REMOTE_FLASH_ERASE_OVERHEAD + (idx * REMOTE_FLASH_RANGE_LENGTH);
+			write_le4(payload, range_offset, ranges[offset + idx].addr);
+			write_le4(payload, range_offset + 4U, (uint32_t)ranges[offset + idx].length);
+		}
+		result = remote_v5_flash_request(REMOTE_FLASH_ERASE_OVERHEAD + (amount * REMOTE_FLASH_RANGE_LENGTH), NULL, 0U);
+		offset += amount;
+	}
+	return result;
+}
+
+static bool remote_v5_flash_write(
+	target_s *const target, const target_addr_t dest, const void *const src, const size_t len)
+{
+	(void)target;
+	const uint8_t *const data = (const uint8_t *)src;
+	const size_t blocksize = remote_v5_request_payload_size() - REMOTE_FLASH_WRITE_OVERHEAD;
+	bool result = true;
+	for (size_t offset = 0U; result && offset < len; offset += blocksize) {
+		const size_t amount = MIN(len - offset, blocksize);
+		uint8_t *const payload = remote_v5_request_payload();
+		payload[0U] = REMOTE_FLASH_WRITE;
+		write_le4(payload, 1U, dest + offset);
+		memcpy(payload + REMOTE_FLASH_WRITE_OVERHEAD, data + offset, amount);
+		result = remote_v5_flash_request(REMOTE_FLASH_WRITE_OVERHEAD + amount, NULL, 0U);
+	}
+	if (!result)
+		DEBUG_ERROR("Probe failed to write Flash around 0x%08" PRIx32 "\n", dest);
+	return result;
+}
+
+static bool remote_v5_flash_complete(target_s *const target, const bool release)
+{
+	(void)target;
+	uint8_t *const payload = remote_v5_request_payload();
+	payload[0U] = REMOTE_FLASH_COMPLETE;
+	payload[1U] = release ? 1U : 0U;
+	return remote_v5_flash_request(REMOTE_FLASH_COMPLETE_LENGTH, NULL, 0U);
+}
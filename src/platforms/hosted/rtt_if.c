@@ -25,8 +25,11 @@
  */
 
 #include <general.h>
+#include <errno.h>
 #include <fcntl.h>
+#include <rtt.h>
 #include <rtt_if.h>
+#include "observer.h"
 
 #ifdef _MSC_VER
 #include <io.h>
@@ -34,10 +37,61 @@
 #include <unistd.h>
 #endif
 
-/* maybe rewrite this as tcp server */
+#ifndef O_BINARY
+#define O_BINARY 0
+#endif
+
+/*
+ * Where each up channel's data goes: 0 if not opened yet, -1 if discarded.
+ * By default only channel 0 is shown, on stdout.
+ */
+static int rtt_output_fd[MAX_RTT_CHAN] = {1};
+static const char *rtt_output_path = NULL;
+
+bool rtt_if_set_output(const char *const path)
+{
+	/* "-" keeps the default of channel 0 on stdout */
+	if (!path || strcmp(path, "-") == 0)
+		return true;
+	rtt_output_path = path;
+	/* open the file for channel 0 now so a bad path is reported straight away */
+	rtt_output_fd[0] = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_BINARY, 0644);
+	if (rtt_output_fd[0] == -1) {
+		DEBUG_ERROR("Error opening RTT output file %s: %s\n", path, strerror(errno));
+		return false;
+	}
+	return true;
+}
+
+/* Find where an up channel's data goes, opening "<path>.<channel>" the first time a channel other than 0 has any */
+static int rtt_channel_output(const uint32_t channel)
+{
+	if (channel >= MAX_RTT_CHAN)
+		return -1;
+	if (rtt_output_fd[channel] == 0) {
+		if (!rtt_output_path) {
+			rtt_output_fd[channel] = -1;
+			return -1;
+		}
+		/* room for the '.', up to two digits of channel number and the NUL */
+		const size_t path_len = strlen(rtt_output_path) + 4U;
+		char *const path = alloca(path_len);
+		snprintf(path, path_len, "%s.%" PRIu32, rtt_output_path, channel);
+		rtt_output_fd[channel] = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_BINARY, 0644);
+		if (rtt_output_fd[channel] == -1)
+			DEBUG_ERROR("Error opening RTT output file %s: %s\n", path, strerror(errno));
+	}
+	return rtt_output_fd[channel];
+}
 
 #ifndef _WIN32
 #include <termios.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0
+#endif
 
 typedef struct termios terminal_io_state_s;
 
@@ -45,10 +99,127 @@ typedef struct termios terminal_io_state_s;
 static terminal_io_state_s saved_ttystate;
 static bool tty_saved = false;
 
+/*
+ * When given a base port, each channel N is served on its own TCP port, base + N, in the manner of
+ * SEGGER's RTT telnet servers: what the target writes to up channel N goes to the client connected
+ * there, and what the client sends goes to down channel N. Up channel data is sent straight from the
+ * buffer it was read from the target into, and input is taken off the socket a buffer at a time.
+ */
+#define RTT_INPUT_LEN 256U
+
+typedef struct rtt_socket {
+	int listener;
+	int client;
+	uint16_t input_used;
+	uint16_t input_read;
+	char input[RTT_INPUT_LEN];
+} rtt_socket_s;
+
+static uint16_t rtt_port = 0U;
+static bool rtt_sockets_open = false;
+static rtt_socket_s rtt_sockets[MAX_RTT_CHAN];
+
+void rtt_if_set_port(const uint16_t port)
+{
+	rtt_port = port;
+}
+
+static int rtt_socket_listen(const uint16_t port)
+{
+	const int listener = socket(AF_INET, SOCK_STREAM, 0);
+	if (listener == -1)
+		return -1;
+	const int reuse = 1;
+	setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+	/* Only local clients, as with the GDB server's own idea of who it is talking to */
+	struct sockaddr_in addr = {0};
+	addr.sin_family = AF_INET;
+	addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	addr.sin_port = htons(port);
+	if (bind(listener, (const struct sockaddr *)&addr, sizeof(addr)) == -1 || listen(listener, 1) == -1) {
+		DEBUG_ERROR("Error listening for RTT on port %u: %s\n", port, strerror(errno));
+		close(listener);
+		return -1;
+	}
+	/* Accepting is polled, so the listener mustn't block */
+	fcntl(listener, F_SETFL, fcntl(listener, F_GETFL, 0) | O_NONBLOCK);
+	return listener;
+}
+
+static void rtt_socket_drop(rtt_socket_s *const sock)
+{
+	close(sock->client);
+	sock->client = -1;
+	sock->input_used = 0U;
+	sock->input_read = 0U;
+}
+
+/* The client connected for a channel, picking up a new connection if there isn't one, -1 if none */
+static int rtt_socket_client(const uint32_t channel)
+{
+	if (channel >= MAX_RTT_CHAN)
+		return -1;
+	rtt_socket_s *const sock = &rtt_sockets[channel];
+	if (sock->client == -1 && sock->listener != -1) {
+		sock->client = accept(sock->listener, NULL, NULL);
+		/* The client is read without blocking and written to with blocking, much as stdout would be */
+		if (sock->client != -1) {
+			fcntl(sock->client, F_SETFL, fcntl(sock->client, F_GETFL, 0) & ~O_NONBLOCK);
+			DEBUG_INFO("RTT channel %" PRIu32 " connected\n", channel);
+		}
+	}
+	return sock->client;
+}
+
+static bool rtt_socket_input(const uint32_t channel)
+{
+	const int client = rtt_socket_client(channel);
+	if (client == -1)
+		return false;
+	rtt_socket_s *const sock = &rtt_sockets[channel];
+	if (sock->input_read < sock->input_used)
+		return true;
+	const ssize_t result = recv(client, sock->input, sizeof(sock->input), MSG_DONTWAIT);
+	if (result == 0 || (result < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)) {
+		rtt_socket_drop(sock);
+		return false;
+	}
+	sock->input_read = 0U;
+	sock->input_used = result > 0 ? (uint16_t)result : 0U;
+	return sock->input_used != 0U;
+}
+
+static void rtt_socket_write(const uint32_t channel, const char *const buf, const uint32_t len)
+{
+	const int client = rtt_socket_client(channel);
+	if (client == -1)
+		return;
+	for (uint32_t offset = 0U; offset < len;) {
+		const ssize_t result = send(client, buf + offset, len - offset, MSG_NOSIGNAL);
+		if (result < 0 && errno == EINTR)
+			continue;
+		if (result <= 0) {
+			rtt_socket_drop(&rtt_sockets[channel]);
+			return;
+		}
+		offset += (uint32_t)result;
+	}
+}
+
 /* set up and tear down */
 
 int rtt_if_init()
 {
+	if (rtt_port) {
+		for (uint32_t channel = 0U; channel < MAX_RTT_CHAN; ++channel) {
+			rtt_sockets[channel].listener = rtt_socket_listen((uint16_t)(rtt_port + channel));
+			rtt_sockets[channel].client = -1;
+		}
+		rtt_sockets_open = true;
+		DEBUG_WARN("Serving RTT channels on TCP ports %u to %u\n", rtt_port, rtt_port + MAX_RTT_CHAN - 1U);
+		return 0;
+	}
+
 	terminal_io_state_s ttystate;
 	tcgetattr(STDIN_FILENO, &saved_ttystate);
 	tty_saved = true;
@@ -66,6 +237,15 @@ int rtt_if_exit()
 {
 	if (tty_saved)
 		tcsetattr(STDIN_FILENO, TCSANOW, &saved_ttystate);
+	if (rtt_sockets_open) {
+		rtt_sockets_open = false;
+		for (uint32_t channel = 0U; channel < MAX_RTT_CHAN; ++channel) {
+			if (rtt_sockets[channel].client != -1)
+				rtt_socket_drop(&rtt_sockets[channel]);
+			if (rtt_sockets[channel].listener != -1)
+				close(rtt_sockets[channel].listener);
+		}
+	}
 	return 0;
 }
 
@@ -73,10 +253,15 @@ int rtt_if_exit()
 
 uint32_t rtt_write(const uint32_t channel, const char *buf, uint32_t len)
 {
-	/* only support writing to up channel 0 */
-	if (channel != 0U)
+	observer_rtt(channel, buf, len);
+	if (rtt_port) {
+		rtt_socket_write(channel, buf, len);
+		return len;
+	}
+	const int fd = rtt_channel_output(channel);
+	if (fd == -1)
 		return len;
-	int unused = write(1, buf, len);
+	int unused = write(fd, buf, len);
 	(void)unused;
 	return len;
 }
@@ -85,9 +270,14 @@ uint32_t rtt_write(const uint32_t channel, const char *buf, uint32_t len)
 
 int32_t rtt_getchar(const uint32_t channel)
 {
+	if (rtt_port) {
+		if (!rtt_socket_input(channel))
+			return -1;
+		rtt_socket_s *const sock = &rtt_sockets[channel];
+		return (uint8_t)sock->input[sock->input_read++];
+	}
 	char ch;
 	int len;
-	(void)channel;
 	len = read(0, &ch, 1);
 	if (len == 1)
 		return ch;
@@ -98,7 +288,8 @@ int32_t rtt_getchar(const uint32_t channel)
 
 bool rtt_nodata(const uint32_t channel)
 {
-	(void)channel;
+	if (rtt_port)
+		return !rtt_socket_input(channel);
 	return false;
 }
 
@@ -120,10 +311,10 @@ int rtt_if_exit()
 
 uint32_t rtt_write(const uint32_t channel, const char *buf, uint32_t len)
 {
-	/* only support writing to up channel 0 */
-	if (channel != 0U)
+	const int fd = rtt_channel_output(channel);
+	if (fd == -1)
 		return len;
-	write(1, buf, len);
+	write(fd, buf, len);
 	return len;
 }
 
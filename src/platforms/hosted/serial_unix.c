@@ -22,6 +22,7 @@
 #include "remote.h"
 #include "bmp_hosted.h"
 #include "utils.h"
+#include "buffer_utils.h"
 #include "cortexm.h"
 
 #include <sys/stat.h>
@@ -37,15 +38,24 @@
 #include <sys/types.h>
 #include <sys/socket.h>
 #include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
 
-#define READ_BUFFER_LENGTH 4096U
+/* Big enough to take a whole pipeline of v5 responses in one read() */
+#define READ_BUFFER_LENGTH  65536U
+/* Big enough to take a whole pipeline of v5 requests, which then go out in one write() */
+#define WRITE_BUFFER_LENGTH 32768U
 
 /* File descriptor for the connection to the remote BMP */
 static int fd;
+static bool network_device = false;
 /* Buffer for read request data + fullness and next read position values */
 static uint8_t read_buffer[READ_BUFFER_LENGTH];
 static size_t read_buffer_fullness = 0U;
 static size_t read_buffer_offset = 0U;
+/* Buffer for requests not yet sent, which get flushed once we need a response to any of them */
+static uint8_t write_buffer[WRITE_BUFFER_LENGTH];
+static size_t write_buffer_fullness = 0U;
 
 #ifndef _WIN32
 inline int closesocket(const int socket)
@@ -116,9 +126,22 @@ static bool try_opening_network_device(const char *const name)
 	if (server_addr == NULL)
 		return false;
 
+	/*
+	 * Requests go out whole from the write buffer, so there's nothing for Nagle to gather up - it'd just hold
+	 * each one back waiting on the ACK for the last, adding a round trip to every transaction
+	 */
+	const int no_delay = 1;
+	if (setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &no_delay, sizeof(no_delay)) == -1)
+		DEBUG_WARN("Failed to disable Nagle's algorithm on the connection: %s\n", strerror(errno));
+	network_device = true;
 	return true;
 }
 
+bool serial_is_network(void)
+{
+	return network_device;
+}
+
 /* A nice routine grabbed from
  * https://stackoverflow.com/questions/6947413/how-to-open-read-and-write-from-serial-port-in-c
  */
@@ -275,9 +298,10 @@ bool serial_open(const bmda_cli_options_s *const cl_opts, const char *const seri
 		memcpy(name, cl_opts->opt_device, truncated_len);
 		name[truncated_len] = '\0';
 	}
-	/* Reset the read buffer before opening the target BMP */
+	/* Reset the read and write buffers before opening the target BMP */
 	read_buffer_fullness = 0U;
 	read_buffer_offset = 0U;
+	write_buffer_fullness = 0U;
 	fd = open(name, O_RDWR | O_SYNC | O_NOCTTY);
 	if (fd < 0) {
 		if (try_opening_network_device(name))
@@ -294,23 +318,54 @@ bool serial_open(const bmda_cli_options_s *const cl_opts, const char *const seri
 
 void serial_close(void)
 {
+	serial_buffer_flush();
 	close(fd);
+	network_device = false;
+}
+
+static void bmda_write_data(const uint8_t *const data, const size_t length)
+{
+	for (size_t offset = 0U; offset < length;) {
+		const ssize_t written = write(fd, data + offset, length - offset);
+		if (written < 0) {
+			const int error = errno;
+			if (error == EINTR || error == EAGAIN)
+				continue;
+			DEBUG_ERROR("Failed to write (%d): %s\n", error, strerror(error));
+			exit(-2);
+		}
+		offset += (size_t)written;
+	}
+}
+
+void serial_buffer_flush(void)
+{
+	if (!write_buffer_fullness)
+		return;
+	bmda_write_data(write_buffer, write_buffer_fullness);
+	write_buffer_fullness = 0U;
 }
 
 bool platform_buffer_write(const void *const data, const size_t length)
 {
 	DEBUG_WIRE("%s\n", (const char *)data);
-	const ssize_t written = write(fd, data, length);
-	if (written < 0) {
-		const int error = errno;
-		DEBUG_ERROR("Failed to write (%d): %s\n", errno, strerror(error));
-		exit(-2);
+	if (write_buffer_fullness + length > WRITE_BUFFER_LENGTH)
+		serial_buffer_flush();
+	/* Anything too big to buffer goes straight out, behind what was already queued */
+	if (length > WRITE_BUFFER_LENGTH)
+		bmda_write_data(data, length);
+	else {
+		memcpy(write_buffer + write_buffer_fullness, data, length);
+		write_buffer_fullness += length;
 	}
-	return (size_t)written == length;
+	return true;
 }
 
 static ssize_t bmda_read_more_data(void)
 {
+	/* Whatever response we are waiting on, the request for it has to have actually gone out */
+	serial_buffer_flush();
+
 	timeval_s timeout = {
 		.tv_sec = cortexm_wait_timeout / 1000U,
 		.tv_usec = 1000U * (cortexm_wait_timeout % 1000U),
@@ -392,3 +447,60 @@ int platform_buffer_read(void *const data, const size_t length)
 	}
 	return length;
 }
+
+/* Read exactly `length` bytes of raw data from the probe, pulling more from the link as needed */
+static int bmda_read_raw(uint8_t *const buffer, const size_t length)
+{
+	for (size_t offset = 0; offset < length;) {
+		if (read_buffer_offset == read_buffer_fullness) {
+			const ssize_t result = bmda_read_more_data();
+			if (result < 0)
+				return result;
+		}
+		const size_t amount = MIN(length - offset, read_buffer_fullness - read_buffer_offset);
+		if (buffer)
+			memcpy(buffer + offset, read_buffer + read_buffer_offset, amount);
+		read_buffer_offset += amount;
+		offset += amount;
+	}
+	return 0;
+}
+
+/*
+ * Read a v5 binary frame from the probe, returning the frame header followed by as much of the payload as
+ * fits into the buffer, how many bytes were stored, or a negative value on failure.
+ */
+int platform_buffer_read_binary(void *const data, const size_t length)
+{
+	uint8_t *const buffer = (uint8_t *)data;
+	if (length < REMOTE_BINARY_HEADER_LENGTH)
+		return -5;
+	/* Drain the buffer for the remote till we see a start-of-frame byte */
+	for (uint8_t response = 0; response != REMOTE_BINARY_SOM;) {
+		if (read_buffer_offset == read_buffer_fullness) {
+			const ssize_t result = bmda_read_more_data();
+			if (result < 0)
+				return result;
+		}
+		response = read_buffer[read_buffer_offset++];
+	}
+	/* Grab the header so we know how much payload follows */
+	int result = bmda_read_raw(buffer, REMOTE_BINARY_HEADER_LENGTH);
+	if (result < 0)
+		return result;
+	const size_t payload_length = read_le2(buffer, 2U);
+	const size_t space = length - REMOTE_BINARY_HEADER_LENGTH;
+	/* Collect the payload, discarding whatever will not fit so we stay in sync with the probe */
+	result = bmda_read_raw(buffer + REMOTE_BINARY_HEADER_LENGTH, MIN(payload_length, space));
+	if (result < 0)
+		return result;
+	if (payload_length > space) {
+		result = bmda_read_raw(NULL, payload_length - space);
+		if (result < 0)
+			return result;
+		DEBUG_ERROR("Binary frame payload too large for buffer (%zu > %zu)\n", payload_length, space);
+		return -5;
+	}
+	DEBUG_WIRE("       binary frame %02x %c, %zu bytes\n", buffer[0], buffer[1], payload_length);
+	return (int)(REMOTE_BINARY_HEADER_LENGTH + payload_length);
+}
@@ -29,6 +29,10 @@
 #include "remote.h"
 #include "cli.h"
 #include "utils.h"
+#include "buffer_utils.h"
+#if HOSTED_BMP_ONLY == 0
+#include "bmp_hosted.h"
+#endif
 
 #include <assert.h>
 #include <string.h>
@@ -39,15 +43,25 @@
 #define NT_DEV_SUFFIX     "\\\\.\\"
 #define NT_DEV_SUFFIX_LEN ARRAY_LENGTH(NT_DEV_SUFFIX)
 
-#define READ_BUFFER_LENGTH 4096U
+/* Big enough to take a whole pipeline of v5 responses in one ReadFile() */
+#define READ_BUFFER_LENGTH  65536U
+/* Big enough to take a whole pipeline of v5 requests, which then go out in one WriteFile() */
+#define WRITE_BUFFER_LENGTH 32768U
 
 /* Windows handle for the connection to the remote BMP */
 static HANDLE port_handle = INVALID_HANDLE_VALUE;
 static SOCKET network_socket = INVALID_SOCKET;
+#if HOSTED_BMP_ONLY == 0
+/* libusb link to the GDB server's CDC data interface, when that's bound to WinUSB rather than usbser.sys */
+static usb_link_s *usb_link = NULL;
+#endif
 /* Buffer for read request data + fullness and next read position values */
 static uint8_t read_buffer[READ_BUFFER_LENGTH];
 static size_t read_buffer_fullness = 0U;
 static size_t read_buffer_offset = 0U;
+/* Buffer for requests not yet sent, which get flushed once we need a response to any of them */
+static uint8_t write_buffer[WRITE_BUFFER_LENGTH];
+static size_t write_buffer_fullness = 0U;
 
 /* Socket code taken from https://beej.us/guide/bgnet/ */
 static bool try_opening_network_device(const char *const name)
@@ -127,9 +141,21 @@ static bool try_opening_network_device(const char *const name)
 		return false;
 	}
 
+	/*
+	 * Requests go out whole from the write buffer, so there's nothing for Nagle to gather up - it'd just hold
+	 * each one back waiting on the ACK for the last, adding a round trip to every transaction
+	 */
+	const BOOL no_delay = TRUE;
+	if (setsockopt(network_socket, IPPROTO_TCP, TCP_NODELAY, (const char *)&no_delay, sizeof(no_delay)) == SOCKET_ERROR)
+		DEBUG_WARN("Failed to disable Nagle's algorithm on the connection: %d\n", WSAGetLastError());
 	return true;
 }
 
+bool serial_is_network(void)
+{
+	return network_socket != INVALID_SOCKET;
+}
+
 static void display_error(const LSTATUS error, const char *const operation, const char *const path)
 {
 	char *message = NULL;
@@ -252,6 +278,78 @@ static char *device_to_path(const char *const device)
 	return path;
 }
 
+#if HOSTED_BMP_ONLY == 0
+/* Find the GDB server's CDC data interface - the first of the probe's CDC data interfaces, the other being AUX */
+static const libusb_interface_descriptor_s *find_gdb_data_interface(const libusb_config_descriptor_s *const config)
+{
+	for (size_t idx = 0; idx < config->bNumInterfaces; ++idx) {
+		const libusb_interface_descriptor_s *const descriptor = &config->interface[idx].altsetting[0];
+		if (descriptor->bInterfaceClass == LIBUSB_CLASS_DATA && descriptor->bNumEndpoints == 2U)
+			return descriptor;
+	}
+	return NULL;
+}
+
+/*
+ * Try to talk to the probe's GDB server interface directly through libusb, which bypasses usbser.sys and
+ * the latency and buffering it adds. This only works if the interface has had WinUSB bound to it (such as
+ * with Zadig), otherwise claiming it fails and the caller falls back to the COM port.
+ */
+static bool try_opening_usb_device(void)
+{
+	if (!bmda_probe_info.libusb_dev)
+		return false;
+
+	libusb_config_descriptor_s *config = NULL;
+	int result = libusb_get_active_config_descriptor(bmda_probe_info.libusb_dev, &config);
+	if (result != LIBUSB_SUCCESS) {
+		DEBUG_INFO("Failed to get configuration descriptor: %s\n", libusb_error_name(result));
+		return false;
+	}
+	const libusb_interface_descriptor_s *const descriptor = find_gdb_data_interface(config);
+	if (!descriptor) {
+		libusb_free_config_descriptor(config);
+		return false;
+	}
+
+	usb_link_s *const link = calloc(1U, sizeof(*link));
+	if (!link) { /* calloc failed: heap exhaustion */
+		DEBUG_ERROR("calloc: failed in %s\n", __func__);
+		libusb_free_config_descriptor(config);
+		return false;
+	}
+	link->context = bmda_probe_info.libusb_ctx;
+	link->interface = descriptor->bInterfaceNumber;
+	for (size_t idx = 0; idx < descriptor->bNumEndpoints; ++idx) {
+		const libusb_endpoint_descriptor_s *const endpoint = &descriptor->endpoint[idx];
+		if (endpoint->bEndpointAddress & LIBUSB_ENDPOINT_IN)
+			link->ep_rx = endpoint->bEndpointAddress;
+		else
+			link->ep_tx = endpoint->bEndpointAddress;
+	}
+	libusb_free_config_descriptor(config);
+
+	result = libusb_open(bmda_probe_info.libusb_dev, &link->device_handle);
+	if (result == LIBUSB_SUCCESS) {
+		result = libusb_claim_interface(link->device_handle, link->interface);
+		if (result != LIBUSB_SUCCESS)
+			libusb_close(link->device_handle);
+	}
+	if (result != LIBUSB_SUCCESS) {
+		DEBUG_INFO("GDB interface not available through WinUSB (%s), using the COM port\n", libusb_error_name(result));
+		free(link);
+		return false;
+	}
+	/*
+	 * There's no SET_CONTROL_LINE_STATE to send here as the control interface stays with usbser.sys, but the
+	 * firmware treats DTR as asserted until told otherwise, so it will still talk to us
+	 */
+	DEBUG_WARN("Using BMP GDB interface %u through WinUSB\n", link->interface);
+	usb_link = link;
+	return true;
+}
+#endif
+
 static char *find_bmp_device(const bmda_cli_options_s *const cl_opts, const char *const serial)
 {
 	if (cl_opts->opt_device)
@@ -267,6 +365,12 @@ static char *find_bmp_device(const bmda_cli_options_s *const cl_opts, const char
 
 bool serial_open(const bmda_cli_options_s *const cl_opts, const char *const serial)
 {
+#if HOSTED_BMP_ONLY == 0
+	/* If the probe was found on the USB bus (rather than named with -d), prefer talking to it directly */
+	if (!cl_opts->opt_device && try_opening_usb_device())
+		return true;
+#endif
+
 	/* Figure out what the device node is for the requested device */
 	char *const device = find_bmp_device(cl_opts, serial);
 	if (!device) {
@@ -342,6 +446,15 @@ bool serial_open(const bmda_cli_options_s *const cl_opts, const char *const seri
 
 void serial_close(void)
 {
+	serial_buffer_flush();
+#if HOSTED_BMP_ONLY == 0
+	if (usb_link) {
+		libusb_release_interface(usb_link->device_handle, usb_link->interface);
+		libusb_close(usb_link->device_handle);
+		free(usb_link);
+		usb_link = NULL;
+	}
+#endif
 	if (port_handle != INVALID_HANDLE_VALUE) {
 		CloseHandle(port_handle);
 		port_handle = INVALID_HANDLE_VALUE;
@@ -353,10 +466,13 @@ void serial_close(void)
 	}
 }
 
-bool platform_buffer_write(const void *const data, const size_t length)
+static bool bmda_write_data(const char *const buffer, const size_t length)
 {
-	const char *const buffer = (const char *)data;
-	DEBUG_WIRE("%s\n", buffer);
+#if HOSTED_BMP_ONLY == 0
+	/* libusb splits the transfer into packets itself and any short write shows up as an error */
+	if (usb_link)
+		return bmda_usb_transfer(usb_link, buffer, length, NULL, 0U, 100U) == LIBUSB_SUCCESS;
+#endif
 	DWORD written = 0;
 	for (size_t offset = 0; offset < length; offset += written) {
 		if (port_handle != INVALID_HANDLE_VALUE) {
@@ -371,11 +487,33 @@ bool platform_buffer_write(const void *const data, const size_t length)
 				return false;
 			}
 			written = network_written;
-		}
+		} else
+			return false;
 	}
 	return true;
 }
 
+void serial_buffer_flush(void)
+{
+	if (!write_buffer_fullness)
+		return;
+	bmda_write_data((const char *)write_buffer, write_buffer_fullness);
+	write_buffer_fullness = 0U;
+}
+
+bool platform_buffer_write(const void *const data, const size_t length)
+{
+	DEBUG_WIRE("%s\n", (const char *)data);
+	if (write_buffer_fullness + length > WRITE_BUFFER_LENGTH)
+		serial_buffer_flush();
+	/* Anything too big to buffer goes straight out, behind what was already queued */
+	if (length > WRITE_BUFFER_LENGTH)
+		return bmda_write_data((const char *)data, length);
+	memcpy(write_buffer + write_buffer_fullness, data, length);
+	write_buffer_fullness += length;
+	return true;
+}
+
 static ssize_t bmda_read_more_socket_data(void)
 {
 	struct timeval timeout = {
@@ -413,10 +551,49 @@ static ssize_t bmda_read_more_socket_data(void)
 	return 0;
 }
 
+#if HOSTED_BMP_ONLY == 0
+static ssize_t bmda_read_more_usb_data(const uint32_t end_time)
+{
+	const uint32_t now = platform_time_ms();
+	if (now >= end_time) {
+		DEBUG_ERROR("Timeout while waiting for BMP response\n");
+		return -4;
+	}
+	/*
+	 * Ask for a whole read buffer's worth in one go - the firmware ends every flush with a short packet, so this
+	 * completes as soon as the probe has sent what it has, with as much of a pipeline of responses as is ready.
+	 * This is done directly rather than through bmda_usb_transfer() so that on timeout we keep any partial data.
+	 */
+	int bytes_received = 0;
+	const int result = libusb_bulk_transfer(usb_link->device_handle, usb_link->ep_rx | LIBUSB_ENDPOINT_IN,
+		read_buffer, READ_BUFFER_LENGTH, &bytes_received, MIN(end_time - now, UINT16_MAX));
+	if (result != LIBUSB_SUCCESS && !(result == LIBUSB_ERROR_TIMEOUT && bytes_received > 0)) {
+		if (result == LIBUSB_ERROR_TIMEOUT) {
+			DEBUG_ERROR("Timeout while waiting for BMP response\n");
+			return -4;
+		}
+		DEBUG_ERROR("Failed to read response (%d): %s\n", result, libusb_error_name(result));
+		if (result == LIBUSB_ERROR_PIPE)
+			libusb_clear_halt(usb_link->device_handle, usb_link->ep_rx | LIBUSB_ENDPOINT_IN);
+		return -3;
+	}
+	/* We now have more data, so update the read buffer counters */
+	read_buffer_fullness = (size_t)bytes_received;
+	read_buffer_offset = 0U;
+	return 0;
+}
+#endif
+
 static ssize_t bmda_read_more_data(const uint32_t end_time)
 {
+	/* Whatever response we are waiting on, the request for it has to have actually gone out */
+	serial_buffer_flush();
 	if (network_socket != INVALID_SOCKET)
 		return bmda_read_more_socket_data();
+#if HOSTED_BMP_ONLY == 0
+	if (usb_link)
+		return bmda_read_more_usb_data(end_time);
+#endif
 
 	// Try to wait for up to 100ms for data to become available
 	if (WaitForSingleObject(port_handle, 100) != WAIT_OBJECT_0) {
@@ -492,3 +669,61 @@ int platform_buffer_read(void *const data, const size_t length)
 	}
 	return length;
 }
+
+/* Read exactly `length` bytes of raw data from the probe, pulling more from the link as needed */
+static int bmda_read_raw(uint8_t *const buffer, const size_t length, const uint32_t end_time)
+{
+	for (size_t offset = 0; offset < length;) {
+		if (read_buffer_offset == read_buffer_fullness) {
+			const ssize_t result = bmda_read_more_data(end_time);
+			if (result < 0)
+				return result;
+		}
+		const size_t amount = MIN(length - offset, read_buffer_fullness - read_buffer_offset);
+		if (buffer)
+			memcpy(buffer + offset, read_buffer + read_buffer_offset, amount);
+		read_buffer_offset += amount;
+		offset += amount;
+	}
+	return 0;
+}
+
+/*
+ * Read a v5 binary frame from the probe, returning the frame header followed by as much of the payload as
+ * fits into the buffer, how many bytes were stored, or a negative value on failure.
+ */
+int platform_buffer_read_binary(void *const data, const size_t length)
+{
+	uint8_t *const buffer = (uint8_t *)data;
+	if (length < REMOTE_BINARY_HEADER_LENGTH)
+		return -5;
+	const uint32_t end_time = platform_time_ms() + cortexm_wait_timeout;
+	/* Drain the buffer for the remote till we see a start-of-frame byte */
+	for (uint8_t response = 0; response != REMOTE_BINARY_SOM;) {
+		while (read_buffer_offset == read_buffer_fullness) {
+			const ssize_t result = bmda_read_more_data(end_time);
+			if (result < 0)
+				return result;
+		}
+		response = read_buffer[read_buffer_offset++];
+	}
+	/* Grab the header so we know how much payload follows */
+	int result = bmda_read_raw(buffer, REMOTE_BINARY_HEADER_LENGTH, end_time);
+	if (result < 0)
+		return result;
+	const size_t payload_length = read_le2(buffer, 2U);
+	const size_t space = length - REMOTE_BINARY_HEADER_LENGTH;
+	/* Collect the payload, discarding whatever will not fit so we stay in sync with the probe */
+	result = bmda_read_raw(buffer + REMOTE_BINARY_HEADER_LENGTH, MIN(payload_length, space), end_time);
+	if (result < 0)
+		return result;
+	if (payload_length > space) {
+		result = bmda_read_raw(NULL, payload_length - space, end_time);
+		if (result < 0)
+			return result;
+		DEBUG_ERROR("Binary frame payload too large for buffer (%zu > %zu)\n", payload_length, space);
+		return -5;
+	}
+	DEBUG_WIRE("       binary frame %02x %c, %zu bytes\n", buffer[0], buffer[1], payload_length);
+	return (int)(REMOTE_BINARY_HEADER_LENGTH + payload_length);
+}
@@ -0,0 +1,643 @@
+/*
+ * This file is part of the Black Magic Debug project.
+ *
+ * Copyright (C) 2026 1BitSquared <info@1bitsquared.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * This file implements a simulated probe, with an in-process model of an SWD-DP and the target behind it in
+ * place of any hardware. It's there so BMDA's own overhead - the ADIv5 and target layers, Flash buffering,
+ * GDB packet handling and so on - can be measured and profiled without any probe or link variance, as
+ * every access costs the same fixed (and configurable) latency.
+ *
+ * The target is modelled on an nRF51 so the existing target support picks it up and drives it for real:
+ * a DPv1 SWD-DP with a single AHB-AP, a ROM table leading to a Cortex-M0 SCS, and the Flash, UICR, FICR,
+ * RAM and NVMC register interface the nRF51 driver expects. The core can be halted, reset, and its registers
+ * read and written, but it does not execute instructions, so anything that runs code on the target (such as
+ * Flash stubs) won't work. The NVMC programs and erases instantly.
+ */
+
+#include "general.h"
+#include "platform.h"
+#include "bmp_hosted.h"
+#include "adiv5.h"
+#include "cortexm.h"
+#include "buffer_utils.h"
+#include "target_internal.h"
+#include "sim.h"
+
+/* DPv1, designer ARM, part 0xbb - a regular SW-DP as found on Cortex-M0 parts */
+#define SIM_DPIDR 0x0bb11477U
+/* AHB-AP, designer ARM, with a legacy format BASE pointing at the ROM table */
+#define SIM_AP_IDR  0x04770021U
+#define SIM_AP_BASE 0xf0000003U
+#define SIM_AP_CSW_RESET                                                                 \
+	(ADIV5_AP_CSW_DBGSWENABLE | ADIV5_AP_CSW_AHB_HPROT_PRIV | ADIV5_AP_CSW_AHB_HPROT_DATA | \
+		ADIV5_AP_CSW_AP_ENABLED | ADIV5_AP_CSW_SIZE_WORD)
+/* TAR only auto-increments through its bottom 10 bits */
+#define SIM_AP_TAR_INC_MASK 0x3ffU
+
+#define SIM_CTRLSTAT_STICKY                                                                \
+	(ADIV5_DP_CTRLSTAT_STICKYORUN | ADIV5_DP_CTRLSTAT_STICKYCMP | ADIV5_DP_CTRLSTAT_STICKYERR | \
+		ADIV5_DP_CTRLSTAT_WDATAERR)
+#define SIM_CTRLSTAT_PWRUPREQ (ADIV5_DP_CTRLSTAT_CSYSPWRUPREQ | ADIV5_DP_CTRLSTAT_CDBGPWRUPREQ)
+#define SIM_CTRLSTAT_PWRUPACK (ADIV5_DP_CTRLSTAT_CSYSPWRUPACK | ADIV5_DP_CTRLSTAT_CDBGPWRUPACK)
+
+#define SIM_FLASH_PAGE_SIZE 1024U
+#define SIM_FLASH_PAGES     256U
+#define SIM_FLASH_SIZE      (SIM_FLASH_PAGE_SIZE * SIM_FLASH_PAGES)
+#define SIM_FICR_BASE       0x10000000U
+#define SIM_FICR_SIZE       0x400U
+#define SIM_UICR_BASE       0x10001000U
+#define SIM_UICR_SIZE       SIM_FLASH_PAGE_SIZE
+#define SIM_RAM_BASE        0x20000000U
+#define SIM_RAM_SIZE        0x8000U
+#define SIM_PERIPH_BASE     0x40000000U
+#define SIM_PERIPH_SIZE     0x20000000U
+#define SIM_PPB_SIZE        0x00100000U
+#define SIM_ROM_TABLE       0xf0000000U
+#define SIM_COMPONENT_SIZE  0x1000U
+
+#define SIM_FICR_CODEPAGESIZE   0x010U
+#define SIM_FICR_CODESIZE       0x014U
+#define SIM_FICR_CONFIGID       0x05cU
+#define SIM_FICR_DEVICEID_LOW   0x060U
+#define SIM_FICR_DEVICEID_HIGH  0x064U
+#define SIM_FICR_DEVICEADDRTYPE 0x0a0U
+#define SIM_FICR_DEVICEADDR_LOW 0x0a4U
+#define SIM_FICR_DEVICEADDR_HI  0x0a8U
+
+#define SIM_NVMC_BASE      0x4001e000U
+#define SIM_NVMC_READY     0x400U
+#define SIM_NVMC_CONFIG    0x504U
+#define SIM_NVMC_ERASEPAGE 0x508U
+#define SIM_NVMC_ERASEALL  0x50cU
+#define SIM_NVMC_ERASEUICR 0x514U
+
+#define SIM_NVMC_CONFIG_WEN 1U
+#define SIM_NVMC_CONFIG_EEN 2U
+
+/* Cortex-M0 r0p0 */
+#define SIM_CPUID 0x410cc200U
+/* 4 instruction comparators in the BPU and 2 DWT comparators, as on a Cortex-M0 */
+#define SIM_FPB_COMPARATORS   4U
+#define SIM_DWT_COMPARATORS   2U
+#define SIM_FPB_CTRL          (SIM_FPB_COMPARATORS << 4U)
+#define SIM_FPB_CTRL_WRITABLE 0x1U
+#define SIM_DWT_CTRL          (SIM_DWT_COMPARATORS << 28U)
+#define SIM_AIRCR_VECTKEYSTAT 0xfa050000U
+#define SIM_DHCSR_CONTROL     0x0000002fU
+#define SIM_DEMCR_WRITABLE    0x010f07f1U
+#define SIM_DCRSR_REGSEL_MASK 0x7fU
+#define SIM_CORE_REG_COUNT    128U
+#define SIM_CORE_REG_SP       13U
+#define SIM_CORE_REG_PC       15U
+#define SIM_CORE_REG_XPSR     16U
+
+/* Component and peripheral ID registers, PIDR4-7 then PIDR0-3 then CIDR0-3, one byte per word */
+#define SIM_PIDR4_OFFSET 0xfd0U
+#define SIM_MEMTYPE      0xfccU
+#define SIM_CIDR_ROM     0xb105100dU
+#define SIM_CIDR_GIPC    0xb105e00dU
+/* Designer Nordic (JEP106 bank 3, 0x44), part 0x001, as on the nRF51 ROM table */
+#define SIM_PIDR_ROM 0x00000002000c4001ULL
+/* Designer ARM (JEP106 bank 5, 0x3b) with the Cortex-M0 SCS, DWT and BPU part numbers */
+#define SIM_PIDR_SCS 0x00000004000bb008ULL
+#define SIM_PIDR_DWT 0x00000004000bb00aULL
+#define SIM_PIDR_BPU 0x00000004000bb00bULL
+
+typedef struct sim_component {
+	uint32_t base;
+	uint64_t pidr;
+	uint32_t cidr;
+} sim_component_s;
+
+static const sim_component_s sim_components[] = {
+	{SIM_ROM_TABLE, SIM_PIDR_ROM, SIM_CIDR_ROM},
+	{CORTEXM_SCS_BASE, SIM_PIDR_SCS, SIM_CIDR_GIPC},
+	{CORTEXM_DWT_BASE, SIM_PIDR_DWT, SIM_CIDR_GIPC},
+	{CORTEXM_FPB_BASE, SIM_PIDR_BPU, SIM_CIDR_GIPC},
+};
+
+/* The ROM table's entries, as offsets from the table with the format and present bits set */
+static const uint32_t sim_rom_entries[] = {
+	(CORTEXM_SCS_BASE - SIM_ROM_TABLE) | 3U,
+	(CORTEXM_DWT_BASE - SIM_ROM_TABLE) | 3U,
+	(CORTEXM_FPB_BASE - SIM_ROM_TABLE) | 3U,
+};
+
+typedef struct sim_core {
+	uint32_t regs[SIM_CORE_REG_COUNT];
+	/* The C_* control bits of DHCSR as last written */
+	uint32_t dhcsr;
+	bool halted;
+	/* Whether the core has been reset since DHCSR was last read, for S_RESET_ST */
+	bool reset_seen;
+	uint32_t dcrdr;
+	uint32_t dfsr;
+	uint32_t demcr;
+	uint32_t fpb_ctrl;
+	uint32_t fpb_comp[SIM_FPB_COMPARATORS];
+	uint32_t dwt_comp[SIM_DWT_COMPARATORS];
+	uint32_t dwt_mask[SIM_DWT_COMPARATORS];
+	uint32_t dwt_func[SIM_DWT_COMPARATORS];
+} sim_core_s;
+
+typedef struct sim {
+	uint32_t latency_us;
+	bool nrst;
+	/* SW-DP state */
+	uint32_t ctrlstat;
+	uint32_t select;
+	uint32_t rdbuff;
+	/* AP0 state */
+	uint32_t csw;
+	uint32_t tar;
+	/* The target itself */
+	sim_core_s core;
+	uint32_t nvmc_config;
+	uint8_t flash[SIM_FLASH_SIZE];
+	uint8_t uicr[SIM_UICR_SIZE];
+	uint8_t ram[SIM_RAM_SIZE];
+} sim_s;
+
+static sim_s sim;
+
+static void sim_core_reset(void)
+{
+	sim_core_s *const core = &sim.core;
+	memset(core->regs, 0, sizeof(core->regs));
+	/* Take the initial stack pointer and entry point from the vector table at the start of Flash */
+	core->regs[SIM_CORE_REG_SP] = read_le4(sim.flash, 0U) & ~3U;
+	core->regs[SIM_CORE_REG_PC] = read_le4(sim.flash, 4U) & ~1U;
+	core->regs[SIM_CORE_REG_XPSR] = CORTEXM_XPSR_THUMB;
+	core->reset_seen = true;
+	/* The debug logic isn't touched by a system reset, but vector catch gets its chance to halt the core */
+	core->halted = (core->dhcsr & CORTEXM_DHCSR_C_DEBUGEN) && (core->demcr & CORTEXM_DEMCR_VC_CORERESET);
+	if (core->halted)
+		core->dfsr |= CORTEXM_DFSR_VCATCH;
+}
+
+static uint32_t sim_component_id(const uint32_t address)
+{
+	const uint32_t base = address & ~(SIM_COMPONENT_SIZE - 1U);
+	const uint32_t offset = address & (SIM_COMPONENT_SIZE - 1U);
+	if (offset < SIM_PIDR4_OFFSET)
+		return 0U;
+	for (size_t idx = 0; idx < ARRAY_LENGTH(sim_components); ++idx) {
+		const sim_component_s *const component = &sim_components[idx];
+		if (component->base != base)
+			continue;
+		const uint32_t index = (offset - SIM_PIDR4_OFFSET) >> 2U;
+		if (index < 4U)
+			return (uint32_t)(component->pidr >> (32U + (index * 8U))) & 0xffU;
+		if (index < 8U)
+			return (uint32_t)(component->pidr >> ((index - 4U) * 8U)) & 0xffU;
+		return (component->cidr >> ((index - 8U) * 8U)) & 0xffU;
+	}
+	return 0U;
+}
+
+static uint32_t sim_ficr_read(const uint32_t offset)
+{
+	switch (offset) {
+	case SIM_FICR_CODEPAGESIZE:
+		return SIM_FLASH_PAGE_SIZE;
+	case SIM_FICR_CODESIZE:
+		return SIM_FLASH_PAGES;
+	case SIM_FICR_CONFIGID:
+		return 0xffff0072U;
+	case SIM_FICR_DEVICEID_LOW:
+		return 0x51515151U;
+	case SIM_FICR_DEVICEID_HIGH:
+		return 0x0badc0deU;
+	case SIM_FICR_DEVICEADDRTYPE:
+		return 1U;
+	case SIM_FICR_DEVICEADDR_LOW:
+		return 0x12345678U;
+	case SIM_FICR_DEVICEADDR_HI:
+		return 0xffffc0deU;
+	default:
+		/* Everything else reads as unprogrammed, which includes the nRF52 part info */
+		return 0xffffffffU;
+	}
+}
+
+static void sim_nvmc_write(const uint32_t offset, const uint32_t value)
+{
+	switch (offset) {
+	case SIM_NVMC_CONFIG:
+		sim.nvmc_config = value & 3U;
+		break;
+	case SIM_NVMC_ERASEPAGE:
+		if (sim.nvmc_config == SIM_NVMC_CONFIG_EEN && value < SIM_FLASH_SIZE)
+			memset(sim.flash + (value & ~(SIM_FLASH_PAGE_SIZE - 1U)), 0xff, SIM_FLASH_PAGE_SIZE);
+		break;
+	case SIM_NVMC_ERASEALL:
+		if (sim.nvmc_config == SIM_NVMC_CONFIG_EEN && (value & 1U)) {
+			memset(sim.flash, 0xff, sizeof(sim.flash));
+			memset(sim.uicr, 0xff, sizeof(sim.uicr));
+		}
+		break;
+	case SIM_NVMC_ERASEUICR:
+		if (sim.nvmc_config == SIM_NVMC_CONFIG_EEN && (value & 1U))
+			memset(sim.uicr, 0xff, sizeof(sim.uicr));
+		break;
+	default:
+		break;
+	}
+}
+
+static uint32_t sim_ppb_read(const uint32_t address)
+{
+	sim_core_s *const core = &sim.core;
+	switch (address) {
+	case CORTEXM_CPUID:
+		return SIM_CPUID;
+	case CORTEXM_AIRCR:
+		return SIM_AIRCR_VECTKEYSTAT;
+	case CORTEXM_DFSR:
+		return core->dfsr;
+	case CORTEXM_DHCSR: {
+		uint32_t dhcsr = core->dhcsr | CORTEXM_DHCSR_S_REGRDY;
+		if (core->halted)
+			dhcsr |= CORTEXM_DHCSR_S_HALT;
+		if (core->reset_seen || sim.nrst)
+			dhcsr |= CORTEXM_DHCSR_S_RESET_ST;
+		core->reset_seen = false;
+		return dhcsr;
+	}
+	case CORTEXM_DCRDR:
+		return core->dcrdr;
+	case CORTEXM_DEMCR:
+		return core->demcr;
+	case CORTEXM_FPB_CTRL:
+		return SIM_FPB_CTRL | core->fpb_ctrl;
+	case CORTEXM_DWT_CTRL:
+		return SIM_DWT_CTRL;
+	case CORTEXM_DWT_PCSR:
+		/* The core isn't going anywhere, so sample its PC wherever it stopped */
+		return core->regs[SIM_CORE_REG_PC];
+	default:
+		break;
+	}
+	for (size_t idx = 0; idx < SIM_FPB_COMPARATORS; ++idx) {
+		if (address == CORTEXM_FPB_COMP(idx))
+			return core->fpb_comp[idx];
+	}
+	for (size_t idx = 0; idx < SIM_DWT_COMPARATORS; ++idx) {
+		if (address == CORTEXM_DWT_COMP(idx))
+			return core->dwt_comp[idx];
+		if (address == CORTEXM_DWT_MASK(idx))
+			return core->dwt_mask[idx];
+		if (address == CORTEXM_DWT_FUNC(idx))
+			return core->dwt_func[idx];
+	}
+	/* Anything else that isn't a component ID register is unimplemented, so reads as zero */
+	return sim_component_id(address);
+}
+
+static void sim_ppb_write(const uint32_t address, const uint32_t value)
+{
+	sim_core_s *const core = &sim.core;
+	switch (address) {
+	case CORTEXM_AIRCR:
+		if ((value & 0xffff0000U) == CORTEXM_AIRCR_VECTKEY && (value & CORTEXM_AIRCR_SYSRESETREQ))
+			sim_core_reset();
+		return;
+	case CORTEXM_DFSR:
+		core->dfsr &= ~value;
+		return;
+	case CORTEXM_DHCSR:
+		if ((value & 0xffff0000U) != CORTEXM_DHCSR_DBGKEY)
+			return;
+		core->dhcsr = value & SIM_DHCSR_CONTROL;
+		if (!(value & CORTEXM_DHCSR_C_DEBUGEN))
+			core->halted = false;
+		else if (value & CORTEXM_DHCSR_C_HALT) {
+			if (!core->halted)
+				core->dfsr |= CORTEXM_DFSR_HALTED;
+			core->halted = true;
+		} else if (value & CORTEXM_DHCSR_C_STEP) {
+			/* A step retires nothing here, but does come straight back to a halt */
+			core->dfsr |= CORTEXM_DFSR_HALTED;
+			core->halted = true;
+		} else
+			core->halted = false;
+		return;
+	case CORTEXM_DCRSR:
+		if (value & CORTEXM_DCRSR_REGWnR)
+			core->regs[value & SIM_DCRSR_REGSEL_MASK] = core->dcrdr;
+		else
+			core->dcrdr = core->regs[value & SIM_DCRSR_REGSEL_MASK];
+		return;
+	case CORTEXM_DCRDR:
+		core->dcrdr = value;
+		return;
+	case CORTEXM_DEMCR:
+		core->demcr = value & SIM_DEMCR_WRITABLE;
+		return;
+	case CORTEXM_FPB_CTRL:
+		/* Writes to ENABLE only take when KEY is set */
+		if (value & 2U)
+			core->fpb_ctrl = value & SIM_FPB_CTRL_WRITABLE;
+		return;
+	default:
+		break;
+	}
+	for (size_t idx = 0; idx < SIM_FPB_COMPARATORS; ++idx) {
+		if (address == CORTEXM_FPB_COMP(idx))
+			core->fpb_comp[idx] = value;
+	}
+	for (size_t idx = 0; idx < SIM_DWT_COMPARATORS; ++idx) {
+		if (address == CORTEXM_DWT_COMP(idx))
+			core->dwt_comp[idx] = value;
+		else if (address == CORTEXM_DWT_MASK(idx))
+			core->dwt_mask[idx] = value & 0x1fU;
+		else if (address == CORTEXM_DWT_FUNC(idx))
+			core->dwt_func[idx] = value & 0xfU;
+	}
+}
+
+/* Find the backing store for the byte-addressed memories, if the (word aligned) address is in one */
+static uint8_t *sim_memory(const uint32_t address, bool *const is_flash)
+{
+	*is_flash = true;
+	if (address < SIM_FLASH_SIZE)
+		return sim.flash + address;
+	if (address - SIM_UICR_BASE < SIM_UICR_SIZE)
+		return sim.uicr + (address - SIM_UICR_BASE);
+	*is_flash = false;
+	if (address - SIM_RAM_BASE < SIM_RAM_SIZE)
+		return sim.ram + (address - SIM_RAM_BASE);
+	return NULL;
+}
+
+/* Read the word at an aligned address on the simulated bus, returning false for a bus fault */
+static bool sim_bus_read(const uint32_t address, uint32_t *const value)
+{
+	bool is_flash = false;
+	const uint8_t *const memory = sim_memory(address, &is_flash);
+	if (memory)
+		*value = read_le4(memory, 0U);
+	else if (address - SIM_FICR_BASE < SIM_FICR_SIZE)
+		*value = sim_ficr_read(address - SIM_FICR_BASE);
+	else if (address - SIM_NVMC_BASE < SIM_COMPONENT_SIZE) {
+		/* Programming and erasing is instant, so the NVMC is always ready */
+		const uint32_t offset = address - SIM_NVMC_BASE;
+		*value = offset == SIM_NVMC_READY ? 1U : offset == SIM_NVMC_CONFIG ? sim.nvmc_config : 0U;
+	} else if (address - SIM_PERIPH_BASE < SIM_PERIPH_SIZE)
+		*value = 0U;
+	else if (address - CORTEXM_PPB_BASE < SIM_PPB_SIZE)
+		*value = sim_ppb_read(address);
+	else if (address - SIM_ROM_TABLE < SIM_COMPONENT_SIZE) {
+		const uint32_t offset = address - SIM_ROM_TABLE;
+		if (offset < sizeof(sim_rom_entries))
+			*value = sim_rom_entries[offset / 4U];
+		else if (offset == SIM_MEMTYPE)
+			*value = 1U;
+		else
+			*value = sim_component_id(address);
+	} else
+		return false;
+	return true;
+}
+
+/* Write the byte lanes of a word selected by mask at an aligned address, returning false for a bus fault */
+static bool sim_bus_write(const uint32_t address, const uint32_t value, const uint32_t mask)
+{
+	bool is_flash = false;
+	uint8_t *const memory = sim_memory(address, &is_flash);
+	if (memory) {
+		const uint32_t current = read_le4(memory, 0U);
+		/* Flash can only be programmed from 1 to 0, and only while the NVMC is write enabled */
+		if (!is_flash)
+			write_le4(memory, 0U, (current & ~mask) | (value & mask));
+		else if (sim.nvmc_config == SIM_NVMC_CONFIG_WEN)
+			write_le4(memory, 0U, current & (value | ~mask));
+	} else if (address - SIM_NVMC_BASE < SIM_COMPONENT_SIZE)
+		sim_nvmc_write(address - SIM_NVMC_BASE, value);
+	else if (address - CORTEXM_PPB_BASE < SIM_PPB_SIZE)
+		sim_ppb_write(address, value);
+	else if (address - SIM_FICR_BASE >= SIM_FICR_SIZE && address - SIM_PERIPH_BASE >= SIM_PERIPH_SIZE &&
+		address - SIM_ROM_TABLE >= SIM_COMPONENT_SIZE)
+		return false;
+	return true;
+}
+
+/* Do a DRW access at TAR, with CSW's size and byte lanes, then auto-increment TAR if asked to */
+static uint32_t sim_ap_drw(const uint8_t rnw, const uint32_t value)
+{
+	const uint32_t size = sim.csw & ADIV5_AP_CSW_SIZE_MASK;
+	const uint32_t width = size == ADIV5_AP_CSW_SIZE_BYTE ? 1U : size == ADIV5_AP_CSW_SIZE_HALFWORD ? 2U : 4U;
+	const uint32_t address = sim.tar & ~3U;
+	uint32_t result = 0U;
+	bool ok;
+	if (rnw)
+		ok = sim_bus_read(address, &result);
+	else {
+		const uint32_t lanes = width == 4U ? 0xffffffffU : ((1U << (width * 8U)) - 1U) << ((sim.tar & 3U) * 8U);
+		ok = sim_bus_write(address, value, lanes);
+	}
+	if (!ok)
+		sim.ctrlstat |= ADIV5_DP_CTRLSTAT_STICKYERR;
+	if ((sim.csw & ADIV5_AP_CSW_ADDRINC_MASK) == ADIV5_AP_CSW_ADDRINC_SINGLE)
+		sim.tar = (sim.tar & ~SIM_AP_TAR_INC_MASK) | ((sim.tar + width) & SIM_AP_TAR_INC_MASK);
+	return result;
+}
+
+static uint32_t sim_ap_access(adiv5_debug_port_s *const dp, const uint8_t rnw, const uint16_t addr, uint32_t value)
+{
+	/* With a sticky error flagged, the DP refuses AP accesses until it's cleared */
+	if (sim.ctrlstat & SIM_CTRLSTAT_STICKY) {
+		dp->fault = SWD_ACK_FAULT;
+		return 0U;
+	}
+	const uint8_t apsel = sim.select >> 24U;
+	const uint8_t reg = (sim.select & ADIV5_DP_SELECT_APBANK_MASK) | (addr & 0x0cU);
+	uint32_t result = 0U;
+	/* Only AP0 exists, every other AP reads as all zeros to say as much */
+	if (apsel == 0U) {
+		switch (reg) {
+		case ADIV5_AP_CSW & 0xffU:
+			if (rnw)
+				result = sim.csw;
+			else {
+				/* This AP doesn't do packed transfers, so those are turned into single increments */
+				if ((value & ADIV5_AP_CSW_ADDRINC_MASK) == ADIV5_AP_CSW_ADDRINC_PACKED)
+					value = (value & ~ADIV5_AP_CSW_ADDRINC_MASK) | ADIV5_AP_CSW_ADDRINC_SINGLE;
+				sim.csw = (value & ~ADIV5_AP_CSW_TRINPROG) | ADIV5_AP_CSW_AP_ENABLED;
+			}
+			break;
+		case ADIV5_AP_TAR_LOW & 0xffU:
+			if (rnw)
+				result = sim.tar;
+			else
+				sim.tar = value;
+			break;
+		case ADIV5_AP_DRW & 0xffU:
+			result = sim_ap_drw(rnw, value);
+			break;
+		case 0x10U:
+		case 0x14U:
+		case 0x18U:
+		case 0x1cU: {
+			/* The banked data registers access the word in the 16 byte block TAR points at, without incrementing */
+			const uint32_t address = (sim.tar & ~0xfU) | (reg & 0x0cU);
+			const bool ok = rnw ? sim_bus_read(address, &result) : sim_bus_write(address, value, 0xffffffffU);
+			if (!ok)
+				sim.ctrlstat |= ADIV5_DP_CTRLSTAT_STICKYERR;
+			break;
+		}
+		case ADIV5_AP_BASE_LOW & 0xffU:
+			result = SIM_AP_BASE;
+			break;
+		case ADIV5_AP_IDR & 0xffU:
+			result = SIM_AP_IDR;
+			break;
+		default:
+			break;
+		}
+	}
+	if (!rnw)
+		return 0U;
+	/* AP reads are posted, returning the result of the previous one, and leaving this one in RDBUFF */
+	const uint32_t posted = sim.rdbuff;
+	sim.rdbuff = result;
+	return posted;
+}
+
+static uint32_t sim_raw_access(
+	adiv5_debug_port_s *const dp, const uint8_t rnw, const uint16_t addr, const uint32_t value)
+{
+	/* Like the real SWD routines, don't even try AP accesses until a fault has been dealt with */
+	if ((addr & ADIV5_APnDP) && dp->fault)
+		return 0U;
+	if (sim.latency_us)
+		platform_delay_us(sim.latency_us);
+	if (addr & ADIV5_APnDP)
+		return sim_ap_access(dp, rnw, addr, value);
+
+	switch (addr & 0x0cU) {
+	case ADIV5_DP_DPIDR:
+		if (rnw)
+			return SIM_DPIDR;
+		/* Writes here go to ABORT */
+		if (value & ADIV5_DP_ABORT_ORUNERRCLR)
+			sim.ctrlstat &= ~ADIV5_DP_CTRLSTAT_STICKYORUN;
+		if (value & ADIV5_DP_ABORT_WDERRCLR)
+			sim.ctrlstat &= ~ADIV5_DP_CTRLSTAT_WDATAERR;
+		if (value & ADIV5_DP_ABORT_STKERRCLR)
+			sim.ctrlstat &= ~ADIV5_DP_CTRLSTAT_STICKYERR;
+		if (value & ADIV5_DP_ABORT_STKCMPCLR)
+			sim.ctrlstat &= ~ADIV5_DP_CTRLSTAT_STICKYCMP;
+		return 0U;
+	case ADIV5_DP_CTRLSTAT:
+		/* Only bank 0 (CTRL/STAT) is implemented */
+		if (sim.select & ADIV5_DP_SELECT_DPBANK_MASK)
+			return 0U;
+		if (rnw) {
+			/* The power domains come up (and go down) the moment they're asked to */
+			const uint32_t requests = sim.ctrlstat & SIM_CTRLSTAT_PWRUPREQ;
+			return sim.ctrlstat | (requests << 1U);
+		}
+		sim.ctrlstat = (sim.ctrlstat & SIM_CTRLSTAT_STICKY) | (value & ~(SIM_CTRLSTAT_STICKY | SIM_CTRLSTAT_PWRUPACK));
+		return 0U;
+	case ADIV5_DP_SELECT:
+		/* Reads here are RESEND, which gives the last AP read result again */
+		if (rnw)
+			return sim.rdbuff;
+		sim.select = value;
+		return 0U;
+	default:
+		/* RDBUFF on reads, TARGETSEL (which is ignored as this is not a multi-drop DP) on writes */
+		return rnw ? sim.rdbuff : 0U;
+	}
+}
+
+static uint32_t sim_dp_error(adiv5_debug_port_s *const dp, const bool protocol_recovery)
+{
+	(void)protocol_recovery;
+	const uint32_t err = adiv5_dp_low_access(dp, ADIV5_LOW_READ, ADIV5_DP_CTRLSTAT, 0U) & SIM_CTRLSTAT_STICKY;
+	if (err)
+		adiv5_dp_low_access(dp, ADIV5_LOW_WRITE, ADIV5_DP_ABORT,
+			ADIV5_DP_ABORT_ORUNERRCLR | ADIV5_DP_ABORT_WDERRCLR | ADIV5_DP_ABORT_STKERRCLR | ADIV5_DP_ABORT_STKCMPCLR);
+	dp->fault = 0U;
+	return err;
+}
+
+static void sim_dp_abort(adiv5_debug_port_s *const dp, const uint32_t abort)
+{
+	adiv5_dp_low_access(dp, ADIV5_LOW_WRITE, ADIV5_DP_ABORT, abort);
+}
+
+bool sim_init(const bmda_cli_options_s *const cl_opts)
+{
+	memset(&sim, 0, sizeof(sim));
+	sim.latency_us = cl_opts->opt_sim_latency_us;
+	memset(sim.flash, 0xff, sizeof(sim.flash));
+	memset(sim.uicr, 0xff, sizeof(sim.uicr));
+	sim.csw = SIM_AP_CSW_RESET;
+	sim_core_reset();
+	sim.core.reset_seen = false;
+
+	strncpy(bmda_probe_info.manufacturer, "Black Magic Debug", sizeof(bmda_probe_info.manufacturer) - 1U);
+	strncpy(bmda_probe_info.product, "Simulator", sizeof(bmda_probe_info.product) - 1U);
+	snprintf(bmda_probe_info.version, sizeof(bmda_probe_info.version), "%" PRIu32 "us per access", sim.latency_us);
+	DEBUG_INFO("Simulating an nRF51 target with %" PRIu32 "us of latency per access\n", sim.latency_us);
+	return true;
+}
+
+bool sim_swd_scan(void)
+{
+	target_list_free();
+
+	/* A fresh connection finds the DP and AP in their reset states, though the target itself carries on */
+	sim.ctrlstat = 0U;
+	sim.select = 0U;
+	sim.rdbuff = 0U;
+	sim.csw = SIM_AP_CSW_RESET;
+	sim.tar = 0U;
+
+	adiv5_debug_port_s *dp = calloc(1, sizeof(*dp));
+	if (!dp) { /* calloc failed: heap exhaustion */
+		DEBUG_ERROR("calloc: failed in %s\n", __func__);
+		return false;
+	}
+
+	dp->dp_read = adiv5_swd_read;
+	dp->error = sim_dp_error;
+	dp->low_access = sim_raw_access;
+	dp->abort = sim_dp_abort;
+
+	adiv5_dp_error(dp);
+	adiv5_dp_init(dp);
+
+	return target_list != NULL;
+}
+
+void sim_nrst_set_val(const bool assert)
+{
+	/* The core is held in reset for as long as nRST is, and goes through the reset again on the way out */
+	if (assert != sim.nrst)
+		sim_core_reset();
+	sim.nrst = assert;
+}
+
+bool sim_nrst_get_val(void)
+{
+	return sim.nrst;
+}
@@ -0,0 +1,33 @@
+/*
+ * This file is part of the Black Magic Debug project.
+ *
+ * Copyright (C) 2026 1BitSquared <info@1bitsquared.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef PLATFORMS_HOSTED_SIM_H
+#define PLATFORMS_HOSTED_SIM_H
+
+#include "cli.h"
+
+/* Set up the simulated probe and the target behind it, taking the per-access latency from the options */
+bool sim_init(const bmda_cli_options_s *cl_opts);
+/* Scan the simulated SWD bus, which always finds the one simulated DP */
+bool sim_swd_scan(void);
+
+void sim_nrst_set_val(bool assert);
+bool sim_nrst_get_val(void);
+
+#endif /* PLATFORMS_HOSTED_SIM_H */
@@ -694,6 +694,74 @@ static int stlink_usb_get_rw_status(bool verbose)
 	return stlink_usb_error_check(data, verbose);
 }
 
+/* How many USB exchanges to keep in flight when pipelining memory accesses on an ST-Link V3 */
+#define STLINK_V3_PIPELINE_DEPTH 4U
+
+static const stlink_simple_command_s stlink_rw_status_request = {
+	.command = STLINK_DEBUG_COMMAND,
+	.operation = STLINK_DEBUG_APIV2_GETLASTRWSTATUS2,
+};
+
+static int stlink_mem_read_block(adiv5_access_port_s *const ap, void *const dest, const target_addr64_t src,
+	const size_t len, const uint8_t type)
+{
+	/* Build the command packet and perform the access */
+	stlink_mem_command_s command = stlink_memory_access(type, src, len, ap->apsel);
+	if (len > 1)
+		return stlink_read_retry(&command, sizeof(command), dest, len);
+	/*
+	 * Due to an artefact of how the ST-Link protocol works (minimum read size is 2),
+	 * a single byte read must be done into a 2 byte buffer
+	 */
+	uint8_t buffer[2];
+	const int res = stlink_read_retry(&command, sizeof(command), buffer, sizeof(buffer));
+	/* But we only want and need to keep a single byte from this */
+	memcpy(dest, buffer, 1);
+	return res;
+}
+
+/*
+ * Run a sequence of block reads on an ST-Link V3, queueing the next block's command while the previous one's
+ * data and status are still coming back. Returns how many blocks completed successfully in order, so the
+ * caller can redo the rest the slow way.
+ */
+static size_t stlink_mem_read_pipelined(adiv5_access_port_s *const ap, uint8_t *const dest, const target_addr64_t src,
+	const size_t len, const uint8_t type, const uint16_t block_size)
+{
+	const size_t blocks = (len + block_size - 1U) / block_size;
+	stlink_mem_command_s *const commands = calloc(blocks, sizeof(*commands));
+	bmda_usb_request_s *const requests = calloc(blocks * 2U, sizeof(*requests));
+	uint8_t(*const status)[12] = calloc(blocks, sizeof(*status));
+	size_t completed = 0U;
+	if (!commands || !requests || !status) { /* calloc failed: heap exhaustion */
+		DEBUG_ERROR("calloc: failed in %s\n", __func__);
+		goto done;
+	}
+
+	/* Each block is its command and data phase, followed by fetching the status of the access */
+	for (size_t block = 0U; block < blocks; ++block) {
+		const size_t offset = block * block_size;
+		const size_t amount = MIN(len - offset, block_size);
+		commands[block] = stlink_memory_access(type, src + offset, amount, ap->apsel);
+		requests[block * 2U] = (bmda_usb_request_s){&commands[block], sizeof(*commands), dest + offset, amount, 0};
+		requests[(block * 2U) + 1U] =
+			(bmda_usb_request_s){&stlink_rw_status_request, sizeof(stlink_rw_status_request), status[block], 12U, 0};
+	}
+	bmda_usb_transfer_pipelined(
+		bmda_probe_info.usb_link, requests, blocks * 2U, STLINK_V3_PIPELINE_DEPTH, BMDA_USB_NO_TIMEOUT);
+
+	for (; completed < blocks; ++completed) {
+		if (requests[completed * 2U].result < 0 || requests[(completed * 2U) + 1U].result < 0 ||
+			stlink_usb_error_check(status[completed], false) != STLINK_ERROR_OK)
+			break;
+	}
+done:
+	free(commands);
+	free(requests);
+	free(status);
+	return completed;
+}
+
 static void stlink_mem_read(adiv5_access_port_s *ap, void *dest, target_addr64_t src, size_t len)
 {
 	/* Check if this is supposed to be a 64-bit access and bail gracefully if it is */
@@ -718,38 +786,69 @@ static void stlink_mem_read(adiv5_access_port_s *ap, void *dest, target_addr64_t
 		type = STLINK_DEBUG_READMEM_32BIT;
 		block_size = STLINK_READMEM_32BIT_MAX_SIZE;
 	}
-	if (len > block_size) {
-		DEBUG_ERROR(
-			"%s(AP %u @0x%016" PRIx64 "+%zu): Too large! Must be <%u\n", __func__, ap->apsel, src, len, block_size);
-		return;
+
+	uint8_t *const data = (uint8_t *)dest;
+	size_t offset = 0U;
+	/* On V3 adaptors, anything needing more than one block can be pipelined */
+	if (stlink.ver_stlink == 3U && len > block_size)
+		offset = stlink_mem_read_pipelined(ap, data, src, len, type, block_size) * block_size;
+
+	/* Do whatever is left (which may be everything) a block at a time */
+	for (; offset < len; offset += block_size) {
+		const size_t amount = MIN(len - offset, block_size);
+		if (stlink_mem_read_block(ap, data + offset, src + offset, amount, type) != STLINK_ERROR_OK) {
+			/* FIXME: What is the right measure when failing?
+			 *
+			 * E.g. TM4C129 gets here when NRF probe reads 0x10000010
+			 * Approach taken:
+			 * Fill the memory with some fixed pattern so hopefully
+			 * the caller notices the error*/
+			DEBUG_ERROR("stlink_mem_read from  %08" PRIx64 " to %p, len %zu failed\n", src, dest, len);
+			memset(data + offset, 0xffU, len - offset);
+			break;
+		}
 	}
+	DEBUG_PROBE("stlink_mem_read from %08" PRIx64 " to %p, len %zu\n", src, dest, len);
+}
 
-	/* Build the command packet and perform the access */
-	stlink_mem_command_s command = stlink_memory_access(type, src, len, ap->apsel);
-	int res = 0;
-	if (len > 1)
-		res = stlink_read_retry(&command, sizeof(command), dest, len);
-	else {
-		/*
-		 * Due to an artefact of how the ST-Link protocol works (minimum read size is 2),
-		 * a single byte read must be done into a 2 byte buffer
-		 */
-		uint8_t buffer[2];
-		res = stlink_read_retry(&command, sizeof(command), buffer, sizeof(buffer));
-		/* But we only want and need to keep a single byte from this */
-		memcpy(dest, buffer, 1);
+/* As stlink_mem_read_pipelined(), but for block writes */
+static size_t stlink_mem_write_pipelined(adiv5_access_port_s *const ap, const target_addr64_t dest,
+	const uint8_t *const src, const size_t len, const uint8_t type, const uint16_t block_size)
+{
+	const size_t blocks = (len + block_size - 1U) / block_size;
+	stlink_mem_command_s *const commands = calloc(blocks, sizeof(*commands));
+	bmda_usb_request_s *const requests = calloc(blocks * 3U, sizeof(*requests));
+	uint8_t(*const status)[12] = calloc(blocks, sizeof(*status));
+	size_t completed = 0U;
+	if (!commands || !requests || !status) { /* calloc failed: heap exhaustion */
+		DEBUG_ERROR("calloc: failed in %s\n", __func__);
+		goto done;
 	}
-	if (res != STLINK_ERROR_OK) {
-		/* FIXME: What is the right measure when failing?
-		 *
-		 * E.g. TM4C129 gets here when NRF probe reads 0x10000010
-		 * Approach taken:
-		 * Fill the memory with some fixed pattern so hopefully
-		 * the caller notices the error*/
-		DEBUG_ERROR("stlink_mem_read from  %08" PRIx64 " to %p, len %zu failed\n", src, dest, len);
-		memset(dest, 0xffU, len);
+
+	/* Each block is its command, then its data phase, followed by fetching the status of the access */
+	for (size_t block = 0U; block < blocks; ++block) {
+		const size_t offset = block * block_size;
+		const size_t amount = MIN(len - offset, block_size);
+		commands[block] = stlink_memory_access(type, dest + offset, amount, ap->apsel);
+		requests[block * 3U] = (bmda_usb_request_s){&commands[block], sizeof(*commands), NULL, 0U, 0};
+		requests[(block * 3U) + 1U] = (bmda_usb_request_s){src + offset, amount, NULL, 0U, 0};
+		requests[(block * 3U) + 2U] =
+			(bmda_usb_request_s){&stlink_rw_status_request, sizeof(stlink_rw_status_request), status[block], 12U, 0};
 	}
-	DEBUG_PROBE("stlink_mem_read from %08" PRIx64 " to %p, len %zu\n", src, dest, len);
+	bmda_usb_transfer_pipelined(
+		bmda_probe_info.usb_link, requests, blocks * 3U, STLINK_V3_PIPELINE_DEPTH, BMDA_USB_NO_TIMEOUT);
+
+	for (; completed < blocks; ++completed) {
+		if (requests[completed * 3U].result < 0 || requests[(completed * 3U) + 1U].result < 0 ||
+			requests[(completed * 3U) + 2U].result < 0 ||
+			stlink_usb_error_check(status[completed], false) != STLINK_ERROR_OK)
+			break;
+	}
+done:
+	free(commands);
+	free(requests);
+	free(status);
+	return completed;
 }
 
 static void stlink_mem_write(adiv5_access_port_s *const ap, const target_addr64_t dest, const void *const src,
@@ -769,26 +868,34 @@ static void stlink_mem_write(adiv5_access_port_s *const ap, const target_addr64_
 
 	const uint8_t *const data = (const uint8_t *)src;
 	const uint16_t block_size = (align == ALIGN_8BIT) ? stlink.block_size : STLINK_READMEM_32BIT_MAX_SIZE;
-	/* Chunk the write up into firmware-digestible blocks */
-	for (size_t offset = 0; offset < len; offset += block_size) {
+	/* Figure out the access type to use */
+	uint8_t type;
+	switch (align) {
+	case ALIGN_8BIT:
+		type = STLINK_DEBUG_WRITEMEM_8BIT;
+		break;
+	case ALIGN_16BIT:
+		type = STLINK_DEBUG_APIV2_WRITEMEM_16BIT;
+		break;
+	case ALIGN_32BIT:
+	case ALIGN_64BIT:
+	default:
+		type = STLINK_DEBUG_WRITEMEM_32BIT;
+		break;
+	}
+
+	size_t offset = 0U;
+	/* On V3 adaptors, anything needing more than one block can be pipelined */
+	if (stlink.ver_stlink == 3U && len > block_size)
+		offset = stlink_mem_write_pipelined(ap, dest, data, len, type, block_size) * block_size;
+
+	/* Chunk the rest of the write up into firmware-digestible blocks */
+	for (; offset < len; offset += block_size) {
 		/* Figure out how many bytes are in the block and at what start address */
 		const size_t amount = MIN(len - offset, block_size);
 		const uint32_t addr = dest + offset;
-		/* Now generate an appropriate access packet */
-		stlink_mem_command_s command;
-		switch (align) {
-		case ALIGN_8BIT:
-			command = stlink_memory_access(STLINK_DEBUG_WRITEMEM_8BIT, addr, amount, ap->apsel);
-			break;
-		case ALIGN_16BIT:
-			command = stlink_memory_access(STLINK_DEBUG_APIV2_WRITEMEM_16BIT, addr, amount, ap->apsel);
-			break;
-		case ALIGN_32BIT:
-		case ALIGN_64BIT:
-			command = stlink_memory_access(STLINK_DEBUG_WRITEMEM_32BIT, addr, amount, ap->apsel);
-			break;
-		}
-		/* And perform the block write */
+		/* Now generate an appropriate access packet and perform the block write */
+		stlink_mem_command_s command = stlink_memory_access(type, addr, amount, ap->apsel);
 		stlink_write_retry(&command, sizeof(command), data + offset, amount);
 	}
 }
@@ -0,0 +1,181 @@
+/*
+ * This file is part of the Black Magic Debug project.
+ *
+ * Copyright (C) 2026 1BitSquared <info@1bitsquared.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * This file implements SWO capture for BMDA on top of the capture support in the CMSIS-DAP and J-Link
+ * adaptors. The captured data goes either through the ITM decoder onto stdout, or raw into a capture file
+ * for other tools (such as orbuculum) to consume.
+ */
+
+#include "general.h"
+#include "platform.h"
+#include "gdb_packet.h"
+#include "swo.h"
+#include "bmp_hosted.h"
+#if HOSTED_BMP_ONLY == 0
+#include "jlink.h"
+#include "cmsis_dap.h"
+#endif
+
+#include <stdio.h>
+
+#define SWO_READ_SIZE 4096U
+/* The most reads to do in one poll, so a fast stream can't starve GDB */
+#define SWO_POLL_READS 16U
+
+swo_coding_e swo_current_mode = swo_none;
+swo_stats_s swo_stats;
+
+static bool swo_decode = false;
+static const char *swo_capture_path = NULL;
+static FILE *swo_capture_file = NULL;
+
+void swo_set_capture_file(const char *const path)
+{
+	swo_capture_path = path;
+}
+
+static bool swo_start(const swo_coding_e mode, const uint32_t baudrate, uint32_t *const actual_baudrate)
+{
+#if HOSTED_BMP_ONLY == 1
+	(void)mode;
+	(void)baudrate;
+	(void)actual_baudrate;
+#endif
+	bool started = false;
+	switch (bmda_probe_info.type) {
+#if HOSTED_BMP_ONLY == 0
+	case PROBE_TYPE_CMSIS_DAP:
+		started = dap_swo_start(mode, baudrate, actual_baudrate);
+		break;
+
+	case PROBE_TYPE_JLINK:
+		started = jlink_swo_start(mode, baudrate, actual_baudrate);
+		break;
+#endif
+
+	default:
+		gdb_out("SWO capture is not supported on this probe\n");
+		return false;
+	}
+	if (!started)
+		gdb_out("Failed to start SWO capture, see BMDA's output for why\n");
+	return started;
+}
+
+void swo_init(const swo_coding_e swo_mode, const uint32_t baudrate, const uint32_t itm_stream_bitmask)
+{
+	if (swo_current_mode != swo_none)
+		swo_deinit(false);
+	memset(&swo_stats, 0, sizeof(swo_stats));
+	/* Without something to decode, the data has to go somewhere */
+	if (!itm_stream_bitmask && !swo_capture_path) {
+		gdb_out("Raw SWO capture needs a capture file, see the --swo-file option\n");
+		return;
+	}
+
+	if (!itm_stream_bitmask) {
+		swo_capture_file = fopen(swo_capture_path, "wb");
+		if (!swo_capture_file) {
+			gdb_outf("Failed to open %s for the SWO capture\n", swo_capture_path);
+			return;
+		}
+	}
+
+	uint32_t actual_baudrate = baudrate;
+	if (!swo_start(swo_mode, baudrate, &actual_baudrate)) {
+		if (swo_capture_file) {
+			fclose(swo_capture_file);
+			swo_capture_file = NULL;
+		}
+		return;
+	}
+
+	swo_decode = itm_stream_bitmask != 0U;
+	swo_itm_decode_set_mask(itm_stream_bitmask);
+	swo_current_mode = swo_mode;
+	if (swo_mode == swo_nrz_uart && actual_baudrate != baudrate)
+		gdb_outf("Capturing at %" PRIu32 " baud, the nearest the probe can do\n", actual_baudrate);
+}
+
+void swo_deinit(const bool deallocate)
+{
+	(void)deallocate;
+	if (swo_current_mode == swo_none)
+		return;
+	switch (bmda_probe_info.type) {
+#if HOSTED_BMP_ONLY == 0
+	case PROBE_TYPE_CMSIS_DAP:
+		dap_swo_stop();
+		break;
+
+	case PROBE_TYPE_JLINK:
+		jlink_swo_stop();
+		break;
+#endif
+
+	default:
+		break;
+	}
+	swo_current_mode = swo_none;
+	if (swo_capture_file) {
+		fclose(swo_capture_file);
+		swo_capture_file = NULL;
+	}
+}
+
+static size_t swo_read(uint8_t *const data, const size_t length)
+{
+#if HOSTED_BMP_ONLY == 1
+	(void)data;
+	(void)length;
+#endif
+	switch (bmda_probe_info.type) {
+#if HOSTED_BMP_ONLY == 0
+	case PROBE_TYPE_CMSIS_DAP:
+		return dap_swo_read(data, length);
+
+	case PROBE_TYPE_JLINK:
+		return jlink_swo_read(data, length);
+#endif
+
+	default:
+		return 0U;
+	}
+}
+
+void swo_poll(void)
+{
+	if (swo_current_mode == swo_none)
+		return;
+	/* Keep reading until the probe runs dry, so one poll keeps up even when each read is only a packet's worth */
+	uint8_t data[SWO_READ_SIZE];
+	for (size_t reads = 0U; reads < SWO_POLL_READS; ++reads) {
+		const size_t length = swo_read(data, sizeof(data));
+		if (!length)
+			break;
+		if (swo_decode)
+			swo_itm_decode(data, (uint16_t)length);
+		else {
+			fwrite(data, 1U, length, swo_capture_file);
+			fflush(swo_capture_file);
+		}
+		swo_stats.bytes_sent += length;
+	}
+}
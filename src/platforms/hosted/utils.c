@@ -29,6 +29,7 @@
 
 #include <string.h>
 #include <stdio.h>
+#include <time.h>
 
 #include "timeofday.h"
 #include "timing.h"
@@ -43,6 +44,19 @@ void platform_delay(uint32_t ms)
 #endif
 }
 
+void platform_delay_us(const uint32_t us)
+{
+#if defined(_WIN32) && !defined(__MINGW32__)
+	/* Sleep() only has millisecond granularity (at best), so spin for short delays */
+	platform_timeout_us_s timeout;
+	platform_timeout_us_set(&timeout, us);
+	while (!platform_timeout_us_is_expired(&timeout))
+		continue;
+#else
+	usleep(us);
+#endif
+}
+
 uint32_t platform_time_ms(void)
 {
 	timeval_s tv;
@@ -50,6 +64,13 @@ uint32_t platform_time_ms(void)
 	return (tv.tv_sec * 1000U) + (tv.tv_usec / 1000U);
 }
 
+uint32_t platform_time_us(void)
+{
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (uint32_t)(((uint64_t)now.tv_sec * 1000000U) + ((uint64_t)now.tv_nsec / 1000U));
+}
+
 char *format_string(const char *format, ...)
 {
 	va_list args;
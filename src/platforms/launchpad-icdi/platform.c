@@ -49,6 +49,19 @@ uint32_t platform_time_ms(void)
 	return time_ms;
 }
 
+uint32_t platform_time_us(void)
+{
+	uint32_t ms;
+	uint32_t count;
+	do {
+		ms = time_ms;
+		count = systick_get_value();
+	} while (ms != time_ms);
+	/* Each tick advances time_ms by 10, so spread 10ms worth of microseconds over one SysTick period */
+	const uint32_t reload = systick_get_reload();
+	return (ms * 1000U) + (((reload - count) * 10000U) / (reload + 1U));
+}
+
 int platform_hwversion(void)
 {
 	return 0;
@@ -118,6 +131,14 @@ void platform_delay(uint32_t ms)
 		continue;
 }
 
+void platform_delay_us(const uint32_t us)
+{
+	platform_timeout_us_s timeout;
+	platform_timeout_us_set(&timeout, us);
+	while (!platform_timeout_us_is_expired(&timeout))
+		continue;
+}
+
 const char *platform_target_voltage(void)
 {
 	return "Unknown";
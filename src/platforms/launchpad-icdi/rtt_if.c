@@ -119,6 +119,14 @@ bool rtt_nodata(const uint32_t channel)
 	return recv_head == recv_tail;
 }
 
+/* usb tx complete callback: up channel data is written to the endpoint directly here, so never anything queued */
+bool rtt_serial_send_callback(usbd_device *dev, uint8_t ep)
+{
+	(void)dev;
+	(void)ep;
+	return false;
+}
+
 /* rtt target to host: write string */
 uint32_t rtt_write(const uint32_t channel, const char *buf, uint32_t len)
 {
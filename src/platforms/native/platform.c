@@ -25,6 +25,7 @@
 #include "usb.h"
 #include "aux_serial.h"
 #include "morse.h"
+#include "buffer_utils.h"
 
 #include <libopencm3/cm3/vector.h>
 #include <libopencm3/stm32/rcc.h>
@@ -519,6 +520,43 @@ uint8_t platform_spi_xfer(const spi_bus_e bus, const uint8_t value)
 	return spi_xfer(bus == SPI_BUS_EXTERNAL ? EXT_SPI : AUX_SPI, value);
 }
 
+/*
+ * Shift as many whole 16-bit units of a JTAG DR/IR scan as possible through SPI1, which on hardware 6 and newer
+ * sits on TCK (SCK), TDO (MISO) and TDI (MOSI). The SPI runs in mode 0 LSb-first so the bit order and sampling
+ * edges match JTAG. TMS is left driven low by the caller and the final cycle of the scan is never taken here so it
+ * (and its TMS transition) always falls to the GPIO path. Returns the number of clock cycles shifted, which is
+ * always a multiple of 16.
+ */
+size_t platform_jtag_spi_shift(const uint8_t *const data_in, uint8_t *const data_out, const size_t clock_cycles)
+{
+	if (hwversion < 6 || clock_cycles <= 16U)
+		return 0U;
+	const size_t units = (clock_cycles - 1U) >> 4U;
+
+	rcc_periph_clock_enable(RCC_SPI1);
+	spi_init_master(EXT_SPI, SPI_CR1_BAUDRATE_FPCLK_DIV_8, SPI_CR1_CPOL_CLK_TO_0_WHEN_IDLE,
+		SPI_CR1_CPHA_CLK_TRANSITION_1, SPI_CR1_DFF_16BIT, SPI_CR1_LSBFIRST);
+	spi_enable(EXT_SPI);
+	gpio_set_mode(TCK_PORT, GPIO_MODE_OUTPUT_50_MHZ, GPIO_CNF_OUTPUT_ALTFN_PUSHPULL, TCK_PIN);
+	gpio_set_mode(TDI_PORT, GPIO_MODE_OUTPUT_50_MHZ, GPIO_CNF_OUTPUT_ALTFN_PUSHPULL, TDI_PIN);
+
+	for (size_t unit = 0U; unit < units; ++unit) {
+		const size_t offset = unit * 2U;
+		/* spi_xfer() waits for RXNE, so each unit has been fully clocked out by the time it returns */
+		const uint16_t value = spi_xfer(EXT_SPI, read_le2(data_in, offset));
+		if (data_out)
+			write_le2(data_out, offset, value);
+	}
+
+	/* Hand the pins back to the GPIO bit-bang path with TCK idling low */
+	gpio_clear(TCK_PORT, TCK_PIN);
+	gpio_set_mode(TCK_PORT, GPIO_MODE_OUTPUT_50_MHZ, GPIO_CNF_OUTPUT_PUSHPULL, TCK_PIN);
+	gpio_set_mode(TDI_PORT, GPIO_MODE_OUTPUT_50_MHZ, GPIO_CNF_OUTPUT_PUSHPULL, TDI_PIN);
+	spi_disable(EXT_SPI);
+	rcc_periph_clock_disable(RCC_SPI1);
+	return units << 4U;
+}
+
 void exti15_10_isr(void)
 {
 	uint32_t usb_vbus_port;
@@ -29,6 +29,7 @@
 
 #define PLATFORM_HAS_TRACESWO
 #define PLATFORM_HAS_POWER_SWITCH
+#define PLATFORM_HAS_JTAG_SPI
 
 #if ENABLE_DEBUG == 1
 #define PLATFORM_HAS_DEBUG
@@ -33,6 +33,7 @@
 #include "spi.h"
 #include "sfdp.h"
 #include "target.h"
+#include "target_internal.h"
 #include "adiv5.h"
 #include "adiv6.h"
 #if defined(CONFIG_RISCV_ACCEL) && CONFIG_RISCV_ACCEL == 1
@@ -41,75 +42,81 @@
 #include "version.h"
 #include "exception.h"
 #include "hex_utils.h"
+#include "buffer_utils.h"
 
 #if CONFIG_BMDA == 0
 static void remote_packet_process_adiv6(const char *packet, size_t packet_len);
 
-/* hex-ify and send a buffer of data */
-static void remote_send_buf(const void *const buffer, const size_t len)
-{
-	char hex[3] = {0};
-	const uint8_t *const data = (const uint8_t *)buffer;
-	for (size_t offset = 0; offset < len; ++offset) {
-		hexify(hex, data + offset, 1U);
-		gdb_if_putchar(hex[0], false);
-		gdb_if_putchar(hex[1], false);
-	}
-}
+/*
+ * Responses are built up in a local buffer and handed to gdb_if_write() a chunk at a time, rather than a
+ * character at a time through gdb_if_putchar(), so each response costs as few calls into the USB stack as
+ * it can and is flushed exactly once, at its end.
+ */
+#define REMOTE_RESPONSE_CHUNK 64U
 
-/* Send a response with some data following */
+/* Send a response with some data following, hex-ified */
 static void remote_respond_buf(const char response_code, const void *const buffer, const size_t len)
 {
-	gdb_if_putchar(REMOTE_RESP, false);
-	gdb_if_putchar(response_code, false);
-
-	remote_send_buf(buffer, len);
-
-	gdb_if_putchar(REMOTE_EOM, true);
+	char response[REMOTE_RESPONSE_CHUNK];
+	response[0] = REMOTE_RESP;
+	response[1] = response_code;
+	size_t used = 2U;
+	const uint8_t *const data = (const uint8_t *)buffer;
+	for (size_t offset = 0; offset < len;) {
+		const size_t amount = MIN(len - offset, (sizeof(response) - used) / 2U);
+		hexify(response + used, data + offset, amount);
+		used += amount * 2U;
+		offset += amount;
+		/* If that's filled the chunk, send it on and start another */
+		if (used + 1U >= sizeof(response)) {
+			gdb_if_write(response, used, false);
+			used = 0U;
+		}
+	}
+	response[used++] = REMOTE_EOM;
+	gdb_if_write(response, used, true);
 }
 
 /* Send a response with a simple result code parameter */
-static void remote_respond(const char response_code, uint64_t param)
+static void remote_respond(const char response_code, const uint64_t param)
 {
-	/* Put out the start of response marker and response code */
-	gdb_if_putchar(REMOTE_RESP, false);
-	gdb_if_putchar(response_code, false);
-
-	/* This defines space for exactly a 64-bit number expressed in hex */
-	char response[16];
-	size_t idx = 0;
-
-	/* Convert the response to hexadecimal */
-	for (; idx < 16U && param; ++idx) {
-		response[idx] = hex_digit(param & 0xfU);
-		param >>= 4U;
+	/* Space for the start of response marker, response code, a 64-bit number in hex and the end marker */
+	char response[19];
+	response[0] = REMOTE_RESP;
+	response[1] = response_code;
+	/* Work out how many digits the result needs (at least 1, for 0 responses) and fill them in backwards */
+	size_t digits = 1U;
+	for (uint64_t value = param >> 4U; value; value >>= 4U)
+		++digits;
+	uint64_t value = param;
+	for (size_t idx = digits; idx; --idx) {
+		response[1U + idx] = hex_digit(value & 0xfU);
+		value >>= 4U;
 	}
-	/* Adjust for 0 responses */
-	if (!idx)
-		response[idx++] = '0';
-
-	/* response now contains the response but logically backwards, so iterate backwards through it sending it */
-	for (; idx; --idx)
-		gdb_if_putchar(response[idx - 1U], false);
-	/* Finish with the endof response marker */
-	gdb_if_putchar(REMOTE_EOM, true);
+	response[2U + digits] = REMOTE_EOM;
+	gdb_if_write(response, digits + 3U, true);
 }
 
 /* Send a response with a string following */
 static void remote_respond_string(const char response_code, const char *const str)
 {
-	gdb_if_putchar(REMOTE_RESP, false);
-	gdb_if_putchar(response_code, false);
-	const size_t str_length = strlen(str);
-	for (size_t idx = 0; idx < str_length; ++idx) {
-		const char chr = str[idx];
+	char response[REMOTE_RESPONSE_CHUNK];
+	response[0] = REMOTE_RESP;
+	response[1] = response_code;
+	size_t used = 2U;
+	for (const char *chr = str; *chr; ++chr) {
 		/* Replace problematic/illegal characters with a space to not disturb the protocol */
-		if (chr == '$' || chr == REMOTE_SOM || chr == REMOTE_EOM)
-			gdb_if_putchar(' ', false);
+		if (*chr == '$' || *chr == REMOTE_SOM || *chr == REMOTE_EOM)
+			response[used++] = ' ';
 		else
-			gdb_if_putchar(chr, false);
+			response[used++] = *chr;
+		if (used == sizeof(response) - 1U) {
+			gdb_if_write(response, used, false);
+			used = 0U;
+		}
 	}
-	gdb_if_putchar(REMOTE_EOM, true);
+	response[used++] = REMOTE_EOM;
+	gdb_if_write(response, used, true);
 }
 
 /*
@@ -120,14 +127,28 @@ static void remote_respond_string(const char response_code, const char *const st
  *
  * REMOTE_INIT for SWD and JTAG rewrite the {read,write}_no_check, dp_read, error, low_access and abort function
  * pointers to reconfigure this structure appropriately.
+ *
+ * As the AP and memory accesses all go through the generic routines, the DP register shadows are kept across
+ * requests so repeated accesses don't rewrite SELECT, CSW and TAR. Any request that could move those behind
+ * the shadows' back, such as raw SWD/JTAG sequences or a change of device, throws the shadows away.
  */
 static adiv5_debug_port_s remote_dp = {
 	.ap_read = adiv5_ap_reg_read,
 	.ap_write = adiv5_ap_reg_write,
 	.mem_read = adiv5_mem_read_bytes,
 	.mem_write = adiv5_mem_write_bytes,
+	.shadowing = true,
 };
 
+/* Point the remote DP at the requested device, forgetting the register shadows if that's a change of device */
+static void remote_dp_select_device(const uint8_t dev_index)
+{
+	if (dev_index != remote_dp.dev_index)
+		adiv5_dp_shadow_invalidate(&remote_dp);
+	remote_dp.dev_index = dev_index;
+	remote_dp.fault = 0U;
+}
+
 static void remote_packet_process_swd(const char *const packet, const size_t packet_len)
 {
 	switch (packet[1]) {
@@ -353,7 +374,7 @@ static void remote_packet_process_high_level(const char *packet, const size_t pa
 	case REMOTE_HL_ACCEL: { /* HA = request what accelerations are available */
 		/* Build a response value that depends on what things are built into the firmare */
 		remote_respond(REMOTE_RESP_OK,
-			REMOTE_ACCEL_ADIV5 | REMOTE_ACCEL_ADIV6
+			REMOTE_ACCEL_ADIV5 | REMOTE_ACCEL_ADIV6 | REMOTE_ACCEL_FLASH
 #if defined(CONFIG_RISCV_ACCEL) && CONFIG_RISCV_ACCEL == 1
 				| REMOTE_ACCEL_RISCV
 #endif
@@ -361,6 +382,10 @@ static void remote_packet_process_high_level(const char *packet, const size_t pa
 		break;
 	}
 
+	case REMOTE_HL_PACKET_SIZE: /* HP = request how large a binary frame payload may be */
+		remote_respond(REMOTE_RESP_OK, GDB_PACKET_BUFFER_SIZE);
+		break;
+
 	default:
 		remote_respond(REMOTE_RESP_ERR, REMOTE_ERROR_UNRECOGNISED);
 		break;
@@ -396,6 +421,7 @@ static void remote_packet_process_adiv5(const char *const packet, const size_t p
 		if (packet_len == 4U) {
 			/* Extract the new version information into the DP */
 			remote_dp.version = hex_string_to_num(2U, packet + 2U);
+			adiv5_dp_shadow_invalidate(&remote_dp);
 			remote_respond(REMOTE_RESP_OK, 0);
 		} else
 			/* There weren't enough bytes, so tell the host and get out of here */
@@ -408,6 +434,7 @@ static void remote_packet_process_adiv5(const char *const packet, const size_t p
 		if (packet_len == 10U) {
 			/* Extract the new targetsel information into the DP */
 			remote_dp.targetsel = hex_string_to_num(8U, packet + 2U);
+			adiv5_dp_shadow_invalidate(&remote_dp);
 			remote_respond(REMOTE_RESP_OK, 0);
 		} else
 			/* There weren't enough bytes, so tell the host and get out of here */
@@ -428,8 +455,7 @@ static void remote_packet_process_adiv5(const char *const packet, const size_t p
 	}
 
 	/* Set up the DP and a fake AP structure to perform the access with */
-	remote_dp.dev_index = hex_string_to_num(2, packet + 2);
-	remote_dp.fault = 0U;
+	remote_dp_select_device(hex_string_to_num(2, packet + 2));
 	adiv5_access_port_s remote_ap;
 	remote_ap.apsel = hex_string_to_num(2, packet + 4);
 	remote_ap.dp = &remote_dp;
@@ -542,13 +568,14 @@ static void remote_packet_process_adiv6(const char *const packet, const size_t p
 	 * and basic DP state for remote protocol requests made. This mirrors the ADIv5 version of this structure
 	 * so our faked AP can do the right thing.
 	 */
+	remote_dp_select_device(hex_string_to_num(2, packet + 3));
 	adiv5_debug_port_s dp = remote_dp;
 	dp.ap_read = adiv6_ap_reg_read;
 	dp.ap_write = adiv6_ap_reg_write;
+	/* The register shadows now live in the copy until the request completes, so an exception can't leave them stale */
+	adiv5_dp_shadow_invalidate(&remote_dp);
 
-	/* Set up the DP and a fake AP structure to perform the access with */
-	remote_dp.dev_index = hex_string_to_num(2, packet + 3);
-	remote_dp.fault = 0U;
+	/* Set up a fake AP structure to perform the access with */
 	adiv6_access_port_s remote_ap;
 	remote_ap.ap_address = hex_string_to_num(16, packet + 5);
 	remote_ap.base.dp = &dp;
@@ -625,6 +652,12 @@ static void remote_packet_process_adiv6(const char *const packet, const size_t p
 		break;
 	}
 
+	/* Hand the register shadows back for the next request */
+	remote_dp.shadow_valid = dp.shadow_valid;
+	remote_dp.select_shadow = dp.select_shadow;
+	remote_dp.select1_shadow = dp.select1_shadow;
+	remote_dp.csw_shadow = dp.csw_shadow;
+	remote_dp.tar_shadow = dp.tar_shadow;
 	SET_IDLE_STATE(1);
 }
 
@@ -689,6 +722,10 @@ void remote_packet_process_riscv(const char *const packet, const size_t packet_l
 	/* Having dealt with the other requests, set up the fake DMI structure to perform the access with */
 	remote_dmi.dev_index = hex_string_to_num(2, packet + 2);
 	remote_dmi.idle_cycles = hex_string_to_num(2, packet + 4);
+	/* Each request says how long to idle for, so tuning starts afresh from that rather than from what the last one learnt */
+	remote_dmi.idle_min = remote_dmi.idle_cycles;
+	remote_dmi.idle_floor = remote_dmi.idle_cycles;
+	remote_dmi.idle_streak = 0U;
 	remote_dmi.address_width = hex_string_to_num(2, packet + 6);
 	remote_dmi.fault = 0U;
 
@@ -837,6 +874,19 @@ void remote_packet_process_spi(const char *const packet, const size_t packet_len
 		remote_respond(REMOTE_RESP_OK, 0);
 		break;
 	}
+	/* Wait for a SPI Flash device to finish a write or erase, polling its status register here on the probe */
+	case REMOTE_SPI_WAIT_READY: {
+		/* Decode the device to talk to and how long in milliseconds it may take */
+		const uint8_t spi_device = hex_string_to_num(2, packet + 4);
+		const uint32_t timeout = hex_string_to_num(8, packet + 6);
+		/* Respond with the final status register value, or a timeout error if the Flash stayed busy */
+		uint8_t status = 0U;
+		if (bmp_spi_wait_ready(spi_bus, spi_device, timeout, &status))
+			remote_respond(REMOTE_RESP_OK, status);
+		else
+			remote_respond(REMOTE_RESP_ERR, REMOTE_ERROR_TIMEOUT);
+		break;
+	}
 	default:
 		remote_respond(REMOTE_RESP_ERR, REMOTE_ERROR_UNRECOGNISED);
 		break;
@@ -852,18 +902,23 @@ void remote_packet_process(char *const packet, const size_t packet_length)
 	}
 	switch (packet[0]) {
 	case REMOTE_SWDP_PACKET:
+		/* Raw sequences can do anything to the DP, from a SELECT write to a line reset */
+		adiv5_dp_shadow_invalidate(&remote_dp);
 		remote_packet_process_swd(packet, packet_length);
 		break;
 
 	case REMOTE_JTAG_PACKET:
+		adiv5_dp_shadow_invalidate(&remote_dp);
 		remote_packet_process_jtag(packet, packet_length);
 		break;
 
 	case REMOTE_GEN_PACKET:
+		adiv5_dp_shadow_invalidate(&remote_dp);
 		remote_packet_process_general(packet, packet_length);
 		break;
 
 	case REMOTE_HL_PACKET:
+		adiv5_dp_shadow_invalidate(&remote_dp);
 		remote_packet_process_high_level(packet, packet_length);
 		break;
 
@@ -895,4 +950,399 @@ void remote_packet_process(char *const packet, const size_t packet_length)
 		break;
 	}
 }
+
+/* Send the header of a binary frame response for the request's tag, with `length` bytes of payload to follow */
+static void remote_binary_respond_header(const uint8_t tag, const char response_code, const size_t length)
+{
+	const char header[] = {
+		REMOTE_BINARY_SOM,
+		(char)tag,
+		response_code,
+		(char)(length & 0xffU),
+		(char)((length >> 8U) & 0xffU),
+	};
+	gdb_if_write(header, sizeof(header), !length);
+}
+
+/* Send raw data as part of a binary frame payload, flushing at the end of it if this completes the frame */
+static void remote_binary_send_buf(const void *const data, const size_t length, const bool last)
+{
+	gdb_if_write(data, length, last);
+}
+
+/* Send a binary frame response with the request's tag and some raw data following */
+static void remote_binary_respond(
+	const uint8_t tag, const char response_code, const void *const data, const size_t length)
+{
+	remote_binary_respond_header(tag, response_code, length);
+	remote_binary_send_buf(data, length, true);
+}
+
+/*
+ * Send a binary frame error response, the error value being sent as a 64-bit little endian number,
+ * followed by any partial results there are
+ */
+static void remote_binary_respond_error_with_data(
+	const uint8_t tag, const uint64_t error, const void *const data, const size_t length)
+{
+	uint8_t response[8];
+	write_le4(response, 0U, (uint32_t)error);
+	write_le4(response, 4U, (uint32_t)(error >> 32U));
+	remote_binary_respond_header(tag, REMOTE_RESP_ERR, sizeof(response) + length);
+	remote_binary_send_buf(response, sizeof(response), !length);
+	remote_binary_send_buf(data, length, true);
+}
+
+static void remote_binary_respond_error(const uint8_t tag, const uint64_t error)
+{
+	remote_binary_respond_error_with_data(tag, error, NULL, 0U);
+}
+
+static void remote_binary_adiv5_respond(const uint8_t tag, const void *const data, const size_t length)
+{
+	if (remote_dp.fault)
+		/* If the request didn't work and caused a fault, tell the host */
+		remote_binary_respond_error(tag, REMOTE_ERROR_FAULT | ((uint16_t)remote_dp.fault << 8U));
+	else
+		/* Otherwise reply back with the data */
+		remote_binary_respond(tag, REMOTE_RESP_OK, data, length);
+}
+
+static void remote_binary_process_adiv5(
+	const uint8_t tag, const char command, const uint8_t *const payload, const size_t payload_length)
+{
+	/* Check the payload holds at least the common memory I/O request header */
+	if (payload_length < REMOTE_BINARY_MEM_WRITE_OVERHEAD) {
+		remote_binary_respond_error(tag, REMOTE_ERROR_WRONGLEN);
+		return;
+	}
+
+	/* Set up the DP and a fake AP structure to perform the access with */
+	remote_dp.dev_index = payload[0];
+	remote_dp.fault = 0U;
+	adiv5_access_port_s remote_ap;
+	remote_ap.apsel = payload[1];
+	remote_ap.dp = &remote_dp;
+	/* Grab the CSW value to use in the access */
+	remote_ap.csw = read_le4(payload, 2U);
+
+	switch (command) {
+	case REMOTE_BINARY_MEM_READ: { /* m = Read from memory */
+		/* Grab the start address for the read and how many bytes to read */
+		const target_addr64_t address = read_le4(payload, 6U) | ((uint64_t)read_le4(payload, 10U) << 32U);
+		const uint32_t length = read_le4(payload, 14U);
+		/* Binary framing lets the response use the entire packet buffer */
+		if (payload_length != REMOTE_BINARY_MEM_READ_LENGTH || length > GDB_PACKET_BUFFER_SIZE) {
+			remote_binary_respond(tag, REMOTE_RESP_PARERR, NULL, 0U);
+			break;
+		}
+		/* Get the aligned packet buffer to reuse for the data read, the request has been decoded by this point */
+		void *data = gdb_packet_buffer();
+		/* Perform the read and send back the results */
+		adiv5_mem_read(&remote_ap, data, address, length);
+		remote_binary_adiv5_respond(tag, data, length);
+		break;
+	}
+	case REMOTE_BINARY_MEM_WRITE: { /* M = Write to memory */
+		/* Grab the alignment for the access and the start address for the write */
+		const align_e align = payload[6];
+		const target_addr64_t address = read_le4(payload, 7U) | ((uint64_t)read_le4(payload, 11U) << 32U);
+		/* The data to write makes up the rest of the payload, so validate it against the alignment */
+		const size_t length = payload_length - REMOTE_BINARY_MEM_WRITE_OVERHEAD;
+		if (align > ALIGN_64BIT || length & ((1U << align) - 1U)) {
+			remote_binary_respond(tag, REMOTE_RESP_PARERR, NULL, 0U);
+			break;
+		}
+		/* Perform the write straight from the packet buffer and report success/failures */
+		adiv5_mem_write_aligned(&remote_ap, address, payload + REMOTE_BINARY_MEM_WRITE_OVERHEAD, length, align);
+		remote_binary_adiv5_respond(tag, NULL, 0U);
+		break;
+	}
+
+	default:
+		remote_binary_respond_error(tag, REMOTE_ERROR_UNRECOGNISED);
+		break;
+	}
+}
+
+/* Determine how long a batch operation is, or 0 if it is not one we know about */
+static size_t remote_binary_batch_op_length(const uint8_t operation)
+{
+	switch (operation) {
+	case REMOTE_BATCH_REG_READ:
+		return REMOTE_BATCH_REG_READ_LENGTH;
+	case REMOTE_BATCH_REG_WRITE:
+		return REMOTE_BATCH_REG_WRITE_LENGTH;
+	case REMOTE_BATCH_MEM_READ:
+		return REMOTE_BATCH_MEM_READ_LENGTH;
+	case REMOTE_BATCH_MEM_POLL:
+		return REMOTE_BATCH_MEM_POLL_LENGTH;
+	default:
+		return 0U;
+	}
+}
+
+/* Determine how many bytes of results a batch operation produces */
+static size_t remote_binary_batch_result_length(const uint8_t *const operation)
+{
+	switch (operation[0]) {
+	case REMOTE_BATCH_REG_READ:
+	case REMOTE_BATCH_MEM_POLL:
+		return 4U;
+	case REMOTE_BATCH_MEM_READ:
+		return read_le2(operation, 14U);
+	default:
+		return 0U;
+	}
+}
+
+static uint16_t remote_binary_batch_reg_addr(const uint8_t *const operation)
+{
+	const uint16_t addr = read_le2(operation, 1U);
+	return (addr & REMOTE_ADIV5_APnDP ? ADIV5_APnDP : 0U) | (addr & 0x00ffU);
+}
+
+/* Run a single batch operation, returning false if it timed out (having still stored the last value read) */
+static bool remote_binary_batch_run_op(
+	adiv5_access_port_s *const ap, const uint8_t *const operation, uint8_t *const results)
+{
+	switch (operation[0]) {
+	case REMOTE_BATCH_REG_READ:
+		write_le4(results, 0U, adiv5_dp_read(&remote_dp, remote_binary_batch_reg_addr(operation)));
+		break;
+	case REMOTE_BATCH_REG_WRITE:
+		adiv5_dp_write(&remote_dp, remote_binary_batch_reg_addr(operation), read_le4(operation, 3U));
+		break;
+	case REMOTE_BATCH_MEM_READ:
+	case REMOTE_BATCH_MEM_POLL: {
+		ap->apsel = operation[1];
+		ap->csw = read_le4(operation, 2U);
+		const target_addr64_t address = read_le4(operation, 6U) | ((uint64_t)read_le4(operation, 10U) << 32U);
+		if (operation[0] == REMOTE_BATCH_MEM_READ) {
+			adiv5_mem_read(ap, results, address, read_le2(operation, 14U));
+			break;
+		}
+		const uint32_t mask = read_le4(operation, 14U);
+		const uint32_t expected = read_le4(operation, 18U);
+		platform_timeout_s timeout;
+		platform_timeout_set(&timeout, read_le2(operation, 22U));
+		/* Keep reading the location until the masked value matches, the read faults or we run out of time */
+		uint32_t value = 0U;
+		while (true) {
+			adiv5_mem_read(ap, &value, address, sizeof(value));
+			if (remote_dp.fault || (value & mask) == expected || platform_timeout_is_expired(&timeout))
+				break;
+		}
+		write_le4(results, 0U, value);
+		return remote_dp.fault || (value & mask) == expected;
+	}
+	}
+	return true;
+}
+
+static void remote_binary_process_adiv5_batch(const uint8_t tag, uint8_t *const payload, const size_t payload_length)
+{
+	/* Validate the operation list and work out how much result data it will produce */
+	size_t results_length = 0U;
+	for (size_t offset = 1U; offset < payload_length;) {
+		const size_t op_length = remote_binary_batch_op_length(payload[offset]);
+		if (!op_length || offset + op_length > payload_length) {
+			remote_binary_respond(tag, REMOTE_RESP_PARERR, NULL, 0U);
+			return;
+		}
+		results_length += remote_binary_batch_result_length(payload + offset);
+		offset += op_length;
+	}
+	/* The results are built up in the packet buffer just after the request, so they must fit there */
+	if (results_length > GDB_PACKET_BUFFER_SIZE - payload_length) {
+		remote_binary_respond(tag, REMOTE_RESP_PARERR, NULL, 0U);
+		return;
+	}
+	uint8_t *const results = payload + payload_length;
+
+	/* Set up the DP and a fake AP structure to perform the accesses with */
+	remote_dp.dev_index = payload[0];
+	remote_dp.fault = 0U;
+	adiv5_access_port_s remote_ap;
+	remote_ap.dp = &remote_dp;
+
+	/* Run the operations in order, stopping at the first that fails */
+	size_t results_offset = 0U;
+	for (size_t offset = 1U; offset < payload_length; offset += remote_binary_batch_op_length(payload[offset])) {
+		if (!remote_binary_batch_run_op(&remote_ap, payload + offset, results + results_offset)) {
+			/* Report the timeout along with the results so far, including the poll's last value */
+			remote_binary_respond_error_with_data(tag, REMOTE_ERROR_TIMEOUT, results, results_offset + 4U);
+			return;
+		}
+		if (remote_dp.fault)
+			break;
+		results_offset += remote_binary_batch_result_length(payload + offset);
+	}
+	remote_binary_adiv5_respond(tag, results, results_length);
+}
+
+/*
+ * For the Flash offload, the probe scans for and attaches to the target itself so its own Flash drivers get a
+ * fully set up copy of it to run against. The copy is dropped again without detaching at the end of the
+ * session, leaving the core halted for BMDA to carry on with.
+ */
+static target_s *remote_flash_target;
+static bool remote_flash_saved_differential;
+static bool remote_flash_saved_blank_check;
+
+static void remote_flash_controller_destroy(target_controller_s *const controller, target_s *const target)
+{
+	(void)controller;
+	(void)target;
+	remote_flash_target = NULL;
+}
+
+static void remote_flash_controller_printf(target_controller_s *const controller, const char *const fmt, va_list ap)
+{
+	/* There's no GDB on this end to show the drivers' messages to */
+	(void)controller;
+	(void)fmt;
+	(void)ap;
+}
+
+static target_controller_s remote_flash_controller = {
+	.destroy_callback = remote_flash_controller_destroy,
+	.printf = remote_flash_controller_printf,
+};
+
+static void remote_flash_release(void)
+{
+	if (!remote_flash_target)
+		return;
+	flash_differential = remote_flash_saved_differential;
+	flash_blank_check = remote_flash_saved_blank_check;
+	/* Keep the detach routine from resuming the core as the target list is freed */
+	remote_flash_target->attached = false;
+	target_list_free();
+}
+
+static void remote_binary_flash_attach(const uint8_t tag, const uint8_t *const payload)
+{
+	remote_flash_release();
+	const bool scanned = payload[1U] == REMOTE_FLASH_SCAN_JTAG ? jtag_scan() : adiv5_swd_scan(read_le4(payload, 2U));
+	if (scanned)
+		remote_flash_target = target_attach_n(payload[6U], &remote_flash_controller);
+	if (!remote_flash_target || !remote_flash_target->flash) {
+		remote_flash_release();
+		remote_binary_respond_error(tag, REMOTE_ERROR_FAULT);
+		return;
+	}
+
+	/* Program the Flash the way BMDA has been told to for the duration of the session */
+	remote_flash_saved_differential = flash_differential;
+	remote_flash_saved_blank_check = flash_blank_check;
+	flash_differential = payload[7U] & REMOTE_FLASH_FLAG_DIFFERENTIAL;
+	flash_blank_check = payload[7U] & REMOTE_FLASH_FLAG_BLANK_CHECK;
+	/* Hold Flash mode across the operations, which only comes to an end on a releasing complete */
+	target_flash_session_begin(remote_flash_target);
+	const char *const driver = remote_flash_target->driver;
+	remote_binary_respond(tag, REMOTE_RESP_OK, driver, strlen(driver));
+}
+
+static bool remote_binary_flash_erase(const uint8_t *const payload, const size_t payload_length)
+{
+	target_flash_range_s ranges[REMOTE_FLASH_MAX_RANGES];
+	const size_t count = (payload_length - REMOTE_FLASH_ERASE_OVERHEAD) / REMOTE_FLASH_RANGE_LENGTH;
+	for (size_t idx = 0U; idx < count; ++idx) {
+		const size_t offset = REMOTE_FLASH_ERASE_OVERHEAD + (idx * REMOTE_FLASH_RANGE_LENGTH);
+		ranges[idx].addr = read_le4(payload, offset);
+		ranges[idx].length = read_le4(payload, offset + 4U);
+	}
+	if (payload[1U])
+		return target_flash_erase_on_write(remote_flash_target, ranges, count);
+	return target_flash_erase_ranges(remote_flash_target, ranges, count);
+}
+
+static bool remote_binary_flash_complete(const uint8_t *const payload)
+{
+	if (!payload[1U])
+		return target_flash_complete(remote_flash_target);
+	const bool result = target_flash_session_end(remote_flash_target);
+	remote_flash_release();
+	return result;
+}
+
+static void remote_binary_process_flash(const uint8_t tag, const uint8_t *const payload, const size_t payload_length)
+{
+	const uint8_t operation = payload[0U];
+	/* Check the request is well formed for the operation asked for */
+	bool valid = false;
+	switch (operation) {
+	case REMOTE_FLASH_ATTACH:
+		valid = payload_length == REMOTE_FLASH_ATTACH_LENGTH;
+		break;
+	case REMOTE_FLASH_ERASE:
+		valid = payload_length >= REMOTE_FLASH_ERASE_OVERHEAD &&
+			payload_length <= REMOTE_FLASH_ERASE_OVERHEAD + (REMOTE_FLASH_MAX_RANGES * REMOTE_FLASH_RANGE_LENGTH) &&
+			(payload_length - REMOTE_FLASH_ERASE_OVERHEAD) % REMOTE_FLASH_RANGE_LENGTH == 0U;
+		break;
+	case REMOTE_FLASH_WRITE:
+		valid = payload_length >= REMOTE_FLASH_WRITE_OVERHEAD;
+		break;
+	case REMOTE_FLASH_COMPLETE:
+		valid = payload_length == REMOTE_FLASH_COMPLETE_LENGTH;
+		break;
+	default:
+		remote_binary_respond_error(tag, REMOTE_ERROR_UNRECOGNISED);
+		return;
+	}
+	if (!valid) {
+		remote_binary_respond(tag, REMOTE_RESP_PARERR, NULL, 0U);
+		return;
+	}
+
+	if (operation == REMOTE_FLASH_ATTACH) {
+		remote_binary_flash_attach(tag, payload);
+		return;
+	}
+	/* Everything else needs a session to have been started with an attach */
+	bool result = remote_flash_target != NULL;
+	if (result && operation == REMOTE_FLASH_ERASE)
+		result = remote_binary_flash_erase(payload, payload_length);
+	else if (result && operation == REMOTE_FLASH_WRITE)
+		result = target_flash_write(remote_flash_target, read_le4(payload, 1U),
+			payload + REMOTE_FLASH_WRITE_OVERHEAD, payload_length - REMOTE_FLASH_WRITE_OVERHEAD);
+	else if (result)
+		result = remote_binary_flash_complete(payload);
+
+	if (result)
+		remote_binary_respond(tag, REMOTE_RESP_OK, NULL, 0U);
+	else
+		remote_binary_respond_error(tag, REMOTE_ERROR_FAULT);
+}
+
+void remote_binary_packet_process(
+	const uint8_t tag, const char command, uint8_t *const payload, const size_t payload_length)
+{
+	/* Check the payload actually fit in the buffer and holds at least a dev_index */
+	if (payload_length > GDB_PACKET_BUFFER_SIZE || payload_length < 1U) {
+		remote_binary_respond_error(tag, REMOTE_ERROR_WRONGLEN);
+		return;
+	}
+
+	SET_IDLE_STATE(0);
+	/* Setup an exception frame to try the ADIv5 operation in */
+	TRY (EXCEPTION_ALL) {
+		if (command == REMOTE_BINARY_ADIV5_BATCH)
+			remote_binary_process_adiv5_batch(tag, payload, payload_length);
+		else if (command == REMOTE_BINARY_FLASH)
+			remote_binary_process_flash(tag, payload, payload_length);
+		else
+			remote_binary_process_adiv5(tag, command, payload, payload_length);
+	}
+	CATCH () {
+	/* Handle any exception we've caught by translating it into a remote protocol response */
+	default:
+		remote_binary_respond_error(tag, REMOTE_ERROR_EXCEPTION | ((uint64_t)exception_frame.type << 8U));
+	}
+	/* The Flash offload's scans and drivers work the DP behind the memory I/O's back, so drop its shadows */
+	if (command == REMOTE_BINARY_FLASH)
+		adiv5_dp_shadow_invalidate(&remote_dp);
+	SET_IDLE_STATE(1);
+}
 #endif
@@ -26,7 +26,7 @@
 #include <stddef.h>
 #include "general.h"
 
-#define REMOTE_HL_VERSION 4
+#define REMOTE_HL_VERSION 5
 
 /*
  * Commands to remote end, and responses
@@ -48,6 +48,17 @@
  *       resp: F<PARAM> - hex value returned, bad parity.
  *             X<err>   - error occurred
  *
+ * From v5 on, memory I/O may alternatively be done with length-prefixed binary frames:
+ *
+ * %<TAG><CMD><LEN><PAYLOAD>
+ *   <TAG>     - 1 byte sequence number, echoed back in the response so requests may be pipelined
+ *   <CMD>     - 1 byte command
+ *   <LEN>     - 2 byte little endian payload length
+ *   <PAYLOAD> - <LEN> bytes of raw binary payload data
+ *
+ *   resp: %<TAG><STATUS><LEN><PAYLOAD>, where <STATUS> is one of the response codes below
+ *     and an error response's payload is the 64-bit little endian error value.
+ *
  * The whole protocol is defined in this header file. Parameters have
  * to be marshalled in remote.c, swdptap.c and jtagtap.c, so be
  * careful to ensure the parameter handling matches the protocol
@@ -59,12 +70,19 @@
 #define REMOTE_ERROR_WRONGLEN     2
 #define REMOTE_ERROR_FAULT        3
 #define REMOTE_ERROR_EXCEPTION    4
+#define REMOTE_ERROR_TIMEOUT      5
 
 /* Start and end of message identifiers */
 #define REMOTE_SOM  '!'
 #define REMOTE_EOM  '#'
 #define REMOTE_RESP '&'
 
+/* Start of binary frame identifier, used in both directions */
+#define REMOTE_BINARY_SOM '%'
+
+/* Binary frames have a 4 byte header following the start of frame byte */
+#define REMOTE_BINARY_HEADER_LENGTH 4U
+
 /* Protocol response options */
 #define REMOTE_RESP_OK     'K'
 #define REMOTE_RESP_PARERR 'P'
@@ -223,6 +241,7 @@
 #define REMOTE_HL_CHECK        'C'
 #define REMOTE_HL_ACCEL        'A'
 #define REMOTE_HL_ADD_JTAG_DEV 'J'
+#define REMOTE_HL_PACKET_SIZE  'P'
 
 #define REMOTE_HL_CHECK_STR                                          \
 	(char[])                                                         \
@@ -234,6 +253,11 @@
 	{                                                                \
 		REMOTE_SOM, REMOTE_HL_PACKET, REMOTE_HL_ACCEL, REMOTE_EOM, 0 \
 	}
+#define REMOTE_HL_PACKET_SIZE_STR                                          \
+	(char[])                                                               \
+	{                                                                      \
+		REMOTE_SOM, REMOTE_HL_PACKET, REMOTE_HL_PACKET_SIZE, REMOTE_EOM, 0 \
+	}
 #define REMOTE_JTAG_ADD_DEV_STR                                                               \
 	(char[])                                                                                  \
 	{                                                                                         \
@@ -252,6 +276,7 @@
 #define REMOTE_ACCEL_CORTEX_AR (1U << 1U)
 #define REMOTE_ACCEL_RISCV     (1U << 2U)
 #define REMOTE_ACCEL_ADIV6     (1U << 3U)
+#define REMOTE_ACCEL_FLASH     (1U << 4U)
 
 /* ADIv5 accleration protocol elements */
 #define REMOTE_ADIV5_PACKET     'A'
@@ -417,6 +442,7 @@
 #define REMOTE_SPI_WRTIE       'w'
 #define REMOTE_SPI_CHIP_ID     'I'
 #define REMOTE_SPI_RUN_COMMAND 'c'
+#define REMOTE_SPI_WAIT_READY  'W'
 
 #define REMOTE_SPI_BEGIN_STR                                                                          \
 	(char[])                                                                                          \
@@ -462,6 +488,73 @@
 			REMOTE_UINT24, REMOTE_EOM, 0                                                                  \
 	}
 
+#define REMOTE_SPI_WAIT_READY_STR                                                                                      \
+	(char[])                                                                                                           \
+	{                                                                                                                  \
+		REMOTE_SOM, REMOTE_SPI_PACKET, REMOTE_SPI_WAIT_READY, REMOTE_UINT8, REMOTE_UINT8, REMOTE_UINT32, REMOTE_EOM, 0 \
+	}
+
+/*
+ * Binary frame memory I/O commands, their payloads are all little endian:
+ *  read:  dev_index (u8), apsel (u8), csw (u32), address (u64), length (u32)
+ *  write: dev_index (u8), apsel (u8), csw (u32), align (u8), address (u64), data (rest of the payload)
+ */
+#define REMOTE_BINARY_MEM_READ           'm'
+#define REMOTE_BINARY_MEM_WRITE          'M'
+#define REMOTE_BINARY_MEM_READ_LENGTH    18U
+#define REMOTE_BINARY_MEM_WRITE_OVERHEAD 15U
+
+/*
+ * Binary frame ADIv5 batch command. The payload is the dev_index (u8) followed by a list of operations which the
+ * probe runs in order, stopping at the first that fails. The response is the concatenation of every operation's
+ * results. Operations, which all start with their operation byte, are:
+ *  r: register read  - addr (u16, using REMOTE_ADIV5_APnDP), results in the value read (u32)
+ *  w: register write - addr (u16, using REMOTE_ADIV5_APnDP), value (u32)
+ *  m: memory read    - apsel (u8), csw (u32), address (u64), length (u16), results in the data read
+ *  p: memory poll    - apsel (u8), csw (u32), address (u64), mask (u32), value (u32), timeout in ms (u16),
+ *                      reads address until (data & mask) == value, results in the last value read (u32)
+ */
+#define REMOTE_BINARY_ADIV5_BATCH 'B'
+#define REMOTE_BATCH_REG_READ     'r'
+#define REMOTE_BATCH_REG_WRITE    'w'
+#define REMOTE_BATCH_MEM_READ     'm'
+#define REMOTE_BATCH_MEM_POLL     'p'
+
+#define REMOTE_BATCH_REG_READ_LENGTH  3U
+#define REMOTE_BATCH_REG_WRITE_LENGTH 7U
+#define REMOTE_BATCH_MEM_READ_LENGTH  16U
+#define REMOTE_BATCH_MEM_POLL_LENGTH  24U
+
+/*
+ * Binary frame Flash offload command, which has the probe run a target's Flash drivers itself. The payload is an
+ * operation byte, then that operation's (little endian) parameters:
+ *  a: attach   - scan (u8, REMOTE_FLASH_SCAN_*), SWD targetid (u32), target number (u8, counting from 1 as for
+ *                target_attach_n()), flags (u8, REMOTE_FLASH_FLAG_*), responding with the target's driver name
+ *  e: erase    - lazy (u8, non-zero to erase as the data is written), then up to REMOTE_FLASH_MAX_RANGES ranges in
+ *                address order, each an address (u32) and length (u32)
+ *  w: write    - address (u32), data (rest of the payload)
+ *  c: complete - release (u8, non-zero to end the session, leaving the core halted)
+ * The attach starts a session the other operations then work within.
+ */
+#define REMOTE_BINARY_FLASH   'F'
+#define REMOTE_FLASH_ATTACH   'a'
+#define REMOTE_FLASH_ERASE    'e'
+#define REMOTE_FLASH_WRITE    'w'
+#define REMOTE_FLASH_COMPLETE 'c'
+
+#define REMOTE_FLASH_SCAN_SWD          's'
+#define REMOTE_FLASH_SCAN_JTAG         'j'
+#define REMOTE_FLASH_FLAG_DIFFERENTIAL (1U << 0U)
+#define REMOTE_FLASH_FLAG_BLANK_CHECK  (1U << 1U)
+
+#define REMOTE_FLASH_ATTACH_LENGTH   8U
+#define REMOTE_FLASH_ERASE_OVERHEAD  2U
+#define REMOTE_FLASH_RANGE_LENGTH    8U
+#define REMOTE_FLASH_MAX_RANGES      16U
+#define REMOTE_FLASH_WRITE_OVERHEAD  5U
+#define REMOTE_FLASH_COMPLETE_LENGTH 2U
+
 void remote_packet_process(char *packet, size_t packet_length);
+void remote_binary_packet_process(uint8_t tag, char command, uint8_t *payload, size_t payload_length);
 
 #endif /* REMOTE_H */
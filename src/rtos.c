@@ -0,0 +1,564 @@
+/*
+ * This file is part of the Black Magic Debug project.
+ *
+ * Copyright (C) 2026 1BitSquared <info@1bitsquared.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * This file implements RTOS awareness for FreeRTOS and Zephyr on Cortex-M targets, so GDB can show the
+ * kernel's threads as its own and unwind the ones that aren't running.
+ *
+ * GDB looks up the kernel's symbols for us through qSymbol. The first time GDB wants the thread list
+ * after a halt, a snapshot of it is taken by walking the kernel's thread lists, and that serves every
+ * request until the target is resumed again. Walking a list only reads each node's links and owner, and
+ * the FreeRTOS ready lists are all read in one go. A thread's name is only read the first time it shows
+ * up, so a thread seen at the previous halt costs nothing more than the list walk.
+ *
+ * The registers of a thread that isn't running are recovered from the context its kernel saved on its
+ * stack: the callee saved registers the kernel stacked itself, followed by the exception frame the core
+ * stacked on entry to PendSV. Only the ARMv6-M and ARMv7-M context layouts are understood.
+ */
+
+#include "general.h"
+#include "target.h"
+#include "target_internal.h"
+#include "cortexm.h"
+#include "cortex.h"
+#include "rtos.h"
+
+#if CONFIG_BMDA == 1
+#define RTOS_MAX_THREADS 256U
+#else
+#define RTOS_MAX_THREADS 64U
+#endif
+#define RTOS_NAME_LENGTH 16U
+
+/* EXC_RETURN for a return to thread mode on the PSP with a basic (non-FP) frame */
+#define RTOS_EXC_RETURN_BASIC       0xfffffffdU
+#define RTOS_EXC_RETURN_BASIC_FRAME (1U << 4U)
+#define RTOS_BASIC_FRAME_SIZE       32U
+#define RTOS_EXTENDED_FRAME_SIZE    104U
+/* Set in the stacked xPSR when the core had to pad the frame out to 8 byte alignment */
+#define RTOS_XPSR_FRAME_PADDED (1U << 9U)
+
+typedef enum rtos_symbol {
+	RTOS_FREERTOS_CURRENT_TCB,
+	RTOS_FREERTOS_READY_LISTS,
+	RTOS_FREERTOS_DELAYED_LIST1,
+	RTOS_FREERTOS_DELAYED_LIST2,
+	RTOS_FREERTOS_PENDING_READY_LIST,
+	RTOS_FREERTOS_SUSPENDED_LIST,
+	RTOS_FREERTOS_TERMINATION_LIST,
+	RTOS_FREERTOS_TOP_USED_PRIORITY,
+	RTOS_ZEPHYR_KERNEL,
+	RTOS_ZEPHYR_OFFSETS,
+	RTOS_ZEPHYR_OFFSET_COUNT,
+	RTOS_SYMBOL_COUNT,
+} rtos_symbol_e;
+
+static const char *const rtos_symbol_names[RTOS_SYMBOL_COUNT] = {
+	[RTOS_FREERTOS_CURRENT_TCB] = "pxCurrentTCB",
+	[RTOS_FREERTOS_READY_LISTS] = "pxReadyTasksLists",
+	[RTOS_FREERTOS_DELAYED_LIST1] = "xDelayedTaskList1",
+	[RTOS_FREERTOS_DELAYED_LIST2] = "xDelayedTaskList2",
+	[RTOS_FREERTOS_PENDING_READY_LIST] = "xPendingReadyList",
+	[RTOS_FREERTOS_SUSPENDED_LIST] = "xSuspendedTaskList",
+	[RTOS_FREERTOS_TERMINATION_LIST] = "xTasksWaitingTermination",
+	[RTOS_FREERTOS_TOP_USED_PRIORITY] = "uxTopUsedPriority",
+	[RTOS_ZEPHYR_KERNEL] = "_kernel",
+	[RTOS_ZEPHYR_OFFSETS] = "_kernel_thread_info_offsets",
+	[RTOS_ZEPHYR_OFFSET_COUNT] = "_kernel_thread_info_num_offsets",
+};
+
+typedef enum rtos_state {
+	RTOS_STATE_RUNNING,
+	RTOS_STATE_READY,
+	RTOS_STATE_BLOCKED,
+	RTOS_STATE_SUSPENDED,
+	RTOS_STATE_DELETED,
+	RTOS_STATE_COUNT,
+} rtos_state_e;
+
+static const char *const rtos_state_names[RTOS_STATE_COUNT] = {
+	[RTOS_STATE_RUNNING] = "Running",
+	[RTOS_STATE_READY] = "Ready",
+	[RTOS_STATE_BLOCKED] = "Blocked",
+	[RTOS_STATE_SUSPENDED] = "Suspended",
+	[RTOS_STATE_DELETED] = "Deleted",
+};
+
+typedef struct rtos_thread {
+	uint32_t id;
+	uint8_t state;
+	bool seen;  /* Found again by the snapshot being taken */
+	bool named; /* The name has been read */
+	char name[RTOS_NAME_LENGTH + 1U];
+} rtos_thread_s;
+
+/* Where a thread that isn't running had its context saved */
+typedef struct rtos_frame {
+	uint32_t callee_saved[8]; /* r4-r11 */
+	uint32_t exception_frame; /* Address of the frame the core stacked */
+	uint32_t exc_return;      /* The EXC_RETURN the thread will be resumed with */
+} rtos_frame_s;
+
+typedef struct rtos_ops {
+	const char *name;
+	bool (*detect)(target_s *target);
+	uint32_t (*current_thread)(target_s *target);
+	bool (*update)(target_s *target);
+	bool (*thread_name)(target_s *target, rtos_thread_s *thread);
+	bool (*thread_frame)(target_s *target, uint32_t thread_id, rtos_frame_s *frame);
+} rtos_ops_s;
+
+bool rtos_enabled = true;
+
+static uint32_t rtos_symbols[RTOS_SYMBOL_COUNT];
+static const rtos_ops_s *rtos_ops = NULL;
+static bool rtos_detected = false;
+static bool rtos_current_valid = false;
+static uint32_t rtos_current = 0U;
+static bool rtos_snapshot_valid = false;
+static rtos_thread_s rtos_threads[RTOS_MAX_THREADS];
+static size_t rtos_thread_total = 0U;
+
+/* Record a thread found by the snapshot being taken, false if there's no more room for threads */
+static bool rtos_thread_seen(const uint32_t thread_id, const rtos_state_e state)
+{
+	if (!thread_id)
+		return true;
+	const rtos_state_e actual_state = thread_id == rtos_current ? RTOS_STATE_RUNNING : state;
+	for (size_t idx = 0U; idx < rtos_thread_total; ++idx) {
+		rtos_thread_s *const thread = &rtos_threads[idx];
+		if (thread->id != thread_id)
+			continue;
+		/* A thread can be on more than one of the lists walked, the first one found wins */
+		if (!thread->seen)
+			thread->state = actual_state;
+		thread->seen = true;
+		return true;
+	}
+	if (rtos_thread_total == RTOS_MAX_THREADS)
+		return false;
+	rtos_thread_s *const thread = &rtos_threads[rtos_thread_total++];
+	thread->id = thread_id;
+	thread->state = actual_state;
+	thread->seen = true;
+	thread->named = false;
+	thread->name[0] = '\0';
+	return true;
+}
+
+/*
+ * FreeRTOS keeps its tasks on doubly linked lists, with the list header ending in a sentinel node.
+ * This assumes the default 32-bit configuration: no list integrity check bytes and mini list items.
+ */
+#define FREERTOS_LIST_SIZE       20U
+#define FREERTOS_LIST_END_OFFSET 8U
+#define FREERTOS_LIST_WORDS      (FREERTOS_LIST_SIZE / 4U)
+/* Offset of pcTaskName in the TCB, when the MPU wrappers aren't in use */
+#define FREERTOS_TCB_NAME_OFFSET 52U
+#define FREERTOS_MAX_PRIORITIES  32U
+/* Ready lists read per batch, which keeps the stack use of the walk bounded */
+#define FREERTOS_READY_LIST_BATCH 8U
+/* Coprocessor Access Control Register, CP10 and CP11 enabled once the FreeRTOS port turns the FPU on */
+#define FREERTOS_CPACR            0xe000ed88U
+#define FREERTOS_CPACR_FPU_ACCESS 0x00f00000U
+
+static uint32_t freertos_priorities = 0U;
+
+static bool freertos_detect(target_s *const target)
+{
+	if (!rtos_symbols[RTOS_FREERTOS_CURRENT_TCB] || !rtos_symbols[RTOS_FREERTOS_READY_LISTS] ||
+		!rtos_symbols[RTOS_FREERTOS_DELAYED_LIST1])
+		return false;
+
+	/* uxTopUsedPriority gives the number of ready lists when the program keeps it */
+	if (rtos_symbols[RTOS_FREERTOS_TOP_USED_PRIORITY])
+		freertos_priorities = target_mem32_read32(target, rtos_symbols[RTOS_FREERTOS_TOP_USED_PRIORITY]) + 1U;
+	else {
+		/* Otherwise rely on xDelayedTaskList1 being laid out straight after the ready lists, as tasks.c declares */
+		const uint32_t ready_lists = rtos_symbols[RTOS_FREERTOS_READY_LISTS];
+		const uint32_t delayed_list = rtos_symbols[RTOS_FREERTOS_DELAYED_LIST1];
+		if (delayed_list > ready_lists && (delayed_list - ready_lists) % FREERTOS_LIST_SIZE == 0U)
+			freertos_priorities = (delayed_list - ready_lists) / FREERTOS_LIST_SIZE;
+		else {
+			DEBUG_WARN("FreeRTOS: uxTopUsedPriority is missing, only priority 0 tasks will be found ready\n");
+			freertos_priorities = 1U;
+		}
+	}
+	if (target_check_error(target) || !freertos_priorities)
+		return false;
+	freertos_priorities = MIN(freertos_priorities, FREERTOS_MAX_PRIORITIES);
+	return true;
+}
+
+static uint32_t freertos_current_thread(target_s *const target)
+{
+	return target_mem32_read32(target, rtos_symbols[RTOS_FREERTOS_CURRENT_TCB]);
+}
+
+static bool freertos_list_walk(
+	target_s *const target, const uint32_t list_addr, const uint32_t *const header, const rtos_state_e state)
+{
+	const uint32_t items = MIN(header[0], RTOS_MAX_THREADS);
+	const uint32_t list_end = list_addr + FREERTOS_LIST_END_OFFSET;
+	/* Start from the sentinel's pxNext, and stop on getting back round to it */
+	uint32_t node = header[3];
+	for (uint32_t item = 0U; item < items && node != list_end; ++item) {
+		/* pxNext, pxPrevious and pvOwner */
+		uint32_t links[3];
+		if (target_mem32_read(target, links, node + 4U, sizeof(links)) || !rtos_thread_seen(links[2], state))
+			return false;
+		node = links[0];
+	}
+	return true;
+}
+
+static bool freertos_update(target_s *const target)
+{
+	uint32_t headers[FREERTOS_READY_LIST_BATCH * FREERTOS_LIST_WORDS];
+	const uint32_t ready_lists = rtos_symbols[RTOS_FREERTOS_READY_LISTS];
+	for (uint32_t priority = 0U; priority < freertos_priorities; priority += FREERTOS_READY_LIST_BATCH) {
+		const uint32_t count = MIN(FREERTOS_READY_LIST_BATCH, freertos_priorities - priority);
+		const uint32_t batch_addr = ready_lists + priority * FREERTOS_LIST_SIZE;
+		if (target_mem32_read(target, headers, batch_addr, count * FREERTOS_LIST_SIZE))
+			return false;
+		for (uint32_t idx = 0U; idx < count; ++idx) {
+			if (!freertos_list_walk(target, batch_addr + idx * FREERTOS_LIST_SIZE,
+					headers + idx * FREERTOS_LIST_WORDS, RTOS_STATE_READY))
+				return false;
+		}
+	}
+
+	static const struct {
+		rtos_symbol_e symbol;
+		rtos_state_e state;
+	} lists[] = {
+		{RTOS_FREERTOS_PENDING_READY_LIST, RTOS_STATE_READY},
+		{RTOS_FREERTOS_DELAYED_LIST1, RTOS_STATE_BLOCKED},
+		{RTOS_FREERTOS_DELAYED_LIST2, RTOS_STATE_BLOCKED},
+		{RTOS_FREERTOS_SUSPENDED_LIST, RTOS_STATE_SUSPENDED},
+		{RTOS_FREERTOS_TERMINATION_LIST, RTOS_STATE_DELETED},
+	};
+	for (size_t idx = 0U; idx < ARRAY_LENGTH(lists); ++idx) {
+		const uint32_t list_addr = rtos_symbols[lists[idx].symbol];
+		/* Lists for features the program doesn't use simply aren't there */
+		if (!list_addr)
+			continue;
+		if (target_mem32_read(target, headers, list_addr, FREERTOS_LIST_SIZE) ||
+			!freertos_list_walk(target, list_addr, headers, lists[idx].state))
+			return false;
+	}
+	return true;
+}
+
+static bool freertos_thread_name(target_s *const target, rtos_thread_s *const thread)
+{
+	return !target_mem32_read(target, thread->name, thread->id + FREERTOS_TCB_NAME_OFFSET, RTOS_NAME_LENGTH);
+}
+
+static bool freertos_thread_frame(target_s *const target, const uint32_t thread_id, rtos_frame_s *const frame)
+{
+	/* pxTopOfStack is the first member of the TCB */
+	const uint32_t stack = target_mem32_read32(target, thread_id);
+	/* The FPU ports also save EXC_RETURN after r4-r11, and s16-s31 after that if the task used the FPU */
+	const bool fpu_port = (target_mem32_read32(target, FREERTOS_CPACR) & FREERTOS_CPACR_FPU_ACCESS) ==
+		FREERTOS_CPACR_FPU_ACCESS;
+	uint32_t stacked[9];
+	const size_t stacked_words = fpu_port ? 9U : 8U;
+	if (target_check_error(target) || target_mem32_read(target, stacked, stack, stacked_words * 4U))
+		return false;
+	memcpy(frame->callee_saved, stacked, sizeof(frame->callee_saved));
+	frame->exc_return = fpu_port ? stacked[8] : RTOS_EXC_RETURN_BASIC;
+	frame->exception_frame = stack + stacked_words * 4U;
+	if (!(frame->exc_return & RTOS_EXC_RETURN_BASIC_FRAME))
+		frame->exception_frame += 16U * 4U;
+	return true;
+}
+
+static const rtos_ops_s rtos_freertos = {
+	.name = "FreeRTOS",
+	.detect = freertos_detect,
+	.current_thread = freertos_current_thread,
+	.update = freertos_update,
+	.thread_name = freertos_thread_name,
+	.thread_frame = freertos_thread_frame,
+};
+
+/*
+ * Zephyr publishes the offsets of the thread structure members it's laid out with in
+ * _kernel_thread_info_offsets (with CONFIG_DEBUG_THREAD_INFO), and links every thread
+ * together from _kernel.threads (with CONFIG_THREAD_MONITOR).
+ */
+#define ZEPHYR_OFFSET_K_CURR_THREAD     1U
+#define ZEPHYR_OFFSET_K_THREADS         2U
+#define ZEPHYR_OFFSET_T_NEXT_THREAD     4U
+#define ZEPHYR_OFFSET_T_STATE           5U
+#define ZEPHYR_OFFSET_T_STACK_PTR       8U
+#define ZEPHYR_OFFSET_T_NAME            9U
+#define ZEPHYR_OFFSET_T_ARM_EXC_RETURN  13U
+#define ZEPHYR_OFFSET_COUNT             14U
+#define ZEPHYR_OFFSET_UNIMPLEMENTED     UINT32_MAX
+#define ZEPHYR_THREAD_DEAD              (1U << 3U)
+#define ZEPHYR_THREAD_SUSPENDED         (1U << 4U)
+#define ZEPHYR_THREAD_QUEUED            (1U << 7U)
+/* The callee saved registers, r4-r11, sit right before the saved PSP in the thread's arch state */
+#define ZEPHYR_CALLEE_SAVED_SIZE        32U
+
+static uint32_t zephyr_offsets[ZEPHYR_OFFSET_COUNT];
+
+static bool zephyr_detect(target_s *const target)
+{
+	if (!rtos_symbols[RTOS_ZEPHYR_KERNEL] || !rtos_symbols[RTOS_ZEPHYR_OFFSETS])
+		return false;
+	uint32_t count = ZEPHYR_OFFSET_COUNT;
+	if (rtos_symbols[RTOS_ZEPHYR_OFFSET_COUNT])
+		count = MIN(target_mem32_read32(target, rtos_symbols[RTOS_ZEPHYR_OFFSET_COUNT]), ZEPHYR_OFFSET_COUNT);
+	for (size_t idx = 0U; idx < ZEPHYR_OFFSET_COUNT; ++idx)
+		zephyr_offsets[idx] = ZEPHYR_OFFSET_UNIMPLEMENTED;
+	if (target_mem32_read(target, zephyr_offsets, rtos_symbols[RTOS_ZEPHYR_OFFSETS], count * sizeof(uint32_t)))
+		return false;
+	return zephyr_offsets[ZEPHYR_OFFSET_K_CURR_THREAD] != ZEPHYR_OFFSET_UNIMPLEMENTED &&
+		zephyr_offsets[ZEPHYR_OFFSET_K_THREADS] != ZEPHYR_OFFSET_UNIMPLEMENTED &&
+		zephyr_offsets[ZEPHYR_OFFSET_T_NEXT_THREAD] != ZEPHYR_OFFSET_UNIMPLEMENTED &&
+		zephyr_offsets[ZEPHYR_OFFSET_T_STATE] != ZEPHYR_OFFSET_UNIMPLEMENTED &&
+		zephyr_offsets[ZEPHYR_OFFSET_T_STACK_PTR] != ZEPHYR_OFFSET_UNIMPLEMENTED;
+}
+
+static uint32_t zephyr_current_thread(target_s *const target)
+{
+	return target_mem32_read32(target, rtos_symbols[RTOS_ZEPHYR_KERNEL] + zephyr_offsets[ZEPHYR_OFFSET_K_CURR_THREAD]);
+}
+
+static bool zephyr_update(target_s *const target)
+{
+	uint32_t thread =
+		target_mem32_read32(target, rtos_symbols[RTOS_ZEPHYR_KERNEL] + zephyr_offsets[ZEPHYR_OFFSET_K_THREADS]);
+	for (size_t count = 0U; thread && count < RTOS_MAX_THREADS; ++count) {
+		const uint8_t state = target_mem32_read8(target, thread + zephyr_offsets[ZEPHYR_OFFSET_T_STATE]);
+		if (target_check_error(target))
+			return false;
+		rtos_state_e thread_state = RTOS_STATE_BLOCKED;
+		if (state & ZEPHYR_THREAD_DEAD)
+			thread_state = RTOS_STATE_DELETED;
+		else if (state & ZEPHYR_THREAD_SUSPENDED)
+			thread_state = RTOS_STATE_SUSPENDED;
+		else if (state & ZEPHYR_THREAD_QUEUED)
+			thread_state = RTOS_STATE_READY;
+		if (!rtos_thread_seen(thread, thread_state))
+			return false;
+		thread = target_mem32_read32(target, thread + zephyr_offsets[ZEPHYR_OFFSET_T_NEXT_THREAD]);
+	}
+	return !target_check_error(target);
+}
+
+static bool zephyr_thread_name(target_s *const target, rtos_thread_s *const thread)
+{
+	/* Thread names are optional (CONFIG_THREAD_NAME) */
+	if (zephyr_offsets[ZEPHYR_OFFSET_T_NAME] == ZEPHYR_OFFSET_UNIMPLEMENTED)
+		return true;
+	return !target_mem32_read(
+		target, thread->name, thread->id + zephyr_offsets[ZEPHYR_OFFSET_T_NAME], RTOS_NAME_LENGTH);
+}
+
+static bool zephyr_thread_frame(target_s *const target, const uint32_t thread_id, rtos_frame_s *const frame)
+{
+	/* r4-r11 followed by the PSP, which points at the frame the core stacked */
+	uint32_t callee_saved[9];
+	const uint32_t stack_ptr = thread_id + zephyr_offsets[ZEPHYR_OFFSET_T_STACK_PTR];
+	if (target_mem32_read(target, callee_saved, stack_ptr - ZEPHYR_CALLEE_SAVED_SIZE, sizeof(callee_saved)))
+		return false;
+	memcpy(frame->callee_saved, callee_saved, sizeof(frame->callee_saved));
+	frame->exception_frame = callee_saved[8];
+	frame->exc_return = RTOS_EXC_RETURN_BASIC;
+	/* Only the bottom byte of EXC_RETURN is kept, which is the part that says if the frame has FP state */
+	if (zephyr_offsets[ZEPHYR_OFFSET_T_ARM_EXC_RETURN] != ZEPHYR_OFFSET_UNIMPLEMENTED)
+		frame->exc_return =
+			0xffffff00U | target_mem32_read8(target, thread_id + zephyr_offsets[ZEPHYR_OFFSET_T_ARM_EXC_RETURN]);
+	return !target_check_error(target);
+}
+
+static const rtos_ops_s rtos_zephyr = {
+	.name = "Zephyr",
+	.detect = zephyr_detect,
+	.current_thread = zephyr_current_thread,
+	.update = zephyr_update,
+	.thread_name = zephyr_thread_name,
+	.thread_frame = zephyr_thread_frame,
+};
+
+static const rtos_ops_s *const rtos_kernels[] = {
+	&rtos_freertos,
+	&rtos_zephyr,
+};
+
+const char *rtos_symbol_name(const size_t index)
+{
+	return index < RTOS_SYMBOL_COUNT ? rtos_symbol_names[index] : NULL;
+}
+
+void rtos_symbol_value(const size_t index, const uint32_t value)
+{
+	if (index >= RTOS_SYMBOL_COUNT)
+		return;
+	rtos_symbols[index] = value;
+	/* Work out which kernel this is again with the new symbol */
+	rtos_detected = false;
+	rtos_ops = NULL;
+	rtos_invalidate();
+}
+
+void rtos_reset(void)
+{
+	memset(rtos_symbols, 0, sizeof(rtos_symbols));
+	rtos_detected = false;
+	rtos_ops = NULL;
+	rtos_thread_total = 0U;
+	rtos_invalidate();
+}
+
+void rtos_invalidate(void)
+{
+	rtos_current_valid = false;
+	rtos_snapshot_valid = false;
+}
+
+const char *rtos_name(void)
+{
+	return rtos_ops ? rtos_ops->name : NULL;
+}
+
+uint32_t rtos_current_thread(target_s *const target)
+{
+	if (!rtos_enabled || !target_is_cortexm(target))
+		return 0U;
+	if (!rtos_detected) {
+		rtos_detected = true;
+		for (size_t idx = 0U; idx < ARRAY_LENGTH(rtos_kernels) && !rtos_ops; ++idx) {
+			if (rtos_kernels[idx]->detect(target))
+				rtos_ops = rtos_kernels[idx];
+		}
+		if (rtos_ops)
+			DEBUG_INFO("RTOS: found %s\n", rtos_ops->name);
+	}
+	if (!rtos_ops)
+		return 0U;
+	if (!rtos_current_valid) {
+		rtos_current = rtos_ops->current_thread(target);
+		if (target_check_error(target))
+			rtos_current = 0U;
+		rtos_current_valid = true;
+	}
+	return rtos_current;
+}
+
+static bool rtos_snapshot(target_s *const target)
+{
+	if (rtos_snapshot_valid)
+		return true;
+	/* There's only a kernel to report on once its scheduler is running */
+	if (!rtos_current_thread(target))
+		return false;
+
+	for (size_t idx = 0U; idx < rtos_thread_total; ++idx)
+		rtos_threads[idx].seen = false;
+	if (!rtos_ops->update(target))
+		DEBUG_WARN("RTOS: failed to walk all of the %s thread lists\n", rtos_ops->name);
+	/* Make sure the running thread always makes it in, whichever list it's on */
+	rtos_thread_seen(rtos_current, RTOS_STATE_RUNNING);
+
+	/* Drop the threads that have gone away, and read the names of any new ones */
+	size_t kept = 0U;
+	for (size_t idx = 0U; idx < rtos_thread_total; ++idx) {
+		rtos_thread_s *const thread = &rtos_threads[idx];
+		if (!thread->seen)
+			continue;
+		if (!thread->named) {
+			if (!rtos_ops->thread_name(target, thread))
+				thread->name[0] = '\0';
+			thread->name[RTOS_NAME_LENGTH] = '\0';
+			thread->named = true;
+		}
+		if (kept != idx)
+			rtos_threads[kept] = *thread;
+		++kept;
+	}
+	rtos_thread_total = kept;
+	rtos_snapshot_valid = true;
+	return true;
+}
+
+size_t rtos_thread_count(target_s *const target)
+{
+	return rtos_snapshot(target) ? rtos_thread_total : 0U;
+}
+
+uint32_t rtos_thread_id(const size_t index)
+{
+	return index < rtos_thread_total ? rtos_threads[index].id : 0U;
+}
+
+static const rtos_thread_s *rtos_thread_find(target_s *const target, const uint32_t thread_id)
+{
+	if (!rtos_snapshot(target))
+		return NULL;
+	for (size_t idx = 0U; idx < rtos_thread_total; ++idx) {
+		if (rtos_threads[idx].id == thread_id)
+			return &rtos_threads[idx];
+	}
+	return NULL;
+}
+
+bool rtos_thread_valid(target_s *const target, const uint32_t thread_id)
+{
+	return rtos_thread_find(target, thread_id) != NULL;
+}
+
+void rtos_thread_describe(target_s *const target, const uint32_t thread_id, char *const buffer, const size_t length)
+{
+	const rtos_thread_s *const thread = rtos_thread_find(target, thread_id);
+	if (!thread)
+		snprintf(buffer, length, "Unknown");
+	else if (thread->name[0])
+		snprintf(buffer, length, "%s (%s)", thread->name, rtos_state_names[thread->state]);
+	else
+		snprintf(buffer, length, "%s", rtos_state_names[thread->state]);
+}
+
+bool rtos_thread_regs_read(target_s *const target, const uint32_t thread_id, uint32_t *const regs)
+{
+	if (!rtos_ops || !rtos_thread_find(target, thread_id))
+		return false;
+	rtos_frame_s frame;
+	/* r0-r3, r12, lr, pc and xPSR, as the core stacked them */
+	uint32_t stacked[8];
+	if (!rtos_ops->thread_frame(target, thread_id, &frame) ||
+		target_mem32_read(target, stacked, frame.exception_frame, sizeof(stacked)))
+		return false;
+
+	memcpy(regs, stacked, 4U * sizeof(uint32_t));
+	memcpy(regs + 4U, frame.callee_saved, sizeof(frame.callee_saved));
+	regs[12U] = stacked[4U];
+	regs[CORTEX_REG_LR] = stacked[5U];
+	regs[CORTEX_REG_PC] = stacked[6U];
+	regs[CORTEX_REG_XPSR] = stacked[7U];
+	/* The thread's stack pointer is wherever it was before the core stacked the frame */
+	const uint32_t frame_size =
+		frame.exc_return & RTOS_EXC_RETURN_BASIC_FRAME ? RTOS_BASIC_FRAME_SIZE : RTOS_EXTENDED_FRAME_SIZE;
+	regs[CORTEX_REG_SP] = frame.exception_frame + frame_size + (stacked[7U] & RTOS_XPSR_FRAME_PADDED ? 4U : 0U);
+	return true;
+}
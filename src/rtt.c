@@ -31,11 +31,13 @@
 #include "target/target_internal.h"
 #include "rtt.h"
 #include "rtt_if.h"
+#include "stats.h"
 
 bool rtt_enabled = false;
 bool rtt_found = false;
 static bool rtt_halt = false; // true if rtt needs to halt target to access memory
 uint32_t rtt_cbaddr = 0;
+uint32_t rtt_cbaddr_hint = 0;
 uint32_t rtt_num_up_chan = 0;
 uint32_t rtt_num_down_chan = 0;
 bool rtt_auto_channel = true;
@@ -51,11 +53,16 @@ static uint32_t last_poll_ms;
 /* flags for data from host to target */
 bool rtt_flag_skip = false;
 bool rtt_flag_block = false;
+/* read the up channels' data together rather than channel by channel */
+bool rtt_flag_coalesce = true;
 /* limit rtt ram accesses */
 bool rtt_flag_ram;                      // limit ram scanned by rtt
 uint32_t rtt_ram_start;                 // if rtt_flag_ram set, lower limit of ram scanned by rtt
 uint32_t rtt_ram_end;                   // if rtt_flag_ram set, upper limit of ram scanned by rtt
 static uint32_t saved_cblock_header[6]; // first 24 bytes of control block
+static bool rtt_revalidate;             // true if the next poll must re-check the control block and descriptors
+/* scratch space for the WrOff/RdOff span of the enabled channels */
+static uint32_t rtt_offsets[MAX_RTT_CHAN * sizeof(rtt_channel_s) / sizeof(uint32_t)];
 
 typedef enum rtt_retval {
 	RTT_OK,
@@ -74,6 +81,18 @@ char rtt_ident[16] = {0};
 /* usb uart transmit buffer */
 static char xmit_buf[RTT_UP_BUF_SIZE];
 
+/* largest single target read that fits xmit_buf, which needs 8 bytes for alignment and padding */
+#define RTT_COALESCE_MAX (sizeof(xmit_buf) - 8U)
+/* pending ranges closer together than this get read as one, along with the gap between them */
+#define RTT_COALESCE_GAP 64U
+
+/* a contiguous piece of an up channel's pending data */
+typedef struct rtt_range {
+	uint32_t addr;
+	uint32_t len;
+	uint32_t channel;
+} rtt_range_s;
+
 /*********************************************************************
 *
 *       rtt control block
@@ -82,94 +101,111 @@ static char xmit_buf[RTT_UP_BUF_SIZE];
 */
 
 /*
- * Search in memory for a hash of the target string. This uses a rolling
- * hash as described in [0] where memory is appended to a hash byte-by
- * byte, enabling fast searching for a target string in memory without
- * needing to continuously backtrack.
- *
- * The magic string we're looking for is 16 bytes long, which is stored
- * as `m`. Data is read into `srch_buf` in chunks of `stride` bytes, and
- * the previous `m` bytes are kept in memory to calculate the full hash.
- *
- * On each loop, the previous `stride + m` bytes are hashed together with
- * prime `p`. If the string is found the hashes will match. Note that
- * this does not check that the actual string matches, so it is prone
- * to false positives.
- *
- * The patten was derived using the following function:
- *
- * uint64_t make_hash(const char *s, size_t hash_len, uint64_t q)
- * {
- *     // Horner’s method, applied to modular hashing
- *     uint64_t h = 0;
- *     for (int j = 0; j < hash_len; j++)
- *         h = (256 * h + s[j]) % q;
- *     return h;
- * };
- *
- * The `remainder` was precomputed using the following function:
- *
- * uint64_t make_remainder(size_t hash_len, uint64_t q) {
- *     // precompute 256^(m-1) % q for use in removing leading digit
- *     uint64_t r = 1;
- *     for (int i = 1; i <= hash_len-1; i++)
- *         r = (256 * r) % q;
- *     return r;
- * }
- *
- * References:
- * [Algo] Rolling hash; Rabin-Karp string search
- * - 0: https://yurichev.com/news/20210205_rolling_hash/
+ * How much target memory the control block search reads at a time. BMDA has memory to spare for
+ * large reads, which keeps the per-transfer overhead of the probe link out of long RAM scans.
  */
-static uint32_t fast_search(target_s *const cur_target, const uint32_t ram_start, const uint32_t ram_end)
+#if CONFIG_BMDA == 1
+#define RTT_SEARCH_CHUNK 16384U
+#else
+#define RTT_SEARCH_CHUNK 128U
+#endif
+
+/* ID of a SEGGER RTT control block as it appears in target memory, padded out with NULs */
+static const char rtt_default_ident[16] = "SEGGER RTT";
+/* chunk buffer, with room at the front for the tail of the previous chunk */
+static uint8_t rtt_search_buf[RTT_SEARCH_CHUNK + sizeof(rtt_default_ident)];
+
+/* Find the first occurrence of value in [start, end) */
+static const uint8_t *rtt_find_char(const uint8_t *const start, const uint8_t *const end, const uint8_t value)
 {
-	static const uint32_t hash_len = 16;
-	static const uint64_t pattern = 0x444110cd;
-	static const uint64_t remainder = 0x73b07d01;
-	static const uint64_t q = 0x797a9691; /* prime */
-	static const uint32_t stride = 128;
-	uint64_t hash = 0;
-	uint8_t *srch_buf = alloca(hash_len + stride);
-
-	memset(srch_buf, 0, hash_len + stride);
-
-	for (uint32_t addr = ram_start; addr < ram_end; addr += stride) {
-		uint32_t buf_siz = MIN(stride, ram_end - addr);
-		memcpy(srch_buf, srch_buf + stride, hash_len);
-		if (target_mem32_read(cur_target, srch_buf + hash_len, addr, buf_siz)) {
-			gdb_outf("rtt: read fail at 0x%" PRIx32 "\r\n", addr);
-			return 0;
-		}
-		for (uint32_t i = 0; i < buf_siz; i++) {
-			hash = (hash + q - remainder * srch_buf[i] % q) % q;
-			hash = ((hash << 8U) + srch_buf[i + hash_len]) % q;
-			if (pattern == hash)
-				return addr + i - hash_len + 1U;
-		}
+#if CONFIG_BMDA == 1
+	/* the C library's memchr() is vectorised on any host we run on */
+	return memchr(start, value, end - start);
+#else
+	/* check bytes one at a time up to the first word boundary */
+	const uint8_t *ptr = start;
+	for (; ptr < end && ((uintptr_t)ptr & 3U); ++ptr) {
+		if (*ptr == value)
+			return ptr;
 	}
-	/* no match */
-	return 0;
+	/* then skip whole words until one has a byte that matches (a byte that is zero after the XOR) */
+	const uint32_t pattern = value * 0x01010101U;
+	for (; ptr + 4U <= end; ptr += 4U) {
+		uint32_t word;
+		memcpy(&word, ptr, sizeof(word));
+		word ^= pattern;
+		if ((word - 0x01010101U) & ~word & 0x80808080U)
+			break;
+	}
+	for (; ptr < end; ++ptr) {
+		if (*ptr == value)
+			return ptr;
+	}
+	return NULL;
+#endif
 }
 
-static uint32_t memory_search(target_s *const cur_target, const uint32_t ram_start, const uint32_t ram_end)
+/*
+ * Search target memory for the control block ident. Memory is read in large chunks and each
+ * one scanned for the ident's first character, with only those places compared in full.
+ * The end of each chunk is carried over to the next so an ident straddling two is still found.
+ */
+static uint32_t rtt_search(target_s *const cur_target, const uint32_t ram_start, const uint32_t ram_end,
+	const char *const ident, const size_t ident_len)
 {
-	const char *const srch_str = rtt_ident;
-	const uint32_t srch_str_len = strlen(srch_str);
-	uint8_t srch_buf[128];
-
-	if (srch_str_len == 0 || srch_str_len > sizeof(srch_buf) / 2U)
+	if (ident_len == 0 || ident_len > sizeof(rtt_default_ident))
 		return 0;
 
-	for (uint32_t addr = ram_start; addr < ram_end; addr += sizeof(srch_buf) - srch_str_len - 1U) {
-		uint32_t buf_siz = MIN(ram_end - addr, sizeof(srch_buf));
-		if (target_mem32_read(cur_target, srch_buf, addr, buf_siz)) {
+	size_t carried = 0;
+	for (uint32_t addr = ram_start; addr < ram_end;) {
+		const uint32_t len = MIN(RTT_SEARCH_CHUNK, ram_end - addr);
+		if (target_mem32_read(cur_target, rtt_search_buf + carried, addr, len)) {
 			gdb_outf("rtt: read fail at 0x%" PRIx32 "\r\n", addr);
+			carried = 0;
+			addr += len;
 			continue;
 		}
-		for (uint32_t offset = 0; offset + srch_str_len + 1U < buf_siz; offset++) {
-			if (strncmp((const char *)(srch_buf + offset), srch_str, srch_str_len) == 0)
-				return addr + offset;
+
+		/* the buffer now holds target memory from addr - carried up to addr + len */
+		const size_t total = carried + len;
+		if (total >= ident_len) {
+			const uint8_t *const scan_end = rtt_search_buf + total - ident_len + 1U;
+			for (const uint8_t *match = rtt_search_buf; match < scan_end; ++match) {
+				match = rtt_find_char(match, scan_end, (uint8_t)ident[0]);
+				if (!match)
+					break;
+				if (memcmp(match, ident, ident_len) == 0)
+					return addr - carried + (uint32_t)(match - rtt_search_buf);
+			}
 		}
+
+		carried = MIN(ident_len - 1U, total);
+		memmove(rtt_search_buf, rtt_search_buf + total - carried, carried);
+		addr += len;
+	}
+	/* no match */
+	return 0;
+}
+
+/*
+ * Search a range a memory map policy run at a time, skipping what a bulk read shouldn't go near: anything
+ * known to fault or stall, anything needing the core halted when we aren't halting it, and unless it's a range
+ * we were explicitly given, anything that isn't known to be safe to read.
+ */
+static uint32_t rtt_search_policy(target_s *const cur_target, const uint32_t start, const uint32_t end,
+	const char *const ident, const size_t ident_len, const bool explicit_range)
+{
+	for (uint32_t addr = start; addr < end;) {
+		target_addr64_t run_end = 0U;
+		const uint8_t policy = target_mem_policy(cur_target, addr, &run_end);
+		const uint32_t stop = (uint32_t)MIN(run_end, (target_addr64_t)end);
+		if (!(policy & TARGET_MEM_AVOID) && (rtt_halt || !(policy & TARGET_MEM_NEEDS_HALT)) &&
+			(explicit_range || (policy & TARGET_MEM_READ_SAFE))) {
+			const uint32_t cbaddr = rtt_search(cur_target, addr, stop, ident, ident_len);
+			if (cbaddr)
+				return cbaddr;
+		}
+		addr = stop;
 	}
 	return 0;
 }
@@ -185,24 +221,30 @@ static void find_rtt(target_s *const cur_target)
 		return;
 
 	rtt_cbaddr = 0;
-	if (!rtt_flag_ram) {
+	/* without an ident set, look for the standard one */
+	const char *const ident = rtt_ident[0] == 0 ? rtt_default_ident : rtt_ident;
+	const size_t ident_len = rtt_ident[0] == 0 ? sizeof(rtt_default_ident) : strlen(rtt_ident);
+	/* if GDB told us where the control block is, check there first and only scan if it isn't */
+	if (rtt_cbaddr_hint) {
+		char ident_found[sizeof(rtt_default_ident)];
+		if (!target_mem32_read(cur_target, ident_found, rtt_cbaddr_hint, ident_len) &&
+			memcmp(ident_found, ident, ident_len) == 0)
+			rtt_cbaddr = rtt_cbaddr_hint;
+	}
+	if (rtt_cbaddr)
+		DEBUG_INFO("rtt: control block at symbol address\n");
+	else if (!rtt_flag_ram) {
 		/* search all of target ram */
 		for (const target_ram_s *r = cur_target->ram; r; r = r->next) {
 			const uint32_t ram_start = r->start;
 			const uint32_t ram_end = r->start + r->length;
-			if (rtt_ident[0] == 0)
-				rtt_cbaddr = fast_search(cur_target, ram_start, ram_end);
-			else
-				rtt_cbaddr = memory_search(cur_target, ram_start, ram_end);
+			rtt_cbaddr = rtt_search_policy(cur_target, ram_start, ram_end, ident, ident_len, false);
 			if (rtt_cbaddr)
 				break;
 		}
 	} else {
 		/* search  only given target address range */
-		if (rtt_ident[0] == 0)
-			rtt_cbaddr = fast_search(cur_target, rtt_ram_start, rtt_ram_end);
-		else
-			rtt_cbaddr = memory_search(cur_target, rtt_ram_start, rtt_ram_end);
+		rtt_cbaddr = rtt_search_policy(cur_target, rtt_ram_start, rtt_ram_end, ident, ident_len, true);
 	}
 
 	if (rtt_cbaddr) {
@@ -230,8 +272,11 @@ static void find_rtt(target_s *const cur_target)
 			return;
 		}
 
-		/* clear channel data */
+		/* clear channel data, then cache the channel descriptors so polling only needs their offsets */
 		memset(rtt_channel, 0, sizeof rtt_channel);
+		if (target_mem32_read(cur_target, rtt_channel, rtt_cbaddr + 24U,
+				sizeof(rtt_channel[0]) * (rtt_num_up_chan + rtt_num_down_chan)))
+			return;
 
 		/* auto channel: enable output channel 0, channel 1 and first input channel */
 		if (rtt_auto_channel) {
@@ -248,6 +293,7 @@ static void find_rtt(target_s *const cur_target)
 			return;
 
 		rtt_found = true;
+		rtt_revalidate = false;
 		DEBUG_INFO("rtt found\n");
 	}
 }
@@ -279,18 +325,27 @@ static rtt_retval_e read_rtt(target_s *const cur_target, const uint32_t i)
 	if (rtt_channel[i].head >= rtt_channel[i].buf_size || rtt_channel[i].tail >= rtt_channel[i].buf_size)
 		return RTT_ERR;
 
-	/* write recv_buf to target rtt 'down' buf */
+	/*
+	 * Write what the host has to the target rtt 'down' buf a chunk at a time. Each chunk fills the free
+	 * space from the head up to the slot before the tail, or up to the end of the buffer if that comes first.
+	 */
 	while (true) {
-		const uint32_t next_head = (rtt_channel[i].head + 1U) % rtt_channel[i].buf_size;
-		if (rtt_channel[i].tail == next_head)
-			break;
-		const int ch = rtt_getchar(channel);
-		if (ch == -1)
+		rtt_channel_s *const down = &rtt_channel[i];
+		const uint32_t limit = down->tail > down->head ? down->tail - 1U : down->buf_size - (down->tail ? 0U : 1U);
+		uint8_t chunk[64U];
+		uint32_t len = 0;
+		while (len < sizeof(chunk) && down->head + len < limit) {
+			const int ch = rtt_getchar(channel);
+			if (ch == -1)
+				break;
+			chunk[len++] = (uint8_t)ch;
+		}
+		if (!len)
 			break;
-		if (target_mem32_write(cur_target, rtt_channel[i].buf_addr + rtt_channel[i].head, &ch, 1))
+		if (target_mem32_write(cur_target, down->buf_addr + down->head, chunk, len))
 			return RTT_ERR;
 		/* advance head pointer */
-		rtt_channel[i].head = next_head;
+		down->head = (down->head + len) % down->buf_size;
 	}
 
 	/* update head of target 'down' buffer */
@@ -372,6 +427,96 @@ static rtt_retval_e print_rtt(target_s *const cur_target, const uint32_t i)
 	return RTT_OK;
 }
 
+/* Read one run of ranges (sorted by address) as a single span, then hand each range's data to its channel */
+static bool print_rtt_span(target_s *const cur_target, const rtt_range_s *const ranges, const size_t count)
+{
+	const uint32_t span_start = ranges[0].addr;
+	uint32_t span_end = span_start;
+	for (size_t idx = 0; idx < count; ++idx)
+		span_end = MAX(span_end, ranges[idx].addr + ranges[idx].len);
+	if (rtt_aligned_mem_read(cur_target, xmit_buf, span_start, span_end - span_start))
+		return false;
+
+	for (size_t idx = 0; idx < count; ++idx) {
+		const rtt_range_s *const range = &ranges[idx];
+		rtt_channel_s *const channel = &rtt_channel[range->channel];
+		rtt_write(range->channel, xmit_buf + (range->addr - span_start), range->len);
+		channel->tail = (channel->tail + range->len) % channel->buf_size;
+	}
+	return true;
+}
+
+/*
+ * Poll all the enabled up channels at once. Each channel's pending data makes up to two
+ * ranges - from the read offset to the write offset or the end of the buffer, then what has
+ * wrapped round to the start. Those are gathered across channels, sorted and merged into as
+ * few target reads as possible, and the data split back out to the channels afterwards.
+ */
+static rtt_retval_e print_rtt_coalesced(target_s *const cur_target)
+{
+	static rtt_range_s ranges[MAX_RTT_CHAN];
+	rtt_retval_e result = RTT_IDLE;
+	uint32_t channels_read = 0;
+	bool read_failed = false;
+
+	/* Doing the wrapped parts in a second pass keeps each channel's data in order */
+	for (uint32_t pass = 0; pass < 2U && !read_failed; ++pass) {
+		size_t count = 0;
+		for (uint32_t i = 0; i < rtt_num_up_chan; i++) {
+			const rtt_channel_s *const channel = &rtt_channel[i];
+			if (!rtt_channel_enabled[i] || channel->buf_addr == 0 || channel->buf_size == 0)
+				continue;
+			if (channel->head >= channel->buf_size || channel->tail >= channel->buf_size) {
+				result = RTT_ERR;
+				continue;
+			}
+			if (channel->head == channel->tail)
+				continue;
+			const uint32_t end = channel->tail > channel->head ? channel->buf_size : channel->head;
+			rtt_range_s range = {
+				.addr = channel->buf_addr + channel->tail,
+				.len = MIN(end - channel->tail, RTT_COALESCE_MAX),
+				.channel = i,
+			};
+			/* insert the range in address order */
+			size_t idx = count++;
+			for (; idx && ranges[idx - 1U].addr > range.addr; --idx)
+				ranges[idx] = ranges[idx - 1U];
+			ranges[idx] = range;
+			channels_read |= 1U << i;
+		}
+
+		for (size_t first = 0; first < count;) {
+			/* extend the span over following ranges while they're close enough and it still fits xmit_buf */
+			uint32_t span_end = ranges[first].addr + ranges[first].len;
+			size_t last = first + 1U;
+			for (; last < count && ranges[last].addr <= span_end + RTT_COALESCE_GAP; ++last) {
+				const uint32_t range_end = MAX(span_end, ranges[last].addr + ranges[last].len);
+				if (range_end - ranges[first].addr > RTT_COALESCE_MAX)
+					break;
+				span_end = range_end;
+			}
+			if (!print_rtt_span(cur_target, ranges + first, last - first)) {
+				read_failed = true;
+				break;
+			}
+			first = last;
+		}
+	}
+
+	/* update tails of the target 'up' buffers that were read from */
+	for (uint32_t i = 0; i < rtt_num_up_chan; i++) {
+		if (!(channels_read & (1U << i)))
+			continue;
+		const uint32_t tail_addr = rtt_cbaddr + 24U + i * 24U + 16U;
+		if (target_mem32_write(cur_target, tail_addr, &rtt_channel[i].tail, sizeof(rtt_channel[i].tail)))
+			return RTT_ERR;
+		if (result == RTT_IDLE)
+			result = RTT_OK;
+	}
+	return read_failed ? RTT_ERR : result;
+}
+
 /*********************************************************************
 *
 *       rtt top level
@@ -379,6 +524,42 @@ static rtt_retval_e print_rtt(target_s *const cur_target, const uint32_t i)
 **********************************************************************
 */
 
+/*
+ * Refresh the WrOff/RdOff pairs of the enabled channels from the target.
+ * The rest of each descriptor is static, so rather than re-read it, this does one
+ * read spanning from the first enabled channel's WrOff to the last one's RdOff.
+ */
+static bool rtt_read_offsets(target_s *const cur_target)
+{
+	const uint32_t num_chan = rtt_num_up_chan + rtt_num_down_chan;
+	uint32_t first = num_chan;
+	uint32_t last = 0;
+	for (uint32_t i = 0; i < num_chan; i++) {
+		if (!rtt_channel_enabled[i])
+			continue;
+		if (first == num_chan)
+			first = i;
+		last = i;
+	}
+	/* nothing enabled, nothing to read */
+	if (first == num_chan)
+		return true;
+
+	const size_t chan_words = sizeof(rtt_channel_s) / sizeof(uint32_t);
+	const size_t span_words = (last - first) * chan_words + 2U;
+	const uint32_t span_addr = rtt_cbaddr + 24U + first * sizeof(rtt_channel_s) + offsetof(rtt_channel_s, head);
+	if (target_mem32_read(cur_target, rtt_offsets, span_addr, span_words * sizeof(uint32_t)))
+		return false;
+
+	for (uint32_t i = first; i <= last; i++) {
+		if (!rtt_channel_enabled[i])
+			continue;
+		rtt_channel[i].head = rtt_offsets[(i - first) * chan_words];
+		rtt_channel[i].tail = rtt_offsets[(i - first) * chan_words + 1U];
+	}
+	return true;
+}
+
 void poll_rtt(target_s *const cur_target)
 {
 	/* rtt off */
@@ -389,6 +570,7 @@ void poll_rtt(target_s *const cur_target)
 	uint32_t now = platform_time_ms();
 
 	if (last_poll_ms + rtt_poll_ms <= now || now < last_poll_ms) {
+		const uint32_t start = stats_timestamp();
 		if (!rtt_found)
 			/* check if target needs to be halted during memory access */
 			rtt_halt = target_mem_access_needs_halt(cur_target);
@@ -410,7 +592,12 @@ void poll_rtt(target_s *const cur_target)
 			/* find rtt control block in target memory */
 			find_rtt(cur_target);
 
-		if (rtt_found) {
+		/*
+		 * While data is flowing only the channel offsets get polled. Once things go quiet,
+		 * re-check the control block header and re-read the descriptors in case the target
+		 * was reset or reconfigured its buffers.
+		 */
+		if (rtt_found && rtt_revalidate) {
 			uint32_t cblock_header[6]; // first 24 bytes of control block
 			/* check control block not changed or corrupted */
 			if (target_mem32_read(cur_target, cblock_header, rtt_cbaddr, sizeof(cblock_header)) ||
@@ -420,20 +607,40 @@ void poll_rtt(target_s *const cur_target)
 
 		bool rtt_err = false;
 		bool rtt_busy = false;
+		/* shortest time until an up channel would be half full, at the rate it last filled */
+		uint32_t fill_poll_ms = UINT32_MAX;
+		const uint32_t elapsed_ms = last_poll_ms ? MAX(now - last_poll_ms, 1U) : rtt_poll_ms;
 		/* do rtt i/o if control block found */
 		if (rtt_found && rtt_cbaddr) {
-			/* copy control block from target */
-			uint32_t rtt_cblock_size = sizeof(rtt_channel[0]) * (rtt_num_up_chan + rtt_num_down_chan);
-			if (target_mem32_read(cur_target, rtt_channel, rtt_cbaddr + 24U, rtt_cblock_size)) {
+			bool read_ok;
+			if (rtt_revalidate) {
+				/* copy channel descriptors from target */
+				uint32_t rtt_cblock_size = sizeof(rtt_channel[0]) * (rtt_num_up_chan + rtt_num_down_chan);
+				read_ok = !target_mem32_read(cur_target, rtt_channel, rtt_cbaddr + 24U, rtt_cblock_size);
+			} else
+				read_ok = rtt_read_offsets(cur_target);
+			if (!read_ok) {
 				gdb_outf("rtt: read fail at 0x%" PRIx32 "\r\n", rtt_cbaddr + 24U);
 				rtt_err = true;
 			} else {
 				for (uint32_t i = 0; i < rtt_num_up_chan + rtt_num_down_chan; i++) {
 					if (rtt_channel_enabled[i]) {
 						rtt_retval_e result;
-						if (i < rtt_num_up_chan)
+						if (i < rtt_num_up_chan) {
+							const rtt_channel_s *const channel = &rtt_channel[i];
+							if (channel->head < channel->buf_size && channel->tail < channel->buf_size &&
+								channel->head != channel->tail) {
+								const uint32_t pending =
+									(channel->head + channel->buf_size - channel->tail) % channel->buf_size;
+								const uint32_t half_fill_ms =
+									(uint32_t)(((uint64_t)elapsed_ms * (channel->buf_size / 2U)) / pending);
+								fill_poll_ms = MIN(fill_poll_ms, half_fill_ms);
+							}
+							/* with coalescing, the up channels are all read together below */
+							if (rtt_flag_coalesce)
+								continue;
 							result = print_rtt(cur_target, i); /* rtt from target to host */
-						else {
+						} else {
 							/* rtt from host to target */
 							rtt_flag_skip = rtt_channel[i].flag == 0;
 							rtt_flag_block = rtt_channel[i].flag == 2U;
@@ -445,6 +652,14 @@ void poll_rtt(target_s *const cur_target)
 							rtt_err = true;
 					}
 				}
+				if (rtt_flag_coalesce) {
+					/* rtt from target to host, all up channels at once */
+					const rtt_retval_e result = print_rtt_coalesced(cur_target);
+					if (result == RTT_OK)
+						rtt_busy = true;
+					else if (result == RTT_ERR)
+						rtt_err = true;
+				}
 			}
 		}
 
@@ -455,11 +670,16 @@ void poll_rtt(target_s *const cur_target)
 		/* update last poll time */
 		last_poll_ms = now;
 
-		/* rtt polling frequency goes up and down with rtt activity */
+		/*
+		 * rtt polling frequency goes up and down with rtt activity. While data is flowing, poll
+		 * at least often enough that the busiest up channel is drained before it gets half full.
+		 */
 		if (rtt_busy && !rtt_err)
-			rtt_poll_ms /= 2U;
+			rtt_poll_ms = MIN(rtt_poll_ms / 2U, fill_poll_ms);
 		else
 			rtt_poll_ms *= 2U;
+		/* quiet or failing polls re-check the control block next time around */
+		rtt_revalidate = !rtt_busy || rtt_err;
 
 		if (rtt_poll_ms > rtt_max_poll_ms)
 			rtt_poll_ms = rtt_max_poll_ms;
@@ -474,5 +694,6 @@ void poll_rtt(target_s *const cur_target)
 				rtt_enabled = false;
 			}
 		}
+		stats_record(STATS_RTT_POLL, start);
 	}
 }
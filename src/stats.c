@@ -0,0 +1,132 @@
+/*
+ * This file is part of the Black Magic Debug project.
+ *
+ * Copyright (C) 2026 1BitSquared <info@1bitsquared.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * This file implements a small set of always-on counters and timers for the hot paths through the
+ * GDB server, the SWD link, target memory access, the Flash drivers and RTT, so it's possible to tell
+ * where the time in a slow session actually goes.
+ *
+ * The time base is a monotonic microsecond clock in BMDA. On the firmware it is the probe's own DWT
+ * cycle counter where the probe's core has one, and the millisecond system tick otherwise.
+ */
+
+#include "general.h"
+#include "gdb_packet.h"
+#include "stats.h"
+
+#if CONFIG_BMDA == 1
+#include <time.h>
+#define STATS_TIME_UNIT "us"
+#elif defined(__ARM_ARCH_7M__) || defined(__ARM_ARCH_7EM__)
+#define STATS_USE_CYCCNT
+#define STATS_TIME_UNIT "cycles"
+
+#define STATS_DEMCR              (*(volatile uint32_t *)0xe000edfcU)
+#define STATS_DEMCR_TRCENA       (1U << 24U)
+#define STATS_DWT_CTRL           (*(volatile uint32_t *)0xe0001000U)
+#define STATS_DWT_CTRL_CYCCNTENA (1U << 0U)
+#define STATS_DWT_CYCCNT         (*(volatile uint32_t *)0xe0001004U)
+
+static bool stats_cyccnt_running = false;
+#else
+#define STATS_TIME_UNIT "ms"
+#endif
+
+typedef struct stats_counter {
+	uint32_t count;
+	uint32_t max;
+	uint64_t total;
+} stats_counter_s;
+
+static const char *const stats_names[STATS_COUNT] = {
+	[STATS_GDB_RX] = "gdb_rx",
+	[STATS_GDB_TX] = "gdb_tx",
+	[STATS_SWD_ACCESS] = "swd_access",
+	[STATS_SWD_WAIT] = "swd_wait",
+	[STATS_SWD_FAULT] = "swd_fault",
+	[STATS_SWD_NO_RESPONSE] = "swd_no_response",
+	[STATS_MEM_READ] = "mem_read",
+	[STATS_MEM_READ_BYTES] = "mem_read_bytes",
+	[STATS_FLASH_PREPARE] = "flash_prepare",
+	[STATS_FLASH_ERASE] = "flash_erase",
+	[STATS_FLASH_WRITE] = "flash_write",
+	[STATS_FLASH_DONE] = "flash_done",
+	[STATS_FLASH_WAIT] = "flash_wait",
+	[STATS_FLASH_HOST] = "flash_host",
+	[STATS_FLASH_BYTES_WRITTEN] = "flash_bytes_written",
+	[STATS_FLASH_BYTES_SKIPPED] = "flash_bytes_skipped",
+	[STATS_RTT_POLL] = "rtt_poll",
+};
+
+static stats_counter_s stats_counters[STATS_COUNT];
+
+uint32_t stats_timestamp(void)
+{
+#if CONFIG_BMDA == 1
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (uint32_t)(((uint64_t)now.tv_sec * 1000000U) + ((uint64_t)now.tv_nsec / 1000U));
+#elif defined(STATS_USE_CYCCNT)
+	/* Start the cycle counter the first time it's needed */
+	if (!stats_cyccnt_running) {
+		STATS_DEMCR |= STATS_DEMCR_TRCENA;
+		STATS_DWT_CYCCNT = 0U;
+		STATS_DWT_CTRL |= STATS_DWT_CTRL_CYCCNTENA;
+		stats_cyccnt_running = true;
+	}
+	return STATS_DWT_CYCCNT;
+#else
+	return platform_time_ms();
+#endif
+}
+
+void stats_event(const stats_id_e id, const uint32_t amount)
+{
+	stats_counters[id].count += amount;
+}
+
+void stats_record(const stats_id_e id, const uint32_t start)
+{
+	/* Unsigned subtraction keeps this right across the time base wrapping */
+	const uint32_t elapsed = stats_timestamp() - start;
+	stats_counter_s *const counter = &stats_counters[id];
+	++counter->count;
+	counter->total += elapsed;
+	counter->max = MAX(counter->max, elapsed);
+}
+
+void stats_reset(void)
+{
+	memset(stats_counters, 0, sizeof(stats_counters));
+}
+
+void stats_dump(void)
+{
+	gdb_out("Time unit: " STATS_TIME_UNIT "\n");
+	for (size_t idx = 0U; idx < STATS_COUNT; ++idx) {
+		const stats_counter_s *const counter = &stats_counters[idx];
+		/* Totals are kept in 64 bits but reported saturated to 32 */
+		if (counter->total)
+			gdb_outf("stats %s count=%" PRIu32 " total=%" PRIu32 " max=%" PRIu32 " avg=%" PRIu32 "\n",
+				stats_names[idx], counter->count, (uint32_t)MIN(counter->total, UINT32_MAX), counter->max,
+				(uint32_t)(counter->total / counter->count));
+		else
+			gdb_outf("stats %s count=%" PRIu32 "\n", stats_names[idx], counter->count);
+	}
+}
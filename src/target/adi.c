@@ -472,6 +472,16 @@ static bool adi_configure_mem_ap(adiv5_access_port_s *const ap)
 		return false;
 	}
 
+	/*
+	 * Packed transfers are an optional MEM-AP feature, so ask for them with byte sized accesses and see if the
+	 * CSW holds on to the request. The CSW gets rewritten by the next memory access set up regardless.
+	 */
+	adiv5_ap_write(ap, ADIV5_AP_CSW, ap->csw | ADIV5_AP_CSW_ADDRINC_PACKED | ADIV5_AP_CSW_SIZE_BYTE);
+	const uint32_t csw = adiv5_ap_read(ap, ADIV5_AP_CSW);
+	if ((csw & (ADIV5_AP_CSW_ADDRINC_MASK | ADIV5_AP_CSW_SIZE_MASK)) ==
+		(ADIV5_AP_CSW_ADDRINC_PACKED | ADIV5_AP_CSW_SIZE_BYTE))
+		ap->flags |= ADIV5_AP_FLAGS_PACKED;
+
 	return true;
 }
 
@@ -510,10 +520,11 @@ void adi_ap_resume_cores(adiv5_access_port_s *const ap)
 	}
 }
 
-/* Program the CSW and TAR for sequential access at a given width */
-void adi_ap_mem_access_setup(adiv5_access_port_s *const ap, const target_addr64_t addr, const align_e align)
+/* Program the CSW and TAR for sequential access at a given width, with the given address increment mode */
+static void adi_ap_mem_access_csw_setup(
+	adiv5_access_port_s *const ap, const target_addr64_t addr, const align_e align, const uint32_t addrinc)
 {
-	uint32_t csw = ap->csw | ADIV5_AP_CSW_ADDRINC_SINGLE;
+	uint32_t csw = ap->csw | addrinc;
 
 	switch (align) {
 	case ALIGN_8BIT:
@@ -527,46 +538,96 @@ void adi_ap_mem_access_setup(adiv5_access_port_s *const ap, const target_addr64_
 		csw |= ADIV5_AP_CSW_SIZE_WORD;
 		break;
 	}
-	/* Select AP bank 0 and write CSW */
-	adiv5_ap_write(ap, ADIV5_AP_CSW, csw);
-	/* Then write TAR which is in the same AP bank */
-	if (ap->flags & ADIV5_AP_FLAGS_64BIT)
-		adiv5_dp_write(ap->dp, ADIV5_AP_TAR_HIGH, (uint32_t)(addr >> 32U));
-	adiv5_dp_write(ap->dp, ADIV5_AP_TAR_LOW, (uint32_t)addr);
+	adiv5_debug_port_s *const dp = ap->dp;
+	/* Select AP bank 0 and write CSW, unless the shadows say it already holds this value */
+	if (dp->shadowing)
+		adi_ap_select(ap, ADIV5_AP_CSW);
+	if (!adiv5_dp_shadowed(dp, ADIV5_SHADOW_CSW) || dp->csw_shadow != csw)
+		adiv5_ap_write(ap, ADIV5_AP_CSW, csw);
+	/* Then write TAR which is in the same AP bank, again only the halves that differ from the shadow */
+	const bool tar_shadowed = adiv5_dp_shadowed(dp, ADIV5_SHADOW_TAR);
+	if ((ap->flags & ADIV5_AP_FLAGS_64BIT) && (!tar_shadowed || (dp->tar_shadow >> 32U) != (addr >> 32U)))
+		adiv5_dp_write(dp, ADIV5_AP_TAR_HIGH, (uint32_t)(addr >> 32U));
+	if (!tar_shadowed || (uint32_t)dp->tar_shadow != (uint32_t)addr)
+		adiv5_dp_write(dp, ADIV5_AP_TAR_LOW, (uint32_t)addr);
+	adiv5_dp_shadow_mem(dp, csw, addr);
 }
 
-void adi_ap_banked_access_setup(adiv5_access_port_s *base_ap)
+void adi_ap_mem_access_setup(adiv5_access_port_s *const ap, const target_addr64_t addr, const align_e align)
+{
+	adi_ap_mem_access_csw_setup(ap, addr, align, ADIV5_AP_CSW_ADDRINC_SINGLE);
+}
+
+void adi_ap_mem_access_setup_packed(adiv5_access_port_s *const ap, const target_addr64_t addr, const align_e align)
+{
+	adi_ap_mem_access_csw_setup(ap, addr, align, ADIV5_AP_CSW_ADDRINC_PACKED);
+}
+
+/* Point SELECT (and SELECT1 on ADIv6) at the AP register bank holding addr, skipping writes the shadows make moot */
+void adi_ap_select(adiv5_access_port_s *const base_ap, const uint16_t addr)
 {
+	adiv5_debug_port_s *const dp = base_ap->dp;
 	/* Check which ADI version this is for, v5 only requires we set up the DP's SELECT register */
-	if (base_ap->dp->version <= 2U)
-		/* Configure the bank selection to the appropriate AP register bank */
-		adiv5_dp_write(base_ap->dp, ADIV5_DP_SELECT, ((uint32_t)base_ap->apsel << 24U) | (ADIV5_AP_DB(0) & 0x00f0U));
-	else {
+	if (dp->version <= 2U) {
+		const uint32_t select = ((uint32_t)base_ap->apsel << 24U) | (addr & 0x00f0U);
+		if (!adiv5_dp_shadowed(dp, ADIV5_SHADOW_SELECT) || dp->select_shadow != select)
+			adiv5_dp_write(dp, ADIV5_DP_SELECT, select);
+	} else {
 		/* ADIv6 requires we set up the DP's SELECT1 and SELECT registers to correctly acccess the AP */
-		adiv6_access_port_s *const ap = (adiv6_access_port_s *)base_ap;
+		uint32_t select1 = 0U;
+		uint32_t select = 0U;
+		const uint8_t writes = adi_ap_select_writes(base_ap, addr, &select1, &select);
 		/* Set SELECT1 in the DP up first */
-		adiv5_dp_write(base_ap->dp, ADIV5_DP_SELECT, ADIV5_DP_BANK5);
-		adiv5_dp_write(base_ap->dp, ADIV6_DP_SELECT1, (uint32_t)(ap->ap_address >> 32U));
+		if (writes & ADIV5_SHADOW_SELECT1) {
+			adiv5_dp_write(dp, ADIV5_DP_SELECT, ADIV5_DP_BANK5);
+			adiv5_dp_write(dp, ADIV6_DP_SELECT1, select1);
+		}
 		/* Now set up SELECT in the DP */
-		adiv5_dp_write(base_ap->dp, ADIV5_DP_SELECT, (uint32_t)ap->ap_address | (ADIV5_AP_DB(0) & ADIV6_AP_BANK_MASK));
+		if (writes & ADIV5_SHADOW_SELECT)
+			adiv5_dp_write(dp, ADIV5_DP_SELECT, select);
 	}
 }
 
-static uint32_t adi_ap_read_id(adiv5_access_port_s *ap, uint32_t addr)
+uint8_t adi_ap_select_writes(
+	const adiv5_access_port_s *const base_ap, const uint16_t addr, uint32_t *const select1, uint32_t *const select)
+{
+	const adiv5_debug_port_s *const dp = base_ap->dp;
+	const adiv6_access_port_s *const ap = (const adiv6_access_port_s *)base_ap;
+	*select1 = (uint32_t)(ap->ap_address >> 32U);
+	*select = (uint32_t)ap->ap_address | (addr & ADIV6_AP_BANK_MASK);
+	/* Getting at SELECT1 means pointing SELECT at DP bank 5, so SELECT then has to be written regardless */
+	if (!adiv5_dp_shadowed(dp, ADIV5_SHADOW_SELECT1) || dp->select1_shadow != *select1)
+		return ADIV5_SHADOW_SELECT1 | ADIV5_SHADOW_SELECT;
+	if (!adiv5_dp_shadowed(dp, ADIV5_SHADOW_SELECT) || dp->select_shadow != *select)
+		return ADIV5_SHADOW_SELECT;
+	return 0U;
+}
+
+void adi_ap_banked_access_setup(adiv5_access_port_s *base_ap)
+{
+	/* Configure the bank selection to the appropriate AP register bank */
+	adi_ap_select(base_ap, ADIV5_AP_DB(0));
+}
+
+/* Reassemble a 32-bit ID value from the low bytes of the 4 consecutive ID registers it's split across */
+static uint32_t adi_unpack_id(const uint8_t *const data)
 {
 	uint32_t res = 0;
-	uint8_t data[16];
-	adiv5_mem_read(ap, data, addr, sizeof(data));
 	for (size_t i = 0; i < 4U; ++i)
 		res |= (uint32_t)data[4U * i] << (i * 8U);
 	return res;
 }
 
-static uint64_t adi_ap_read_pidr(adiv5_access_port_s *ap, uint32_t addr)
+/*
+ * PIDR4-7, PIDR0-3 and CIDR0-3 are contiguous at the top of every component's 4KiB block,
+ * so read them all in one block access and return the CIDR, handing back the PIDR via pidr
+ */
+static uint32_t adi_ap_read_ids(adiv5_access_port_s *const ap, const target_addr64_t base_address, uint64_t *const pidr)
 {
-	const uint32_t pidr_upper = adi_ap_read_id(ap, addr + PIDR4_OFFSET);
-	const uint32_t pidr_lower = adi_ap_read_id(ap, addr + PIDR0_OFFSET);
-	return ((uint64_t)pidr_upper << 32U) | (uint64_t)pidr_lower;
+	uint8_t data[48];
+	adiv5_mem_read(ap, data, base_address + PIDR4_OFFSET, sizeof(data));
+	*pidr = ((uint64_t)adi_unpack_id(data) << 32U) | (uint64_t)adi_unpack_id(data + 16U);
+	return adi_unpack_id(data + 32U);
 }
 
 uint32_t adi_mem_read32(adiv5_access_port_s *const ap, const target_addr32_t addr)
@@ -638,6 +699,9 @@ static void adi_parse_adi_rom_table(adiv5_access_port_s *const ap, const target_
 
 		/* Probe recursively */
 		adi_ap_component_probe(ap, base_address + (entry & ADI_ROM_ROMENTRY_OFFSET), recursion_depth + 1U, i);
+		/* If that turned up the AP's Cortex-M core, the rest of the table is only trace and debug support blocks */
+		if (ap->flags & ADIV5_AP_FLAGS_HAS_CORTEXM)
+			break;
 	}
 	DEBUG_INFO("%sROM Table: END\n", indent);
 }
@@ -770,11 +834,66 @@ static void adi_parse_coresight_v0_rom_table(adiv5_access_port_s *const ap, cons
 
 		/* Now recursively probe the component */
 		adi_ap_component_probe(ap, base_address + offset, recursion_depth + 1U, index);
+		/* If that turned up the AP's Cortex-M core, the rest of the table is only trace and debug support blocks */
+		if (ap->flags & ADIV5_AP_FLAGS_HAS_CORTEXM)
+			break;
 	}
 
 	DEBUG_INFO("%sROM Table: END\n", indent);
 }
 
+target_addr32_t adi_ap_find_component(adiv5_access_port_s *const ap, const target_addr32_t base_address,
+	const uint16_t part_number, const size_t recursion)
+{
+	uint64_t pidr = 0U;
+	const uint32_t cidr = adi_ap_read_ids(ap, base_address, &pidr);
+	if (adiv5_dp_error(ap->dp) || (cidr & ~CID_CLASS_MASK) != CID_PREAMBLE)
+		return 0U;
+
+	const uint8_t cid_class = (cidr & CID_CLASS_MASK) >> CID_CLASS_SHIFT;
+	if (cid_class != cidc_romtab) {
+		const uint16_t designer_code = adi_designer_from_pidr(pidr);
+		return designer_code == JEP106_MANUFACTURER_ARM && (pidr & PIDR_PN_MASK) == part_number ? base_address : 0U;
+	}
+	/* Guard against a malformed table referring back to itself */
+	if (recursion > 3U)
+		return 0U;
+
+	for (uint32_t i = 0; i < 960U; i++) {
+		const uint32_t entry = adi_mem_read32(ap, base_address + i * 4U);
+		if (adiv5_dp_error(ap->dp) || entry == 0U)
+			break;
+		if (!(entry & ADI_ROM_ROMENTRY_PRESENT))
+			continue;
+		const target_addr32_t address = adi_ap_find_component(
+			ap, base_address + (entry & ADI_ROM_ROMENTRY_OFFSET), part_number, recursion + 1U);
+		if (address)
+			return address;
+	}
+	return 0U;
+}
+
+/*
+ * TAR only has to auto-increment through its bottom 10 bits, but many MEM-APs carry further. Find out how far
+ * by reading the last word before each 1KiB boundary of the AP's base ROM table, where reads have no side
+ * effects, and checking whether TAR carried on into the next block. A ROM table is 4KiB, so stop there.
+ */
+static void adi_ap_probe_tar_wrap(adiv5_access_port_s *const ap, const target_addr64_t rom_table)
+{
+	adiv5_debug_port_s *const dp = ap->dp;
+	for (uint8_t bits = 0U; bits < ADIV5_AP_TAR_INC_BITS_MAX; ++bits) {
+		const target_addr64_t boundary = rom_table + (ADIV5_AP_TAR_WRAP_MIN << bits);
+		adi_ap_mem_access_setup(ap, boundary - 4U, ALIGN_32BIT);
+		adiv5_dp_read(dp, ADIV5_AP_DRW);
+		const uint32_t tar = adiv5_dp_read(dp, ADIV5_AP_TAR_LOW);
+		if (adiv5_dp_error(dp) || tar != (uint32_t)boundary)
+			break;
+		ap->tar_inc_bits = bits + 1U;
+	}
+	if (ap->tar_inc_bits)
+		DEBUG_INFO("AP %u: TAR auto-increments within %" PRIu32 " byte blocks\n", ap->apsel, adiv5_ap_tar_wrap(ap));
+}
+
 /* Return true if we find a debuggable device. */
 void adi_ap_component_probe(
 	adiv5_access_port_s *ap, target_addr64_t base_address, const size_t recursion, const uint32_t entry_number)
@@ -783,7 +902,8 @@ void adi_ap_component_probe(
 	(void)entry_number;
 #endif
 
-	const uint32_t cidr = adi_ap_read_id(ap, base_address + CIDR0_OFFSET);
+	uint64_t pidr = 0U;
+	const uint32_t cidr = adi_ap_read_ids(ap, base_address, &pidr);
 	if (ap->dp->fault) {
 		DEBUG_ERROR("Error reading CIDR on AP%u: %u\n", ap->apsel, ap->dp->fault);
 		return;
@@ -815,9 +935,6 @@ void adi_ap_component_probe(
 	/* Extract Component ID class nibble */
 	const uint8_t cid_class = (cidr & CID_CLASS_MASK) >> CID_CLASS_SHIFT;
 
-	/* Read out the peripheral ID register */
-	const uint64_t pidr = adi_ap_read_pidr(ap, base_address);
-
 	/* ROM table */
 	if (cid_class == cidc_romtab) {
 		/* Validate that the SIZE field is 0 per the spec */
@@ -825,6 +942,8 @@ void adi_ap_component_probe(
 			DEBUG_ERROR("Fault reading ROM table\n");
 			return;
 		}
+		if (base_address == ap->base)
+			adi_ap_probe_tar_wrap(ap, base_address);
 		adi_parse_adi_rom_table(ap, base_address, recursion, indent, pidr);
 	} else {
 		/* Extract the designer code from the part ID register */
@@ -847,9 +966,11 @@ void adi_ap_component_probe(
 		uint8_t dev_type = 0;
 		uint16_t arch_id = 0;
 		if (cid_class == cidc_dc) {
-			/* Read out the component's identification information */
-			const uint32_t devarch = adi_mem_read32(ap, base_address + CORESIGHT_ROM_DEVARCH);
-			dev_type = adi_mem_read32(ap, base_address + CORESIGHT_ROM_DEVTYPE) & DEVTYPE_MASK;
+			/* Read out the component's identification information, DEVARCH through DEVTYPE, in one go */
+			uint32_t devarch_devtype[5];
+			adiv5_mem_read(ap, devarch_devtype, base_address + CORESIGHT_ROM_DEVARCH, sizeof(devarch_devtype));
+			const uint32_t devarch = devarch_devtype[0];
+			dev_type = devarch_devtype[4] & DEVTYPE_MASK;
 
 			if (devarch & DEVARCH_PRESENT)
 				arch_id = devarch & DEVARCH_ARCHID_MASK;
@@ -864,7 +985,9 @@ void adi_ap_component_probe(
 		switch (component->arch) {
 		case aa_cortexm:
 			DEBUG_INFO("%s-> cortexm_probe\n", indent + 1);
-			cortexm_probe(ap);
+			/* An AP can only present one Cortex-M PPB, so once we've found its core there's nothing more to walk */
+			if (cortexm_probe(ap))
+				ap->flags |= ADIV5_AP_FLAGS_HAS_CORTEXM;
 			break;
 		case aa_cortexa:
 			DEBUG_INFO("%s-> cortexa_probe\n", indent + 1);
@@ -878,8 +1001,11 @@ void adi_ap_component_probe(
 		case aa_rom_table:
 			if (pidr & PIDR_SIZE_MASK)
 				DEBUG_ERROR("Fault reading ROM table\n");
-			else
+			else {
+				if (base_address == ap->base)
+					adi_ap_probe_tar_wrap(ap, base_address);
 				adi_parse_coresight_v0_rom_table(ap, base_address, recursion, indent, pidr);
+			}
 			break;
 		default:
 			break;
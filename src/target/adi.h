@@ -39,11 +39,25 @@ uint32_t adi_mem_read32(adiv5_access_port_s *ap, target_addr32_t addr);
 /* Helper for probing a CoreSight debug component */
 void adi_ap_component_probe(
 	adiv5_access_port_s *ap, target_addr64_t base_address, size_t recursion, uint32_t entry_number);
+/*
+ * Helper for finding an ARM CoreSight component by part number in an AP's ROM tables, such as the trace
+ * blocks probe stops short of once it has found the core. Returns the component's base address, 0 if not found
+ */
+target_addr32_t adi_ap_find_component(
+	adiv5_access_port_s *ap, target_addr32_t base_address, uint16_t part_number, size_t recursion);
 /* Helper for resuming all cores halted on an AP during probe */
 void adi_ap_resume_cores(adiv5_access_port_s *ap);
 
 /* Helpers for setting up memory accesses and banked accesses */
 void adi_ap_mem_access_setup(adiv5_access_port_s *ap, target_addr64_t addr, align_e align);
+/* As above, but with packed transfers so each DRW access moves a whole word's worth of bytes or halfwords */
+void adi_ap_mem_access_setup_packed(adiv5_access_port_s *ap, target_addr64_t addr, align_e align);
+void adi_ap_select(adiv5_access_port_s *base_ap, uint16_t addr);
+/*
+ * Work out the SELECT1 and SELECT values that address the bank holding addr on an ADIv6 AP, returning which of
+ * ADIV5_SHADOW_SELECT1 and ADIV5_SHADOW_SELECT the DP's shadows say actually need writing to get there
+ */
+uint8_t adi_ap_select_writes(const adiv5_access_port_s *base_ap, uint16_t addr, uint32_t *select1, uint32_t *select);
 void adi_ap_banked_access_setup(adiv5_access_port_s *base_ap);
 
 /*
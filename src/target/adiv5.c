@@ -63,6 +63,9 @@
 #define S32K3xx_SDA_AP_DBGENCTR      ADIV5_AP_REG(0x80U)
 #define S32K3xx_SDA_AP_DBGENCTR_MASK 0x300000f0U
 
+/* Below this many bytes packed, switching the CSW over to packed transfers and back costs more than it saves */
+#define ADIV5_PACKED_MIN_LEN 8U
+
 void adiv5_ap_ref(adiv5_access_port_s *ap)
 {
 	if (ap->refcnt == 0)
@@ -346,10 +349,8 @@ static bool adiv5_power_cycle_aps(adiv5_debug_port_s *const dp)
 	platform_timeout_set(&timeout, 201);
 	/* Write request for system and debug power up */
 	adiv5_dp_write(dp, ADIV5_DP_CTRLSTAT, ADIV5_DP_CTRLSTAT_CSYSPWRUPREQ | ADIV5_DP_CTRLSTAT_CDBGPWRUPREQ);
-	/* Wait for acknowledge */
-	status = 0U;
-	while (status != (ADIV5_DP_CTRLSTAT_CSYSPWRUPACK | ADIV5_DP_CTRLSTAT_CDBGPWRUPACK)) {
-		platform_delay(10);
+	/* Wait for acknowledge, checking straight away as most parts give it within a few SWD clocks */
+	while (true) {
 		status =
 			adiv5_dp_read(dp, ADIV5_DP_CTRLSTAT) & (ADIV5_DP_CTRLSTAT_CSYSPWRUPACK | ADIV5_DP_CTRLSTAT_CDBGPWRUPACK);
 		if (status == (ADIV5_DP_CTRLSTAT_CSYSPWRUPACK | ADIV5_DP_CTRLSTAT_CDBGPWRUPACK))
@@ -358,8 +359,10 @@ static bool adiv5_power_cycle_aps(adiv5_debug_port_s *const dp)
 			DEBUG_WARN("adiv5: power-up failed\n");
 			return false;
 		}
+		platform_delay(1);
 	}
 	/* At this point due to the guaranteed power domain restart, the APs are all up and in their reset state. */
+	adiv5_dp_shadow_invalidate(dp);
 	return true;
 }
 
@@ -376,6 +379,9 @@ void adiv5_dp_init(adiv5_debug_port_s *const dp)
 #if CONFIG_BMDA == 1
 	bmda_adiv5_dp_init(dp);
 #endif
+	/* The register shadows can only be kept if nothing has replaced the generic AP and memory access routines */
+	dp->shadowing = dp->ap_write == adiv5_ap_reg_write && dp->mem_write == adiv5_mem_write_bytes;
+	adiv5_dp_shadow_invalidate(dp);
 
 	/*
 	 * Unless we've got an ARM SoC-400 JTAG-DP, which must be ADIv5 and so DPv0, we can safely assume
@@ -614,88 +620,234 @@ const void *adiv5_pack_data(
 	return (const uint8_t *)src + (1U << align);
 }
 
-void adiv5_mem_read_bytes(adiv5_access_port_s *const ap, void *dest, const target_addr64_t src, const size_t len)
+/*
+ * Work out how to split a byte or halfword transfer so its word aligned middle can go as packed transfers.
+ * Each packed DRW access then moves a whole word of lanes, in address order, and never straddles the TAR
+ * auto-increment boundary. The head and tail either side are left to individual accesses so nothing outside
+ * the requested range is touched. Returns false if packing isn't available or wouldn't pay for the extra CSW writes.
+ */
+static bool adiv5_mem_packed_split(const adiv5_access_port_s *const ap, const target_addr64_t addr, const size_t len,
+	const align_e align, size_t *const head, size_t *const body)
+{
+	if (align >= ALIGN_32BIT || !(ap->flags & ADIV5_AP_FLAGS_PACKED))
+		return false;
+	*head = (4U - (addr & 3U)) & 3U;
+	if (len < *head + ADIV5_PACKED_MIN_LEN)
+		return false;
+	*body = (len - *head) & ~(size_t)3U;
+	return true;
+}
+
+static void *adiv5_mem_read_run(adiv5_access_port_s *const ap, void *dest, const target_addr64_t src,
+	const size_t len, const align_e align, const bool packed)
 {
 	/* Do nothing and return if there's nothing to read */
 	if (len == 0U)
-		return;
+		return dest;
 	/* Calculate the extent of the transfer */
 	target_addr64_t begin = src;
 	const target_addr64_t end = begin + len;
-	/* Calculate the alignment of the transfer */
-	const align_e align = MIN_ALIGN(src, len);
+	/* Packed transfers fill all the byte lanes of each word read, so unpack those as a whole word */
+	const align_e lanes = packed ? ALIGN_32BIT : align;
 	/* Calculate how much each loop will increment the destination address by */
-	const uint8_t stride = 1U << align;
+	const uint8_t stride = 1U << lanes;
+	const uint32_t tar_wrap = adiv5_ap_tar_wrap(ap);
 	/* Set up the transfer */
-	adi_ap_mem_access_setup(ap, src, align);
-	/* Now loop through the data and move it 1 stride at a time to the target */
-	for (; begin < end; begin += stride) {
-		/*
-		 * Check if the address doesn't overflow the 10-bit auto increment bound for TAR,
-		 * if it's not the first transfer (offset == 0)
-		 */
-		if (begin != src && (begin & 0x000003ffU) == 0U) {
-			/* Update TAR to adjust the upper bits */
-			if (ap->flags & ADIV5_AP_FLAGS_64BIT)
-				adiv5_dp_write(ap->dp, ADIV5_AP_TAR_HIGH, (uint32_t)(begin >> 32));
-			adiv5_dp_write(ap->dp, ADIV5_AP_TAR_LOW, (uint32_t)begin);
+	if (packed)
+		adi_ap_mem_access_setup_packed(ap, src, align);
+	else
+		adi_ap_mem_access_setup(ap, src, align);
+	/* Now loop through the data, queueing up a batch of reads at a time so backends that can pipeline them get to */
+	while (begin < end) {
+		uint32_t values[ADIV5_TRANSFER_QUEUE_DEPTH];
+		const target_addr64_t batch = begin;
+		size_t reads = 0U;
+		for (; begin < end && reads < ADIV5_TRANSFER_QUEUE_DEPTH; begin += stride, ++reads) {
+			/*
+			 * Check if the address doesn't overflow the auto increment bound for TAR,
+			 * if it's not the first transfer (offset == 0)
+			 */
+			if (begin != src && (begin & (tar_wrap - 1U)) == 0U) {
+				/* Update TAR to adjust the upper bits */
+				if (ap->flags & ADIV5_AP_FLAGS_64BIT)
+					adiv5_dp_queue_write(ap->dp, ADIV5_AP_TAR_HIGH, (uint32_t)(begin >> 32));
+				adiv5_dp_queue_write(ap->dp, ADIV5_AP_TAR_LOW, (uint32_t)begin);
+			}
+			/* Queue up a read of the next chunk of data from the target */
+			adiv5_dp_queue_read(ap->dp, ADIV5_AP_DRW, &values[reads]);
 		}
-		/* Grab the next chunk of data from the target */
-		const uint32_t value = adiv5_dp_read(ap->dp, ADIV5_AP_DRW);
-		/* Unpack the data from the chunk */
-		dest = adiv5_unpack_data(dest, begin, value, align);
+		adiv5_dp_queue_flush(ap->dp);
+		/* Unpack the data from the chunks */
+		for (size_t idx = 0U; idx < reads; ++idx)
+			dest = adiv5_unpack_data(dest, batch + (idx * stride), values[idx], lanes);
 	}
+	/* TAR has now auto-incremented to just past the end of the transfer */
+	adiv5_dp_shadow_tar(ap->dp, end);
+	return dest;
 }
 
-void adiv5_mem_write_bytes(
-	adiv5_access_port_s *const ap, const target_addr64_t dest, const void *src, const size_t len, const align_e align)
+void adiv5_mem_read_bytes(adiv5_access_port_s *const ap, void *dest, const target_addr64_t src, const size_t len)
+{
+	/* Calculate the alignment of the transfer */
+	const align_e align = MIN_ALIGN(src, len);
+	size_t head = 0U;
+	size_t body = 0U;
+	/* If the AP can do packed transfers, use them for as much of a byte or halfword read as we can */
+	if (adiv5_mem_packed_split(ap, src, len, align, &head, &body)) {
+		dest = adiv5_mem_read_run(ap, dest, src, head, align, false);
+		dest = adiv5_mem_read_run(ap, dest, src + head, body, align, true);
+		adiv5_mem_read_run(ap, dest, src + head + body, len - head - body, align, false);
+	} else
+		adiv5_mem_read_run(ap, dest, src, len, align, false);
+}
+
+static const void *adiv5_mem_write_run(adiv5_access_port_s *const ap, const target_addr64_t dest, const void *src,
+	const size_t len, const align_e align, const bool packed)
 {
 	/* Do nothing and return if there's nothing to write */
 	if (len == 0U)
-		return;
+		return src;
 	/* Calculate the extent of the transfer */
 	target_addr64_t begin = dest;
 	const target_addr64_t end = begin + len;
+	/* Packed transfers take all the byte lanes of each word written, so pack those as a whole word */
+	const align_e lanes = packed ? ALIGN_32BIT : align;
 	/* Calculate how much each loop will increment the destination address by */
-	const uint8_t stride = 1U << align;
+	const uint8_t stride = 1U << lanes;
+	const uint32_t tar_wrap = adiv5_ap_tar_wrap(ap);
 	/* Set up the transfer */
-	adi_ap_mem_access_setup(ap, dest, align);
+	if (packed)
+		adi_ap_mem_access_setup_packed(ap, dest, align);
+	else
+		adi_ap_mem_access_setup(ap, dest, align);
 	/* Now loop through the data and move it 1 stride at a time to the target */
 	for (; begin < end; begin += stride) {
 		/*
-		 * Check if the address doesn't overflow the 10-bit auto increment bound for TAR,
+		 * Check if the address doesn't overflow the auto increment bound for TAR,
 		 * if it's not the first transfer (offset == 0)
 		 */
-		if (begin != dest && (begin & 0x000003ffU) == 0U) {
+		if (begin != dest && (begin & (tar_wrap - 1U)) == 0U) {
 			/* Update TAR to adjust the upper bits */
 			if (ap->flags & ADIV5_AP_FLAGS_64BIT)
-				adiv5_dp_write(ap->dp, ADIV5_AP_TAR_HIGH, (uint32_t)(begin >> 32));
-			adiv5_dp_write(ap->dp, ADIV5_AP_TAR_LOW, (uint32_t)begin);
+				adiv5_dp_queue_write(ap->dp, ADIV5_AP_TAR_HIGH, (uint32_t)(begin >> 32));
+			adiv5_dp_queue_write(ap->dp, ADIV5_AP_TAR_LOW, (uint32_t)begin);
 		}
 		/* Pack the data for transfer */
 		uint32_t value = 0;
-		src = adiv5_pack_data(begin, src, &value, align);
-		/* And copy the result to the target */
-		adiv5_dp_write(ap->dp, ADIV5_AP_DRW, value);
+		src = adiv5_pack_data(begin, src, &value, lanes);
+		/* And queue it up for the target, so backends that can batch writes get to */
+		adiv5_dp_queue_write(ap->dp, ADIV5_AP_DRW, value);
 	}
+	adiv5_dp_queue_flush(ap->dp);
+	/* TAR has now auto-incremented to just past the end of the transfer, for accesses of up to 32 bits */
+	if (align <= ALIGN_32BIT)
+		adiv5_dp_shadow_tar(ap->dp, end);
+	return src;
+}
+
+void adiv5_mem_write_bytes(
+	adiv5_access_port_s *const ap, const target_addr64_t dest, const void *src, const size_t len, const align_e align)
+{
+	/* Do nothing and return if there's nothing to write */
+	if (len == 0U)
+		return;
+	size_t head = 0U;
+	size_t body = 0U;
+	/* If the AP can do packed transfers, use them for as much of a byte or halfword write as we can */
+	if (adiv5_mem_packed_split(ap, dest, len, align, &head, &body)) {
+		src = adiv5_mem_write_run(ap, dest, src, head, align, false);
+		src = adiv5_mem_write_run(ap, dest + head, src, body, align, true);
+		adiv5_mem_write_run(ap, dest + head + body, src, len - head - body, align, false);
+	} else
+		adiv5_mem_write_run(ap, dest, src, len, align, false);
 	/* Make sure this write is complete by doing a dummy read */
 	adiv5_dp_read(ap->dp, ADIV5_DP_RDBUFF);
 }
 
+static void adiv5_ap_select(adiv5_access_port_s *const ap, const uint16_t addr)
+{
+	const uint32_t select = ((uint32_t)ap->apsel << 24U) | (addr & 0xf0U);
+	/* Skip the SELECT write entirely if the DP is known to already hold this value */
+	if (!adiv5_dp_shadowed(ap->dp, ADIV5_SHADOW_SELECT) || ap->dp->select_shadow != select)
+		adiv5_dp_recoverable_access(ap->dp, ADIV5_LOW_WRITE, ADIV5_DP_SELECT, select);
+}
+
 void adiv5_ap_reg_write(adiv5_access_port_s *ap, uint16_t addr, uint32_t value)
 {
-	adiv5_dp_recoverable_access(
-		ap->dp, ADIV5_LOW_WRITE, ADIV5_DP_SELECT, ((uint32_t)ap->apsel << 24U) | (addr & 0xf0U));
+	adiv5_ap_select(ap, addr);
 	adiv5_dp_write(ap->dp, addr, value);
 }
 
 uint32_t adiv5_ap_reg_read(adiv5_access_port_s *ap, uint16_t addr)
 {
-	adiv5_dp_recoverable_access(
-		ap->dp, ADIV5_LOW_WRITE, ADIV5_DP_SELECT, ((uint32_t)ap->apsel << 24U) | (addr & 0xf0U));
+	adiv5_ap_select(ap, addr);
 	return adiv5_dp_read(ap->dp, addr);
 }
 
+bool adiv5_dp_queue_flush(adiv5_debug_port_s *const dp)
+{
+	const size_t count = dp->transfer_count;
+	dp->transfer_count = 0U;
+	if (!count)
+		return true;
+
+	/* If the backend can batch the accesses, hand them all over in one go */
+	if (dp->transfers) {
+		/* The batch goes around the wrappers, so drop the shadows it's going to disturb as they would have */
+		for (size_t idx = 0; idx < count; ++idx) {
+			const adiv5_transfer_s *const transfer = &dp->transfer_queue[idx];
+			adiv5_dp_shadow_access(dp, transfer->rnw, transfer->addr, transfer->value);
+		}
+		const bool result = dp->transfers(dp, dp->transfer_queue, count);
+		/*
+		 * A failed batch has been through error recovery, and on ADIv6 the CTRL/STAT writes some backends
+		 * bracket a batch with can end up in SELECT1, so in either case trust none of the shadows
+		 */
+		if (!result || dp->version >= 3U)
+			adiv5_dp_shadow_invalidate(dp);
+		for (size_t idx = 0; idx < count; ++idx) {
+			const adiv5_transfer_s *const transfer = &dp->transfer_queue[idx];
+			/* Make sure a failed batch doesn't leave the caller with garbage */
+			if (!result && transfer->rnw == ADIV5_LOW_READ)
+				*transfer->result = 0U;
+#ifndef DEBUG_PROTO_IS_NOOP
+			decode_access(transfer->addr, transfer->rnw, 0U, transfer->value);
+			DEBUG_PROTO("0x%08" PRIx32 "\n", transfer->rnw == ADIV5_LOW_READ ? *transfer->result : transfer->value);
+#endif
+		}
+		return result;
+	}
+
+	/* Otherwise run each access in turn */
+	for (size_t idx = 0; idx < count; ++idx) {
+		const adiv5_transfer_s *const transfer = &dp->transfer_queue[idx];
+		if (transfer->rnw == ADIV5_LOW_READ)
+			*transfer->result = adiv5_dp_read(dp, transfer->addr);
+		else
+			adiv5_dp_write(dp, transfer->addr, transfer->value);
+	}
+	return true;
+}
+
+static void adiv5_dp_queue(adiv5_debug_port_s *const dp, const adiv5_transfer_s *const transfer)
+{
+	if (dp->transfer_count == ADIV5_TRANSFER_QUEUE_DEPTH)
+		adiv5_dp_queue_flush(dp);
+	dp->transfer_queue[dp->transfer_count++] = *transfer;
+}
+
+void adiv5_dp_queue_read(adiv5_debug_port_s *const dp, const uint16_t addr, uint32_t *const result)
+{
+	const adiv5_transfer_s transfer = {.addr = addr, .rnw = ADIV5_LOW_READ, .result = result};
+	adiv5_dp_queue(dp, &transfer);
+}
+
+void adiv5_dp_queue_write(adiv5_debug_port_s *const dp, const uint16_t addr, const uint32_t value)
+{
+	const adiv5_transfer_s transfer = {.addr = addr, .rnw = ADIV5_LOW_WRITE, .value = value};
+	adiv5_dp_queue(dp, &transfer);
+}
+
 void adiv5_mem_write(adiv5_access_port_s *const ap, const target_addr64_t dest, const void *const src, const size_t len)
 {
 	const align_e align = MIN_ALIGN(dest, len);
@@ -109,14 +109,18 @@
 /* For all AXI and APB4 + APB5: */
 #define ADIV5_AP_CSW_AXI_PROT_NS   (1U << 29U) /* Set if the request should be non-secure */
 #define ADIV5_AP_CSW_AXI_PROT_PRIV (1U << 28U) /* Request is privileged */
+/* For AXI3, AXI4, bits 27:24 are AxCACHE */
+#define ADIV5_AP_CSW_AXI_CACHE_MODIFIABLE (1U << 25U) /* Request may be merged with others */
+#define ADIV5_AP_CSW_AXI_CACHE_BUFFERABLE (1U << 24U) /* Request may be posted */
 /* Bit 15 - MTE (Memory Tagging Enable) for AXI busses */
 #define ADIV5_AP_CSW_AXI_MTE (1U << 15U)
 /* For AHB3, AHB5: */
-#define ADIV5_AP_CSW_AHB_HNONSEC    (1U << 30U) /* Must be set for ABH3 to operate correctly */
-#define ADIV5_AP_CSW_AHB_MASTERTYPE (1U << 29U) /* AHB-AP as requester if set, secondary ID if not */
-#define ADIV5_AP_CSW_AHB_HPROT_MASK 0x1f000000U
-#define ADIV5_AP_CSW_AHB_HPROT_PRIV (1U << 25U) /* Request is privileged */
-#define ADIV5_AP_CSW_AHB_HPROT_DATA (1U << 24U) /* Request is a data access */
+#define ADIV5_AP_CSW_AHB_HNONSEC          (1U << 30U) /* Must be set for ABH3 to operate correctly */
+#define ADIV5_AP_CSW_AHB_MASTERTYPE       (1U << 29U) /* AHB-AP as requester if set, secondary ID if not */
+#define ADIV5_AP_CSW_AHB_HPROT_MASK       0x1f000000U
+#define ADIV5_AP_CSW_AHB_HPROT_BUFFERABLE (1U << 26U) /* Request may be posted */
+#define ADIV5_AP_CSW_AHB_HPROT_PRIV       (1U << 25U) /* Request is privileged */
+#define ADIV5_AP_CSW_AHB_HPROT_DATA       (1U << 24U) /* Request is a data access */
 /* For APB2 and APB3, bits 23 thorugh 30 are reserved */
 /* For APB4 and APB5: */
 #define ADIV5_AP_CSW_APB_PPROT_MASK 0x70000000U
@@ -186,6 +190,8 @@
 #define ADIV5_AP_FLAGS_HAS_MEM         (1U << 1U)
 #define ADIV6_DP_FLAGS_HAS_PWRCTRL     (1U << 2U)
 #define ADIV6_DP_FLAGS_HAS_SYSRESETREQ (1U << 3U)
+#define ADIV5_AP_FLAGS_HAS_CORTEXM     (1U << 4U)
+#define ADIV5_AP_FLAGS_PACKED          (1U << 5U)
 
 /* ADIv5 Class 0x1 ROM Table Registers */
 #define ADI_ROM_MEMTYPE          0xfccU
@@ -278,6 +284,14 @@ void adiv5_mem_read_bytes(adiv5_access_port_s *ap, void *dest, target_addr64_t s
 void adiv5_ap_reg_write(adiv5_access_port_s *ap, uint16_t addr, uint32_t value);
 uint32_t adiv5_ap_reg_read(adiv5_access_port_s *ap, uint16_t addr);
 
+/*
+ * ADIv5 DP transaction queue - accesses are held until the queue is flushed (or fills), so that backends
+ * able to do so can run them all in a single round trip. Read results are only valid after a flush.
+ */
+void adiv5_dp_queue_read(adiv5_debug_port_s *dp, uint16_t addr, uint32_t *result);
+void adiv5_dp_queue_write(adiv5_debug_port_s *dp, uint16_t addr, uint32_t value);
+bool adiv5_dp_queue_flush(adiv5_debug_port_s *dp);
+
 /* ADIv5 DP logical operation function for reading DPIDR safely */
 uint32_t adiv5_dp_read_dpidr(adiv5_debug_port_s *dp);
 
@@ -288,11 +302,15 @@ uint32_t adiv5_swd_read(adiv5_debug_port_s *dp, uint16_t addr);
 uint32_t adiv5_swd_raw_access(adiv5_debug_port_s *dp, uint8_t rnw, uint16_t addr, uint32_t value);
 uint32_t adiv5_swd_clear_error(adiv5_debug_port_s *dp, bool protocol_recovery);
 void adiv5_swd_abort(adiv5_debug_port_s *dp, uint32_t abort);
+/* Batched accesses for probes where swd_proc drives the wire directly, rather than over another link */
+bool adiv5_swd_transfers(adiv5_debug_port_s *dp, const adiv5_transfer_s *transfers, size_t count);
 
 /* JTAG low-level ADIv5 routines */
 uint32_t adiv5_jtag_read(adiv5_debug_port_s *dp, uint16_t addr);
 uint32_t adiv5_jtag_raw_access(adiv5_debug_port_s *dp, uint8_t rnw, uint16_t addr, uint32_t value);
 uint32_t adiv5_jtag_clear_error(adiv5_debug_port_s *dp, bool protocol_recovery);
 void adiv5_jtag_abort(adiv5_debug_port_s *dp, uint32_t abort);
+/* Batched accesses for probes where jtag_proc drives the scans directly, pipelining reads through the DP */
+bool adiv5_jtag_transfers(adiv5_debug_port_s *dp, const adiv5_transfer_s *transfers, size_t count);
 
 #endif /* TARGET_ADIV5_H */
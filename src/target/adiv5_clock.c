@@ -0,0 +1,210 @@
+/*
+ * This file is part of the Black Magic Debug project.
+ *
+ * Copyright (C) 2026 1BitSquared <info@1bitsquared.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * This file implements adaptive debug link clocking for ADIv5 DPs.
+ *
+ * Calibration walks down a ladder of link frequencies, starting at the fastest, until it finds one at which
+ * repeated DPIDR reads and a RAM pattern write/read-back all come back intact. That becomes the ceiling for
+ * adaptive mode, which then watches the result of every DP access: a burst of link errors steps the clock
+ * down a rung, and a long enough run of clean accesses steps it back up towards the ceiling again.
+ *
+ * Only errors which point at the link itself count - parity errors, no response, invalid ACKs and WAITs
+ * that never cleared. FAULT responses are the target's normal answer to an access to a bad address (which
+ * GDB makes all the time), so they say nothing about the link and are ignored.
+ */
+
+#include "general.h"
+#include "target.h"
+#include "target_internal.h"
+#include "adiv5.h"
+#include "adiv5_interface.h"
+#include "cortexm.h"
+#include "cortex.h"
+#include "exception.h"
+
+#define ADIV5_CLOCK_DPIDR_READS  16U
+#define ADIV5_CLOCK_PATTERN_SIZE 64U
+/* How many link errors without an intervening clean run it takes to step the clock down */
+#define ADIV5_CLOCK_ERROR_LIMIT 3U
+/* How many clean accesses in a row it takes to step the clock back up */
+#define ADIV5_CLOCK_CLEAN_RUN 8192U
+
+static const uint32_t adiv5_clock_ladder[] = {
+	50000000U,
+	24000000U,
+	16000000U,
+	12000000U,
+	8000000U,
+	6000000U,
+	4000000U,
+	3000000U,
+	2000000U,
+	1000000U,
+	500000U,
+	250000U,
+	100000U,
+};
+
+#define ADIV5_CLOCK_SLOWEST (ARRAY_LENGTH(adiv5_clock_ladder) - 1U)
+
+bool adiv5_clock_adaptive = false;
+
+static size_t adiv5_clock_ceiling;
+static size_t adiv5_clock_rung;
+static uint32_t adiv5_clock_errors;
+static uint32_t adiv5_clock_clean;
+static bool adiv5_clock_faulted;
+
+/* Keep the TRY/CATCH funkiness contained to avoid clobbering and reduce the need for volatiles */
+static bool adiv5_clock_pattern_check(adiv5_access_port_s *const ap, const target_addr64_t addr,
+	const uint8_t *const pattern, uint8_t *const readback)
+{
+	volatile bool result = false;
+	TRY (EXCEPTION_ALL) {
+		adiv5_mem_write(ap, addr, pattern, ADIV5_CLOCK_PATTERN_SIZE);
+		adiv5_mem_read(ap, readback, addr, ADIV5_CLOCK_PATTERN_SIZE);
+		result = !ap->dp->fault && memcmp(pattern, readback, ADIV5_CLOCK_PATTERN_SIZE) == 0;
+	}
+	CATCH () {
+	default:
+		result = false;
+	}
+	return result;
+}
+
+static bool adiv5_clock_link_check(adiv5_access_port_s *const ap, const uint32_t dpidr, const target_addr64_t addr)
+{
+	adiv5_debug_port_s *const dp = ap->dp;
+	for (size_t read = 0U; read < ADIV5_CLOCK_DPIDR_READS; ++read) {
+		if (adiv5_dp_read_dpidr(dp) != dpidr || dp->fault)
+			return false;
+	}
+
+	/* Alternating bit patterns and a ramp make for plenty of transitions on the data line */
+	uint8_t pattern[ADIV5_CLOCK_PATTERN_SIZE];
+	uint8_t readback[ADIV5_CLOCK_PATTERN_SIZE];
+	for (size_t idx = 0U; idx < ADIV5_CLOCK_PATTERN_SIZE; ++idx)
+		pattern[idx] = idx & 1U ? 0x55U ^ (uint8_t)idx : 0xaaU;
+	return adiv5_clock_pattern_check(ap, addr, pattern, readback);
+}
+
+/* Get the link talking again after a failed check, at the slowest rung */
+static void adiv5_clock_link_recover(adiv5_debug_port_s *const dp)
+{
+	platform_max_frequency_set(adiv5_clock_ladder[ADIV5_CLOCK_SLOWEST]);
+	adiv5_dp_shadow_invalidate(dp);
+	TRY (EXCEPTION_ALL) {
+		dp->error(dp, true);
+	}
+	CATCH () {
+	default:
+		break;
+	}
+	dp->fault = 0U;
+}
+
+static void adiv5_clock_set_rung(const size_t rung)
+{
+	adiv5_clock_rung = rung;
+	adiv5_clock_errors = 0U;
+	adiv5_clock_clean = 0U;
+	platform_max_frequency_set(adiv5_clock_ladder[rung]);
+	DEBUG_INFO("Adaptive clock: link now at %" PRIu32 "Hz\n", platform_max_frequency_get());
+}
+
+bool adiv5_clock_calibrate(target_s *const target)
+{
+	adiv5_clock_adaptive = false;
+	if (!target_is_cortexm(target) || !target->ram) {
+		tc_printf(target, "Adaptive clocking needs an attached ADIv5 target with RAM\n");
+		return false;
+	}
+	if (platform_max_frequency_get() == FREQ_FIXED) {
+		tc_printf(target, "Debug iface frequency is fixed\n");
+		return false;
+	}
+
+	adiv5_access_port_s *const ap = cortex_ap(target);
+	adiv5_debug_port_s *const dp = ap->dp;
+	const target_addr64_t addr = target->ram->start;
+	if (target->ram->length < ADIV5_CLOCK_PATTERN_SIZE) {
+		tc_printf(target, "Adaptive clocking needs at least %u bytes of RAM\n", ADIV5_CLOCK_PATTERN_SIZE);
+		return false;
+	}
+
+	/* Take the reference DPIDR and the RAM contents we're about to trample at the slowest rung */
+	platform_max_frequency_set(adiv5_clock_ladder[ADIV5_CLOCK_SLOWEST]);
+	uint8_t saved[ADIV5_CLOCK_PATTERN_SIZE];
+	const uint32_t dpidr = adiv5_dp_read_dpidr(dp);
+	adiv5_mem_read(ap, saved, addr, ADIV5_CLOCK_PATTERN_SIZE);
+	if (!dpidr || dp->fault) {
+		tc_printf(target, "Failed to read the reference DPIDR and RAM\n");
+		dp->fault = 0U;
+		return false;
+	}
+
+	/* Walk down the ladder, skipping rungs the probe can't actually tell apart from the previous one */
+	size_t rung = 0U;
+	uint32_t last_frequency = 0U;
+	for (; rung < ADIV5_CLOCK_SLOWEST; ++rung) {
+		platform_max_frequency_set(adiv5_clock_ladder[rung]);
+		const uint32_t frequency = platform_max_frequency_get();
+		if (frequency == last_frequency)
+			continue;
+		last_frequency = frequency;
+		if (adiv5_clock_link_check(ap, dpidr, addr))
+			break;
+		DEBUG_INFO("Adaptive clock: link failed at %" PRIu32 "Hz\n", frequency);
+		adiv5_clock_link_recover(dp);
+	}
+
+	adiv5_clock_ceiling = rung;
+	adiv5_clock_faulted = false;
+	adiv5_clock_set_rung(rung);
+	adiv5_mem_write(ap, addr, saved, ADIV5_CLOCK_PATTERN_SIZE);
+	adiv5_clock_adaptive = true;
+	tc_printf(target, "Adaptive clocking enabled, link calibrated to %" PRIu32 "Hz\n", platform_max_frequency_get());
+	return true;
+}
+
+void adiv5_clock_adaptive_disable(void)
+{
+	adiv5_clock_adaptive = false;
+}
+
+void adiv5_clock_note_access(const uint8_t fault)
+{
+	/* A fault stays latched until it's cleared, so only count the access that raised it */
+	const bool link_error = fault && fault != SWD_ACK_FAULT;
+	if (link_error) {
+		if (!adiv5_clock_faulted && ++adiv5_clock_errors >= ADIV5_CLOCK_ERROR_LIMIT &&
+			adiv5_clock_rung < ADIV5_CLOCK_SLOWEST)
+			adiv5_clock_set_rung(adiv5_clock_rung + 1U);
+		adiv5_clock_clean = 0U;
+	} else if (!fault && ++adiv5_clock_clean >= ADIV5_CLOCK_CLEAN_RUN) {
+		if (adiv5_clock_rung > adiv5_clock_ceiling)
+			adiv5_clock_set_rung(adiv5_clock_rung - 1U);
+		else {
+			adiv5_clock_errors = 0U;
+			adiv5_clock_clean = 0U;
+		}
+	}
+	adiv5_clock_faulted = link_error;
+}
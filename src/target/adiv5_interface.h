@@ -26,18 +26,156 @@
 
 #include "adiv5_internal.h"
 #include "exception.h"
+#include "probe_trace.h"
 
 #ifndef DEBUG_PROTO_IS_NOOP
 void decode_access(uint16_t addr, uint8_t rnw, uint8_t apsel, uint32_t value);
 #endif
 
+/* Forget everything the register shadows know, as after error recovery or an abort */
+static inline void adiv5_dp_shadow_invalidate(adiv5_debug_port_s *const dp)
+{
+	dp->shadow_valid = 0U;
+}
+
+static inline bool adiv5_dp_shadowed(const adiv5_debug_port_s *const dp, const uint8_t shadows)
+{
+	return (dp->shadow_valid & shadows) == shadows;
+}
+
+/* Whether a DP write to address 0x4 is going to SELECT1 (ADIv6, DP bank 5) rather than CTRL/STAT */
+static inline bool adiv5_dp_shadow_is_select1(const adiv5_debug_port_s *const dp)
+{
+	return dp->version >= 3U && adiv5_dp_shadowed(dp, ADIV5_SHADOW_SELECT) &&
+		(dp->select_shadow & ADIV5_DP_SELECT_DPBANK_MASK) == ADIV5_DP_BANK5;
+}
+
+/*
+ * Drop every shadow a raw access is about to disturb. This is done before the access is made so that an access
+ * which fails part way, or raises an exception, can never leave a shadow claiming a value the hardware doesn't hold.
+ */
+static inline void adiv5_dp_shadow_access(
+	adiv5_debug_port_s *const dp, const uint8_t rnw, const uint16_t addr, const uint32_t value)
+{
+	if (addr & ADIV5_APnDP) {
+		/* Only accesses to the AP bank holding CSW, TAR and DRW can change them, if we know what's selected */
+		const uint32_t bank_mask = dp->version >= 3U ? ADIV6_DP_SELECT_APBANK_MASK : ADIV5_DP_SELECT_APBANK_MASK;
+		if (adiv5_dp_shadowed(dp, ADIV5_SHADOW_SELECT) &&
+			(dp->select_shadow & bank_mask) != (ADIV5_AP_CSW & bank_mask))
+			return;
+		/* DRW accesses move TAR on, otherwise only writes to CSW and TAR themselves change anything */
+		switch (addr & 0x0cU) {
+		case 0x0U:
+			if (rnw == ADIV5_LOW_WRITE)
+				dp->shadow_valid &= ~ADIV5_SHADOW_CSW;
+			break;
+		case 0x4U:
+		case 0x8U:
+			if (rnw == ADIV5_LOW_WRITE)
+				dp->shadow_valid &= ~ADIV5_SHADOW_TAR;
+			break;
+		default:
+			dp->shadow_valid &= ~ADIV5_SHADOW_TAR;
+			break;
+		}
+		return;
+	}
+	if (rnw == ADIV5_LOW_READ)
+		return;
+
+	switch (addr & 0x0cU) {
+	case ADIV5_DP_SELECT: {
+		/* Moving SELECT on to another AP means the CSW and TAR shadows no longer describe the selected AP */
+		const uint32_t ap_mask = dp->version >= 3U ? ADIV6_DP_SELECT_AP_MASK : ADIV5_DP_SELECT_APSEL_MASK;
+		if (!adiv5_dp_shadowed(dp, ADIV5_SHADOW_SELECT) || ((dp->select_shadow ^ value) & ap_mask))
+			dp->shadow_valid &= ~(ADIV5_SHADOW_CSW | ADIV5_SHADOW_TAR);
+		dp->shadow_valid &= ~ADIV5_SHADOW_SELECT;
+		break;
+	}
+	case ADIV5_DP_CTRLSTAT:
+		if (adiv5_dp_shadow_is_select1(dp) && adiv5_dp_shadowed(dp, ADIV5_SHADOW_SELECT1) &&
+			dp->select1_shadow == value)
+			break;
+		/* Either SELECT1 is changing, or this is CTRL/STAT which can power the debug domain (and APs) down */
+		dp->shadow_valid &= ~(ADIV5_SHADOW_SELECT1 | ADIV5_SHADOW_CSW | ADIV5_SHADOW_TAR);
+		break;
+	case ADIV5_DP_ABORT:
+		dp->shadow_valid &= ~(ADIV5_SHADOW_CSW | ADIV5_SHADOW_TAR);
+		break;
+	default:
+		/* TARGETSEL, which can put a different DP on the other end of the wire */
+		adiv5_dp_shadow_invalidate(dp);
+		break;
+	}
+}
+
+/* Record the new value of SELECT or SELECT1 once a write to it has completed successfully */
+static inline void adiv5_dp_shadow_complete(
+	adiv5_debug_port_s *const dp, const uint8_t rnw, const uint16_t addr, const uint32_t value)
+{
+	if (!dp->shadowing || rnw != ADIV5_LOW_WRITE || (addr & ADIV5_APnDP) || dp->fault)
+		return;
+	if (addr == ADIV5_DP_SELECT) {
+		dp->select_shadow = value;
+		dp->shadow_valid |= ADIV5_SHADOW_SELECT;
+	} else if (addr == ADIV5_DP_CTRLSTAT && adiv5_dp_shadow_is_select1(dp)) {
+		/* SELECT1 shares its address with CTRL/STAT, being on DP bank 5 */
+		dp->select1_shadow = value;
+		dp->shadow_valid |= ADIV5_SHADOW_SELECT1;
+	}
+}
+
+/* Record the CSW and TAR values of the selected AP after a memory access set up or completed without fault */
+static inline void adiv5_dp_shadow_mem(adiv5_debug_port_s *const dp, const uint32_t csw, const target_addr64_t tar)
+{
+	if (!dp->shadowing || dp->fault || !adiv5_dp_shadowed(dp, ADIV5_SHADOW_SELECT))
+		return;
+	dp->csw_shadow = csw;
+	dp->tar_shadow = tar;
+	dp->shadow_valid |= ADIV5_SHADOW_CSW | ADIV5_SHADOW_TAR;
+}
+
+/*
+ * Record where TAR was left by a run of DRW accesses which completed without fault. Auto-increment is only
+ * guaranteed within a 1KiB block, so a run ending on a block boundary leaves TAR in an unknown state.
+ */
+static inline void adiv5_dp_shadow_tar(adiv5_debug_port_s *const dp, const target_addr64_t tar)
+{
+	if (!dp->shadowing || dp->fault || !adiv5_dp_shadowed(dp, ADIV5_SHADOW_SELECT | ADIV5_SHADOW_CSW) ||
+		(tar & 0x000003ffU) == 0U)
+		return;
+	dp->tar_shadow = tar;
+	dp->shadow_valid |= ADIV5_SHADOW_TAR;
+}
+
+/* TAR is only guaranteed to auto-increment through its bottom 10 bits, but we probe for up to 4KiB */
+#define ADIV5_AP_TAR_WRAP_MIN     1024U
+#define ADIV5_AP_TAR_INC_BITS_MAX 2U
+
+/* The size of the aligned blocks TAR auto-increments within on this AP, TAR must be rewritten to cross into the next */
+static inline uint32_t adiv5_ap_tar_wrap(const adiv5_access_port_s *const ap)
+{
+	return ADIV5_AP_TAR_WRAP_MIN << ap->tar_inc_bits;
+}
+
+/* Feed the result of an access through to the adaptive link clock, if it's in use */
+static inline void adiv5_clock_note(const adiv5_debug_port_s *const dp)
+{
+	if (adiv5_clock_adaptive)
+		adiv5_clock_note_access(dp->fault);
+}
+
 static inline bool adiv5_write_no_check(adiv5_debug_port_s *const dp, const uint16_t addr, const uint32_t value)
 {
 #ifndef DEBUG_PROTO_IS_NOOP
 	decode_access(addr, ADIV5_LOW_WRITE, 0U, value);
 	DEBUG_PROTO("0x%08" PRIx32 "\n", value);
 #endif
-	return dp->write_no_check(addr, value);
+	adiv5_dp_shadow_access(dp, ADIV5_LOW_WRITE, addr, value);
+	const bool result = dp->write_no_check(addr, value);
+	if (!result)
+		adiv5_dp_shadow_complete(dp, ADIV5_LOW_WRITE, addr, value);
+	return result;
 }
 
 static inline uint32_t adiv5_read_no_check(adiv5_debug_port_s *const dp, const uint16_t addr)
@@ -52,7 +190,11 @@ static inline uint32_t adiv5_read_no_check(adiv5_debug_port_s *const dp, const u
 
 static inline uint32_t adiv5_dp_read(adiv5_debug_port_s *const dp, const uint16_t addr)
 {
+	adiv5_dp_shadow_access(dp, ADIV5_LOW_READ, addr, 0U);
+	const uint32_t start = probe_trace_begin();
 	uint32_t ret = dp->dp_read(dp, addr);
+	probe_trace_record(PROBE_TRACE_DP_READ, start, addr, ret, 0U, dp->fault);
+	adiv5_clock_note(dp);
 #ifndef DEBUG_PROTO_IS_NOOP
 	decode_access(addr, ADIV5_LOW_READ, 0U, 0U);
 	DEBUG_PROTO("0x%08" PRIx32 "\n", ret);
@@ -66,13 +208,23 @@ static inline void adiv5_dp_write(adiv5_debug_port_s *const dp, const uint16_t a
 	decode_access(addr, ADIV5_LOW_WRITE, 0U, value);
 	DEBUG_PROTO("0x%08" PRIx32 "\n", value);
 #endif
+	adiv5_dp_shadow_access(dp, ADIV5_LOW_WRITE, addr, value);
+	const uint32_t start = probe_trace_begin();
 	dp->low_access(dp, ADIV5_LOW_WRITE, addr, value);
+	probe_trace_record(PROBE_TRACE_DP_WRITE, start, addr, value, 0U, dp->fault);
+	adiv5_clock_note(dp);
+	adiv5_dp_shadow_complete(dp, ADIV5_LOW_WRITE, addr, value);
 }
 
 static inline uint32_t adiv5_dp_low_access(
 	adiv5_debug_port_s *const dp, const uint8_t rnw, const uint16_t addr, const uint32_t value)
 {
+	adiv5_dp_shadow_access(dp, rnw, addr, value);
+	const uint32_t start = probe_trace_begin();
 	uint32_t ret = dp->low_access(dp, rnw, addr, value);
+	probe_trace_record(PROBE_TRACE_LOW_ACCESS, start, addr, rnw ? ret : value, 0U, dp->fault);
+	adiv5_clock_note(dp);
+	adiv5_dp_shadow_complete(dp, rnw, addr, value);
 #ifndef DEBUG_PROTO_IS_NOOP
 	decode_access(addr, rnw, 0U, value);
 	DEBUG_PROTO("0x%08" PRIx32 "\n", rnw ? ret : value);
@@ -82,6 +234,7 @@ static inline uint32_t adiv5_dp_low_access(
 
 static inline uint32_t adiv5_dp_error(adiv5_debug_port_s *const dp)
 {
+	adiv5_dp_shadow_invalidate(dp);
 	uint32_t ret = dp->error(dp, false);
 	DEBUG_PROTO("DP Error 0x%08" PRIx32 "\n", ret);
 	return ret;
@@ -90,12 +243,16 @@ static inline uint32_t adiv5_dp_error(adiv5_debug_port_s *const dp)
 static inline void adiv5_dp_abort(adiv5_debug_port_s *const dp, const uint32_t abort)
 {
 	DEBUG_PROTO("Abort: %08" PRIx32 "\n", abort);
+	adiv5_dp_shadow_invalidate(dp);
 	dp->abort(dp, abort);
 }
 
 static inline uint32_t adiv5_ap_read(adiv5_access_port_s *const ap, const uint16_t addr)
 {
+	const uint32_t start = probe_trace_begin();
 	uint32_t ret = ap->dp->ap_read(ap, addr);
+	probe_trace_record(PROBE_TRACE_AP_READ, start, addr, ret, ap->apsel, ap->dp->fault);
+	adiv5_clock_note(ap->dp);
 #ifndef DEBUG_PROTO_IS_NOOP
 	decode_access(addr, ADIV5_LOW_READ, ap->apsel, 0U);
 	DEBUG_PROTO("0x%08" PRIx32 "\n", ret);
@@ -109,13 +266,19 @@ static inline void adiv5_ap_write(adiv5_access_port_s *const ap, const uint16_t
 	decode_access(addr, ADIV5_LOW_WRITE, ap->apsel, value);
 	DEBUG_PROTO("0x%08" PRIx32 "\n", value);
 #endif
+	const uint32_t start = probe_trace_begin();
 	ap->dp->ap_write(ap, addr, value);
+	probe_trace_record(PROBE_TRACE_AP_WRITE, start, addr, value, ap->apsel, ap->dp->fault);
+	adiv5_clock_note(ap->dp);
 }
 
 static inline void adiv5_mem_read(
 	adiv5_access_port_s *const ap, void *const dest, const target_addr64_t src, const size_t len)
 {
+	const uint32_t start = probe_trace_begin();
 	ap->dp->mem_read(ap, dest, src, len);
+	probe_trace_record(PROBE_TRACE_MEM_READ, start, (uint32_t)src, (uint32_t)len, ap->apsel, ap->dp->fault);
+	adiv5_clock_note(ap->dp);
 	DEBUG_PROTO("%s @ %" PRIx64 " len %zu:", __func__, src, len);
 #ifndef DEBUG_PROTO_IS_NOOP
 	const uint8_t *const data = (const uint8_t *)dest;
@@ -145,25 +308,34 @@ static inline void adiv5_mem_write_aligned(adiv5_access_port_s *const ap, const
 		DEBUG_PROTO(" ...");
 #endif
 	DEBUG_PROTO("\n");
+	const uint32_t start = probe_trace_begin();
 	ap->dp->mem_write(ap, dest, src, len, align);
+	probe_trace_record(PROBE_TRACE_MEM_WRITE, start, (uint32_t)dest, (uint32_t)len, ap->apsel, ap->dp->fault);
+	adiv5_clock_note(ap->dp);
 }
 
 static inline uint32_t adiv5_dp_recoverable_access(adiv5_debug_port_s *dp, uint8_t rnw, uint16_t addr, uint32_t value)
 {
+	adiv5_dp_shadow_access(dp, rnw, addr, value);
 	const uint32_t result = dp->low_access(dp, rnw, addr, value);
+	adiv5_clock_note(dp);
 	/* If the access results in the no-response response, retry after clearing the error state */
 	if (dp->fault == SWD_ACK_NO_RESPONSE) {
 		uint32_t response;
 		/* Wait the response period, then clear the error */
 		swd_proc.seq_in_parity(&response, 32);
 		DEBUG_WARN("Recovering and re-trying access\n");
+		adiv5_dp_shadow_invalidate(dp);
 		dp->error(dp, true);
 		response = dp->low_access(dp, rnw, addr, value);
+		adiv5_clock_note(dp);
 		/* If the access results in no-response again, throw to propergate that up */
 		if (dp->fault == SWD_ACK_NO_RESPONSE)
 			raise_exception(EXCEPTION_ERROR, "SWD invalid ACK");
+		adiv5_dp_shadow_complete(dp, rnw, addr, value);
 		return response;
 	}
+	adiv5_dp_shadow_complete(dp, rnw, addr, value);
 	return result;
 }
 
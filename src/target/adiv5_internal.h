@@ -75,6 +75,19 @@
 #define ADIV5_DP_BANK4 4U
 #define ADIV5_DP_BANK5 5U
 
+/* DP SELECT register fields identifying the selected DP bank and AP (ADIv5 APSEL, ADIv6 AP base address) */
+#define ADIV5_DP_SELECT_DPBANK_MASK 0x0000000fU
+#define ADIV5_DP_SELECT_APBANK_MASK 0x000000f0U
+#define ADIV5_DP_SELECT_APSEL_MASK  0xff000000U
+#define ADIV6_DP_SELECT_APBANK_MASK 0x00000ff0U
+#define ADIV6_DP_SELECT_AP_MASK     0xfffff000U
+
+/* Which of the register shadows held on a DP are currently known to match the hardware */
+#define ADIV5_SHADOW_SELECT  (1U << 0U)
+#define ADIV5_SHADOW_SELECT1 (1U << 1U)
+#define ADIV5_SHADOW_CSW     (1U << 2U) /* CSW of the AP SELECT addresses */
+#define ADIV5_SHADOW_TAR     (1U << 3U) /* TAR of the AP SELECT addresses */
+
 /*
  * ADIv5 MEM-AP Registers
  *
@@ -193,6 +206,17 @@
 typedef struct adiv5_access_port adiv5_access_port_s;
 typedef struct adiv5_debug_port adiv5_debug_port_s;
 
+/* Number of DP/AP accesses a DP's transaction queue holds before it is automatically flushed */
+#define ADIV5_TRANSFER_QUEUE_DEPTH 12U
+
+/* A single DP or AP register access held in a DP's transaction queue */
+typedef struct adiv5_transfer {
+	uint16_t addr;    /* DP register address, or AP register address (ADIV5_APnDP set) in the current bank */
+	uint8_t rnw;      /* ADIV5_LOW_READ or ADIV5_LOW_WRITE */
+	uint32_t value;   /* Value to write, for writes */
+	uint32_t *result; /* Where to deliver the value read, for reads */
+} adiv5_transfer_s;
+
 struct adiv5_debug_port {
 	int refcnt;
 
@@ -203,11 +227,16 @@ struct adiv5_debug_port {
 	uint32_t (*error)(adiv5_debug_port_s *dp, bool protocol_recovery);
 	uint32_t (*low_access)(adiv5_debug_port_s *dp, uint8_t RnW, uint16_t addr, uint32_t value);
 	void (*abort)(adiv5_debug_port_s *dp, uint32_t abort);
+	/* Optionally run a batch of queued accesses in one go, delivering read results to the transfers' buffers */
+	bool (*transfers)(adiv5_debug_port_s *dp, const adiv5_transfer_s *transfers, size_t count);
 
 #if CONFIG_BMDA == 1
 	void (*ap_regs_read)(adiv5_access_port_s *ap, void *data);
 	uint32_t (*ap_reg_read)(adiv5_access_port_s *ap, uint8_t reg_num);
 	void (*ap_reg_write)(adiv5_access_port_s *ap, uint8_t num, uint32_t value);
+	/* Optionally poll a 32-bit memory location probe-side, returning the last value read */
+	uint32_t (*mem_poll32)(
+		adiv5_access_port_s *ap, target_addr64_t addr, uint32_t mask, uint32_t value, uint32_t timeout_ms);
 #endif
 	uint32_t (*ap_read)(adiv5_access_port_s *ap, uint16_t addr);
 	void (*ap_write)(adiv5_access_port_s *ap, uint16_t addr, uint32_t value);
@@ -236,6 +265,23 @@ struct adiv5_debug_port {
 
 	/* DPv3+ bus address width */
 	uint8_t address_width;
+
+	/* Accesses queued by adiv5_dp_queue_read()/adiv5_dp_queue_write() awaiting adiv5_dp_queue_flush() */
+	uint8_t transfer_count;
+	adiv5_transfer_s transfer_queue[ADIV5_TRANSFER_QUEUE_DEPTH];
+
+	/*
+	 * Shadows of SELECT, SELECT1 and the selected AP's CSW and TAR, used to skip writes that would change nothing.
+	 * These are only kept when every AP and memory access goes through the generic ADIv5/ADIv6 routines, as
+	 * backends with their own implementations of those move the registers behind the shadows' back. The one
+	 * exception is the CMSIS-DAP ADIv6 backend, which keeps SELECT and SELECT1 up to date itself.
+	 */
+	bool shadowing;
+	uint8_t shadow_valid;
+	uint32_t select_shadow;
+	uint32_t select1_shadow;
+	uint32_t csw_shadow;
+	target_addr64_t tar_shadow;
 };
 
 struct adiv5_access_port {
@@ -249,6 +295,8 @@ struct adiv5_access_port {
 	target_addr64_t base;
 	uint32_t csw;
 	uint32_t ap_cortexm_demcr; /* Copy of demcr when starting */
+	/* How many bits past the guaranteed 10 TAR was found to auto-increment through */
+	uint8_t tar_inc_bits;
 
 	/* AP designer and partno */
 	uint16_t designer_code;
@@ -297,4 +345,14 @@ typedef struct arm_coresight_component {
 /* Helper for building an ADIv5 request */
 uint8_t make_packet_request(uint8_t rnw, uint16_t addr);
 
+/*
+ * Adaptive link clocking. Calibration finds the fastest link frequency the target copes with reliably and
+ * enables adaptive mode, in which every access result is fed back to step the clock down on link errors and
+ * back up towards the calibrated frequency after a sustained run of clean accesses.
+ */
+extern bool adiv5_clock_adaptive;
+bool adiv5_clock_calibrate(target_s *target);
+void adiv5_clock_adaptive_disable(void);
+void adiv5_clock_note_access(uint8_t fault);
+
 #endif /* TARGET_ADIV5_INTERNAL_H */
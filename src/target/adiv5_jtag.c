@@ -57,6 +57,8 @@ void adiv5_jtag_dp_handler(const uint8_t dev_index)
 	dp->abort = adiv5_jtag_abort;
 #if CONFIG_BMDA == 1
 	bmda_jtag_dp_init(dp);
+#else
+	dp->transfers = adiv5_jtag_transfers;
 #endif
 
 	/* Grab the ID code that was scanned */
@@ -122,8 +124,8 @@ uint32_t adiv5_jtag_raw_access(
 	uint32_t result;
 	uint8_t ack;
 
-	/* Set the instruction to the correct one for the kind of access needed */
-	jtag_dev_write_ir(dp->dev_index, (addr & ADIV5_APnDP) ? IR_APACC : IR_DPACC);
+	/* Set the instruction to the correct one for the kind of access needed, sending it with the first DR scan */
+	jtag_dev_queue_ir(dp->dev_index, (addr & ADIV5_APnDP) ? IR_APACC : IR_DPACC);
 
 	platform_timeout_s timeout;
 	platform_timeout_set(&timeout, 250);
@@ -143,6 +145,7 @@ uint32_t adiv5_jtag_raw_access(
 	 */
 	if (ack == JTAG_ACK_WAIT) {
 		DEBUG_ERROR("JTAG access resulted in wait, aborting\n");
+		adiv5_dp_shadow_invalidate(dp);
 		dp->abort(dp, ADIV5_DP_ABORT_DAPABORT);
 		/* Use the SWD ack codes for the fault code to be completely consistent between JTAG-vs-SWD */
 		dp->fault = SWD_ACK_WAIT;
@@ -169,9 +172,33 @@ uint32_t adiv5_jtag_raw_access(
 	return result;
 }
 
+/*
+ * Run a batch of DP and AP accesses back to back. A JTAG-DP returns the result of a read in the capture of
+ * whichever scan comes next, so rather than following every read with a read of RDBUFF as adiv5_jtag_read()
+ * does, each scan collects the result of the read before it and only a read ending the batch needs draining.
+ */
+bool adiv5_jtag_transfers(adiv5_debug_port_s *const dp, const adiv5_transfer_s *const transfers, const size_t count)
+{
+	if (dp->fault)
+		return false;
+	uint32_t *pending = NULL;
+	for (size_t idx = 0; idx < count; ++idx) {
+		const adiv5_transfer_s *const transfer = &transfers[idx];
+		const uint32_t result = adiv5_jtag_raw_access(dp, transfer->rnw, transfer->addr, transfer->value);
+		if (dp->fault)
+			return false;
+		if (pending)
+			*pending = result;
+		pending = transfer->rnw == ADIV5_LOW_READ ? transfer->result : NULL;
+	}
+	if (pending)
+		*pending = adiv5_jtag_raw_access(dp, ADIV5_LOW_READ, ADIV5_DP_RDBUFF, 0U);
+	return !dp->fault;
+}
+
 void adiv5_jtag_abort(adiv5_debug_port_s *dp, uint32_t abort)
 {
 	uint64_t request = (uint64_t)abort << 3U;
-	jtag_dev_write_ir(dp->dev_index, IR_ABORT);
+	jtag_dev_queue_ir(dp->dev_index, IR_ABORT);
 	jtag_dev_shift_dr(dp->dev_index, NULL, (const uint8_t *)&request, 35);
 }
@@ -30,6 +30,7 @@
 #include "swd.h"
 #include "target.h"
 #include "target_internal.h"
+#include "stats.h"
 
 uint8_t make_packet_request(const uint8_t rnw, const uint16_t addr)
 {
@@ -53,10 +54,15 @@ uint8_t make_packet_request(const uint8_t rnw, const uint16_t addr)
 	return request;
 }
 
+/* The TARGETSEL value of the multi-drop DP listening on the bus, 0 (never a valid TARGETSEL) if that's not known */
+static uint32_t swd_selected_targetsel = 0U;
+
 /* Provide bare DP access functions without timeout and exception */
 
 static void swd_line_reset_sequence(const bool idle_cycles)
 {
+	/* A line reset leaves every multi-drop DP on the bus waiting for a TARGETSEL write */
+	swd_selected_targetsel = 0U;
 	/*
 	 * A line reset is achieved by holding the SWDIOTMS HIGH for at least 50 SWCLKTCK cycles, followed by at least two idle cycles
 	 * Note: in some non-conformant devices (STM32) at least 51 HIGH cycles and/or 3/4 idle cycles are required
@@ -175,6 +181,7 @@ bool adiv5_swd_scan(const uint32_t targetid)
 
 #if CONFIG_BMDA == 0
 	swdptap_init();
+	dp->transfers = adiv5_swd_transfers;
 #else
 	if (!bmda_swd_dp_init(dp)) {
 		free(dp);
@@ -310,9 +317,10 @@ void adiv5_swd_multidrop_scan(adiv5_debug_port_s *const dp, const uint32_t targe
 		dp->fault = 0;
 
 		/* Select the instance */
-		dp->write_no_check(ADIV5_DP_TARGETSEL,
-			instance << ADIV5_DP_TARGETSEL_TINSTANCE_OFFSET |
-				(targetid & (ADIV5_DP_TARGETID_TDESIGNER_MASK | ADIV5_DP_TARGETID_TPARTNO_MASK)) | 1U);
+		const uint32_t targetsel = instance << ADIV5_DP_TARGETSEL_TINSTANCE_OFFSET |
+			(targetid & (ADIV5_DP_TARGETID_TDESIGNER_MASK | ADIV5_DP_TARGETID_TPARTNO_MASK)) | 1U;
+		dp->write_no_check(ADIV5_DP_TARGETSEL, targetsel);
+		swd_selected_targetsel = targetsel;
 
 		/* Read DPIDR */
 		if (adiv5_dp_read_dpidr(dp) == 0)
@@ -339,6 +347,23 @@ void adiv5_swd_multidrop_scan(adiv5_debug_port_s *const dp, const uint32_t targe
 	free(dp);
 }
 
+/*
+ * Make sure that dp is the multi-drop DP listening on the bus, switching over with just a line reset, TARGETSEL
+ * write and the DPIDR read that gets the DP out of its reset state if not, so that time-slicing between targets
+ * on a shared bus doesn't need to go through fault recovery on every switch.
+ */
+static void adiv5_swd_select_dp(adiv5_debug_port_s *const dp)
+{
+	if (dp->version < 2U || !dp->targetsel || dp->targetsel == swd_selected_targetsel || !dp->write_no_check)
+		return;
+	swd_line_reset_sequence(true);
+	adiv5_write_no_check(dp, ADIV5_DP_TARGETSEL, dp->targetsel);
+	swd_selected_targetsel = dp->targetsel;
+	adiv5_dp_low_access(dp, ADIV5_LOW_READ, ADIV5_DP_DPIDR, 0U);
+	if (dp->fault)
+		swd_selected_targetsel = 0U;
+}
+
 uint32_t adiv5_swd_read(adiv5_debug_port_s *dp, uint16_t addr)
 {
 	if (addr & ADIV5_APnDP) {
@@ -359,10 +384,14 @@ uint32_t adiv5_swd_clear_error(adiv5_debug_port_s *const dp, const bool protocol
 		 * into the expected state.
 		 */
 		swd_line_reset_sequence(true);
-		if (dp->version >= 2U)
+		if (dp->version >= 2U) {
 			adiv5_write_no_check(dp, ADIV5_DP_TARGETSEL, dp->targetsel);
+			swd_selected_targetsel = dp->targetsel;
+		}
 		adiv5_dp_low_access(dp, ADIV5_LOW_READ, ADIV5_DP_DPIDR, 0U);
-	}
+	} else
+		/* The status read below bypasses the raw access routine, so make sure it goes to the right DP */
+		adiv5_swd_select_dp(dp);
 	/* Try to read the current target status */
 	const uint32_t err = adiv5_read_no_check(dp, ADIV5_DP_CTRLSTAT);
 	/* If the read failed for some reason */
@@ -402,7 +431,9 @@ uint32_t adiv5_swd_raw_access(adiv5_debug_port_s *dp, const uint8_t rnw, const u
 {
 	if ((addr & ADIV5_APnDP) && dp->fault)
 		return 0;
+	adiv5_swd_select_dp(dp);
 
+	const uint32_t start = stats_timestamp();
 	const uint8_t request = make_packet_request(rnw, addr);
 	uint32_t response = 0;
 	uint8_t ack = SWD_ACK_WAIT;
@@ -411,7 +442,10 @@ uint32_t adiv5_swd_raw_access(adiv5_debug_port_s *dp, const uint8_t rnw, const u
 	do {
 		swd_proc.seq_out(request, 8U);
 		ack = swd_proc.seq_in(3U);
-		if (ack == SWD_ACK_FAULT) {
+		if (ack == SWD_ACK_WAIT)
+			stats_event(STATS_SWD_WAIT, 1U);
+		else if (ack == SWD_ACK_FAULT) {
+			stats_event(STATS_SWD_FAULT, 1U);
 			DEBUG_ERROR("SWD access resulted in fault, retrying\n");
 			/* On fault, abort the request and repeat */
 			/* Yes, this is self-recursive.. no, we can't think of a better option */
@@ -423,6 +457,7 @@ uint32_t adiv5_swd_raw_access(adiv5_debug_port_s *dp, const uint8_t rnw, const u
 
 	if (ack == SWD_ACK_WAIT) {
 		DEBUG_ERROR("SWD access resulted in wait, aborting\n");
+		adiv5_dp_shadow_invalidate(dp);
 		dp->abort(dp, ADIV5_DP_ABORT_DAPABORT);
 		dp->fault = ack;
 		return 0;
@@ -435,6 +470,7 @@ uint32_t adiv5_swd_raw_access(adiv5_debug_port_s *dp, const uint8_t rnw, const u
 	}
 
 	if (ack == SWD_ACK_NO_RESPONSE) {
+		stats_event(STATS_SWD_NO_RESPONSE, 1U);
 		DEBUG_ERROR("SWD access resulted in no response\n");
 		dp->fault = ack;
 		return 0;
@@ -442,6 +478,9 @@ uint32_t adiv5_swd_raw_access(adiv5_debug_port_s *dp, const uint8_t rnw, const u
 
 	if (ack != SWD_ACK_OK) {
 		DEBUG_ERROR("SWD access has invalid ack %x\n", ack);
+		/* The exception skips the wrappers, so tell the adaptive clock about the link error here */
+		if (adiv5_clock_adaptive)
+			adiv5_clock_note_access(SWD_ACK_NO_RESPONSE);
 		raise_exception(EXCEPTION_ERROR, "SWD invalid ACK");
 	}
 
@@ -449,6 +488,8 @@ uint32_t adiv5_swd_raw_access(adiv5_debug_port_s *dp, const uint8_t rnw, const u
 		if (!swd_proc.seq_in_parity(&response, 32U)) { /* Give up on parity error */
 			dp->fault = 1U;
 			DEBUG_ERROR("SWD access resulted in parity error\n");
+			if (adiv5_clock_adaptive)
+				adiv5_clock_note_access(dp->fault);
 			raise_exception(EXCEPTION_ERROR, "SWD parity error");
 		}
 	} else
@@ -465,9 +506,81 @@ uint32_t adiv5_swd_raw_access(adiv5_debug_port_s *dp, const uint8_t rnw, const u
 	 */
 	swd_proc.seq_out(0, 8U);
 
+	stats_record(STATS_SWD_ACCESS, start);
 	return response;
 }
 
+/*
+ * Run a packet without acting on its ACK, as is allowed with overrun detection on: the data phase always
+ * follows, whatever the ACK, and the next packet can start straight after without any idle cycles.
+ * A read's data with bad parity is reported as no response.
+ */
+static uint8_t adiv5_swd_unchecked_access(
+	const uint8_t rnw, const uint16_t addr, const uint32_t value, uint32_t *const result)
+{
+	swd_proc.seq_out(make_packet_request(rnw, addr), 8U);
+	const uint8_t ack = swd_proc.seq_in(3U);
+	if (rnw == ADIV5_LOW_WRITE) {
+		swd_proc.seq_out_parity(value, 32U);
+		return ack;
+	}
+	uint32_t data = 0U;
+	if (!swd_proc.seq_in_parity(&data, 32U))
+		return SWD_ACK_NO_RESPONSE;
+	if (result)
+		*result = data;
+	return ack;
+}
+
+/*
+ * Run a batch of DP and AP accesses back to back with overrun detection enabled, checking each ACK only to
+ * find where things went wrong rather than handling WAITs as they happen. If any access doesn't go through,
+ * the DP is recovered and everything from that access on is re-run one at a time, handling WAITs as normal.
+ */
+bool adiv5_swd_transfers(adiv5_debug_port_s *const dp, const adiv5_transfer_s *const transfers, const size_t count)
+{
+	if (dp->fault)
+		return false;
+	/* With ADIv6's DP bank 5 selected, the CTRL/STAT writes bracketing the batch would land in SELECT1 instead */
+	size_t failed = 0U;
+	const uint32_t ctrlstat = ADIV5_DP_CTRLSTAT_CSYSPWRUPREQ | ADIV5_DP_CTRLSTAT_CDBGPWRUPREQ;
+	if (dp->version < 3U) {
+		adiv5_swd_select_dp(dp);
+		const uint32_t enable = ctrlstat | ADIV5_DP_CTRLSTAT_ORUNDETECT;
+		uint8_t ack = adiv5_swd_unchecked_access(ADIV5_LOW_WRITE, ADIV5_DP_CTRLSTAT, enable, NULL);
+		/* An AP read only returns its result via the next access, so follow each one with a read of RDBUFF */
+		for (; ack == SWD_ACK_OK && failed < count; ++failed) {
+			const adiv5_transfer_s *const transfer = &transfers[failed];
+			ack = adiv5_swd_unchecked_access(transfer->rnw, transfer->addr, transfer->value, transfer->result);
+			if (ack == SWD_ACK_OK && transfer->rnw == ADIV5_LOW_READ && (transfer->addr & ADIV5_APnDP))
+				ack = adiv5_swd_unchecked_access(ADIV5_LOW_READ, ADIV5_DP_RDBUFF, 0U, transfer->result);
+			if (ack != SWD_ACK_OK)
+				break;
+		}
+		if (ack == SWD_ACK_OK)
+			ack = adiv5_swd_unchecked_access(ADIV5_LOW_WRITE, ADIV5_DP_CTRLSTAT, ctrlstat, NULL);
+		swd_proc.seq_out(0, 8U);
+		if (ack == SWD_ACK_OK)
+			return true;
+
+		if (ack == SWD_ACK_WAIT)
+			stats_event(STATS_SWD_WAIT, 1U);
+		DEBUG_PROBE("%s: batch failed at access %zu of %zu, retrying individually\n", __func__, failed, count);
+		/* Clear STICKYORUN and put overrun detection back the way it was before replaying the rest */
+		adiv5_swd_clear_error(dp, false);
+		adiv5_dp_low_access(dp, ADIV5_LOW_WRITE, ADIV5_DP_CTRLSTAT, ctrlstat);
+	}
+
+	for (size_t idx = failed; idx < count && !dp->fault; ++idx) {
+		const adiv5_transfer_s *const transfer = &transfers[idx];
+		if (transfer->rnw == ADIV5_LOW_READ)
+			*transfer->result = adiv5_dp_read(dp, transfer->addr);
+		else
+			adiv5_dp_write(dp, transfer->addr, transfer->value);
+	}
+	return !dp->fault;
+}
+
 void adiv5_swd_abort(adiv5_debug_port_s *dp, uint32_t abort)
 {
 	adiv5_dp_write(dp, ADIV5_DP_ABORT, abort);
@@ -72,6 +72,9 @@ bool adiv6_dp_init(adiv5_debug_port_s *const dp)
 #if CONFIG_BMDA == 1
 	bmda_adiv6_dp_init(dp);
 #endif
+	/* As for ADIv5, only keep the register shadows if the generic AP and memory access routines are in use */
+	dp->shadowing = dp->ap_write == adiv6_ap_reg_write && dp->mem_write == adiv5_mem_write_bytes;
+	adiv5_dp_shadow_invalidate(dp);
 
 	/* DPIDR1 is on bank 1 */
 	adiv5_dp_write(dp, ADIV5_DP_SELECT, ADIV5_DP_BANK1);
@@ -99,14 +102,8 @@ bool adiv6_dp_init(adiv5_debug_port_s *const dp)
 
 static uint32_t adiv6_dp_read_id(adiv6_access_port_s *const ap, const uint16_t addr)
 {
-	/*
-	 * Set up the DP resource bus to do the reads.
-	 * Set SELECT1 in the DP up first
-	 */
-	adiv5_dp_write(ap->base.dp, ADIV5_DP_SELECT, ADIV5_DP_BANK5);
-	adiv5_dp_write(ap->base.dp, ADIV6_DP_SELECT1, (uint32_t)(ap->ap_address >> 32U));
-	/* Now set up SELECT in the DP */
-	adiv5_dp_write(ap->base.dp, ADIV5_DP_SELECT, (uint32_t)ap->ap_address | (addr & ADIV6_AP_BANK_MASK));
+	/* Set up the DP resource bus to do the reads */
+	adi_ap_select(&ap->base, addr);
 	const uint16_t ap_reg_base = ADIV5_APnDP | (addr & ADIV6_AP_BANK_MASK);
 
 	uint32_t result = 0;
@@ -366,22 +363,16 @@ static bool adiv6_component_probe(adiv5_debug_port_s *const dp, const target_add
 
 uint32_t adiv6_ap_reg_read(adiv5_access_port_s *const base_ap, const uint16_t addr)
 {
-	adiv6_access_port_s *const ap = (adiv6_access_port_s *)base_ap;
-	/* Set SELECT1 in the DP up first */
-	adiv5_dp_write(base_ap->dp, ADIV5_DP_SELECT, ADIV5_DP_BANK5);
-	adiv5_dp_write(base_ap->dp, ADIV6_DP_SELECT1, (uint32_t)(ap->ap_address >> 32U));
-	/* Now set up SELECT in the DP */
-	adiv5_dp_write(base_ap->dp, ADIV5_DP_SELECT, (uint32_t)ap->ap_address | (addr & ADIV6_AP_BANK_MASK));
+	/* Set SELECT1 and SELECT in the DP up to address the AP register */
+	adi_ap_select(base_ap, addr);
+	adiv5_dp_shadow_access(base_ap->dp, ADIV5_LOW_READ, addr, 0U);
 	return base_ap->dp->dp_read(base_ap->dp, addr);
 }
 
 void adiv6_ap_reg_write(adiv5_access_port_s *const base_ap, const uint16_t addr, const uint32_t value)
 {
-	adiv6_access_port_s *const ap = (adiv6_access_port_s *)base_ap;
-	/* Set SELECT1 in the DP up first */
-	adiv5_dp_write(base_ap->dp, ADIV5_DP_SELECT, ADIV5_DP_BANK5);
-	adiv5_dp_write(base_ap->dp, ADIV6_DP_SELECT1, (uint32_t)(ap->ap_address >> 32U));
-	/* Now set up SELECT in the DP */
-	adiv5_dp_write(base_ap->dp, ADIV5_DP_SELECT, (uint32_t)ap->ap_address | (addr & ADIV6_AP_BANK_MASK));
+	/* Set SELECT1 and SELECT in the DP up to address the AP register */
+	adi_ap_select(base_ap, addr);
+	adiv5_dp_shadow_access(base_ap->dp, ADIV5_LOW_WRITE, addr, value);
 	base_ap->dp->low_access(base_ap->dp, ADIV5_LOW_WRITE, addr, value);
 }
@@ -36,6 +36,7 @@
 #include "target_internal.h"
 #include "cortexm.h"
 #include "stm32_common.h"
+#include "flashloader.h"
 
 static bool at32f43_cmd_option(target_s *target, int argc, const char **argv);
 static bool at32f43_cmd_uid(target_s *target, int argc, const char **argv);
@@ -69,6 +70,7 @@ static bool at32f43_mass_erase(target_s *target, platform_timeout_s *print_proge
 #define AT32F43x_FLASH_CTRL_FPRGM   (1U << 0U)
 #define AT32F43x_FLASH_CTRL_SECERS  (1U << 1U)
 #define AT32F43x_FLASH_CTRL_BANKERS (1U << 2U)
+#define AT32F43x_FLASH_CTRL_BLKERS  (1U << 3U)
 #define AT32F43x_FLASH_CTRL_USDPRGM (1U << 4U)
 #define AT32F43x_FLASH_CTRL_USDERS  (1U << 5U)
 #define AT32F43x_FLASH_CTRL_ERSTR   (1U << 6U)
@@ -84,6 +86,9 @@ static bool at32f43_mass_erase(target_s *target, platform_timeout_s *print_proge
 
 #define AT32F43x_FLASH_USD_RDP (1U << 1U)
 
+/* Block erase operates on 64 KB at once for all F43x parts */
+#define AT32F43x_FLASH_BLOCK_SIZE 0x10000U
+
 #define AT32F43x_FLASH_KEY1 0x45670123U
 #define AT32F43x_FLASH_KEY2 0xcdef89abU
 
@@ -140,7 +145,7 @@ typedef struct at32f43_flash {
 } at32f43_flash_s;
 
 static void at32f43_add_flash(target_s *const target, const target_addr_t addr, const size_t length,
-	const size_t pagesize, const uint32_t bank_reg_offset)
+	const size_t pagesize, const size_t block_size, const uint32_t bank_reg_offset)
 {
 	if (length == 0)
 		return;
@@ -155,11 +160,12 @@ static void at32f43_add_flash(target_s *const target, const target_addr_t addr,
 	target_flash->start = addr;
 	target_flash->length = length;
 	target_flash->blocksize = pagesize;
+	target_flash->erase_span = block_size;
 	target_flash->prepare = at32f43_flash_prepare;
 	target_flash->erase = at32f43_flash_erase;
 	target_flash->write = at32f43_flash_write;
 	target_flash->done = at32f43_flash_done;
-	target_flash->writesize = 1024U;
+	target_flash->writesize = 4096U;
 	target_flash->erased = 0xffU;
 	flash->bank_reg_offset = bank_reg_offset;
 	target_add_flash(target, target_flash);
@@ -272,14 +278,14 @@ static bool at32f43_detect(target_s *target, const uint16_t part_id)
 		return false;
 	}
 	/*
-	 * Arterytek F43x Flash controller has BLKERS (1<<3U).
-	 * Block erase operates on 64 KB at once for all parts.
-	 * Using here only sector erase (page erase) for compatibility.
+	 * Arterytek F43x Flash controller has BLKERS (1<<3U), so aligned 64 KB runs get block erased
+	 * while anything smaller falls back to sector erase.
 	 */
-	at32f43_add_flash(target, 0x08000000, flash_size_bank1, sector_size, AT32F43x_FLASH_BANK1_REG_OFFSET);
+	at32f43_add_flash(target, 0x08000000, flash_size_bank1, sector_size, AT32F43x_FLASH_BLOCK_SIZE,
+		AT32F43x_FLASH_BANK1_REG_OFFSET);
 	if (flash_size_bank2 > 0)
-		at32f43_add_flash(
-			target, 0x08000000 + flash_size_bank1, flash_size_bank2, sector_size, AT32F43x_FLASH_BANK2_REG_OFFSET);
+		at32f43_add_flash(target, 0x08000000 + flash_size_bank1, flash_size_bank2, sector_size,
+			AT32F43x_FLASH_BLOCK_SIZE, AT32F43x_FLASH_BANK2_REG_OFFSET);
 
 	// SRAM1 (64KB) can be remapped to 0x10000000.
 	target_add_ram32(target, 0x20000000, 64U * 1024U);
@@ -313,7 +319,7 @@ static bool at32f405_detect(target_s *target, const uint32_t series)
 	 */
 	const uint16_t flash_size = target_mem32_read16(target, AT32F4x_FLASHSIZE);
 	const uint16_t sector_size = series == AT32F405_SERIES_128KB ? 1024U : 2048U;
-	at32f43_add_flash(target, 0x08000000, flash_size * 1024U, sector_size, AT32F43x_FLASH_BANK1_REG_OFFSET);
+	at32f43_add_flash(target, 0x08000000, flash_size * 1024U, sector_size, 0U, AT32F43x_FLASH_BANK1_REG_OFFSET);
 
 	/*
 	 * Either 96 or 102 KiB of SRAM, depending on USD bit 7 nRAM_PRT_CHK:
@@ -345,7 +351,7 @@ static bool at32f423_detect(target_s *target, const uint32_t series)
 	 */
 	const uint16_t flash_size = target_mem32_read16(target, AT32F4x_FLASHSIZE);
 	const uint16_t sector_size = series == AT32F423_SERIES_256KB ? 2048U : 1024U;
-	at32f43_add_flash(target, 0x08000000, flash_size * 1024U, sector_size, AT32F43x_FLASH_BANK1_REG_OFFSET);
+	at32f43_add_flash(target, 0x08000000, flash_size * 1024U, sector_size, 0U, AT32F43x_FLASH_BANK1_REG_OFFSET);
 
 	target_add_ram32(target, 0x20000000, 48U * 1024U);
 	target->driver = "AT32F423";
@@ -481,7 +487,8 @@ static bool at32f43_flash_erase(target_flash_s *target_flash, target_addr_t addr
 	const at32f43_flash_s *const flash = (at32f43_flash_s *)target_flash;
 	const uint32_t bank_reg_offset = flash->bank_reg_offset;
 
-	if (len != target_flash->blocksize) {
+	const bool block_erase = target_flash->erase_span && len == target_flash->erase_span;
+	if (len != target_flash->blocksize && !block_erase) {
 		DEBUG_ERROR(
 			"%s: Requested erase length %zu does not match blocksize %zu!\n", __func__, len, target_flash->blocksize);
 		return false;
@@ -491,15 +498,15 @@ static bool at32f43_flash_erase(target_flash_s *target_flash, target_addr_t addr
 	DEBUG_TARGET("%s: 0x%08" PRIX32 "+%" PRIu32 " reg_base 0x%08" PRIX32 "\n", __func__, addr, (uint32_t)len,
 		bank_reg_offset + AT32F43x_FLASH_REG_BASE);
 
-	/* Prepare for page/sector erase */
-	target_mem32_write32(target, AT32F43x_FLASH_CTRL + bank_reg_offset, AT32F43x_FLASH_CTRL_SECERS);
-	/* Select erased sector by its address */
+	/* Prepare for page/sector or block erase */
+	const uint32_t erase_mode = block_erase ? AT32F43x_FLASH_CTRL_BLKERS : AT32F43x_FLASH_CTRL_SECERS;
+	target_mem32_write32(target, AT32F43x_FLASH_CTRL + bank_reg_offset, erase_mode);
+	/* Select erased sector or block by its address */
 	target_mem32_write32(target, AT32F43x_FLASH_ADDR + bank_reg_offset, addr);
-	/* Start sector erase operation */
-	target_mem32_write32(
-		target, AT32F43x_FLASH_CTRL + bank_reg_offset, AT32F43x_FLASH_CTRL_SECERS | AT32F43x_FLASH_CTRL_ERSTR);
+	/* Start the erase operation */
+	target_mem32_write32(target, AT32F43x_FLASH_CTRL + bank_reg_offset, erase_mode | AT32F43x_FLASH_CTRL_ERSTR);
 
-	/* Datasheet: page erase takes 50ms (typ), 500ms (max) */
+	/* Datasheet: page erase takes 50ms (typ), 500ms (max), block erase proportionally longer */
 	return at32f43_flash_busy_wait(target, bank_reg_offset, NULL);
 }
 
@@ -516,7 +523,21 @@ static bool at32f43_flash_write(target_flash_s *target_flash, target_addr_t dest
 
 	/* Write to bank corresponding to flash region */
 	target_mem32_write32(target, AT32F43x_FLASH_CTRL + bank_reg_offset, AT32F43x_FLASH_CTRL_FPRGM);
-	cortexm_mem_write_aligned(target, dest, src, len, psize);
+	/* If there's enough RAM on the target, have the RAM-resident loader do the programming and polling */
+	if (flashloader_usable(target, len)) {
+		const flashloader_params_s params = {
+			.status_reg = AT32F43x_FLASH_STS + bank_reg_offset,
+			.busy_mask = AT32F43x_FLASH_STS_OBF,
+			.error_mask = AT32F43x_FLASH_STS_PRGMERR | AT32F43x_FLASH_STS_EPPERR,
+			.access_width = 4U,
+		};
+		if (!flashloader_write(target, &params, dest, src, len)) {
+			DEBUG_ERROR("at32f43 flash loader failed, STS: 0x%" PRIx32 "\n",
+				target_mem32_read32(target, AT32F43x_FLASH_STS + bank_reg_offset));
+			return false;
+		}
+	} else
+		cortexm_mem_write_aligned(target, dest, src, len, psize);
 
 	/* Datasheet: flash programming takes 50us (typ), 200us (max) */
 	return at32f43_flash_busy_wait(target, bank_reg_offset, NULL);
@@ -0,0 +1,259 @@
+/*
+ * This file is part of the Black Magic Debug project.
+ *
+ * Copyright (C) 2026 1BitSquared <info@1bitsquared.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * This file implements a fixed benchmark suite for the current probe, link and target combination.
+ * Each benchmark repeats one operation for BENCH_DURATION_MS and reports a single line of the form
+ *   bench <name> ops=<count> ms=<elapsed> rate=<ops per second> latency=<us per op>
+ * or, for the throughput benchmarks,
+ *   bench <name> bytes=<count> ms=<elapsed> rate=<bytes per second>
+ * so the output can be consumed by scripts as well as read directly.
+ *
+ * The RAM benchmarks only ever write back what they read from the first RAM region, and the halt/resume
+ * benchmark puts the registers back afterwards, so the suite leaves the target as it found it. The Flash
+ * benchmarks are the exception and are only run when explicitly requested.
+ */
+
+#include "general.h"
+#include "target.h"
+#include "target_internal.h"
+#include "cortexm.h"
+#include "cortex.h"
+#include "adiv5.h"
+#include "bench.h"
+
+#define BENCH_DURATION_MS     250U
+#define BENCH_BUFFER_SIZE     1024U
+#define BENCH_FLASH_SPAN      16384U
+#define BENCH_HALT_TIMEOUT_MS 500U
+
+typedef enum bench_kind {
+	BENCH_LATENCY, /* Reported as operations per second and time per operation */
+	BENCH_BYTES,   /* Each run moves one byte, reported as bytes per second */
+	BENCH_BLOCK,   /* Each run moves the whole buffer, reported as bytes per second */
+} bench_kind_e;
+
+typedef struct bench_state {
+	target_addr32_t ram_addr;
+	uint8_t *buffer;
+	size_t buffer_len;
+	size_t offset;
+} bench_state_s;
+
+typedef struct bench {
+	const char *name;
+	bench_kind_e kind;
+	bool needs_dp;
+	bool (*run)(target_s *target, bench_state_s *state);
+} bench_s;
+
+static void bench_report(target_s *const target, const char *const name, const bench_kind_e kind,
+	const uint64_t amount, const uint32_t elapsed_ms)
+{
+	const uint32_t ms = elapsed_ms ? elapsed_ms : 1U;
+	const uint32_t rate = (uint32_t)((amount * 1000U) / ms);
+	if (kind != BENCH_LATENCY)
+		tc_printf(target, "bench %s bytes=%" PRIu32 " ms=%" PRIu32 " rate=%" PRIu32 "\n", name, (uint32_t)amount,
+			elapsed_ms, rate);
+	else
+		tc_printf(target, "bench %s ops=%" PRIu32 " ms=%" PRIu32 " rate=%" PRIu32 " latency=%" PRIu32 "\n", name,
+			(uint32_t)amount, elapsed_ms, rate, amount ? (uint32_t)(((uint64_t)ms * 1000U) / amount) : 0U);
+}
+
+static bool bench_dp_read(target_s *const target, bench_state_s *const state)
+{
+	(void)state;
+	adiv5_debug_port_s *const dp = cortex_ap(target)->dp;
+	adiv5_dp_read(dp, ADIV5_DP_CTRLSTAT);
+	return !target_check_error(target);
+}
+
+static bool bench_mem32_read_word(target_s *const target, bench_state_s *const state)
+{
+	target_mem32_read32(target, state->ram_addr);
+	return !target_check_error(target);
+}
+
+static bool bench_mem32_read(target_s *const target, bench_state_s *const state)
+{
+	return !target_mem32_read(target, state->buffer, state->ram_addr, state->buffer_len);
+}
+
+static bool bench_mem32_write(target_s *const target, bench_state_s *const state)
+{
+	/* Writes back exactly what was read from the RAM to begin with */
+	return !target_mem32_write(target, state->ram_addr, state->buffer, state->buffer_len);
+}
+
+static bool bench_mem8_read(target_s *const target, bench_state_s *const state)
+{
+	target_mem32_read8(target, state->ram_addr + state->offset);
+	state->offset = (state->offset + 1U) % state->buffer_len;
+	return !target_check_error(target);
+}
+
+static bool bench_mem8_write(target_s *const target, bench_state_s *const state)
+{
+	const bool result = target_mem32_write8(target, state->ram_addr + state->offset, state->buffer[state->offset]);
+	state->offset = (state->offset + 1U) % state->buffer_len;
+	return result && !target_check_error(target);
+}
+
+static bool bench_reg_read(target_s *const target, bench_state_s *const state)
+{
+	(void)state;
+	/* Make sure each read actually goes to the core rather than being answered from the register cache */
+	if (target_is_cortexm(target))
+		cortexm_reg_cache_invalidate(target);
+	uint32_t value = 0U;
+	return target_reg_read(target, 0U, &value, sizeof(value)) == sizeof(value) && !target_check_error(target);
+}
+
+static bool bench_halt_resume(target_s *const target, bench_state_s *const state)
+{
+	(void)state;
+	target_halt_resume(target, false);
+	target_halt_request(target);
+	platform_timeout_s timeout;
+	platform_timeout_set(&timeout, BENCH_HALT_TIMEOUT_MS);
+	target_halt_reason_e reason = TARGET_HALT_RUNNING;
+	while (reason == TARGET_HALT_RUNNING) {
+		if (platform_timeout_is_expired(&timeout))
+			return false;
+		reason = target_halt_poll(target, NULL);
+	}
+	return reason != TARGET_HALT_ERROR;
+}
+
+static const bench_s bench_list[] = {
+	{"dp_read", BENCH_LATENCY, true, bench_dp_read},
+	{"mem32_read_word", BENCH_LATENCY, false, bench_mem32_read_word},
+	{"mem32_read", BENCH_BLOCK, false, bench_mem32_read},
+	{"mem32_write", BENCH_BLOCK, false, bench_mem32_write},
+	{"mem8_read", BENCH_BYTES, false, bench_mem8_read},
+	{"mem8_write", BENCH_BYTES, false, bench_mem8_write},
+	{"reg_read", BENCH_LATENCY, false, bench_reg_read},
+	{"halt_resume", BENCH_LATENCY, false, bench_halt_resume},
+};
+
+static bool bench_one(target_s *const target, const bench_s *const bench, bench_state_s *const state)
+{
+	const size_t amount_per_run = bench->kind == BENCH_BLOCK ? state->buffer_len : 1U;
+	uint64_t amount = 0U;
+	state->offset = 0U;
+
+	const uint32_t start = platform_time_ms();
+	uint32_t elapsed = 0U;
+	while (elapsed < BENCH_DURATION_MS) {
+		if (!bench->run(target, state)) {
+			tc_printf(target, "bench %s failed\n", bench->name);
+			return false;
+		}
+		amount += amount_per_run;
+		elapsed = platform_time_ms() - start;
+	}
+	bench_report(target, bench->name, bench->kind, amount, elapsed);
+	return true;
+}
+
+static bool bench_flash(target_s *const target, const bench_state_s *const state)
+{
+	target_flash_s *flash = target->flash;
+	for (target_flash_s *candidate = target->flash; candidate; candidate = candidate->next) {
+		if (candidate->start < flash->start)
+			flash = candidate;
+	}
+	if (!flash || !flash->blocksize) {
+		tc_printf(target, "bench flash skipped, no Flash\n");
+		return true;
+	}
+
+	/* Work on a whole number of blocks at the end of the region, around BENCH_FLASH_SPAN in size */
+	const size_t blocks = MIN((BENCH_FLASH_SPAN + flash->blocksize - 1U) / flash->blocksize,
+		flash->length / flash->blocksize);
+	const size_t span = blocks * flash->blocksize;
+	const target_addr_t addr = flash->start + flash->length - span;
+
+	uint32_t start = platform_time_ms();
+	bool result = target_flash_erase(target, addr, span) && target_flash_complete(target);
+	if (!result) {
+		tc_printf(target, "bench flash_erase failed\n");
+		return false;
+	}
+	bench_report(target, "flash_erase", BENCH_BLOCK, span, platform_time_ms() - start);
+
+	start = platform_time_ms();
+	for (size_t offset = 0U; result && offset < span; offset += state->buffer_len)
+		result = target_flash_write(target, addr + offset, state->buffer, MIN(state->buffer_len, span - offset));
+	result = target_flash_complete(target) && result;
+	if (!result) {
+		tc_printf(target, "bench flash_write failed\n");
+		return false;
+	}
+	bench_report(target, "flash_write", BENCH_BLOCK, span, platform_time_ms() - start);
+
+	/* Leave the span erased rather than full of test pattern */
+	return target_flash_erase(target, addr, span) && target_flash_complete(target);
+}
+
+bool bench_run(target_s *const target, const bool flash)
+{
+	const target_ram_s *const ram = target->ram;
+	if (!ram) {
+		tc_printf(target, "bench needs a target with RAM\n");
+		return false;
+	}
+
+	bench_state_s state = {
+		.ram_addr = ram->start,
+		.buffer_len = MIN(ram->length, BENCH_BUFFER_SIZE),
+	};
+	state.buffer = malloc(state.buffer_len);
+	uint8_t *const saved_regs = malloc(target->regs_size);
+	if (!state.buffer || !saved_regs) { /* malloc failed: heap exhaustion */
+		DEBUG_ERROR("malloc: failed in %s\n", __func__);
+		free(state.buffer);
+		free(saved_regs);
+		return false;
+	}
+
+	/* Everything gets written back as it was found, starting with the RAM contents */
+	bool result = !target_mem32_read(target, state.buffer, state.ram_addr, state.buffer_len);
+	target_regs_read(target, saved_regs);
+
+	for (size_t idx = 0U; result && idx < ARRAY_LENGTH(bench_list); ++idx) {
+		const bench_s *const bench = &bench_list[idx];
+		/* DP accesses are only meaningful for targets sitting behind an ADIv5 DP */
+		if (bench->needs_dp && !target_is_cortexm(target))
+			continue;
+		result = bench_one(target, bench, &state);
+	}
+	target_regs_write(target, saved_regs);
+
+	if (result && flash) {
+		/* Use a recognisable pattern for the Flash writes rather than the RAM contents */
+		for (size_t idx = 0U; idx < state.buffer_len; ++idx)
+			state.buffer[idx] = (uint8_t)idx;
+		result = bench_flash(target, &state);
+	}
+
+	free(saved_regs);
+	free(state.buffer);
+	return result;
+}
@@ -0,0 +1,31 @@
+/*
+ * This file is part of the Black Magic Debug project.
+ *
+ * Copyright (C) 2026 1BitSquared <info@1bitsquared.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef TARGET_BENCH_H
+#define TARGET_BENCH_H
+
+#include "target.h"
+
+/*
+ * Run the benchmark suite against an attached, halted target, reporting each result through tc_printf().
+ * If flash is true, the end of the lowest Flash region is also erased and rewritten to time those operations.
+ */
+bool bench_run(target_s *target, bool flash);
+
+#endif /* TARGET_BENCH_H */
@@ -25,6 +25,8 @@
  * /!\ There is some sort of bus stall/bus arbitration going on that does NOT work when
  * programmed through SWD/jtag
  * The workaround is to wait a few cycles before filling the write buffer. This is performed by reading the flash a few times
+ * When the target has enough free RAM, writes instead use standard half-word programming driven by the shared
+ * RAM-resident loader (see flashloader.c), so none of the programming traffic goes over SWD at all
  */
 
 #include "general.h"
@@ -32,6 +34,7 @@
 #include "target_internal.h"
 #include "cortex.h"
 #include "stm32_common.h"
+#include "flashloader.h"
 
 // These are common with stm32f1/gd32f1/...
 #define FPEC_BASE     0x40022000U
@@ -40,6 +43,7 @@
 #define FLASH_SR      (FPEC_BASE + 0x0cU)
 #define FLASH_CR      (FPEC_BASE + 0x10U)
 #define FLASH_AR      (FPEC_BASE + 0x14U)
+#define FLASH_CR_PG   (1U << 0U)
 #define FLASH_CR_LOCK (1U << 7U)
 #define FLASH_CR_STRT (1U << 6U)
 #define FLASH_SR_BSY  (1U << 0U)
@@ -82,7 +86,8 @@ static void ch32f1_add_flash(target_s *target, uint32_t addr, size_t length, siz
 	flash->blocksize = erasesize;
 	flash->erase = ch32f1_flash_erase;
 	flash->write = ch32f1_flash_write;
-	flash->writesize = erasesize;
+	/* Fast mode programs 128 bytes at a time regardless, so hand over bigger chunks for the loader's benefit */
+	flash->writesize = 1024U;
 	flash->erased = 0xffU;
 	target_add_flash(target, flash);
 }
@@ -311,11 +316,40 @@ static int ch32f1_buffer_clear(target_s *const target)
 /*
  * CH32 implementation of Flash write using the CH32-specific fast write
  */
+/* Standard (half-word) programming, done entirely on the target by the RAM-resident loader */
+static bool ch32f1_flash_write_loader(
+	target_s *const target, const target_addr_t dest, const void *const src, const size_t len)
+{
+	if (!ch32f1_flash_unlock(target) || !ch32f1_flash_busy_wait(target))
+		return false;
+	target_mem32_write32(target, FLASH_SR, FLASH_SR_EOP | SR_ERROR_MASK);
+	ch32f1_flash_ctrl_set(target, FLASH_CR_PG);
+
+	const flashloader_params_s params = {
+		.status_reg = FLASH_SR,
+		.busy_mask = FLASH_SR_BSY,
+		.error_mask = SR_ERROR_MASK,
+		.access_width = 2U,
+	};
+	const bool result = flashloader_write(target, &params, dest, src, len);
+
+	ch32f1_flash_ctrl_clear(target, FLASH_CR_PG);
+	const uint32_t status = target_mem32_read32(target, FLASH_SR);
+	ch32f1_flash_lock(target);
+	if (!result || (status & SR_ERROR_MASK)) {
+		DEBUG_ERROR("ch32f1 flash loader failed, status 0x%" PRIx32 "\n", status);
+		return false;
+	}
+	return true;
+}
+
 static bool ch32f1_flash_write(
 	target_flash_s *const flash, const target_addr_t dest, const void *const src, const size_t len)
 {
 	uint32_t status;
 	target_s *const target = flash->t;
+	if (flashloader_usable(target, len))
+		return ch32f1_flash_write_loader(target, dest, src, len);
 #ifdef CH32_VERIFY
 	target_addr_t org_dest = dest;
 	const uint8_t *org_src = (const uint8_t *)src;
@@ -61,6 +61,11 @@ bool cortex_check_error(target_s *const target)
 	return adiv5_dp_error(ap->dp) != 0;
 }
 
+bool cortex_check_fault(target_s *const target)
+{
+	return cortex_ap(target)->dp->fault != 0U;
+}
+
 uint32_t cortex_dbg_read32(target_s *const target, const uint16_t src)
 {
 	/* Translate the offset given in the src parameter into an address in the debug address space and read */
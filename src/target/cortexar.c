@@ -78,6 +78,11 @@ typedef struct cortexar_priv {
 
 	/* Control and status information */
 	uint8_t core_status;
+
+	/* System bus MEM-AP to use for bulk memory access, and the address window it covers */
+	adiv5_access_port_s *bus_ap;
+	target_addr_t bus_start;
+	size_t bus_length;
 } cortexar_priv_s;
 
 #define CORTEXAR_DBG_IDR   0x000U /* ID register */
@@ -320,7 +325,8 @@ static const uint16_t cortexar_spsr_encodings[5] = {
 /* SCTLR System Control Register */
 #define CORTEXAR_SCTLR 15U, ENCODE_CP_REG(1U, 0U, 0U, 0U)
 
-#define CORTEXAR_SCTLR_MMU_ENABLED (1U << 0U)
+#define CORTEXAR_SCTLR_MMU_ENABLED    (1U << 0U)
+#define CORTEXAR_SCTLR_DCACHE_ENABLED (1U << 2U)
 
 #define CORTEXAR_CPACR_CP10_FULL_ACCESS 0x00300000U
 #define CORTEXAR_CPACR_CP11_FULL_ACCESS 0x00c00000U
@@ -353,34 +359,60 @@ static const uint16_t cortexar_spsr_encodings[5] = {
 #define CORTEXAR_STATUS_MMU_FAULT         (1U << 1U)
 #define CORTEXAR_STATUS_FAULT_CACHE_VALID (1U << 2U)
 
+/* Accesses smaller than this stay on the core path even when a system bus MEM-AP is available */
+#define CORTEXAR_BUS_AP_MIN_TRANSFER 64U
+
 /*
- * Fields for Cortex-R special-purpose registers, used in the generation of GDB's target description XML.
- * The general-purpose registers r0-r12 and the vector floating point (VFP) registers d0-d15 all follow a
- * very regular format, so we only need to store fields for the special-purpose registers.
- * The array for each SPR field have the same order as each other, making each of these pseudo
- * 'associative array's.
+ * GDB's target description XML for Cortex-A/R parts, put together from fixed pieces at compile time.
+ * CPSR is remapped to register 25 to line up with the ARM core feature, CORTEXAR_CPSR_GDB_REMAP_POS
+ * being used for this mapping elsewhere in the logic. Cores with a FPU (VFP) then get its registers.
  */
-
-/* Cortex-R special-purpose register name strings */
-static const char *cortexr_spr_names[] = {
-	"sp",
-	"lr",
-	"pc",
-	"cpsr",
-};
-
-/* Cortex-R special-purpose register types */
-static const gdb_reg_type_e cortexr_spr_types[] = {
-	GDB_TYPE_DATA_PTR,    /* sp */
-	GDB_TYPE_CODE_PTR,    /* lr */
-	GDB_TYPE_CODE_PTR,    /* pc */
-	GDB_TYPE_UNSPECIFIED, /* cpsr */
-};
-
 /* clang-format off */
-static_assert(ARRAY_LENGTH(cortexr_spr_types) == ARRAY_LENGTH(cortexr_spr_names),
-	"SPR array length mistmatch! SPR type array should have the same length as SPR name array."
-);
+static const target_description_piece_s cortexar_description[] = {
+	{0U,
+		GDB_XML_PREAMBLE("arm")
+		GDB_XML_FEATURE("org.gnu.gdb.arm.core")
+		GDB_XML_REG("r0", 32, "")
+		GDB_XML_REG("r1", 32, "")
+		GDB_XML_REG("r2", 32, "")
+		GDB_XML_REG("r3", 32, "")
+		GDB_XML_REG("r4", 32, "")
+		GDB_XML_REG("r5", 32, "")
+		GDB_XML_REG("r6", 32, "")
+		GDB_XML_REG("r7", 32, "")
+		GDB_XML_REG("r8", 32, "")
+		GDB_XML_REG("r9", 32, "")
+		GDB_XML_REG("r10", 32, "")
+		GDB_XML_REG("r11", 32, "")
+		GDB_XML_REG("r12", 32, "")
+		GDB_XML_REG("sp", 32, GDB_XML_TYPE_DATA_PTR)
+		GDB_XML_REG("lr", 32, GDB_XML_TYPE_CODE_PTR)
+		GDB_XML_REG("pc", 32, GDB_XML_TYPE_CODE_PTR)
+		GDB_XML_REG("cpsr", 32, GDB_XML_REGNUM(25))
+	},
+	{TOPT_FLAVOUR_FLOAT,
+		GDB_XML_FEATURE_END
+		GDB_XML_FEATURE("org.gnu.gdb.arm.vfp")
+		GDB_XML_REG("d0", 64, " type=\"ieee_double\"")
+		GDB_XML_REG("d1", 64, " type=\"ieee_double\"")
+		GDB_XML_REG("d2", 64, " type=\"ieee_double\"")
+		GDB_XML_REG("d3", 64, " type=\"ieee_double\"")
+		GDB_XML_REG("d4", 64, " type=\"ieee_double\"")
+		GDB_XML_REG("d5", 64, " type=\"ieee_double\"")
+		GDB_XML_REG("d6", 64, " type=\"ieee_double\"")
+		GDB_XML_REG("d7", 64, " type=\"ieee_double\"")
+		GDB_XML_REG("d8", 64, " type=\"ieee_double\"")
+		GDB_XML_REG("d9", 64, " type=\"ieee_double\"")
+		GDB_XML_REG("d10", 64, " type=\"ieee_double\"")
+		GDB_XML_REG("d11", 64, " type=\"ieee_double\"")
+		GDB_XML_REG("d12", 64, " type=\"ieee_double\"")
+		GDB_XML_REG("d13", 64, " type=\"ieee_double\"")
+		GDB_XML_REG("d14", 64, " type=\"ieee_double\"")
+		GDB_XML_REG("d15", 64, " type=\"ieee_double\"")
+		GDB_XML_REG("fpscr", 32, "")
+	},
+	{0U, GDB_XML_FEATURE_END "</target>"},
+};
 /* clang-format on */
 
 static bool cortexar_check_error(target_s *target);
@@ -405,7 +437,7 @@ static void cortexar_config_breakpoint(target_s *target, size_t slot, uint32_t m
 bool cortexar_attach(target_s *target);
 void cortexar_detach(target_s *target);
 
-static const char *cortexar_target_description(target_s *target);
+static void cortexar_target_description(target_s *target, target_description_stream_s *stream);
 
 static void cortexar_banked_dcc_mode(target_s *const target)
 {
@@ -490,6 +522,56 @@ static bool cortexar_run_write_insn(target_s *const target, const uint32_t insn,
 	return true;
 }
 
+/*
+ * Switch the DCC into Stall mode, where ITR writes wait for the previous instruction to complete and DTR accesses
+ * wait for the core, so instruction/DTR sequences can be queued up without polling DSCR in between.
+ * Returns the DSCR value to hand back to cortexar_dcc_stall_mode_exit().
+ */
+static uint32_t cortexar_dcc_stall_mode_enter(target_s *const target)
+{
+	const cortexar_priv_s *const priv = (const cortexar_priv_s *)target->priv;
+	/* Make sure we're in banked mode */
+	cortexar_banked_dcc_mode(target);
+	const uint32_t dbg_dcsr =
+		adiv5_dp_read(priv->base.ap->dp, ADIV5_AP_DB(CORTEXAR_BANKED_DCSR)) & ~CORTEXAR_DBG_DCSR_DCC_MASK;
+	adiv5_dp_write(priv->base.ap->dp, ADIV5_AP_DB(CORTEXAR_BANKED_DCSR), dbg_dcsr | CORTEXAR_DBG_DCSR_DCC_STALL);
+	return dbg_dcsr;
+}
+
+/* Run everything queued in Stall mode, then go back to DCC Normal (Non-blocking) mode */
+static bool cortexar_dcc_stall_mode_exit(target_s *const target, const uint32_t dbg_dcsr)
+{
+	const cortexar_priv_s *const priv = (const cortexar_priv_s *)target->priv;
+	adiv5_dp_queue_flush(priv->base.ap->dp);
+	/* Now read out the status from the DCSR in case anything went wrong */
+	const uint32_t status = adiv5_dp_read(priv->base.ap->dp, ADIV5_AP_DB(CORTEXAR_BANKED_DCSR));
+	adiv5_dp_write(priv->base.ap->dp, ADIV5_AP_DB(CORTEXAR_BANKED_DCSR), dbg_dcsr | CORTEXAR_DBG_DCSR_DCC_NORMAL);
+	return cortexar_check_data_abort(target, status);
+}
+
+/* Queue an instruction for the core to run. Only valid in DCC Stall mode */
+static inline void cortexar_queue_insn(target_s *const target, const uint32_t insn)
+{
+	const cortexar_priv_s *const priv = (const cortexar_priv_s *)target->priv;
+	adiv5_dp_queue_write(priv->base.ap->dp, ADIV5_AP_DB(CORTEXAR_BANKED_ITR), insn);
+}
+
+/* Queue reading a GPR other than the PC back via the DTR. Only valid in DCC Stall mode */
+static inline void cortexar_queue_core_reg_read(target_s *const target, const uint8_t reg, uint32_t *const value)
+{
+	const cortexar_priv_s *const priv = (const cortexar_priv_s *)target->priv;
+	cortexar_queue_insn(target, ARM_MCR_INSN | ENCODE_CP_ACCESS(14, 0, reg, 0, 5, 0));
+	adiv5_dp_queue_read(priv->base.ap->dp, ADIV5_AP_DB(CORTEXAR_BANKED_DTRRX), value);
+}
+
+/* Queue writing a GPR other than the PC via the DTR. Only valid in DCC Stall mode */
+static inline void cortexar_queue_core_reg_write(target_s *const target, const uint8_t reg, const uint32_t value)
+{
+	const cortexar_priv_s *const priv = (const cortexar_priv_s *)target->priv;
+	adiv5_dp_queue_write(priv->base.ap->dp, ADIV5_AP_DB(CORTEXAR_BANKED_DTRTX), value);
+	cortexar_queue_insn(target, ARM_MRC_INSN | ENCODE_CP_ACCESS(14, 0, reg, 0, 5, 0));
+}
+
 static inline uint32_t cortexar_core_reg_read(target_s *const target, const uint8_t reg)
 {
 	/* If the register is a GPR and not the program counter, use a "simple" MCR to read */
@@ -511,38 +593,48 @@ static inline uint32_t cortexar_core_reg_read(target_s *const target, const uint
 static void cortexar_core_regs_save(target_s *const target)
 {
 	cortexar_priv_s *const priv = (cortexar_priv_s *)target->priv;
-	/* Save out r0-r15 in that order (r15, aka pc, clobbers r0) */
-	for (size_t i = 0U; i < ARRAY_LENGTH(priv->core_regs.r); ++i)
-		priv->core_regs.r[i] = cortexar_core_reg_read(target, i);
+	/* Queue the whole save sequence up in Stall mode so it runs in as few adaptor round trips as possible */
+	const uint32_t dbg_dcsr = cortexar_dcc_stall_mode_enter(target);
+	/* Save out r0-r14 in that order */
+	for (size_t i = 0U; i < CORTEX_REG_PC; ++i)
+		cortexar_queue_core_reg_read(target, i, &priv->core_regs.r[i]);
+	/* Extract the program counter (r15) to r0 and retrieve it */
+	cortexar_queue_insn(target, ARM_MOV_R0_PC_INSN);
+	cortexar_queue_core_reg_read(target, 0U, &priv->core_regs.r[CORTEX_REG_PC]);
 	/* Read CPSR to r0 and retrieve it */
-	cortexar_run_insn(target, ARM_MRS_R0_CPSR_INSN);
-	priv->core_regs.cpsr = cortexar_core_reg_read(target, 0U);
-	/* Adjust the program counter according to the mode */
-	priv->core_regs.r[CORTEX_REG_PC] -= (priv->core_regs.cpsr & CORTEXAR_CPSR_THUMB) ? 4U : 8U;
+	cortexar_queue_insn(target, ARM_MRS_R0_CPSR_INSN);
+	cortexar_queue_core_reg_read(target, 0U, &priv->core_regs.cpsr);
 	/* Read the SPSRs into r0 and retrieve them */
 	for (size_t i = 0; i < ARRAY_LENGTH(priv->core_regs.spsr); ++i) {
 		/* Build and issue the banked MRS for the required SPSR */
-		cortexar_run_insn(target, ARM_MRS_R0_SPSR_INSN | (cortexar_spsr_encodings[i] << 4U));
-		priv->core_regs.spsr[i] = cortexar_core_reg_read(target, 0U);
+		cortexar_queue_insn(target, ARM_MRS_R0_SPSR_INSN | (cortexar_spsr_encodings[i] << 4U));
+		cortexar_queue_core_reg_read(target, 0U, &priv->core_regs.spsr[i]);
 	}
+	cortexar_dcc_stall_mode_exit(target, dbg_dcsr);
+	/* Adjust the program counter according to the mode */
+	priv->core_regs.r[CORTEX_REG_PC] -= (priv->core_regs.cpsr & CORTEXAR_CPSR_THUMB) ? 4U : 8U;
 }
 
 static void cortexar_float_regs_save(target_s *const target)
 {
 	cortexar_priv_s *const priv = (cortexar_priv_s *)target->priv;
+	uint32_t d_halves[ARRAY_LENGTH(priv->core_regs.d) * 2U];
+	const uint32_t dbg_dcsr = cortexar_dcc_stall_mode_enter(target);
 	/* Read FPCSR to r0 and retrieve it */
-	cortexar_run_insn(target, ARM_VMRS_R0_FPCSR_INSN);
-	priv->core_regs.fpcsr = cortexar_core_reg_read(target, 0U);
+	cortexar_queue_insn(target, ARM_VMRS_R0_FPCSR_INSN);
+	cortexar_queue_core_reg_read(target, 0U, &priv->core_regs.fpcsr);
 	/* Now step through each double-precision float register, reading it back to r0,r1 */
 	for (size_t i = 0; i < ARRAY_LENGTH(priv->core_regs.d); ++i) {
 		/* The float register to read slots into the bottom 4 bits of the instruction */
-		cortexar_run_insn(target, ARM_VMOV_R0_R1_DN_INSN | i);
+		cortexar_queue_insn(target, ARM_VMOV_R0_R1_DN_INSN | i);
 		/* Read back the data */
-		const uint32_t d_low = cortexar_core_reg_read(target, 0U);
-		const uint32_t d_high = cortexar_core_reg_read(target, 1U);
-		/* Reassemble it as a full 64-bit value */
-		priv->core_regs.d[i] = d_low | ((uint64_t)d_high << 32U);
+		cortexar_queue_core_reg_read(target, 0U, &d_halves[i * 2U]);
+		cortexar_queue_core_reg_read(target, 1U, &d_halves[(i * 2U) + 1U]);
 	}
+	cortexar_dcc_stall_mode_exit(target, dbg_dcsr);
+	/* Reassemble each as a full 64-bit value */
+	for (size_t i = 0; i < ARRAY_LENGTH(priv->core_regs.d); ++i)
+		priv->core_regs.d[i] = d_halves[i * 2U] | ((uint64_t)d_halves[(i * 2U) + 1U] << 32U);
 }
 
 static void cortexar_regs_save(target_s *const target)
@@ -568,39 +660,47 @@ static inline void cortexar_core_reg_write(target_s *const target, const uint8_t
 static void cortexar_core_regs_restore(target_s *const target)
 {
 	cortexar_priv_s *const priv = (cortexar_priv_s *)target->priv;
+	/* Queue the whole restore sequence up in Stall mode so it runs in as few adaptor round trips as possible */
+	const uint32_t dbg_dcsr = cortexar_dcc_stall_mode_enter(target);
 	/* Load the values for each of the SPSRs in turn into r0 and shove them back into place */
 	for (size_t i = 0; i < ARRAY_LENGTH(priv->core_regs.spsr); ++i) {
-		cortexar_core_reg_write(target, 0U, priv->core_regs.spsr[i]);
+		cortexar_queue_core_reg_write(target, 0U, priv->core_regs.spsr[i]);
 		/* Build and issue the banked MSR for the required SPSR */
-		cortexar_run_insn(target, ARM_MSR_SPSR_R0_INSN | (cortexar_spsr_encodings[i] << 4U));
+		cortexar_queue_insn(target, ARM_MSR_SPSR_R0_INSN | (cortexar_spsr_encodings[i] << 4U));
 	}
 	/* Load the value for CPSR to r0 and then shove it back into place */
-	cortexar_core_reg_write(target, 0U, priv->core_regs.cpsr);
-	cortexar_run_insn(target, ARM_MSR_CPSR_R0_INSN);
+	cortexar_queue_core_reg_write(target, 0U, priv->core_regs.cpsr);
+	cortexar_queue_insn(target, ARM_MSR_CPSR_R0_INSN);
 	/* Fix up the program counter for the mode */
 	if (priv->core_regs.cpsr & CORTEXAR_CPSR_THUMB)
 		priv->core_regs.r[CORTEX_REG_PC] |= 1U;
-	/* Restore r1-15 in that order. Ignore r0 for the moment as it gets clobbered repeatedly */
-	for (size_t i = 1U; i < ARRAY_LENGTH(priv->core_regs.r); ++i)
-		cortexar_core_reg_write(target, i, priv->core_regs.r[i]);
+	/* Restore r1-14 in that order. Ignore r0 for the moment as it gets clobbered repeatedly */
+	for (size_t i = 1U; i < CORTEX_REG_PC; ++i)
+		cortexar_queue_core_reg_write(target, i, priv->core_regs.r[i]);
+	/* Load the program counter (r15) via r0 */
+	cortexar_queue_core_reg_write(target, 0U, priv->core_regs.r[CORTEX_REG_PC]);
+	cortexar_queue_insn(target, ARM_MOV_PC_R0_INSN);
 	/* Now we're done with the rest of the registers, restore r0 */
-	cortexar_core_reg_write(target, 0U, priv->core_regs.r[0U]);
+	cortexar_queue_core_reg_write(target, 0U, priv->core_regs.r[0U]);
+	cortexar_dcc_stall_mode_exit(target, dbg_dcsr);
 }
 
 static void cortexar_float_regs_restore(target_s *const target)
 {
 	const cortexar_priv_s *const priv = (cortexar_priv_s *)target->priv;
+	const uint32_t dbg_dcsr = cortexar_dcc_stall_mode_enter(target);
 	/* Step through each double-precision float register, writing it back via r0,r1 */
 	for (size_t i = 0; i < ARRAY_LENGTH(priv->core_regs.d); ++i) {
 		/* Load the low 32 bits into r0, and the high into r1 */
-		cortexar_core_reg_write(target, 0U, priv->core_regs.d[i] & UINT32_MAX);
-		cortexar_core_reg_write(target, 1U, priv->core_regs.d[i] >> 32U);
+		cortexar_queue_core_reg_write(target, 0U, priv->core_regs.d[i] & UINT32_MAX);
+		cortexar_queue_core_reg_write(target, 1U, priv->core_regs.d[i] >> 32U);
 		/* The float register to write slots into the bottom 4 bits of the instruction */
-		cortexar_run_insn(target, ARM_VMOV_DN_R0_R1_INSN | i);
+		cortexar_queue_insn(target, ARM_VMOV_DN_R0_R1_INSN | i);
 	}
 	/* Load the value for FPCSR to r0 and then shove it back into place */
-	cortexar_core_reg_write(target, 0U, priv->core_regs.fpcsr);
-	cortexar_run_insn(target, ARM_VMSR_FPCSR_R0_INSN);
+	cortexar_queue_core_reg_write(target, 0U, priv->core_regs.fpcsr);
+	cortexar_queue_insn(target, ARM_VMSR_FPCSR_R0_INSN);
+	cortexar_dcc_stall_mode_exit(target, dbg_dcsr);
 }
 
 static void cortexar_regs_restore(target_s *const target)
@@ -756,6 +856,14 @@ static bool cortexar_ensure_core_powered(target_s *const target)
 	return true;
 }
 
+static void cortexar_priv_free(void *const priv)
+{
+	cortexar_priv_s *const cortexar_priv = (cortexar_priv_s *)priv;
+	if (cortexar_priv->bus_ap)
+		adiv5_ap_unref(cortexar_priv->bus_ap);
+	cortex_priv_free(priv);
+}
+
 static target_s *cortexar_probe(
 	adiv5_access_port_s *const ap, const target_addr_t base_address, const char *const core_type)
 {
@@ -782,7 +890,7 @@ static target_s *cortexar_probe(
 
 	target->driver = core_type;
 	target->priv = priv;
-	target->priv_free = cortex_priv_free;
+	target->priv_free = cortexar_priv_free;
 	priv->base.ap = ap;
 	priv->base.base_addr = base_address;
 
@@ -1013,14 +1121,16 @@ static inline bool cortexar_mem_read_fast(target_s *const target, uint32_t *cons
 		adiv5_dp_write(priv->base.ap->dp, ADIV5_AP_DB(CORTEXAR_BANKED_DCSR), dbg_dcsr | CORTEXAR_DBG_DCSR_DCC_FAST);
 		/* Set up continual load so we can hammer the DTR */
 		adiv5_dp_write(priv->base.ap->dp, ADIV5_AP_DB(CORTEXAR_BANKED_ITR), ARM_LDC_R0_POSTINC4_DTRTX_INSN);
-		/* Run the transfer, hammering the DTR */
-		for (size_t offset = 0; offset < count; ++offset) {
-			/* Read the next value, which is the value for the last instruction run */
-			const uint32_t value = adiv5_dp_read(priv->base.ap->dp, ADIV5_AP_DB(CORTEXAR_BANKED_DTRRX));
-			/* If we've run the instruction at least once, store it */
-			if (offset)
-				dest[offset - 1U] = value;
-		}
+		/*
+		 * Run the transfer, hammering the DTR. Each read returns the value loaded by the previous run of the
+		 * instruction, so the first is discarded. The core stalls each access until its load completes, so
+		 * these can all be queued up and handed to the adaptor in batches.
+		 */
+		uint32_t discard = 0U;
+		for (size_t offset = 0; offset < count; ++offset)
+			adiv5_dp_queue_read(
+				priv->base.ap->dp, ADIV5_AP_DB(CORTEXAR_BANKED_DTRRX), offset ? dest + offset - 1U : &discard);
+		adiv5_dp_queue_flush(priv->base.ap->dp);
 		/* Now read out the status from the DCSR in case anything went wrong */
 		const uint32_t status = adiv5_dp_read(priv->base.ap->dp, ADIV5_AP_DB(CORTEXAR_BANKED_DCSR));
 		/* Go back into DCC Normal (Non-blocking) mode */
@@ -1094,6 +1204,24 @@ static void cortexar_mem_handle_fault(target_s *const target, const char *const
 	}
 }
 
+/*
+ * Check if an access should go over the system bus MEM-AP instead of through the core. That's only safe
+ * while the core sees memory as it is on the bus - with the MMU off there are no translations to respect,
+ * and with the data cache off there are no dirty lines the access could miss or later be overwritten by.
+ * Small accesses are left to the core as they are mostly GDB looking at variables and the stack.
+ */
+static bool cortexar_mem_via_bus(target_s *const target, const target_addr64_t address, const size_t len)
+{
+	const cortexar_priv_s *const priv = (cortexar_priv_s *)target->priv;
+	if (!priv->bus_ap || len < CORTEXAR_BUS_AP_MIN_TRANSFER || address < priv->bus_start)
+		return false;
+	const target_addr64_t offset = address - priv->bus_start;
+	if (offset >= priv->bus_length || len > priv->bus_length - offset)
+		return false;
+	const uint32_t sctlr = cortexar_coproc_read(target, CORTEXAR_SCTLR);
+	return !(sctlr & (CORTEXAR_SCTLR_MMU_ENABLED | CORTEXAR_SCTLR_DCACHE_ENABLED));
+}
+
 /*
  * This reads memory by jumping from the debug unit bus to the system bus.
  * NB: This requires the core to be halted! Uses instruction launches on
@@ -1107,25 +1235,30 @@ static void cortexar_mem_read(target_s *const target, void *const dest, const ta
 	const bool halted_in_function = cortexar_halt_and_wait(target);
 
 	cortexar_priv_s *const priv = (cortexar_priv_s *)target->priv;
-	/* Cache DFSR and DFAR in case we wind up triggering a data fault */
-	if (!(priv->core_status & CORTEXAR_STATUS_FAULT_CACHE_VALID)) {
-		priv->fault_status = cortexar_coproc_read(target, CORTEXAR_DFSR);
-		priv->fault_address = cortexar_coproc_read(target, CORTEXAR_DFAR);
-		priv->core_status |= CORTEXAR_STATUS_FAULT_CACHE_VALID;
-	}
-	/* Clear any existing fault state */
-	priv->core_status &= ~(CORTEXAR_STATUS_DATA_FAULT | CORTEXAR_STATUS_MMU_FAULT);
+	if (cortexar_mem_via_bus(target, src, len))
+		/* Large transfers to plain memory go straight over the system bus, bypassing the core entirely */
+		adiv5_mem_read(priv->bus_ap, dest, src, len);
+	else {
+		/* Cache DFSR and DFAR in case we wind up triggering a data fault */
+		if (!(priv->core_status & CORTEXAR_STATUS_FAULT_CACHE_VALID)) {
+			priv->fault_status = cortexar_coproc_read(target, CORTEXAR_DFSR);
+			priv->fault_address = cortexar_coproc_read(target, CORTEXAR_DFAR);
+			priv->core_status |= CORTEXAR_STATUS_FAULT_CACHE_VALID;
+		}
+		/* Clear any existing fault state */
+		priv->core_status &= ~(CORTEXAR_STATUS_DATA_FAULT | CORTEXAR_STATUS_MMU_FAULT);
 
-	/* Move the start address into the core's r0 */
-	cortexar_core_reg_write(target, 0U, src);
+		/* Move the start address into the core's r0 */
+		cortexar_core_reg_write(target, 0U, src);
 
-	/* If the address is 32-bit aligned and we're reading 32 bits at a time, use the fast path */
-	if ((src & 3U) == 0U && (len & 3U) == 0U)
-		cortexar_mem_read_fast(target, (uint32_t *)dest, len >> 2U);
-	else
-		cortexar_mem_read_slow(target, (uint8_t *)dest, src, len);
-	/* Deal with any data faults that occurred */
-	cortexar_mem_handle_fault(target, __func__);
+		/* If the address is 32-bit aligned and we're reading 32 bits at a time, use the fast path */
+		if ((src & 3U) == 0U && (len & 3U) == 0U)
+			cortexar_mem_read_fast(target, (uint32_t *)dest, len >> 2U);
+		else
+			cortexar_mem_read_slow(target, (uint8_t *)dest, src, len);
+		/* Deal with any data faults that occurred */
+		cortexar_mem_handle_fault(target, __func__);
+	}
 
 	DEBUG_PROTO("%s: Reading %zu bytes @0x%" PRIx64 ":", __func__, len, src);
 #ifndef DEBUG_PROTO_IS_NOOP
@@ -1158,9 +1291,10 @@ static inline bool cortexar_mem_write_fast(target_s *const target, const uint32_
 		adiv5_dp_write(priv->base.ap->dp, ADIV5_AP_DB(CORTEXAR_BANKED_DCSR), dbg_dcsr | CORTEXAR_DBG_DCSR_DCC_FAST);
 		/* Set up continual store so we can hammer the DTR */
 		adiv5_dp_write(priv->base.ap->dp, ADIV5_AP_DB(CORTEXAR_BANKED_ITR), ARM_STC_DTRRX_R0_POSTINC4_INSN);
-		/* Run the transfer, hammering the DTR */
+		/* Run the transfer, hammering the DTR - the core stalls each access till its store completes */
 		for (size_t offset = 0; offset < count; ++offset)
-			adiv5_dp_write(priv->base.ap->dp, ADIV5_AP_DB(CORTEXAR_BANKED_DTRTX), src[offset]);
+			adiv5_dp_queue_write(priv->base.ap->dp, ADIV5_AP_DB(CORTEXAR_BANKED_DTRTX), src[offset]);
+		adiv5_dp_queue_flush(priv->base.ap->dp);
 		/* Now read out the status from the DCSR in case anything went wrong */
 		const uint32_t status = adiv5_dp_read(priv->base.ap->dp, ADIV5_AP_DB(CORTEXAR_BANKED_DCSR));
 		/* Go back into DCC Normal (Non-blocking) mode */
@@ -1243,25 +1377,30 @@ static void cortexar_mem_write(
 		DEBUG_PROTO(" ...");
 	DEBUG_PROTO("\n");
 
-	/* Cache DFSR and DFAR in case we wind up triggering a data fault */
-	if (!(priv->core_status & CORTEXAR_STATUS_FAULT_CACHE_VALID)) {
-		priv->fault_status = cortexar_coproc_read(target, CORTEXAR_DFSR);
-		priv->fault_address = cortexar_coproc_read(target, CORTEXAR_DFAR);
-		priv->core_status |= CORTEXAR_STATUS_FAULT_CACHE_VALID;
-	}
-	/* Clear any existing fault state */
-	priv->core_status &= ~(CORTEXAR_STATUS_DATA_FAULT | CORTEXAR_STATUS_MMU_FAULT);
+	if (cortexar_mem_via_bus(target, dest, len))
+		/* Large transfers to plain memory go straight over the system bus, bypassing the core entirely */
+		adiv5_mem_write(priv->bus_ap, dest, src, len);
+	else {
+		/* Cache DFSR and DFAR in case we wind up triggering a data fault */
+		if (!(priv->core_status & CORTEXAR_STATUS_FAULT_CACHE_VALID)) {
+			priv->fault_status = cortexar_coproc_read(target, CORTEXAR_DFSR);
+			priv->fault_address = cortexar_coproc_read(target, CORTEXAR_DFAR);
+			priv->core_status |= CORTEXAR_STATUS_FAULT_CACHE_VALID;
+		}
+		/* Clear any existing fault state */
+		priv->core_status &= ~(CORTEXAR_STATUS_DATA_FAULT | CORTEXAR_STATUS_MMU_FAULT);
 
-	/* Move the start address into the core's r0 */
-	cortexar_core_reg_write(target, 0U, dest);
+		/* Move the start address into the core's r0 */
+		cortexar_core_reg_write(target, 0U, dest);
 
-	/* If the address is 32-bit aligned and we're writing 32 bits at a time, use the fast path */
-	if ((dest & 3U) == 0U && (len & 3U) == 0U)
-		cortexar_mem_write_fast(target, (const uint32_t *)src, len >> 2U);
-	else
-		cortexar_mem_write_slow(target, dest, (const uint8_t *)src, len);
-	/* Deal with any data faults that occurred */
-	cortexar_mem_handle_fault(target, __func__);
+		/* If the address is 32-bit aligned and we're writing 32 bits at a time, use the fast path */
+		if ((dest & 3U) == 0U && (len & 3U) == 0U)
+			cortexar_mem_write_fast(target, (const uint32_t *)src, len >> 2U);
+		else
+			cortexar_mem_write_slow(target, dest, (const uint8_t *)src, len);
+		/* Deal with any data faults that occurred */
+		cortexar_mem_handle_fault(target, __func__);
+	}
 
 	if (halted_in_function)
 		cortexar_halt_resume(target, false);
@@ -1542,6 +1681,40 @@ static bool cortexar_halt_and_wait(target_s *const target)
 	return true;
 }
 
+void cortexar_bus_ap_set(target_s *const target, const uint8_t apsel, const target_addr_t start, const size_t length)
+{
+	cortexar_priv_s *const priv = (cortexar_priv_s *)target->priv;
+	adiv5_access_port_s *const ap = adiv5_new_ap(priv->base.ap->dp, apsel);
+	if (!ap)
+		return;
+
+	/*
+	 * Mark the accesses bufferable (and for AXI, modifiable) so the interconnect is free to post and merge
+	 * the writes of a block transfer, which is what makes loading large images over this AP quick
+	 */
+	switch (ADIV5_AP_IDR_TYPE(ap->idr)) {
+	case ADIV5_AP_IDR_TYPE_AXI3_4:
+		ap->csw |= ADIV5_AP_CSW_AXI_CACHE_BUFFERABLE | ADIV5_AP_CSW_AXI_CACHE_MODIFIABLE;
+		break;
+	case ADIV5_AP_IDR_TYPE_AHB3:
+	case ADIV5_AP_IDR_TYPE_AHB5:
+	case ADIV5_AP_IDR_TYPE_AHB5_HPROT:
+		ap->csw |= ADIV5_AP_CSW_AHB_HPROT_BUFFERABLE;
+		break;
+	default:
+		DEBUG_WARN("%s: AP %u is not a system bus MEM-AP\n", __func__, apsel);
+		adiv5_ap_unref(ap);
+		return;
+	}
+
+	if (priv->bus_ap)
+		adiv5_ap_unref(priv->bus_ap);
+	priv->bus_ap = ap;
+	priv->bus_start = start;
+	priv->bus_length = length;
+	DEBUG_INFO("Using AP %u for memory access to 0x%08" PRIx32 "+%zx\n", apsel, start, length);
+}
+
 void cortexar_invalidate_all_caches(target_s *const target)
 {
 	/* Extract the cache geometry */
@@ -1729,143 +1902,7 @@ static int cortexar_breakwatch_clear(target_s *const target, breakwatch_s *const
 	}
 }
 
-/*
- * This function creates the target description XML substring for the FPU (VFPv2) on
- * a Cortex-A/R part. This has the same rationale as the function below.
- *
- * The string it creates is conceptually the following:
- * <feature name="org.gnu.gdb.arm.vfp">
- *   <reg name="d0" bitsize="64" type="ieee_double"/>
- *   <reg name="d1" bitsize="64" type="ieee_double"/>
- *   <reg name="d2" bitsize="64" type="ieee_double"/>
- *   <reg name="d3" bitsize="64" type="ieee_double"/>
- *   <reg name="d4" bitsize="64" type="ieee_double"/>
- *   <reg name="d5" bitsize="64" type="ieee_double"/>
- *   <reg name="d6" bitsize="64" type="ieee_double"/>
- *   <reg name="d7" bitsize="64" type="ieee_double"/>
- *   <reg name="d8" bitsize="64" type="ieee_double"/>
- *   <reg name="d9" bitsize="64" type="ieee_double"/>
- *   <reg name="d10" bitsize="64" type="ieee_double"/>
- *   <reg name="d11" bitsize="64" type="ieee_double"/>
- *   <reg name="d12" bitsize="64" type="ieee_double"/>
- *   <reg name="d13" bitsize="64" type="ieee_double"/>
- *   <reg name="d14" bitsize="64" type="ieee_double"/>
- *   <reg name="d15" bitsize="64" type="ieee_double"/>
- *   <reg name="fpscr" bitsize="32"/>
- * </feature>
- */
-static size_t cortexar_build_target_fpu_description(char *const buffer, size_t max_length)
-{
-	size_t print_size = max_length;
-	/* Terminate the previous feature block and start the new */
-	int offset = snprintf(buffer, print_size, "</feature><feature name=\"org.gnu.gdb.arm.vfp\">");
-
-	/* Build the FPU general purpose register descriptions for d0-d15 */
-	for (uint8_t i = 0; i < 16U; ++i) {
-		if (max_length != 0)
-			print_size = max_length - (size_t)offset;
-
-		offset += snprintf(buffer + offset, print_size, "<reg name=\"d%u\" bitsize=\"64\" type=\"ieee_double\"/>", i);
-	}
-
-	/* Build the FPU status/control register (fpscr) description */
-	if (max_length != 0)
-		print_size = max_length - (size_t)offset;
-
-	offset += snprintf(buffer + offset, print_size, "<reg name=\"fpscr\" bitsize=\"32\"/>");
-
-	/* offset is now the total length of the string created, discard the sign and return it. */
-	return (size_t)offset;
-}
-
-/*
- * This function creates the target description XML string for a Cortex-A/R part.
- * This is done this way to decrease string duplications and thus code size,
- * making it unfortunately much less readable than the string literal it is
- * equivalent to.
- *
- * The string it creates is approximately the following:
- * <?xml version="1.0"?>
- * <!DOCTYPE target SYSTEM "gdb-target.dtd">
- * <target>
- *   <architecture>arm</architecture>
- *   <feature name="org.gnu.gdb.arm.core">
- *     <reg name="r0" bitsize="32"/>
- *     <reg name="r1" bitsize="32"/>
- *     <reg name="r2" bitsize="32"/>
- *     <reg name="r3" bitsize="32"/>
- *     <reg name="r4" bitsize="32"/>
- *     <reg name="r5" bitsize="32"/>
- *     <reg name="r6" bitsize="32"/>
- *     <reg name="r7" bitsize="32"/>
- *     <reg name="r8" bitsize="32"/>
- *     <reg name="r9" bitsize="32"/>
- *     <reg name="r10" bitsize="32"/>
- *     <reg name="r11" bitsize="32"/>
- *     <reg name="r12" bitsize="32"/>
- *     <reg name="sp" bitsize="32" type="data_ptr"/>
- *     <reg name="lr" bitsize="32" type="code_ptr"/>
- *     <reg name="pc" bitsize="32" type="code_ptr"/>
- *     <reg name="cpsr" bitsize="32" regnum="25"/>
- *   </feature>
- * </target>
- */
-static size_t cortexar_build_target_description(char *const buffer, size_t max_length, const bool has_fpu)
-{
-	size_t print_size = max_length;
-	/* Start with the "preamble" chunks which are mostly common across targets save for 2 words. */
-	int offset = snprintf(buffer, print_size, "%s target %sarm%s <feature name=\"org.gnu.gdb.arm.core\">",
-		gdb_xml_preamble_first, gdb_xml_preamble_second, gdb_xml_preamble_third);
-
-	/* Then build the general purpose register descriptions for r0-r12 */
-	for (uint8_t i = 0; i <= 12U; ++i) {
-		if (max_length != 0)
-			print_size = max_length - (size_t)offset;
-
-		offset += snprintf(buffer + offset, print_size, "<reg name=\"r%u\" bitsize=\"32\"/>", i);
-	}
-
-	/* Now build the special-purpose register descriptions using the arrays at the top of file */
-	for (uint8_t i = 0; i < ARRAY_LENGTH(cortexr_spr_names); ++i) {
-		if (max_length != 0)
-			print_size = max_length - (size_t)offset;
-
-		const char *const name = cortexr_spr_names[i];
-		const gdb_reg_type_e type = cortexr_spr_types[i];
-
-		/*
-		 * Create tag for each register In the case of CPSR, remap it to 25 so it aligns
-		 * with the target description XML string above. CORTEXAR_CPSR_GDB_REMAP_POS is
-		 * used for this mapping elsewhere in the logic.
-		 */
-		offset += snprintf(buffer + offset, print_size, "<reg name=\"%s\" bitsize=\"32\"%s%s/>", name,
-			gdb_reg_type_strings[type], i == 3U ? " regnum=\"25\"" : "");
-	}
-
-	/* Handle when the core has a FPU (VFP) */
-	if (has_fpu) {
-		if (max_length != 0)
-			print_size = max_length - (size_t)offset;
-
-		offset += cortexar_build_target_fpu_description(buffer + offset, print_size);
-	}
-
-	/* Build the XML blob's termination */
-	if (max_length != 0)
-		print_size = max_length - (size_t)offset;
-
-	offset += snprintf(buffer + offset, print_size, "</feature></target>");
-	/* offset is now the total length of the string created, discard the sign and return it. */
-	return (size_t)offset;
-}
-
-static const char *cortexar_target_description(target_s *const target)
+static void cortexar_target_description(target_s *const target, target_description_stream_s *const stream)
 {
-	const size_t description_length =
-		cortexar_build_target_description(NULL, 0, target->target_options & TOPT_FLAVOUR_FLOAT) + 1U;
-	char *const description = malloc(description_length);
-	if (description)
-		(void)cortexar_build_target_description(
-			description, description_length, target->target_options & TOPT_FLAVOUR_FLOAT);
-	return description;
+	target_description_pieces(stream, cortexar_description, ARRAY_LENGTH(cortexar_description), target->target_options);
 }
@@ -37,5 +37,10 @@
 #include "general.h"
 
 void cortexar_invalidate_all_caches(target_s *target);
+/*
+ * Use the given system bus MEM-AP for large accesses to [start, start + length) while the MMU and data cache
+ * are off, leaving everything else to go through the core
+ */
+void cortexar_bus_ap_set(target_s *target, uint8_t apsel, target_addr_t start, size_t length);
 
 #endif /* TARGET_CORTEXAR_H */
@@ -42,8 +42,10 @@
 #include "command.h"
 #include "gdb_packet.h"
 #include "semihosting.h"
+#include "semihosting_internal.h"
 #include "platform.h"
 #include "maths_utils.h"
+#include "buffer_utils.h"
 
 #include <assert.h>
 
@@ -51,20 +53,27 @@
 #define CORTEXM_MAX_REG_COUNT (CORTEXM_GENERAL_REG_COUNT + CORTEX_FLOAT_REG_COUNT + CORTEXM_TRUSTZONE_REG_COUNT)
 
 static bool cortexm_vector_catch(target_s *target, int argc, const char **argv);
+static bool cortexm_profile(target_s *target, int argc, const char **argv);
+static bool cortexm_step(target_s *target, int argc, const char **argv);
 
 const command_s cortexm_cmd_list[] = {
 	{"vector_catch", cortexm_vector_catch, "Catch exception vectors"},
+	{"profile", cortexm_profile, "Run the core sampling its PC: [milliseconds] [bucket shift]"},
+	{"step", cortexm_step, "Single-step the core on the probe: [trace] COUNT [RANGE_START RANGE_END]"},
 	{NULL, NULL, NULL},
 };
 
 #define CORTEXM_DCRSR_REG_WRITE (1U << 16U)
 
-static const char *cortexm_target_description(target_s *target);
+static void cortexm_target_description(target_s *target, target_description_stream_s *stream);
 static void cortexm_regs_read(target_s *target, void *data);
+static size_t cortexm_regs_read_core(target_s *target, void *data);
 static void cortexm_regs_write(target_s *target, const void *data);
 static uint32_t cortexm_pc_read(target_s *target);
 static size_t cortexm_reg_read(target_s *target, uint32_t reg, void *data, size_t max);
 static size_t cortexm_reg_write(target_s *target, uint32_t reg, const void *data, size_t max);
+static int dcrsr_regnum(target_s *target, uint32_t reg);
+static void cortexm_reg_cache_flush(target_s *target);
 
 static void cortexm_reset(target_s *target);
 static target_halt_reason_e cortexm_halt_poll(target_s *target, target_addr64_t *watch);
@@ -74,8 +83,25 @@ static int cortexm_fault_unwind(target_s *target);
 static int cortexm_breakwatch_set(target_s *target, breakwatch_s *breakwatch);
 static int cortexm_breakwatch_clear(target_s *target, breakwatch_s *breakwatch);
 static target_addr_t cortexm_check_watch(target_s *target);
-
-static bool cortexm_hostio_request(target_s *target);
+static void cortexm_comparators_sync(target_s *target);
+
+static bool cortexm_hostio_request(target_s *target, uint32_t program_counter);
+static bool cortexm_crc32(target_s *target, uint32_t *crc, target_addr_t base, size_t len);
+static bool cortexm_mem_fill(target_s *target, target_addr_t dest, uint32_t value, size_t len);
+
+/* The values of the FPB and DWT comparator registers */
+typedef struct cortexm_comparators {
+	uint32_t fpb_comp[CORTEX_MAX_BREAKPOINTS];
+	uint32_t dwt_comp[CORTEX_MAX_WATCHPOINTS];
+	uint32_t dwt_mask[CORTEX_MAX_WATCHPOINTS];
+	uint32_t dwt_func[CORTEX_MAX_WATCHPOINTS];
+} cortexm_comparators_s;
+
+/* A run of memory [start, end) that's had D-cache maintenance done on it since the core last halted */
+typedef struct cortexm_dcache_range {
+	target_addr64_t start;
+	target_addr64_t end;
+} cortexm_dcache_range_s;
 
 typedef struct cortexm_priv {
 	cortex_priv_s base;
@@ -83,12 +109,137 @@ typedef struct cortexm_priv {
 	bool on_bkpt;
 	bool icache_enabled;
 	bool dcache_enabled;
+	/*
+	 * While the core is halted nothing but us touches its D-cache, so once a range has been cleaned (or cleaned
+	 * and invalidated) it stays that way until the core is resumed. These are only meaningful if dcache_halted
+	 */
+	bool dcache_halted;
+	cortexm_dcache_range_s dcache_cleaned;
+	cortexm_dcache_range_s dcache_invalidated;
 	/* Flash Patch controller configuration */
 	uint8_t flash_patch_revision;
 	/* Copy of DEMCR for vector-catch */
 	uint32_t demcr;
+	/* Set once pulsing nRST has been seen to not reset the core, so later resets go straight to SYSRESETREQ */
+	bool nrst_ineffective;
+	/*
+	 * Write-back cache of the core registers, valid only while the core is halted. The FPU's registers are
+	 * fetched into it separately, only once something actually asks for one of them
+	 */
+	bool reg_cache_valid;
+	bool reg_cache_fp_valid;
+	uint64_t reg_cache_dirty;
+	uint32_t reg_cache[CORTEXM_MAX_REG_COUNT];
+	/*
+	 * The comparators as the break- and watchpoints set call for, and as last written to the core. Setting and
+	 * clearing only changes the former, and just the comparators that differ are written as the core resumes
+	 */
+	cortexm_comparators_s comparators;
+	cortexm_comparators_s comparators_programmed;
 } cortexm_priv_s;
 
+/* The dirty mask needs one bit per cached register */
+static_assert(CORTEXM_MAX_REG_COUNT <= 64U, "Cortex-M register cache dirty mask too small");
+
+/* The PC sample histogram kept for `monitor profile`, sized to what the probe can spare */
+#if CONFIG_BMDA == 1
+#define CORTEXM_PROFILE_BUCKETS 4096U
+#else
+#define CORTEXM_PROFILE_BUCKETS 128U
+#endif
+/* How far past its home slot a sample may land before it's counted as dropped */
+#define CORTEXM_PROFILE_PROBES 16U
+/* How many of the busiest buckets get reported */
+#define CORTEXM_PROFILE_REPORT 16U
+
+typedef struct cortexm_profile_bucket {
+	uint32_t addr;
+	uint32_t count;
+} cortexm_profile_bucket_s;
+
+typedef struct cortexm_profile {
+	uint32_t mask;
+	uint32_t samples;
+	uint32_t dropped;
+	cortexm_profile_bucket_s buckets[CORTEXM_PROFILE_BUCKETS];
+} cortexm_profile_s;
+
+/* Match any part ID or core in a part probe table entry */
+#define CORTEXM_PART_ANY 0xffffU
+#define CORTEXM_CORE_ANY 0U
+
+#ifndef DEBUG_TARGET_IS_NOOP
+#define CORTEXM_PART_PROBE_NAME(probe_fn) .name = STRINGIFY(probe_fn),
+#else
+#define CORTEXM_PART_PROBE_NAME(probe_fn)
+#endif
+
+/* Declare a part probe that applies to cores matching the given designer, part ID and CPUID part number */
+#define CORTEXM_PART_PROBE_ENTRY(designer, part, core, probe_fn) \
+	{                                                            \
+		.designer_code = (designer),                             \
+		.part_id = (part),                                       \
+		.cpuid_partno = (core),                                  \
+		.probe = (probe_fn),                                     \
+		CORTEXM_PART_PROBE_NAME(probe_fn)                        \
+	}
+/* Declare a part probe for all cores from a designer */
+#define CORTEXM_DESIGNER_PROBE(designer, probe_fn) \
+	CORTEXM_PART_PROBE_ENTRY(designer, CORTEXM_PART_ANY, CORTEXM_CORE_ANY, probe_fn)
+/* Declare a part probe for cores from a designer with a specific part ID */
+#define CORTEXM_PART_PROBE(designer, part, probe_fn) \
+	CORTEXM_PART_PROBE_ENTRY(designer, part, CORTEXM_CORE_ANY, probe_fn)
+/* Declare a part probe for cores from a designer of a specific core type */
+#define CORTEXM_CORE_PROBE(designer, core, probe_fn) \
+	CORTEXM_PART_PROBE_ENTRY(designer, CORTEXM_PART_ANY, core, probe_fn)
+
+typedef struct cortexm_part_probe {
+	uint16_t designer_code;
+	uint16_t part_id;
+	uint16_t cpuid_partno;
+	bool (*probe)(target_s *target);
+#ifndef DEBUG_TARGET_IS_NOOP
+	const char *name;
+#endif
+} cortexm_part_probe_s;
+
+/* How many distinct cores the part probe cache remembers */
+#define CORTEXM_PROBE_CACHE_ENTRIES 4U
+
+/*
+ * Which part probe matched a core, keyed on the identification values read before part probing starts.
+ * When a rescan finds a core with the same identity, its probe is tried on its own before the full probe chain.
+ */
+typedef struct cortexm_probe_cache_entry {
+	uint8_t dev_index;
+	uint8_t apsel;
+	uint16_t dp_designer_code;
+	uint16_t dp_partno;
+	uint16_t designer_code;
+	uint16_t part_id;
+	uint32_t targetsel;
+	uint32_t ap_idr;
+	uint32_t cpuid;
+	const cortexm_part_probe_s *part_probe;
+} cortexm_probe_cache_entry_s;
+
+static cortexm_probe_cache_entry_s cortexm_probe_cache[CORTEXM_PROBE_CACHE_ENTRIES];
+static size_t cortexm_probe_cache_next;
+
+
+static const uint16_t cortexm_crc32_stub[] = {
+#include "flashstub/crc32.stub"
+};
+
+/* The CRC32 stub followed by the word it keeps the running CRC in */
+#define CORTEXM_CRC32_SCRATCH_SIZE (ALIGN(sizeof(cortexm_crc32_stub), 4U) + 4U)
+
+static const uint16_t cortexm_fill_stub[] = {
+#include "flashstub/fill.stub"
+};
+
+#define CORTEXM_FILL_SCRATCH_SIZE ALIGN(sizeof(cortexm_fill_stub), 4U)
+
 /* Register number tables */
 static const uint8_t regnum_cortex_m[CORTEXM_GENERAL_REG_COUNT] = {
 	0U, 1U, 2U, 3U, 4U, 5U, 6U, 7U, 8U, 9U, 10U, 11U, 12U, 13U, 14U, 15U, /* r0-r15 */
@@ -112,113 +263,146 @@ static const uint8_t regnum_cortex_mf[CORTEX_FLOAT_REG_COUNT] = {
 };
 
 /*
- * Fields for Cortex-M special purpose registers, used in the generation of GDB's target description XML.
- * The general purpose registers r0-r12 and the vector floating point registers d0-d15 all follow a very
- * regular format, so we only need to store fields for the special purpose registers.
- * The arrays for each SPR field have the same order as each other, making each of them a pseudo
- * 'associative array'.
+ * GDB's target description XML for Cortex-M parts, put together from fixed pieces at compile time. The core
+ * and system registers are always described, followed by the TrustZone stack pointers and then the FPU
+ * registers for cores that have them - each of those closing off the feature block before it - and finally
+ * the closing tags.
  */
-
-// Strings for the names of the Cortex-M's special purpose registers.
-static const char *cortex_m_spr_names[] = {
-	"sp",
-	"lr",
-	"pc",
-	"xpsr",
-	"msp",
-	"psp",
-	"primask",
-	"basepri",
-	"faultmask",
-	"control",
-};
-
-// The "type" field for each Cortex-M special purpose register.
-static const gdb_reg_type_e cortex_m_spr_types[] = {
-	GDB_TYPE_DATA_PTR,    // sp
-	GDB_TYPE_CODE_PTR,    // lr
-	GDB_TYPE_CODE_PTR,    // pc
-	GDB_TYPE_UNSPECIFIED, // xpsr
-	GDB_TYPE_DATA_PTR,    // msp
-	GDB_TYPE_DATA_PTR,    // psp
-	GDB_TYPE_UNSPECIFIED, // primask
-	GDB_TYPE_UNSPECIFIED, // basepri
-	GDB_TYPE_UNSPECIFIED, // faultmask
-	GDB_TYPE_UNSPECIFIED, // control
-};
-
 // clang-format off
-static_assert(ARRAY_LENGTH(cortex_m_spr_types) == ARRAY_LENGTH(cortex_m_spr_names),
-	"SPR array length mismatch! SPR type array should have the same length as SPR name array."
-);
-// clang-format on
-
-// The "save-restore" field of each SPR.
-static const gdb_reg_save_restore_e cortex_m_spr_save_restores[] = {
-	GDB_SAVE_RESTORE_UNSPECIFIED, // sp
-	GDB_SAVE_RESTORE_UNSPECIFIED, // lr
-	GDB_SAVE_RESTORE_UNSPECIFIED, // pc
-	GDB_SAVE_RESTORE_UNSPECIFIED, // xpsr
-	GDB_SAVE_RESTORE_NO,          // msp
-	GDB_SAVE_RESTORE_NO,          // psp
-	GDB_SAVE_RESTORE_NO,          // primask
-	GDB_SAVE_RESTORE_NO,          // basepri
-	GDB_SAVE_RESTORE_NO,          // faultmask
-	GDB_SAVE_RESTORE_NO,          // control
+static const target_description_piece_s cortexm_description[] = {
+	{0U,
+		GDB_XML_PREAMBLE("arm")
+		GDB_XML_FEATURE("org.gnu.gdb.arm.m-profile")
+		GDB_XML_REG("r0", 32, "")
+		GDB_XML_REG("r1", 32, "")
+		GDB_XML_REG("r2", 32, "")
+		GDB_XML_REG("r3", 32, "")
+		GDB_XML_REG("r4", 32, "")
+		GDB_XML_REG("r5", 32, "")
+		GDB_XML_REG("r6", 32, "")
+		GDB_XML_REG("r7", 32, "")
+		GDB_XML_REG("r8", 32, "")
+		GDB_XML_REG("r9", 32, "")
+		GDB_XML_REG("r10", 32, "")
+		GDB_XML_REG("r11", 32, "")
+		GDB_XML_REG("r12", 32, "")
+		GDB_XML_REG("sp", 32, GDB_XML_TYPE_DATA_PTR)
+		GDB_XML_REG("lr", 32, GDB_XML_TYPE_CODE_PTR)
+		GDB_XML_REG("pc", 32, GDB_XML_TYPE_CODE_PTR)
+		GDB_XML_REG("xpsr", 32, GDB_XML_REGNUM(25))
+		GDB_XML_FEATURE_END
+		GDB_XML_FEATURE("org.gnu.gdb.arm.m-system")
+		GDB_XML_REG("msp", 32, GDB_XML_NO_SAVE_RESTORE GDB_XML_TYPE_DATA_PTR)
+		GDB_XML_REG("psp", 32, GDB_XML_NO_SAVE_RESTORE GDB_XML_TYPE_DATA_PTR)
+		GDB_XML_REG("primask", 8, GDB_XML_NO_SAVE_RESTORE)
+		GDB_XML_REG("basepri", 8, GDB_XML_NO_SAVE_RESTORE)
+		GDB_XML_REG("faultmask", 8, GDB_XML_NO_SAVE_RESTORE)
+		GDB_XML_REG("control", 8, GDB_XML_NO_SAVE_RESTORE)
+	},
+	{CORTEXM_TOPT_TRUSTZONE,
+		GDB_XML_FEATURE_END
+		GDB_XML_FEATURE("org.gnu.gdb.arm.m-secext")
+		GDB_XML_REG("msp_ns", 32, GDB_XML_NO_SAVE_RESTORE GDB_XML_TYPE_DATA_PTR)
+		GDB_XML_REG("psp_ns", 32, GDB_XML_NO_SAVE_RESTORE GDB_XML_TYPE_DATA_PTR)
+		GDB_XML_REG("msp_s", 32, GDB_XML_NO_SAVE_RESTORE GDB_XML_TYPE_DATA_PTR)
+		GDB_XML_REG("psp_s", 32, GDB_XML_NO_SAVE_RESTORE GDB_XML_TYPE_DATA_PTR)
+	},
+	{CORTEXM_TOPT_FLAVOUR_FLOAT,
+		GDB_XML_FEATURE_END
+		GDB_XML_FEATURE("org.gnu.gdb.arm.vfp")
+		/* FPSCR has to come before the VFP registers */
+		GDB_XML_REG("fpscr", 32, "")
+		GDB_XML_REG("d0", 64, " type=\"float\"")
+		GDB_XML_REG("d1", 64, " type=\"float\"")
+		GDB_XML_REG("d2", 64, " type=\"float\"")
+		GDB_XML_REG("d3", 64, " type=\"float\"")
+		GDB_XML_REG("d4", 64, " type=\"float\"")
+		GDB_XML_REG("d5", 64, " type=\"float\"")
+		GDB_XML_REG("d6", 64, " type=\"float\"")
+		GDB_XML_REG("d7", 64, " type=\"float\"")
+		GDB_XML_REG("d8", 64, " type=\"float\"")
+		GDB_XML_REG("d9", 64, " type=\"float\"")
+		GDB_XML_REG("d10", 64, " type=\"float\"")
+		GDB_XML_REG("d11", 64, " type=\"float\"")
+		GDB_XML_REG("d12", 64, " type=\"float\"")
+		GDB_XML_REG("d13", 64, " type=\"float\"")
+		GDB_XML_REG("d14", 64, " type=\"float\"")
+		GDB_XML_REG("d15", 64, " type=\"float\"")
+	},
+	{0U, GDB_XML_FEATURE_END "</target>"},
 };
-
-// clang-format off
-static_assert(ARRAY_LENGTH(cortex_m_spr_save_restores) == ARRAY_LENGTH(cortex_m_spr_names),
-	"SPR array length mismatch! SPR save-restore array should have the same length as SPR name array."
-);
 // clang-format on
 
-// The "bitsize" field of each SPR.
-static const uint8_t cortex_m_spr_bitsizes[] = {
-	32, // sp
-	32, // lr
-	32, // pc
-	32, // xpsr
-	32, // msp
-	32, // psp
-	8,  // primask
-	8,  // basepri
-	8,  // faultmask
-	8,  // control
-};
+static bool cortexm_dcache_range_covers(
+	const cortexm_dcache_range_s *const range, const target_addr64_t start, const target_addr64_t end)
+{
+	return start >= range->start && end <= range->end;
+}
 
-// clang-format off
-static_assert(ARRAY_LENGTH(cortex_m_spr_bitsizes) == ARRAY_LENGTH(cortex_m_spr_names),
-	"SPR array length mismatch! SPR bitsize array should have the same length as SPR name array."
-);
+/* Grow the range to take in [start, end) if the two touch, otherwise start over with just [start, end) */
+static void cortexm_dcache_range_add(
+	cortexm_dcache_range_s *const range, const target_addr64_t start, const target_addr64_t end)
+{
+	if (range->start < range->end && start <= range->end && end >= range->start) {
+		range->start = MIN(range->start, start);
+		range->end = MAX(range->end, end);
+	} else {
+		range->start = start;
+		range->end = end;
+	}
+}
 
-// clang-format on
+/* Forget what maintenance has been done, as the core may be about to run or has just halted */
+static void cortexm_dcache_forget(cortexm_priv_s *const priv, const bool halted)
+{
+	priv->dcache_halted = halted;
+	priv->dcache_cleaned = (cortexm_dcache_range_s){0U, 0U};
+	priv->dcache_invalidated = (cortexm_dcache_range_s){0U, 0U};
+}
 
 static void cortexm_cache_clean(
 	target_s *const target, const target_addr32_t addr, const size_t len, const bool invalidate)
 {
-	const cortexm_priv_s *const priv = (const cortexm_priv_s *)target->priv;
+	cortexm_priv_s *const priv = (cortexm_priv_s *)target->priv;
 	/* Check if there is a data cache and if it's even actually enabled */
 	if (!priv->base.dcache_line_length || !priv->dcache_enabled)
 		return;
+	const target_addr64_t mem_end = (target_addr64_t)addr + len;
+	/* Cleaned and invalidated lines can't become dirty again without the core running, so cover both cases */
+	if (priv->dcache_halted && (cortexm_dcache_range_covers(&priv->dcache_invalidated, addr, mem_end) ||
+								   (!invalidate && cortexm_dcache_range_covers(&priv->dcache_cleaned, addr, mem_end))))
+		return;
 	const target_addr32_t cache_reg = invalidate ? CORTEXM_DCCIMVAC : CORTEXM_DCCMVAC;
 	const size_t minline = priv->base.dcache_line_length << 2U;
 
-	/* flush data cache for RAM regions that intersect requested region */
-	const target_addr32_t mem_end = addr + len; /* following code is NOP if wraparound */
-	/* requested region is [src, src_end) */
+	/*
+	 * Queue up one write per line of each RAM region that intersects the requested region, through the banked
+	 * data register that maps the maintenance register once TAR points at the 16 byte block holding it
+	 */
+	adiv5_access_port_s *const ap = cortex_ap(target);
+	const uint16_t cache_bank_reg = ADIV5_AP_DB((cache_reg >> 2U) & 3U);
+	bool queued = false;
+	/* requested region is [addr, mem_end) */
 	for (target_ram_s *ram = target->ram; ram; ram = ram->next) {
-		target_addr32_t region_start = ram->start;
-		target_addr32_t region_end = ram->start + ram->length;
-		/* RAM region is [region_start, region_end) */
-		if (addr > region_start)
-			region_start = addr;
-		if (mem_end < region_end)
-			region_end = mem_end;
+		const target_addr64_t region_start = MAX((target_addr64_t)ram->start, (target_addr64_t)addr);
+		const target_addr64_t region_end = MIN((target_addr64_t)ram->start + ram->length, mem_end);
 		/* intersection is [region_start, region_end) */
-		for (region_start &= ~(minline - 1U); region_start < region_end; region_start += minline)
-			target_mem32_write32(target, cache_reg, region_start);
+		if (region_start >= region_end)
+			continue;
+		if (!queued) {
+			adi_ap_mem_access_setup(ap, cache_reg & ~0xfU, ALIGN_32BIT);
+			adi_ap_banked_access_setup(ap);
+			queued = true;
+		}
+		for (target_addr64_t line = region_start & ~(target_addr64_t)(minline - 1U); line < region_end;
+			 line += minline)
+			adiv5_dp_queue_write(ap->dp, cache_bank_reg, (uint32_t)line);
 	}
+	if (queued)
+		adiv5_dp_queue_flush(ap->dp);
+
+	if (priv->dcache_halted)
+		cortexm_dcache_range_add(invalidate ? &priv->dcache_invalidated : &priv->dcache_cleaned, addr, mem_end);
 }
 
 static void cortexm_mem_read(target_s *target, void *dest, target_addr64_t src, size_t len)
@@ -233,11 +417,37 @@ static void cortexm_mem_write(target_s *target, target_addr64_t dest, const void
 	adiv5_mem_write(cortex_ap(target), dest, src, len);
 }
 
+#if CONFIG_BMDA == 1
+static uint32_t cortexm_mem_poll32(target_s *const target, const target_addr64_t addr, const uint32_t mask,
+	const uint32_t value, const uint32_t timeout_ms)
+{
+	adiv5_access_port_s *const ap = cortex_ap(target);
+	return ap->dp->mem_poll32(ap, addr, mask, value, timeout_ms);
+}
+#endif
+
 bool target_is_cortexm(const target_s *target)
 {
 	return target != NULL && target->regs_description == cortexm_target_description;
 }
 
+/*
+ * Whether two Cortex-M targets are cores of the same device. That's the case if they hang off the same DP
+ * (as on the STM32H7 or nRF5340), or for multi-drop parts (like the RP2040) which give each core its own DP,
+ * if their DPs report the same TARGETID part and differ only in the instance.
+ */
+bool target_same_device(target_s *const target, target_s *const other)
+{
+	if (target == other || !target_is_cortexm(target) || !target_is_cortexm(other))
+		return false;
+	const adiv5_debug_port_s *const dp = cortex_ap(target)->dp;
+	const adiv5_debug_port_s *const other_dp = cortex_ap(other)->dp;
+	if (dp == other_dp)
+		return true;
+	return dp->version >= 2U && other_dp->version >= 2U && dp->targetsel != other_dp->targetsel &&
+		dp->target_designer_code == other_dp->target_designer_code && dp->target_partno == other_dp->target_partno;
+}
+
 uint32_t cortexm_demcr_read(const target_s *target)
 {
 	const cortexm_priv_s *priv = (const cortexm_priv_s *)target->priv;
@@ -251,6 +461,150 @@ void cortexm_demcr_write(target_s *target, uint32_t demcr)
 	target_mem32_write32(target, CORTEXM_DEMCR, demcr);
 }
 
+/*
+ * The part probes to try for each Cortex-M core, by the designer code and part ID from the DP's TARGETID
+ * or else from the AP. Within a designer, entries are tried in order, so where one part's probe can upset
+ * another part (see the LPC546xx note below), order here matters.
+ */
+static const cortexm_part_probe_s cortexm_part_probes[] = {
+	CORTEXM_DESIGNER_PROBE(JEP106_MANUFACTURER_FREESCALE, imxrt_probe),
+	CORTEXM_DESIGNER_PROBE(JEP106_MANUFACTURER_FREESCALE, kinetis_probe),
+	CORTEXM_DESIGNER_PROBE(JEP106_MANUFACTURER_FREESCALE, s32k3xx_probe),
+	CORTEXM_DESIGNER_PROBE(JEP106_MANUFACTURER_FREESCALE, ke04_probe),
+	CORTEXM_DESIGNER_PROBE(JEP106_MANUFACTURER_GIGADEVICE, gd32f1_probe),
+	CORTEXM_DESIGNER_PROBE(JEP106_MANUFACTURER_GIGADEVICE, gd32f4_probe),
+	CORTEXM_DESIGNER_PROBE(JEP106_MANUFACTURER_STM, stm32f1_probe),
+	CORTEXM_DESIGNER_PROBE(JEP106_MANUFACTURER_STM, stm32f4_probe),
+	CORTEXM_DESIGNER_PROBE(JEP106_MANUFACTURER_STM, stm32h5_probe),
+	CORTEXM_DESIGNER_PROBE(JEP106_MANUFACTURER_STM, stm32h7_probe),
+	CORTEXM_DESIGNER_PROBE(JEP106_MANUFACTURER_STM, stm32mp15_cm4_probe),
+	CORTEXM_DESIGNER_PROBE(JEP106_MANUFACTURER_STM, stm32l0_probe),
+	CORTEXM_DESIGNER_PROBE(JEP106_MANUFACTURER_STM, stm32l1_probe),
+	CORTEXM_DESIGNER_PROBE(JEP106_MANUFACTURER_STM, stm32l4_probe),
+	CORTEXM_DESIGNER_PROBE(JEP106_MANUFACTURER_STM, stm32g0_probe),
+	CORTEXM_DESIGNER_PROBE(JEP106_MANUFACTURER_STM, stm32wb0_probe),
+	CORTEXM_DESIGNER_PROBE(JEP106_MANUFACTURER_NORDIC, nrf51_probe),
+	CORTEXM_DESIGNER_PROBE(JEP106_MANUFACTURER_NORDIC, nrf54l_probe),
+	CORTEXM_DESIGNER_PROBE(JEP106_MANUFACTURER_NORDIC, nrf91_probe),
+	CORTEXM_DESIGNER_PROBE(JEP106_MANUFACTURER_ATMEL, samx7x_probe),
+	CORTEXM_DESIGNER_PROBE(JEP106_MANUFACTURER_ATMEL, sam4l_probe),
+	CORTEXM_DESIGNER_PROBE(JEP106_MANUFACTURER_ATMEL, samd_probe),
+	CORTEXM_DESIGNER_PROBE(JEP106_MANUFACTURER_ATMEL, samx5x_probe),
+	CORTEXM_DESIGNER_PROBE(JEP106_MANUFACTURER_ENERGY_MICRO, efm32_probe),
+	CORTEXM_DESIGNER_PROBE(JEP106_MANUFACTURER_TEXAS, msp432p4_probe),
+	CORTEXM_DESIGNER_PROBE(JEP106_MANUFACTURER_TEXAS, mspm0_probe),
+	CORTEXM_DESIGNER_PROBE(JEP106_MANUFACTURER_SPECULAR, lpc11xx_probe), /* LPC845 */
+	CORTEXM_DESIGNER_PROBE(JEP106_MANUFACTURER_RASPBERRY, rp2040_probe),
+	CORTEXM_DESIGNER_PROBE(JEP106_MANUFACTURER_RASPBERRY, rp2350_probe),
+	CORTEXM_DESIGNER_PROBE(JEP106_MANUFACTURER_RENESAS, renesas_ra_probe),
+	CORTEXM_DESIGNER_PROBE(JEP106_MANUFACTURER_WCH, ch579_probe),
+	CORTEXM_CORE_PROBE(JEP106_MANUFACTURER_NXP, CORTEX_M33, lpc55xx_probe),
+	CORTEXM_DESIGNER_PROBE(JEP106_MANUFACTURER_ARM_CHINA, mm32f3xx_probe), /* MindMotion Star-MC1 */
+	/* Cortex-M0+ ROM */
+	CORTEXM_PART_PROBE(JEP106_MANUFACTURER_ARM, 0x4c0U, lpc11xx_probe),  /* LPC8 */
+	CORTEXM_PART_PROBE(JEP106_MANUFACTURER_ARM, 0x4c0U, hc32l110_probe), /* HDSC HC32L110 */
+	CORTEXM_PART_PROBE(JEP106_MANUFACTURER_ARM, 0x4c0U, puya_probe),     /* Puya PY32 */
+	/* NXP Cortex-M0+ ROM */
+	CORTEXM_PART_PROBE(JEP106_MANUFACTURER_ARM, 0x4c1U, lpc11xx_probe), /* newer LPC11U6x */
+	/* Cortex-M3 ROM */
+	CORTEXM_PART_PROBE(JEP106_MANUFACTURER_ARM, 0x4c3U, lmi_probe),
+	CORTEXM_PART_PROBE(JEP106_MANUFACTURER_ARM, 0x4c3U, ch32f1_probe),
+	CORTEXM_PART_PROBE(JEP106_MANUFACTURER_ARM, 0x4c3U, stm32f1_probe),  /* Care for other STM32F1 clones (?) */
+	CORTEXM_PART_PROBE(JEP106_MANUFACTURER_ARM, 0x4c3U, lpc15xx_probe),  /* Thanks to JojoS for testing */
+	CORTEXM_PART_PROBE(JEP106_MANUFACTURER_ARM, 0x4c3U, mm32f3xx_probe), /* MindMotion MM32 */
+	/* Cortex-M0 ROM */
+	CORTEXM_PART_PROBE(JEP106_MANUFACTURER_ARM, 0x471U, lpc11xx_probe), /* LPC24C11 */
+	CORTEXM_PART_PROBE(JEP106_MANUFACTURER_ARM, 0x471U, lpc43xx_probe),
+	CORTEXM_PART_PROBE(JEP106_MANUFACTURER_ARM, 0x471U, mm32l0xx_probe), /* MindMotion MM32 */
+	/* Cortex-M4 ROM */
+	CORTEXM_PART_PROBE(JEP106_MANUFACTURER_ARM, 0x4c4U, sam3x_probe),
+	CORTEXM_PART_PROBE(JEP106_MANUFACTURER_ARM, 0x4c4U, lmi_probe),
+	CORTEXM_PART_PROBE(JEP106_MANUFACTURER_ARM, 0x4c4U, apollo_3_probe),
+	/*
+	 * The LPC546xx and LPC43xx parts present with the same AP ROM part number,
+	 * so we need to probe both. Unfortunately, when probing for the LPC43xx
+	 * when the target is actually an LPC546xx, the memory location checked
+	 * is illegal for the LPC546xx and puts the chip into lockup, requiring a
+	 * reset pulse to recover. Instead, make sure to probe for the LPC546xx first,
+	 * which experimentally doesn't harm LPC43xx detection.
+	 */
+	CORTEXM_PART_PROBE(JEP106_MANUFACTURER_ARM, 0x4c4U, lpc546xx_probe),
+	CORTEXM_PART_PROBE(JEP106_MANUFACTURER_ARM, 0x4c4U, lpc43xx_probe),
+	CORTEXM_PART_PROBE(JEP106_MANUFACTURER_ARM, 0x4c4U, at32f40x_probe),
+	CORTEXM_PART_PROBE(JEP106_MANUFACTURER_ARM, 0x4c4U, at32f43x_probe), /* AT32F435 doesn't survive LPC40xx IAP */
+	CORTEXM_PART_PROBE(JEP106_MANUFACTURER_ARM, 0x4c4U, lpc40xx_probe),
+	CORTEXM_PART_PROBE(JEP106_MANUFACTURER_ARM, 0x4c4U, kinetis_probe), /* Older K-series */
+	CORTEXM_PART_PROBE(JEP106_MANUFACTURER_ARM, 0x4c4U, msp432e4_probe),
+	/* Cortex-M23 ROM */
+	CORTEXM_PART_PROBE(JEP106_MANUFACTURER_ARM, 0x4cbU, gd32f1_probe), /* GD32E23x uses GD32F1 peripherals */
+	/*
+	 * These devices enumerate an AP with an empty ascii code,
+	 * and have no available designer code elsewhere
+	 */
+	CORTEXM_DESIGNER_PROBE(ASCII_CODE_FLAG, sam3x_probe),
+	CORTEXM_DESIGNER_PROBE(ASCII_CODE_FLAG, ke04_probe),
+	CORTEXM_DESIGNER_PROBE(ASCII_CODE_FLAG, lpc17xx_probe),
+	CORTEXM_DESIGNER_PROBE(ASCII_CODE_FLAG, lpc11xx_probe), /* LPC1343 */
+};
+
+static void cortexm_probe_cache_key(
+	const target_s *const target, const adiv5_access_port_s *const ap, cortexm_probe_cache_entry_s *const key)
+{
+	memset(key, 0, sizeof(*key));
+	key->dev_index = ap->dp->dev_index;
+	key->apsel = ap->apsel;
+	key->dp_designer_code = ap->dp->designer_code;
+	key->dp_partno = ap->dp->partno;
+	key->designer_code = target->designer_code;
+	key->part_id = target->part_id;
+	key->targetsel = ap->dp->targetsel;
+	key->ap_idr = ap->idr;
+	key->cpuid = target->cpuid;
+}
+
+static cortexm_probe_cache_entry_s *cortexm_probe_cache_lookup(const cortexm_probe_cache_entry_s *const key)
+{
+	for (size_t idx = 0; idx < CORTEXM_PROBE_CACHE_ENTRIES; ++idx) {
+		cortexm_probe_cache_entry_s *const entry = &cortexm_probe_cache[idx];
+		if (entry->part_probe && entry->dev_index == key->dev_index && entry->apsel == key->apsel &&
+			entry->dp_designer_code == key->dp_designer_code && entry->dp_partno == key->dp_partno &&
+			entry->designer_code == key->designer_code && entry->part_id == key->part_id &&
+			entry->targetsel == key->targetsel && entry->ap_idr == key->ap_idr && entry->cpuid == key->cpuid)
+			return entry;
+	}
+	return NULL;
+}
+
+static void cortexm_probe_cache_store(
+	const cortexm_probe_cache_entry_s *const key, const cortexm_part_probe_s *const part_probe)
+{
+	cortexm_probe_cache_entry_s *entry = cortexm_probe_cache_lookup(key);
+	/* If this core isn't already known, take over the oldest entry */
+	if (!entry) {
+		entry = &cortexm_probe_cache[cortexm_probe_cache_next];
+		cortexm_probe_cache_next = (cortexm_probe_cache_next + 1U) % CORTEXM_PROBE_CACHE_ENTRIES;
+	}
+	*entry = *key;
+	entry->part_probe = part_probe;
+}
+
+static bool cortexm_part_probe_matches(const cortexm_part_probe_s *const part_probe, const target_s *const target)
+{
+	return part_probe->designer_code == target->designer_code &&
+		(part_probe->part_id == CORTEXM_PART_ANY || part_probe->part_id == target->part_id) &&
+		(part_probe->cpuid_partno == CORTEXM_CORE_ANY ||
+			part_probe->cpuid_partno == (target->cpuid & CORTEX_CPUID_PARTNO_MASK));
+}
+
+static bool cortexm_part_probe_run(target_s *const target, const cortexm_part_probe_s *const part_probe)
+{
+	DEBUG_TARGET("Calling %s\n", part_probe->name);
+	if (part_probe->probe(target))
+		return true;
+	target_check_error(target);
+	return false;
+}
+
 bool cortexm_probe(adiv5_access_port_s *ap)
 {
 	target_s *target = target_new();
@@ -285,8 +639,15 @@ bool cortexm_probe(adiv5_access_port_s *ap)
 	priv->base.base_addr = CORTEXM_SCS_BASE;
 
 	target->check_error = cortex_check_error;
+	target->check_fault = cortex_check_fault;
 	target->mem_read = cortexm_mem_read;
 	target->mem_write = cortexm_mem_write;
+	target->crc32 = cortexm_crc32;
+	target->mem_fill = cortexm_mem_fill;
+#if CONFIG_BMDA == 1
+	if (ap->dp->mem_poll32)
+		target->mem_poll32 = cortexm_mem_poll32;
+#endif
 
 	target->driver = "ARM Cortex-M";
 
@@ -308,9 +669,11 @@ bool cortexm_probe(adiv5_access_port_s *ap)
 
 	target->regs_description = cortexm_target_description;
 	target->regs_read = cortexm_regs_read;
+	target->regs_read_core = cortexm_regs_read_core;
 	target->regs_write = cortexm_regs_write;
 	target->reg_read = cortexm_reg_read;
 	target->reg_write = cortexm_reg_write;
+	target->pc_read = cortexm_pc_read;
 
 	target->reset = cortexm_reset;
 	target->halt_request = cortexm_halt_request;
@@ -332,6 +695,7 @@ bool cortexm_probe(adiv5_access_port_s *ap)
 	target->breakwatch_clear = cortexm_breakwatch_clear;
 
 	target_add_commands(target, cortexm_cmd_list, target->driver);
+	cortexm_mtb_probe(target);
 
 	/* Default vectors to catch */
 	priv->demcr = CORTEXM_DEMCR_TRCENA | CORTEXM_DEMCR_VC_HARDERR | CORTEXM_DEMCR_VC_CORERESET;
@@ -379,129 +743,30 @@ bool cortexm_probe(adiv5_access_port_s *ap)
 
 	DEBUG_TARGET("%s: Examining Part ID 0x%04x, AP Part ID: 0x%04x\n", __func__, target->part_id, ap->partno);
 
-	switch (target->designer_code) {
-	case JEP106_MANUFACTURER_FREESCALE:
-		PROBE(imxrt_probe);
-		PROBE(kinetis_probe);
-		PROBE(s32k3xx_probe);
-		PROBE(ke04_probe);
-		break;
-	case JEP106_MANUFACTURER_GIGADEVICE:
-		PROBE(gd32f1_probe);
-		PROBE(gd32f4_probe);
-		break;
-	case JEP106_MANUFACTURER_STM:
-		PROBE(stm32f1_probe);
-		PROBE(stm32f4_probe);
-		PROBE(stm32h5_probe);
-		PROBE(stm32h7_probe);
-		PROBE(stm32mp15_cm4_probe);
-		PROBE(stm32l0_probe);
-		PROBE(stm32l1_probe);
-		PROBE(stm32l4_probe);
-		PROBE(stm32g0_probe);
-		PROBE(stm32wb0_probe);
-		break;
-	case JEP106_MANUFACTURER_CYPRESS:
-		DEBUG_WARN("Unhandled Cypress device\n");
-		break;
-	case JEP106_MANUFACTURER_INFINEON:
-		DEBUG_WARN("Unhandled Infineon device\n");
-		break;
-	case JEP106_MANUFACTURER_NORDIC:
-		PROBE(nrf51_probe);
-		PROBE(nrf54l_probe);
-		PROBE(nrf91_probe);
-		break;
-	case JEP106_MANUFACTURER_ATMEL:
-		PROBE(samx7x_probe);
-		PROBE(sam4l_probe);
-		PROBE(samd_probe);
-		PROBE(samx5x_probe);
-		break;
-	case JEP106_MANUFACTURER_ENERGY_MICRO:
-		PROBE(efm32_probe);
-		break;
-	case JEP106_MANUFACTURER_TEXAS:
-		PROBE(msp432p4_probe);
-		PROBE(mspm0_probe);
-		break;
-	case JEP106_MANUFACTURER_SPECULAR:
-		PROBE(lpc11xx_probe); /* LPC845 */
-		break;
-	case JEP106_MANUFACTURER_RASPBERRY:
-		PROBE(rp2040_probe);
-		PROBE(rp2350_probe);
-		break;
-	case JEP106_MANUFACTURER_RENESAS:
-		PROBE(renesas_ra_probe);
-		break;
-	case JEP106_MANUFACTURER_WCH:
-		PROBE(ch579_probe);
-		break;
-	case JEP106_MANUFACTURER_NXP:
-		if ((target->cpuid & CORTEX_CPUID_PARTNO_MASK) == CORTEX_M33)
-			PROBE(lpc55xx_probe);
-		else
-			DEBUG_WARN("Unhandled NXP device\n");
-		break;
-	case JEP106_MANUFACTURER_ARM_CHINA:
-		PROBE(mm32f3xx_probe); /* MindMotion Star-MC1 */
-		break;
-	case JEP106_MANUFACTURER_ARM:
-		/*
-		 * All of these have braces as a brake from the standard so they're completely
-		 * consistent and easier to add new probe calls to.
-		 */
-		if (target->part_id == 0x4c0U) {        /* Cortex-M0+ ROM */
-			PROBE(lpc11xx_probe);               /* LPC8 */
-			PROBE(hc32l110_probe);              /* HDSC HC32L110 */
-			PROBE(puya_probe);                  /* Puya PY32 */
-		} else if (target->part_id == 0x4c1U) { /* NXP Cortex-M0+ ROM */
-			PROBE(lpc11xx_probe);               /* newer LPC11U6x */
-		} else if (target->part_id == 0x4c3U) { /* Cortex-M3 ROM */
-			PROBE(lmi_probe);
-			PROBE(ch32f1_probe);
-			PROBE(stm32f1_probe);               /* Care for other STM32F1 clones (?) */
-			PROBE(lpc15xx_probe);               /* Thanks to JojoS for testing */
-			PROBE(mm32f3xx_probe);              /* MindMotion MM32 */
-		} else if (target->part_id == 0x471U) { /* Cortex-M0 ROM */
-			PROBE(lpc11xx_probe);               /* LPC24C11 */
-			PROBE(lpc43xx_probe);
-			PROBE(mm32l0xx_probe);              /* MindMotion MM32 */
-		} else if (target->part_id == 0x4c4U) { /* Cortex-M4 ROM */
-			PROBE(sam3x_probe);
-			PROBE(lmi_probe);
-			PROBE(apollo_3_probe);
-			/*
-			 * The LPC546xx and LPC43xx parts present with the same AP ROM part number,
-			 * so we need to probe both. Unfortunately, when probing for the LPC43xx
-			 * when the target is actually an LPC546xx, the memory location checked
-			 * is illegal for the LPC546xx and puts the chip into lockup, requiring a
-			 * reset pulse to recover. Instead, make sure to probe for the LPC546xx first,
-			 * which experimentally doesn't harm LPC43xx detection.
-			 */
-			PROBE(lpc546xx_probe);
-			PROBE(lpc43xx_probe);
-			PROBE(at32f40x_probe);
-			PROBE(at32f43x_probe); /* AT32F435 doesn't survive LPC40xx IAP */
-			PROBE(lpc40xx_probe);
-			PROBE(kinetis_probe); /* Older K-series */
-			PROBE(msp432e4_probe);
-		} else if (target->part_id == 0x4cbU) { /* Cortex-M23 ROM */
-			PROBE(gd32f1_probe);                /* GD32E23x uses GD32F1 peripherals */
+	/* If we've seen this core before, try the part probe that matched it last time first */
+	cortexm_probe_cache_entry_s cache_key;
+	cortexm_probe_cache_key(target, ap, &cache_key);
+	cortexm_probe_cache_entry_s *const cached = cortexm_probe_cache_lookup(&cache_key);
+	const cortexm_part_probe_s *failed_probe = NULL;
+	if (cached) {
+		DEBUG_TARGET("%s: Trying cached part probe\n", __func__);
+		if (cortexm_part_probe_run(target, cached->part_probe))
+			return true;
+		/* It's not the part we saw last time after all, so forget it and run the full probe chain */
+		DEBUG_WARN("Cached part probe did not match, rescanning\n");
+		failed_probe = cached->part_probe;
+		cached->part_probe = NULL;
+	}
+
+	/* Run only the part probes declared for this core's designer and part, in table order */
+	for (size_t idx = 0; idx < ARRAY_LENGTH(cortexm_part_probes); ++idx) {
+		const cortexm_part_probe_s *const part_probe = &cortexm_part_probes[idx];
+		if (part_probe == failed_probe || !cortexm_part_probe_matches(part_probe, target))
+			continue;
+		if (cortexm_part_probe_run(target, part_probe)) {
+			cortexm_probe_cache_store(&cache_key, part_probe);
+			return true;
 		}
-		break;
-	case ASCII_CODE_FLAG:
-		/*
-		 * these devices enumerate an AP with an empty ascii code,
-		 * and have no available designer code elsewhere
-		 */
-		PROBE(sam3x_probe);
-		PROBE(ke04_probe);
-		PROBE(lpc17xx_probe);
-		PROBE(lpc11xx_probe); /* LPC1343 */
-		break;
 	}
 #if CONFIG_BMDA == 0
 	gdb_outf("Please report unknown device with Designer 0x%x Part ID 0x%x\n", target->designer_code, target->part_id);
@@ -518,6 +783,10 @@ bool cortexm_attach(target_s *target)
 	/* Mark the DP as being in fault so error recovery will switch to this core when in multi-drop mode */
 	ap->dp->fault = 1;
 	cortexm_priv_s *priv = target->priv;
+	/* The core may have run since the registers were last cached */
+	cortexm_reg_cache_invalidate(target);
+	/* The probe may have been rewired since the last attach, so give nRST another chance */
+	priv->nrst_ineffective = false;
 
 	/* Clear any pending fault condition (and switch to this core) */
 	target_check_error(target);
@@ -554,15 +823,22 @@ bool cortexm_attach(target_s *target)
 	if ((watchpoints >> 28U) < priv->base.watchpoints_available)
 		priv->base.watchpoints_available = watchpoints >> 28U;
 
-	/* Clear any stale breakpoints */
+	/* Clear any stale breakpoints, the comparators being contiguous so this can be done as one block write */
 	priv->base.breakpoints_mask = 0;
-	for (size_t i = 0; i < priv->base.breakpoints_available; i++)
-		target_mem32_write32(target, CORTEXM_FPB_COMP(i), 0);
+	static const uint32_t fpb_comp_clear[CORTEX_MAX_BREAKPOINTS] = {0};
+	if (priv->base.breakpoints_available)
+		target_mem32_write(
+			target, CORTEXM_FPB_COMP(0), fpb_comp_clear, priv->base.breakpoints_available * sizeof(uint32_t));
 
 	/* Clear any stale watchpoints */
 	priv->base.watchpoints_mask = 0;
 	for (size_t i = 0; i < priv->base.watchpoints_available; i++)
 		target_mem32_write32(target, CORTEXM_DWT_FUNC(i), 0);
+	/* That leaves all the comparators disabled, and the DWT ones matching who knows what */
+	memset(&priv->comparators, 0, sizeof(priv->comparators));
+	memset(&priv->comparators_programmed, 0xff, sizeof(priv->comparators_programmed));
+	memset(priv->comparators_programmed.fpb_comp, 0, sizeof(priv->comparators_programmed.fpb_comp));
+	memset(priv->comparators_programmed.dwt_func, 0, sizeof(priv->comparators_programmed.dwt_func));
 
 	/* Flash Patch Control Register: set ENABLE */
 	target_mem32_write32(target, CORTEXM_FPB_CTRL, CORTEXM_FPB_CTRL_KEY | CORTEXM_FPB_CTRL_ENABLE);
@@ -589,6 +865,10 @@ void cortexm_detach(target_s *target)
 {
 	cortexm_priv_s *priv = target->priv;
 
+	/* Make sure any register changes make it to the core before it's let go */
+	cortexm_reg_cache_flush(target);
+	cortexm_reg_cache_invalidate(target);
+
 	/* Clear any stale breakpoints */
 	for (size_t i = 0; i < priv->base.breakpoints_available; i++)
 		target_mem32_write32(target, CORTEXM_FPB_COMP(i), 0);
@@ -613,9 +893,27 @@ enum {
 	DB_DEMCR
 };
 
-static void cortexm_regs_read(target_s *const target, void *const data)
+/* The index of the first of the FPU's registers in the register file, after the core's own */
+static size_t cortexm_fp_reg_offset(const target_s *const target)
+{
+	if (target->target_options & CORTEXM_TOPT_TRUSTZONE)
+		return CORTEXM_GENERAL_REG_COUNT + CORTEXM_TRUSTZONE_REG_COUNT;
+	return CORTEXM_GENERAL_REG_COUNT;
+}
+
+/* Queue reading a run of registers through the banked DCRSR/DCRDR pair, see cortexm_regs_fetch() */
+static void cortexm_regs_queue_read(
+	adiv5_access_port_s *const ap, const uint8_t *const regnums, const size_t count, uint32_t *const regs)
+{
+	for (size_t i = 0U; i < count; ++i) {
+		adiv5_dp_queue_write(ap->dp, ADIV5_AP_DB(DB_DCRSR), regnums[i]);
+		adiv5_dp_queue_read(ap->dp, ADIV5_AP_DB(DB_DCRDR), &regs[i]);
+	}
+}
+
+/* Read the core's own registers, leaving the FPU's to cortexm_regs_fetch_fp() */
+static void cortexm_regs_fetch(target_s *const target, uint32_t *const regs)
 {
-	uint32_t *const regs = data;
 	adiv5_access_port_s *const ap = cortex_ap(target);
 #if CONFIG_BMDA == 1
 	if (ap->dp->ap_regs_read && ap->dp->ap_reg_read) {
@@ -623,12 +921,6 @@ static void cortexm_regs_read(target_s *const target, void *const data)
 		ap->dp->ap_regs_read(ap, core_regs);
 		for (size_t i = 0; i < CORTEXM_GENERAL_REG_COUNT; ++i)
 			regs[i] = core_regs[regnum_cortex_m[i]];
-
-		if (target->target_options & CORTEXM_TOPT_FLAVOUR_FLOAT) {
-			const size_t offset = CORTEXM_GENERAL_REG_COUNT;
-			for (size_t i = 0; i < CORTEX_FLOAT_REG_COUNT; ++i)
-				regs[offset + i] = ap->dp->ap_reg_read(ap, regnum_cortex_mf[i]);
-		}
 	} else {
 #endif
 		/*
@@ -640,44 +932,71 @@ static void cortexm_regs_read(target_s *const target, void *const data)
 		adi_ap_banked_access_setup(ap);
 
 		/* Walk the regnum_cortex_m array, reading the registers it specifies */
-		for (size_t i = 0U; i < CORTEXM_GENERAL_REG_COUNT; ++i) {
-			adiv5_dp_write(ap->dp, ADIV5_AP_DB(DB_DCRSR), regnum_cortex_m[i]);
-			regs[i] = adiv5_dp_read(ap->dp, ADIV5_AP_DB(DB_DCRDR));
-		}
-		size_t offset = CORTEXM_GENERAL_REG_COUNT;
+		cortexm_regs_queue_read(ap, regnum_cortex_m, CORTEXM_GENERAL_REG_COUNT, regs);
 		/* If the core implements TrustZone, pull out the extra stack pointers */
-		if (target->target_options & CORTEXM_TOPT_TRUSTZONE) {
-			for (size_t i = 0U; i < CORTEXM_TRUSTZONE_REG_COUNT; ++i) {
-				adiv5_dp_write(ap->dp, ADIV5_AP_DB(DB_DCRSR), regnum_cortex_m_trustzone[i]);
-				regs[offset + i] = adiv5_dp_read(ap->dp, ADIV5_AP_DB(DB_DCRDR));
-			}
-			offset += CORTEXM_TRUSTZONE_REG_COUNT;
-		}
-		/* If the core has a FPU, also walk the regnum_cortex_mf array */
-		if (target->target_options & CORTEXM_TOPT_FLAVOUR_FLOAT) {
-			for (size_t i = 0U; i < CORTEX_FLOAT_REG_COUNT; ++i) {
-				adiv5_dp_write(ap->dp, ADIV5_AP_DB(DB_DCRSR), regnum_cortex_mf[i]);
-				regs[offset + i] = adiv5_dp_read(ap->dp, ADIV5_AP_DB(DB_DCRDR));
-			}
-		}
+		if (target->target_options & CORTEXM_TOPT_TRUSTZONE)
+			cortexm_regs_queue_read(
+				ap, regnum_cortex_m_trustzone, CORTEXM_TRUSTZONE_REG_COUNT, &regs[CORTEXM_GENERAL_REG_COUNT]);
+		/* Run all the queued accesses */
+		adiv5_dp_queue_flush(ap->dp);
 #if CONFIG_BMDA == 1
 	}
 #endif
 }
 
-static void cortexm_regs_write(target_s *const target, const void *const data)
+/* Read the FPU's registers, walking the regnum_cortex_mf array */
+static void cortexm_regs_fetch_fp(target_s *const target, uint32_t *const regs)
 {
-	const uint32_t *const regs = data;
 	adiv5_access_port_s *const ap = cortex_ap(target);
 #if CONFIG_BMDA == 1
-	if (ap->dp->ap_reg_write) {
-		for (size_t i = 0; i < CORTEXM_GENERAL_REG_COUNT; ++i)
-			ap->dp->ap_reg_write(ap, regnum_cortex_m[i], regs[i]);
+	if (ap->dp->ap_regs_read && ap->dp->ap_reg_read) {
+		for (size_t i = 0; i < CORTEX_FLOAT_REG_COUNT; ++i)
+			regs[i] = ap->dp->ap_reg_read(ap, regnum_cortex_mf[i]);
+		return;
+	}
+#endif
+	adi_ap_mem_access_setup(ap, CORTEXM_DHCSR, ALIGN_32BIT);
+	adi_ap_banked_access_setup(ap);
+	cortexm_regs_queue_read(ap, regnum_cortex_mf, CORTEX_FLOAT_REG_COUNT, regs);
+	adiv5_dp_queue_flush(ap->dp);
+}
+
+/* Fill in whichever parts of the register cache aren't valid yet, the FPU's registers only if asked */
+static void cortexm_reg_cache_fill(target_s *const target, const bool fp)
+{
+	cortexm_priv_s *const priv = target->priv;
+	if (!priv->reg_cache_valid) {
+		cortexm_regs_fetch(target, priv->reg_cache);
+		priv->reg_cache_valid = true;
+	}
+	if (fp && (target->target_options & CORTEXM_TOPT_FLAVOUR_FLOAT) && !priv->reg_cache_fp_valid) {
+		cortexm_regs_fetch_fp(target, &priv->reg_cache[cortexm_fp_reg_offset(target)]);
+		priv->reg_cache_fp_valid = true;
+	}
+}
+
+/* Check whether a register is held in the cache, which is split into the core's and the FPU's registers */
+static bool cortexm_reg_cached(const target_s *const target, const uint32_t reg)
+{
+	const cortexm_priv_s *const priv = target->priv;
+	if (reg >= target->regs_size / sizeof(uint32_t))
+		return false;
+	return reg < cortexm_fp_reg_offset(target) ? priv->reg_cache_valid : priv->reg_cache_fp_valid;
+}
 
-		if (target->target_options & CORTEXM_TOPT_FLAVOUR_FLOAT) {
-			const size_t offset = CORTEXM_GENERAL_REG_COUNT;
-			for (size_t i = 0; i < CORTEX_FLOAT_REG_COUNT; ++i)
-				ap->dp->ap_reg_write(ap, regnum_cortex_mf[i], regs[offset + i]);
+/* Write any registers changed since the cache was filled back to the core */
+static void cortexm_reg_cache_flush(target_s *const target)
+{
+	cortexm_priv_s *const priv = target->priv;
+	if (!priv->reg_cache_dirty)
+		return;
+	adiv5_access_port_s *const ap = cortex_ap(target);
+	const size_t reg_count = target->regs_size / sizeof(uint32_t);
+#if CONFIG_BMDA == 1
+	if (ap->dp->ap_reg_write) {
+		for (size_t i = 0U; i < reg_count; ++i) {
+			if (priv->reg_cache_dirty & (1ULL << i))
+				ap->dp->ap_reg_write(ap, dcrsr_regnum(target, i), priv->reg_cache[i]);
 		}
 	} else {
 #endif
@@ -689,30 +1008,66 @@ static void cortexm_regs_write(target_s *const target, const void *const data)
 		adi_ap_mem_access_setup(ap, CORTEXM_DHCSR, ALIGN_32BIT);
 		adi_ap_banked_access_setup(ap);
 
-		/* Walk the regnum_cortex_m array, writing the registers it specifies */
-		for (size_t i = 0U; i < CORTEXM_GENERAL_REG_COUNT; ++i) {
-			adiv5_dp_write(ap->dp, ADIV5_AP_DB(DB_DCRDR), regs[i]);
-			adiv5_dp_write(ap->dp, ADIV5_AP_DB(DB_DCRSR), CORTEXM_DCRSR_REG_WRITE | regnum_cortex_m[i]);
-		}
-		size_t offset = CORTEXM_GENERAL_REG_COUNT;
-		/* If the core implements TrustZone, write in the extra stack pointers */
-		if (target->target_options & CORTEXM_TOPT_TRUSTZONE) {
-			for (size_t i = 0U; i < CORTEXM_TRUSTZONE_REG_COUNT; ++i) {
-				adiv5_dp_write(ap->dp, ADIV5_AP_DB(DB_DCRDR), regs[offset + i]);
-				adiv5_dp_write(ap->dp, ADIV5_AP_DB(DB_DCRSR), CORTEXM_DCRSR_REG_WRITE | regnum_cortex_m_trustzone[i]);
-			}
-			offset += CORTEXM_TRUSTZONE_REG_COUNT;
-		}
-		/* If the core has a FPU, also walk the regnum_cortex_mf array */
-		if (target->target_options & CORTEXM_TOPT_FLAVOUR_FLOAT) {
-			for (size_t i = 0U; i < CORTEX_FLOAT_REG_COUNT; ++i) {
-				adiv5_dp_write(ap->dp, ADIV5_AP_DB(DB_DCRDR), regs[offset + i]);
-				adiv5_dp_write(ap->dp, ADIV5_AP_DB(DB_DCRSR), CORTEXM_DCRSR_REG_WRITE | regnum_cortex_mf[i]);
-			}
+		/* Queue a DCRDR/DCRSR write pair for each dirty register */
+		for (size_t i = 0U; i < reg_count; ++i) {
+			if (!(priv->reg_cache_dirty & (1ULL << i)))
+				continue;
+			adiv5_dp_queue_write(ap->dp, ADIV5_AP_DB(DB_DCRDR), priv->reg_cache[i]);
+			adiv5_dp_queue_write(
+				ap->dp, ADIV5_AP_DB(DB_DCRSR), CORTEXM_DCRSR_REG_WRITE | (uint32_t)dcrsr_regnum(target, i));
 		}
+		/* Run all the queued accesses */
+		adiv5_dp_queue_flush(ap->dp);
 #if CONFIG_BMDA == 1
 	}
 #endif
+	priv->reg_cache_dirty = 0U;
+}
+
+void cortexm_reg_cache_invalidate(target_s *const target)
+{
+	cortexm_priv_s *const priv = target->priv;
+	priv->reg_cache_valid = false;
+	priv->reg_cache_fp_valid = false;
+	priv->reg_cache_dirty = 0U;
+	/* Whatever let the registers go stale may have let the core touch its D-cache too */
+	cortexm_dcache_forget(priv, false);
+}
+
+static void cortexm_regs_read(target_s *const target, void *const data)
+{
+	cortexm_priv_s *const priv = target->priv;
+	/* Only go to the core for what hasn't been read since it last halted */
+	cortexm_reg_cache_fill(target, true);
+	memcpy(data, priv->reg_cache, target->regs_size);
+}
+
+/* Read just the core's own registers, as GDB reads the FPU's with 'p' only when it needs them */
+static size_t cortexm_regs_read_core(target_s *const target, void *const data)
+{
+	cortexm_priv_s *const priv = target->priv;
+	cortexm_reg_cache_fill(target, false);
+	const size_t length = cortexm_fp_reg_offset(target) * sizeof(uint32_t);
+	memcpy(data, priv->reg_cache, length);
+	return length;
+}
+
+static void cortexm_regs_write(target_s *const target, const void *const data)
+{
+	cortexm_priv_s *const priv = target->priv;
+	const uint32_t *const regs = data;
+	const size_t reg_count = target->regs_size / sizeof(uint32_t);
+	/*
+	 * This supplies every register, so the cache becomes valid either way. Only the registers
+	 * that actually change get marked dirty and are written back when the core is next resumed.
+	 */
+	for (size_t i = 0U; i < reg_count; ++i) {
+		if (!cortexm_reg_cached(target, i) || priv->reg_cache[i] != regs[i])
+			priv->reg_cache_dirty |= 1ULL << i;
+		priv->reg_cache[i] = regs[i];
+	}
+	priv->reg_cache_valid = true;
+	priv->reg_cache_fp_valid = true;
 }
 
 int cortexm_mem_write_aligned(target_s *target, target_addr_t dest, const void *src, size_t len, align_e align)
@@ -744,6 +1099,14 @@ static size_t cortexm_reg_read(target_s *target, uint32_t reg, void *data, size_
 	if (max < 4U)
 		return 0;
 	uint32_t *reg_value = data;
+	cortexm_priv_s *priv = target->priv;
+	/* The first read of any of the FPU's registers since the halt pulls all of them into the cache */
+	if (reg >= cortexm_fp_reg_offset(target) && reg < target->regs_size / sizeof(uint32_t))
+		cortexm_reg_cache_fill(target, true);
+	if (cortexm_reg_cached(target, reg)) {
+		*reg_value = priv->reg_cache[reg];
+		return 4U;
+	}
 	target_mem32_write32(target, CORTEXM_DCRSR, dcrsr_regnum(target, reg));
 	*reg_value = target_mem32_read32(target, CORTEXM_DCRDR);
 	return 4U;
@@ -754,6 +1117,14 @@ static size_t cortexm_reg_write(target_s *target, uint32_t reg, const void *data
 	if (max < 4U)
 		return 0;
 	const uint32_t *reg_value = data;
+	cortexm_priv_s *priv = target->priv;
+	/* If the register is cached, defer the write to when the core is next resumed */
+	if (cortexm_reg_cached(target, reg)) {
+		if (priv->reg_cache[reg] != *reg_value)
+			priv->reg_cache_dirty |= 1ULL << reg;
+		priv->reg_cache[reg] = *reg_value;
+		return 4U;
+	}
 	target_mem32_write32(target, CORTEXM_DCRDR, *reg_value);
 	target_mem32_write32(target, CORTEXM_DCRSR, CORTEXM_DCRSR_REGWnR | dcrsr_regnum(target, reg));
 	return 4U;
@@ -761,14 +1132,14 @@ static size_t cortexm_reg_write(target_s *target, uint32_t reg, const void *data
 
 static uint32_t cortexm_pc_read(target_s *target)
 {
-	target_mem32_write32(target, CORTEXM_DCRSR, 0x0f);
-	return target_mem32_read32(target, CORTEXM_DCRDR);
+	uint32_t pc = 0U;
+	cortexm_reg_read(target, CORTEX_REG_PC, &pc, sizeof(pc));
+	return pc;
 }
 
 static void cortexm_pc_write(target_s *target, const uint32_t val)
 {
-	target_mem32_write32(target, CORTEXM_DCRDR, val);
-	target_mem32_write32(target, CORTEXM_DCRSR, CORTEXM_DCRSR_REGWnR | 0x0fU);
+	cortexm_reg_write(target, CORTEX_REG_PC, &val, sizeof(val));
 }
 
 /*
@@ -777,10 +1148,14 @@ static void cortexm_pc_write(target_s *target, const uint32_t val)
  */
 static void cortexm_reset(target_s *const target)
 {
+	/* Any cached register state is about to be thrown away by the core */
+	cortexm_reg_cache_invalidate(target);
 	/* Read DHCSR here to clear S_RESET_ST bit before reset */
 	target_mem32_read32(target, CORTEXM_DHCSR);
-	/* If the physical reset pin is not inhibited, use it */
-	if (!(target->target_options & TOPT_INHIBIT_NRST)) {
+	cortexm_priv_s *const priv = target->priv;
+	/* If the physical reset pin is not inhibited, and hasn't already been found to do nothing, use it */
+	const bool use_nrst = !(target->target_options & TOPT_INHIBIT_NRST) && !priv->nrst_ineffective;
+	if (use_nrst) {
 		platform_nrst_set_val(true);
 		platform_nrst_set_val(false);
 		/* Some NRF52840 users saw invalid SWD transaction with native/firmware without this delay.*/
@@ -788,12 +1163,16 @@ static void cortexm_reset(target_s *const target)
 	}
 
 	/* Check if the reset succeeded */
-	const uint32_t status = target_mem32_read32(target, CORTEXM_DHCSR);
+	const uint32_t status = use_nrst ? target_mem32_read32(target, CORTEXM_DHCSR) : 0U;
 	if (!(status & CORTEXM_DHCSR_S_RESET_ST)) {
 		/*
 		 * No reset seen yet, maybe as nRST is not connected, or device has TOPT_INHIBIT_NRST set.
-		 * Trigger reset by AIRCR.
+		 * Remember that so the next reset doesn't waste time on nRST, and trigger reset by AIRCR.
 		 */
+		if (use_nrst) {
+			DEBUG_INFO("nRST had no effect, using SYSRESETREQ from now on\n");
+			priv->nrst_ineffective = true;
+		}
 		target_mem32_write32(target, CORTEXM_AIRCR, CORTEXM_AIRCR_VECTKEY | CORTEXM_AIRCR_SYSRESETREQ);
 	}
 
@@ -859,10 +1238,13 @@ static target_halt_reason_e cortexm_halt_poll(target_s *target, target_addr64_t
 	/* Write the same value back to clear the register */
 	target_mem32_write32(target, CORTEXM_DFSR, dfsr);
 
-	/* Check what caches are currently enabled */
-	const uint32_t ccr = target_mem32_read32(target, CORTEXM_CCR);
-	priv->dcache_enabled = ccr & CORTEXM_CCR_DCACHE_ENABLE;
-	priv->icache_enabled = ccr & CORTEXM_CCR_ICACHE_ENABLE;
+	/* Check what caches are currently enabled, if the core has any at all */
+	if (priv->base.icache_line_length || priv->base.dcache_line_length) {
+		const uint32_t ccr = target_mem32_read32(target, CORTEXM_CCR);
+		priv->dcache_enabled = ccr & CORTEXM_CCR_DCACHE_ENABLE;
+		priv->icache_enabled = ccr & CORTEXM_CCR_ICACHE_ENABLE;
+	}
+	cortexm_dcache_forget(priv, true);
 
 	if ((dfsr & CORTEXM_DFSR_VCATCH) && cortexm_fault_unwind(target))
 		return TARGET_HALT_FAULT;
@@ -875,7 +1257,7 @@ static target_halt_reason_e cortexm_halt_poll(target_s *target, target_addr64_t
 		const uint16_t instruction = target_mem32_read16(target, program_counter);
 		/* 0xbeab encodes the breakpoint instruction used to indicate a semihosting call */
 		if (instruction == 0xbeabU) {
-			if (cortexm_hostio_request(target))
+			if (cortexm_hostio_request(target, program_counter))
 				return TARGET_HALT_REQUEST;
 
 			target_halt_resume(target, priv->stepping);
@@ -927,6 +1309,13 @@ void cortexm_halt_resume(target_s *const target, const bool step)
 	if (priv->base.icache_line_length)
 		target_mem32_write32(target, CORTEXM_ICIALLU, 0U);
 
+	/* Bring the break- and watchpoint comparators up to date */
+	cortexm_comparators_sync(target);
+
+	/* Write back any register changes, the cached copies go stale as soon as the core runs */
+	cortexm_reg_cache_flush(target);
+	cortexm_reg_cache_invalidate(target);
+
 	/* Release C_HALT to resume the core in whichever mode is selected */
 	target_mem32_write32(target, CORTEXM_DHCSR, dhcsr);
 }
@@ -993,7 +1382,8 @@ static int cortexm_fault_unwind(target_s *target)
 	return 0;
 }
 
-bool cortexm_run_stub(target_s *target, uint32_t loadaddr, uint32_t r0, uint32_t r1, uint32_t r2, uint32_t r3)
+/* Set up the registers for a stub and start it running, cortexm_wait_stub() then collects the result */
+bool cortexm_start_stub(target_s *target, uint32_t loadaddr, uint32_t r0, uint32_t r1, uint32_t r2, uint32_t r3)
 {
 	uint32_t regs[CORTEXM_MAX_REG_COUNT] = {0};
 
@@ -1011,14 +1401,18 @@ bool cortexm_run_stub(target_s *target, uint32_t loadaddr, uint32_t r0, uint32_t
 		return false;
 
 	/* Execute the stub */
-	target_halt_reason_e reason = TARGET_HALT_RUNNING;
-#if defined(PLATFORM_HAS_DEBUG)
-	uint32_t arm_regs_start[CORTEXM_MAX_REG_COUNT];
-	target_regs_read(target, arm_regs_start);
-#endif
 	cortexm_halt_resume(target, 0);
+	/* The stub is free to change target memory, so nothing read before now can be trusted */
+	target_mem_cache_flush(target);
+	return true;
+}
+
+/* Wait up to timeout_ms for a running stub to hit its exit breakpoint, returning the breakpoint's code */
+bool cortexm_wait_stub(target_s *target, uint32_t timeout_ms)
+{
+	target_halt_reason_e reason = TARGET_HALT_RUNNING;
 	platform_timeout_s timeout;
-	platform_timeout_set(&timeout, 5000);
+	platform_timeout_set(&timeout, timeout_ms);
 	while (reason == TARGET_HALT_RUNNING) {
 		if (platform_timeout_is_expired(&timeout)) {
 			cortexm_halt_request(target);
@@ -1027,7 +1421,7 @@ bool cortexm_run_stub(target_s *target, uint32_t loadaddr, uint32_t r0, uint32_t
 			uint32_t arm_regs[CORTEXM_MAX_REG_COUNT];
 			target_regs_read(target, arm_regs);
 			for (uint32_t i = 0; i < 20U; ++i)
-				DEBUG_WARN("%2" PRIu32 ": %08" PRIx32 ", %08" PRIx32 "\n", i, arm_regs_start[i], arm_regs[i]);
+				DEBUG_WARN("%2" PRIu32 ": %08" PRIx32 "\n", i, arm_regs[i]);
 #endif
 			return false;
 		}
@@ -1050,12 +1444,103 @@ bool cortexm_run_stub(target_s *target, uint32_t loadaddr, uint32_t r0, uint32_t
 	return bkpt_instr & 0xffU;
 }
 
+bool cortexm_run_stub(target_s *target, uint32_t loadaddr, uint32_t r0, uint32_t r1, uint32_t r2, uint32_t r3)
+{
+	return cortexm_start_stub(target, loadaddr, r0, r1, r2, r3) && cortexm_wait_stub(target, 5000U);
+}
+
+/*
+ * Run the CRC32 stub over a region of target memory, updating the running CRC in *crc.
+ * This is used in the middle of a debug session (eg, for GDB's qCRC), so the registers, the RAM
+ * the stub occupies and the breakpoint state are all put back as they were afterwards.
+ */
+static bool cortexm_crc32(target_s *const target, uint32_t *const crc, const target_addr_t base, const size_t len)
+{
+	const target_ram_s *const ram = target->ram;
+	if (!ram || ram->length < CORTEXM_CRC32_SCRATCH_SIZE)
+		return false;
+	/* The stub can't be used to CRC the RAM it's occupying */
+	const target_addr32_t stub_base = ram->start;
+	const target_addr32_t crc_addr = stub_base + CORTEXM_CRC32_SCRATCH_SIZE - 4U;
+	if (base < stub_base + CORTEXM_CRC32_SCRATCH_SIZE && base + len > stub_base)
+		return false;
+	/* And the core has to be halted, otherwise we'd be hijacking the running program */
+	if (!(target_mem32_read32(target, CORTEXM_DHCSR) & CORTEXM_DHCSR_S_HALT))
+		return false;
+
+	cortexm_priv_s *const priv = target->priv;
+	const bool on_bkpt = priv->on_bkpt;
+	uint32_t regs[CORTEXM_MAX_REG_COUNT];
+	uint8_t scratch[CORTEXM_CRC32_SCRATCH_SIZE];
+	target_regs_read(target, regs);
+	target_mem32_read(target, scratch, stub_base, sizeof(scratch));
+
+	target_mem32_write(target, stub_base, cortexm_crc32_stub, sizeof(cortexm_crc32_stub));
+	target_mem32_write32(target, crc_addr, *crc);
+	bool result = !target_check_error(target);
+	if (result)
+		result = cortexm_run_stub(target, stub_base, base, len, crc_addr, 0) == 0;
+	if (result)
+		*crc = target_mem32_read32(target, crc_addr);
+
+	/* Put everything back as the program left it */
+	target_mem32_write(target, stub_base, scratch, sizeof(scratch));
+	target_regs_write(target, regs);
+	priv->on_bkpt = on_bkpt;
+	return result && !target_check_error(target);
+}
+
+/*
+ * Run the fill stub over a word aligned region of target memory. The stub can't fill the RAM it's running
+ * from, so it's run over what's either side of that, and the pattern then goes over whatever of that RAM the
+ * fill covers as the scratch copy is put back. Like the CRC32 stub, this leaves the core as it found it.
+ */
+static bool cortexm_mem_fill(target_s *const target, const target_addr_t dest, const uint32_t value, const size_t len)
+{
+	const target_ram_s *const ram = target->ram;
+	if (!ram || ram->length < CORTEXM_FILL_SCRATCH_SIZE || (ram->start & 3U))
+		return false;
+	if (!(target_mem32_read32(target, CORTEXM_DHCSR) & CORTEXM_DHCSR_S_HALT))
+		return false;
+	const target_addr32_t stub_base = ram->start;
+	const target_addr32_t stub_end = stub_base + CORTEXM_FILL_SCRATCH_SIZE;
+	const target_addr32_t end = dest + len;
+
+	cortexm_priv_s *const priv = target->priv;
+	const bool on_bkpt = priv->on_bkpt;
+	uint32_t regs[CORTEXM_MAX_REG_COUNT];
+	uint8_t scratch[CORTEXM_FILL_SCRATCH_SIZE];
+	target_regs_read(target, regs);
+	target_mem32_read(target, scratch, stub_base, sizeof(scratch));
+
+	target_mem32_write(target, stub_base, cortexm_fill_stub, sizeof(cortexm_fill_stub));
+	bool result = !target_check_error(target);
+	if (result && dest < stub_base)
+		result = cortexm_run_stub(target, stub_base, dest, MIN(end, stub_base) - dest, value, 0) == 0;
+	if (result && end > stub_end) {
+		const target_addr32_t begin = MAX(dest, stub_end);
+		result = cortexm_run_stub(target, stub_base, begin, end - begin, value, 0) == 0;
+	}
+	for (target_addr32_t addr = MAX(dest, stub_base); addr < MIN(end, stub_end); addr += 4U)
+		write_le4(scratch, addr - stub_base, value);
+
+	/* Put everything back as the program left it */
+	target_mem32_write(target, stub_base, scratch, sizeof(scratch));
+	target_regs_write(target, regs);
+	priv->on_bkpt = on_bkpt;
+	return result && !target_check_error(target);
+}
+
 /*
  * The following routines implement hardware breakpoints and watchpoints.
  * The Flash Patch and Breakpoint (FPB) and Data Watch and Trace (DWT)
- * systems are used.
+ * systems are used. Once the FPB runs out of comparators, breakpoints
+ * in Flash are patched into the program instead (see target_flash.c).
  */
 
+/* Marks a breakpoint as patched into Flash rather than using an FPB slot */
+#define CORTEXM_FLASH_BREAKPOINT UINT32_MAX
+
 /*
  * DWT only supports powers of two as size. Convert length in bytes to
  * number of least-significant bits of the address to ignore during
@@ -1131,13 +1616,20 @@ static int cortexm_breakpoint_set(target_s *const target, breakwatch_s *const br
 			break;
 	}
 
-	/* If we could not find any slots, inform the GDB server that we could not set the breakpoint */
-	if (slot == priv->base.breakpoints_available)
-		return -1;
+	/*
+	 * If we could not find any slots, fall back on patching a breakpoint instruction into Flash, and if that's
+	 * not possible either, inform the GDB server that we could not set the breakpoint
+	 */
+	if (slot == priv->base.breakpoints_available) {
+		if (!target_flash_breakpoint_set(target, breakwatch->addr))
+			return -1;
+		breakwatch->reserved[0] = CORTEXM_FLASH_BREAKPOINT;
+		return 0;
+	}
 
 	/* Otherwise, mark the slot chosen as used, and write it with the computed value */
 	priv->base.breakpoints_mask |= 1U << slot;
-	target_mem32_write32(target, CORTEXM_FPB_COMP(slot), breakpoint);
+	priv->comparators.fpb_comp[slot] = breakpoint;
 	breakwatch->reserved[0] = slot;
 	return 0;
 }
@@ -1160,13 +1652,12 @@ static int cortexm_watchpoint_set(target_s *const target, breakwatch_s *const br
 	/* Otherwise, mark the slot chosen as used */
 	priv->base.watchpoints_mask |= 1U << slot;
 	/* Then set the watchpoint hardware up to observe the requested address in the requested way */
-	if ((target->target_options & CORTEXM_TOPT_FLAVOUR_V8M)) {
-		target_mem32_write32(target, CORTEXM_DWT_COMP(slot), breakwatch->addr);
-		target_mem32_write32(target, CORTEXM_DWT_FUNC(slot), cortexm_dwtv2_func(breakwatch->type, breakwatch->size));
-	} else {
-		target_mem32_write32(target, CORTEXM_DWT_COMP(slot), breakwatch->addr);
-		target_mem32_write32(target, CORTEXM_DWT_MASK(slot), cortexm_dwt_mask(breakwatch->size));
-		target_mem32_write32(target, CORTEXM_DWT_FUNC(slot), cortexm_dwt_func(target, breakwatch->type));
+	priv->comparators.dwt_comp[slot] = breakwatch->addr;
+	if ((target->target_options & CORTEXM_TOPT_FLAVOUR_V8M))
+		priv->comparators.dwt_func[slot] = cortexm_dwtv2_func(breakwatch->type, breakwatch->size);
+	else {
+		priv->comparators.dwt_mask[slot] = cortexm_dwt_mask(breakwatch->size);
+		priv->comparators.dwt_func[slot] = cortexm_dwt_func(target, breakwatch->type);
 	}
 	breakwatch->reserved[0] = slot;
 	return 0;
@@ -1194,6 +1685,10 @@ static int cortexm_breakwatch_clear(target_s *const target, breakwatch_s *const
 
 	switch (breakwatch->type) {
 	case TARGET_BREAK_HARD:
+		if (slot == CORTEXM_FLASH_BREAKPOINT) {
+			target_flash_breakpoint_clear(target, breakwatch->addr);
+			return 0;
+		}
 		/* Unmark the slot this breakpoint uses as used */
 		priv->base.breakpoints_mask &= ~(1U << slot);
 		/*
@@ -1202,20 +1697,50 @@ static int cortexm_breakwatch_clear(target_s *const target, breakwatch_s *const
 		 * The ARMv8-M ARM requires this be a write to 0, specifically, as called out in §D1.2.107, FP_COMPn,
 		 * Flash Patch Comparator Register, pg1653
 		 */
-		target_mem32_write32(target, CORTEXM_FPB_COMP(slot), 0U);
+		priv->comparators.fpb_comp[slot] = 0U;
 		return 0;
 	case TARGET_WATCH_WRITE:
 	case TARGET_WATCH_READ:
 	case TARGET_WATCH_ACCESS:
 		/* Unmark the slot this watchpoint uses as used and disable the watchpoint */
 		priv->base.watchpoints_mask &= ~(1U << slot);
-		target_mem32_write32(target, CORTEXM_DWT_FUNC(slot), 0U);
+		priv->comparators.dwt_func[slot] = 0U;
 		return 0;
 	default:
 		return 1;
 	}
 }
 
+/* Write a comparator register, but only if its value has changed since it was last written */
+static void cortexm_comparator_write(
+	target_s *const target, const target_addr32_t addr, const uint32_t value, uint32_t *const programmed)
+{
+	if (*programmed == value)
+		return;
+	target_mem32_write32(target, addr, value);
+	*programmed = value;
+}
+
+static void cortexm_comparators_sync(target_s *const target)
+{
+	cortexm_priv_s *const priv = target->priv;
+	const cortexm_comparators_s *const wanted = &priv->comparators;
+	cortexm_comparators_s *const programmed = &priv->comparators_programmed;
+	for (size_t slot = 0U; slot < priv->base.breakpoints_available; ++slot)
+		cortexm_comparator_write(target, CORTEXM_FPB_COMP(slot), wanted->fpb_comp[slot], &programmed->fpb_comp[slot]);
+	for (size_t slot = 0U; slot < priv->base.watchpoints_available; ++slot) {
+		/* What a disabled comparator matches doesn't matter, so that's left be until it's next enabled */
+		if (wanted->dwt_func[slot]) {
+			cortexm_comparator_write(
+				target, CORTEXM_DWT_COMP(slot), wanted->dwt_comp[slot], &programmed->dwt_comp[slot]);
+			if (!(target->target_options & CORTEXM_TOPT_FLAVOUR_V8M))
+				cortexm_comparator_write(
+					target, CORTEXM_DWT_MASK(slot), wanted->dwt_mask[slot], &programmed->dwt_mask[slot]);
+		}
+		cortexm_comparator_write(target, CORTEXM_DWT_FUNC(slot), wanted->dwt_func[slot], &programmed->dwt_func[slot]);
+	}
+}
+
 static target_addr_t cortexm_check_watch(target_s *target)
 {
 	cortexm_priv_s *priv = target->priv;
@@ -1272,259 +1797,204 @@ static bool cortexm_vector_catch(target_s *target, int argc, const char **argv)
 	return true;
 }
 
-static bool cortexm_hostio_request(target_s *const target)
-{
-	/* Read out the information from the target needed to complete the request */
-	uint32_t syscall = 0U;
-	target_reg_read(target, 0, &syscall, sizeof(syscall));
-	uint32_t r1 = 0U;
-	target_reg_read(target, 1, &r1, sizeof(r1));
-
-	/* Hand off to the main semihosting implementation */
-	const int32_t result = semihosting_request(target, syscall, r1);
-
-	/* Write the result back to the target */
-	target_reg_write(target, 0, &result, sizeof(result));
-	/* Return if the request was in any way interrupted */
-	return target->tc->interrupted;
-}
-
 /*
- * Generate the FPU section of the description.
- * When a Cortex-M core has the optional FPU, the following XML-equivalent is generated:
- *  <feature name="org.gnu.gdb.arm.vfp">
- *      <reg name="fpscr" bitsize="32"/>
- *      <reg name="d0" bitsize="64" type="float"/>
- *      <reg name="d1" bitsize="64" type="float"/>
- *      <reg name="d2" bitsize="64" type="float"/>
- *      <reg name="d3" bitsize="64" type="float"/>
- *      <reg name="d4" bitsize="64" type="float"/>
- *      <reg name="d5" bitsize="64" type="float"/>
- *      <reg name="d6" bitsize="64" type="float"/>
- *      <reg name="d7" bitsize="64" type="float"/>
- *      <reg name="d8" bitsize="64" type="float"/>
- *      <reg name="d9" bitsize="64" type="float"/>
- *      <reg name="d10" bitsize="64" type="float"/>
- *      <reg name="d11" bitsize="64" type="float"/>
- *      <reg name="d12" bitsize="64" type="float"/>
- *      <reg name="d13" bitsize="64" type="float"/>
- *      <reg name="d14" bitsize="64" type="float"/>
- *      <reg name="d15" bitsize="64" type="float"/>
- *  </feature>"
+ * Let the (halted) core run for the given time, reading DWT_PCSR back to back and handing each
+ * sample over as it arrives, then halt the core again. PCSR reads as all 1's when there's no sample
+ * to give, which is also what happens once the core stops by itself, so that ends sampling early.
  */
-static size_t cortexm_build_target_fpu_description(char *const buffer, const size_t max_length)
+bool cortexm_pc_sample(
+	target_s *const target, const uint32_t duration_ms, const cortexm_pc_sample_f sample, void *const ctx)
 {
-	size_t offset = 0U;
-	size_t print_size = max_length;
-	/*
-	 * Start by ending the previous feature block and starting the new FPU one.
-	 * This includes the FPSCR entry which has to come before the VFP registers
-	 */
-	offset += snprintf(buffer + offset, print_size,
-		"</feature><feature name=\"org.gnu.gdb.arm.vfp\">"
-		"<reg name=\"fpscr\" bitsize=\"32\"/>");
-
-	/* After FPSCR, the rest of the VFP registers follow a regular format: d0-d15, bitsize 64, type float. */
-	for (uint8_t i = 0U; i < 16U; ++i) {
-		if (max_length != 0U)
-			print_size = max_length - offset;
-		/* Generate the register entry */
-		offset += snprintf(buffer + offset, print_size, "<reg name=\"d%u\" bitsize=\"64\" type=\"float\"/>", i);
+	target_halt_resume(target, false);
+	platform_timeout_s timeout;
+	platform_timeout_set(&timeout, duration_ms);
+	while (!platform_timeout_is_expired(&timeout)) {
+		const uint32_t pc = target_mem32_read32(target, CORTEXM_DWT_PCSR);
+		if (target_check_error(target))
+			break;
+		if (pc != 0xffffffffU)
+			sample(ctx, pc & ~1U);
+		else if (target_mem32_read32(target, CORTEXM_DHCSR) & CORTEXM_DHCSR_S_HALT)
+			break;
 	}
 
-	/*
-	 * We then leave the closing feature tag off because that will get generated on
-	 * returning to cortexm_build_target_description() by the logic that finishes off the XML block.
-	 */
-	return offset;
+	/* Put the core back how we found it */
+	target_halt_request(target);
+	platform_timeout_set(&timeout, 500U);
+	target_halt_reason_e reason = TARGET_HALT_RUNNING;
+	while (reason == TARGET_HALT_RUNNING && !platform_timeout_is_expired(&timeout))
+		reason = target_halt_poll(target, NULL);
+	return reason != TARGET_HALT_RUNNING && reason != TARGET_HALT_ERROR;
 }
 
-/*
- * Generate the secext section of the description.
- * When a ARMv8-M core has the security (TrustZone) extension, the following XML-equivalent must be generated:
- *  <feature name="org.gnu.gdb.arm.m-secext">
- *      <reg name="msp_ns" bitsize="32" save-restore="no" type="data_ptr"/>
- *      <reg name="psp_ns" bitsize="32" save-restore="no" type="data_ptr"/>
- *      <reg name="msp_s" bitsize="32" save-restore="no" type="data_ptr"/>
- *      <reg name="psp_s" bitsize="32" save-restore="no" type="data_ptr"/>
- *  </feature>
- */
-static size_t cortexm_build_target_secext_description(char *const buffer, const size_t max_length)
-{
-	size_t offset = 0U;
-	size_t print_size = max_length;
-	/* Start by ending the previous feature block and starting the new secext one. */
-	offset +=
-		(size_t)snprintf(buffer + offset, print_size, "</feature><feature name=\"org.gnu.gdb.arm.m-%s\">", "secext");
-
-	/* Loop through first the non-secure and then the secure registers */
-	for (uint8_t mode = 0U; mode <= 1U; ++mode) {
-		/* Then loop through the MSP and PSP entries */
-		for (size_t i = 4U; i <= 5U; ++i) {
-			if (max_length != 0U)
-				print_size = max_length - offset;
-
-			/* Extract the register type and save-restore status from the tables at the top of the file */
-			gdb_reg_type_e type = cortex_m_spr_types[i];
-			gdb_reg_save_restore_e save_restore = cortex_m_spr_save_restores[i];
-
-			/* Build an appropriate entry for the register */
-			offset += (size_t)snprintf(buffer + offset, print_size, "<reg name=\"%s_%ss\" bitsize=\"%u\"%s%s/>",
-				cortex_m_spr_names[i], mode == 0U ? "n" : "", cortex_m_spr_bitsizes[i],
-				gdb_reg_save_restore_strings[save_restore], gdb_reg_type_strings[type]);
+static void cortexm_profile_sample(void *const ctx, const uint32_t pc)
+{
+	cortexm_profile_s *const profile = ctx;
+	const uint32_t addr = pc & profile->mask;
+	++profile->samples;
+	/* Open addressing on the bucket address, a zero count marks a free slot */
+	size_t slot = ((addr >> 1U) * 2654435761U) % CORTEXM_PROFILE_BUCKETS;
+	for (size_t probe = 0; probe < CORTEXM_PROFILE_PROBES; ++probe) {
+		cortexm_profile_bucket_s *const bucket = &profile->buckets[slot];
+		if (!bucket->count || bucket->addr == addr) {
+			bucket->addr = addr;
+			++bucket->count;
+			return;
 		}
+		slot = (slot + 1U) % CORTEXM_PROFILE_BUCKETS;
 	}
-
-	/*
-	 * We then leave the closing feature tag off because that will get generated on
-	 * returning to cortexm_build_target_description() by the logic that follows.
-	 */
-	return offset;
+	++profile->dropped;
 }
 
-/*
- * This function creates the target description XML string for a Cortex-M part.
- * This is done this way to decrease string duplication adn thus code size, making it
- * unfortunately much less readable than the string literal it is equvalent to.
- *
- * The backbone of this approach is snprintf() which will write no more than max_len bytes
- * to the buffer and returns the amount of bytes written. Or, if max_len is 0, then this
- * function will return the amount of bytes that would be necessary to create this string.
- *
- * The string it creates is XML-equivalent to the following:
- *  <?xml version=\"1.0\"?>
- *  <!DOCTYPE target SYSTEM \"gdb-target.dtd\">
- *  <target>
- *      <architecture>arm</architecture>
- *      <feature name="org.gnu.gdb.arm.m-profile">
- *          <reg name="r0" bitsize="32"/>
- *          <reg name="r1" bitsize="32"/>
- *          <reg name="r2" bitsize="32"/>
- *          <reg name="r3" bitsize="32"/>
- *          <reg name="r4" bitsize="32"/>
- *          <reg name="r5" bitsize="32"/>
- *          <reg name="r6" bitsize="32"/>
- *          <reg name="r7" bitsize="32"/>
- *          <reg name="r8" bitsize="32"/>
- *          <reg name="r9" bitsize="32"/>
- *          <reg name="r10" bitsize="32"/>
- *          <reg name="r11" bitsize="32"/>
- *          <reg name="r12" bitsize="32"/>
- *          <reg name="sp" bitsize="32" type="data_ptr"/>
- *          <reg name="lr" bitsize="32" type="code_ptr"/>
- *          <reg name="pc" bitsize="32" type="code_ptr"/>
- *          <reg name="xpsr" bitsize="32" regnum="25"/>
- *      </feature>
- *      <feature name="org.gnu.gdb.arm.m-system">
- *          <reg name="msp" bitsize="32" save-restore="no" type="data_ptr"/>
- *          <reg name="psp" bitsize="32" save-restore="no" type="data_ptr"/>
- *          <reg name="primask" bitsize="8" save-restore="no"/>
- *          <reg name="basepri" bitsize="8" save-restore="no"/>
- *          <reg name="faultmask" bitsize="8" save-restore="no"/>
- *          <reg name="control" bitsize="8" save-restore="no"/>
- *      </feature>
- *  </target>
- */
-static size_t cortexm_build_target_description(
-	char *const buffer, const size_t max_length, const uint32_t target_options)
+static bool cortexm_profile(target_s *target, int argc, const char **argv)
 {
-	/*
-	 * Minor hack: technically snprintf returns an int for possibility of error, but in this case
-	 * these functions are given static input that should not be able to fail -- and if it does,
-	 * then there's nothing we can do about it, so we'll repatedly cast its result to size_t
-	 * when updating this variable (see below).
-	 */
-	size_t offset = 0U;
-	/*
-	 * We can't just repeatedly pass max_length to snprintf, because we keep changing the start
-	 * of buffer (effectively changing its size), so we have to repeatedly recompute the size
-	 * passed to snprintf by subtracting the current total from max_length.
-	 * ...Unless max_length is 0, in which case that subtraction will result in an (underflowed)
-	 * negative number. So we also have to repatedly check if max_length is 0 before performing
-	 * that subtraction.
-	 */
-	size_t print_size = max_length;
-
-	/*
-	 * Start with the "preamble", which is generic across ARM targets,
-	 * ...save for one word, so we'll have to do the preamble in halves.
-	 */
-	offset += (size_t)snprintf(buffer, print_size, "%s target %sarm%s <feature name=\"org.gnu.gdb.arm.m-profile\">",
-		gdb_xml_preamble_first, gdb_xml_preamble_second, gdb_xml_preamble_third);
-
-	/* Then the general purpose registers, which have names of r0 to r12, and all the same bitsize. */
-	for (uint8_t i = 0U; i <= 12U; ++i) {
-		if (max_length != 0)
-			print_size = max_length - offset;
-		offset += (size_t)snprintf(buffer + offset, print_size, "<reg name=\"r%u\" bitsize=\"32\"/>", i);
+	const uint32_t duration_ms = argc > 1 ? strtoul(argv[1], NULL, 0) : 1000U;
+	const uint32_t shift = argc > 2 ? strtoul(argv[2], NULL, 0) : 1U;
+	if (!duration_ms || duration_ms > 60000U || shift < 1U || shift > 16U) {
+		tc_printf(target, "usage: monitor profile [milliseconds (1-60000)] [bucket shift (1-16)]\n");
+		return false;
 	}
 
-	/*
-	 * Now for sp, lr, pc, xpsr, msp, psp, primask, basepri, faultmask, and control.
-	 * These special purpose registers are a little more complicated.
-	 * Some of them have different bitsizes, specified types, or specified save-restore values.
-	 * We'll use the 'associative arrays' defined for those values.
-	 * NOTE: unlike the other loops, this loop uses a size_t for its counter, as it's used to index into arrays.
-	 */
-	for (size_t i = 0U; i < ARRAY_LENGTH(cortex_m_spr_names); ++i) {
-		if (max_length != 0U)
-			print_size = max_length - offset;
-
-		/* Extract the register type and save-restore status from the tables at the top of the file */
-		gdb_reg_type_e type = cortex_m_spr_types[i];
-		gdb_reg_save_restore_e save_restore = cortex_m_spr_save_restores[i];
+	cortexm_profile_s *const profile = calloc(1, sizeof(*profile));
+	if (!profile) { /* calloc failed: heap exhaustion */
+		DEBUG_ERROR("calloc: failed in %s\n", __func__);
+		return false;
+	}
+	profile->mask = ~((1U << shift) - 1U);
 
-		/*
-		 * There is one special extra thing that has to happen here -
-		 * xPSR (reg index 3) requires placement at register logical number 25
-		 */
-		offset += (size_t)snprintf(buffer + offset, print_size, "<reg name=\"%s\" bitsize=\"%u\"%s%s%s/>",
-			cortex_m_spr_names[i], cortex_m_spr_bitsizes[i], gdb_reg_save_restore_strings[save_restore],
-			gdb_reg_type_strings[type], i == 3U ? " regnum=\"25\"" : "");
+	const uint32_t start_time = platform_time_ms();
+	const bool result = cortexm_pc_sample(target, duration_ms, cortexm_profile_sample, profile);
+	const uint32_t elapsed = platform_time_ms() - start_time;
+	if (!result)
+		tc_printf(target, "Failed to halt the core again after sampling\n");
 
-		/* After the xPSR, then need to generate the system block to receive system regs */
-		if (i == 3U) {
-			if (max_length != 0U)
-				print_size = max_length - offset;
+	tc_printf(target, "%" PRIu32 " samples in %" PRIu32 "ms", profile->samples, elapsed);
+	if (profile->dropped)
+		tc_printf(target, ", %" PRIu32 " outside the table", profile->dropped);
+	tc_printf(target, "\n");
 
-			offset += (size_t)snprintf(
-				buffer + offset, print_size, "</feature><feature name=\"org.gnu.gdb.arm.m-%s\">", "system");
+	/* Report the busiest buckets, pulling each out of the table as it's printed */
+	for (size_t entry = 0; entry < CORTEXM_PROFILE_REPORT && profile->samples; ++entry) {
+		cortexm_profile_bucket_s *busiest = &profile->buckets[0];
+		for (size_t slot = 1; slot < CORTEXM_PROFILE_BUCKETS; ++slot) {
+			if (profile->buckets[slot].count > busiest->count)
+				busiest = &profile->buckets[slot];
 		}
+		if (!busiest->count)
+			break;
+		const uint32_t permille = (uint32_t)(((uint64_t)busiest->count * 1000U) / profile->samples);
+		tc_printf(target, "0x%08" PRIx32 "-0x%08" PRIx32 ": %8" PRIu32 " %3" PRIu32 ".%" PRIu32 "%%\n", busiest->addr,
+			busiest->addr + ~profile->mask, busiest->count, permille / 10U, permille % 10U);
+		busiest->count = 0;
 	}
+	free(profile);
+	return result;
+}
 
-	/* If the target implements TrustZone, include the extra stack pointers */
-	if (target_options & CORTEXM_TOPT_TRUSTZONE) {
-		if (max_length != 0U)
-			print_size = max_length - offset;
-		offset += cortexm_build_target_secext_description(buffer + offset, print_size);
-	}
+/* Wait for the core to come back to halt after a step, forcing the issue if it seems to have run away */
+static target_halt_reason_e cortexm_step_wait(target_s *const target)
+{
+	platform_timeout_s timeout;
+	platform_timeout_set(&timeout, cortexm_wait_timeout);
+	target_halt_reason_e reason = TARGET_HALT_RUNNING;
+	while (reason == TARGET_HALT_RUNNING && !platform_timeout_is_expired(&timeout))
+		reason = target_halt_poll(target, NULL);
+	if (reason != TARGET_HALT_RUNNING)
+		return reason;
 
-	/* If the target has a FPU, include that */
-	if (target_options & CORTEXM_TOPT_FLAVOUR_FLOAT) {
-		if (max_length != 0U)
-			print_size = max_length - offset;
-		offset += cortexm_build_target_fpu_description(buffer + offset, print_size);
+	target_halt_request(target);
+	platform_timeout_set(&timeout, cortexm_wait_timeout);
+	while (reason == TARGET_HALT_RUNNING && !platform_timeout_is_expired(&timeout))
+		reason = target_halt_poll(target, NULL);
+	return reason == TARGET_HALT_RUNNING ? TARGET_HALT_ERROR : TARGET_HALT_REQUEST;
+}
+
+/*
+ * Step the core COUNT instructions, or until the PC leaves [RANGE_START, RANGE_END), without going
+ * back to GDB between each one. With "trace", the PC after each step is reported as we go.
+ * GDB doesn't know the core moved, so its register cache needs flushing afterwards.
+ */
+static bool cortexm_step(target_s *target, int argc, const char **argv)
+{
+	const bool trace = argc > 1 && strcmp(argv[1], "trace") == 0;
+	if (trace) {
+		--argc;
+		++argv;
+	}
+	const uint32_t count = argc > 1 ? strtoul(argv[1], NULL, 0) : 0U;
+	if ((argc != 2 && argc != 4) || !count) {
+		tc_printf(target, "usage: monitor step [trace] COUNT [RANGE_START RANGE_END]\n");
+		return false;
+	}
+	const uint32_t range_start = argc == 4 ? strtoul(argv[2], NULL, 0) : 0U;
+	const uint32_t range_end = argc == 4 ? strtoul(argv[3], NULL, 0) : UINT32_MAX;
+
+	uint32_t steps = 0U;
+	uint32_t program_counter = cortexm_pc_read(target);
+	target_halt_reason_e reason = TARGET_HALT_STEPPING;
+	while (steps < count && reason == TARGET_HALT_STEPPING) {
+		target_halt_resume(target, true);
+		reason = cortexm_step_wait(target);
+		if (reason == TARGET_HALT_ERROR) {
+			tc_printf(target, "Core failed to halt after %" PRIu32 " steps\n", steps);
+			return false;
+		}
+		++steps;
+		program_counter = cortexm_pc_read(target);
+		if (trace)
+			tc_printf(target, "0x%08" PRIx32 "\n", program_counter);
+		if (program_counter < range_start || program_counter >= range_end)
+			break;
 	}
+	tc_printf(target, "Stepped %" PRIu32 " instructions, PC now 0x%08" PRIx32 "%s\n", steps, program_counter,
+		reason == TARGET_HALT_STEPPING ? "" : " (stopped early)");
+	return true;
+}
+
+static bool cortexm_hostio_request(target_s *const target, const uint32_t program_counter)
+{
+	cortexm_priv_s *const priv = target->priv;
+	adiv5_access_port_s *const ap = cortex_ap(target);
+	/*
+	 * Read out the information from the target needed to complete the request, which is just r0 and r1.
+	 * Map the AP's banked data registers to DHCSR, DCRSR, DCRDR and DEMCR so this is one queued batch
+	 */
+	uint32_t syscall = 0U;
+	uint32_t r1 = 0U;
+	adi_ap_mem_access_setup(ap, CORTEXM_DHCSR, ALIGN_32BIT);
+	adi_ap_banked_access_setup(ap);
+	adiv5_dp_queue_write(ap->dp, ADIV5_AP_DB(DB_DCRSR), (uint32_t)dcrsr_regnum(target, 0U));
+	adiv5_dp_queue_read(ap->dp, ADIV5_AP_DB(DB_DCRDR), &syscall);
+	adiv5_dp_queue_write(ap->dp, ADIV5_AP_DB(DB_DCRSR), (uint32_t)dcrsr_regnum(target, 1U));
+	adiv5_dp_queue_read(ap->dp, ADIV5_AP_DB(DB_DCRDR), &r1);
+	adiv5_dp_queue_flush(ap->dp);
 
-	/* Now generate the closing tags that are required */
-	if (max_length != 0U)
-		print_size = max_length - offset;
-	offset += (size_t)snprintf(buffer + offset, print_size, "</feature></target>");
+	/* Hand off to the main semihosting implementation */
+	const int32_t result = semihosting_request(target, syscall, r1);
 
 	/*
-	 * Minor hack: technically snprintf returns an int for possibility of error, but in this case
-	 * these functions are given static input that should not ever be able to fail -- and if it
-	 * does, then there's nothing we can do about it, so we just discard the signedness when building
-	 * the total in `offset` as we go.
+	 * Exit requests, interrupted requests and anything that left the register cache populated go through
+	 * the normal resume path. For everything else, we already know the PC is sat on the BKPT, so write the
+	 * result back to r0 and step the PC past the instruction in one go, letting the resume skip re-reading both
 	 */
-	return offset;
+	if (target->tc->interrupted || priv->reg_cache_valid || priv->reg_cache_fp_valid ||
+		syscall == SEMIHOSTING_SYS_EXIT || syscall == SEMIHOSTING_SYS_EXIT_EXTENDED) {
+		target_reg_write(target, 0, &result, sizeof(result));
+		return target->tc->interrupted;
+	}
+	adi_ap_mem_access_setup(ap, CORTEXM_DHCSR, ALIGN_32BIT);
+	adi_ap_banked_access_setup(ap);
+	adiv5_dp_queue_write(ap->dp, ADIV5_AP_DB(DB_DCRDR), (uint32_t)result);
+	adiv5_dp_queue_write(ap->dp, ADIV5_AP_DB(DB_DCRSR), CORTEXM_DCRSR_REG_WRITE | (uint32_t)dcrsr_regnum(target, 0U));
+	adiv5_dp_queue_write(ap->dp, ADIV5_AP_DB(DB_DCRDR), program_counter + 2U);
+	adiv5_dp_queue_write(
+		ap->dp, ADIV5_AP_DB(DB_DCRSR), CORTEXM_DCRSR_REG_WRITE | (uint32_t)dcrsr_regnum(target, CORTEX_REG_PC));
+	adiv5_dp_queue_flush(ap->dp);
+	priv->on_bkpt = false;
+	return false;
 }
 
-static const char *cortexm_target_description(target_s *const target)
+static void cortexm_target_description(target_s *const target, target_description_stream_s *const stream)
 {
-	const size_t description_length = cortexm_build_target_description(NULL, 0, target->target_options) + 1U;
-	char *const description = malloc(description_length);
-	if (description)
-		cortexm_build_target_description(description, description_length, target->target_options);
-	return description;
+	target_description_pieces(stream, cortexm_description, ARRAY_LENGTH(cortexm_description), target->target_options);
 }
@@ -65,6 +65,7 @@ extern unsigned cortexm_wait_timeout;
 #define CORTEXM_DWT_BASE (CORTEXM_PPB_BASE + 0x1000U)
 
 #define CORTEXM_DWT_CTRL    (CORTEXM_DWT_BASE + 0x000U)
+#define CORTEXM_DWT_PCSR    (CORTEXM_DWT_BASE + 0x01cU)
 #define CORTEXM_DWT_COMP(i) (CORTEXM_DWT_BASE + 0x020U + (0x10U * (i)))
 #define CORTEXM_DWT_MASK(i) (CORTEXM_DWT_BASE + 0x024U + (0x10U * (i)))
 #define CORTEXM_DWT_FUNC(i) (CORTEXM_DWT_BASE + 0x028U + (0x10U * (i)))
@@ -191,10 +192,19 @@ extern unsigned cortexm_wait_timeout;
 bool cortexm_attach(target_s *target);
 void cortexm_detach(target_s *target);
 void cortexm_halt_resume(target_s *target, bool step);
+void cortexm_reg_cache_invalidate(target_s *target);
 bool cortexm_run_stub(target_s *target, uint32_t loadaddr, uint32_t r0, uint32_t r1, uint32_t r2, uint32_t r3);
+bool cortexm_start_stub(target_s *target, uint32_t loadaddr, uint32_t r0, uint32_t r1, uint32_t r2, uint32_t r3);
+bool cortexm_wait_stub(target_s *target, uint32_t timeout_ms);
 int cortexm_mem_write_aligned(target_s *target, target_addr_t dest, const void *src, size_t len, align_e align);
 uint32_t cortexm_demcr_read(const target_s *target);
 void cortexm_demcr_write(target_s *target, uint32_t demcr);
 bool target_is_cortexm(const target_s *target);
+/* Register the MTB trace commands on cores that can have one */
+void cortexm_mtb_probe(target_s *target);
+
+/* Called for each PC sampled by cortexm_pc_sample() */
+typedef void (*cortexm_pc_sample_f)(void *ctx, uint32_t pc);
+bool cortexm_pc_sample(target_s *target, uint32_t duration_ms, cortexm_pc_sample_f sample, void *ctx);
 
 #endif /* TARGET_CORTEXM_H */
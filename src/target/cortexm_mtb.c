@@ -0,0 +1,218 @@
+/*
+ * This file is part of the Black Magic Debug project.
+ *
+ * Copyright (C) 2026 1BitSquared <info@1bitsquared.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * This file implements instruction trace for Cortex-M0+ cores through the CoreSight MTB-M0+ (Micro Trace
+ * Buffer), as described in the ARM document DDI0486B.
+ *
+ * The MTB records every non-sequential change of flow the core makes as a source/destination address pair
+ * into a region of the target's own SRAM - so that region must be set aside by the firmware (or at least
+ * not be in use) while tracing. Once the core halts, the buffer is read back and turned into the history of
+ * the instruction ranges the core executed, oldest first.
+ */
+
+#include "general.h"
+#include "target.h"
+#include "target_internal.h"
+#include "adi.h"
+#include "adiv5.h"
+#include "cortex.h"
+#include "cortexm.h"
+#include "maths_utils.h"
+
+#define MTB_PART_NUMBER 0x932U
+
+#define MTB_POSITION 0x000U
+#define MTB_MASTER   0x004U
+#define MTB_FLOW     0x008U
+#define MTB_BASE     0x00cU
+
+#define MTB_POSITION_POINTER_MASK 0xfffffff8U
+#define MTB_POSITION_WRAP         (1U << 2U)
+#define MTB_MASTER_EN             (1U << 31U)
+#define MTB_MASTER_MASK_MASK      0x1fU
+
+/* Each packet is a source word with the A (exception) bit, then a destination word with the S (start) bit */
+#define MTB_PACKET_SIZE      8U
+#define MTB_PACKET_EXCEPTION (1U << 0U)
+#define MTB_PACKET_START     (1U << 0U)
+/* MASTER.MASK[4:0] sizes the buffer as 2^(MASK + 4) bytes, so it's at least 16 */
+#define MTB_MIN_SIZE 16U
+/* How many packets to read from the target at a time */
+#define MTB_READ_PACKETS 32U
+
+static bool cortexm_mtb_cmd(target_s *target, int argc, const char **argv);
+
+static const command_s cortexm_mtb_cmd_list[] = {
+	{"mtb", cortexm_mtb_cmd, "Micro Trace Buffer instruction trace: (enable ADDR SIZE|disable|status|dump [COUNT])"},
+	{NULL, NULL, NULL},
+};
+
+void cortexm_mtb_probe(target_s *const target)
+{
+	if ((target->cpuid & CORTEX_CPUID_PARTNO_MASK) == CORTEX_M0P)
+		target_add_commands(target, cortexm_mtb_cmd_list, "Cortex-M0+ MTB");
+}
+
+/* The MTB isn't needed to debug the core so probe doesn't look for it, instead find it here on demand */
+static target_addr32_t cortexm_mtb_find(target_s *const target)
+{
+	adiv5_access_port_s *const ap = cortex_ap(target);
+	const target_addr32_t mtb = adi_ap_find_component(ap, (target_addr32_t)ap->base, MTB_PART_NUMBER, 0U);
+	if (!mtb)
+		tc_printf(target, "No MTB found on this core\n");
+	return mtb;
+}
+
+static uint32_t cortexm_mtb_size(const uint32_t master)
+{
+	return MTB_MIN_SIZE << (master & MTB_MASTER_MASK_MASK);
+}
+
+static bool cortexm_mtb_enable(target_s *const target, const target_addr32_t mtb, const int argc, const char **argv)
+{
+	if (argc != 4) {
+		tc_printf(target, "usage: monitor mtb enable ADDR SIZE\n");
+		return false;
+	}
+	const uint32_t addr = strtoul(argv[2], NULL, 0);
+	const uint32_t size = strtoul(argv[3], NULL, 0);
+	const uint32_t base = target_mem32_read32(target, mtb + MTB_BASE);
+	/* The MTB can only wrap on a power-of-two sized buffer, aligned to its size, within the SRAM it's wired to */
+	if (size < MTB_MIN_SIZE || (size & (size - 1U)) || (addr & (size - 1U)) || addr < base) {
+		tc_printf(target, "The buffer must be a power of two of at least %u bytes, aligned to its size and at or "
+						  "above the MTB's SRAM base 0x%08" PRIx32 "\n",
+			MTB_MIN_SIZE, base);
+		return false;
+	}
+
+	const uint32_t mask = ulog2(size) - ulog2(MTB_MIN_SIZE);
+	target_mem32_write32(target, mtb + MTB_MASTER, 0U);
+	target_mem32_write32(target, mtb + MTB_POSITION, (addr - base) & MTB_POSITION_POINTER_MASK);
+	target_mem32_write32(target, mtb + MTB_FLOW, 0U);
+	target_mem32_write32(target, mtb + MTB_MASTER, MTB_MASTER_EN | mask);
+	/* MASK only implements as many bits as the SRAM the MTB has, so read it back to see what we got */
+	const uint32_t master = target_mem32_read32(target, mtb + MTB_MASTER);
+	if (target_check_error(target) || !(master & MTB_MASTER_EN)) {
+		tc_printf(target, "Failed to enable the MTB\n");
+		return false;
+	}
+	if ((master & MTB_MASTER_MASK_MASK) != mask)
+		tc_printf(target, "MTB limited the buffer to %" PRIu32 " bytes\n", cortexm_mtb_size(master));
+	tc_printf(target, "Tracing into 0x%08" PRIx32 "\n", addr);
+	return true;
+}
+
+static void cortexm_mtb_status(target_s *const target, const target_addr32_t mtb)
+{
+	const uint32_t master = target_mem32_read32(target, mtb + MTB_MASTER);
+	const uint32_t position = target_mem32_read32(target, mtb + MTB_POSITION);
+	const uint32_t base = target_mem32_read32(target, mtb + MTB_BASE);
+	const uint32_t size = cortexm_mtb_size(master);
+	tc_printf(target, "MTB at 0x%08" PRIx32 ": %s, buffer 0x%08" PRIx32 " (%" PRIu32 " bytes)%s\n", mtb,
+		master & MTB_MASTER_EN ? "enabled" : "disabled",
+		base + ((position & MTB_POSITION_POINTER_MASK) & ~(size - 1U)), size,
+		position & MTB_POSITION_WRAP ? ", wrapped" : "");
+}
+
+/*
+ * Walk the buffer oldest packet first. Between one packet's destination and the next packet's source the core
+ * ran straight through, so each line is a range of executed instructions and where the range ended up going
+ */
+static bool cortexm_mtb_dump(target_s *const target, const target_addr32_t mtb, const int argc, const char **argv)
+{
+	const uint32_t master = target_mem32_read32(target, mtb + MTB_MASTER);
+	const uint32_t position = target_mem32_read32(target, mtb + MTB_POSITION);
+	const uint32_t base = target_mem32_read32(target, mtb + MTB_BASE);
+	if (target_check_error(target)) {
+		tc_printf(target, "Failed to read the MTB's state\n");
+		return false;
+	}
+
+	const uint32_t size = cortexm_mtb_size(master);
+	const uint32_t pointer = position & MTB_POSITION_POINTER_MASK;
+	const target_addr32_t buffer = base + (pointer & ~(size - 1U));
+	const uint32_t packets = size / MTB_PACKET_SIZE;
+	const uint32_t next = (pointer & (size - 1U)) / MTB_PACKET_SIZE;
+	uint32_t count = position & MTB_POSITION_WRAP ? packets : next;
+	const uint32_t limit = argc > 2 ? strtoul(argv[2], NULL, 0) : 0U;
+	if (limit && limit < count)
+		count = limit;
+	/* The newest packet is the one before the write pointer, so count back from there */
+	uint32_t index = (next + packets - count) % packets;
+
+	tc_printf(target, "%" PRIu32 " branches, oldest first\n", count);
+	uint32_t data[MTB_READ_PACKETS * 2U];
+	uint32_t previous = 0U;
+	bool have_previous = false;
+	while (count) {
+		const uint32_t chunk = MIN(MIN(count, packets - index), MTB_READ_PACKETS);
+		if (target_mem32_read(target, data, buffer + index * MTB_PACKET_SIZE, chunk * MTB_PACKET_SIZE)) {
+			tc_printf(target, "Failed to read the trace buffer\n");
+			return false;
+		}
+		for (uint32_t packet = 0U; packet < chunk; ++packet) {
+			const uint32_t source = data[packet * 2U];
+			const uint32_t destination = data[packet * 2U + 1U];
+			/* The S bit marks the first packet after tracing (re)started, so the last destination means nothing */
+			if (destination & MTB_PACKET_START) {
+				tc_printf(target, "-- trace start --\n");
+				have_previous = false;
+			}
+			if (have_previous)
+				tc_printf(target, "0x%08" PRIx32 "-0x%08" PRIx32, previous, source & ~1U);
+			else
+				tc_printf(target, "           0x%08" PRIx32, source & ~1U);
+			tc_printf(target, " -> 0x%08" PRIx32 "%s\n", destination & ~1U,
+				source & MTB_PACKET_EXCEPTION ? " (exception)" : "");
+			previous = destination & ~1U;
+			have_previous = true;
+		}
+		count -= chunk;
+		index = (index + chunk) % packets;
+	}
+	return true;
+}
+
+static bool cortexm_mtb_cmd(target_s *const target, const int argc, const char **const argv)
+{
+	if (argc < 2) {
+		tc_printf(target, "usage: monitor mtb (enable ADDR SIZE|disable|status|dump [COUNT])\n");
+		return false;
+	}
+	const target_addr32_t mtb = cortexm_mtb_find(target);
+	if (!mtb)
+		return false;
+
+	if (strcmp(argv[1], "enable") == 0)
+		return cortexm_mtb_enable(target, mtb, argc, argv);
+	if (strcmp(argv[1], "disable") == 0) {
+		const uint32_t master = target_mem32_read32(target, mtb + MTB_MASTER);
+		target_mem32_write32(target, mtb + MTB_MASTER, master & ~MTB_MASTER_EN);
+		return !target_check_error(target);
+	}
+	if (strcmp(argv[1], "status") == 0) {
+		cortexm_mtb_status(target, mtb);
+		return true;
+	}
+	if (strcmp(argv[1], "dump") == 0)
+		return cortexm_mtb_dump(target, mtb, argc, argv);
+	tc_printf(target, "usage: monitor mtb (enable ADDR SIZE|disable|status|dump [COUNT])\n");
+	return false;
+}
@@ -45,9 +45,13 @@
 
 #define SRAM_BASE        0x20000000U
 #define STUB_BUFFER_BASE ALIGN(SRAM_BASE + sizeof(efm32_flash_write_stub), 4U)
+/* Set in the MSC address handed to the write stub to have it use WriteFast */
+#define EFM32_STUB_WRITE_FAST 1U
 
+static bool efm32_flash_prepare(target_flash_s *f);
 static bool efm32_flash_erase(target_flash_s *f, target_addr_t addr, size_t len);
 static bool efm32_flash_write(target_flash_s *f, target_addr_t dest, const void *src, size_t len);
+static bool efm32_flash_write_wait(target_flash_s *f);
 static bool efm32_mass_erase(target_s *t, platform_timeout_s *print_progess);
 
 static const uint16_t efm32_flash_write_stub[] = {
@@ -511,8 +515,11 @@ static void efm32_add_flash(target_s *t, target_addr_t addr, size_t length, size
 	f->start = addr;
 	f->length = length;
 	f->blocksize = page_size;
+	f->prepare = efm32_flash_prepare;
 	f->erase = efm32_flash_erase;
 	f->write = efm32_flash_write;
+	f->write_wait = efm32_flash_write_wait;
+	f->write_overlaps = true;
 	f->writesize = page_size;
 	target_add_flash(t, f);
 }
@@ -538,6 +545,11 @@ typedef struct efm32_priv {
 	char efm32_variant_string[60];
 	uint8_t di_version;
 	const efm32_device_s *device;
+	bool double_buffered;         /* There's room in SRAM for a second page buffer after the stub's first */
+	bool write_fast;              /* Program with WriteFast, until the MSC shows it isn't up to it */
+	uint8_t buffer_index;         /* Which page buffer the next write loads its data into */
+	target_addr32_t write_dest;   /* Where the stub currently running is programming to */
+	target_addr32_t write_buffer; /* and the buffer it is programming from */
 } efm32_priv_s;
 
 bool efm32_probe(target_s *t)
@@ -582,6 +594,8 @@ bool efm32_probe(target_s *t)
 
 	priv_storage->di_version = di_version;
 	priv_storage->device = device;
+	priv_storage->write_fast = true;
+	priv_storage->double_buffered = ram_size >= (STUB_BUFFER_BASE - SRAM_BASE) + (2U * flash_page_size);
 
 	snprintf(priv_storage->efm32_variant_string, sizeof(priv_storage->efm32_variant_string), "%s%huF%hu %s",
 		device->name, part_number, flash_kib, device->description);
@@ -646,23 +660,69 @@ static bool efm32_flash_erase(target_flash_s *f, target_addr_t addr, size_t len)
 	return true;
 }
 
-/* Write flash page by page */
-static bool efm32_flash_write(target_flash_s *f, target_addr_t dest, const void *src, size_t len)
+/* Load the write stub once for the whole run of writes, rather than with every page */
+static bool efm32_flash_prepare(target_flash_s *f)
 {
-	(void)len;
+	target_s *t = f->t;
+	efm32_priv_s *priv_storage = (efm32_priv_s *)t->target_storage;
+	if (!priv_storage || !priv_storage->device)
+		return false;
+	if (f->operation != FLASH_OPERATION_WRITE)
+		return true;
 
+	priv_storage->buffer_index = 0;
+	return target_mem32_write(t, SRAM_BASE, efm32_flash_write_stub, sizeof(efm32_flash_write_stub)) == 0;
+}
+
+static bool efm32_flash_start_stub(target_s *t, efm32_priv_s *priv_storage, size_t len)
+{
+	const uint32_t msc_mode = priv_storage->device->msc_addr | (priv_storage->write_fast ? EFM32_STUB_WRITE_FAST : 0U);
+	return cortexm_start_stub(t, SRAM_BASE, priv_storage->write_dest, priv_storage->write_buffer, len, msc_mode);
+}
+
+/*
+ * Write flash page by page. Each page is loaded into the page buffer the stub isn't using before waiting on
+ * the page before it, so the stub spends as little time as possible idle between pages
+ */
+static bool efm32_flash_write(target_flash_s *f, target_addr_t dest, const void *src, size_t len)
+{
 	target_s *t = f->t;
 
 	efm32_priv_s *priv_storage = (efm32_priv_s *)t->target_storage;
 	if (!priv_storage || !priv_storage->device)
 		return false;
 
-	/* Write flashloader */
-	target_mem32_write(t, SRAM_BASE, efm32_flash_write_stub, sizeof(efm32_flash_write_stub));
+	/* With only the one buffer, the previous page has to finish before this one can be loaded over it */
+	if (f->write_pending && !priv_storage->double_buffered && !efm32_flash_write_wait(f))
+		return false;
+	const target_addr32_t buffer = STUB_BUFFER_BASE + (priv_storage->buffer_index * f->writesize);
 	/* Write Buffer */
-	target_mem32_write(t, STUB_BUFFER_BASE, src, len);
+	if (target_mem32_write(t, buffer, src, len))
+		return false;
+	if (f->write_pending && priv_storage->double_buffered && !efm32_flash_write_wait(f))
+		return false;
+
 	/* Run flashloader */
-	const bool ret = cortexm_run_stub(t, SRAM_BASE, dest, STUB_BUFFER_BASE, len, priv_storage->device->msc_addr) == 0;
+	priv_storage->write_dest = dest;
+	priv_storage->write_buffer = buffer;
+	if (priv_storage->double_buffered)
+		priv_storage->buffer_index ^= 1U;
+	return efm32_flash_start_stub(t, priv_storage, len);
+}
+
+static bool efm32_flash_write_wait(target_flash_s *f)
+{
+	target_s *t = f->t;
+	efm32_priv_s *priv_storage = (efm32_priv_s *)t->target_storage;
+	f->write_pending = false;
+
+	bool ret = cortexm_wait_stub(t, 5000U) == 0;
+	/* If WriteFast didn't work out, fall back to writing word by word for this page and all the ones after it */
+	if (!ret && priv_storage->write_fast) {
+		DEBUG_WARN("EFM32: WriteFast failed, falling back to single word writes\n");
+		priv_storage->write_fast = false;
+		ret = efm32_flash_start_stub(t, priv_storage, f->writesize) && cortexm_wait_stub(t, 5000U) == 0;
+	}
 
 #if ENABLE_DEBUG == 1
 	/* Check the MSC_IF */
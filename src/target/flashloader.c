@@ -0,0 +1,269 @@
+/*
+ * This file is part of the Black Magic Debug project.
+ *
+ * Copyright (C) 2026 1BitSquared <info@1bitsquared.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * This file implements a generic RAM-resident Flash loader for Cortex-M targets with a simple
+ * memory-mapped Flash controller - that is, ones where programming consists of writing the data
+ * directly to the Flash address and waiting on a busy bit in a status register.
+ *
+ * Rather than the probe issuing a write and then polling the status register over the debug
+ * interface for every single programming unit, the whole block is downloaded into target RAM
+ * along with a small stub which then performs all the writes and status polling on-target.
+ * This reduces the debug interface traffic for a block to one bulk memory write and a stub run.
+ *
+ * The RAM layout used is: the stub, the controller description and then the data buffer, all
+ * placed at the start of the first RAM region of the target.
+ *
+ * The resident variant goes one step further for drivers that write many blocks in a row: its stub is
+ * started once and left running, taking each block as a command through a mailbox in RAM which the probe
+ * polls over the debug interface without halting the core. This saves the register setup, resume and halt
+ * of a stub run per block, and with two data buffers the probe loads the next block while the stub is
+ * still programming the previous one. Its layout is: the stub, the controller description, the mailbox
+ * and then the two data buffers.
+ *
+ * The resident loader's blocks are also run-length encoded on their way to the target, as images tend
+ * to have long runs of padding and constant tables in them. A block is a series of tokens: a header word
+ * holding a word count and a repeat flag, followed by either that many words of data, or the one word the
+ * stub is to program that many times. It's decoded by the stub as it programs, and can only ever be one
+ * header word bigger than the data it encodes.
+ */
+
+#include "general.h"
+#include "target.h"
+#include "target_internal.h"
+#include "cortexm.h"
+#include "buffer_utils.h"
+#include "flashloader.h"
+
+static const uint16_t flashloader_write_stub[] = {
+#include "flashstub/flashloader.stub"
+};
+
+static const uint16_t flashloader_server_stub[] = {
+#include "flashstub/flashloader_server.stub"
+};
+
+#define FLASHLOADER_PARAMS_OFFSET ALIGN(sizeof(flashloader_write_stub), 4U)
+#define FLASHLOADER_BUFFER_OFFSET (FLASHLOADER_PARAMS_OFFSET + sizeof(flashloader_params_s))
+
+/*
+ * The command mailbox of the resident loader, shared with the stub in flashstub/flashloader_server.c.
+ * The probe fills in a block then bumps doorbell, and the stub sets done to match once it's programmed.
+ */
+typedef struct flashloader_mailbox {
+	uint32_t doorbell;
+	uint32_t done;
+	uint32_t status; /* 0 if the last block done programmed successfully */
+	uint32_t dest;
+	uint32_t src;
+	uint32_t size; /* 0 to have the stub exit */
+} flashloader_mailbox_s;
+
+#define FLASHLOADER_SERVER_PARAMS_OFFSET  ALIGN(sizeof(flashloader_server_stub), 4U)
+#define FLASHLOADER_SERVER_MAILBOX_OFFSET (FLASHLOADER_SERVER_PARAMS_OFFSET + sizeof(flashloader_params_s))
+#define FLASHLOADER_SERVER_BUFFER_OFFSET  (FLASHLOADER_SERVER_MAILBOX_OFFSET + sizeof(flashloader_mailbox_s))
+/* The target address of one of the fields of the resident loader's mailbox */
+#define FLASHLOADER_SERVER_MAILBOX(target, field) \
+	((target)->ram->start + FLASHLOADER_SERVER_MAILBOX_OFFSET + offsetof(flashloader_mailbox_s, field))
+/* Encoded block tokens, see above */
+#define FLASHLOADER_TOKEN_REPEAT 1U
+#define FLASHLOADER_TOKEN_SIZE   4U
+/* The shortest run of a word worth a repeat token, rather than leaving it in a literal one */
+#define FLASHLOADER_REPEAT_MIN 3U
+/* How long a single block may take to program, which matches what cortexm_run_stub() allows a stub run */
+#define FLASHLOADER_SERVER_TIMEOUT 5000U
+
+/* The state of the resident loader, which runs on at most one target at a time */
+typedef struct flashloader_server {
+	target_s *target;            /* The target the loader is running on, NULL if it's not running */
+	flashloader_params_s params; /* The Flash controller it was started for */
+	size_t block_size;           /* The largest block its two data buffers can take */
+	uint32_t sequence;           /* Sequence number of the last block handed over */
+	uint8_t buffer;              /* Which buffer the next block is loaded into */
+	bool pending;                /* Whether the last block handed over is yet to be collected */
+} flashloader_server_s;
+
+static flashloader_server_s flashloader_server;
+
+bool flashloader_usable(const target_s *const target, const size_t len)
+{
+	const target_ram_s *const ram = target->ram;
+	return ram && ram->length >= FLASHLOADER_BUFFER_OFFSET + len;
+}
+
+bool flashloader_write(target_s *const target, const flashloader_params_s *const params, const target_addr_t dest,
+	const void *const src, const size_t len)
+{
+	const target_addr32_t stub_base = target->ram->start;
+	const target_addr32_t params_base = stub_base + FLASHLOADER_PARAMS_OFFSET;
+	const target_addr32_t buffer_base = stub_base + FLASHLOADER_BUFFER_OFFSET;
+
+	target_mem32_write(target, stub_base, flashloader_write_stub, sizeof(flashloader_write_stub));
+	target_mem32_write(target, params_base, params, sizeof(*params));
+	target_mem32_write(target, buffer_base, src, len);
+	if (target_check_error(target))
+		return false;
+
+	return cortexm_run_stub(target, stub_base, dest, buffer_base, len, params_base) == 0;
+}
+
+bool flashloader_server_usable(const target_s *const target, const size_t len)
+{
+	const target_ram_s *const ram = target->ram;
+	/* The stub programs whole words, with the encoding only ever costing it one extra header word */
+	const size_t buffer_size = len + FLASHLOADER_TOKEN_SIZE;
+	return ram && len && !(len & 3U) && ram->length >= FLASHLOADER_SERVER_BUFFER_OFFSET + (2U * buffer_size);
+}
+
+static bool flashloader_server_start(
+	target_s *const target, const flashloader_params_s *const params, const size_t block_size)
+{
+	const target_addr32_t stub_base = target->ram->start;
+	const flashloader_mailbox_s mailbox = {0};
+	target_mem32_write(target, stub_base, flashloader_server_stub, sizeof(flashloader_server_stub));
+	target_mem32_write(target, stub_base + FLASHLOADER_SERVER_PARAMS_OFFSET, params, sizeof(*params));
+	target_mem32_write(target, FLASHLOADER_SERVER_MAILBOX(target, doorbell), &mailbox, sizeof(mailbox));
+	if (target_check_error(target) ||
+		!cortexm_start_stub(target, stub_base, stub_base + FLASHLOADER_SERVER_PARAMS_OFFSET,
+			FLASHLOADER_SERVER_MAILBOX(target, doorbell), 0U, 0U))
+		return false;
+
+	flashloader_server = (flashloader_server_s){
+		.target = target,
+		.params = *params,
+		.block_size = block_size,
+	};
+	return true;
+}
+
+/* Write a token of the run of words from start up to end of the block out to the buffer, if there are any */
+static size_t flashloader_server_literal(target_s *const target, const target_addr32_t buffer,
+	const uint8_t *const src, const size_t start, const size_t end)
+{
+	if (start == end)
+		return 0U;
+	uint8_t header[FLASHLOADER_TOKEN_SIZE];
+	write_le4(header, 0U, (uint32_t)(end - start) << 1U);
+	target_mem32_write(target, buffer, header, sizeof(header));
+	target_mem32_write(target, buffer + FLASHLOADER_TOKEN_SIZE, src + (start * 4U), (end - start) * 4U);
+	return FLASHLOADER_TOKEN_SIZE + ((end - start) * 4U);
+}
+
+/* Encode a block straight into one of the resident loader's buffers, returning how big it came out */
+static size_t flashloader_server_encode(
+	target_s *const target, const target_addr32_t buffer, const uint8_t *const src, const size_t len)
+{
+	const size_t words = len / 4U;
+	size_t encoded = 0U;
+	size_t literal = 0U;
+	for (size_t idx = 0U; idx < words;) {
+		const uint32_t value = read_le4(src, idx * 4U);
+		size_t run = 1U;
+		while (idx + run < words && read_le4(src, (idx + run) * 4U) == value)
+			++run;
+		if (run >= FLASHLOADER_REPEAT_MIN) {
+			encoded += flashloader_server_literal(target, buffer + encoded, src, literal, idx);
+			uint8_t token[FLASHLOADER_TOKEN_SIZE + 4U];
+			write_le4(token, 0U, ((uint32_t)run << 1U) | FLASHLOADER_TOKEN_REPEAT);
+			memcpy(token + FLASHLOADER_TOKEN_SIZE, src + (idx * 4U), 4U);
+			target_mem32_write(target, buffer + encoded, token, sizeof(token));
+			encoded += sizeof(token);
+			literal = idx + run;
+		}
+		idx += run;
+	}
+	return encoded + flashloader_server_literal(target, buffer + encoded, src, literal, words);
+}
+
+bool flashloader_server_busy(const target_s *const target)
+{
+	return flashloader_server.target == target && flashloader_server.pending;
+}
+
+bool flashloader_server_wait(target_s *const target)
+{
+	if (flashloader_server.target != target || !flashloader_server.pending)
+		return true;
+	flashloader_server.pending = false;
+
+	platform_timeout_s timeout;
+	platform_timeout_set(&timeout, FLASHLOADER_SERVER_TIMEOUT);
+	while (true) {
+		/* The stub is changing the mailbox under us, so it must never be served from the read cache */
+		target_mem_cache_flush(target);
+		const uint32_t done = target_mem32_read32(target, FLASHLOADER_SERVER_MAILBOX(target, done));
+		if (target_check_error(target))
+			return false;
+		if (done == flashloader_server.sequence)
+			break;
+		if (platform_timeout_is_expired(&timeout)) {
+			DEBUG_WARN("Resident flash loader hung\n");
+			target_halt_request(target);
+			flashloader_server.target = NULL;
+			return false;
+		}
+	}
+	target_mem_cache_flush(target);
+	const uint32_t result = target_mem32_read32(target, FLASHLOADER_SERVER_MAILBOX(target, status));
+	return result == 0U && !target_check_error(target);
+}
+
+bool flashloader_server_write(target_s *const target, const flashloader_params_s *const params,
+	const target_addr_t dest, const void *const src, const size_t len)
+{
+	/* A loader that was started for another target, Flash controller or smaller blocks has to be restarted */
+	if (flashloader_server.target &&
+		(flashloader_server.target != target || len > flashloader_server.block_size ||
+			memcmp(&flashloader_server.params, params, sizeof(*params)) != 0) &&
+		!flashloader_server_stop(flashloader_server.target))
+		return false;
+	if (!flashloader_server.target && !flashloader_server_start(target, params, len))
+		return false;
+
+	/* Load the block into the free buffer while the stub may still be programming the last one */
+	const target_addr32_t buffer_base = target->ram->start + FLASHLOADER_SERVER_BUFFER_OFFSET +
+		(flashloader_server.buffer * (flashloader_server.block_size + FLASHLOADER_TOKEN_SIZE));
+	const size_t encoded = flashloader_server_encode(target, buffer_base, src, len);
+	DEBUG_TARGET("%s: %zu bytes encoded to %zu\n", __func__, len, encoded);
+	if (target_check_error(target) || !flashloader_server_wait(target))
+		return false;
+
+	/* Then hand it over, ringing the doorbell only once the rest of the command is in place */
+	const uint32_t command[3] = {dest, buffer_base, (uint32_t)encoded};
+	target_mem32_write(target, FLASHLOADER_SERVER_MAILBOX(target, dest), command, sizeof(command));
+	target_mem32_write32(target, FLASHLOADER_SERVER_MAILBOX(target, doorbell), ++flashloader_server.sequence);
+	flashloader_server.buffer ^= 1U;
+	flashloader_server.pending = true;
+	return !target_check_error(target);
+}
+
+bool flashloader_server_stop(target_s *const target)
+{
+	if (flashloader_server.target != target)
+		return true;
+	bool result = flashloader_server_wait(target);
+	/* The wait may have found the stub hung and halted it already */
+	if (flashloader_server.target) {
+		target_mem32_write32(target, FLASHLOADER_SERVER_MAILBOX(target, size), 0U);
+		target_mem32_write32(target, FLASHLOADER_SERVER_MAILBOX(target, doorbell), ++flashloader_server.sequence);
+		result &= cortexm_wait_stub(target, FLASHLOADER_SERVER_TIMEOUT) == 0;
+	}
+	flashloader_server.target = NULL;
+	return result;
+}
@@ -0,0 +1,73 @@
+/*
+ * This file is part of the Black Magic Debug project.
+ *
+ * Copyright (C) 2026 1BitSquared <info@1bitsquared.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef TARGET_FLASHLOADER_H
+#define TARGET_FLASHLOADER_H
+
+// IWYU pragma: begin_keep
+#include "general.h"
+#include "target_internal.h"
+// IWYU pragma: end_keep
+
+/*
+ * Description of a memory-mapped Flash controller for the generic RAM-resident loader.
+ * The loader copies the data into Flash one access_width sized unit at a time, then waits for
+ * (status_reg & busy_mask) to clear and fails if any bits in error_mask are then set.
+ * For controllers that program a burst of units in one go (such as a page buffer), burst_mask is
+ * one less than the burst size in bytes and the loader only waits at the end of each burst. It is
+ * only supported by flashloader_write(), and must be 0 for the resident loader.
+ * The layout of this structure is shared with the stubs in flashstub/flashloader.c and
+ * flashstub/flashloader_server.c.
+ */
+typedef struct flashloader_params {
+	uint32_t status_reg;
+	uint32_t busy_mask;
+	uint32_t error_mask;
+	uint32_t access_width; /* Either 2 or 4 */
+	uint32_t burst_mask;   /* 0 to wait after every unit */
+} flashloader_params_s;
+
+/* Returns true if the target has enough RAM to run the loader over a block of len bytes */
+bool flashloader_usable(const target_s *target, size_t len);
+/*
+ * Program len bytes from src to dest using the loader. The Flash controller must already
+ * be unlocked and placed in programming mode by the caller.
+ */
+bool flashloader_write(target_s *target, const flashloader_params_s *params, target_addr_t dest, const void *src,
+	size_t len);
+
+/* Returns true if the target has enough RAM to run the resident loader over blocks of len bytes */
+bool flashloader_server_usable(const target_s *target, size_t len);
+/*
+ * Program len bytes from src to dest using the resident loader, starting it if it's not already running
+ * for this Flash controller. This returns as soon as the block has been handed over, having first waited
+ * for the previous one, so the next block's data goes onto the target while this one is programmed.
+ * The Flash controller must already be unlocked and placed in programming mode by the caller, and the
+ * core is left running the loader until flashloader_server_stop() is called.
+ */
+bool flashloader_server_write(target_s *target, const flashloader_params_s *params, target_addr_t dest,
+	const void *src, size_t len);
+/* Returns true if the resident loader may still be programming the last block handed to it */
+bool flashloader_server_busy(const target_s *target);
+/* Wait for the last block handed to the resident loader to be programmed, returning false if that failed */
+bool flashloader_server_wait(target_s *target);
+/* Wait for the resident loader to finish its last block then stop it, leaving the core halted in it */
+bool flashloader_server_stop(target_s *target);
+
+#endif /* TARGET_FLASHLOADER_H */
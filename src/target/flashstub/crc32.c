@@ -0,0 +1,44 @@
+/*
+ * This file is part of the Black Magic Debug project.
+ *
+ * Copyright (C) 2026 1BitSquared <info@1bitsquared.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <stdint.h>
+#include "stub.h"
+
+#define CRC32_POLY 0x04c11db7U
+
+/*
+ * Compute the same CRC32 as GDB's qCRC (and so bmd_crc32()) over a region of target memory.
+ * The running CRC is read from and written back to *crc so large regions can be done in pieces.
+ * This stub must remain position independent as it is loaded at the start of target RAM.
+ */
+void __attribute__((naked)) crc32_stub(const uint8_t *data, const uint32_t len, uint32_t *const crc)
+{
+	uint32_t value = *crc;
+	for (const uint8_t *const end = data + len; data < end; ++data) {
+		value ^= (uint32_t)*data << 24U;
+		for (uint32_t bit = 8U; bit; --bit) {
+			if (value & 0x80000000U)
+				value = (value << 1U) ^ CRC32_POLY;
+			else
+				value <<= 1U;
+		}
+	}
+	*crc = value;
+
+	stub_exit(0);
+}
@@ -42,28 +42,57 @@
 #define EFM32_MSC_STATUS_WDATAREADY  (1U << 3U)
 #define EFM32_MSC_STATUS_WORDTIMEOUT (1U << 4U)
 
+/* Set in the MSC address passed to the stub to program the buffer with WRITETRIG/WRITEEND rather than word by word */
+#define EFM32_STUB_WRITE_FAST 1U
+
 void __attribute__((naked))
-efm32_flash_write_stub(const uint32_t *const dest, const uint32_t *const src, uint32_t size, const uint32_t msc_addr)
+efm32_flash_write_stub(const uint32_t *const dest, const uint32_t *const src, uint32_t size, const uint32_t msc_mode)
 {
-	const uintptr_t msc = msc_addr;
+	const uintptr_t msc = msc_mode & ~EFM32_STUB_WRITE_FAST;
 	EFM32_MSC_LOCK(msc) = EFM32_MSC_LOCK_LOCKKEY;
 	EFM32_MSC_WRITECTRL(msc) = 1;
 
-	for (uint32_t i = 0; i < size / 4U; i++) {
-		EFM32_MSC_ADDRB(msc) = (uintptr_t)(dest + i);
-		EFM32_MSC_WRITECMD(msc) = EFM32_MSC_WRITECMD_LADDRIM;
+	if (!(msc_mode & EFM32_STUB_WRITE_FAST)) {
+		for (uint32_t i = 0; i < size / 4U; i++) {
+			EFM32_MSC_ADDRB(msc) = (uintptr_t)(dest + i);
+			EFM32_MSC_WRITECMD(msc) = EFM32_MSC_WRITECMD_LADDRIM;
 
-		/* Wait for WDATAREADY */
-		while (!(EFM32_MSC_STATUS(msc) & EFM32_MSC_STATUS_WDATAREADY))
-			continue;
+			/* Wait for WDATAREADY */
+			while (!(EFM32_MSC_STATUS(msc) & EFM32_MSC_STATUS_WDATAREADY))
+				continue;
 
-		EFM32_MSC_WDATA(msc) = src[i];
-		EFM32_MSC_WRITECMD(msc) = EFM32_MSC_WRITECMD_WRITEONCE;
+			EFM32_MSC_WDATA(msc) = src[i];
+			EFM32_MSC_WRITECMD(msc) = EFM32_MSC_WRITECMD_WRITEONCE;
 
-		/* Wait for BUSY */
-		while ((EFM32_MSC_STATUS(msc) & EFM32_MSC_STATUS_BUSY))
+			/* Wait for BUSY */
+			while ((EFM32_MSC_STATUS(msc) & EFM32_MSC_STATUS_BUSY))
+				continue;
+		}
+		stub_exit(0);
+	}
+
+	/*
+	 * WriteFast: load the address once and let it auto-increment, triggering the first word and then
+	 * feeding each next one in as soon as the MSC is ready for it, so the words program back to back
+	 */
+	EFM32_MSC_ADDRB(msc) = (uintptr_t)dest;
+	EFM32_MSC_WRITECMD(msc) = EFM32_MSC_WRITECMD_LADDRIM;
+	for (uint32_t i = 0; i < size / 4U; i++) {
+		while (!(EFM32_MSC_STATUS(msc) & EFM32_MSC_STATUS_WDATAREADY))
 			continue;
+		EFM32_MSC_WDATA(msc) = src[i];
+		if (i == 0)
+			EFM32_MSC_WRITECMD(msc) = EFM32_MSC_WRITECMD_WRITETRIG;
 	}
+	while (!(EFM32_MSC_STATUS(msc) & EFM32_MSC_STATUS_WDATAREADY))
+		continue;
+	EFM32_MSC_WRITECMD(msc) = EFM32_MSC_WRITECMD_WRITEEND;
 
+	uint32_t status;
+	while ((status = EFM32_MSC_STATUS(msc)) & EFM32_MSC_STATUS_BUSY)
+		continue;
+	/* Parts without WriteFast, or where the buffer couldn't keep up, flag it here rather than hanging */
+	if (status & (EFM32_MSC_STATUS_LOCKED | EFM32_MSC_STATUS_INVADDR | EFM32_MSC_STATUS_WORDTIMEOUT))
+		stub_exit(1);
 	stub_exit(0);
 }
@@ -0,0 +1,32 @@
+/*
+ * This file is part of the Black Magic Debug project.
+ *
+ * Copyright (C) 2026 1BitSquared <info@1bitsquared.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <stdint.h>
+#include "stub.h"
+
+/*
+ * Fill a word aligned region of target memory with a repeated 32-bit value, len being a multiple of 4.
+ * This stub must remain position independent as it is loaded into target RAM.
+ */
+void __attribute__((naked)) fill_stub(uint32_t *dest, const uint32_t len, const uint32_t value)
+{
+	for (const uint32_t *const end = (const uint32_t *)((uintptr_t)dest + len); dest < end; ++dest)
+		*dest = value;
+
+	stub_exit(0);
+}
@@ -0,0 +1,59 @@
+/*
+ * This file is part of the Black Magic Debug project.
+ *
+ * Copyright (C) 2026 1BitSquared <info@1bitsquared.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <stdint.h>
+#include "stub.h"
+
+/*
+ * Generic Flash write stub used by the RAM-resident Flash loader (see ../flashloader.c).
+ * The layout of this structure must match flashloader_params_s in ../flashloader.h.
+ * This stub must remain position independent as it is loaded at the start of whatever
+ * the first RAM region of the target happens to be.
+ */
+typedef struct flashloader_params {
+	uint32_t status_reg;
+	uint32_t busy_mask;
+	uint32_t error_mask;
+	uint32_t access_width;
+	uint32_t burst_mask;
+} flashloader_params_s;
+
+void __attribute__((naked)) flashloader_write_stub(
+	const uintptr_t dest, const uintptr_t src, const uint32_t size, const flashloader_params_s *const params)
+{
+	volatile uint32_t *const status_reg = (volatile uint32_t *)params->status_reg;
+
+	for (uint32_t offset = 0; offset < size;) {
+		if (params->access_width == 4U)
+			*(volatile uint32_t *)(dest + offset) = *(const uint32_t *)(src + offset);
+		else
+			*(volatile uint16_t *)(dest + offset) = *(const uint16_t *)(src + offset);
+		offset += params->access_width;
+
+		/* Keep going without waiting until the end of a burst, or of the data */
+		if ((offset & params->burst_mask) && offset < size)
+			continue;
+		uint32_t status = *status_reg;
+		while (status & params->busy_mask)
+			status = *status_reg;
+		if (status & params->error_mask)
+			stub_exit(1);
+	}
+
+	stub_exit(0);
+}
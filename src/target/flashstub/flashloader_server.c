@@ -0,0 +1,115 @@
+/*
+ * This file is part of the Black Magic Debug project.
+ *
+ * Copyright (C) 2026 1BitSquared <info@1bitsquared.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <stdint.h>
+#include <stdbool.h>
+#include "stub.h"
+
+/*
+ * Resident variant of the generic Flash write stub (see ../flashloader.c). Rather than programming one block
+ * and exiting, this stays running and takes each block as a command through a mailbox in RAM: the debugger
+ * fills in the block's details then rings the doorbell by bumping its sequence number, and the stub copies
+ * that number to done once it has programmed the block. A block of size 0 tells the stub to exit.
+ *
+ * Each block is sent run-length encoded as a series of tokens, each a header word holding a word count and
+ * a repeat flag in bit 0, followed either by that many words of data or, for a repeat, the one word to
+ * program that many times. The stub decodes it on the fly as it programs, so needs no buffer of its own.
+ *
+ * The layouts of these structures must match the ones in ../flashloader.h and ../flashloader.c.
+ * This stub must remain position independent as it is loaded at the start of whatever
+ * the first RAM region of the target happens to be.
+ */
+typedef struct flashloader_params {
+	uint32_t status_reg;
+	uint32_t busy_mask;
+	uint32_t error_mask;
+	uint32_t access_width;
+	uint32_t burst_mask; /* Not supported by the resident loader */
+} flashloader_params_s;
+
+typedef struct flashloader_mailbox {
+	uint32_t doorbell;
+	uint32_t done;
+	uint32_t status;
+	uintptr_t dest;
+	uintptr_t src;
+	uint32_t size;
+} flashloader_mailbox_s;
+
+#define FLASHLOADER_TOKEN_REPEAT 1U
+
+static inline bool __attribute__((always_inline)) flashloader_server_poll(
+	const flashloader_params_s *const params, volatile uint32_t *const status_reg)
+{
+	uint32_t status = *status_reg;
+	while (status & params->busy_mask)
+		status = *status_reg;
+	return !(status & params->error_mask);
+}
+
+static inline bool __attribute__((always_inline)) flashloader_server_program(
+	const flashloader_params_s *const params, volatile uint32_t *const status_reg, const uintptr_t dest,
+	const uint32_t value)
+{
+	if (params->access_width == 4U) {
+		*(volatile uint32_t *)dest = value;
+		return flashloader_server_poll(params, status_reg);
+	}
+	*(volatile uint16_t *)dest = value & 0xffffU;
+	if (!flashloader_server_poll(params, status_reg))
+		return false;
+	*(volatile uint16_t *)(dest + 2U) = value >> 16U;
+	return flashloader_server_poll(params, status_reg);
+}
+
+void __attribute__((naked)) flashloader_server_stub(
+	const flashloader_params_s *const params, volatile flashloader_mailbox_s *const mailbox)
+{
+	volatile uint32_t *const status_reg = (volatile uint32_t *)params->status_reg;
+	uint32_t done = 0;
+
+	while (true) {
+		while (mailbox->doorbell == done)
+			continue;
+		done = mailbox->doorbell;
+		uintptr_t dest = mailbox->dest;
+		const uint32_t *src = (const uint32_t *)mailbox->src;
+		const uint32_t *const end = (const uint32_t *)(mailbox->src + mailbox->size);
+		if (src == end)
+			stub_exit(0);
+
+		mailbox->status = 0;
+		while (src < end) {
+			const uint32_t header = *src++;
+			const bool repeat = header & FLASHLOADER_TOKEN_REPEAT;
+			bool ok = true;
+			for (uint32_t count = header >> 1U; ok && count; --count, dest += 4U) {
+				ok = flashloader_server_program(params, status_reg, dest, *src);
+				if (!repeat)
+					++src;
+			}
+			if (!ok) {
+				mailbox->status = 1;
+				break;
+			}
+			if (repeat)
+				++src;
+		}
+		mailbox->done = done;
+	}
+}
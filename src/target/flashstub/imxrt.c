@@ -0,0 +1,113 @@
+/*
+ * This file is part of the Black Magic Debug project.
+ *
+ * Copyright (C) 2026 1BitSquared <info@1bitsquared.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <stdint.h>
+#include "stub.h"
+
+/* FlexSPI1 register offsets and bits, see ../imxrt.c */
+#define FLEXSPI_INT                   0x014U
+#define FLEXSPI_PRG_CTRL0             0x0a0U
+#define FLEXSPI_PRG_CTRL1             0x0a4U
+#define FLEXSPI_PRG_CMD               0x0b0U
+#define FLEXSPI_PRG_WRITE_FIFO_STATUS 0x0f4U
+#define FLEXSPI_PRG_READ_FIFO         0x100U
+#define FLEXSPI_PRG_WRITE_FIFO        0x180U
+
+#define FLEXSPI_INT_PRG_CMD_DONE           0x00000001U
+#define FLEXSPI_INT_CMD_ERR                0x00000008U
+#define FLEXSPI_INT_READ_FIFO_FULL         0x00000020U
+#define FLEXSPI_INT_WRITE_FIFO_EMPTY       0x00000040U
+#define FLEXSPI_PRG_RUN                    0x00000001U
+#define FLEXSPI_PRG_WRITE_FIFO_STATUS_FILL 0x000000ffU
+#define FLEXSPI_WRITE_FIFO_SIZE            128U
+
+#define SPI_FLASH_STATUS_BUSY 0x01U
+
+#define FLEXSPI_REG(base, reg) (*(volatile uint32_t *)((base) + (reg)))
+
+/*
+ * SPI Flash page programming stub for the i.MX RT FlexSPI controller (see ../imxrt.c).
+ * The layout of this structure must match imxrt_flexspi_stub_params_s in ../imxrt.c.
+ * The sequence values are complete PRG_CTRL1 values for LUT sequences the driver has
+ * already written, except for the page program one which has the page length added here.
+ * This stub must remain position independent as it is loaded at the start of target RAM.
+ */
+typedef struct imxrt_flexspi_stub_params {
+	uint32_t flexspi_base;
+	uint32_t page_size;
+	uint32_t write_enable_seq;
+	uint32_t page_program_seq;
+	uint32_t read_status_seq;
+} imxrt_flexspi_stub_params_s;
+
+static inline void __attribute__((always_inline)) flexspi_run(const uintptr_t base, const uint32_t seq)
+{
+	FLEXSPI_REG(base, FLEXSPI_PRG_CTRL1) = seq;
+	FLEXSPI_REG(base, FLEXSPI_PRG_CMD) = FLEXSPI_PRG_RUN;
+}
+
+static inline void __attribute__((always_inline)) flexspi_wait_complete(const uintptr_t base)
+{
+	while (!(FLEXSPI_REG(base, FLEXSPI_INT) & FLEXSPI_INT_PRG_CMD_DONE))
+		continue;
+	FLEXSPI_REG(base, FLEXSPI_INT) = FLEXSPI_INT_PRG_CMD_DONE;
+	if (FLEXSPI_REG(base, FLEXSPI_INT) & FLEXSPI_INT_CMD_ERR) {
+		FLEXSPI_REG(base, FLEXSPI_INT) = FLEXSPI_INT_CMD_ERR;
+		stub_exit(1);
+	}
+}
+
+void __attribute__((naked)) imxrt_flexspi_write_stub(
+	uint32_t dest, const uint32_t *src, uint32_t size, const imxrt_flexspi_stub_params_s *const params)
+{
+	const uintptr_t base = params->flexspi_base;
+
+	while (size) {
+		const uint32_t amount = size < params->page_size ? size : params->page_size;
+
+		flexspi_run(base, params->write_enable_seq);
+		flexspi_wait_complete(base);
+
+		/* Start the page program, then feed the data through the write FIFO a FIFO load at a time */
+		FLEXSPI_REG(base, FLEXSPI_PRG_CTRL0) = dest;
+		flexspi_run(base, params->page_program_seq | amount);
+		for (uint32_t offset = 0U; offset < amount;) {
+			while (FLEXSPI_REG(base, FLEXSPI_PRG_WRITE_FIFO_STATUS) & FLEXSPI_PRG_WRITE_FIFO_STATUS_FILL)
+				continue;
+			volatile uint32_t *fifo = &FLEXSPI_REG(base, FLEXSPI_PRG_WRITE_FIFO);
+			for (uint32_t idx = 0U; idx < FLEXSPI_WRITE_FIFO_SIZE && offset < amount; idx += 4U, offset += 4U)
+				*fifo++ = *src++;
+			FLEXSPI_REG(base, FLEXSPI_INT) = FLEXSPI_INT_WRITE_FIFO_EMPTY;
+		}
+		flexspi_wait_complete(base);
+
+		/* Poll the Flash status register till the page is written */
+		uint32_t status;
+		do {
+			flexspi_run(base, params->read_status_seq);
+			flexspi_wait_complete(base);
+			status = FLEXSPI_REG(base, FLEXSPI_PRG_READ_FIFO);
+			FLEXSPI_REG(base, FLEXSPI_INT) = FLEXSPI_INT_READ_FIFO_FULL;
+		} while (status & SPI_FLASH_STATUS_BUSY);
+
+		dest += amount;
+		size -= amount;
+	}
+
+	stub_exit(0);
+}
@@ -0,0 +1,112 @@
+/*
+ * This file is part of the Black Magic Debug project.
+ *
+ * Copyright (C) 2026 1BitSquared <info@1bitsquared.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <stdint.h>
+#include <stdbool.h>
+#include "stub.h"
+
+/* SPIFI controller registers and bits, see ../lpc43xx.c */
+#define SPIFI_BASE 0x40003000U
+#define SPIFI_CMD  0x004U
+#define SPIFI_ADDR 0x008U
+#define SPIFI_DATA 0x014U
+#define SPIFI_STAT 0x01cU
+
+#define SPIFI_STATUS_CMD_ACTIVE (1U << 1U)
+#define SPIFI_STATUS_INTRQ      (1U << 5U)
+
+#define SPI_FLASH_STATUS_BUSY 0x01U
+
+#define SPIFI_REG32(reg) (*(volatile uint32_t *)(SPIFI_BASE + (reg)))
+#define SPIFI_REG8(reg)  (*(volatile uint8_t *)(SPIFI_BASE + (reg)))
+
+/*
+ * Resident SPI Flash page programming stub for the LPC43x0 SPIFI controller (see ../lpc43xx.c).
+ * The probe hands it the data a chunk of whole pages at a time through a mailbox in RAM: it fills in the
+ * chunk's details then rings the doorbell by bumping its sequence number, and the stub copies that number
+ * to done once it has programmed the chunk. With two chunk buffers, the probe loads the next chunk while
+ * the stub programs the last one. A chunk of size 0 tells the stub to exit.
+ *
+ * The command values are complete CMD register values for the SPIFI controller built by the driver,
+ * except for the page program one which has the page length added here. The controller must already be
+ * out of memory mode. The layouts of these structures must match the ones in ../lpc43xx.c.
+ * This stub must remain position independent as it is loaded at the start of target RAM.
+ */
+typedef struct lpc43x0_spifi_stub_params {
+	uint32_t page_size;
+	uint32_t write_enable_cmd;
+	uint32_t page_program_cmd;
+	uint32_t read_status_cmd;
+} lpc43x0_spifi_stub_params_s;
+
+typedef struct lpc43x0_spifi_stub_mailbox {
+	uint32_t doorbell;
+	uint32_t done;
+	uintptr_t dest;
+	uintptr_t src;
+	uint32_t size;
+} lpc43x0_spifi_stub_mailbox_s;
+
+static inline void __attribute__((always_inline)) spifi_wait_complete(void)
+{
+	while (SPIFI_REG32(SPIFI_STAT) & SPIFI_STATUS_CMD_ACTIVE)
+		continue;
+	SPIFI_REG32(SPIFI_STAT) = SPIFI_STATUS_INTRQ;
+}
+
+void __attribute__((naked)) lpc43x0_spifi_write_stub(
+	const lpc43x0_spifi_stub_params_s *const params, volatile lpc43x0_spifi_stub_mailbox_s *const mailbox)
+{
+	uint32_t done = 0;
+
+	while (true) {
+		while (mailbox->doorbell == done)
+			continue;
+		done = mailbox->doorbell;
+		uintptr_t dest = mailbox->dest;
+		const uint32_t *src = (const uint32_t *)mailbox->src;
+		uint32_t size = mailbox->size;
+		if (!size)
+			stub_exit(0);
+
+		while (size) {
+			uint32_t amount = size < params->page_size ? size : params->page_size;
+
+			SPIFI_REG32(SPIFI_CMD) = params->write_enable_cmd;
+			spifi_wait_complete();
+
+			/* Start the page program, then feed the data through the data FIFO a word at a time */
+			SPIFI_REG32(SPIFI_ADDR) = dest;
+			SPIFI_REG32(SPIFI_CMD) = params->page_program_cmd | amount;
+			dest += amount;
+			size -= amount;
+			for (; amount; amount -= 4U)
+				SPIFI_REG32(SPIFI_DATA) = *src++;
+			spifi_wait_complete();
+
+			/* Poll the Flash status register till the page is written */
+			uint8_t status;
+			do {
+				SPIFI_REG32(SPIFI_CMD) = params->read_status_cmd;
+				status = SPIFI_REG8(SPIFI_DATA);
+				spifi_wait_complete();
+			} while (status & SPI_FLASH_STATUS_BUSY);
+		}
+		mailbox->done = done;
+	}
+}
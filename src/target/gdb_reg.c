@@ -21,21 +21,13 @@
 
 #include "gdb_reg.h"
 
-const char *gdb_xml_preamble_first = "<?xml version=\"1.0\"?>"
-									 "<!DOCTYPE";
-
-const char *gdb_xml_preamble_second = "SYSTEM \"gdb-target.dtd\">"
-									  "<target>"
-									  "  <architecture>";
-const char *gdb_xml_preamble_third = "</architecture>";
-
 const char *gdb_reg_type_strings[] = {
-	"",                   // GDB_TYPE_UNSPECIFIED.
-	" type=\"data_ptr\"", // GDB_TYPE_DATA_PTR.
-	" type=\"code_ptr\"", // GDB_TYPE_CODE_PTR.
+	"",                    // GDB_TYPE_UNSPECIFIED.
+	GDB_XML_TYPE_DATA_PTR, // GDB_TYPE_DATA_PTR.
+	GDB_XML_TYPE_CODE_PTR, // GDB_TYPE_CODE_PTR.
 };
 
 const char *gdb_reg_save_restore_strings[] = {
-	"",                    // GDB_SAVE_RESTORE_UNSPECIFIED.
-	" save-restore=\"no\"" // GDB_SAVE_RESTORE_NO.
+	"",                     // GDB_SAVE_RESTORE_UNSPECIFIED.
+	GDB_XML_NO_SAVE_RESTORE // GDB_SAVE_RESTORE_NO.
 };
@@ -22,23 +22,24 @@
 #ifndef TARGET_GDB_REG_H
 #define TARGET_GDB_REG_H
 
-// The beginning XML for GDB target descriptions that are common to all targets,
-// save for one word: the word after DOCTYPE, which is "target" for Cortex-M, and "feature"
-// for Cortex-A. The "preamble" is thus split into three parts, with this single word missing
-// and as the split point.
-extern const char *gdb_xml_preamble_first;
-
-// The beginning XML for GDB target descriptions that are common to all targets,
-// save for one word: the word after DOCTYPE, which is "target" for Cortex-M, and "feature"
-// for Cortex-A. The "preamble" is thus split into three parts, with this single word missing
-// and as the split point.
-extern const char *gdb_xml_preamble_second;
-
-// The beginning XML for GDB target descriptions that are common to all targets,
-// save for one word: the word after <architecture>, which is "arm" for Cortex-*, and "avr"
-// for AVR. The "preamble" is thus split into three parts, with this single word missing
-// and as the split point.
-extern const char *gdb_xml_preamble_third;
+// The XML that starts every GDB target description, split either side of the architecture name. These are
+// literals so that the fixed parts of a description can be put together at compile time.
+#define GDB_XML_PREAMBLE_START                                           \
+	"<?xml version=\"1.0\"?><!DOCTYPE target SYSTEM \"gdb-target.dtd\">" \
+	"<target>  <architecture>"
+#define GDB_XML_PREAMBLE_END "</architecture>"
+#define GDB_XML_PREAMBLE(arch) GDB_XML_PREAMBLE_START arch GDB_XML_PREAMBLE_END
+
+// The optional fields of a register tag, as literals for GDB_XML_REG().
+#define GDB_XML_TYPE_DATA_PTR   " type=\"data_ptr\""
+#define GDB_XML_TYPE_CODE_PTR   " type=\"code_ptr\""
+#define GDB_XML_NO_SAVE_RESTORE " save-restore=\"no\""
+#define GDB_XML_REGNUM(regnum)  " regnum=\"" #regnum "\""
+
+// A whole register tag for a description, where fields is any of the above strung together (or "").
+#define GDB_XML_REG(name, bitsize, fields) "<reg name=\"" name "\" bitsize=\"" #bitsize "\"" fields "/>"
+#define GDB_XML_FEATURE(name)              "<feature name=\"" name "\">"
+#define GDB_XML_FEATURE_END                "</feature>"
 
 // The "type" field of a register tag.
 typedef enum gdb_reg_type {
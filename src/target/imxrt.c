@@ -179,6 +179,10 @@
 
 #define IMXRT_NAME_MAX_LENGTH 12
 
+/* The page programming stub, its parameters and then the page data all go at the start of target RAM */
+#define IMXRT_STUB_PARAMS_OFFSET ALIGN(sizeof(imxrt_flexspi_write_stub), 4U)
+#define IMXRT_STUB_BUFFER_OFFSET (IMXRT_STUB_PARAMS_OFFSET + sizeof(imxrt_flexspi_stub_params_s))
+
 typedef enum imxrt_boot_src {
 	BOOT_FLEX_SPI,
 	boot_sd_card,
@@ -204,14 +208,30 @@ typedef struct imxrt_priv {
 	char name[IMXRT_NAME_MAX_LENGTH];
 } imxrt_priv_s;
 
+/* This must match the structure of the same name in flashstub/imxrt.c */
+typedef struct imxrt_flexspi_stub_params {
+	uint32_t flexspi_base;
+	uint32_t page_size;
+	uint32_t write_enable_seq;
+	uint32_t page_program_seq;
+	uint32_t read_status_seq;
+} imxrt_flexspi_stub_params_s;
+
+static const uint16_t imxrt_flexspi_write_stub[] = {
+#include "flashstub/imxrt.stub"
+};
+
 static imxrt_boot_src_e imxrt_boot_source(uint32_t boot_cfg);
 static bool imxrt_enter_flash_mode(target_s *target);
 static bool imxrt_exit_flash_mode(target_s *target);
+static bool imxrt_flexspi_boot_is_quad(const imxrt_priv_s *priv);
 static uint8_t imxrt_spi_build_insn_sequence(target_s *target, uint16_t command, uint16_t length);
 static void imxrt_spi_read(target_s *target, uint16_t command, target_addr_t address, void *buffer, size_t length);
 static void imxrt_spi_write(
 	target_s *target, uint16_t command, target_addr_t address, const void *buffer, size_t length);
 static void imxrt_spi_run_command(target_s *target, uint16_t command, target_addr_t address);
+static bool imxrt_spi_write_pages(
+	target_s *target, const spi_flash_s *flash, target_addr32_t address, const void *buffer, size_t length);
 static bool imxrt_ident_device(target_s *target);
 
 bool imxrt_probe(target_s *const target)
@@ -288,8 +308,17 @@ bool imxrt_probe(target_s *const target)
 			const uint32_t capacity = 1U << flash_id.capacity;
 			DEBUG_INFO("SPI Flash: mfr = %02x, type = %02x, capacity = %08" PRIx32 "\n", flash_id.manufacturer,
 				flash_id.type, capacity);
-			bmp_spi_add_flash(
+			spi_flash_s *const flash = bmp_spi_add_flash(
 				target, IMXRT_FLEXSPI_BASE, capacity, imxrt_spi_read, imxrt_spi_write, imxrt_spi_run_command);
+			/*
+			 * If the boot ROM reads the Flash over 4 lanes, the board has them wired and we can program over them
+			 * too. The Quad Enable bit is then normally already set, so this doesn't usually write anything.
+			 */
+			if (flash && imxrt_flexspi_boot_is_quad(priv))
+				bmp_spi_enable_quad(target, flash);
+			/* If there's room in RAM for the stub and a whole write's worth of pages, program on-target */
+			if (flash && target->ram && target->ram->length >= IMXRT_STUB_BUFFER_OFFSET + flash->flash.writesize)
+				flash->write_pages = imxrt_spi_write_pages;
 		} else
 			DEBUG_INFO("Flash identification failed\n");
 
@@ -463,6 +492,18 @@ static bool imxrt_exit_flash_mode(target_s *const target)
 	return true;
 }
 
+/* Check the AHB read sequence the boot ROM left in LUT slot 0 (saved on entering Flash mode) for quad pad use */
+static bool imxrt_flexspi_boot_is_quad(const imxrt_priv_s *const priv)
+{
+	for (size_t idx = 0U; idx < 8U; ++idx) {
+		const imxrt_flexspi_lut_insn_s *const insn = &priv->flexspi_prg_seq_state[0][idx];
+		if ((insn->opcode_mode & 0x3U) == IMXRT_FLEXSPI_LUT_MODE_QUAD &&
+			(insn->opcode_mode >> 2U) != IMXRT_FLEXSPI_LUT_OP_STOP)
+			return true;
+	}
+	return false;
+}
+
 static uint8_t imxrt_spi_build_insn_sequence(target_s *const target, const uint16_t command, const uint16_t length)
 {
 	imxrt_priv_s *const priv = (imxrt_priv_s *)target->target_storage;
@@ -486,27 +527,26 @@ static uint8_t imxrt_spi_build_insn_sequence(target_s *const target, const uint1
 	sequence[0].opcode_mode = IMXRT_FLEXSPI_LUT_OPCODE(IMXRT_FLEXSPI_LUT_OP_COMMAND) | IMXRT_FLEXSPI_LUT_MODE_SERIAL;
 	sequence[0].value = command & SPI_FLASH_OPCODE_MASK;
 	uint8_t offset = 1;
+	/* The LUT pad modes count lanes the same way the command encodes them: 1, 2 or 4 as 0, 1 or 2 */
+	const uint8_t data_mode = (command & SPI_FLASH_LANES_MASK) >> SPI_FLASH_LANES_SHIFT;
+	const uint8_t address_mode = (command & SPI_FLASH_ADDR_WIDE) ? data_mode : IMXRT_FLEXSPI_LUT_MODE_SERIAL;
 	/* Then, if the command has an address, perform the necessary addressing */
 	if ((command & SPI_FLASH_OPCODE_MODE_MASK) == SPI_FLASH_OPCODE_3B_ADDR) {
-		sequence[offset].opcode_mode =
-			IMXRT_FLEXSPI_LUT_OPCODE(IMXRT_FLEXSPI_LUT_OP_RADDR) | IMXRT_FLEXSPI_LUT_MODE_SERIAL;
+		sequence[offset].opcode_mode = IMXRT_FLEXSPI_LUT_OPCODE(IMXRT_FLEXSPI_LUT_OP_RADDR) | address_mode;
 		sequence[offset++].value = 24U;
 	}
 	/* If the command uses dummy cycles, include the command for those */
 	if (command & SPI_FLASH_DUMMY_MASK) {
-		sequence[offset].opcode_mode =
-			IMXRT_FLEXSPI_LUT_OPCODE(IMXRT_FLEXSPI_LUT_OP_DUMMY_CYCLES) | IMXRT_FLEXSPI_LUT_MODE_SERIAL;
+		sequence[offset].opcode_mode = IMXRT_FLEXSPI_LUT_OPCODE(IMXRT_FLEXSPI_LUT_OP_DUMMY_CYCLES) | address_mode;
 		/* Convert bytes to bits in the process of building this */
 		sequence[offset++].value = ((command & SPI_FLASH_DUMMY_MASK) >> SPI_FLASH_DUMMY_SHIFT) * 8U;
 	}
 	/* Now run the data phase based on the operation's data direction */
 	if (length) {
 		if (command & SPI_FLASH_DATA_OUT)
-			sequence[offset].opcode_mode =
-				IMXRT_FLEXSPI_LUT_OPCODE(IMXRT_FLEXSPI_LUT_OP_WRITE) | IMXRT_FLEXSPI_LUT_MODE_SERIAL;
+			sequence[offset].opcode_mode = IMXRT_FLEXSPI_LUT_OPCODE(IMXRT_FLEXSPI_LUT_OP_WRITE) | data_mode;
 		else
-			sequence[offset].opcode_mode =
-				IMXRT_FLEXSPI_LUT_OPCODE(IMXRT_FLEXSPI_LUT_OP_READ) | IMXRT_FLEXSPI_LUT_MODE_SERIAL;
+			sequence[offset].opcode_mode = IMXRT_FLEXSPI_LUT_OPCODE(IMXRT_FLEXSPI_LUT_OP_READ) | data_mode;
 		sequence[offset++].value = 0;
 	}
 	/* Because sequence gets 0 initialised above when it's declared, the STOP entry is already present */
@@ -608,3 +648,40 @@ static void imxrt_spi_run_command(target_s *const target, const uint16_t command
 	/* Now wait for the FlexSPI controller to indicate the command completed we're done */
 	imxrt_spi_wait_complete(target);
 }
+
+/*
+ * Program whole pages using the page programming stub which runs the write enable, page program
+ * and status polling sequences on the FlexSPI controller from the target, rather than doing all the
+ * register accesses that takes for every page over the debug interface.
+ */
+static bool imxrt_spi_write_pages(target_s *const target, const spi_flash_s *const flash,
+	const target_addr32_t address, const void *const buffer, const size_t length)
+{
+	imxrt_priv_s *const priv = (imxrt_priv_s *)target->target_storage;
+	/*
+	 * Drop the sequence cache so the three sequences the stub uses are guaranteed to all land in their own
+	 * slots - the LUT is put back as it was on leaving Flash mode so this loses nothing.
+	 */
+	memset(priv->flexspi_cached_commands, 0, sizeof(priv->flexspi_cached_commands));
+	const uint8_t write_enable_slot = imxrt_spi_build_insn_sequence(target, SPI_FLASH_CMD_WRITE_ENABLE, 0U);
+	const uint8_t page_program_slot = imxrt_spi_build_insn_sequence(target, flash->page_program_command, 1U);
+	const uint8_t read_status_slot = imxrt_spi_build_insn_sequence(target, SPI_FLASH_CMD_READ_STATUS, 1U);
+	const imxrt_flexspi_stub_params_s params = {
+		.flexspi_base = priv->flexspi_base,
+		.page_size = flash->page_size,
+		.write_enable_seq = IMXRT_FLEXSPI1_PRG_SEQ_INDEX(write_enable_slot),
+		.page_program_seq = IMXRT_FLEXSPI1_PRG_SEQ_INDEX(page_program_slot),
+		.read_status_seq = IMXRT_FLEXSPI1_PRG_SEQ_INDEX(read_status_slot) | IMXRT_FLEXSPI1_PRG_LENGTH(1U),
+	};
+
+	const target_addr32_t stub_base = target->ram->start;
+	const target_addr32_t params_base = stub_base + IMXRT_STUB_PARAMS_OFFSET;
+	const target_addr32_t buffer_base = stub_base + IMXRT_STUB_BUFFER_OFFSET;
+	target_mem32_write(target, stub_base, imxrt_flexspi_write_stub, sizeof(imxrt_flexspi_write_stub));
+	target_mem32_write(target, params_base, &params, sizeof(params));
+	target_mem32_write(target, buffer_base, buffer, length);
+	if (target_check_error(target))
+		return false;
+
+	return cortexm_run_stub(target, stub_base, address, buffer_base, length, params_base) == 0;
+}
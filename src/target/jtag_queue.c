@@ -0,0 +1,167 @@
+/*
+ * This file is part of the Black Magic Debug project.
+ *
+ * Copyright (C) 2026 1BitSquared <info@1bitsquared.com>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * This file implements the JTAG queue, which collects up TAP operations as the TMS and TDI bit streams
+ * they describe so adaptors able to run whole raw sequences can execute them in as few transfers as possible.
+ * Where the adaptor can't do that, queued operations are passed straight through to jtag_proc instead.
+ */
+
+#include "general.h"
+#include "jtagtap.h"
+#include "buffer_utils.h"
+
+#if CONFIG_BMDA == 1
+/* This is the longest sequence the J-Link can be handed in one transfer, and is plenty for everything else too */
+#define JTAG_QUEUE_CYCLES   4096U
+#define JTAG_QUEUE_CAPTURES 64U
+
+typedef struct jtag_queue_capture {
+	uint8_t *data_out;
+	uint16_t offset;
+	uint16_t clock_cycles;
+} jtag_queue_capture_s;
+
+static uint8_t jtag_queue_tms[JTAG_QUEUE_CYCLES / 8U];
+static uint8_t jtag_queue_tdi[JTAG_QUEUE_CYCLES / 8U];
+static uint8_t jtag_queue_tdo[JTAG_QUEUE_CYCLES / 8U];
+static jtag_queue_capture_s jtag_queue_captures[JTAG_QUEUE_CAPTURES];
+static size_t jtag_queue_cycles;
+static size_t jtag_queue_capture_count;
+
+/* Make room for a new operation on the queue, returning false if it's too big to ever be queued */
+static bool jtag_queue_reserve(const size_t clock_cycles, const bool capture)
+{
+	if (clock_cycles > JTAG_QUEUE_CYCLES) {
+		jtag_queue_flush();
+		return false;
+	}
+	if (jtag_queue_cycles + clock_cycles > JTAG_QUEUE_CYCLES ||
+		(capture && jtag_queue_capture_count == JTAG_QUEUE_CAPTURES))
+		jtag_queue_flush();
+	return true;
+}
+
+/* Append a cycle to the end of the queue's TMS and TDI bit streams */
+static void jtag_queue_append(const bool tms, const bool tdi)
+{
+	const size_t byte = jtag_queue_cycles >> 3U;
+	const uint8_t bit = 1U << (jtag_queue_cycles & 7U);
+	/* Starting a new byte, clear it down */
+	if (bit == 1U) {
+		jtag_queue_tms[byte] = 0U;
+		jtag_queue_tdi[byte] = 0U;
+	}
+	if (tms)
+		jtag_queue_tms[byte] |= bit;
+	if (tdi)
+		jtag_queue_tdi[byte] |= bit;
+	++jtag_queue_cycles;
+}
+#endif
+
+void jtag_queue_tms_seq(const uint32_t tms_states, const size_t clock_cycles)
+{
+#if CONFIG_BMDA == 1
+	if (jtag_proc.jtagtap_sequence && jtag_queue_reserve(clock_cycles, false)) {
+		for (size_t cycle = 0U; cycle < clock_cycles; ++cycle)
+			jtag_queue_append((tms_states >> cycle) & 1U, true);
+		return;
+	}
+#endif
+	jtag_proc.jtagtap_tms_seq(tms_states, clock_cycles);
+}
+
+void jtag_queue_tdi_tdo_seq(
+	uint8_t *const data_out, const bool final_tms, const uint8_t *const data_in, const size_t clock_cycles)
+{
+	if (!data_out) {
+		jtag_queue_tdi_seq(final_tms, data_in, clock_cycles);
+		return;
+	}
+#if CONFIG_BMDA == 1
+	if (jtag_proc.jtagtap_sequence && jtag_queue_reserve(clock_cycles, true)) {
+		/* Note where this operation's TDO data will be found in the results once run */
+		jtag_queue_capture_s *const capture = &jtag_queue_captures[jtag_queue_capture_count++];
+		capture->data_out = data_out;
+		capture->offset = (uint16_t)jtag_queue_cycles;
+		capture->clock_cycles = (uint16_t)clock_cycles;
+		for (size_t cycle = 0U; cycle < clock_cycles; ++cycle)
+			jtag_queue_append(final_tms && cycle + 1U == clock_cycles, read_bit(data_in, cycle));
+		return;
+	}
+#endif
+	jtag_proc.jtagtap_tdi_tdo_seq(data_out, final_tms, data_in, clock_cycles);
+}
+
+void jtag_queue_tdi_seq(const bool final_tms, const uint8_t *const data_in, const size_t clock_cycles)
+{
+#if CONFIG_BMDA == 1
+	if (jtag_proc.jtagtap_sequence && jtag_queue_reserve(clock_cycles, false)) {
+		for (size_t cycle = 0U; cycle < clock_cycles; ++cycle)
+			jtag_queue_append(final_tms && cycle + 1U == clock_cycles, read_bit(data_in, cycle));
+		return;
+	}
+#endif
+	jtag_proc.jtagtap_tdi_seq(final_tms, data_in, clock_cycles);
+}
+
+void jtag_queue_cycle(const bool tms, const bool tdi, const size_t clock_cycles)
+{
+#if CONFIG_BMDA == 1
+	if (jtag_proc.jtagtap_sequence && jtag_queue_reserve(clock_cycles, false)) {
+		for (size_t cycle = 0U; cycle < clock_cycles; ++cycle)
+			jtag_queue_append(tms, tdi);
+		return;
+	}
+#endif
+	jtag_proc.jtagtap_cycle(tms, tdi, clock_cycles);
+}
+
+void jtag_queue_flush(void)
+{
+#if CONFIG_BMDA == 1
+	if (!jtag_queue_cycles)
+		return;
+	/* Reset the queue before running it so that the queue is left empty even if the adaptor raises an exception */
+	const size_t clock_cycles = jtag_queue_cycles;
+	const size_t capture_count = jtag_queue_capture_count;
+	jtag_queue_cycles = 0U;
+	jtag_queue_capture_count = 0U;
+	jtag_proc.jtagtap_sequence(jtag_queue_tms, jtag_queue_tdi, capture_count ? jtag_queue_tdo : NULL, clock_cycles);
+	/* Now hand the captured data back out to where each operation wanted it */
+	for (size_t idx = 0U; idx < capture_count; ++idx) {
+		const jtag_queue_capture_s *const capture = &jtag_queue_captures[idx];
+		copy_bits(capture->data_out, 0U, jtag_queue_tdo, capture->offset, capture->clock_cycles);
+	}
+#endif
+}
@@ -33,6 +33,8 @@
 #include "adiv5.h"
 #include "jtag_devs.h"
 #include "gdb_packet.h"
+#include "buffer_utils.h"
+#include "probe_trace.h"
 
 jtag_dev_s jtag_devs[JTAG_MAX_DEVS];
 uint32_t jtag_dev_count = 0;
@@ -40,10 +42,28 @@ uint32_t jtag_dev_count = 0;
 /* bucket of ones for don't care TDI */
 const uint8_t ones[8] = {0xffU, 0xffU, 0xffU, 0xffU, 0xffU, 0xffU, 0xffU, 0xffU};
 
+/* Enough cycles to read an ID code from every device we support, plus the all-1's that marks the end of the chain */
+#define JTAG_IDCODE_SCAN_CYCLES ((JTAG_MAX_DEVS + 1U) * 32U)
+/* Enough cycles to read every IR on a chain of the given length, plus the two 1's that mark the end of the chain */
+#define JTAG_IR_SCAN_CYCLES(devices) (((devices) * JTAG_MAX_IR_LEN) + 2U)
+#define JTAG_SCAN_BUFFER_SIZE        ((JTAG_IDCODE_SCAN_CYCLES + 7U) >> 3U)
+
+/*
+ * The result of the last successful IR discovery, keyed by the ID code vector of the chain it was done on.
+ * When a rescan finds the same ID codes, the IR lengths are taken from here rather than rediscovered.
+ */
+static struct {
+	uint32_t dev_count;
+	uint32_t idcodes[JTAG_MAX_DEVS];
+	uint8_t ir_lens[JTAG_MAX_DEVS];
+} jtag_chain_cache;
+
 static bool jtag_read_idcodes(void);
 static void jtag_display_idcodes(void);
 static bool jtag_read_irs(void);
 static bool jtag_sanity_check(void);
+static bool jtag_chain_cache_lookup(void);
+static void jtag_chain_cache_store(void);
 
 #if CONFIG_BMDA == 0
 void jtag_add_device(const uint32_t dev_index, const jtag_dev_s *jtag_dev)
@@ -61,12 +81,15 @@ void jtag_add_device(const uint32_t dev_index, const jtag_dev_s *jtag_dev)
  *
  * 1. Perform a SWD -> JTAG transition just in case any ARM devices were in SWD mode
  * 2. Reset the TAPs of any attached device (this ensures they're all in ID code mode)
- * 3. Read out the ID code register chain, shifting in all 1's, until we read an
- *    all-1's ID back (indicating the end of the chain)
- * 4. Read out the active instruction register chain, shifting in all 1's,
- *    and applying quirks as required to calculate how long each IR is
- * 5. Switch back to the DR chain and read out all the devices again now they are in
- *    BYPASS mode as a way to validate we have the chain length right
+ * 3. Read out the ID code register chain in one long shift, shifting in all 1's,
+ *    and walk it until we find an all-1's ID (indicating the end of the chain)
+ * 4. If the ID codes match the chain discovered last time, reuse its IR lengths, loading
+ *    all 1's into the IR chain in one shift to put every device into BYPASS. Otherwise:
+ *    a. Read out the active instruction register chain in one shift, shifting in all 1's,
+ *       and applying quirks as required to calculate how long each IR is, cross-checking
+ *       the device count against the ID code scan and that only 1's follow the last IR
+ *    b. Switch back to the DR chain and read out all the devices again now they are in
+ *       BYPASS mode as a way to validate we have the chain length right
  *
  * Once this process is complete, all devices should be accounted for, the
  * device structures all set up with suitable pre- and post-scan values for both the
@@ -100,21 +123,17 @@ bool jtag_scan(void)
 	/* Reset the chain ready */
 	jtag_proc.jtagtap_reset();
 	/* Start by reading out the ID Codes for all the devices on the chain */
-	if (!jtag_read_idcodes() ||
-		/* Otherwise, try and learn the chain IR lengths */
-		!jtag_read_irs())
+	if (!jtag_read_idcodes())
 		return false;
 
-	/* IRs are all successfully accounted for, so clean up and do housekeeping */
-	DEBUG_INFO("Return to Run-Test/Idle\n");
-	jtag_proc.jtagtap_next(true, true);
-	jtagtap_return_idle(1);
-
-	/* All devices should be in BYPASS now so do the sanity check */
-	if (!jtag_sanity_check())
-		return false;
+	/* If we've seen this chain before we already know the IR lengths, otherwise learn them and validate the result */
+	if (!jtag_chain_cache_lookup()) {
+		if (!jtag_read_irs() || !jtag_sanity_check())
+			return false;
+		jtag_chain_cache_store();
+	}
 
-	/* Fill in the ir_postscan fields */
+	/* Fill in the ir_postscan and DR pre/post scan fields */
 	uint8_t postscan = 0;
 	for (size_t device = 0; device < jtag_dev_count; ++device) {
 		/* Traverse the device list from the back */
@@ -122,6 +141,8 @@ bool jtag_scan(void)
 		/* Copy the current postscan value in and add this device's IR to it for the next lowest in the list  */
 		jtag_devs[idx].ir_postscan = postscan;
 		postscan += jtag_devs[idx].ir_len;
+		jtag_devs[idx].dr_prescan = idx;
+		jtag_devs[idx].dr_postscan = device;
 	}
 
 #if CONFIG_BMDA == 1
@@ -159,17 +180,25 @@ bool jtag_scan(void)
 
 static bool jtag_read_idcodes(void)
 {
+	uint8_t data_in[JTAG_SCAN_BUFFER_SIZE];
+	uint8_t idcodes[JTAG_SCAN_BUFFER_SIZE];
+	memset(data_in, 0xff, sizeof(data_in));
+
 	/* Transition to Shift-DR */
 	DEBUG_INFO("Change state to Shift-DR\n");
 	jtagtap_shift_dr();
 
+	/* Read out enough bits for the longest chain we support plus one, while shifting in 1's */
 	DEBUG_INFO("Scanning out ID codes\n");
+	jtag_proc.jtagtap_tdi_tdo_seq(idcodes, true, data_in, JTAG_IDCODE_SCAN_CYCLES);
+	/* Well, it worked, so clean up and do housekeeping */
+	DEBUG_INFO("Return to Run-Test/Idle\n");
+	jtagtap_return_idle(1);
+
 	size_t device = 0;
-	/* Try scanning to one ID past the end of the chain */
+	/* Walk the ID codes to find the one past the end of the chain */
 	for (; device <= JTAG_MAX_DEVS; ++device) {
-		/* Try to read out 32 bits, while shifting in 1's */
-		uint32_t idcode = 0;
-		jtag_proc.jtagtap_tdi_tdo_seq((uint8_t *)&idcode, false, ones, 32);
+		const uint32_t idcode = read_le4(idcodes, device * 4U);
 		/* If the IDCode read is all 1's, we've reached the end */
 		if (idcode == 0xffffffffU)
 			break;
@@ -183,12 +212,10 @@ static bool jtag_read_idcodes(void)
 		jtag_devs[device].jd_idcode = idcode;
 	}
 
-	/* Well, it worked, so clean up and do housekeeping */
-	DEBUG_INFO("Return to Run-Test/Idle\n");
-	jtag_proc.jtagtap_next(true, true);
-	jtagtap_return_idle(1);
 	jtag_dev_count = device;
-	return true;
+	if (!jtag_dev_count)
+		DEBUG_ERROR("jtag_scan: No devices found on the chain\n");
+	return jtag_dev_count;
 }
 
 static void jtag_display_idcodes(void)
@@ -219,22 +246,34 @@ static jtag_ir_quirks_s jtag_device_get_quirks(const uint32_t idcode)
 
 static bool jtag_read_irs(void)
 {
+	uint8_t data_in[JTAG_SCAN_BUFFER_SIZE];
+	uint8_t irs[JTAG_SCAN_BUFFER_SIZE];
+	memset(data_in, 0xff, sizeof(data_in));
+	const size_t scan_cycles = JTAG_IR_SCAN_CYCLES(jtag_dev_count);
+
 	/* Transition to Shift-IR */
 	DEBUG_INFO("Change state to Shift-IR\n");
 	jtagtap_shift_ir();
 
+	/* Read out enough bits for every device to have the longest IR we support, while shifting in 1's */
 	DEBUG_INFO("Scanning out IRs\n");
+	jtag_proc.jtagtap_tdi_tdo_seq(irs, true, data_in, scan_cycles);
+	/* Load the 1's into the IRs, putting all devices into BYPASS */
+	DEBUG_INFO("Return to Run-Test/Idle\n");
+	jtagtap_return_idle(1);
+
 	/* Start with no prescan and the first device */
 	size_t prescan = 0U;
 	size_t device = 0U;
+	size_t cycle = 0U;
 	uint8_t ir_len = 0U;
 	/* Grab the first device's quirks, if any */
 	jtag_ir_quirks_s ir_quirks = jtag_device_get_quirks(jtag_devs[0].jd_idcode);
 
-	/* Try scanning out the IR for the device */
-	while (ir_len <= JTAG_MAX_IR_LEN) {
-		/* Read the next IR bit */
-		const bool next_bit = jtag_proc.jtagtap_next(false, true);
+	/* Try decoding the IR for the device */
+	for (; cycle < scan_cycles && ir_len <= JTAG_MAX_IR_LEN; ++cycle) {
+		/* Get the next IR bit */
+		const bool next_bit = read_bit(irs, cycle);
 		/* If we have quirks, validate the bit against the expected IR */
 		if (ir_quirks.ir_length && ((ir_quirks.ir_value >> ir_len) & 1U) != next_bit) {
 			DEBUG_ERROR("jtag_scan: IR does not match the expected value, bailing out\n");
@@ -256,6 +295,12 @@ static bool jtag_read_irs(void)
 			/* If we're not in quirks mode and the IR length is now 2 (2 1-bits in a row read), we're actually done */
 			if (!ir_quirks.ir_length && ir_len == 2U)
 				break;
+			/* Cross-check the IR scan against the ID code scan */
+			if (device == jtag_dev_count) {
+				DEBUG_ERROR("jtag_scan: Sanity check failed: IR dev count doesn't match ID code scan\n");
+				jtag_dev_count = 0;
+				return false;
+			}
 
 			/*
 			 * If we're reading using quirks, we'll read exactly the right number of bits,
@@ -272,32 +317,51 @@ static bool jtag_read_irs(void)
 			++device;
 			ir_len = overrun;
 			/* Grab the device quirks for this new device, if any */
-			ir_quirks = jtag_device_get_quirks(jtag_devs[device].jd_idcode);
+			ir_quirks = device < jtag_dev_count ? jtag_device_get_quirks(jtag_devs[device].jd_idcode) :
+												  (jtag_ir_quirks_s){0};
 		}
 	}
 
 	/* Sanity check that we didn't get an over-long IR */
-	if (ir_len > JTAG_MAX_IR_LEN) {
+	if (ir_len > JTAG_MAX_IR_LEN || cycle == scan_cycles) {
 		DEBUG_ERROR("jtag_scan: Maximum IR length exceeded\n");
 		jtag_dev_count = 0;
-		return 0;
+		return false;
+	}
+	/* Cross-check the IR scan against the ID code scan */
+	if (device != jtag_dev_count) {
+		DEBUG_ERROR("jtag_scan: Sanity check failed: IR dev count doesn't match ID code scan\n");
+		jtag_dev_count = 0;
+		return false;
+	}
+	/* Everything past the end of the IR chain should be the 1's we shifted in */
+	for (++cycle; cycle < scan_cycles; ++cycle) {
+		if (!read_bit(irs, cycle)) {
+			DEBUG_ERROR("jtag_scan: Sanity check failed: IR chain did not end in all 1's\n");
+			jtag_dev_count = 0;
+			return false;
+		}
 	}
 	return true;
 }
 
 static bool jtag_sanity_check(void)
 {
+	uint8_t bypass[(JTAG_MAX_DEVS + 8U) >> 3U];
 	/* Transition to Shift-DR */
 	DEBUG_INFO("Change state to Shift-DR\n");
 	jtagtap_shift_dr();
+	/* Read out one more bit than there are devices - each BYPASS register should give back a 0, then our first 1 */
+	jtag_proc.jtagtap_tdi_tdo_seq(bypass, true, ones, jtag_dev_count + 1U);
+	/* Clean up */
+	DEBUG_INFO("Return to Run-Test/Idle\n");
+	jtagtap_return_idle(1);
+
 	/* Count devices on chain */
 	size_t device = 0;
 	for (; device <= jtag_dev_count; ++device) {
-		if (jtag_proc.jtagtap_next(false, true))
+		if (read_bit(bypass, device))
 			break;
-		/* Configure the DR pre/post scan values */
-		jtag_devs[device].dr_prescan = device;
-		jtag_devs[device].dr_postscan = jtag_dev_count - device - 1U;
 	}
 
 	/* If the device count gleaned above does not match the device count, error out */
@@ -306,16 +370,48 @@ static bool jtag_sanity_check(void)
 		jtag_dev_count = 0;
 		return false;
 	}
-
-	/* Everything's accounted for, so clean up */
-	DEBUG_INFO("Return to Run-Test/Idle\n");
-	jtag_proc.jtagtap_next(true, true);
-	jtagtap_return_idle(1);
 	/* Return if there are any devices on the scan chain */
 	return jtag_dev_count;
 }
 
-void jtag_dev_write_ir(const uint8_t dev_index, const uint32_t ir)
+static bool jtag_chain_cache_lookup(void)
+{
+	if (jtag_chain_cache.dev_count != jtag_dev_count)
+		return false;
+	for (size_t device = 0; device < jtag_dev_count; ++device) {
+		if (jtag_chain_cache.idcodes[device] != jtag_devs[device].jd_idcode)
+			return false;
+	}
+
+	/* It's a chain we know, so restore the IR layout */
+	DEBUG_INFO("Known chain, reusing IR lengths\n");
+	size_t prescan = 0U;
+	for (size_t device = 0; device < jtag_dev_count; ++device) {
+		jtag_devs[device].ir_len = jtag_chain_cache.ir_lens[device];
+		jtag_devs[device].ir_prescan = prescan;
+		jtag_devs[device].current_ir = UINT32_MAX;
+		prescan += jtag_chain_cache.ir_lens[device];
+	}
+
+	/* And put every device into BYPASS by loading all 1's into the IR chain */
+	uint8_t data_in[JTAG_SCAN_BUFFER_SIZE];
+	memset(data_in, 0xff, sizeof(data_in));
+	jtagtap_shift_ir();
+	jtag_proc.jtagtap_tdi_seq(true, data_in, prescan);
+	jtagtap_return_idle(1);
+	return true;
+}
+
+static void jtag_chain_cache_store(void)
+{
+	jtag_chain_cache.dev_count = jtag_dev_count;
+	for (size_t device = 0; device < jtag_dev_count; ++device) {
+		jtag_chain_cache.idcodes[device] = jtag_devs[device].jd_idcode;
+		jtag_chain_cache.ir_lens[device] = jtag_devs[device].ir_len;
+	}
+}
+
+void jtag_dev_queue_ir(const uint8_t dev_index, const uint32_t ir)
 {
 	jtag_dev_s *const device = &jtag_devs[dev_index];
 	/* If the request would duplicate work already done, do nothing */
@@ -329,32 +425,46 @@ void jtag_dev_write_ir(const uint8_t dev_index, const uint32_t ir)
 	device->current_ir = ir;
 
 	/* Do the work to make the scanchain match the jtag_devs state */
-	jtagtap_shift_ir();
+	jtag_queue_shift_ir();
 	/* Once in Shift-IR, clock out 1's till we hit the right device in the chain */
-	jtag_proc.jtagtap_tdi_seq(false, ones, device->ir_prescan);
+	jtag_queue_tdi_seq(false, ones, device->ir_prescan);
 	/* Then clock out the new IR value and drop into Exit1-IR on the last cycle if we're the last device */
-	jtag_proc.jtagtap_tdi_seq(!device->ir_postscan, (const uint8_t *)&ir, device->ir_len);
+	jtag_queue_tdi_seq(!device->ir_postscan, (const uint8_t *)&ir, device->ir_len);
 	/* Make sure we're in Exit1-IR having clocked out 1's for any more devices on the chain */
-	jtag_proc.jtagtap_tdi_seq(true, ones, device->ir_postscan);
+	jtag_queue_tdi_seq(true, ones, device->ir_postscan);
 	/* Now go through Update-IR and back to Idle */
-	jtagtap_return_idle(1);
+	jtag_queue_return_idle(1U);
 }
 
-void jtag_dev_shift_dr(
+void jtag_dev_write_ir(const uint8_t dev_index, const uint32_t ir)
+{
+	const uint32_t start = probe_trace_begin();
+	jtag_dev_queue_ir(dev_index, ir);
+	jtag_queue_flush();
+	probe_trace_record(PROBE_TRACE_JTAG_IR, start, dev_index, ir, 0U, 0U);
+}
+
+void jtag_dev_queue_dr(
 	const uint8_t dev_index, uint8_t *const data_out, const uint8_t *const data_in, const size_t clock_cycles)
 {
 	const jtag_dev_s *const device = &jtag_devs[dev_index];
 	/* Switch into Shift-DR */
-	jtagtap_shift_dr();
+	jtag_queue_shift_dr();
 	/* Now we're in Shift-DR, clock out 1's till we hit the right device in the chain */
-	jtag_proc.jtagtap_tdi_seq(false, ones, device->dr_prescan);
+	jtag_queue_tdi_seq(false, ones, device->dr_prescan);
 	/* Now clock out the new DR value and get the response */
-	if (data_out)
-		jtag_proc.jtagtap_tdi_tdo_seq(data_out, !device->dr_postscan, data_in, clock_cycles);
-	else
-		jtag_proc.jtagtap_tdi_seq(!device->dr_postscan, data_in, clock_cycles);
+	jtag_queue_tdi_tdo_seq(data_out, !device->dr_postscan, data_in, clock_cycles);
 	/* Make sure we're in Exit1-DR having clocked out 1's for any more devices on the chain */
-	jtag_proc.jtagtap_tdi_seq(true, ones, device->dr_postscan);
+	jtag_queue_tdi_seq(true, ones, device->dr_postscan);
 	/* Now go through Update-DR and back to Idle */
-	jtagtap_return_idle(1);
+	jtag_queue_return_idle(1U);
+}
+
+void jtag_dev_shift_dr(
+	const uint8_t dev_index, uint8_t *const data_out, const uint8_t *const data_in, const size_t clock_cycles)
+{
+	const uint32_t start = probe_trace_begin();
+	jtag_dev_queue_dr(dev_index, data_out, data_in, clock_cycles);
+	jtag_queue_flush();
+	probe_trace_record(PROBE_TRACE_JTAG_DR, start, dev_index, (uint32_t)clock_cycles, 0U, 0U);
 }
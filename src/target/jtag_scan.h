@@ -48,6 +48,9 @@ extern const uint8_t ones[8];
 
 void jtag_dev_write_ir(uint8_t dev_index, uint32_t ir);
 void jtag_dev_shift_dr(uint8_t dev_index, uint8_t *data_out, const uint8_t *data_in, size_t clock_cycles);
+/* As above, but only put the IR/DR scans on the JTAG queue - see jtag_queue_flush() */
+void jtag_dev_queue_ir(uint8_t dev_index, uint32_t ir);
+void jtag_dev_queue_dr(uint8_t dev_index, uint8_t *data_out, const uint8_t *data_in, size_t clock_cycles);
 void jtag_add_device(uint32_t dev_index, const jtag_dev_s *jtag_dev);
 
 #endif /* TARGET_JTAG_SCAN_H */
@@ -75,6 +75,8 @@
 #define FTFx_FSTAT_FPVIOL   (1U << 4U)
 #define FTFx_FSTAT_MGSTAT0  (1U << 0U)
 
+#define FTFx_FCNFG_RAMRDY (1U << 1U)
+
 #define FTFx_FSEC_KEYEN_MSK (0b11U << 6U)
 #define FTFx_FSEC_KEYEN     (0b10U << 6U)
 
@@ -85,6 +87,7 @@
 /* Part of the FTFE module for K64 */
 #define FTFx_CMD_PROGRAM_PHRASE  0x07U
 #define FTFx_CMD_ERASE_SECTOR    0x09U
+#define FTFx_CMD_PROGRAM_SECTION 0x0bU
 #define FTFx_CMD_CHECK_ERASE_ALL 0x40U
 #define FTFx_CMD_READ_ONCE       0x41U
 #define FTFx_CMD_PROGRAM_ONCE    0x43U
@@ -95,6 +98,10 @@
 /* 8 byte phrases need to be written to the k64 flash */
 #define K64_WRITE_LEN 8U
 
+/* FlexRAM, used as the programming acceleration RAM by the program section command */
+#define FTFx_FLEXRAM_BASE 0x14000000U
+#define FTFx_FLEXRAM_SIZE 0x00001000U
+
 /* Target registers */
 #define MK20DX256_FLASH_BASE       0x00000000U
 #define MK20DX256_FLASH_SIZE       0x00040000U
@@ -127,10 +134,12 @@ static bool kinetis_cmd_unsafe(target_s *t, int argc, const char **argv)
 static bool kinetis_flash_cmd_erase(target_flash_s *f, target_addr_t addr, size_t len);
 static bool kinetis_flash_cmd_write(target_flash_s *f, target_addr_t dest, const void *src, size_t len);
 static bool kinetis_flash_done(target_flash_s *f);
+static bool kinetis_flash_blank_check(target_flash_s *f, target_addr_t addr, size_t len, bool *blank);
 
 typedef struct kinetis_flash {
 	target_flash_s f;
 	uint8_t write_len;
+	bool program_section; /* Whether to try programming whole sections from FlexRAM */
 } kinetis_flash_s;
 
 static void kinetis_add_flash(
@@ -149,8 +158,11 @@ static void kinetis_add_flash(
 	f->erase = kinetis_flash_cmd_erase;
 	f->write = kinetis_flash_cmd_write;
 	f->done = kinetis_flash_done;
+	f->blank_check = kinetis_flash_blank_check;
 	f->erased = 0xff;
 	kf->write_len = write_len;
+	/* The phrase programming FTFE/FTFC parts have FlexRAM and the program section command */
+	kf->program_section = write_len == K64_WRITE_LEN;
 	target_add_flash(t, f);
 }
 
@@ -469,6 +481,45 @@ static bool kinetis_flash_cmd_erase(target_flash_s *const f, target_addr_t addr,
 	return true;
 }
 
+/* Have the controller check the range reads as all 1s using its Read 1s Section command, at normal margin */
+static bool kinetis_flash_blank_check(target_flash_s *const f, const target_addr_t addr, const size_t len, bool *blank)
+{
+	const kinetis_flash_s *const kf = (kinetis_flash_s *)f;
+	/* The unit count goes in FCCOB4 (high byte) and FCCOB5 (low byte), with the margin level in FCCOB6 */
+	const size_t units = len / kf->write_len;
+	if (units > UINT16_MAX)
+		return false;
+	const uint32_t count = (uint32_t)units << 16U;
+	if (!kinetis_fccob_cmd(f->t, FTFx_CMD_CHECK_ERASE, addr, &count, 1))
+		return false;
+	*blank = !(target_mem32_read8(f->t, FTFx_FSTAT) & FTFx_FSTAT_MGSTAT0);
+	return true;
+}
+
+/*
+ * Program up to a FlexRAM's worth of phrases in one command by staging them in FlexRAM. This only works
+ * while FlexRAM is available as plain RAM (not set up for EEPROM emulation), so returns false to have the
+ * caller fall back to programming a phrase at a time if it's not or the controller rejects the command.
+ */
+static bool kinetis_flash_program_section(target_s *const t, target_addr_t dest, const uint8_t *src, size_t len)
+{
+	if (!(target_mem32_read8(t, FTFx_FCNFG) & FTFx_FCNFG_RAMRDY))
+		return false;
+
+	while (len) {
+		const size_t amount = MIN(len, FTFx_FLEXRAM_SIZE);
+		target_mem32_write(t, FTFx_FLEXRAM_BASE, src, amount);
+		/* The phrase count goes in FCCOB4 (high byte) and FCCOB5 (low byte) */
+		const uint32_t count = (uint32_t)(amount / K64_WRITE_LEN) << 16U;
+		if (target_check_error(t) || !kinetis_fccob_cmd(t, FTFx_CMD_PROGRAM_SECTION, dest, &count, 1))
+			return false;
+		len -= amount;
+		dest += amount;
+		src += amount;
+	}
+	return true;
+}
+
 static bool kinetis_flash_cmd_write(target_flash_s *f, target_addr_t dest, const void *src, size_t len)
 {
 	kinetis_flash_s *const kf = (kinetis_flash_s *)f;
@@ -480,6 +531,14 @@ static bool kinetis_flash_cmd_write(target_flash_s *f, target_addr_t dest, const
 		((uint8_t *)src)[FLASH_SECURITY_BYTE_ADDRESS - dest] = FLASH_SECURITY_BYTE_UNSECURED;
 #pragma GCC diagnostic pop
 
+	if (kf->program_section) {
+		if (kinetis_flash_program_section(f->t, dest, src, len))
+			return true;
+		/* Don't try again if the part can't do it, and redo the whole block a phrase at a time */
+		DEBUG_WARN("Kinetis program section failed, falling back to phrase programming\n");
+		kf->program_section = false;
+	}
+
 	/* Determine write command based on the alignment. */
 	uint8_t write_cmd;
 	if (kf->write_len == K64_WRITE_LEN)
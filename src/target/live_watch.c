@@ -0,0 +1,169 @@
+/*
+ * This file is part of the Black Magic Debug project.
+ *
+ * Copyright (C) 2026 1BitSquared <info@1bitsquared.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * This file implements live watches - a set of target addresses that get read back at a fixed rate while
+ * the target runs, with any value that changed being reported to GDB as console output. This replaces
+ * repeatedly halting the target from GDB to look at a variable, which distorts timing and takes far longer.
+ *
+ * Watches close together in memory are read in a single block access. On targets whose memory can be
+ * accessed while running this is entirely non-intrusive, otherwise the target is halted just for the
+ * duration of the reads, as RTT polling does.
+ */
+
+#include "general.h"
+#include "target.h"
+#include "target_internal.h"
+#include "gdb_packet.h"
+#include "buffer_utils.h"
+#include "live_watch.h"
+
+#define LIVE_WATCH_MAX_ENTRIES 16U
+/* Watches at most this many bytes apart are read together */
+#define LIVE_WATCH_COALESCE_GAP 32U
+/* Largest single block read done for a group of watches */
+#define LIVE_WATCH_BLOCK_MAX 64U
+
+typedef struct live_watch {
+	target_addr_t addr;
+	uint8_t size;
+	/* Who asked for the watch, so a value is only reported to those that want it */
+	uint8_t owners;
+	bool reported;
+	uint32_t value;
+} live_watch_s;
+
+uint32_t live_watch_rate_ms = 100U;
+void (*live_watch_observer)(target_addr_t addr, uint8_t size, uint32_t value) = NULL;
+
+/* Kept sorted by address so that neighbouring watches can be coalesced */
+static live_watch_s live_watches[LIVE_WATCH_MAX_ENTRIES];
+static size_t live_watch_count = 0U;
+static uint32_t live_watch_last_ms = 0U;
+
+bool live_watch_add(const target_addr_t addr, const uint8_t size, const uint8_t owner)
+{
+	if ((size != 1U && size != 2U && size != 4U) || (addr & (size - 1U)))
+		return false;
+
+	size_t idx = 0U;
+	while (idx < live_watch_count && live_watches[idx].addr < addr)
+		++idx;
+	/*
+	 * Re-adding an address just changes the size it's watched at, and adds to who wants it - so the same
+	 * address asked for by several owners is still only read once per round
+	 */
+	uint8_t owners = owner;
+	if (idx == live_watch_count || live_watches[idx].addr != addr) {
+		if (live_watch_count == LIVE_WATCH_MAX_ENTRIES)
+			return false;
+		memmove(&live_watches[idx + 1U], &live_watches[idx], (live_watch_count - idx) * sizeof(*live_watches));
+		++live_watch_count;
+	} else
+		owners |= live_watches[idx].owners;
+	live_watches[idx] = (live_watch_s){.addr = addr, .size = size, .owners = owners};
+	return true;
+}
+
+/* Drop the owner's interest in all the watches, removing those nobody else wants */
+void live_watch_clear(const uint8_t owner)
+{
+	size_t kept = 0U;
+	for (size_t idx = 0U; idx < live_watch_count; ++idx) {
+		live_watches[idx].owners &= ~owner;
+		if (live_watches[idx].owners)
+			live_watches[kept++] = live_watches[idx];
+	}
+	live_watch_count = kept;
+}
+
+void live_watch_list(void)
+{
+	for (size_t idx = 0U; idx < live_watch_count; ++idx)
+		gdb_outf("0x%08" PRIx32 " %u%s\n", live_watches[idx].addr, live_watches[idx].size,
+			live_watches[idx].owners & LIVE_WATCH_OWNER_GDB ? "" : " (observer)");
+}
+
+static void live_watch_report(live_watch_s *const watch, const uint8_t *const block)
+{
+	uint32_t value;
+	if (watch->size == 4U)
+		value = read_le4(block, 0U);
+	else if (watch->size == 2U)
+		value = read_le2(block, 0U);
+	else
+		value = block[0];
+
+	if (watch->reported && watch->value == value)
+		return;
+	watch->value = value;
+	watch->reported = true;
+	if (watch->owners & LIVE_WATCH_OWNER_GDB)
+		gdb_outf("0x%08" PRIx32 " = 0x%0*" PRIx32 "\n", watch->addr, watch->size * 2, value);
+	if ((watch->owners & LIVE_WATCH_OWNER_OBSERVER) && live_watch_observer)
+		live_watch_observer(watch->addr, watch->size, value);
+}
+
+/* Read one group of neighbouring watches, returning the index of the first watch not in it */
+static size_t live_watch_read_group(target_s *const target, const size_t first)
+{
+	const target_addr_t start = live_watches[first].addr;
+	target_addr_t end = start + live_watches[first].size;
+	size_t last = first + 1U;
+	for (; last < live_watch_count; ++last) {
+		const live_watch_s *const watch = &live_watches[last];
+		if (watch->addr > end + LIVE_WATCH_COALESCE_GAP || watch->addr + watch->size - start > LIVE_WATCH_BLOCK_MAX)
+			break;
+		end = MAX(end, watch->addr + watch->size);
+	}
+
+	uint8_t block[LIVE_WATCH_BLOCK_MAX];
+	if (!target_mem32_read(target, block, start, end - start)) {
+		for (size_t idx = first; idx < last; ++idx)
+			live_watch_report(&live_watches[idx], block + (live_watches[idx].addr - start));
+	}
+	return last;
+}
+
+void live_watch_poll(target_s *const target)
+{
+	const uint32_t now = platform_time_ms();
+	if (!target || !live_watch_count || now - live_watch_last_ms < live_watch_rate_ms)
+		return;
+	live_watch_last_ms = now;
+
+	bool resume_target = false;
+	if (target_mem_access_needs_halt(target) && target_halt_poll(target, NULL) == TARGET_HALT_RUNNING) {
+		/* Briefly halt the target for the reads */
+		target_halt_request(target);
+		target_halt_reason_e reason = TARGET_HALT_RUNNING;
+		while (reason == TARGET_HALT_RUNNING)
+			reason = target_halt_poll(target, NULL);
+		/* If it stopped for any other reason, leave that for GDB to pick up */
+		if (reason != TARGET_HALT_REQUEST)
+			return;
+		resume_target = true;
+	}
+
+	for (size_t idx = 0U; idx < live_watch_count;)
+		idx = live_watch_read_group(target, idx);
+
+	if (resume_target)
+		target_halt_resume(target, false);
+}
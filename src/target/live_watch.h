@@ -0,0 +1,38 @@
+/*
+ * This file is part of the Black Magic Debug project.
+ *
+ * Copyright (C) 2026 1BitSquared <info@1bitsquared.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef TARGET_LIVE_WATCH_H
+#define TARGET_LIVE_WATCH_H
+
+#include "target.h"
+
+/* Who a watch is for: the controlling GDB's console, or the read-only observer clients */
+#define LIVE_WATCH_OWNER_GDB      (1U << 0U)
+#define LIVE_WATCH_OWNER_OBSERVER (1U << 1U)
+
+extern uint32_t live_watch_rate_ms; /* How often the watched addresses are read back while the target runs */
+/* Called with each new value of a watch the observers own, if set */
+extern void (*live_watch_observer)(target_addr_t addr, uint8_t size, uint32_t value);
+
+bool live_watch_add(target_addr_t addr, uint8_t size, uint8_t owner);
+void live_watch_clear(uint8_t owner);
+void live_watch_list(void);
+void live_watch_poll(target_s *target);
+
+#endif /* TARGET_LIVE_WATCH_H */
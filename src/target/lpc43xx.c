@@ -28,6 +28,7 @@
 #include "lpc_common.h"
 #include "spi.h"
 #include "sfdp.h"
+#include "buffer_utils.h"
 
 #define LPC43xx_CHIPID                0x40043200U
 #define LPC43xx_CHIPID_FAMILY_MASK    0x0fffffffU
@@ -210,6 +211,23 @@
 #define LPC43x0_SPIFI_STATUS_RESET         (1U << 4U)
 #define LPC43x0_SPIFI_STATUS_INTRQ         (1U << 5U)
 
+/* Memory mode read command used when the boot ROM didn't leave one behind: serial fast read (0x0b) */
+#define LPC43x0_SPIFI_MCMD_FAST_READ                                                                         \
+	((0x0bU << LPC43x0_SPIFI_OPCODE_SHIFT) | LPC43x0_SPIFI_FRAME_OPCODE_3B_ADDR | LPC43x0_SPIFI_CMD_SERIAL | \
+		(1U << LPC43x0_SPIFI_DUMMY_SHIFT))
+
+/* The page programming stub, its parameters, its mailbox and then the two chunk buffers go at the start of RAM */
+#define LPC43x0_SPIFI_STUB_PARAMS_OFFSET  ALIGN(sizeof(lpc43x0_spifi_write_stub), 4U)
+#define LPC43x0_SPIFI_STUB_MAILBOX_OFFSET (LPC43x0_SPIFI_STUB_PARAMS_OFFSET + sizeof(lpc43x0_spifi_stub_params_s))
+#define LPC43x0_SPIFI_STUB_BUFFER_OFFSET  (LPC43x0_SPIFI_STUB_MAILBOX_OFFSET + sizeof(lpc43x0_spifi_stub_mailbox_s))
+/* The target address of one of the fields of the stub's mailbox */
+#define LPC43x0_SPIFI_STUB_MAILBOX(target, field) \
+	((target)->ram->start + LPC43x0_SPIFI_STUB_MAILBOX_OFFSET + offsetof(lpc43x0_spifi_stub_mailbox_s, field))
+/* How many pages go in each chunk handed to the stub, so loading one overlaps with programming the last */
+#define LPC43x0_SPIFI_STUB_CHUNK_PAGES 4U
+/* How long a single chunk may take to program */
+#define LPC43x0_SPIFI_STUB_TIMEOUT 5000U
+
 #define LPC43x0_SSP0_BASE 0x40083000
 #define LPC43x0_SSP0_DR   (LPC43x0_SSP0_BASE + 0x008)
 #define LPC43x0_SSP0_SR   (LPC43x0_SSP0_BASE + 0x00c)
@@ -267,6 +285,27 @@ typedef struct lpc43x0_priv {
 	uint32_t bank3_pin8_config;
 } lpc43x0_priv_s;
 
+/* This must match the structure of the same name in flashstub/lpc43x0_spifi.c */
+typedef struct lpc43x0_spifi_stub_params {
+	uint32_t page_size;
+	uint32_t write_enable_cmd;
+	uint32_t page_program_cmd;
+	uint32_t read_status_cmd;
+} lpc43x0_spifi_stub_params_s;
+
+/* This must match the structure of the same name in flashstub/lpc43x0_spifi.c */
+typedef struct lpc43x0_spifi_stub_mailbox {
+	uint32_t doorbell;
+	uint32_t done;
+	uint32_t dest;
+	uint32_t src;
+	uint32_t size;
+} lpc43x0_spifi_stub_mailbox_s;
+
+static const uint16_t lpc43x0_spifi_write_stub[] = {
+#include "flashstub/lpc43x0_spifi.stub"
+};
+
 static bool lpc43xx_cmd_reset(target_s *t, int argc, const char **argv);
 static bool lpc43xx_cmd_mkboot(target_s *t, int argc, const char **argv);
 
@@ -280,6 +319,8 @@ static void lpc43x0_spi_read(target_s *target, uint16_t command, target_addr_t a
 static void lpc43x0_spi_write(
 	target_s *target, uint16_t command, target_addr_t address, const void *buffer, size_t length);
 static void lpc43x0_spi_run_command(target_s *target, uint16_t command, target_addr_t address);
+static bool lpc43x0_spifi_write_pages(
+	target_s *target, const spi_flash_s *flash, target_addr32_t address, const void *buffer, size_t length);
 
 static bool lpc43xx_iap_init(target_flash_s *flash);
 static lpc43xx_partid_s lpc43xx_iap_read_partid(target_s *t);
@@ -403,6 +444,14 @@ static void lpc43x0_add_spi_flash(target_s *const target, const size_t length)
 	/* Add the high region first so it appears second in the map */
 	flash->flash_high = bmp_spi_add_flash(target, LPC43x0_SPI_FLASH_HIGH_BASE, MIN(length, LPC43x0_SPI_FLASH_HIGH_SIZE),
 		lpc43x0_spi_read, lpc43x0_spi_write, lpc43x0_spi_run_command);
+	/*
+	 * If on SPIFI and there's room in RAM for the stub and two chunks' worth of pages, program on-target.
+	 * This is done before the low region is copied from the high one so they both get it.
+	 */
+	const target_ram_s *const ram = target->ram;
+	if (flash->flash_high && priv->interface == FLASH_SPIFI && !(flash->flash_high->page_size & 3U) && ram &&
+		ram->length >= LPC43x0_SPIFI_STUB_BUFFER_OFFSET + (2U * flash->flash_high->page_size))
+		flash->flash_high->write_pages = lpc43x0_spifi_write_pages;
 
 	/*
 	 * Then add the low region - the reason for this is that
@@ -796,14 +845,32 @@ static lpc43xx_partid_s lpc43x0_spi_read_partid(target_s *const t)
 	return result;
 }
 
+/* Take the SPIFI controller out of memory mode (or abort whatever command it's running) so it takes commands */
+static void lpc43x0_spifi_command_mode(target_s *const t)
+{
+	target_mem32_write32(t, LPC43x0_SPIFI_STAT, LPC43x0_SPIFI_STATUS_RESET);
+	while (target_mem32_read32(t, LPC43x0_SPIFI_STAT) & LPC43x0_SPIFI_STATUS_RESET)
+		continue;
+}
+
+/*
+ * Put the SPIFI controller back into memory mode once a command is done. This keeps the Flash readable
+ * through its memory window during Flash operations, so checking blocks for being blank or unchanged,
+ * and verifying them, is done with block reads over the debug interface rather than through commands.
+ */
+static void lpc43x0_spifi_memory_mode(target_s *const t)
+{
+	const lpc43x0_priv_s *const priv = (const lpc43x0_priv_s *)t->target_storage;
+	target_mem32_write32(
+		t, LPC43x0_SPIFI_MCMD, priv->spifi_memory_command ? priv->spifi_memory_command : LPC43x0_SPIFI_MCMD_FAST_READ);
+}
+
 static void lpc43x0_spi_abort(target_s *const t)
 {
 	lpc43x0_priv_s *const priv = (lpc43x0_priv_s *)t->target_storage;
 	if (priv->interface == FLASH_SPIFI) {
 		/* If in SPIFI mode, reset the controller to get to a known state */
-		target_mem32_write32(t, LPC43x0_SPIFI_STAT, LPC43x0_SPIFI_STATUS_RESET);
-		while (target_mem32_read32(t, LPC43x0_SPIFI_STAT) & LPC43x0_SPIFI_STATUS_RESET)
-			continue;
+		lpc43x0_spifi_command_mode(t);
 	} else if (priv->interface == FLASH_SPI) {
 		/* If in SPI/SSP0 mode, first wait for the controller to finish transmitting all outstanding frames */
 		while (target_mem32_read32(t, LPC43x0_SSP0_SR) & SPI43x0_SSP_SR_BSY)
@@ -847,25 +914,29 @@ static void lpc43x0_ssp0_setup_command(target_s *const t, const uint32_t command
 		lpc43x0_ssp0_transfer(t, 0U);
 }
 
-static void lpc43x0_spi_setup_xfer(
-	target_s *const target, const uint16_t command, const target_addr_t address, const size_t length)
+/* Rebuild a command for the SPIFI controller */
+static uint32_t lpc43x0_spifi_command(const uint16_t command, const size_t length)
 {
-	/* Rebuild the command for the SPIFI controller */
-	uint32_t spifi_command = LPC43x0_SPIFI_CMD_SERIAL |
+	const uint32_t spifi_command = LPC43x0_SPIFI_CMD_SERIAL |
 		((command & SPI_FLASH_OPCODE_MASK) << LPC43x0_SPIFI_OPCODE_SHIFT) |
 		(((command & SPI_FLASH_DUMMY_MASK) >> SPI_FLASH_DUMMY_SHIFT) << LPC43x0_SPIFI_DUMMY_SHIFT) |
 		(((command & SPI_FLASH_DATA_MASK) >> SPI_FLASH_DATA_SHIFT) << LPC43x0_SPIFI_DATA_SHIFT) |
 		LPC43x0_SPIFI_DATA_LENGTH(length);
+	if ((command & SPI_FLASH_OPCODE_MODE_MASK) != SPI_FLASH_OPCODE_ONLY)
+		return spifi_command | LPC43x0_SPIFI_FRAME_OPCODE_3B_ADDR;
+	return spifi_command | LPC43x0_SPIFI_FRAME_OPCODE_ONLY;
+}
 
-	/* Setup addressing for the instruction */
-	if ((command & SPI_FLASH_OPCODE_MODE_MASK) != SPI_FLASH_OPCODE_ONLY) {
+static void lpc43x0_spi_setup_xfer(
+	target_s *const target, const uint16_t command, const target_addr_t address, const size_t length)
+{
+	/* Get the controller out of memory mode, then setup addressing for the instruction */
+	lpc43x0_spifi_command_mode(target);
+	if ((command & SPI_FLASH_OPCODE_MODE_MASK) != SPI_FLASH_OPCODE_ONLY)
 		target_mem32_write32(target, LPC43x0_SPIFI_ADDR, address);
-		spifi_command |= LPC43x0_SPIFI_FRAME_OPCODE_3B_ADDR;
-	} else
-		spifi_command |= LPC43x0_SPIFI_FRAME_OPCODE_ONLY;
 
 	/* Write the resulting command to the command register */
-	target_mem32_write32(target, LPC43x0_SPIFI_CMD, spifi_command);
+	target_mem32_write32(target, LPC43x0_SPIFI_CMD, lpc43x0_spifi_command(command, length));
 }
 
 static void lpc43x0_spi_read(target_s *const target, const uint16_t command, const target_addr_t address,
@@ -874,10 +945,15 @@ static void lpc43x0_spi_read(target_s *const target, const uint16_t command, con
 	lpc43x0_priv_s *const priv = (lpc43x0_priv_s *)target->target_storage;
 	if (priv->interface == FLASH_SPIFI) {
 		lpc43x0_spi_setup_xfer(target, command, address, length);
+		/* The data FIFO can be drained a word at a time, so only do the tail a byte at a time */
 		uint8_t *const data = (uint8_t *)buffer;
-		for (size_t i = 0; i < length; ++i)
+		size_t i = 0;
+		for (; i + 4U <= length; i += 4U)
+			write_le4(data, i, target_mem32_read32(target, LPC43x0_SPIFI_DATA));
+		for (; i < length; ++i)
 			data[i] = target_mem32_read8(target, LPC43x0_SPIFI_DATA);
 		lpc43x0_spi_wait_complete(target);
+		lpc43x0_spifi_memory_mode(target);
 	} else if (priv->interface == FLASH_SPI) {
 		/* Select the Flash */
 		target_mem32_write32(target, LPC43xx_GPIO_PORT0_SET, 1U << 6U);
@@ -898,10 +974,15 @@ static void lpc43x0_spi_write(target_s *const target, const uint16_t command, co
 	lpc43x0_priv_s *const priv = (lpc43x0_priv_s *)target->target_storage;
 	if (priv->interface == FLASH_SPIFI) {
 		lpc43x0_spi_setup_xfer(target, command, address, length);
+		/* As with reading, fill the data FIFO a word at a time and only do the tail a byte at a time */
 		const uint8_t *const data = (const uint8_t *)buffer;
-		for (size_t i = 0; i < length; ++i)
+		size_t i = 0;
+		for (; i + 4U <= length; i += 4U)
+			target_mem32_write32(target, LPC43x0_SPIFI_DATA, read_le4(data, i));
+		for (; i < length; ++i)
 			target_mem32_write8(target, LPC43x0_SPIFI_DATA, data[i]);
 		lpc43x0_spi_wait_complete(target);
+		lpc43x0_spifi_memory_mode(target);
 	} else if (priv->interface == FLASH_SPI) {
 		/* Select the Flash */
 		target_mem32_write32(target, LPC43xx_GPIO_PORT0_SET, 1U << 6U);
@@ -921,10 +1002,96 @@ static void lpc43x0_spi_run_command(target_s *const target, const uint16_t comma
 	if (priv->interface == FLASH_SPIFI) {
 		lpc43x0_spi_setup_xfer(target, command, address, 0U);
 		lpc43x0_spi_wait_complete(target);
+		lpc43x0_spifi_memory_mode(target);
 	} else if (priv->interface == FLASH_SPI)
 		lpc43x0_spi_write(target, command, address, NULL, 0U);
 }
 
+/* Wait for the page programming stub to finish the chunk with the given sequence number */
+static bool lpc43x0_spifi_stub_wait(target_s *const target, const uint32_t sequence)
+{
+	platform_timeout_s timeout;
+	platform_timeout_set(&timeout, LPC43x0_SPIFI_STUB_TIMEOUT);
+	while (true) {
+		/* The stub is changing the mailbox under us, so it must never be served from the read cache */
+		target_mem_cache_flush(target);
+		const uint32_t done = target_mem32_read32(target, LPC43x0_SPIFI_STUB_MAILBOX(target, done));
+		if (target_check_error(target))
+			return false;
+		if (done == sequence)
+			return true;
+		if (platform_timeout_is_expired(&timeout)) {
+			DEBUG_WARN("SPIFI page programming stub hung\n");
+			target_halt_request(target);
+			return false;
+		}
+	}
+}
+
+/*
+ * Program whole pages using the resident page programming stub, which runs the write enable, page program
+ * and status polling commands on the SPIFI controller from the target. The data is handed to it in chunks
+ * of a few pages, alternating between two buffers so that the next chunk is loaded while the stub is still
+ * programming the last, rather than the probe doing every register access for every byte over the debug
+ * interface.
+ */
+static bool lpc43x0_spifi_write_pages(target_s *const target, const spi_flash_s *const flash,
+	const target_addr32_t address, const void *const buffer, const size_t length)
+{
+	const target_ram_s *const ram = target->ram;
+	const size_t buffers_size = ram->length - LPC43x0_SPIFI_STUB_BUFFER_OFFSET;
+	const size_t chunk_pages = MIN(LPC43x0_SPIFI_STUB_CHUNK_PAGES, buffers_size / (2U * flash->page_size));
+	const size_t chunk_size = chunk_pages * flash->page_size;
+	const lpc43x0_spifi_stub_params_s params = {
+		.page_size = flash->page_size,
+		.write_enable_cmd = lpc43x0_spifi_command(SPI_FLASH_CMD_WRITE_ENABLE, 0U),
+		.page_program_cmd = lpc43x0_spifi_command(flash->page_program_command, 0U),
+		.read_status_cmd = lpc43x0_spifi_command(SPI_FLASH_CMD_READ_STATUS, 1U),
+	};
+	const lpc43x0_spifi_stub_mailbox_s mailbox = {0};
+
+	const target_addr32_t stub_base = ram->start;
+	const target_addr32_t params_base = stub_base + LPC43x0_SPIFI_STUB_PARAMS_OFFSET;
+	const target_addr32_t buffer_base = stub_base + LPC43x0_SPIFI_STUB_BUFFER_OFFSET;
+	target_mem32_write(target, stub_base, lpc43x0_spifi_write_stub, sizeof(lpc43x0_spifi_write_stub));
+	target_mem32_write(target, params_base, &params, sizeof(params));
+	target_mem32_write(target, LPC43x0_SPIFI_STUB_MAILBOX(target, doorbell), &mailbox, sizeof(mailbox));
+	/* The stub expects the controller to be ready to take commands */
+	lpc43x0_spifi_command_mode(target);
+	if (target_check_error(target) ||
+		!cortexm_start_stub(target, stub_base, params_base, LPC43x0_SPIFI_STUB_MAILBOX(target, doorbell), 0U, 0U))
+		return false;
+
+	const uint8_t *const data = (const uint8_t *)buffer;
+	uint32_t sequence = 0U;
+	bool result = true;
+	for (size_t offset = 0U; result && offset < length; offset += chunk_size) {
+		/* Load the chunk into the free buffer while the stub may still be programming the last one */
+		const size_t amount = MIN(length - offset, chunk_size);
+		const target_addr32_t chunk_base = buffer_base + ((sequence & 1U) * chunk_size);
+		target_mem32_write(target, chunk_base, data + offset, amount);
+		result = !target_check_error(target) && lpc43x0_spifi_stub_wait(target, sequence);
+		if (!result)
+			break;
+
+		/* Then hand it over, ringing the doorbell only once the rest of the command is in place */
+		const uint32_t command[3] = {address + offset, chunk_base, (uint32_t)amount};
+		target_mem32_write(target, LPC43x0_SPIFI_STUB_MAILBOX(target, dest), command, sizeof(command));
+		target_mem32_write32(target, LPC43x0_SPIFI_STUB_MAILBOX(target, doorbell), ++sequence);
+	}
+
+	/* Collect the last chunk, then tell the stub to exit - unless it hung, in which case it's been halted */
+	if (result && lpc43x0_spifi_stub_wait(target, sequence)) {
+		target_mem32_write32(target, LPC43x0_SPIFI_STUB_MAILBOX(target, size), 0U);
+		target_mem32_write32(target, LPC43x0_SPIFI_STUB_MAILBOX(target, doorbell), ++sequence);
+		result = cortexm_wait_stub(target, LPC43x0_SPIFI_STUB_TIMEOUT) == 0;
+	} else
+		result = false;
+	lpc43x0_spifi_command_mode(target);
+	lpc43x0_spifi_memory_mode(target);
+	return result;
+}
+
 /* LPC43xx IAP On-board Flash part routines */
 
 static bool lpc43xx_iap_init(target_flash_s *const target_flash)
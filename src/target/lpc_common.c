@@ -41,6 +41,54 @@ typedef struct BMD_ALIGN_DECL(4) iap_frame {
 	iap_result_s result;
 } iap_frame_s;
 
+/* Maximum number of IAP calls that can be queued into a single batch */
+#define LPC_IAP_BATCH_MAX 3U
+
+typedef struct iap_batch_entry {
+	iap_config_s config;
+	iap_result_s result;
+} iap_batch_entry_s;
+
+typedef struct BMD_ALIGN_DECL(4) iap_batch_frame {
+	/* The batch runner stub, padded out to keep the command table word aligned */
+	uint16_t code[12];
+	iap_batch_entry_s entries[LPC_IAP_BATCH_MAX];
+} iap_batch_frame_s;
+
+/*
+ * Batch runner - calls the IAP ROM once for each entry in the command table, stopping at the first failure.
+ * r4 = command table, r5 = number of entries, r6 = IAP entrypoint (thumb bit set)
+ *
+ * loop:
+ *   movs r0, r4
+ *   movs r1, r4
+ *   adds r1, #20
+ *   blx r6
+ *   ldr r0, [r4, #20]
+ *   cmp r0, #0
+ *   bne done
+ *   adds r4, #40
+ *   subs r5, #1
+ *   bne loop
+ * done:
+ *   bkpt #0
+ */
+static const uint16_t lpc_iap_batch_stub[] = {
+	0x0020U,
+	0x0021U,
+	0x3114U,
+	0x47b0U,
+	0x6960U,
+	0x2800U,
+	0xd102U,
+	0x3428U,
+	0x3d01U,
+	0xd1f5U,
+	CORTEX_THUMB_BREAKPOINT,
+};
+
+#define LPC_IAP_BATCH_BKPT_OFFSET ((ARRAY_LENGTH(lpc_iap_batch_stub) - 1U) * sizeof(uint16_t))
+
 #if ENABLE_DEBUG == 1
 static const char *const iap_error[] = {
 	"CMD_SUCCESS",
@@ -273,6 +321,106 @@ iap_status_e lpc_iap_call(lpc_flash_s *const flash, iap_result_s *const result,
 	return results.return_code;
 }
 
+/*
+ * Run a sequence of IAP calls with a single halt/resume cycle, returning the status of the
+ * first call that did not succeed (or IAP_STATUS_CMD_SUCCESS if they all did)
+ */
+static iap_status_e lpc_iap_batch(lpc_flash_s *const flash, const iap_config_s *const calls, const size_t count)
+{
+	/* The batch runner is Thumb code, so if the ROM isn't, fall back to running the calls one at a time */
+	if (!(flash->iap_entry & 1U)) {
+		for (size_t i = 0; i < count; ++i) {
+			const iap_status_e status = lpc_iap_call(flash, NULL, calls[i].command, calls[i].params[0],
+				calls[i].params[1], calls[i].params[2], calls[i].params[3]);
+			if (status != IAP_STATUS_CMD_SUCCESS)
+				return status;
+		}
+		return IAP_STATUS_CMD_SUCCESS;
+	}
+
+	target_s *const target = flash->f.t;
+	if (flash->wdt_kick)
+		flash->wdt_kick(target);
+
+	/* Save IAP RAM and target registers to restore after the batch has run */
+	iap_batch_frame_s saved_frame;
+	uint32_t saved_regs[CORTEXM_GENERAL_REG_COUNT + CORTEX_FLOAT_REG_COUNT];
+	target_mem32_read(target, &saved_frame, flash->iap_ram, sizeof(iap_batch_frame_s));
+	target_regs_read(target, saved_regs);
+
+	/* Build the command table, setting each result code to something notable so we can tell which calls ran */
+	iap_batch_frame_s frame = {{0}};
+	memcpy(frame.code, lpc_iap_batch_stub, sizeof(lpc_iap_batch_stub));
+	bool full_erase = false;
+	for (size_t i = 0; i < count; ++i) {
+		frame.entries[i].config = calls[i];
+		frame.entries[i].result.return_code = calls[i].command;
+		if (calls[i].command == IAP_CMD_ERASE && lpc_is_full_erase(flash, calls[i].params[0], calls[i].params[1]))
+			full_erase = true;
+		DEBUG_INFO("%s: cmd %" PRIu32 ", params: %08" PRIx32 " %08" PRIx32 " %08" PRIx32 " %08" PRIx32 "\n", __func__,
+			calls[i].command, calls[i].params[0], calls[i].params[1], calls[i].params[2], calls[i].params[3]);
+	}
+	target_mem32_write(target, flash->iap_ram, &frame, sizeof(iap_batch_frame_s));
+
+	uint32_t regs[CORTEXM_GENERAL_REG_COUNT + CORTEX_FLOAT_REG_COUNT];
+	memset(regs, 0, target->regs_size);
+	regs[4] = flash->iap_ram + offsetof(iap_batch_frame_s, entries);
+	regs[5] = count;
+	regs[6] = flash->iap_entry;
+	regs[CORTEX_REG_MSP] = flash->iap_msp;
+	/* Should the ROM somehow return from the stub frame, land on the stub's breakpoint */
+	regs[CORTEX_REG_LR] = (flash->iap_ram + LPC_IAP_BATCH_BKPT_OFFSET) | 1U;
+	regs[CORTEX_REG_PC] = flash->iap_ram | 1U;
+	regs[CORTEX_REG_XPSR] = CORTEXM_XPSR_THUMB;
+	target_regs_write(target, regs);
+
+	platform_timeout_s timeout;
+	platform_timeout_set(&timeout, 500);
+	target_halt_resume(target, false);
+	while (!target_halt_poll(target, NULL)) {
+		if (full_erase)
+			target_print_progress(&timeout);
+	}
+
+	/* Check if a fault occurred while executing the batch */
+	uint32_t status = 0;
+	target_reg_read(target, CORTEX_REG_XPSR, &status, sizeof(status));
+	if (status & CORTEXM_XPSR_EXCEPTION_MASK) {
+		uint32_t fault_address = 0;
+		target_reg_read(target, CORTEX_REG_PC, &fault_address, sizeof(fault_address));
+		if (status & CORTEXM_XPSR_THUMB)
+			fault_address |= 1U;
+
+		if (fault_address != ((flash->iap_ram + LPC_IAP_BATCH_BKPT_OFFSET) | 1U)) {
+			DEBUG_WARN("%s: Failure due to fault (%" PRIu32 ")\n", __func__, status & CORTEXM_XPSR_EXCEPTION_MASK);
+			DEBUG_WARN("\t-> Fault at %08" PRIx32 "\n", fault_address);
+			target_mem32_write(target, flash->iap_ram, &saved_frame, sizeof(iap_batch_frame_s));
+			target_regs_write(target, saved_regs);
+			return IAP_STATUS_INVALID_COMMAND;
+		}
+	}
+
+	/* Copy back the command table to get at the results, then restore the original RAM and registers */
+	target_mem32_read(target, frame.entries, flash->iap_ram + offsetof(iap_batch_frame_s, entries),
+		sizeof(iap_batch_entry_s) * count);
+	target_mem32_write(target, flash->iap_ram, &saved_frame, sizeof(iap_batch_frame_s));
+	target_regs_write(target, saved_regs);
+
+	for (size_t i = 0; i < count; ++i) {
+		const uint32_t return_code = frame.entries[i].result.return_code;
+		if (return_code == IAP_STATUS_CMD_SUCCESS)
+			continue;
+#if ENABLE_DEBUG == 1
+		if (return_code < ARRAY_LENGTH(iap_error))
+			DEBUG_INFO("%s: cmd %" PRIu32 " result %s\n", __func__, calls[i].command, iap_error[return_code]);
+		else
+			DEBUG_INFO("%s: cmd %" PRIu32 " result %" PRIu32 "\n", __func__, calls[i].command, return_code);
+#endif
+		return return_code;
+	}
+	return IAP_STATUS_CMD_SUCCESS;
+}
+
 #define LPX80X_SECTOR_SIZE 0x400U
 #define LPX80X_PAGE_SIZE   0x40U
 
@@ -283,35 +431,30 @@ bool lpc_flash_erase(target_flash_s *tf, target_addr_t addr, size_t len)
 	const uint32_t end = lpc_sector_for_addr(f, addr + len - 1U);
 	uint32_t last_full_sector = end;
 
-	if (lpc_iap_call(f, NULL, IAP_CMD_PREPARE, start, end, f->bank) != IAP_STATUS_CMD_SUCCESS)
-		return false;
-
 	/* Only LPC80x has reserved pages!*/
 	if (f->reserved_pages && addr + len >= tf->length - 0x400U)
 		--last_full_sector;
 
-	if (start <= last_full_sector) {
-		/* Sector erase */
-		if (lpc_iap_call(f, NULL, IAP_CMD_ERASE, start, last_full_sector, CPU_CLK_KHZ, f->bank) !=
-			IAP_STATUS_CMD_SUCCESS)
-			return false;
-
-		/* Check erase ok */
-		if (lpc_iap_call(f, NULL, IAP_CMD_BLANKCHECK, start, last_full_sector, f->bank) != IAP_STATUS_CMD_SUCCESS)
-			return false;
-	}
+	/* Prepare, then sector erase and check the erase was ok */
+	const iap_config_s calls[LPC_IAP_BATCH_MAX] = {
+		{IAP_CMD_PREPARE, {start, end, f->bank}},
+		{IAP_CMD_ERASE, {start, last_full_sector, CPU_CLK_KHZ, f->bank}},
+		{IAP_CMD_BLANKCHECK, {start, last_full_sector, f->bank}},
+	};
+	if (lpc_iap_batch(f, calls, start <= last_full_sector ? 3U : 1U) != IAP_STATUS_CMD_SUCCESS)
+		return false;
 
 	if (last_full_sector != end) {
 		const uint32_t page_start = (addr + len - LPX80X_SECTOR_SIZE) / LPX80X_PAGE_SIZE;
 		const uint32_t page_end = page_start + LPX80X_SECTOR_SIZE / LPX80X_PAGE_SIZE - 1U - f->reserved_pages;
 
-		if (lpc_iap_call(f, NULL, IAP_CMD_PREPARE, end, end, f->bank) != IAP_STATUS_CMD_SUCCESS)
-			return false;
-
-		if (lpc_iap_call(f, NULL, IAP_CMD_ERASE_PAGE, page_start, page_end, CPU_CLK_KHZ, f->bank) !=
-			IAP_STATUS_CMD_SUCCESS)
-			return false;
 		/* Blank check omitted!*/
+		const iap_config_s page_calls[] = {
+			{IAP_CMD_PREPARE, {end, end, f->bank}},
+			{IAP_CMD_ERASE_PAGE, {page_start, page_end, CPU_CLK_KHZ, f->bank}},
+		};
+		if (lpc_iap_batch(f, page_calls, ARRAY_LENGTH(page_calls)) != IAP_STATUS_CMD_SUCCESS)
+			return false;
 	}
 	return true;
 }
@@ -319,36 +462,34 @@ bool lpc_flash_erase(target_flash_s *tf, target_addr_t addr, size_t len)
 static bool lpc_flash_write(target_flash_s *tf, target_addr_t dest, const void *src, size_t len)
 {
 	lpc_flash_s *f = (lpc_flash_s *)tf;
-	/* Prepare... */
 	const uint32_t sector = lpc_sector_for_addr(f, dest);
-	if (lpc_iap_call(f, NULL, IAP_CMD_PREPARE, sector, sector, f->bank) != IAP_STATUS_CMD_SUCCESS) {
-		DEBUG_ERROR("Prepare failed\n");
-		return false;
-	}
-	const uint32_t bufaddr = ALIGN(f->iap_ram + sizeof(iap_frame_s), 4U);
+	const uint32_t bufaddr = ALIGN(f->iap_ram + sizeof(iap_batch_frame_s), 4U);
 	target_mem32_write(f->f.t, bufaddr, src, len);
 	/* Only LPC80x has reserved pages!*/
 	if (!f->reserved_pages || dest + len <= tf->length - len) {
-		/*
-		 * Write payload to target ram,
-		 * set the destination address and program
-		 */
-		if (lpc_iap_call(f, NULL, IAP_CMD_PROGRAM, dest, bufaddr, len, CPU_CLK_KHZ) != IAP_STATUS_CMD_SUCCESS)
+		/* Prepare the sector and program the payload from target RAM in one go */
+		const iap_config_s calls[] = {
+			{IAP_CMD_PREPARE, {sector, sector, f->bank}},
+			{IAP_CMD_PROGRAM, {dest, bufaddr, len, CPU_CLK_KHZ}},
+		};
+		if (lpc_iap_batch(f, calls, ARRAY_LENGTH(calls)) != IAP_STATUS_CMD_SUCCESS) {
+			DEBUG_ERROR("Write failed\n");
 			return false;
+		}
 	} else {
 		/*
 		 * On LPC80x, write top sector in pages.
 		 * Silently ignore write to the 2 reserved pages at top!
 		 */
 		for (size_t offset = 0; offset < len - (0x40U * (size_t)f->reserved_pages); offset += LPX80X_PAGE_SIZE) {
-			if (lpc_iap_call(f, NULL, IAP_CMD_PREPARE, sector, sector, f->bank) != IAP_STATUS_CMD_SUCCESS) {
-				DEBUG_ERROR("Prepare failed\n");
+			const iap_config_s calls[] = {
+				{IAP_CMD_PREPARE, {sector, sector, f->bank}},
+				{IAP_CMD_PROGRAM, {dest + offset, bufaddr + offset, LPX80X_PAGE_SIZE, CPU_CLK_KHZ}},
+			};
+			if (lpc_iap_batch(f, calls, ARRAY_LENGTH(calls)) != IAP_STATUS_CMD_SUCCESS) {
+				DEBUG_ERROR("Write failed\n");
 				return false;
 			}
-			/* Set the destination address and program */
-			if (lpc_iap_call(f, NULL, IAP_CMD_PROGRAM, dest + offset, bufaddr + offset, LPX80X_PAGE_SIZE,
-					CPU_CLK_KHZ) != IAP_STATUS_CMD_SUCCESS)
-				return false;
 		}
 	}
 	return true;
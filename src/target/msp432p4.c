@@ -38,6 +38,7 @@
 #include "target.h"
 #include "target_internal.h"
 #include "cortex.h"
+#include "cortexm.h"
 
 /* TLV: Device info tag, address and expected value */
 #define DEVINFO_TAG_ADDR  0x00201004U
@@ -94,7 +95,11 @@
 #define SRAM_STACK_OFFSET   0x00000200U /* A bit less than 512 stack room */
 #define SRAM_STACK_PTR      (SRAM_BASE + SRAM_STACK_OFFSET)
 #define SRAM_WRITE_BUFFER   SRAM_STACK_PTR /* Buffer right above stack */
-#define SRAM_WRITE_BUF_SIZE 0x00000400U    /* Write 1024 bytes at a tima */
+#define SRAM_WRITE_BUF_SIZE SECTOR_SIZE    /* Write a whole sector at a time */
+#define SRAM_BATCH_BASE     (SRAM_WRITE_BUFFER + SRAM_WRITE_BUF_SIZE) /* ROM call batch frame above that */
+
+/* Maximum number of ROM calls that can be run in a single batch, and so sectors erased in one go */
+#define MSP432_ROM_BATCH_MAX 8U
 
 /* Watchdog */
 #define WDT_A_WTDCTL 0x4000480cU /* Control register for watchdog */
@@ -108,22 +113,67 @@ typedef struct msp432_flash {
 	target_addr_t flash_program_fn;       /* Flash programming routine in ROM */
 } msp432_flash_s;
 
+/* A call to a function in the MSP432 ROM (or anywhere else...) and the arguments to give it in r0-r2 */
+typedef struct msp432_rom_call {
+	uint32_t function;
+	uint32_t args[3];
+} msp432_rom_call_s;
+
+typedef struct BMD_ALIGN_DECL(4) msp432_rom_batch_frame {
+	/* The batch runner stub, padded out to keep the call table word aligned */
+	uint16_t code[12];
+	msp432_rom_call_s calls[MSP432_ROM_BATCH_MAX];
+} msp432_rom_batch_frame_s;
+
+/*
+ * Batch runner - makes each call in the call table in turn, stopping at the first one to return false.
+ * r4 = call table, r5 = number of calls, which is left as the number not completed
+ *
+ * loop:
+ *   ldr r0, [r4, #4]
+ *   ldr r1, [r4, #8]
+ *   ldr r2, [r4, #12]
+ *   ldr r3, [r4, #0]
+ *   blx r3
+ *   cmp r0, #0
+ *   beq done
+ *   adds r4, #16
+ *   subs r5, #1
+ *   bne loop
+ * done:
+ *   bkpt #0
+ */
+static const uint16_t msp432_rom_batch_stub[] = {
+	0x6860U,
+	0x68a1U,
+	0x68e2U,
+	0x6823U,
+	0x4798U,
+	0x2800U,
+	0xd002U,
+	0x3410U,
+	0x3d01U,
+	0xd1f5U,
+	CORTEX_THUMB_BREAKPOINT,
+};
+
 static bool msp432_sector_erase(target_flash_s *f, target_addr_t addr);
 static bool msp432_flash_erase(target_flash_s *f, target_addr_t addr, size_t len);
 static bool msp432_flash_write(target_flash_s *f, target_addr_t dest, const void *src, size_t len);
 
-/* Call a function in the MSP432 ROM (or anywhere else...)*/
-static void msp432_call_rom(target_s *t, uint32_t address, uint32_t *regs);
+/* Make a batch of calls into the MSP432 ROM with a single resume of the target */
+static bool msp432_call_rom_batch(target_s *t, const msp432_rom_call_s *calls, size_t count);
 
-/* Protect or unprotect the sector containing address */
-static inline uint32_t msp432_sector_unprotect(msp432_flash_s *mf, target_addr_t addr)
+/* Unprotect the sectors covering len bytes from addr, returning the old protection to restore after */
+static inline uint32_t msp432_sectors_unprotect(msp432_flash_s *mf, target_addr_t addr, size_t len)
 {
 	/* Read the old protection register */
 	uint32_t old_mask = target_mem32_read32(mf->f.t, mf->flash_protect_register);
-	/* Find the bit representing the sector and set it to 0  */
-	uint32_t sec_mask = ~(1U << ((addr - mf->f.start) / SECTOR_SIZE));
-	/* Clear the potection bit */
-	sec_mask &= old_mask;
+	/* Find the bits representing the sectors and set them to 0  */
+	uint32_t sec_mask = old_mask;
+	for (size_t offset = 0; offset < len; offset += SECTOR_SIZE)
+		sec_mask &= ~(1U << ((addr + offset - mf->f.start) / SECTOR_SIZE));
+	/* Clear the potection bits */
 	target_mem32_write32(mf->f.t, mf->flash_protect_register, sec_mask);
 	return old_mask;
 }
@@ -154,6 +204,7 @@ static void msp432_add_flash(target_s *t, uint32_t addr, size_t length, target_a
 	f->start = addr;
 	f->length = length;
 	f->blocksize = SECTOR_SIZE;
+	f->erase_span = SECTOR_SIZE * MSP432_ROM_BATCH_MAX;
 	f->erase = msp432_flash_erase;
 	f->write = msp432_flash_write;
 	f->writesize = SRAM_WRITE_BUF_SIZE;
@@ -224,50 +275,50 @@ bool msp432p4_probe(target_s *t)
 }
 
 /* Flash operations */
-/* Erase a single sector at addr calling the ROM routine*/
-static bool msp432_sector_erase(target_flash_s *f, target_addr_t addr)
+/* Erase the sectors covering len bytes from addr calling the ROM routine, in batches */
+static bool msp432_sectors_erase(target_flash_s *f, target_addr_t addr, size_t len)
 {
 	target_s *t = f->t;
 	msp432_flash_s *mf = (msp432_flash_s *)f;
 
-	/* Unprotect sector */
-	uint32_t old_prot = msp432_sector_unprotect(mf, addr);
-	DEBUG_WARN("Flash protect: 0x%08" PRIX32 "\n", target_mem32_read32(t, mf->flash_protect_register));
-
-	/* Prepare input data */
-	uint32_t regs[CORTEXM_GENERAL_REG_COUNT + CORTEX_FLOAT_REG_COUNT];
-	target_regs_read(t, regs);
-	regs[0] = addr; // Address of sector to erase in R0
-
-	DEBUG_INFO("Erasing sector at 0x%08" PRIX32 "\n", addr);
-
-	/* Call ROM */
-	msp432_call_rom(t, mf->flash_erase_sector_fn, regs);
-
-	// Result value in R0 is true for success
-	DEBUG_INFO("ROM return value: %" PRIu32 "\n", regs[0]);
+	bool ret = true;
+	while (len && ret) {
+		/* Prepare input data */
+		msp432_rom_call_s calls[MSP432_ROM_BATCH_MAX] = {{0}};
+		size_t count = 0;
+		for (; count < MSP432_ROM_BATCH_MAX && count * SECTOR_SIZE < len; ++count) {
+			calls[count].function = mf->flash_erase_sector_fn;
+			calls[count].args[0] = addr + (count * SECTOR_SIZE); // Address of sector to erase in R0
+		}
+		const size_t amount = MIN(len, count * SECTOR_SIZE);
+
+		/* Unprotect the sectors */
+		uint32_t old_prot = msp432_sectors_unprotect(mf, addr, amount);
+		DEBUG_WARN("Flash protect: 0x%08" PRIX32 "\n", target_mem32_read32(t, mf->flash_protect_register));
+
+		DEBUG_INFO("Erasing %zu sectors at 0x%08" PRIX32 "\n", count, addr);
+		/* Call ROM */
+		ret = msp432_call_rom_batch(t, calls, count);
+
+		/* Restore original protection */
+		target_mem32_write32(t, mf->flash_protect_register, old_prot);
+
+		addr += amount;
+		len -= amount;
+	}
+	return ret;
+}
 
-	/* Restore original protection */
-	target_mem32_write32(t, mf->flash_protect_register, old_prot);
-	return regs[0] != 0;
+/* Erase a single sector at addr calling the ROM routine*/
+static bool msp432_sector_erase(target_flash_s *f, target_addr_t addr)
+{
+	return msp432_sectors_erase(f, addr, SECTOR_SIZE);
 }
 
 /* Erase from addr for len bytes */
 static bool msp432_flash_erase(target_flash_s *f, target_addr_t addr, size_t len)
 {
-	bool ret = true;
-	while (len) {
-		ret &= msp432_sector_erase(f, addr);
-
-		/* update len and addr */
-		len -= f->blocksize;
-		if (len > f->blocksize)
-			len -= f->blocksize;
-		else
-			len = 0;
-	}
-
-	return ret;
+	return msp432_sectors_erase(f, addr, len);
 }
 
 /* Program flash */
@@ -279,29 +330,25 @@ static bool msp432_flash_write(target_flash_s *f, target_addr_t dest, const void
 	/* Prepare RAM buffer in target */
 	target_mem32_write(t, SRAM_WRITE_BUFFER, src, len);
 
-	/* Unprotect sector, len is always < SECTOR_SIZE */
-	uint32_t old_prot = msp432_sector_unprotect(mf, dest);
+	/* Unprotect sector, len is always <= SECTOR_SIZE */
+	uint32_t old_prot = msp432_sectors_unprotect(mf, dest, len);
 
 	DEBUG_WARN("Flash protect: 0x%08" PRIX32 "\n", target_mem32_read32(t, mf->flash_protect_register));
 
 	/* Prepare input data */
-	uint32_t *regs = alloca(t->regs_size / sizeof(uint32_t)); // Use of VLA
-	target_regs_read(t, regs);
-	regs[0] = SRAM_WRITE_BUFFER; // Address of buffer to be flashed in R0
-	regs[1] = dest;              // Flash address to be write to in R1
-	regs[2] = len;               // Size of buffer to be flashed in R2
+	const msp432_rom_call_s call = {
+		.function = mf->flash_program_fn,
+		/* Address of buffer to be flashed, Flash address to be write to, and size of buffer to be flashed */
+		.args = {SRAM_WRITE_BUFFER, dest, len},
+	};
 
-	DEBUG_INFO("Writing 0x%04" PRIX32 " bytes at 0x%08zu\n", dest, len);
+	DEBUG_INFO("Writing 0x%04zx bytes at 0x%08" PRIX32 "\n", len, dest);
 	/* Call ROM */
-	msp432_call_rom(t, mf->flash_program_fn, regs);
+	const bool ret = msp432_call_rom_batch(t, &call, 1U);
 
 	/* Restore original protection */
 	target_mem32_write32(t, mf->flash_protect_register, old_prot);
-
-	DEBUG_INFO("ROM return value: %" PRIu32 "\n", regs[0]);
-
-	// Result value in R0 is true for success
-	return regs[0] != 0;
+	return ret;
 }
 
 /* Optional commands handlers */
@@ -345,25 +392,35 @@ static bool msp432_cmd_sector_erase(target_s *t, int argc, const char **argv)
 }
 
 /* MSP432 ROM routine invocation */
-static void msp432_call_rom(target_s *t, uint32_t address, uint32_t *regs)
+static bool msp432_call_rom_batch(target_s *t, const msp432_rom_call_s *calls, size_t count)
 {
 	/* Kill watchdog */
 	target_mem32_write16(t, WDT_A_WTDCTL, WDT_A_HOLD);
 
-	/* Breakpoint at the beginning of CODE SRAM alias area */
-	target_mem32_write16(t, SRAM_CODE_BASE, CORTEX_THUMB_BREAKPOINT);
+	/* Load the batch runner and its call table into SRAM */
+	msp432_rom_batch_frame_s frame = {{0}};
+	memcpy(frame.code, msp432_rom_batch_stub, sizeof(msp432_rom_batch_stub));
+	memcpy(frame.calls, calls, count * sizeof(*calls));
+	target_mem32_write(t, SRAM_BATCH_BASE, &frame, sizeof(frame));
 
 	/* Prepare registers */
-	regs[CORTEX_REG_MSP] = SRAM_STACK_PTR;     /* Stack space */
-	regs[CORTEX_REG_LR] = SRAM_CODE_BASE | 1U; /* Return to beginning of SRAM CODE alias */
-	regs[CORTEX_REG_PC] = address;             /* Start at given address */
+	uint32_t regs[CORTEXM_GENERAL_REG_COUNT + CORTEX_FLOAT_REG_COUNT];
+	target_regs_read(t, regs);
+	regs[4] = SRAM_BATCH_BASE + offsetof(msp432_rom_batch_frame_s, calls);
+	regs[5] = count;
+	regs[CORTEX_REG_MSP] = SRAM_STACK_PTR; /* Stack space */
+	/* Run the stub from the SRAM CODE alias */
+	regs[CORTEX_REG_PC] = SRAM_CODE_BASE + (SRAM_BATCH_BASE - SRAM_BASE);
+	regs[CORTEX_REG_XPSR] = CORTEXM_XPSR_THUMB;
 	target_regs_write(t, regs);
 
-	/* Start the target and wait for it to halt again, which calls the routine setup above */
+	/* Start the target and wait for it to halt again, which runs all the calls set up above */
 	target_halt_resume(t, false);
 	while (!target_halt_poll(t, NULL))
 		continue;
 
-	// Read registers to get result
+	// Read registers to get result, the count of calls left is 0 when they all returned true
 	target_regs_read(t, regs);
+	DEBUG_INFO("ROM return value: %" PRIu32 ", %" PRIu32 " calls not completed\n", regs[0], regs[5]);
+	return regs[5] == 0U;
 }
@@ -29,6 +29,7 @@
 
 static bool nrf51_flash_erase(target_flash_s *f, target_addr_t addr, size_t len);
 static bool nrf51_flash_write(target_flash_s *f, target_addr_t dest, const void *src, size_t len);
+static bool nrf51_flash_write_wait(target_flash_s *f);
 static bool nrf51_flash_prepare(target_flash_s *f);
 static bool nrf51_flash_done(target_flash_s *f);
 static bool nrf51_mass_erase(target_s *t, platform_timeout_s *print_progess);
@@ -63,6 +64,7 @@ const command_s nrf51_read_cmd_list[] = {
 /* Non-Volatile Memory Controller (NVMC) Registers */
 #define NRF51_NVMC           0x4001e000U
 #define NRF51_NVMC_READY     (NRF51_NVMC + 0x400U)
+#define NRF51_NVMC_READYNEXT (NRF51_NVMC + 0x408U) /* nRF52820/833/840 only */
 #define NRF51_NVMC_CONFIG    (NRF51_NVMC + 0x504U)
 #define NRF51_NVMC_ERASEPAGE (NRF51_NVMC + 0x508U)
 #define NRF51_NVMC_ERASEALL  (NRF51_NVMC + 0x50cU)
@@ -100,6 +102,9 @@ const command_s nrf51_read_cmd_list[] = {
 /* Flash R/W Protection Register */
 #define NRF51_APPROTECT 0x10001208U
 
+/* The NVMC can accept a write while still completing the previous one (has READYNEXT) */
+#define NRF52_TOPT_READYNEXT (1U << 8U)
+
 #define NRF51_PAGE_SIZE 1024U
 #define NRF52_PAGE_SIZE 4096U
 
@@ -118,6 +123,7 @@ static void nrf51_add_flash(target_s *t, uint32_t addr, size_t length, size_t er
 	f->writesize = MIN(erasesize, 1024U);
 	f->erase = nrf51_flash_erase;
 	f->write = nrf51_flash_write;
+	f->write_wait = nrf51_flash_write_wait;
 	f->prepare = nrf51_flash_prepare;
 	f->done = nrf51_flash_done;
 	f->erased = 0xff;
@@ -144,6 +150,8 @@ bool nrf51_probe(target_s *t)
 		uint32_t ram_size = target_mem32_read32(t, NRF52_INFO_RAM);
 		t->driver = "nRF52";
 		t->target_options |= TOPT_INHIBIT_NRST;
+		if (info_part == 0x52820U || info_part == 0x52833U || info_part == 0x52840U)
+			t->target_options |= NRF52_TOPT_READYNEXT;
 		target_add_ram32(t, 0x20000000U, ram_size * 1024U);
 		nrf51_add_flash(t, 0, page_size * code_size, page_size);
 		nrf51_add_flash(t, NRF51_UICR, page_size, page_size);
@@ -226,10 +234,27 @@ static bool nrf51_flash_erase(target_flash_s *f, target_addr_t addr, size_t len)
 
 static bool nrf51_flash_write(target_flash_s *f, target_addr_t dest, const void *src, size_t len)
 {
-	/* nrf51_flash_prepare() and nrf51_flash_done() top-and-tail this, just write the data to the target. */
+	/*
+	 * nrf51_flash_prepare() and nrf51_flash_done() top-and-tail this, just stream the data to the target.
+	 * The NVMC stalls the bus while each word programs, and the final one is waited on in
+	 * nrf51_flash_write_wait() so the next block can be received meanwhile.
+	 */
 	target_s *t = f->t;
 	target_mem32_write(t, dest, src, len);
-	return nrf51_wait_ready(t, NULL);
+	return !target_check_error(t);
+}
+
+static bool nrf51_flash_write_wait(target_flash_s *const f)
+{
+	target_s *const t = f->t;
+	/* Parts with READYNEXT can take the next block while the last word is still programming */
+	if (!(t->target_options & NRF52_TOPT_READYNEXT))
+		return nrf51_wait_ready(t, NULL);
+	while (target_mem32_read32(t, NRF51_NVMC_READYNEXT) == 0) {
+		if (target_check_error(t))
+			return false;
+	}
+	return true;
 }
 
 static bool nrf51_mass_erase(target_s *const t, platform_timeout_s *const print_progess)
@@ -189,13 +189,7 @@ static bool puya_flash_done(target_flash_s *flash)
 
 static bool puya_wait_flash(target_s *const target, platform_timeout_s *const timeout)
 {
-	while (target_mem32_read32(target, PUYA_FLASH_SR) & PUYA_FLASH_SR_BSY) {
-		if (target_check_error(target))
-			return false;
-		if (timeout)
-			target_print_progress(timeout);
-	}
-	return true;
+	return target_mem32_poll32(target, PUYA_FLASH_SR, PUYA_FLASH_SR_BSY, 0U, 0U, timeout, NULL);
 }
 
 static bool puya_check_flash_no_error(target_s *const target)
@@ -63,6 +63,20 @@
 #define RV32_MATCH_BEFORE 0x00000000U
 #define RV32_MATCH_AFTER  0x00040000U
 
+/*
+ * The program buffer memory copier keeps the address in s0 and the data in s1, running either
+ * "lX s1, 0(s0)" or "sX s1, 0(s0)" followed by "addi s0, s0, access_length" with each execution
+ */
+#define RV32_GPR_S0                (RV_GPR_BASE + 8U)
+#define RV32_GPR_S1                (RV_GPR_BASE + 9U)
+#define RV32_LOAD_S1_S0(width)     (0x00040483U | ((uint32_t)(width) << 12U))
+#define RV32_STORE_S1_S0(width)    (0x00940023U | ((uint32_t)(width) << 12U))
+#define RV32_ADDI_S0_S0(imm)       (0x00040413U | ((uint32_t)(imm) << 20U))
+#define RV32_PROGBUF_COPIER_LENGTH 3U
+
+/* Number of data0 values to batch into each pipelined run of DMI accesses while auto-execution streams */
+#define RV32_STREAM_CHUNK 32U
+
 static size_t riscv32_reg_read(target_s *target, uint32_t reg, void *data, size_t max);
 static size_t riscv32_reg_write(target_s *target, uint32_t reg, const void *data, size_t max);
 static void riscv32_regs_read(target_s *target, void *data);
@@ -224,6 +238,218 @@ uint32_t riscv32_pack_data(const void *const src, const uint8_t access_width)
 	return 0;
 }
 
+/*
+ * Run an abstract memory access command. If the hart turns out not to support aampostincrement, this
+ * remembers that and re-runs the command without it - the caller must then write arg1 for each access
+ */
+bool riscv32_abstract_mem_command(riscv_hart_s *const hart, uint32_t *const command)
+{
+	if (!riscv_dm_write(hart->dbg_module, RV_DM_ABST_COMMAND, *command))
+		return false;
+	if (riscv_command_wait_complete(hart))
+		return true;
+	if (hart->status != RISCV_HART_NOT_SUPP || !(*command & RV_ABST_MEM_ADDR_POST_INC))
+		return false;
+	DEBUG_TARGET("Hart does not support abstract memory access post-increment\n");
+	hart->flags |= RV_HART_FLAG_NO_POST_INC;
+	*command &= ~RV_ABST_MEM_ADDR_POST_INC;
+	return riscv_dm_write(hart->dbg_module, RV_DM_ABST_COMMAND, *command) && riscv_command_wait_complete(hart);
+}
+
+/* Build the abstract memory access command for a transfer, asking for post-increment if it's useful and allowed */
+uint32_t riscv32_abstract_mem_access(const riscv_hart_s *const hart, const uint32_t direction,
+	const uint8_t access_width, const size_t access_length, const size_t len)
+{
+	uint32_t command = RV_DM_ABST_CMD_ACCESS_MEM | direction | (access_width << RV_ABST_MEM_ACCESS_SHIFT);
+	if (access_length < len && !(hart->flags & RV_HART_FLAG_NO_POST_INC))
+		command |= RV_ABST_MEM_ADDR_POST_INC;
+	return command;
+}
+
+/* Check a run of auto-executed accesses, giving up on auto-execution if the DM couldn't keep up with it */
+bool riscv32_abstract_stream_complete(riscv_hart_s *const hart)
+{
+	if (riscv_command_wait_complete(hart))
+		return true;
+	if (hart->status == RISCV_HART_BUSY) {
+		DEBUG_WARN("Abstract command auto-execution outran the hart, disabling it\n");
+		hart->flags &= (uint16_t)~RV_HART_FLAG_ABST_AUTOEXEC;
+	}
+	return false;
+}
+
+/* Stream count values of the given access width out of a DM data register, handing them to the DMI in batches */
+bool riscv32_stream_read(riscv_hart_s *const hart, const uint8_t reg, uint8_t *const data, const size_t count,
+	const uint8_t access_width)
+{
+	const uint8_t access_length = 1U << access_width;
+	uint32_t values[RV32_STREAM_CHUNK];
+	for (size_t offset = 0U; offset < count;) {
+		const size_t amount = MIN(count - offset, RV32_STREAM_CHUNK);
+		if (!riscv_dm_read_block(hart->dbg_module, reg, values, amount))
+			return false;
+		for (size_t idx = 0U; idx < amount; ++idx, ++offset)
+			riscv32_unpack_data(data + offset * access_length, values[idx], access_width);
+	}
+	return true;
+}
+
+/* Stream count values of the given access width into a DM data register, handing them to the DMI in batches */
+bool riscv32_stream_write(riscv_hart_s *const hart, const uint8_t reg, const uint8_t *const data,
+	const size_t count, const uint8_t access_width)
+{
+	const uint8_t access_length = 1U << access_width;
+	uint32_t values[RV32_STREAM_CHUNK];
+	for (size_t offset = 0U; offset < count;) {
+		const size_t amount = MIN(count - offset, RV32_STREAM_CHUNK);
+		for (size_t idx = 0U; idx < amount; ++idx)
+			values[idx] = riscv32_pack_data(data + (offset + idx) * access_length, access_width);
+		if (!riscv_dm_write_block(hart->dbg_module, reg, values, amount))
+			return false;
+		offset += amount;
+	}
+	return true;
+}
+
+/*
+ * If the first abstract memory access of a transfer fails as not supported, the hart has no abstract memory
+ * access at all - switch it over to running memory accesses from the program buffer if it's big enough
+ */
+static bool riscv32_use_progbuf_memory(riscv_hart_s *const hart)
+{
+	if (hart->status != RISCV_HART_NOT_SUPP || hart->progbuf_size < RV32_PROGBUF_COPIER_LENGTH)
+		return false;
+	DEBUG_INFO("Hart does not support abstract memory access, using the program buffer\n");
+	hart->flags |= RV_HART_FLAG_MEMORY_PROGBUF;
+	return true;
+}
+
+/* Run an abstract register access command against s0 or s1, waiting for any progbuf execution it kicks off */
+static bool riscv32_progbuf_exec(riscv_hart_s *const hart, const uint32_t command)
+{
+	const uint32_t access = RV_DM_ABST_CMD_ACCESS_REG | RV_REG_XFER | RV_REG_ACCESS_32_BIT | command;
+	return riscv_dm_write(hart->dbg_module, RV_DM_ABST_COMMAND, access) && riscv_command_wait_complete(hart);
+}
+
+/* Load the memory copier into the program buffer and point s0 at the address to start from */
+static bool riscv32_progbuf_setup(
+	riscv_hart_s *const hart, const uint32_t access, const uint8_t access_length, const target_addr_t address)
+{
+	return riscv_dm_write(hart->dbg_module, RV_DM_PROGBUF_BASE + 0U, access) &&
+		riscv_dm_write(hart->dbg_module, RV_DM_PROGBUF_BASE + 1U, RV32_ADDI_S0_S0(access_length)) &&
+		riscv_dm_write(hart->dbg_module, RV_DM_PROGBUF_BASE + 2U, RV_EBREAK) &&
+		riscv_dm_write(hart->dbg_module, RV_DM_DATA0, address);
+}
+
+static bool riscv32_progbuf_copy_out(riscv_hart_s *const hart, uint8_t *const data, const target_addr_t src,
+	const size_t len, const uint8_t access_width)
+{
+	const uint8_t access_length = 1U << access_width;
+	/* Set up the copier and run it once after pointing s0 at the start, loading the first value into s1 */
+	if (!riscv32_progbuf_setup(hart, RV32_LOAD_S1_S0(access_width), access_length, src) ||
+		!riscv32_progbuf_exec(hart, RV_ABST_WRITE | RV_ABST_POSTEXEC | RV32_GPR_S0))
+		return false;
+	size_t offset = 0U;
+	/* For all but the last value, transfer s1 out to data0 and re-run the copier to load the next */
+	if (offset + access_length < len) {
+		if (!riscv32_progbuf_exec(hart, RV_ABST_READ | RV_ABST_POSTEXEC | RV32_GPR_S1))
+			return false;
+		/* With auto-execution, each read of data0 does that again, as long as that won't load past the end */
+		if ((hart->flags & RV_HART_FLAG_ABST_AUTOEXEC) && offset + 2U * access_length < len) {
+			if (!riscv_dm_write(hart->dbg_module, RV_DM_ABST_AUTO, RV_DM_ABST_AUTO_DATA0))
+				return false;
+			const size_t count = len / access_length - 2U;
+			const bool result = riscv32_stream_read(hart, RV_DM_DATA0, data, count, access_width) &&
+				riscv32_abstract_stream_complete(hart);
+			offset = count * access_length;
+			if (!riscv_dm_write(hart->dbg_module, RV_DM_ABST_AUTO, 0U) || !result)
+				return false;
+		}
+		while (true) {
+			uint32_t value = 0;
+			if (!riscv_dm_read(hart->dbg_module, RV_DM_DATA0, &value))
+				return false;
+			riscv32_unpack_data(data + offset, value, access_width);
+			offset += access_length;
+			if (offset + access_length >= len)
+				break;
+			if (!riscv32_progbuf_exec(hart, RV_ABST_READ | RV_ABST_POSTEXEC | RV32_GPR_S1))
+				return false;
+		}
+	}
+	/* The last value is already in s1, so transfer it out without running the copier again */
+	uint32_t value = 0;
+	if (!riscv32_progbuf_exec(hart, RV_ABST_READ | RV32_GPR_S1) ||
+		!riscv_dm_read(hart->dbg_module, RV_DM_DATA0, &value))
+		return false;
+	riscv32_unpack_data(data + offset, value, access_width);
+	return true;
+}
+
+static bool riscv32_progbuf_copy_in(riscv_hart_s *const hart, const target_addr_t dest, const uint8_t *const data,
+	const size_t len, const uint8_t access_width)
+{
+	const uint8_t access_length = 1U << access_width;
+	/* Set up the copier and point s0 at the start */
+	if (!riscv32_progbuf_setup(hart, RV32_STORE_S1_S0(access_width), access_length, dest) ||
+		!riscv32_progbuf_exec(hart, RV_ABST_WRITE | RV32_GPR_S0))
+		return false;
+	/* Transfer the first value to s1 and run the copier to store it */
+	if (!riscv_dm_write(hart->dbg_module, RV_DM_DATA0, riscv32_pack_data(data, access_width)) ||
+		!riscv32_progbuf_exec(hart, RV_ABST_WRITE | RV_ABST_POSTEXEC | RV32_GPR_S1))
+		return false;
+	size_t offset = access_length;
+	/* With auto-execution, each write of data0 does that again */
+	if (offset < len && (hart->flags & RV_HART_FLAG_ABST_AUTOEXEC)) {
+		if (!riscv_dm_write(hart->dbg_module, RV_DM_ABST_AUTO, RV_DM_ABST_AUTO_DATA0))
+			return false;
+		const size_t count = (len - offset) / access_length;
+		const bool result = riscv32_stream_write(hart, RV_DM_DATA0, data + offset, count, access_width) &&
+			riscv32_abstract_stream_complete(hart);
+		return riscv_dm_write(hart->dbg_module, RV_DM_ABST_AUTO, 0U) && result;
+	}
+	for (; offset < len; offset += access_length) {
+		if (!riscv_dm_write(hart->dbg_module, RV_DM_DATA0, riscv32_pack_data(data + offset, access_width)) ||
+			!riscv32_progbuf_exec(hart, RV_ABST_WRITE | RV_ABST_POSTEXEC | RV32_GPR_S1))
+			return false;
+	}
+	return true;
+}
+
+/*
+ * Memory access via a copier running from the program buffer, for harts with neither System Bus
+ * nor abstract memory access. The copier clobbers s0 and s1, so those get put back afterwards.
+ */
+static void riscv32_progbuf_mem_read(
+	riscv_hart_s *const hart, void *const dest, const target_addr_t src, const size_t len)
+{
+	const uint8_t access_width = riscv_mem_access_width(hart, src, len);
+	uint32_t saved_regs[2U];
+	if (!riscv_csr_read(hart, RV32_GPR_S0, &saved_regs[0]) || !riscv_csr_read(hart, RV32_GPR_S1, &saved_regs[1]))
+		return;
+	const uint16_t flags = hart->flags;
+	/* If the DM was too slow for auto-execution, that's now off, so have another go without it */
+	if (!riscv32_progbuf_copy_out(hart, (uint8_t *)dest, src, len, access_width) && flags != hart->flags)
+		riscv32_progbuf_copy_out(hart, (uint8_t *)dest, src, len, access_width);
+	riscv_csr_write(hart, RV32_GPR_S0, &saved_regs[0]);
+	riscv_csr_write(hart, RV32_GPR_S1, &saved_regs[1]);
+}
+
+static void riscv32_progbuf_mem_write(
+	riscv_hart_s *const hart, const target_addr_t dest, const void *const src, const size_t len)
+{
+	const uint8_t access_width = riscv_mem_access_width(hart, dest, len);
+	uint32_t saved_regs[2U];
+	if (!riscv_csr_read(hart, RV32_GPR_S0, &saved_regs[0]) || !riscv_csr_read(hart, RV32_GPR_S1, &saved_regs[1]))
+		return;
+	const uint16_t flags = hart->flags;
+	/* If the DM was too slow for auto-execution, that's now off, so have another go without it */
+	if (!riscv32_progbuf_copy_in(hart, dest, (const uint8_t *)src, len, access_width) && flags != hart->flags)
+		riscv32_progbuf_copy_in(hart, dest, (const uint8_t *)src, len, access_width);
+	riscv_csr_write(hart, RV32_GPR_S0, &saved_regs[0]);
+	riscv_csr_write(hart, RV32_GPR_S1, &saved_regs[1]);
+}
+
 static void riscv32_abstract_mem_read(
 	riscv_hart_s *const hart, void *const dest, const target_addr_t src, const size_t len)
 {
@@ -231,21 +457,51 @@ static void riscv32_abstract_mem_read(
 	const uint8_t access_width = riscv_mem_access_width(hart, src, len);
 	const uint8_t access_length = 1U << access_width;
 	/* Build the access command */
-	const uint32_t command = RV_DM_ABST_CMD_ACCESS_MEM | RV_ABST_READ | (access_width << RV_ABST_MEM_ACCESS_SHIFT) |
-		(access_length < len ? RV_ABST_MEM_ADDR_POST_INC : 0U);
-	/* Write the address to read to arg1 */
-	if (!riscv_dm_write(hart->dbg_module, RV_DM_DATA1, src))
+	uint32_t command = riscv32_abstract_mem_access(hart, RV_ABST_READ, access_width, access_length, len);
+	/* Write the address to read to arg1 and do the first read */
+	if (!riscv_dm_write(hart->dbg_module, RV_DM_DATA1, src) || !riscv32_abstract_mem_command(hart, &command)) {
+		if (riscv32_use_progbuf_memory(hart))
+			riscv32_progbuf_mem_read(hart, dest, src, len);
 		return;
+	}
 	uint8_t *const data = (uint8_t *)dest;
-	for (size_t offset = 0; offset < len; offset += access_length) {
-		/* Execute the read */
-		if (!riscv_dm_write(hart->dbg_module, RV_DM_ABST_COMMAND, command) || !riscv_command_wait_complete(hart))
+	size_t offset = 0U;
+	/*
+	 * If the address post-increments and the DM supports it, have every read of arg0 trigger the next
+	 * access so the rest stream out without writing the command and polling for completion each time.
+	 * Auto-execution gets turned off before the final read so that doesn't read past the end.
+	 */
+	if ((command & RV_ABST_MEM_ADDR_POST_INC) && (hart->flags & RV_HART_FLAG_ABST_AUTOEXEC)) {
+		if (!riscv_dm_write(hart->dbg_module, RV_DM_ABST_AUTO, RV_DM_ABST_AUTO_DATA0))
 			return;
+		const size_t count = len / access_length - 1U;
+		bool result = riscv32_stream_read(hart, RV_DM_DATA0, data, count, access_width);
+		offset = count * access_length;
+		/* Wait for the last access to finish before turning auto-execution back off, the DM rejects that when busy */
+		result = result && riscv32_abstract_stream_complete(hart);
+		if (!riscv_dm_write(hart->dbg_module, RV_DM_ABST_AUTO, 0U))
+			return;
+		if (!result) {
+			/* If the DM was too slow for the stream, redo the whole read without it */
+			if (!(hart->flags & RV_HART_FLAG_ABST_AUTOEXEC))
+				riscv32_abstract_mem_read(hart, dest, src, len);
+			return;
+		}
+	}
+	while (true) {
 		/* Extract back the data from arg0 */
 		uint32_t value = 0;
 		if (!riscv_dm_read(hart->dbg_module, RV_DM_DATA0, &value))
 			return;
 		riscv32_unpack_data(data + offset, value, access_width);
+		offset += access_length;
+		if (offset >= len)
+			break;
+		/* Execute the next read, pointing arg1 at it if the hart doesn't do that for us */
+		if (!(command & RV_ABST_MEM_ADDR_POST_INC) && !riscv_dm_write(hart->dbg_module, RV_DM_DATA1, src + offset))
+			return;
+		if (!riscv32_abstract_mem_command(hart, &command))
+			return;
 	}
 }
 
@@ -256,24 +512,45 @@ static void riscv32_abstract_mem_write(
 	const uint8_t access_width = riscv_mem_access_width(hart, dest, len);
 	const uint8_t access_length = 1U << access_width;
 	/* Build the access command */
-	const uint32_t command = RV_DM_ABST_CMD_ACCESS_MEM | RV_ABST_WRITE | (access_width << RV_ABST_MEM_ACCESS_SHIFT) |
-		(access_length < len ? RV_ABST_MEM_ADDR_POST_INC : 0U);
-	/* Write the address to write to arg1 */
-	if (!riscv_dm_write(hart->dbg_module, RV_DM_DATA1, dest))
-		return;
+	uint32_t command = riscv32_abstract_mem_access(hart, RV_ABST_WRITE, access_width, access_length, len);
 	const uint8_t *const data = (const uint8_t *)src;
-	for (size_t offset = 0; offset < len; offset += access_length) {
-		/* Pack the data to write into arg0 */
-		uint32_t value = riscv32_pack_data(data + offset, access_width);
-		if (!riscv_dm_write(hart->dbg_module, RV_DM_DATA0, value))
+	/* Write the address to write to arg1, the data to write to arg0, and do the first write */
+	if (!riscv_dm_write(hart->dbg_module, RV_DM_DATA1, dest) ||
+		!riscv_dm_write(hart->dbg_module, RV_DM_DATA0, riscv32_pack_data(data, access_width)) ||
+		!riscv32_abstract_mem_command(hart, &command)) {
+		if (riscv32_use_progbuf_memory(hart))
+			riscv32_progbuf_mem_write(hart, dest, src, len);
+		return;
+	}
+	size_t offset = access_length;
+	/* If the address post-increments and the DM supports it, have every write of arg0 trigger the access */
+	if (offset < len && (command & RV_ABST_MEM_ADDR_POST_INC) && (hart->flags & RV_HART_FLAG_ABST_AUTOEXEC)) {
+		if (!riscv_dm_write(hart->dbg_module, RV_DM_ABST_AUTO, RV_DM_ABST_AUTO_DATA0))
+			return;
+		const size_t count = (len - offset) / access_length;
+		bool result = riscv32_stream_write(hart, RV_DM_DATA0, data + offset, count, access_width);
+		/* Wait for the last access to finish before turning auto-execution back off, the DM rejects that when busy */
+		result = result && riscv32_abstract_stream_complete(hart);
+		if (!riscv_dm_write(hart->dbg_module, RV_DM_ABST_AUTO, 0U))
+			return;
+		/* If the DM was too slow for the stream, redo the whole write without it */
+		if (!result && !(hart->flags & RV_HART_FLAG_ABST_AUTOEXEC))
+			riscv32_abstract_mem_write(hart, dest, src, len);
+		return;
+	}
+	for (; offset < len; offset += access_length) {
+		/* Point arg1 at the next write if the hart doesn't do that for us, and pack the data to write into arg0 */
+		if (!(command & RV_ABST_MEM_ADDR_POST_INC) && !riscv_dm_write(hart->dbg_module, RV_DM_DATA1, dest + offset))
+			return;
+		if (!riscv_dm_write(hart->dbg_module, RV_DM_DATA0, riscv32_pack_data(data + offset, access_width)))
 			return;
 		/* Execute the write */
-		if (!riscv_dm_write(hart->dbg_module, RV_DM_ABST_COMMAND, command) || !riscv_command_wait_complete(hart))
+		if (!riscv32_abstract_mem_command(hart, &command))
 			return;
 	}
 }
 
-static void riscv_sysbus_check(riscv_hart_s *const hart)
+void riscv_sysbus_check(riscv_hart_s *const hart)
 {
 	uint32_t status = 0;
 	/* Read back the system bus status */
@@ -288,6 +565,23 @@ static void riscv_sysbus_check(riscv_hart_s *const hart)
 		DEBUG_WARN("memory access failed: %u\n", hart->status);
 }
 
+/*
+ * Check a run of System Bus accesses streamed without polling sbbusy. If any came while the bus was still busy,
+ * clear the error and fall back to polling for all future accesses as the bus can't keep up with the stream.
+ */
+bool riscv32_sysbus_stream_complete(riscv_hart_s *const hart)
+{
+	uint32_t status = 0;
+	if (!riscv_dm_read(hart->dbg_module, RV_DM_SYSBUS_CTRLSTATUS, &status))
+		return false;
+	if (!(status & RV_SYSBUS_STATUS_BUSY_ERROR))
+		return true;
+	DEBUG_WARN("System Bus access streaming outran the bus, disabling it\n");
+	hart->flags |= RV_HART_FLAG_SYSBUS_POLL;
+	riscv_dm_write(hart->dbg_module, RV_DM_SYSBUS_CTRLSTATUS, RV_SYSBUS_STATUS_BUSY_ERROR | (RISCV_HART_OTHER << 12U));
+	return false;
+}
+
 static void riscv32_sysbus_mem_native_read(riscv_hart_s *const hart, void *const dest, const target_addr_t src,
 	const size_t len, const uint8_t access_width, const uint8_t access_length)
 {
@@ -302,7 +596,19 @@ static void riscv32_sysbus_mem_native_read(riscv_hart_s *const hart, void *const
 		!riscv_dm_write(hart->dbg_module, RV_DM_SYSBUS_ADDR0, src))
 		return;
 	uint8_t *const data = (uint8_t *)dest;
-	for (size_t offset = 0; offset < len; offset += access_length) {
+	size_t offset = 0;
+	/*
+	 * Unless the bus has previously been too slow for it, stream all but the last value straight out of
+	 * sbdata0 - each read there kicks off the next bus access, and sbbusyerror catches any that came too soon
+	 */
+	const bool streamed = (command & RV_SYSBUS_MEM_ADDR_POST_INC) && !(hart->flags & RV_HART_FLAG_SYSBUS_POLL);
+	if (streamed) {
+		const size_t count = len / access_length - 1U;
+		if (!riscv32_stream_read(hart, RV_DM_SYSBUS_DATA0, data, count, access_width))
+			return;
+		offset = count * access_length;
+	}
+	for (; offset < len; offset += access_length) {
 		uint32_t status = RV_SYSBUS_STATUS_BUSY;
 		/* Wait for the current read cycle to complete */
 		while (status & RV_SYSBUS_STATUS_BUSY) {
@@ -320,6 +626,12 @@ static void riscv32_sysbus_mem_native_read(riscv_hart_s *const hart, void *const
 			return;
 		riscv32_unpack_data(data + offset, value, access_width);
 	}
+	/* If the stream went wrong, redo the whole read polling the bus */
+	if (streamed && !riscv32_sysbus_stream_complete(hart)) {
+		if (hart->flags & RV_HART_FLAG_SYSBUS_POLL)
+			riscv32_sysbus_mem_native_read(hart, dest, src, len, access_width, access_length);
+		return;
+	}
 	riscv_sysbus_check(hart);
 }
 
@@ -433,6 +745,25 @@ static void riscv32_sysbus_mem_native_write(riscv_hart_s *const hart, const targ
 		!riscv_dm_write(hart->dbg_module, RV_DM_SYSBUS_ADDR0, dest))
 		return;
 	const uint8_t *const data = (const uint8_t *)src;
+	/* Unless the bus has previously been too slow for it, stream all the values into sbdata0 back to back */
+	if ((command & RV_SYSBUS_MEM_ADDR_POST_INC) && !(hart->flags & RV_HART_FLAG_SYSBUS_POLL)) {
+		if (!riscv32_stream_write(hart, RV_DM_SYSBUS_DATA0, data, len / access_length, access_width))
+			return;
+		uint32_t status = RV_SYSBUS_STATUS_BUSY;
+		/* Wait for the last write cycle to complete */
+		while (status & RV_SYSBUS_STATUS_BUSY) {
+			if (!riscv_dm_read(hart->dbg_module, RV_DM_SYSBUS_CTRLSTATUS, &status))
+				return;
+		}
+		/* If the stream went wrong, redo the whole write polling the bus */
+		if (!riscv32_sysbus_stream_complete(hart)) {
+			if (hart->flags & RV_HART_FLAG_SYSBUS_POLL)
+				riscv32_sysbus_mem_native_write(hart, dest, src, len, access_width, access_length);
+			return;
+		}
+		riscv_sysbus_check(hart);
+		return;
+	}
 	for (size_t offset = 0; offset < len; offset += access_length) {
 		/* Pack the data for this block and write it */
 		const uint32_t value = riscv32_pack_data(data + offset, access_width);
@@ -571,6 +902,8 @@ void riscv32_mem_read(target_s *const target, void *const dest, const target_add
 	riscv_hart_s *const hart = riscv_hart_struct(target);
 	if (hart->flags & RV_HART_FLAG_MEMORY_SYSBUS)
 		riscv32_sysbus_mem_read(hart, dest, src, len);
+	else if (hart->flags & RV_HART_FLAG_MEMORY_PROGBUF)
+		riscv32_progbuf_mem_read(hart, dest, src, len);
 	else
 		riscv32_abstract_mem_read(hart, dest, src, len);
 
@@ -613,6 +946,8 @@ void riscv32_mem_write(target_s *const target, const target_addr64_t dest, const
 	riscv_hart_s *const hart = riscv_hart_struct(target);
 	if (hart->flags & RV_HART_FLAG_MEMORY_SYSBUS)
 		riscv32_sysbus_mem_write(hart, dest, src, len);
+	else if (hart->flags & RV_HART_FLAG_MEMORY_PROGBUF)
+		riscv32_progbuf_mem_write(hart, dest, src, len);
 	else
 		riscv32_abstract_mem_write(hart, dest, src, len);
 }
@@ -663,7 +998,7 @@ static int riscv32_breakwatch_set(target_s *const target, breakwatch_s *const br
 		/* If the breakwatch type is not one of the above, tell the debugger we don't support it */
 		return 1;
 	}
-	/* Grab the address to set the breakwatch on and configure the hardware */
+	/* Grab the address to set the breakwatch on and configure the trigger, which is programmed on resume */
 	const uint32_t address = breakwatch->addr;
 	const bool result = riscv_config_trigger(hart, trigger, mode, &config, &address);
 	/* If configuration succeeds, store the trigger index in the breakwatch structure */
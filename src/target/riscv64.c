@@ -42,9 +42,12 @@ typedef struct riscv64_regs {
 	uint64_t pc;
 } riscv64_regs_s;
 
+static size_t riscv64_reg_read(target_s *target, uint32_t reg, void *data, size_t max);
+static size_t riscv64_reg_write(target_s *target, uint32_t reg, const void *data, size_t max);
 static void riscv64_regs_read(target_s *target, void *data);
 static void riscv64_regs_write(target_s *target, const void *data);
 static void riscv64_mem_read(target_s *target, void *dest, target_addr64_t src, size_t len);
+static void riscv64_mem_write(target_s *target, target_addr64_t dest, const void *src, size_t len);
 
 bool riscv64_probe(target_s *const target)
 {
@@ -52,7 +55,10 @@ bool riscv64_probe(target_s *const target)
 	target->regs_size = sizeof(riscv64_regs_s); /* Provide the length of a suitable registers structure */
 	target->regs_read = riscv64_regs_read;
 	target->regs_write = riscv64_regs_write;
+	target->reg_read = riscv64_reg_read;
+	target->reg_write = riscv64_reg_write;
 	target->mem_read = riscv64_mem_read;
+	target->mem_write = riscv64_mem_write;
 
 	return false;
 }
@@ -87,6 +93,46 @@ static void riscv64_regs_write(target_s *const target, const void *const data)
 	riscv_csr_write(hart, RV_DPC, &regs->pc);
 }
 
+static inline size_t riscv64_bool_to_8(const bool ret)
+{
+	return ret ? 8U : 0U;
+}
+
+static size_t riscv64_reg_read(target_s *const target, const uint32_t reg, void *const data, const size_t max)
+{
+	/* We may be called with a buffer larger then necessary, so only error if there is too little space */
+	if (max < 8)
+		return 0;
+	/* Grab the hart structure  */
+	riscv_hart_s *const hart = riscv_hart_struct(target);
+	if (reg < 32)
+		return riscv64_bool_to_8(riscv_csr_read(hart, RV_GPR_BASE + reg, data));
+	if (reg == 32)
+		return riscv64_bool_to_8(riscv_csr_read(hart, RV_DPC, data));
+	if (reg >= RV_CSR_GDB_OFFSET)
+		return riscv64_bool_to_8(riscv_csr_read(hart, reg - RV_CSR_GDB_OFFSET, data));
+	if (reg >= RV_FPU_GDB_OFFSET)
+		return riscv64_bool_to_8(riscv_csr_read(hart, RV_FP_BASE + reg - RV_FPU_GDB_OFFSET, data));
+	return 0;
+}
+
+static size_t riscv64_reg_write(target_s *const target, const uint32_t reg, const void *const data, const size_t max)
+{
+	if (max != 8)
+		return 0;
+	/* Grab the hart structure  */
+	riscv_hart_s *const hart = riscv_hart_struct(target);
+	if (reg < 32)
+		return riscv64_bool_to_8(riscv_csr_write(hart, RV_GPR_BASE + reg, data));
+	if (reg == 32)
+		return riscv64_bool_to_8(riscv_csr_write(hart, RV_DPC, data));
+	if (reg >= RV_CSR_GDB_OFFSET)
+		return riscv64_bool_to_8(riscv_csr_write(hart, reg - RV_CSR_GDB_OFFSET, data));
+	if (reg >= RV_FPU_GDB_OFFSET)
+		return riscv64_bool_to_8(riscv_csr_write(hart, RV_FP_BASE + reg - RV_FPU_GDB_OFFSET, data));
+	return 0;
+}
+
 /* Takes in data from abstract command arg0 and, based on the access width, unpacks it to dest */
 void riscv64_unpack_data(
 	void *const dest, const uint32_t data_low, const uint32_t data_high, const uint8_t access_width)
@@ -107,34 +153,298 @@ void riscv64_unpack_data(
 	}
 }
 
-static void riscv64_mem_read(target_s *const target, void *const dest, const target_addr64_t src, const size_t len)
+/* Takes in data from src and, based on the access width, packs it into the low and high halves of a data pair */
+static void riscv64_pack_data(
+	const void *const src, const uint8_t access_width, uint32_t *const data_low, uint32_t *const data_high)
+{
+	if (access_width == RV_MEM_ACCESS_64_BIT) {
+		uint64_t value = 0;
+		memcpy(&value, src, sizeof(value));
+		*data_low = (uint32_t)value;
+		*data_high = (uint32_t)(value >> 32U);
+	} else {
+		*data_low = riscv32_pack_data(src, access_width);
+		*data_high = 0U;
+	}
+}
+
+/*
+ * Read a value out of a pair of DM data registers. The high half goes first as, when streaming, accessing the
+ * low half is what kicks off the next access - autoexecdata bit 0, and sbreadondata, only look at data0
+ */
+static bool riscv64_data_read(riscv_hart_s *const hart, const uint8_t reg, uint8_t *const data,
+	const uint8_t access_width)
+{
+	uint32_t value_low = 0;
+	uint32_t value_high = 0;
+	if ((access_width == RV_MEM_ACCESS_64_BIT && !riscv_dm_read(hart->dbg_module, reg + 1U, &value_high)) ||
+		!riscv_dm_read(hart->dbg_module, reg, &value_low))
+		return false;
+	riscv64_unpack_data(data, value_low, value_high, access_width);
+	return true;
+}
+
+/* Write a value into a pair of DM data registers, high half first for the same reason as riscv64_data_read() */
+static bool riscv64_data_write(riscv_hart_s *const hart, const uint8_t reg, const uint8_t *const data,
+	const uint8_t access_width)
+{
+	uint32_t value_low = 0;
+	uint32_t value_high = 0;
+	riscv64_pack_data(data, access_width, &value_low, &value_high);
+	return (access_width != RV_MEM_ACCESS_64_BIT || riscv_dm_write(hart->dbg_module, reg + 1U, value_high)) &&
+		riscv_dm_write(hart->dbg_module, reg, value_low);
+}
+
+/*
+ * Stream count values through a DM data register pair, each low half access triggering the next access.
+ * Values of 32 bits or less only need data0, so those go through the pipelined block accesses of the RV32 path.
+ */
+static bool riscv64_stream_read(riscv_hart_s *const hart, const uint8_t reg, uint8_t *const data, const size_t count,
+	const uint8_t access_width)
+{
+	if (access_width != RV_MEM_ACCESS_64_BIT)
+		return riscv32_stream_read(hart, reg, data, count, access_width);
+	for (size_t offset = 0U; offset < count; ++offset) {
+		if (!riscv64_data_read(hart, reg, data + offset * sizeof(uint64_t), access_width))
+			return false;
+	}
+	return true;
+}
+
+static bool riscv64_stream_write(riscv_hart_s *const hart, const uint8_t reg, const uint8_t *const data,
+	const size_t count, const uint8_t access_width)
+{
+	if (access_width != RV_MEM_ACCESS_64_BIT)
+		return riscv32_stream_write(hart, reg, data, count, access_width);
+	for (size_t offset = 0U; offset < count; ++offset) {
+		if (!riscv64_data_write(hart, reg, data + offset * sizeof(uint64_t), access_width))
+			return false;
+	}
+	return true;
+}
+
+/* On RV64, abstract command arg1 (the address) is the 64-bit pair data2 and data3 */
+static bool riscv64_abstract_mem_address(riscv_hart_s *const hart, const target_addr64_t address)
+{
+	return riscv_dm_write(hart->dbg_module, RV_DM_DATA2, (uint32_t)address) &&
+		riscv_dm_write(hart->dbg_module, RV_DM_DATA3, (uint32_t)(address >> 32U));
+}
+
+static void riscv64_abstract_mem_read(
+	riscv_hart_s *const hart, void *const dest, const target_addr64_t src, const size_t len)
 {
-	DEBUG_TARGET("Performing %zu byte read of %08" PRIx64 "\n", len, src);
-	/* If we're asked to do a 0-byte read, do nothing */
-	if (!len)
-		return;
-	riscv_hart_s *const hart = riscv_hart_struct(target);
 	/* Figure out the maximal width of access to perform, up to the bitness of the target */
 	const uint8_t access_width = riscv_mem_access_width(hart, src, len);
 	const uint8_t access_length = 1U << access_width;
 	/* Build the access command */
-	const uint32_t command = RV_DM_ABST_CMD_ACCESS_MEM | RV_ABST_READ | (access_width << RV_ABST_MEM_ACCESS_SHIFT) |
-		(access_length < len ? RV_ABST_MEM_ADDR_POST_INC : 0U);
-	/* Write the address to read to arg1 */
-	if (!riscv_dm_write(hart->dbg_module, RV_DM_DATA2, (uint32_t)src) ||
-		!riscv_dm_write(hart->dbg_module, RV_DM_DATA3, (uint32_t)(src >> 32U)))
+	uint32_t command = riscv32_abstract_mem_access(hart, RV_ABST_READ, access_width, access_length, len);
+	/* Write the address to read to arg1 and do the first read */
+	if (!riscv64_abstract_mem_address(hart, src) || !riscv32_abstract_mem_command(hart, &command))
 		return;
 	uint8_t *const data = (uint8_t *)dest;
-	for (size_t offset = 0; offset < len; offset += access_length) {
-		/* Execute the read */
-		if (!riscv_dm_write(hart->dbg_module, RV_DM_ABST_COMMAND, command) || !riscv_command_wait_complete(hart))
+	size_t offset = 0U;
+	/*
+	 * If the address post-increments and the DM supports it, have every read of arg0 trigger the next
+	 * access so the rest stream out without writing the command and polling for completion each time.
+	 * Auto-execution gets turned off before the final read so that doesn't read past the end.
+	 */
+	if ((command & RV_ABST_MEM_ADDR_POST_INC) && (hart->flags & RV_HART_FLAG_ABST_AUTOEXEC)) {
+		if (!riscv_dm_write(hart->dbg_module, RV_DM_ABST_AUTO, RV_DM_ABST_AUTO_DATA0))
 			return;
+		const size_t count = len / access_length - 1U;
+		bool result = riscv64_stream_read(hart, RV_DM_DATA0, data, count, access_width);
+		offset = count * access_length;
+		/* Wait for the last access to finish before turning auto-execution back off, the DM rejects that when busy */
+		result = result && riscv32_abstract_stream_complete(hart);
+		if (!riscv_dm_write(hart->dbg_module, RV_DM_ABST_AUTO, 0U))
+			return;
+		if (!result) {
+			/* If the DM was too slow for the stream, redo the whole read without it */
+			if (!(hart->flags & RV_HART_FLAG_ABST_AUTOEXEC))
+				riscv64_abstract_mem_read(hart, dest, src, len);
+			return;
+		}
+	}
+	while (true) {
 		/* Extract back the data from arg0 */
-		uint32_t value_low = 0;
-		uint32_t value_high = 0;
-		if (!riscv_dm_read(hart->dbg_module, RV_DM_DATA0, &value_low) ||
-			!riscv_dm_read(hart->dbg_module, RV_DM_DATA1, &value_high))
+		if (!riscv64_data_read(hart, RV_DM_DATA0, data + offset, access_width))
+			return;
+		offset += access_length;
+		if (offset >= len)
+			break;
+		/* Execute the next read, pointing arg1 at it if the hart doesn't do that for us */
+		if (!(command & RV_ABST_MEM_ADDR_POST_INC) && !riscv64_abstract_mem_address(hart, src + offset))
+			return;
+		if (!riscv32_abstract_mem_command(hart, &command))
+			return;
+	}
+}
+
+static void riscv64_abstract_mem_write(
+	riscv_hart_s *const hart, const target_addr64_t dest, const void *const src, const size_t len)
+{
+	/* Figure out the maxmial width of access to perform, up to the bitness of the target */
+	const uint8_t access_width = riscv_mem_access_width(hart, dest, len);
+	const uint8_t access_length = 1U << access_width;
+	/* Build the access command */
+	uint32_t command = riscv32_abstract_mem_access(hart, RV_ABST_WRITE, access_width, access_length, len);
+	const uint8_t *const data = (const uint8_t *)src;
+	/* Write the address to write to arg1, the data to write to arg0, and do the first write */
+	if (!riscv64_abstract_mem_address(hart, dest) || !riscv64_data_write(hart, RV_DM_DATA0, data, access_width) ||
+		!riscv32_abstract_mem_command(hart, &command))
+		return;
+	size_t offset = access_length;
+	/* If the address post-increments and the DM supports it, have every write of arg0 trigger the access */
+	if (offset < len && (command & RV_ABST_MEM_ADDR_POST_INC) && (hart->flags & RV_HART_FLAG_ABST_AUTOEXEC)) {
+		if (!riscv_dm_write(hart->dbg_module, RV_DM_ABST_AUTO, RV_DM_ABST_AUTO_DATA0))
+			return;
+		const size_t count = (len - offset) / access_length;
+		bool result = riscv64_stream_write(hart, RV_DM_DATA0, data + offset, count, access_width);
+		/* Wait for the last access to finish before turning auto-execution back off, the DM rejects that when busy */
+		result = result && riscv32_abstract_stream_complete(hart);
+		if (!riscv_dm_write(hart->dbg_module, RV_DM_ABST_AUTO, 0U))
+			return;
+		/* If the DM was too slow for the stream, redo the whole write without it */
+		if (!result && !(hart->flags & RV_HART_FLAG_ABST_AUTOEXEC))
+			riscv64_abstract_mem_write(hart, dest, src, len);
+		return;
+	}
+	for (; offset < len; offset += access_length) {
+		/* Point arg1 at the next write if the hart doesn't do that for us, and pack the data to write into arg0 */
+		if (!(command & RV_ABST_MEM_ADDR_POST_INC) && !riscv64_abstract_mem_address(hart, dest + offset))
+			return;
+		if (!riscv64_data_write(hart, RV_DM_DATA0, data + offset, access_width))
+			return;
+		/* Execute the write */
+		if (!riscv32_abstract_mem_command(hart, &command))
 			return;
-		riscv64_unpack_data(data + offset, value_low, value_high, access_width);
 	}
 }
+
+/* Wait for the System Bus to finish the access in progress */
+static bool riscv64_sysbus_wait(riscv_hart_s *const hart)
+{
+	uint32_t status = RV_SYSBUS_STATUS_BUSY;
+	while (status & RV_SYSBUS_STATUS_BUSY) {
+		if (!riscv_dm_read(hart->dbg_module, RV_DM_SYSBUS_CTRLSTATUS, &status))
+			return false;
+	}
+	return true;
+}
+
+/*
+ * Set up a System Bus access. The high half of the address goes first as, for reads, writing sbaddress0
+ * is what starts the first access
+ */
+static bool riscv64_sysbus_setup(riscv_hart_s *const hart, const uint32_t command, const target_addr64_t address)
+{
+	return riscv_dm_write(hart->dbg_module, RV_DM_SYSBUS_CTRLSTATUS, command) &&
+		riscv_dm_write(hart->dbg_module, RV_DM_SYSBUS_ADDR1, (uint32_t)(address >> 32U)) &&
+		riscv_dm_write(hart->dbg_module, RV_DM_SYSBUS_ADDR0, (uint32_t)address);
+}
+
+static void riscv64_sysbus_mem_read(riscv_hart_s *const hart, void *const dest, const target_addr64_t src,
+	const size_t len, const uint8_t access_width, const uint8_t access_length)
+{
+	/* Build the access command */
+	const uint32_t command = ((uint32_t)access_width << RV_SYSBUS_MEM_ACCESS_SHIFT) | RV_SYSBUS_MEM_READ_ON_ADDR |
+		(access_length < len ? RV_SYSBUS_MEM_ADDR_POST_INC | RV_SYSBUS_MEM_READ_ON_DATA : 0U);
+	if (!riscv64_sysbus_setup(hart, command, src))
+		return;
+	uint8_t *const data = (uint8_t *)dest;
+	size_t offset = 0;
+	/*
+	 * Unless the bus has previously been too slow for it, stream all but the last value straight out of
+	 * sbdata1:0 - each read of sbdata0 kicks off the next bus access, and sbbusyerror catches any too soon
+	 */
+	const bool streamed = (command & RV_SYSBUS_MEM_ADDR_POST_INC) && !(hart->flags & RV_HART_FLAG_SYSBUS_POLL);
+	if (streamed) {
+		const size_t count = len / access_length - 1U;
+		if (!riscv64_stream_read(hart, RV_DM_SYSBUS_DATA0, data, count, access_width))
+			return;
+		offset = count * access_length;
+	}
+	for (; offset < len; offset += access_length) {
+		/* Wait for the current read cycle to complete */
+		if (!riscv64_sysbus_wait(hart))
+			return;
+		/* If this would be the last read, clean up the access control register */
+		if (offset + access_length == len && (command & RV_SYSBUS_MEM_ADDR_POST_INC)) {
+			if (!riscv_dm_write(hart->dbg_module, RV_DM_SYSBUS_CTRLSTATUS, 0))
+				return;
+		}
+		/* Read back and unpack the data for this block */
+		if (!riscv64_data_read(hart, RV_DM_SYSBUS_DATA0, data + offset, access_width))
+			return;
+	}
+	/* If the stream went wrong, redo the whole read polling the bus */
+	if (streamed && !riscv32_sysbus_stream_complete(hart)) {
+		if (hart->flags & RV_HART_FLAG_SYSBUS_POLL)
+			riscv64_sysbus_mem_read(hart, dest, src, len, access_width, access_length);
+		return;
+	}
+	riscv_sysbus_check(hart);
+}
+
+static void riscv64_sysbus_mem_write(riscv_hart_s *const hart, const target_addr64_t dest, const void *const src,
+	const size_t len, const uint8_t access_width, const uint8_t access_length)
+{
+	/* Build the access command */
+	const uint32_t command = ((uint32_t)access_width << RV_SYSBUS_MEM_ACCESS_SHIFT) |
+		(access_length < len ? RV_SYSBUS_MEM_ADDR_POST_INC : 0U);
+	if (!riscv64_sysbus_setup(hart, command, dest))
+		return;
+	const uint8_t *const data = (const uint8_t *)src;
+	/* Unless the bus has previously been too slow for it, stream all the values into sbdata1:0 back to back */
+	if ((command & RV_SYSBUS_MEM_ADDR_POST_INC) && !(hart->flags & RV_HART_FLAG_SYSBUS_POLL)) {
+		if (!riscv64_stream_write(hart, RV_DM_SYSBUS_DATA0, data, len / access_length, access_width) ||
+			!riscv64_sysbus_wait(hart))
+			return;
+		/* If the stream went wrong, redo the whole write polling the bus */
+		if (!riscv32_sysbus_stream_complete(hart)) {
+			if (hart->flags & RV_HART_FLAG_SYSBUS_POLL)
+				riscv64_sysbus_mem_write(hart, dest, src, len, access_width, access_length);
+			return;
+		}
+		riscv_sysbus_check(hart);
+		return;
+	}
+	for (size_t offset = 0; offset < len; offset += access_length) {
+		/* Pack the data for this block, write it, and wait for the write cycle to complete */
+		if (!riscv64_data_write(hart, RV_DM_SYSBUS_DATA0, data + offset, access_width) || !riscv64_sysbus_wait(hart))
+			return;
+	}
+	riscv_sysbus_check(hart);
+}
+
+static void riscv64_mem_read(target_s *const target, void *const dest, const target_addr64_t src, const size_t len)
+{
+	DEBUG_TARGET("Performing %zu byte read of %08" PRIx64 "\n", len, src);
+	/* If we're asked to do a 0-byte read, do nothing */
+	if (!len)
+		return;
+	riscv_hart_s *const hart = riscv_hart_struct(target);
+	/* Use the System Bus if it natively supports the widest access the transfer allows, otherwise abstract commands */
+	const uint8_t access_width = riscv_mem_access_width(hart, src, len);
+	const uint8_t access_length = 1U << access_width;
+	if ((hart->flags & RV_HART_FLAG_MEMORY_SYSBUS) && (hart->flags & access_length))
+		riscv64_sysbus_mem_read(hart, dest, src, len, access_width, access_length);
+	else
+		riscv64_abstract_mem_read(hart, dest, src, len);
+}
+
+static void riscv64_mem_write(
+	target_s *const target, const target_addr64_t dest, const void *const src, const size_t len)
+{
+	DEBUG_TARGET("Performing %zu byte write of %08" PRIx64 "\n", len, dest);
+	/* If we're asked to do a 0-byte write, do nothing */
+	if (!len)
+		return;
+	riscv_hart_s *const hart = riscv_hart_struct(target);
+	const uint8_t access_width = riscv_mem_access_width(hart, dest, len);
+	const uint8_t access_length = 1U << access_width;
+	if ((hart->flags & RV_HART_FLAG_MEMORY_SYSBUS) && (hart->flags & access_length))
+		riscv64_sysbus_mem_write(hart, dest, src, len, access_width, access_length);
+	else
+		riscv64_abstract_mem_write(hart, dest, src, len);
+}
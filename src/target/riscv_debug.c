@@ -37,6 +37,7 @@
 #include "gdb_reg.h"
 #include "riscv_debug.h"
 #include "buffer_utils.h"
+#include "command.h"
 
 #include <assert.h>
 
@@ -52,14 +53,16 @@
 
 #define RV_DM_CONTROL      0x10U
 #define RV_DM_STATUS       0x11U
+#define RV_DM_HART_WIN_SEL 0x14U
+#define RV_DM_HART_WIN     0x15U
 #define RV_DM_NEXT_DM      0x1dU
-#define RV_DM_PROGBUF_BASE 0x20U
 
 #define RV_DM_CTRL_ACTIVE          (1U << 0U)
 #define RV_DM_CTRL_SYSTEM_RESET    (1U << 1U)
 #define RV_DM_CTRL_HARTSEL_MASK    0x03ffffc0U
 #define RV_DM_CTRL_HARTSELLO_MASK  0x03ff0000U
 #define RV_DM_CTRL_HARTSELHI_MASK  0x0000ffc0U
+#define RV_DM_CTRL_HART_ARRAY      (1U << 26U)
 #define RV_DM_CTRL_HART_ACK_RESET  (1U << 28U)
 #define RV_DM_CTRL_HART_RESET      (1U << 29U)
 #define RV_DM_CTRL_RESUME_REQ      (1U << 30U)
@@ -122,7 +125,6 @@
  */
 #define RV_CSRR_A0 0x00002573U
 #define RV_CSRW_A0 0x00051073U
-#define RV_EBREAK  0x00100073U
 
 #define RV_VENDOR_JEP106_CONT_MASK 0x7fffff80U
 #define RV_VENDOR_JEP106_CODE_MASK 0x7fU
@@ -268,6 +270,7 @@ static_assert(ARRAY_LENGTH(riscv_gpr_names) == ARRAY_LENGTH(riscv_gpr_types),
 // clang-format on
 
 static void riscv_dm_init(riscv_dm_s *dbg_module);
+static void riscv_dm_discover_hart_array(riscv_dm_s *dbg_module, uint32_t harts);
 static bool riscv_hart_init(riscv_hart_s *hart);
 static void riscv_hart_free(void *priv);
 static bool riscv_dmi_read(riscv_dmi_s *dmi, uint32_t address, uint32_t *value);
@@ -278,9 +281,10 @@ static riscv_debug_version_e riscv_dm_version(uint32_t status);
 
 static uint32_t riscv_hart_discover_isa(riscv_hart_s *hart);
 static void riscv_hart_discover_triggers(riscv_hart_s *hart);
+static void riscv_triggers_invalidate(riscv_hart_s *hart);
 static void riscv_hart_memory_access_type(target_s *target);
 
-static const char *riscv_target_description(target_s *target);
+static void riscv_target_description(target_s *target, target_description_stream_s *stream);
 
 static bool riscv_check_error(target_s *target);
 static void riscv_halt_request(target_s *target);
@@ -288,6 +292,13 @@ static void riscv_halt_resume(target_s *target, bool step);
 static target_halt_reason_e riscv_halt_poll(target_s *target, target_addr64_t *watch);
 static void riscv_reset(target_s *target);
 
+static bool riscv_cmd_all_stop(target_s *target, int argc, const char **argv);
+
+static const command_s riscv_cmd_list[] = {
+	{"all_stop", riscv_cmd_all_stop, "Halt and resume all harts on the Debug Module together (enable|disable)"},
+	{NULL, NULL, NULL},
+};
+
 void riscv_dmi_init(riscv_dmi_s *const dmi)
 {
 	/* If we don't currently know how to talk to this DMI, warn and fail */
@@ -349,6 +360,7 @@ static void riscv_dm_init(riscv_dm_s *const dbg_module)
 	/* Extract the maximum number of harts present and iterate through the harts */
 	const uint32_t harts_max = ((control & RV_DM_CTRL_HARTSELLO_MASK) >> RV_DM_CTRL_HARTSELLO_SHIFT) |
 		((control & RV_DM_CTRL_HARTSELHI_MASK) << RV_DM_CTRL_HARTSELHI_SHIFT);
+	uint32_t harts = 0U;
 	for (uint32_t hart_idx = 0; hart_idx <= harts_max; ++hart_idx) {
 		/* Select the hart */
 		control = ((hart_idx << RV_DM_CTRL_HARTSELLO_SHIFT) & RV_DM_CTRL_HARTSELLO_MASK) |
@@ -376,7 +388,37 @@ static void riscv_dm_init(riscv_dm_s *const dbg_module)
 		hart->hartsel = control;
 		if (!riscv_hart_init(hart))
 			free(hart);
+		else if (hart_idx < 32U)
+			harts |= 1U << hart_idx;
 	}
+	riscv_dm_discover_hart_array(dbg_module, harts);
+}
+
+/*
+ * Check if the DM implements the hart array mask so the given harts in the first hart window can be
+ * selected all together. If it does, halt and resume all of them any time one of them is, as GDB's
+ * all-stop mode expects, using a single dmcontrol write for them all.
+ */
+static void riscv_dm_discover_hart_array(riscv_dm_s *const dbg_module, const uint32_t harts)
+{
+	/* This only makes sense if there's more than a single hart */
+	if (!(harts & (harts - 1U)))
+		return;
+	uint32_t control = RV_DM_CTRL_ACTIVE | RV_DM_CTRL_HART_ARRAY;
+	if (!riscv_dm_write(dbg_module, RV_DM_CONTROL, control) || !riscv_dm_read(dbg_module, RV_DM_CONTROL, &control))
+		return;
+	/* hasel is allowed to be hardwired to 0, in which case there's no hart array mask */
+	uint32_t window = 0U;
+	if ((control & RV_DM_CTRL_HART_ARRAY) && riscv_dm_write(dbg_module, RV_DM_HART_WIN_SEL, 0U) &&
+		riscv_dm_write(dbg_module, RV_DM_HART_WIN, harts))
+		riscv_dm_read(dbg_module, RV_DM_HART_WIN, &window);
+	(void)riscv_dm_write(dbg_module, RV_DM_CONTROL, RV_DM_CTRL_ACTIVE);
+	/* Only use the mask if every one of the harts could be put in it */
+	if (window != harts)
+		return;
+	DEBUG_INFO("DM supports hart array mask, harts %08" PRIx32 " will halt and resume together\n", harts);
+	dbg_module->hart_array = harts;
+	dbg_module->all_stop = true;
 }
 
 static uint8_t riscv_isa_address_width(const uint32_t isa)
@@ -529,6 +571,7 @@ static bool riscv_hart_init(riscv_hart_s *const hart)
 	target->halt_resume = riscv_halt_resume;
 	target->halt_poll = riscv_halt_poll;
 	target->reset = riscv_reset;
+	target_add_commands(target, riscv_cmd_list, target->driver);
 
 	if (hart->access_width == 32U) {
 		DEBUG_INFO("-> riscv32_probe\n");
@@ -579,6 +622,38 @@ bool riscv_dm_write(riscv_dm_s *dbg_module, const uint8_t address, const uint32_
 	return riscv_dmi_write(dbg_module->dmi_bus, dbg_module->base + address, value);
 }
 
+/* Read the same DM register count times over, pipelining the reads if the DMI supports that */
+bool riscv_dm_read_block(
+	riscv_dm_s *const dbg_module, const uint8_t address, uint32_t *const values, const size_t count)
+{
+	riscv_dmi_s *const dmi = dbg_module->dmi_bus;
+	if (dmi->read_block) {
+		DEBUG_PROTO("%s: %08" PRIx32 " x %zu\n", __func__, dbg_module->base + address, count);
+		return dmi->read_block(dmi, dbg_module->base + address, values, count);
+	}
+	for (size_t idx = 0U; idx < count; ++idx) {
+		if (!riscv_dmi_read(dmi, dbg_module->base + address, values + idx))
+			return false;
+	}
+	return true;
+}
+
+/* Write a series of values to the same DM register, pipelining the writes if the DMI supports that */
+bool riscv_dm_write_block(
+	riscv_dm_s *const dbg_module, const uint8_t address, const uint32_t *const values, const size_t count)
+{
+	riscv_dmi_s *const dmi = dbg_module->dmi_bus;
+	if (dmi->write_block) {
+		DEBUG_PROTO("%s: %08" PRIx32 " x %zu\n", __func__, dbg_module->base + address, count);
+		return dmi->write_block(dmi, dbg_module->base + address, values, count);
+	}
+	for (size_t idx = 0U; idx < count; ++idx) {
+		if (!riscv_dmi_write(dmi, dbg_module->base + address, values[idx]))
+			return false;
+	}
+	return true;
+}
+
 static riscv_debug_version_e riscv_dm_version(const uint32_t status)
 {
 	uint8_t version = status & RV_STATUS_VERSION_MASK;
@@ -939,20 +1014,91 @@ static void riscv_hart_discover_triggers(riscv_hart_s *const hart)
 		hart->trigger_uses[trigger] = info;
 		DEBUG_TARGET("Hart trigger slot %" PRIu32 " modes: %04" PRIx32 "\n", trigger, info);
 	}
+	riscv_triggers_invalidate(hart);
+}
+
+/* Forget what the hardware triggers hold (such as after a reset), so the next resume reprograms all in use */
+static void riscv_triggers_invalidate(riscv_hart_s *const hart)
+{
+	hart->triggers_dirty = 0U;
+	for (uint32_t trigger = 0; trigger < hart->triggers; ++trigger) {
+		/* Nothing we configure a trigger with has every bit set, so this never matches */
+		hart->trigger_programmed[trigger] = (riscv_trigger_s){UINT64_MAX, UINT64_MAX};
+		if (hart->trigger_uses[trigger] & RV_TRIGGER_MODE_MASK)
+			hart->triggers_dirty |= (uint8_t)(1U << trigger);
+	}
+}
+
+static bool riscv_trigger_write(riscv_hart_s *const hart, const uint16_t reg, const uint64_t value)
+{
+	if (hart->access_width == 32U) {
+		const uint32_t value32 = (uint32_t)value;
+		return riscv_csr_write(hart, reg, &value32);
+	}
+	return riscv_csr_write(hart, reg, &value);
+}
+
+/* Write out all the trigger changes made while the hart was halted, that haven't cancelled each other out */
+static bool riscv_triggers_sync(riscv_hart_s *const hart)
+{
+	for (uint32_t trigger = 0; hart->triggers_dirty && trigger < hart->triggers; ++trigger) {
+		const uint8_t bit = (uint8_t)(1U << trigger);
+		if (!(hart->triggers_dirty & bit))
+			continue;
+		const riscv_trigger_s *const config = &hart->trigger_config[trigger];
+		riscv_trigger_s *const programmed = &hart->trigger_programmed[trigger];
+		if (config->config != programmed->config || config->address != programmed->address) {
+			/*
+			 * Select the trigger and write the new configuration to it.
+			 * tdata1 (RV_TRIG_DATA_1) becomes mcontrol (match control) for this -
+			 * see §5.2.9 pg53 of the RISC-V debug spec v0.13.2 for more details.
+			 */
+			if (!riscv_csr_write(hart, RV_TRIG_SELECT | RV_CSR_FORCE_32_BIT, &trigger) ||
+				!riscv_trigger_write(hart, RV_TRIG_DATA_1, config->config) ||
+				!riscv_trigger_write(hart, RV_TRIG_DATA_2, config->address)) {
+				DEBUG_WARN("Failed to program hart trigger slot %" PRIu32 "\n", trigger);
+				return false;
+			}
+			*programmed = *config;
+		}
+		hart->triggers_dirty &= (uint8_t)~bit;
+	}
+	return true;
+}
+
+/*
+ * Check if the DM implements autoexecdata for data0 (it's WARL, so an unimplemented bit reads back as 0),
+ * which lets bulk memory accesses re-run the abstract access command just by accessing data0
+ */
+static void riscv_hart_discover_autoexec(riscv_hart_s *const hart)
+{
+	hart->flags &= (uint16_t)~RV_HART_FLAG_ABST_AUTOEXEC;
+	uint32_t autoexec = 0U;
+	if (!riscv_dm_write(hart->dbg_module, RV_DM_ABST_AUTO, RV_DM_ABST_AUTO_DATA0) ||
+		!riscv_dm_read(hart->dbg_module, RV_DM_ABST_AUTO, &autoexec))
+		return;
+	if (autoexec & RV_DM_ABST_AUTO_DATA0)
+		hart->flags |= RV_HART_FLAG_ABST_AUTOEXEC;
+	(void)riscv_dm_write(hart->dbg_module, RV_DM_ABST_AUTO, 0U);
+	DEBUG_INFO("Hart %s abstract command auto-execution\n",
+		hart->flags & RV_HART_FLAG_ABST_AUTOEXEC ? "supports" : "does not support");
 }
 
 static void riscv_hart_memory_access_type(target_s *const target)
 {
 	riscv_hart_s *const hart = riscv_hart_struct(target);
-	hart->flags &= (uint8_t)~RV_HART_FLAG_MEMORY_SYSBUS;
+	hart->flags &= (uint16_t)~RV_HART_FLAG_MEMORY_SYSBUS;
 	uint32_t sysbus_status;
 	/*
 	 * Try reading the system bus access control and status register.
 	 * Check if the value read back is non-zero for the sbasize field
 	 */
 	if (!riscv_dm_read(hart->dbg_module, RV_DM_SYSBUS_CTRLSTATUS, &sysbus_status) ||
-		!(sysbus_status & RV_DM_SYSBUS_STATUS_ADDR_WIDTH_MASK))
+		!(sysbus_status & RV_DM_SYSBUS_STATUS_ADDR_WIDTH_MASK)) {
+		/* Memory access is going to be via abstract commands, so find out if those can be streamed */
+		riscv_hart_discover_autoexec(hart);
 		return;
+	}
 	/* If all the checks passed, we now have a valid system bus so can proceed with using it for memory access */
 	hart->flags = RV_HART_FLAG_MEMORY_SYSBUS | (sysbus_status & RV_HART_FLAG_ACCESS_WIDTH_MASK);
 	/* System Bus also means the target can have memory read without halting */
@@ -988,22 +1134,29 @@ riscv_match_size_e riscv_breakwatch_match_size(const size_t size)
 	return 0U;
 }
 
+/*
+ * Configure a trigger, as a pair of tdata1 and tdata2 values of the hart's XLEN pointed to by config
+ * and address. This only records the change - it's written to the hardware on the next resume, so a GDB
+ * removing and reinserting the same breakpoints around every stop costs no CSR accesses at all.
+ */
 bool riscv_config_trigger(riscv_hart_s *const hart, const uint32_t trigger, const riscv_trigger_state_e mode,
 	const void *const config, const void *const address)
 {
-	/*
-	 * Select the trigger and write the new configuration to it provided by config.
-	 * tdata1 (RV_TRIG_DATA_1) becomes mcontrol (match control) for this -
-	 * see §5.2.9 pg53 of the RISC-V debug spec v0.13.2 for more details.
-	 */
-	const bool result = riscv_csr_write(hart, RV_TRIG_SELECT | RV_CSR_FORCE_32_BIT, &trigger) &&
-		riscv_csr_write(hart, RV_TRIG_DATA_1, config) && riscv_csr_write(hart, RV_TRIG_DATA_2, address);
-	if (result) {
-		/* If that succeeds, update the slot with the new mode it's in */
-		hart->trigger_uses[trigger] &= ~RV_TRIGGER_MODE_MASK;
-		hart->trigger_uses[trigger] |= mode;
+	if (trigger >= hart->triggers)
+		return false;
+	riscv_trigger_s *const state = &hart->trigger_config[trigger];
+	if (hart->access_width == 32U) {
+		state->config = *(const uint32_t *)config;
+		state->address = *(const uint32_t *)address;
+	} else {
+		state->config = *(const uint64_t *)config;
+		state->address = *(const uint64_t *)address;
 	}
-	return result;
+	hart->triggers_dirty |= (uint8_t)(1U << trigger);
+	/* Update the slot with the new mode it's in */
+	hart->trigger_uses[trigger] &= ~RV_TRIGGER_MODE_MASK;
+	hart->trigger_uses[trigger] |= mode;
+	return true;
 }
 
 bool riscv_attach(target_s *const target)
@@ -1048,13 +1201,19 @@ static bool riscv_dm_poll_state(riscv_dm_s *const dbg_module, const uint32_t sta
 	return true;
 }
 
+/* Build the dmcontrol hart selection for halt and resume requests, covering the whole hart array in all-stop mode */
+static uint32_t riscv_hart_group_select(const riscv_hart_s *const hart)
+{
+	return hart->dbg_module->all_stop ? hart->hartsel | RV_DM_CTRL_HART_ARRAY : hart->hartsel;
+}
+
 static void riscv_halt_request(target_s *const target)
 {
 	riscv_hart_s *const hart = riscv_hart_struct(target);
-	/* Request the hart to halt */
-	if (!riscv_dm_write(hart->dbg_module, RV_DM_CONTROL, hart->hartsel | RV_DM_CTRL_HALT_REQ))
+	/* Request the hart (and in all-stop mode, the rest of the hart array with it) to halt */
+	if (!riscv_dm_write(hart->dbg_module, RV_DM_CONTROL, riscv_hart_group_select(hart) | RV_DM_CTRL_HALT_REQ))
 		return;
-	/* Poll for the hart to become halted */
+	/* Poll for the hart(s) to become halted */
 	if (!riscv_dm_poll_state(hart->dbg_module, RV_DM_STAT_ALL_HALTED))
 		return;
 	/* Clear the request now we've got it halted */
@@ -1064,6 +1223,9 @@ static void riscv_halt_request(target_s *const target)
 static void riscv_halt_resume(target_s *target, const bool step)
 {
 	riscv_hart_s *const hart = riscv_hart_struct(target);
+	/* Bring the triggers up to date with everything asked of them while halted */
+	if (!riscv_triggers_sync(hart))
+		return;
 	/* Configure the debug controller for single-stepping as appropriate */
 	uint32_t stepping_config = 0U;
 	if (!riscv_csr_read(hart, RV_DCSR | RV_CSR_FORCE_32_BIT, &stepping_config))
@@ -1076,10 +1238,11 @@ static void riscv_halt_resume(target_s *target, const bool step)
 	}
 	if (!riscv_csr_write(hart, RV_DCSR | RV_CSR_FORCE_32_BIT, &stepping_config))
 		return;
-	/* Request the hart to resume */
-	if (!riscv_dm_write(hart->dbg_module, RV_DM_CONTROL, hart->hartsel | RV_DM_CTRL_RESUME_REQ))
+	/* Request the hart to resume, along with the rest of the hart array in all-stop mode unless single-stepping */
+	const uint32_t hart_select = step ? hart->hartsel : riscv_hart_group_select(hart);
+	if (!riscv_dm_write(hart->dbg_module, RV_DM_CONTROL, hart_select | RV_DM_CTRL_RESUME_REQ))
 		return;
-	/* Poll for the hart to become resumed */
+	/* Poll for the hart(s) to become resumed */
 	if (!riscv_dm_poll_state(hart->dbg_module, RV_DM_STAT_ALL_RESUME_ACK))
 		return;
 	/* Clear the request now we've got it resumed */
@@ -1097,6 +1260,9 @@ static target_halt_reason_e riscv_halt_poll(target_s *const target, target_addr6
 	/* If the hart is currently running, exit out early */
 	if (!(status & RV_DM_STAT_ALL_HALTED))
 		return TARGET_HALT_RUNNING;
+	/* In all-stop mode, this hart halting on its own means the rest of the hart array now needs to halt too */
+	if (hart->dbg_module->all_stop)
+		riscv_halt_request(target);
 	/* Read out DCSR to find out why we're halted */
 	if (!riscv_csr_read(hart, RV_DCSR, &status))
 		return TARGET_HALT_ERROR;
@@ -1140,6 +1306,8 @@ static void riscv_reset(target_s *const target)
 	}
 	/* Acknowledge the reset */
 	riscv_dm_write(hart->dbg_module, RV_DM_CONTROL, hart->hartsel | RV_DM_CTRL_HART_ACK_RESET);
+	/* The reset may or may not have cleared the triggers, so make sure they get put back how they should be */
+	riscv_triggers_invalidate(hart);
 	riscv_halt_request(target);
 	target_check_error(target);
 }
@@ -1187,35 +1355,27 @@ static void riscv_reset(target_s *const target)
  *      <reg name="fcsr" bitsize="32" regnum="68" save-restore="no"/>
  *  </feature>
  */
-static size_t riscv_build_target_fpu_description(char *const buffer, size_t max_length, size_t fpu_size)
+static void riscv_build_target_fpu_description(target_description_stream_s *const stream, const size_t fpu_size)
 {
 	const size_t first_fpu_register = RV_FPU_GDB_OFFSET;             // see riscv_debug.h
 	const size_t first_fpu_control_register = RV_FPU_GDB_CSR_OFFSET; // see riscv_debug.h
-	size_t offset = 0U;
-	size_t print_size = max_length;
-	offset += (size_t)snprintf(buffer + offset, print_size, "</feature><feature name=\"org.gnu.gdb.riscv.fpu\">");
-
-	for (size_t i = 0U; i < ARRAY_LENGTH(riscv_fpu_regs); ++i) {
-		if (max_length != 0U)
-			print_size = max_length - offset;
-		offset += (size_t)snprintf(buffer + offset, print_size,
-			"<reg name=\"f%s\" bitsize=\"%" PRIu32 "\"  regnum=\"%" PRIu32 "\"/>", riscv_fpu_regs[i],
-			(uint32_t)fpu_size, (uint32_t)(i + first_fpu_register));
-	}
-	for (size_t i = 0U; i < ARRAY_LENGTH(riscv_fpu_ctrl_regs); ++i) {
-		if (max_length != 0U)
-			print_size = max_length - offset;
-		offset += (size_t)snprintf(buffer + offset, print_size,
+	target_description_printf(stream, "</feature><feature name=\"org.gnu.gdb.riscv.fpu\">");
+
+	for (size_t i = 0U; i < ARRAY_LENGTH(riscv_fpu_regs); ++i)
+		target_description_printf(stream, "<reg name=\"f%s\" bitsize=\"%" PRIu32 "\"  regnum=\"%" PRIu32 "\"/>",
+			riscv_fpu_regs[i], (uint32_t)fpu_size, (uint32_t)(i + first_fpu_register));
+	for (size_t i = 0U; i < ARRAY_LENGTH(riscv_fpu_ctrl_regs); ++i)
+		target_description_printf(stream,
 			"<reg name=\"f%s\" bitsize=\"%" PRIu32 "\" regnum=\"%" PRIu32 "\" save-restore=\"no\"/>",
 			riscv_fpu_ctrl_regs[i], (uint32_t)fpu_size, (uint32_t)(i + first_fpu_control_register));
-	}
-	return offset;
 }
 
 /*
- * This function creates the target description XML string for a RISC-V part.
+ * This function generates the target description XML string for a RISC-V part.
  * This is done this way to decrease string duplication and thus code size, making it
  * unfortunately much less readable than the string literal it is equivalent to.
+ * Each piece goes through target_description_printf(), which keeps only the part of
+ * the document GDB asked for.
  *
  * This string it creates is the XML-equivalent to the following:
  *  <?xml version=\"1.0\"?>
@@ -1261,80 +1421,63 @@ static size_t riscv_build_target_fpu_description(char *const buffer, size_t max_
  *      </feature>
  *  </target>
  */
-static size_t riscv_build_target_description(
-	char *const buffer, const size_t max_length, const uint8_t address_width, const uint32_t extensions)
+static void riscv_build_target_description(
+	target_description_stream_s *const stream, const uint8_t address_width, const uint32_t extensions)
 {
-	size_t print_size = max_length;
-	/* Start with the "preamble" chunks, which are mostly common across targets save for 2 words. */
-	int offset = snprintf(buffer, print_size, "%s target %sriscv:", gdb_xml_preamble_first, gdb_xml_preamble_second);
-	if (max_length != 0)
-		print_size = max_length - (size_t)offset;
-	/* Write the architecture string, which is the ISA subset */
-	offset += riscv_snprint_isa_subset(buffer + offset, print_size, address_width, extensions);
-	if (max_length != 0)
-		print_size = max_length - (size_t)offset;
-	/* Finally finish the rest of the preamble */
-	offset +=
-		snprintf(buffer + offset, print_size, "%s <feature name=\"org.gnu.gdb.riscv.cpu\">", gdb_xml_preamble_third);
-	if (max_length != 0)
-		print_size = max_length - (size_t)offset;
+	/* Start with the preamble, which is common across targets save for the architecture string - the ISA subset */
+	char isa_subset[32U];
+	riscv_snprint_isa_subset(isa_subset, sizeof(isa_subset), address_width, extensions);
+	target_description_puts(stream, GDB_XML_PREAMBLE_START "riscv:");
+	target_description_printf(stream, "%s" GDB_XML_PREAMBLE_END GDB_XML_FEATURE("org.gnu.gdb.riscv.cpu"), isa_subset);
 
 	const uint8_t gprs = extensions & RV_ISA_EXT_EMBEDDED ? 16U : 32U;
 	/* Then build the general purpose register descriptions using the arrays at top of file */
 	/* Note that in a device using the embedded (E) extension, we only generate the first 16. */
 	for (uint8_t i = 0; i < gprs; ++i) {
-		if (max_length != 0)
-			print_size = max_length - offset;
-
 		const char *const name = riscv_gpr_names[i];
 		const gdb_reg_type_e type = riscv_gpr_types[i];
 
-		offset += (size_t)snprintf(buffer + offset, print_size, "<reg name=\"%s\" bitsize=\"%u\"%s%s/>", name,
-			address_width, gdb_reg_type_strings[type], i == 0 ? " regnum=\"0\"" : "");
+		target_description_printf(stream, "<reg name=\"%s\" bitsize=\"%u\"%s%s/>", name, address_width,
+			gdb_reg_type_strings[type], i == 0 ? " regnum=\"0\"" : "");
 	}
 
 	/* Then build the program counter register description, which has the same bitsize as the GPRs. */
-	if (max_length != 0)
-		print_size = max_length - offset;
-	offset += (size_t)snprintf(buffer + offset, print_size, "<reg name=\"pc\" bitsize=\"%u\"%s/>", address_width,
-		gdb_reg_type_strings[GDB_TYPE_CODE_PTR]);
+	target_description_printf(
+		stream, "<reg name=\"pc\" bitsize=\"%u\"%s/>", address_width, gdb_reg_type_strings[GDB_TYPE_CODE_PTR]);
 
 	/* If the target has basic single precision support, generate a block for that */
-	if (extensions & RV_ISA_EXT_SINGLE_FLOAT) {
-		if (max_length != 0)
-			print_size = max_length - offset;
-		offset += riscv_build_target_fpu_description(buffer + offset, print_size, 32);
-	}
+	if (extensions & RV_ISA_EXT_SINGLE_FLOAT)
+		riscv_build_target_fpu_description(stream, 32);
 
 	/* XXX: TODO - implement generation of the FPU feature and registers, double precision */
 
 	/* Add main CSR registers*/
-	if (max_length != 0)
-		print_size = max_length - offset;
-	offset += (size_t)snprintf(buffer + offset, print_size, "</feature><feature name=\"org.gnu.gdb.riscv.csr\">");
-	for (size_t i = 0; i < ARRAY_LENGTH(riscv_csrs); i++) {
-		if (max_length != 0)
-			print_size = max_length - offset;
-		offset += (size_t)snprintf(buffer + offset, print_size,
-			" <reg name=\"%s\" bitsize=\"%u\" regnum=\"%" PRIu32 "\" %s/>", riscv_csrs[i].name, address_width,
-			riscv_csrs[i].csr_number + RV_CSR_GDB_OFFSET, gdb_reg_save_restore_strings[GDB_SAVE_RESTORE_NO]);
-	}
+	target_description_printf(stream, "</feature><feature name=\"org.gnu.gdb.riscv.csr\">");
+	for (size_t i = 0; i < ARRAY_LENGTH(riscv_csrs); i++)
+		target_description_printf(stream, " <reg name=\"%s\" bitsize=\"%u\" regnum=\"%" PRIu32 "\" %s/>",
+			riscv_csrs[i].name, address_width, riscv_csrs[i].csr_number + RV_CSR_GDB_OFFSET,
+			gdb_reg_save_restore_strings[GDB_SAVE_RESTORE_NO]);
 	/* Add the closing tags required */
-	if (max_length != 0)
-		print_size = max_length - offset;
-
-	offset += (size_t)snprintf(buffer + offset, print_size, "</feature></target>");
-	/* offset is now the total length of the string created, discard the sign and return it. */
-	return offset;
+	target_description_printf(stream, "</feature></target>");
 }
 
-static const char *riscv_target_description(target_s *const target)
+static void riscv_target_description(target_s *const target, target_description_stream_s *const stream)
 {
 	const riscv_hart_s *const hart = riscv_hart_struct(target);
-	const size_t description_length =
-		riscv_build_target_description(NULL, 0, hart->address_width, hart->extensions) + 1U;
-	char *const description = malloc(description_length);
-	if (description)
-		(void)riscv_build_target_description(description, description_length, hart->address_width, hart->extensions);
-	return description;
+	riscv_build_target_description(stream, hart->address_width, hart->extensions);
+}
+
+static bool riscv_cmd_all_stop(target_s *const target, const int argc, const char **const argv)
+{
+	riscv_dm_s *const dbg_module = riscv_hart_struct(target)->dbg_module;
+	if (!dbg_module->hart_array) {
+		tc_printf(target, "This Debug Module cannot halt and resume multiple harts together\n");
+		return argc == 1;
+	}
+	if (argc == 1) {
+		tc_printf(target, "All-stop for harts %08" PRIx32 ": %s\n", dbg_module->hart_array,
+			dbg_module->all_stop ? "enabled" : "disabled");
+		return true;
+	}
+	return parse_enable_or_disable(argv[1], &dbg_module->all_stop);
 }
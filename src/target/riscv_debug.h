@@ -95,6 +95,10 @@ typedef enum riscv_match_size {
 #define RV_HART_FLAG_MEMORY_ABSTRACT    (0U << 4U)
 #define RV_HART_FLAG_MEMORY_SYSBUS      (1U << 4U)
 #define RV_HART_FLAG_DATA_GPR_ONLY      (1U << 5U) /* Hart supports Abstract Data commands for GPRs only */
+#define RV_HART_FLAG_ABST_AUTOEXEC      (1U << 6U) /* DM can re-run abstract commands on accessing data0 */
+#define RV_HART_FLAG_NO_POST_INC        (1U << 7U) /* Hart does not support aampostincrement */
+#define RV_HART_FLAG_MEMORY_PROGBUF     (1U << 8U) /* Hart has no abstract memory access, use the progbuf */
+#define RV_HART_FLAG_SYSBUS_POLL        (1U << 9U) /* System Bus can't keep up with streaming, poll sbbusy */
 
 typedef struct riscv_dmi riscv_dmi_s;
 
@@ -106,7 +110,13 @@ struct riscv_dmi {
 	riscv_debug_version_e version;
 
 	uint8_t dev_index;
+	/* How many cycles to idle in Run-Test/Idle after each DMI scan, adjusted as the DTM reports busy */
 	uint8_t idle_cycles;
+	/* The lower bound for that from DTMCS.idle, and the fewest cycles since learnt not to get busy */
+	uint8_t idle_min;
+	uint8_t idle_floor;
+	/* How many scans have run without a busy since idle_cycles last changed */
+	uint16_t idle_streak;
 	uint8_t address_width;
 	uint8_t fault;
 
@@ -114,6 +124,9 @@ struct riscv_dmi {
 	void (*quiesce)(target_s *target);
 	bool (*read)(riscv_dmi_s *dmi, uint32_t address, uint32_t *value);
 	bool (*write)(riscv_dmi_s *dmi, uint32_t address, uint32_t value);
+	/* Optional, run a series of accesses to the same register back to back */
+	bool (*read_block)(riscv_dmi_s *dmi, uint32_t address, uint32_t *values, size_t count);
+	bool (*write_block)(riscv_dmi_s *dmi, uint32_t address, const uint32_t *values, size_t count);
 };
 
 /* This structure represent a DMI bus that is accessed via an ADI AP */
@@ -129,10 +142,21 @@ typedef struct riscv_dm {
 	riscv_dmi_s *dmi_bus;
 	uint32_t base;
 	riscv_debug_version_e version;
+
+	/* Mask of the harts (from the first 32) that can be selected together via hasel, 0 if unsupported */
+	uint32_t hart_array;
+	/* Whether to halt and resume all the harts in the hart array together */
+	bool all_stop;
 } riscv_dm_s;
 
 #define RV_TRIGGERS_MAX 8U
 
+/* The tdata1 and tdata2 values for a trigger, as wide as the hart's XLEN */
+typedef struct riscv_trigger {
+	uint64_t config;
+	uint64_t address;
+} riscv_trigger_s;
+
 /* This represents a specific Hart on a DM */
 typedef struct riscv_hart {
 	riscv_dm_s *dbg_module;
@@ -140,7 +164,7 @@ typedef struct riscv_hart {
 	uint32_t hartsel;
 	uint8_t access_width;
 	uint8_t address_width;
-	uint8_t flags;
+	uint16_t flags;
 	uint8_t progbuf_size;
 	riscv_hart_status_e status;
 
@@ -154,6 +178,13 @@ typedef struct riscv_hart {
 
 	uint32_t triggers;
 	uint32_t trigger_uses[RV_TRIGGERS_MAX];
+	/*
+	 * What each trigger has been configured as, and what the hardware was last programmed with. Changes
+	 * are only written out on resume, for those triggers marked in triggers_dirty that actually differ.
+	 */
+	riscv_trigger_s trigger_config[RV_TRIGGERS_MAX];
+	riscv_trigger_s trigger_programmed[RV_TRIGGERS_MAX];
+	uint8_t triggers_dirty;
 } riscv_hart_s;
 
 #define RV_STATUS_VERSION_MASK 0x0000000fU
@@ -164,6 +195,8 @@ typedef struct riscv_hart {
 #define RV_DM_DATA3             0x07U
 #define RV_DM_ABST_CTRLSTATUS   0x16U
 #define RV_DM_ABST_COMMAND      0x17U
+#define RV_DM_ABST_AUTO         0x18U
+#define RV_DM_PROGBUF_BASE      0x20U
 #define RV_DM_SYSBUS_CTRLSTATUS 0x38U
 #define RV_DM_SYSBUS_ADDR0      0x39U
 #define RV_DM_SYSBUS_ADDR1      0x3aU
@@ -173,6 +206,8 @@ typedef struct riscv_hart {
 #define RV_DM_ABST_CMD_ACCESS_REG 0x00000000U
 #define RV_DM_ABST_CMD_ACCESS_MEM 0x02000000U
 
+#define RV_DM_ABST_AUTO_DATA0 (1U << 0U)
+
 #define RV_ABST_READ          (0U << 16U)
 #define RV_ABST_WRITE         (1U << 16U)
 #define RV_REG_XFER           (1U << 17U)
@@ -194,8 +229,12 @@ typedef struct riscv_hart {
 #define RV_SYSBUS_MEM_READ_ON_ADDR  0x00100000U
 #define RV_SYSBUS_MEM_READ_ON_DATA  0x00008000U
 #define RV_SYSBUS_STATUS_BUSY       0x00200000U
+#define RV_SYSBUS_STATUS_BUSY_ERROR 0x00400000U
 #define RV_SYSBUS_MEM_ACCESS_SHIFT  17U
 
+/* ebreak, used to end program buffer programs when the DM doesn't provide an implicit one */
+#define RV_EBREAK 0x00100073U
+
 /* dpc -> Debug Program Counter */
 #define RV_DPC 0x7b1U
 /* The GPR base defines the starting register space address for the CPU state registers */
@@ -284,6 +323,8 @@ void riscv_adi_dtm_handler(adiv5_access_port_s *ap);
 #endif
 bool riscv_jtag_dmi_read(riscv_dmi_s *dmi, uint32_t address, uint32_t *value);
 bool riscv_jtag_dmi_write(riscv_dmi_s *dmi, uint32_t address, uint32_t value);
+bool riscv_jtag_dmi_read_block(riscv_dmi_s *dmi, uint32_t address, uint32_t *values, size_t count);
+bool riscv_jtag_dmi_write_block(riscv_dmi_s *dmi, uint32_t address, const uint32_t *values, size_t count);
 
 void riscv_dmi_init(riscv_dmi_s *dmi);
 riscv_hart_s *riscv_hart_struct(target_s *target);
@@ -295,6 +336,8 @@ void bmda_riscv_jtag_dtm_init(riscv_dmi_s *dmi);
 
 bool riscv_dm_read(riscv_dm_s *dbg_module, uint8_t address, uint32_t *value);
 bool riscv_dm_write(riscv_dm_s *dbg_module, uint8_t address, uint32_t value);
+bool riscv_dm_read_block(riscv_dm_s *dbg_module, uint8_t address, uint32_t *values, size_t count);
+bool riscv_dm_write_block(riscv_dm_s *dbg_module, uint8_t address, const uint32_t *values, size_t count);
 bool riscv_command_wait_complete(riscv_hart_s *hart);
 bool riscv_csr_read(riscv_hart_s *hart, uint16_t reg, void *data);
 bool riscv_csr_write(riscv_hart_s *hart, uint16_t reg, const void *data);
@@ -309,6 +352,16 @@ uint8_t riscv_mem_access_width(const riscv_hart_s *hart, target_addr_t address,
 void riscv32_unpack_data(void *dest, uint32_t data, uint8_t access_width);
 uint32_t riscv32_pack_data(const void *src, uint8_t access_width);
 
+/* Abstract command and System Bus access helpers shared between the RV32 and RV64 memory access paths */
+bool riscv32_abstract_mem_command(riscv_hart_s *hart, uint32_t *command);
+uint32_t riscv32_abstract_mem_access(
+	const riscv_hart_s *hart, uint32_t direction, uint8_t access_width, size_t access_length, size_t len);
+bool riscv32_abstract_stream_complete(riscv_hart_s *hart);
+bool riscv32_stream_read(riscv_hart_s *hart, uint8_t reg, uint8_t *data, size_t count, uint8_t access_width);
+bool riscv32_stream_write(riscv_hart_s *hart, uint8_t reg, const uint8_t *data, size_t count, uint8_t access_width);
+void riscv_sysbus_check(riscv_hart_s *hart);
+bool riscv32_sysbus_stream_complete(riscv_hart_s *hart);
+
 void riscv32_mem_read(target_s *target, void *dest, target_addr64_t src, size_t len);
 void riscv32_mem_write(target_s *target, target_addr64_t dest, const void *src, size_t len);
 
@@ -57,6 +57,12 @@
 #define RV_DMI_FAILURE  2U
 #define RV_DMI_TOO_SOON 3U
 
+/* Past this many idle cycles, the DTM still being busy is treated as a hard error */
+#define RV_DMI_IDLE_CYCLES_MAX 32U
+/* How many busy-free scans before trying one idle cycle fewer, and before relaxing the learnt floor */
+#define RV_DMI_IDLE_DECAY_SCANS 256U
+#define RV_DMI_IDLE_RELAX_SCANS 4096U
+
 #ifdef CONFIG_RISCV
 static void riscv_jtag_dtm_init(riscv_dmi_s *dmi);
 static uint32_t riscv_shift_dtmcs(const riscv_dmi_s *dmi, uint32_t control);
@@ -97,6 +103,9 @@ static void riscv_jtag_dtm_init(riscv_dmi_s *const dmi)
 	dmi->version = riscv_dtmcs_version(dtmcs);
 	/* Configure the TAP idle cylces based on what we've read */
 	dmi->idle_cycles = (dtmcs & RV_DTMCS_IDLE_CYCLES_MASK) >> RV_DTMCS_IDLE_CYCLES_SHIFT;
+	dmi->idle_min = dmi->idle_cycles;
+	dmi->idle_floor = dmi->idle_cycles;
+	dmi->idle_streak = 0U;
 	/* And figure out how many address bits the DMI address space has */
 	dmi->address_width = (dtmcs & RV_DTMCS_ADDRESS_MASK) >> RV_DTMCS_ADDRESS_SHIFT;
 	/* Switch into DMI access mode for speed */
@@ -105,6 +114,8 @@ static void riscv_jtag_dtm_init(riscv_dmi_s *const dmi)
 	dmi->prepare = riscv_jtag_prepare;
 	dmi->read = riscv_jtag_dmi_read;
 	dmi->write = riscv_jtag_dmi_write;
+	dmi->read_block = riscv_jtag_dmi_read_block;
+	dmi->write_block = riscv_jtag_dmi_write_block;
 #if CONFIG_BMDA == 1
 	bmda_riscv_jtag_dtm_init(dmi);
 #endif
@@ -132,50 +143,77 @@ static uint8_t riscv_shift_dmi(riscv_dmi_s *const dmi, const uint8_t operation,
 	const uint32_t data_in, uint32_t *const data_out)
 {
 	jtag_dev_s *device = &jtag_devs[dmi->dev_index];
-	jtagtap_shift_dr();
-	jtag_proc.jtagtap_tdi_seq(false, ones, device->dr_prescan);
+	/* Build the whole scan on the JTAG queue, starting by switching into Shift-DR */
+	jtag_queue_shift_dr();
+	jtag_queue_tdi_seq(false, ones, device->dr_prescan);
 	/* Shift out the 2 bits for the operation, and get the status bits for the previous back */
 	uint8_t status = 0;
-	jtag_proc.jtagtap_tdi_tdo_seq(&status, false, &operation, 2U);
+	jtag_queue_tdi_tdo_seq(&status, false, &operation, 2U);
 	/* Then the data component */
-	if (data_out)
-		jtag_proc.jtagtap_tdi_tdo_seq((uint8_t *)data_out, false, (const uint8_t *)&data_in, 32U);
-	else
-		jtag_proc.jtagtap_tdi_seq(false, (const uint8_t *)&data_in, 32U);
+	jtag_queue_tdi_tdo_seq((uint8_t *)data_out, false, (const uint8_t *)&data_in, 32U);
 	/* And finally the address component */
-	jtag_proc.jtagtap_tdi_seq(!device->dr_postscan, (const uint8_t *)&address, dmi->address_width);
-	jtag_proc.jtagtap_tdi_seq(true, ones, device->dr_postscan);
-	jtagtap_return_idle(dmi->idle_cycles);
+	jtag_queue_tdi_seq(!device->dr_postscan, (const uint8_t *)&address, dmi->address_width);
+	jtag_queue_tdi_seq(true, ones, device->dr_postscan);
+	/* Return to Run-Test/Idle, idling there as long as the DTM needs, and run the scan */
+	jtag_queue_return_idle(dmi->idle_cycles);
+	jtag_queue_flush();
 	/* Translate error 1 into RV_DMI_FAILURE per the spec */
 	if (status == 1U)
 		return RV_DMI_FAILURE;
 	return status;
 }
 
+/*
+ * The DTM reported busy, so the scan was dropped as the one before it hadn't finished. Note the current idle
+ * count as too few and back off by half as much again, so a target that needs far more than DTMCS.idle
+ * suggested gets there in a handful of busy responses rather than one per idle cycle.
+ */
+static bool riscv_dmi_idle_increase(riscv_dmi_s *const dmi)
+{
+	if (dmi->idle_cycles >= RV_DMI_IDLE_CYCLES_MAX)
+		return false;
+	dmi->idle_floor = dmi->idle_cycles + 1U;
+	dmi->idle_cycles = MIN(dmi->idle_cycles + MAX(dmi->idle_cycles / 2U, 1U), RV_DMI_IDLE_CYCLES_MAX);
+	dmi->idle_streak = 0U;
+	DEBUG_PROTO("DMI busy, now idling for %u cycles\n", dmi->idle_cycles);
+	return true;
+}
+
+/*
+ * The scan went through, so every so often try one idle cycle fewer, working back down to the fewest cycles
+ * that's been found to not get busy. That floor is itself relaxed towards DTMCS.idle much more slowly, as
+ * what got busy may have been a burst of slower accesses (such as to the system bus) that's since finished.
+ */
+static void riscv_dmi_idle_decay(riscv_dmi_s *const dmi)
+{
+	if (dmi->idle_cycles == dmi->idle_min || ++dmi->idle_streak < RV_DMI_IDLE_DECAY_SCANS)
+		return;
+	if (dmi->idle_cycles > dmi->idle_floor) {
+		--dmi->idle_cycles;
+		dmi->idle_streak = 0U;
+	} else if (dmi->idle_streak >= RV_DMI_IDLE_RELAX_SCANS) {
+		dmi->idle_floor = --dmi->idle_cycles;
+		dmi->idle_streak = 0U;
+	}
+}
+
 static bool riscv_dmi_transfer(riscv_dmi_s *const dmi, const uint8_t operation, const uint32_t address,
 	const uint32_t data_in, uint32_t *const data_out)
 {
 	/* Try the transfer */
 	uint8_t status = riscv_shift_dmi(dmi, operation, address, data_in, data_out);
 
-	/* Handle status == 3 (RV_DMI_TOO_SOON) */
-	if (status == RV_DMI_TOO_SOON) {
-		/*
-		 * If we got RV_DMI_TOO_SOON and we're under 8 idle cycles, increase the number
-		 * of idle cycles used to compensate and have the outer code re-run the transfers
-		 */
-		if (dmi->idle_cycles < 8)
-			++dmi->idle_cycles;
-		/*
-		 * Otherwise we've hit 8 idle cycles, it doesn't matter if we get another
-		 * RV_DMI_TOO_SOON, treat that as a hard error and bail out.
-		 */
-		else
-			status = RV_DMI_FAILURE;
-	}
+	/*
+	 * Handle status == 3 (RV_DMI_TOO_SOON) by idling for longer and having the outer code re-run the
+	 * transfers. If we're already idling as long as we're willing to, treat it as a hard error and bail out.
+	 */
+	if (status == RV_DMI_TOO_SOON && !riscv_dmi_idle_increase(dmi))
+		status = RV_DMI_FAILURE;
+	else if (status == RV_DMI_SUCCESS)
+		riscv_dmi_idle_decay(dmi);
 
 	dmi->fault = status;
-	/* If we get straight failure, do a DMI reset */
+	/* If we get straight failure, do a DMI reset, which is also the only way to clear the sticky busy state */
 	if (status == RV_DMI_FAILURE || status == RV_DMI_TOO_SOON)
 		riscv_dmi_reset(dmi);
 	return status == RV_DMI_SUCCESS;
@@ -213,6 +251,48 @@ bool riscv_jtag_dmi_write(riscv_dmi_s *const dmi, const uint32_t address, const
 	return result;
 }
 
+/*
+ * Pipeline a series of reads of the same DMI register. Each scan starts the next read while capturing
+ * the result of the previous one, so count reads take count + 1 scans rather than twice as many.
+ */
+bool riscv_jtag_dmi_read_block(
+	riscv_dmi_s *const dmi, const uint32_t address, uint32_t *const values, const size_t count)
+{
+	for (size_t offset = 0U; offset <= count;) {
+		const bool last = offset == count;
+		uint32_t *const value = offset ? values + offset - 1U : NULL;
+		/*
+		 * If this comes back RV_DMI_TOO_SOON, the read got dropped as the previous one was still in
+		 * progress. That one still completes though, so reissuing this read also captures its result.
+		 */
+		if (riscv_dmi_transfer(dmi, last ? RV_DMI_NOOP : RV_DMI_READ, last ? 0U : address, 0U, value))
+			++offset;
+		else if (dmi->fault != RV_DMI_TOO_SOON) {
+			DEBUG_WARN("DMI block read at 0x%08" PRIx32 " failed with status %u\n", address, dmi->fault);
+			return false;
+		}
+	}
+	return true;
+}
+
+/* Pipeline a series of writes to the same DMI register, each scan collecting the status of the one before */
+bool riscv_jtag_dmi_write_block(
+	riscv_dmi_s *const dmi, const uint32_t address, const uint32_t *const values, const size_t count)
+{
+	for (size_t offset = 0U; offset <= count;) {
+		const bool last = offset == count;
+		const uint32_t value = last ? 0U : values[offset];
+		/* A RV_DMI_TOO_SOON here means this write got dropped for the previous still being in progress */
+		if (riscv_dmi_transfer(dmi, last ? RV_DMI_NOOP : RV_DMI_WRITE, last ? 0U : address, value, NULL))
+			++offset;
+		else if (dmi->fault != RV_DMI_TOO_SOON) {
+			DEBUG_WARN("DMI block write at 0x%08" PRIx32 " failed with status %u\n", address, dmi->fault);
+			return false;
+		}
+	}
+	return true;
+}
+
 #ifdef CONFIG_RISCV
 static riscv_debug_version_e riscv_dtmcs_version(const uint32_t dtmcs)
 {
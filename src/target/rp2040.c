@@ -192,6 +192,7 @@ static void rp_spi_restore(target_s *target);
 static bool rp_flash_prepare(target_s *target);
 static bool rp_flash_resume(target_s *target);
 static bool rp_flash_write(target_flash_s *flash, target_addr_t dest, const void *src, size_t length);
+static bool rp_flash_write_wait(target_flash_s *flash);
 static void rp_spi_read(target_s *target, uint16_t command, target_addr32_t address, void *buffer, size_t length);
 static void rp_spi_run_command(target_s *target, uint16_t command, target_addr32_t address);
 static uint32_t rp_get_flash_length(target_s *target);
@@ -215,6 +216,12 @@ static void rp_add_flash(target_s *target)
 	spi_flash_s *flash = bmp_spi_add_flash(
 		target, RP_XIP_FLASH_BASE, rp_get_flash_length(target), rp_spi_read, NULL, rp_spi_run_command);
 	flash->flash.write = rp_flash_write;
+	flash->flash.write_wait = rp_flash_write_wait;
+	/* The Flash chips used with these parts all have the usual 64KiB block erase, so use it if SFDP didn't say */
+	if (!flash->flash.erase_span) {
+		flash->flash.erase_span = FLASHSIZE_64K_BLOCK;
+		flash->block_erase_opcode = SPI_FLASH_OPCODE_BLOCK_ERASE;
+	}
 
 	rp_spi_restore(target);
 	if (por_state)
@@ -353,13 +360,21 @@ static bool rp_flash_write(
 {
 	target_s *const target = flash->t;
 	const spi_flash_s *const spi_flash = (spi_flash_s *)flash;
-	/* Load the next block of data and run the stub */
+	/*
+	 * Load the next block of data and start the stub on it. It's waited on in rp_flash_write_wait(),
+	 * so the next block can be received from the host while this one programs
+	 */
 	if (target_mem32_write(target, RP_STUB_BUFFER_BASE, src, length))
 		return false;
-	return cortexm_run_stub(
+	return cortexm_start_stub(
 		target, RP_SRAM_BASE, dest - flash->start, RP_STUB_BUFFER_BASE, length, spi_flash->page_size);
 }
 
+static bool rp_flash_write_wait(target_flash_s *const flash)
+{
+	return cortexm_wait_stub(flash->t, 5000U);
+}
+
 static void rp_spi_chip_select(target_s *const target, const uint32_t state)
 {
 	const uint32_t value = target_mem32_read32(target, RP_GPIO_QSPI_CS_CTRL);
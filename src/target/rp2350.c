@@ -47,6 +47,8 @@
 #define RP2350_SRAM_BASE      0x20000000U
 #define RP2350_SRAM_SIZE      0x00082000U
 
+#define RP2350_FLASH_BLOCK_SIZE 0x00010000U
+
 #define RP2350_REG_ACCESS_NORMAL              0x0000U
 #define RP2350_REG_ACCESS_WRITE_XOR           0x1000U
 #define RP2350_REG_ACCESS_WRITE_ATOMIC_BITSET 0x2000U
@@ -148,8 +150,13 @@ static void rp2350_add_flash(target_s *const target)
 		const uint32_t capacity = 1U << flash_id.capacity;
 		DEBUG_INFO("SPI Flash: mfr = %02x, type = %02x, capacity = %08" PRIx32 "\n", flash_id.manufacturer,
 			flash_id.type, capacity);
-		bmp_spi_add_flash(target, RP2350_XIP_FLASH_BASE, MIN(capacity, RP2350_XIP_FLASH_SIZE), rp2350_spi_read,
-			rp2350_spi_write, rp2350_spi_run_command);
+		spi_flash_s *const flash = bmp_spi_add_flash(target, RP2350_XIP_FLASH_BASE,
+			MIN(capacity, RP2350_XIP_FLASH_SIZE), rp2350_spi_read, rp2350_spi_write, rp2350_spi_run_command);
+		/* As for the RP2040, assume the usual 64KiB block erase if SFDP didn't describe one */
+		if (flash && !flash->flash.erase_span) {
+			flash->flash.erase_span = RP2350_FLASH_BLOCK_SIZE;
+			flash->block_erase_opcode = SPI_FLASH_OPCODE_BLOCK_ERASE;
+		}
 	}
 	if (mode_switched)
 		rp2350_spi_resume(target);
@@ -440,8 +447,8 @@ static void rp2350_spi_write(target_s *const target, const uint16_t command, con
 		target_mem32_write32(target, RP2350_QMI_DIRECT_TX,
 			RP2350_QMI_DIRECT_TX_MODE_SINGLE | RP2350_QMI_DIRECT_TX_DATA_16BIT | RP2350_QMI_DIRECT_TX_NOPUSH_RX |
 				read_le2(data, i));
-		/* Every 8 bytes when page programming, invalidate the associated cache line */
-		if (command == SPI_FLASH_CMD_PAGE_PROGRAM && (i & 7U) == 7U)
+		/* Every 8 bytes when page programming, invalidate the associated cache line (i is always even here) */
+		if (command == SPI_FLASH_CMD_PAGE_PROGRAM && (i & 7U) == 6U)
 			target_mem32_write32(
 				target, RP2350_XIP_CACHE_BASE + RP2350_XIP_CACHE_INVALIDATE_BY_ADDRESS + address + (i & ~7U), 0U);
 	}
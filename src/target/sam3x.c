@@ -32,6 +32,7 @@
 static bool sam_flash_erase(target_flash_s *f, target_addr_t addr, size_t len);
 static bool sam3_flash_erase(target_flash_s *f, target_addr_t addr, size_t len);
 static bool sam_flash_write(target_flash_s *f, target_addr_t dest, const void *src, size_t len);
+static bool sam_flash_write_wait(target_flash_s *f);
 
 static bool sam_gpnvm_get(target_s *t, uint32_t base, uint32_t *gpnvm);
 
@@ -205,6 +206,7 @@ static void sam3_add_flash(target_s *t, uint32_t eefc_base, uint32_t addr, size_
 	f->blocksize = SAM_SMALL_PAGE_SIZE;
 	f->erase = sam3_flash_erase;
 	f->write = sam_flash_write;
+	f->write_wait = sam_flash_write_wait;
 	f->writesize = SAM_SMALL_PAGE_SIZE;
 	sf->eefc_base = eefc_base;
 	sf->write_cmd = EEFC_FCR_FCMD_EWP;
@@ -225,6 +227,7 @@ static void sam_add_flash(target_s *t, uint32_t eefc_base, uint32_t addr, size_t
 	f->blocksize = SAM_LARGE_PAGE_SIZE * 8U;
 	f->erase = sam_flash_erase;
 	f->write = sam_flash_write;
+	f->write_wait = sam_flash_write_wait;
 	f->writesize = SAM_LARGE_PAGE_SIZE;
 	sf->eefc_base = eefc_base;
 	sf->write_cmd = EEFC_FCR_FCMD_WP;
@@ -481,7 +484,7 @@ bool sam3x_probe(target_s *t)
 	return false;
 }
 
-static bool sam_flash_cmd(target_s *t, uint32_t base, uint8_t cmd, uint16_t arg)
+static bool sam_flash_cmd_start(target_s *t, uint32_t base, uint8_t cmd, uint16_t arg)
 {
 	DEBUG_INFO("%s: base = 0x%08" PRIx32 " cmd = 0x%02X, arg = 0x%04X\n", __func__, base, cmd, arg);
 
@@ -489,16 +492,23 @@ static bool sam_flash_cmd(target_s *t, uint32_t base, uint8_t cmd, uint16_t arg)
 		return false;
 
 	target_mem32_write32(t, EEFC_FCR(base), EEFC_FCR_FKEY | cmd | ((uint32_t)arg << 8U));
+	return !target_check_error(t);
+}
 
+/* Wait for the EEFC to be ready again, on the probe where it can do this itself */
+static bool sam_flash_cmd_wait(target_s *t, uint32_t base)
+{
 	uint32_t status = 0;
-	while (!(status & EEFC_FSR_FRDY)) {
-		status = target_mem32_read32(t, EEFC_FSR(base));
-		if (target_check_error(t))
-			return false;
-	}
+	if (!target_mem32_poll32(t, EEFC_FSR(base), EEFC_FSR_FRDY, EEFC_FSR_FRDY, 0U, NULL, &status))
+		return false;
 	return !(status & EEFC_FSR_ERROR);
 }
 
+static bool sam_flash_cmd(target_s *t, uint32_t base, uint8_t cmd, uint16_t arg)
+{
+	return sam_flash_cmd_start(t, base, cmd, arg) && sam_flash_cmd_wait(t, base);
+}
+
 static sam_driver_e sam_driver(target_s *t)
 {
 	if (strcmp(t->driver, "Atmel SAM3X") == 0)
@@ -551,8 +561,18 @@ static bool sam_flash_write(target_flash_s *f, target_addr_t dest, const void *s
 	const uint32_t base = sf->eefc_base;
 	const uint32_t chunk = (dest - f->start) / f->writesize;
 
-	target_mem32_write(t, dest, src, len);
-	return sam_flash_cmd(t, base, sf->write_cmd, chunk);
+	/*
+	 * Fill the page latch in one block write, then start programming it. The EEFC is waited on in
+	 * sam_flash_write_wait(), so the next page can be received from the host while this one programs
+	 */
+	if (target_mem32_write(t, dest, src, len))
+		return false;
+	return sam_flash_cmd_start(t, base, sf->write_cmd, chunk);
+}
+
+static bool sam_flash_write_wait(target_flash_s *f)
+{
+	return sam_flash_cmd_wait(f->t, ((sam_flash_s *)f)->eefc_base);
 }
 
 static bool sam_gpnvm_get(target_s *t, uint32_t base, uint32_t *gpnvm)
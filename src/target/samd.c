@@ -44,6 +44,7 @@
 
 static bool samd_flash_erase(target_flash_s *f, target_addr_t addr, size_t len);
 static bool samd_flash_write(target_flash_s *f, target_addr_t dest, const void *src, size_t len);
+static bool samd_flash_write_wait(target_flash_s *f);
 /* NB: This is not marked static on purpose as it's used by samx5x.c. */
 bool samd_mass_erase(target_s *t, platform_timeout_s *print_progess);
 
@@ -255,6 +256,9 @@ void samd_reset(target_s *t)
 	 * XXX: Should this actually call cortexm_reset()?
 	 */
 
+	/* The reset throws away the core state, so drop any cached registers */
+	cortexm_reg_cache_invalidate(t);
+
 	/* Read DHCSR here to clear S_RESET_ST bit before reset */
 	target_mem32_read32(t, CORTEXM_DHCSR);
 
@@ -494,6 +498,7 @@ static void samd_add_flash(target_s *t, uint32_t addr, size_t length)
 	f->blocksize = SAMD_ROW_SIZE;
 	f->erase = samd_flash_erase;
 	f->write = samd_flash_write;
+	f->write_wait = samd_flash_write_wait;
 	f->writesize = SAMD_PAGE_SIZE;
 	target_add_flash(t, f);
 }
@@ -654,14 +659,22 @@ static bool samd_flash_write(target_flash_s *f, target_addr_t dest, const void *
 	/* Unlock */
 	samd_unlock_current_address(t);
 
-	/* Issue the write page command */
+	/*
+	 * Issue the write page command. Completion is waited on in samd_flash_write_wait()
+	 * so the next page can be received from the host while this one programs
+	 */
 	target_mem32_write32(t, SAMD_NVMC_CTRLA, SAMD_CTRLA_CMD_KEY | SAMD_CTRLA_CMD_WRITEPAGE);
+	return !target_check_error(t);
+}
+
+static bool samd_flash_write_wait(target_flash_s *const f)
+{
+	target_s *const t = f->t;
 	if (!samd_wait_nvm_ready(t))
 		return false;
 
 	/* Lock */
 	samd_lock_current_address(t);
-
 	return true;
 }
 
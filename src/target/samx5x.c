@@ -42,6 +42,7 @@
 
 static bool samx5x_flash_erase(target_flash_s *f, target_addr_t addr, size_t len);
 static bool samx5x_flash_write(target_flash_s *f, target_addr_t dest, const void *src, size_t len);
+static bool samx5x_flash_write_wait(target_flash_s *f);
 static bool samx5x_user_page_erase(target_flash_s *f, target_addr_t addr, size_t len);
 static bool samx5x_user_page_write(target_flash_s *f, target_addr_t dest, const void *src, size_t len);
 static bool samx5x_cmd_lock_flash(target_s *t, int argc, const char **argv);
@@ -314,6 +315,7 @@ static void samx5x_add_flash(target_s *t, uint32_t addr, size_t length, size_t e
 	f->blocksize = erase_block_size;
 	f->erase = samx5x_flash_erase;
 	f->write = samx5x_flash_write;
+	f->write_wait = samx5x_flash_write_wait;
 	f->writesize = write_page_size;
 	f->erased = 0xffU;
 	target_add_flash(t, f);
@@ -546,7 +548,6 @@ static bool samx5x_flash_write(target_flash_s *f, target_addr_t dest, const void
 		samx5x_clear_nvm_error(t);
 	}
 
-	bool error = false;
 	/* Unlock */
 	target_mem32_write32(t, SAMX5X_NVMC_ADDRESS, dest);
 	samx5x_unlock_current_address(t);
@@ -554,9 +555,18 @@ static bool samx5x_flash_write(target_flash_s *f, target_addr_t dest, const void
 	/* Write within a single page. This may be part or all of the page */
 	target_mem32_write(t, dest, src, len);
 
-	/* Issue the write page command */
+	/*
+	 * Issue the write page command. Completion is waited on in samx5x_flash_write_wait()
+	 * so the next page can be received from the host while this one programs
+	 */
 	target_mem32_write32(t, SAMX5X_NVMC_CTRLB, SAMX5X_CTRLB_CMD_KEY | SAMX5X_CTRLB_CMD_WRITEPAGE);
+	return !target_check_error(t);
+}
 
+static bool samx5x_flash_write_wait(target_flash_s *const f)
+{
+	target_s *const t = f->t;
+	bool error = false;
 	/* Poll for NVM Ready */
 	while ((target_mem32_read32(t, SAMX5X_NVMC_STATUS) & SAMX5X_STATUS_READY) == 0U) {
 		if (target_check_error(t) || samx5x_check_nvm_error(t)) {
@@ -566,7 +576,7 @@ static bool samx5x_flash_write(target_flash_s *f, target_addr_t dest, const void
 	}
 
 	if (error || target_check_error(t) || samx5x_check_nvm_error(t)) {
-		DEBUG_ERROR("Error writing flash page at 0x%08" PRIx32 " (len 0x%08" PRIx32 ")\n", dest, (uint32_t)len);
+		DEBUG_ERROR("Error writing flash page at 0x%08" PRIx32 "\n", target_mem32_read32(t, SAMX5X_NVMC_ADDRESS));
 		return false;
 	}
 
@@ -50,6 +50,9 @@
 #include "semihosting_internal.h"
 #include "buffer_utils.h"
 #include "timeofday.h"
+#ifdef SEMIHOSTING_RAMFS_SIZE
+#include "semihosting_ramfs.h"
+#endif
 
 #include <string.h>
 #include <stdio.h>
@@ -127,6 +130,43 @@ const char *const semihosting_names[] = {
 static semihosting_errno_e semihosting_errno(void);
 #endif
 
+/*
+ * Console output from SYS_WRITEC and SYS_WRITE0 is coalesced here so that firmware writing a
+ * character at a time doesn't cost a whole GDB round trip per character. It's flushed on newline,
+ * when full, before any other semihosting call, and when the target halt gets reported to GDB.
+ */
+static char semihosting_console_buffer[GDB_OUT_PACKET_MAX_SIZE];
+static size_t semihosting_console_used = 0U;
+
+void semihosting_console_flush(target_s *const target)
+{
+	if (!semihosting_console_used)
+		return;
+	if (target->stdout_redirected) {
+#if CONFIG_BMDA == 0
+		debug_serial_send_stdout((const uint8_t *)semihosting_console_buffer, semihosting_console_used);
+#else
+		if (write(STDOUT_FILENO, semihosting_console_buffer, semihosting_console_used) == -1)
+			target->tc->gdb_errno = semihosting_errno();
+#endif
+	} else
+		/* Console output packets need no reply from GDB, unlike an Fwrite */
+		gdb_put_packet("O", 1U, semihosting_console_buffer, semihosting_console_used, true);
+	semihosting_console_used = 0U;
+}
+
+static void semihosting_console_append(target_s *const target, const char *const data, const size_t length)
+{
+	for (size_t offset = 0U; offset < length;) {
+		const size_t amount = MIN(length - offset, sizeof(semihosting_console_buffer) - semihosting_console_used);
+		memcpy(semihosting_console_buffer + semihosting_console_used, data + offset, amount);
+		semihosting_console_used += amount;
+		if (semihosting_console_used == sizeof(semihosting_console_buffer) || memchr(data + offset, '\n', amount))
+			semihosting_console_flush(target);
+		offset += amount;
+	}
+}
+
 int32_t semihosting_reply(target_controller_s *const tc, const char *const pbuf)
 {
 	/*
@@ -193,23 +233,86 @@ static int32_t semihosting_get_gdb_response(target_controller_s *const tc)
 	}
 }
 
-/* Interface to host system calls */
-static int32_t semihosting_remote_read(
+#if CONFIG_BMDA == 1
+/*
+ * Service a read request against a host file directly, without involving GDB's File-I/O.
+ * The data is moved in large chunks so each lands in the target with a single block write.
+ */
+static int32_t semihosting_local_read(
 	target_s *const target, const int32_t fd, const target_addr_t buf_taddr, const uint32_t count)
 {
-#if CONFIG_BMDA == 1
-	if ((target->stdout_redirected && fd == STDIN_FILENO) || fd > STDERR_FILENO) {
-		uint8_t *const buf = malloc(count);
-		if (buf == NULL)
+	uint8_t *const buffer = malloc(MIN(count, SEMIHOSTING_BULK_BUF_SIZE));
+	if (buffer == NULL)
+		return -1;
+	uint32_t offset = 0U;
+	while (offset < count) {
+		const size_t amount = MIN(count - offset, SEMIHOSTING_BULK_BUF_SIZE);
+		const ssize_t result = read(fd, buffer, amount);
+		if (result == -1) {
+			target->tc->gdb_errno = semihosting_errno();
+			/* Only report the failure if nothing was transferred, otherwise report what did make it */
+			if (offset == 0U) {
+				free(buffer);
+				return -1;
+			}
+			break;
+		}
+		target_mem32_write(target, buf_taddr + offset, buffer, (size_t)result);
+		if (target_check_error(target)) {
+			free(buffer);
 			return -1;
-		const ssize_t result = read(fd, buf, count);
-		target->tc->gdb_errno = semihosting_errno();
-		target_mem32_write(target, buf_taddr, buf, count);
-		free(buf);
-		if (target_check_error(target))
+		}
+		offset += (uint32_t)result;
+		/* A short read means we've hit the end of the file (or the pipe ran dry), so stop */
+		if ((size_t)result < amount)
+			break;
+	}
+	free(buffer);
+	return (int32_t)offset;
+}
+
+/*
+ * Service a write request against a host file directly, without involving GDB's File-I/O.
+ * The data is pulled from the target in large chunks using single block reads.
+ */
+static int32_t semihosting_local_write(
+	target_s *const target, const int32_t fd, const target_addr_t buf_taddr, const uint32_t count)
+{
+	uint8_t *const buffer = malloc(MIN(count, SEMIHOSTING_BULK_BUF_SIZE));
+	if (buffer == NULL)
+		return -1;
+	uint32_t offset = 0U;
+	while (offset < count) {
+		const size_t amount = MIN(count - offset, SEMIHOSTING_BULK_BUF_SIZE);
+		target_mem32_read(target, buffer, buf_taddr + offset, amount);
+		if (target_check_error(target)) {
+			free(buffer);
 			return -1;
-		return result;
+		}
+		/* write() may only take part of the chunk, so keep going till it's all gone or we get an error */
+		for (size_t written = 0U; written < amount;) {
+			const ssize_t result = write(fd, buffer + written, amount - written);
+			if (result == -1) {
+				target->tc->gdb_errno = semihosting_errno();
+				free(buffer);
+				return offset ? (int32_t)offset : -1;
+			}
+			written += (size_t)result;
+			offset += (uint32_t)result;
+		}
 	}
+	free(buffer);
+	return (int32_t)offset;
+}
+#endif
+
+/* Interface to host system calls */
+static int32_t semihosting_remote_read(
+	target_s *const target, const int32_t fd, const target_addr_t buf_taddr, const uint32_t count)
+{
+#if CONFIG_BMDA == 1
+	if ((target->stdout_redirected && fd == STDIN_FILENO) || fd > STDERR_FILENO)
+		return semihosting_local_read(target, fd, buf_taddr, count);
 #endif
 	gdb_putpacket_str_f("Fread,%08X,%08" PRIX32 ",%08" PRIX32, (unsigned)fd, buf_taddr, count);
 	return semihosting_get_gdb_response(target->tc);
@@ -220,27 +323,15 @@ static int32_t semihosting_remote_write(
 	target_s *const target, const int32_t fd, const target_addr_t buf_taddr, const uint32_t count)
 {
 #if CONFIG_BMDA == 1
-	if (fd > STDERR_FILENO) {
-		uint8_t *const buf = malloc(count);
-		if (buf == NULL)
-			return -1;
-		target_mem32_read(target, buf, buf_taddr, count);
-		if (target_check_error(target)) {
-			free(buf);
-			return -1;
-		}
-		const int32_t result = write(fd, buf, count);
-		target->tc->gdb_errno = semihosting_errno();
-		free(buf);
-		return result;
-	}
+	if (fd > STDERR_FILENO)
+		return semihosting_local_write(target, fd, buf_taddr, count);
 #endif
 
 	if (target->stdout_redirected && (fd == STDOUT_FILENO || fd == STDERR_FILENO)) {
 		uint8_t buffer[STDOUT_READ_BUF_SIZE];
 		for (size_t offset = 0; offset < count; offset += STDOUT_READ_BUF_SIZE) {
 			const size_t amount = MIN(count - offset, STDOUT_READ_BUF_SIZE);
-			target_mem32_read(target, buffer, buf_taddr, amount);
+			target_mem32_read(target, buffer, buf_taddr + offset, amount);
 #if CONFIG_BMDA == 0
 			debug_serial_send_stdout(buffer, amount);
 #else
@@ -382,6 +473,19 @@ int32_t semihosting_open(target_s *const target, const semihosting_s *const requ
 		}
 	}
 
+#ifdef SEMIHOSTING_RAMFS_SIZE
+	/* Write-only opens (w, wb, a, ab) of suitably short names get captured into the probe's file store */
+	const uint32_t fopen_mode = request->params[1] >> 1U;
+	if (semihosting_ramfs_enabled && (fopen_mode == 2U || fopen_mode == 4U) &&
+		file_name_length < SEMIHOSTING_RAMFS_NAME_LENGTH) {
+		char file_name[SEMIHOSTING_RAMFS_NAME_LENGTH];
+		if (target_mem32_read(target, file_name, file_name_taddr, file_name_length + 1U))
+			return -1;
+		file_name[file_name_length] = '\0';
+		return semihosting_ramfs_open(file_name, fopen_mode == 2U);
+	}
+#endif
+
 #if CONFIG_BMDA == 1
 	const char *const file_name = semihosting_read_string(target, file_name_taddr, file_name_length);
 	if (file_name == NULL)
@@ -425,6 +529,10 @@ int32_t semihosting_close(target_s *const target, const semihosting_s *const req
 	 */
 	if (fd == STDIN_FILENO || fd == STDOUT_FILENO || fd == STDERR_FILENO || request->params[0] == INT32_MAX)
 		return 0;
+#ifdef SEMIHOSTING_RAMFS_SIZE
+	if (semihosting_ramfs_is_handle(request->params[0]))
+		return semihosting_ramfs_close(request->params[0]);
+#endif
 		/* Otherwise close the descriptor returned by semihosting_open() */
 #if CONFIG_BMDA == 1
 	const int32_t result = close(fd);
@@ -455,6 +563,11 @@ int32_t semihosting_read(target_s *const target, const semihosting_s *const requ
 		/* Return how much was left from what we transferred */
 		return (int32_t)(buf_len - amount);
 	}
+#ifdef SEMIHOSTING_RAMFS_SIZE
+	/* Files in the probe's store are write-only */
+	if (semihosting_ramfs_is_handle(request->params[0]))
+		return -1;
+#endif
 
 	const int32_t fd = request->params[0] - 1;
 	const int32_t result = semihosting_remote_read(target, fd, buf_taddr, buf_len);
@@ -476,6 +589,14 @@ int32_t semihosting_write(target_s *const target, const semihosting_s *const req
 	if (buf_len == 0)
 		return 0;
 #endif
+#ifdef SEMIHOSTING_RAMFS_SIZE
+	if (semihosting_ramfs_is_handle(request->params[0])) {
+		const int32_t result = semihosting_ramfs_write(target, request->params[0], buf_taddr, buf_len);
+		if (result >= 0)
+			return (int32_t)(buf_len - (uint32_t)result);
+		return result;
+	}
+#endif
 
 	const int32_t result = semihosting_remote_write(target, fd, buf_taddr, buf_len);
 	if (result >= 0)
@@ -485,30 +606,40 @@ int32_t semihosting_write(target_s *const target, const semihosting_s *const req
 
 int32_t semihosting_writec(target_s *const target, const semihosting_s *const request)
 {
-	const target_addr_t ch_taddr = request->r1;
-	(void)semihosting_remote_write(target, STDOUT_FILENO, ch_taddr, 1);
+	const char ch = (char)target_mem32_read8(target, request->r1);
+	if (target_check_error(target))
+		return 0;
+	semihosting_console_append(target, &ch, 1U);
 	return 0;
 }
 
 int32_t semihosting_write0(target_s *const target, const semihosting_s *const request)
 {
-	const target_addr_t str_begin_taddr = request->r1;
-	target_addr_t str_end_taddr;
-	for (str_end_taddr = str_begin_taddr; target_mem32_read8(target, str_end_taddr) != 0; ++str_end_taddr) {
-		if (target_check_error(target))
-			break;
-	}
-	const int32_t len = str_end_taddr - str_begin_taddr;
-	if (len >= 0) {
-		const int32_t result = semihosting_remote_write(target, STDOUT_FILENO, str_begin_taddr, len);
-		if (result != len)
+	char buffer[STDOUT_READ_BUF_SIZE];
+	for (target_addr_t str_taddr = request->r1;;) {
+		/*
+		 * Read the string ahead in blocks that stay within one naturally aligned chunk
+		 * so we can't run off the end of a memory region the string itself lives in
+		 */
+		const size_t amount = STDOUT_READ_BUF_SIZE - (str_taddr & (STDOUT_READ_BUF_SIZE - 1U));
+		if (target_mem32_read(target, buffer, str_taddr, amount))
 			return -1;
+		const char *const terminator = memchr(buffer, '\0', amount);
+		const size_t length = terminator ? (size_t)(terminator - buffer) : amount;
+		semihosting_console_append(target, buffer, length);
+		if (terminator)
+			break;
+		str_taddr += amount;
 	}
 	return 0;
 }
 
 int32_t semihosting_isatty(target_s *const target, const semihosting_s *const request)
 {
+#ifdef SEMIHOSTING_RAMFS_SIZE
+	if (semihosting_ramfs_is_handle(request->params[0]))
+		return 0;
+#endif
 	const int32_t fd = request->params[0] - 1;
 #if CONFIG_BMDA == 1
 	if (!target->stdout_redirected || fd > STDERR_FILENO) {
@@ -533,6 +664,11 @@ int32_t semihosting_seek(target_s *const target, const semihosting_s *const requ
 			semihosting_features_offset = SEMIHOSTING_FEATURES_LENGTH;
 		return 0;
 	}
+#ifdef SEMIHOSTING_RAMFS_SIZE
+	/* Files in the probe's store can only be appended to */
+	if (semihosting_ramfs_is_handle(request->params[0]))
+		return -1;
+#endif
 #if CONFIG_BMDA == 1
 	if (!target->stdout_redirected || fd > STDERR_FILENO) {
 		const int32_t result = lseek(fd, offset, SEEK_SET) == offset ? 0 : -1;
@@ -604,6 +740,10 @@ int32_t semihosting_file_length(target_s *const target, const semihosting_s *con
 	/* Check if this is a request for the length of the :semihosting-features "file" */
 	if (request->params[0] == INT32_MAX)
 		return SEMIHOSTING_FEATURES_LENGTH;
+#ifdef SEMIHOSTING_RAMFS_SIZE
+	if (semihosting_ramfs_is_handle(request->params[0]))
+		return semihosting_ramfs_length(request->params[0]);
+#endif
 
 	const int32_t fd = request->params[0] - 1;
 #if CONFIG_BMDA == 1
@@ -922,5 +1062,10 @@ int32_t semihosting_request(target_s *const target, const uint32_t syscall, cons
 	if (syscall != SEMIHOSTING_SYS_ERRNO)
 		target->tc->gdb_errno = TARGET_SUCCESS;
 #endif
+	/* Keep console output ordered with respect to everything else the target asks for */
+	if (syscall != SEMIHOSTING_SYS_WRITEC && syscall != SEMIHOSTING_SYS_WRITE0)
+		semihosting_console_flush(target);
+	/* Targets making syscalls tend to make them in bursts, so keep polling the target tightly */
+	gdb_halt_poll_reset();
 	return semihosting_handle_request(target, &request, syscall);
 }
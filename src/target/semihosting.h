@@ -29,5 +29,6 @@ extern uint32_t semihosting_wallclock_epoch;
 
 int32_t semihosting_request(target_s *target, uint32_t syscall, uint32_t r1);
 int32_t semihosting_reply(target_controller_s *tc, const char *packet);
+void semihosting_console_flush(target_s *target);
 
 #endif /* TARGET_SEMIHOSTING_H */
@@ -53,6 +53,8 @@
 #define TARGET_NULL ((target_addr_t)0)
 
 #define STDOUT_READ_BUF_SIZE 64U
+/* Size of the chunks BMDA moves between host files and target memory in for SYS_READ/SYS_WRITE */
+#define SEMIHOSTING_BULK_BUF_SIZE 65536U
 
 typedef struct semihosting {
 	uint32_t r1;
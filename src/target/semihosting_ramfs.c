@@ -0,0 +1,216 @@
+/*
+ * This file is part of the Black Magic Debug project.
+ *
+ * Copyright (C) 2026 1BitSquared <info@1bitsquared.com>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * This file implements a small in-probe store for files the target opens for writing via semihosting.
+ * It lets a probe running without BMDA capture things like test logs at full speed, without GDB having
+ * to handle the data, and for them to be pulled off the probe afterwards with `monitor semihosting_fs`.
+ *
+ * The store is a single log-structured arena of records, each a 4 byte header (file index, reserved,
+ * 16-bit little endian length) followed by the data. Consecutive writes to the same file extend the
+ * last record rather than starting a new one. Truncating a file retires its table entry, with the space
+ * only coming back when the whole store is cleared.
+ */
+
+#include "general.h"
+#include "target.h"
+#include "gdb_packet.h"
+#include "buffer_utils.h"
+#include "semihosting_ramfs.h"
+
+#include <string.h>
+
+#define SEMIHOSTING_RAMFS_RECORD_HEADER_LENGTH 4U
+#define SEMIHOSTING_RAMFS_RECORD_MAX_LENGTH    UINT16_MAX
+#define SEMIHOSTING_RAMFS_NO_RECORD            SIZE_MAX
+
+typedef struct semihosting_ramfs_file {
+	char name[SEMIHOSTING_RAMFS_NAME_LENGTH];
+	uint32_t length;
+	bool open;
+	bool retired;
+} semihosting_ramfs_file_s;
+
+bool semihosting_ramfs_enabled = true;
+
+static uint8_t semihosting_ramfs_arena[SEMIHOSTING_RAMFS_SIZE];
+static size_t semihosting_ramfs_used = 0U;
+static size_t semihosting_ramfs_last_record = SEMIHOSTING_RAMFS_NO_RECORD;
+static semihosting_ramfs_file_s semihosting_ramfs_files[SEMIHOSTING_RAMFS_MAX_FILES];
+
+static semihosting_ramfs_file_s *semihosting_ramfs_file(const uint32_t handle)
+{
+	if (!semihosting_ramfs_is_handle(handle))
+		return NULL;
+	semihosting_ramfs_file_s *const file = &semihosting_ramfs_files[handle - SEMIHOSTING_RAMFS_HANDLE_BASE];
+	if (file->name[0] == '\0' || file->retired)
+		return NULL;
+	return file;
+}
+
+static size_t semihosting_ramfs_find(const char *const name)
+{
+	for (size_t idx = 0U; idx < SEMIHOSTING_RAMFS_MAX_FILES; ++idx) {
+		const semihosting_ramfs_file_s *const file = &semihosting_ramfs_files[idx];
+		if (!file->retired && strncmp(file->name, name, SEMIHOSTING_RAMFS_NAME_LENGTH) == 0)
+			return idx;
+	}
+	return SEMIHOSTING_RAMFS_MAX_FILES;
+}
+
+int32_t semihosting_ramfs_open(const char *const name, const bool truncate)
+{
+	if (name[0] == '\0' || strlen(name) >= SEMIHOSTING_RAMFS_NAME_LENGTH)
+		return -1;
+	size_t idx = semihosting_ramfs_find(name);
+	if (idx != SEMIHOSTING_RAMFS_MAX_FILES) {
+		semihosting_ramfs_file_s *const file = &semihosting_ramfs_files[idx];
+		/* Appending just picks the existing file back up */
+		if (!truncate) {
+			file->open = true;
+			return (int32_t)(SEMIHOSTING_RAMFS_HANDLE_BASE + idx);
+		}
+		/* Truncating retires the old copy so its records get skipped from here on */
+		file->retired = true;
+		file->open = false;
+	}
+
+	/* Find a free table entry for the new file */
+	for (idx = 0U; idx < SEMIHOSTING_RAMFS_MAX_FILES; ++idx) {
+		if (semihosting_ramfs_files[idx].name[0] == '\0')
+			break;
+	}
+	if (idx == SEMIHOSTING_RAMFS_MAX_FILES)
+		return -1;
+	semihosting_ramfs_file_s *const file = &semihosting_ramfs_files[idx];
+	strncpy(file->name, name, SEMIHOSTING_RAMFS_NAME_LENGTH - 1U);
+	file->length = 0U;
+	file->open = true;
+	file->retired = false;
+	return (int32_t)(SEMIHOSTING_RAMFS_HANDLE_BASE + idx);
+}
+
+int32_t semihosting_ramfs_close(const uint32_t handle)
+{
+	semihosting_ramfs_file_s *const file = semihosting_ramfs_file(handle);
+	if (!file || !file->open)
+		return -1;
+	file->open = false;
+	return 0;
+}
+
+/* Copy data from the target straight into the store, returning how much of it there was room for */
+int32_t semihosting_ramfs_write(
+	target_s *const target, const uint32_t handle, const target_addr_t buf_taddr, const uint32_t count)
+{
+	semihosting_ramfs_file_s *const file = semihosting_ramfs_file(handle);
+	if (!file || !file->open)
+		return -1;
+	const uint8_t file_idx = (uint8_t)(handle - SEMIHOSTING_RAMFS_HANDLE_BASE);
+
+	uint32_t written = 0U;
+	while (written < count) {
+		/* If the last record isn't this file's or is full, start a new one if there's space */
+		size_t record = semihosting_ramfs_last_record;
+		if (record == SEMIHOSTING_RAMFS_NO_RECORD || semihosting_ramfs_arena[record] != file_idx ||
+			read_le2(semihosting_ramfs_arena, record + 2U) == SEMIHOSTING_RAMFS_RECORD_MAX_LENGTH) {
+			if (SEMIHOSTING_RAMFS_SIZE - semihosting_ramfs_used <= SEMIHOSTING_RAMFS_RECORD_HEADER_LENGTH)
+				break;
+			record = semihosting_ramfs_used;
+			semihosting_ramfs_arena[record] = file_idx;
+			semihosting_ramfs_arena[record + 1U] = 0U;
+			write_le2(semihosting_ramfs_arena, record + 2U, 0U);
+			semihosting_ramfs_used += SEMIHOSTING_RAMFS_RECORD_HEADER_LENGTH;
+			semihosting_ramfs_last_record = record;
+		}
+
+		const uint16_t record_length = read_le2(semihosting_ramfs_arena, record + 2U);
+		const size_t amount = MIN(MIN(count - written, SEMIHOSTING_RAMFS_SIZE - semihosting_ramfs_used),
+			(size_t)(SEMIHOSTING_RAMFS_RECORD_MAX_LENGTH - record_length));
+		if (!amount)
+			break;
+		if (target_mem32_read(target, semihosting_ramfs_arena + semihosting_ramfs_used, buf_taddr + written, amount))
+			return written ? (int32_t)written : -1;
+		write_le2(semihosting_ramfs_arena, record + 2U, (uint16_t)(record_length + amount));
+		semihosting_ramfs_used += amount;
+		file->length += amount;
+		written += amount;
+	}
+	return (int32_t)written;
+}
+
+int32_t semihosting_ramfs_length(const uint32_t handle)
+{
+	const semihosting_ramfs_file_s *const file = semihosting_ramfs_file(handle);
+	if (!file)
+		return -1;
+	return (int32_t)file->length;
+}
+
+void semihosting_ramfs_list(void)
+{
+	gdb_outf("Semihosting file store: %s, %zu of %u bytes used\n", semihosting_ramfs_enabled ? "enabled" : "disabled",
+		semihosting_ramfs_used, SEMIHOSTING_RAMFS_SIZE);
+	for (size_t idx = 0U; idx < SEMIHOSTING_RAMFS_MAX_FILES; ++idx) {
+		const semihosting_ramfs_file_s *const file = &semihosting_ramfs_files[idx];
+		if (file->name[0] == '\0' || file->retired)
+			continue;
+		gdb_outf("  %s: %" PRIu32 " bytes%s\n", file->name, file->length, file->open ? " (open)" : "");
+	}
+}
+
+/* Stream a file's contents out as console output packets, a record chunk at a time */
+bool semihosting_ramfs_dump(const char *const name)
+{
+	const size_t file_idx = semihosting_ramfs_find(name);
+	if (file_idx == SEMIHOSTING_RAMFS_MAX_FILES)
+		return false;
+	for (size_t record = 0U; record < semihosting_ramfs_used;) {
+		const size_t length = read_le2(semihosting_ramfs_arena, record + 2U);
+		const size_t data = record + SEMIHOSTING_RAMFS_RECORD_HEADER_LENGTH;
+		if (semihosting_ramfs_arena[record] == file_idx) {
+			for (size_t offset = 0U; offset < length; offset += GDB_OUT_PACKET_MAX_SIZE) {
+				const size_t amount = MIN(length - offset, GDB_OUT_PACKET_MAX_SIZE);
+				gdb_put_packet("O", 1U, (const char *)semihosting_ramfs_arena + data + offset, amount, true);
+			}
+		}
+		record = data + length;
+	}
+	return true;
+}
+
+void semihosting_ramfs_clear(void)
+{
+	memset(semihosting_ramfs_files, 0, sizeof(semihosting_ramfs_files));
+	semihosting_ramfs_used = 0U;
+	semihosting_ramfs_last_record = SEMIHOSTING_RAMFS_NO_RECORD;
+}
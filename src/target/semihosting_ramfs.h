@@ -0,0 +1,60 @@
+/*
+ * This file is part of the Black Magic Debug project.
+ *
+ * Copyright (C) 2026 1BitSquared <info@1bitsquared.com>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef TARGET_SEMIHOSTING_RAMFS_H
+#define TARGET_SEMIHOSTING_RAMFS_H
+
+#include "general.h"
+
+/* Handles for files in the store are handed out from here up, well clear of anything GDB gives us */
+#define SEMIHOSTING_RAMFS_HANDLE_BASE 0x7fff0000U
+#define SEMIHOSTING_RAMFS_MAX_FILES   8U
+#define SEMIHOSTING_RAMFS_NAME_LENGTH 48U
+
+extern bool semihosting_ramfs_enabled;
+
+static inline bool semihosting_ramfs_is_handle(const uint32_t handle)
+{
+	return handle >= SEMIHOSTING_RAMFS_HANDLE_BASE &&
+		handle < SEMIHOSTING_RAMFS_HANDLE_BASE + SEMIHOSTING_RAMFS_MAX_FILES;
+}
+
+int32_t semihosting_ramfs_open(const char *name, bool truncate);
+int32_t semihosting_ramfs_close(uint32_t handle);
+int32_t semihosting_ramfs_write(target_s *target, uint32_t handle, target_addr_t buf_taddr, uint32_t count);
+int32_t semihosting_ramfs_length(uint32_t handle);
+
+void semihosting_ramfs_list(void);
+bool semihosting_ramfs_dump(const char *name);
+void semihosting_ramfs_clear(void);
+
+#endif /* TARGET_SEMIHOSTING_RAMFS_H */
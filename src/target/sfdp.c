@@ -65,6 +65,61 @@ static inline size_t sfdp_memory_density_to_capacity_bits(const uint8_t *const d
 		return SFDP_DENSITY_VALUE(density) + 1U;
 }
 
+static spi_quad_enable_e sfdp_quad_enable(const sfdp_basic_parameter_table_s *const parameter_table)
+{
+	switch (SFDP_QER(*parameter_table)) {
+	case 0U:
+		return SPI_QUAD_ENABLE_NONE;
+	case 1U:
+	case 4U:
+	case 5U:
+		return SPI_QUAD_ENABLE_SR2_BIT1;
+	case 2U:
+		return SPI_QUAD_ENABLE_SR1_BIT6;
+	case 3U:
+		return SPI_QUAD_ENABLE_SR2_BIT7;
+	case 6U:
+		return SPI_QUAD_ENABLE_SR2_BIT1W;
+	default:
+		return SPI_QUAD_ENABLE_UNKNOWN;
+	}
+}
+
+static void sfdp_set_read_mode(spi_read_mode_s *const mode, const timings_and_opcode_s *const command,
+	const uint8_t address_lanes, const uint8_t data_lanes)
+{
+	mode->opcode = command->opcode;
+	mode->address_lanes = address_lanes;
+	mode->data_lanes = data_lanes;
+	/* Mode clocks are in units of clocks on the address lanes, so they're just more dummy cycles to us */
+	mode->dummy_cycles = SFDP_READ_WAIT_STATES(command->timings) + SFDP_READ_MODE_CLOCKS(command->timings);
+}
+
+/* Pick the fastest read the Flash says it supports, only going quad when we know how to turn it on */
+static void sfdp_select_fast_read(spi_parameters_s *const result,
+	const sfdp_basic_parameter_table_s *const parameter_table, const size_t table_length)
+{
+	result->quad_enable = table_length >= SFDP_QER_MIN_TABLE_LENGTH ? sfdp_quad_enable(parameter_table) :
+																	  SPI_QUAD_ENABLE_UNKNOWN;
+	const bool quad = result->quad_enable != SPI_QUAD_ENABLE_UNKNOWN;
+	const uint8_t flags = parameter_table->value2;
+
+	if (quad && (flags & SFDP_FAST_READ_144) && parameter_table->fast_quad_io.opcode)
+		sfdp_set_read_mode(&result->fast_read, &parameter_table->fast_quad_io, 4U, 4U);
+	else if (quad && (flags & SFDP_FAST_READ_114) && parameter_table->fast_quad_output.opcode)
+		sfdp_set_read_mode(&result->fast_read, &parameter_table->fast_quad_output, 1U, 4U);
+	else if ((flags & SFDP_FAST_READ_122) && parameter_table->fast_dual_io.opcode)
+		sfdp_set_read_mode(&result->fast_read, &parameter_table->fast_dual_io, 2U, 2U);
+	else if ((flags & SFDP_FAST_READ_112) && parameter_table->fast_dual_output.opcode)
+		sfdp_set_read_mode(&result->fast_read, &parameter_table->fast_dual_output, 1U, 2U);
+	else
+		/* Otherwise fall back to plain fast read with 8 dummy clocks, which practically every Flash has */
+		result->fast_read =
+			(spi_read_mode_s){.opcode = 0x0bU, .address_lanes = 1U, .data_lanes = 1U, .dummy_cycles = 8U};
+	DEBUG_INFO("Fastest read: opcode %02x, 1-%u-%u, %u dummy cycles\n", result->fast_read.opcode,
+		result->fast_read.address_lanes, result->fast_read.data_lanes, result->fast_read.dummy_cycles);
+}
+
 static spi_parameters_s sfdp_read_basic_parameter_table(target_s *const target,
 	const sfdp_parameter_table_header_s *const header, const uint32_t address, const size_t length,
 	const spi_read_func spi_read)
@@ -84,6 +139,18 @@ static spi_parameters_s sfdp_read_basic_parameter_table(target_s *const target,
 			break;
 		}
 	}
+	/* Find the largest erase type beyond the sector erase, so runs of sectors can be erased in one go */
+	for (size_t i = 0; i < SFDP_ERASE_TYPES; ++i) {
+		erase_parameters_s *erase_type = &parameter_table.erase_types[i];
+		if (!erase_type->erase_size_exponent || !erase_type->opcode)
+			continue;
+		const uint32_t erase_size = SFDP_ERASE_SIZE(erase_type);
+		if (erase_size > result.sector_size && erase_size > result.block_size) {
+			result.block_erase_opcode = erase_type->opcode;
+			result.block_size = erase_size;
+		}
+	}
+	sfdp_select_fast_read(&result, &parameter_table, table_length);
 	// The timing and page size DWORD was added in JESD216A. It is marked as
 	// version 1.5.
 	if (header->version_major > 1 || (header->version_major == 1 && header->version_minor >= 5))
@@ -46,11 +46,34 @@ typedef struct spi_flash_id {
 	uint8_t capacity;
 } spi_flash_id_s;
 
+/* How the Flash's Quad Enable bit, if any, has to be set before quad commands can be used (SFDP QER) */
+typedef enum spi_quad_enable {
+	SPI_QUAD_ENABLE_UNKNOWN,   /* Not described by the Flash, so quad commands can't be relied on */
+	SPI_QUAD_ENABLE_NONE,      /* There's no QE bit, quad commands just work */
+	SPI_QUAD_ENABLE_SR2_BIT1,  /* QE is status register 2 bit 1, written along with SR1 by 01h */
+	SPI_QUAD_ENABLE_SR1_BIT6,  /* QE is status register 1 bit 6, written by 01h */
+	SPI_QUAD_ENABLE_SR2_BIT7,  /* QE is status register 2 bit 7, read by 3fh and written by 3eh */
+	SPI_QUAD_ENABLE_SR2_BIT1W, /* QE is status register 2 bit 1, written on its own by 31h */
+} spi_quad_enable_e;
+
+/* A read command and its bus format, e.g. 1-1-4 being a single lane opcode and address with quad data */
+typedef struct spi_read_mode {
+	uint8_t opcode;
+	uint8_t address_lanes;
+	uint8_t data_lanes;
+	/* Clocks between the address and data phases, including any mode bit clocks */
+	uint8_t dummy_cycles;
+} spi_read_mode_s;
+
 typedef struct spi_parameters {
 	uint32_t page_size;
 	uint32_t sector_size;
 	size_t capacity;
+	uint32_t block_size;
 	uint8_t sector_erase_opcode;
+	uint8_t block_erase_opcode;
+	spi_read_mode_s fast_read;
+	spi_quad_enable_e quad_enable;
 } spi_parameters_s;
 
 typedef void (*spi_read_func)(target_s *target, uint16_t command, target_addr_t address, void *buffer, size_t length);
@@ -57,6 +57,19 @@
 #define SFDP_PAGE_SIZE(parameter_table) \
 	(1U << ((parameter_table).programming_and_chip_erase_timing.programming_timing_ratio_and_page_size >> 4U))
 
+/* DWORD 1 fast read support flags, found in value2 */
+#define SFDP_FAST_READ_112 (1U << 0U)
+#define SFDP_FAST_READ_122 (1U << 4U)
+#define SFDP_FAST_READ_144 (1U << 5U)
+#define SFDP_FAST_READ_114 (1U << 6U)
+
+#define SFDP_READ_WAIT_STATES(timings) ((timings)&0x1fU)
+#define SFDP_READ_MODE_CLOCKS(timings) ((timings) >> 5U)
+
+/* DWORD 15 Quad Enable Requirements, from dual_and_quad_mode[2], which only exists from JESD216A on */
+#define SFDP_QER(parameter_table) (((parameter_table).dual_and_quad_mode[2] >> 4U) & 0x7U)
+#define SFDP_QER_MIN_TABLE_LENGTH 60U
+
 typedef struct sfdp_header {
 	char magic[4];
 	uint8_t version_minor;
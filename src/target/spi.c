@@ -96,6 +96,28 @@ void bmp_spi_run_command(
 	/* Deselect the Flash */
 	platform_spi_chip_select(device);
 }
+
+/*
+ * Poll the status register of a Flash until its write/erase in progress bit clears or timeout_ms expires,
+ * saving the probe's host a status read round trip per poll. After a status read, the Flash keeps clocking
+ * out its current status for as long as it stays selected, so the command only needs sending once.
+ */
+bool bmp_spi_wait_ready(const spi_bus_e bus, const uint8_t device, const uint32_t timeout_ms, uint8_t *const status)
+{
+	platform_timeout_s timeout;
+	platform_timeout_set(&timeout, timeout_ms);
+	/* Setup the transaction */
+	bmp_spi_setup_xfer(bus, device, SPI_FLASH_CMD_READ_STATUS, 0U);
+	/* Now read back status values till the Flash's not busy */
+	uint8_t value = platform_spi_xfer(bus, 0U);
+	while ((value & SPI_FLASH_STATUS_BUSY) && !platform_timeout_is_expired(&timeout))
+		value = platform_spi_xfer(bus, 0U);
+	/* Deselect the Flash */
+	platform_spi_chip_select(device);
+	if (status)
+		*status = value;
+	return !(value & SPI_FLASH_STATUS_BUSY);
+}
 #endif
 
 static inline uint8_t bmp_spi_read_status(target_s *const target, const spi_flash_s *const flash)
@@ -122,6 +144,11 @@ spi_flash_s *bmp_spi_add_flash(target_s *const target, const target_addr_t begin
 		spi_parameters.sector_size = 4096U;
 		spi_parameters.capacity = length;
 		spi_parameters.sector_erase_opcode = SPI_FLASH_OPCODE_SECTOR_ERASE;
+		spi_parameters.block_size = 0U;
+		spi_parameters.block_erase_opcode = 0U;
+		spi_parameters.fast_read =
+			(spi_read_mode_s){.opcode = 0x0bU, .address_lanes = 1U, .data_lanes = 1U, .dummy_cycles = 8U};
+		spi_parameters.quad_enable = SPI_QUAD_ENABLE_UNKNOWN;
 		DEBUG_WARN("SFDP read failed. Using best guess.\n");
 	}
 	DEBUG_INFO("Flash size: %" PRIu32 "MiB\n", (uint32_t)spi_parameters.capacity / (1024U * 1024U));
@@ -130,6 +157,8 @@ spi_flash_s *bmp_spi_add_flash(target_s *const target, const target_addr_t begin
 	flash->start = begin;
 	flash->length = spi_parameters.capacity;
 	flash->blocksize = spi_parameters.sector_size;
+	/* If the Flash has a larger block erase, let the erase planner hand it whole aligned blocks */
+	flash->erase_span = spi_parameters.block_size;
 	flash->write = bmp_spi_flash_write;
 	flash->erase = bmp_spi_flash_erase;
 	flash->mass_erase = bmp_spi_mass_erase;
@@ -138,6 +167,10 @@ spi_flash_s *bmp_spi_add_flash(target_s *const target, const target_addr_t begin
 
 	spi_flash->page_size = spi_parameters.page_size;
 	spi_flash->sector_erase_opcode = spi_parameters.sector_erase_opcode;
+	spi_flash->block_erase_opcode = spi_parameters.block_erase_opcode;
+	spi_flash->page_program_command = SPI_FLASH_CMD_PAGE_PROGRAM;
+	spi_flash->fast_read = spi_parameters.fast_read;
+	spi_flash->quad_enable = spi_parameters.quad_enable;
 	spi_flash->read = spi_read;
 	spi_flash->write = spi_write;
 	spi_flash->run_command = spi_run_command;
@@ -167,17 +200,95 @@ bool bmp_spi_mass_erase(target_flash_s *const flash, platform_timeout_s *const p
 	return true;
 }
 
+/* Write a status register with the given value(s), waiting for the write to complete */
+static bool bmp_spi_write_status(target_s *const target, const spi_flash_s *const spi_flash, const uint16_t command,
+	const uint8_t *const value, const size_t length)
+{
+	spi_flash->run_command(target, SPI_FLASH_CMD_WRITE_ENABLE, 0U);
+	if (!(bmp_spi_read_status(target, spi_flash) & SPI_FLASH_STATUS_WRITE_ENABLED))
+		return false;
+	spi_flash->write(target, command, 0U, value, length);
+	while (bmp_spi_read_status(target, spi_flash) & SPI_FLASH_STATUS_BUSY)
+		continue;
+	return true;
+}
+
+/* Set the Flash's Quad Enable bit the way its SFDP says to, and check it stuck */
+static bool bmp_spi_set_quad_enable(target_s *const target, const spi_flash_s *const spi_flash)
+{
+	uint8_t status[2] = {0U};
+	switch (spi_flash->quad_enable) {
+	case SPI_QUAD_ENABLE_NONE:
+		return true;
+	case SPI_QUAD_ENABLE_SR1_BIT6:
+		status[0] = bmp_spi_read_status(target, spi_flash);
+		if (!(status[0] & 0x40U)) {
+			status[0] |= 0x40U;
+			bmp_spi_write_status(target, spi_flash, SPI_FLASH_CMD_WRITE_STATUS, status, 1U);
+		}
+		return bmp_spi_read_status(target, spi_flash) & 0x40U;
+	case SPI_QUAD_ENABLE_SR2_BIT1:
+	case SPI_QUAD_ENABLE_SR2_BIT1W:
+		status[0] = bmp_spi_read_status(target, spi_flash);
+		spi_flash->read(target, SPI_FLASH_CMD_READ_STATUS2, 0U, &status[1], 1U);
+		if (!(status[1] & 0x02U)) {
+			status[1] |= 0x02U;
+			if (spi_flash->quad_enable == SPI_QUAD_ENABLE_SR2_BIT1W)
+				bmp_spi_write_status(target, spi_flash, SPI_FLASH_CMD_WRITE_STATUS2, &status[1], 1U);
+			else
+				bmp_spi_write_status(target, spi_flash, SPI_FLASH_CMD_WRITE_STATUS, status, 2U);
+		}
+		spi_flash->read(target, SPI_FLASH_CMD_READ_STATUS2, 0U, &status[1], 1U);
+		return status[1] & 0x02U;
+	case SPI_QUAD_ENABLE_SR2_BIT7:
+		spi_flash->read(target, SPI_FLASH_CMD_READ_STATUS2_ALT, 0U, &status[1], 1U);
+		if (!(status[1] & 0x80U)) {
+			status[1] |= 0x80U;
+			bmp_spi_write_status(target, spi_flash, SPI_FLASH_CMD_WRITE_STATUS2_ALT, &status[1], 1U);
+		}
+		spi_flash->read(target, SPI_FLASH_CMD_READ_STATUS2_ALT, 0U, &status[1], 1U);
+		return status[1] & 0x80U;
+	default:
+		return false;
+	}
+}
+
+/*
+ * Switch page programming over to 4 data lanes, for backends that can drive them - they must honour the
+ * SPI_FLASH_DATA_LANES() and SPI_FLASH_ADDR_WIDE bits of the commands they're given. Returns false and
+ * stays single lane if the Flash doesn't say how to turn quad mode on or it won't enable.
+ */
+bool bmp_spi_enable_quad(target_s *const target, spi_flash_s *const spi_flash)
+{
+	if (spi_flash->quad_enable == SPI_QUAD_ENABLE_UNKNOWN || !spi_flash->write) {
+		DEBUG_INFO("SPI Flash quad mode not available, staying single lane\n");
+		return false;
+	}
+	if (!bmp_spi_set_quad_enable(target, spi_flash)) {
+		DEBUG_WARN("SPI Flash Quad Enable bit did not set, staying single lane\n");
+		return false;
+	}
+
+	/* Macronix parts only have the 1-4-4 quad page program, everyone else has the 1-1-4 one */
+	spi_flash_id_s flash_id;
+	spi_flash->read(target, SPI_FLASH_CMD_READ_JEDEC_ID, 0U, &flash_id, sizeof(flash_id));
+	spi_flash->page_program_command =
+		flash_id.manufacturer == 0xc2U ? SPI_FLASH_CMD_QUAD_IO_PAGE_PROGRAM : SPI_FLASH_CMD_QUAD_PAGE_PROGRAM;
+	DEBUG_INFO("SPI Flash using quad page program (%02x)\n", spi_flash->page_program_command & SPI_FLASH_OPCODE_MASK);
+	return true;
+}
+
 static bool bmp_spi_flash_erase(target_flash_s *const flash, const target_addr_t addr, const size_t length)
 {
-	(void)length;
 	target_s *const target = flash->t;
 	const spi_flash_s *const spi_flash = (spi_flash_s *)flash;
 	spi_flash->run_command(target, SPI_FLASH_CMD_WRITE_ENABLE, 0U);
 	if (!(bmp_spi_read_status(target, spi_flash) & SPI_FLASH_STATUS_WRITE_ENABLED))
 		return false;
 
-	spi_flash->run_command(
-		target, SPI_FLASH_CMD_SECTOR_ERASE | SPI_FLASH_OPCODE(spi_flash->sector_erase_opcode), addr - flash->start);
+	/* The erase planner only asks for more than a sector when that's a whole block erase */
+	const uint8_t opcode = length > flash->blocksize ? spi_flash->block_erase_opcode : spi_flash->sector_erase_opcode;
+	spi_flash->run_command(target, SPI_FLASH_CMD_SECTOR_ERASE | SPI_FLASH_OPCODE(opcode), addr - flash->start);
 	while (bmp_spi_read_status(target, spi_flash) & SPI_FLASH_STATUS_BUSY)
 		continue;
 	return true;
@@ -189,6 +300,8 @@ static bool bmp_spi_flash_write(
 	target_s *const target = flash->t;
 	const spi_flash_s *const spi_flash = (spi_flash_s *)flash;
 	const target_addr_t begin = dest - flash->start;
+	if (spi_flash->write_pages)
+		return spi_flash->write_pages(target, spi_flash, begin, src, length);
 	const char *const buffer = (const char *)src;
 	for (size_t offset = 0; offset < length; offset += spi_flash->page_size) {
 		spi_flash->run_command(target, SPI_FLASH_CMD_WRITE_ENABLE, 0U);
@@ -196,7 +309,7 @@ static bool bmp_spi_flash_write(
 			return false;
 
 		const size_t amount = MIN(length - offset, spi_flash->page_size);
-		spi_flash->write(target, SPI_FLASH_CMD_PAGE_PROGRAM, begin + offset, buffer + offset, amount);
+		spi_flash->write(target, spi_flash->page_program_command, begin + offset, buffer + offset, amount);
 		while (bmp_spi_read_status(target, spi_flash) & SPI_FLASH_STATUS_BUSY)
 			continue;
 	}
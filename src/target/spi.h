@@ -39,6 +39,7 @@
 #include "general.h"
 #include "target_internal.h"
 #include "spi_types.h"
+#include "sfdp.h"
 
 #define SPI_FLASH_OPCODE_MASK      0x00ffU
 #define SPI_FLASH_OPCODE(x)        ((x)&SPI_FLASH_OPCODE_MASK)
@@ -52,15 +53,38 @@
 #define SPI_FLASH_DATA_SHIFT       12U
 #define SPI_FLASH_DATA_IN          (0U << SPI_FLASH_DATA_SHIFT)
 #define SPI_FLASH_DATA_OUT         (1U << SPI_FLASH_DATA_SHIFT)
+/* Lanes used by the data phase (and address phase if wide), single lane only backends ignore these */
+#define SPI_FLASH_LANES_MASK    0x6000U
+#define SPI_FLASH_LANES_SHIFT   13U
+#define SPI_FLASH_DATA_LANES(x) ((((x) >> 1U) << SPI_FLASH_LANES_SHIFT) & SPI_FLASH_LANES_MASK)
+#define SPI_FLASH_LANES(x)      (1U << (((x)&SPI_FLASH_LANES_MASK) >> SPI_FLASH_LANES_SHIFT))
+#define SPI_FLASH_ADDR_WIDE     (1U << 15U)
 
 #define SPI_FLASH_OPCODE_SECTOR_ERASE 0x20U
+#define SPI_FLASH_OPCODE_BLOCK_ERASE  0xd8U
 #define SPI_FLASH_CMD_WRITE_ENABLE    (SPI_FLASH_OPCODE_ONLY | SPI_FLASH_DUMMY_LEN(0) | SPI_FLASH_OPCODE(0x06U))
 #define SPI_FLASH_CMD_PAGE_PROGRAM \
 	(SPI_FLASH_OPCODE_3B_ADDR | SPI_FLASH_DATA_OUT | SPI_FLASH_DUMMY_LEN(0) | SPI_FLASH_OPCODE(0x02))
+#define SPI_FLASH_CMD_QUAD_PAGE_PROGRAM                                                                 \
+	(SPI_FLASH_OPCODE_3B_ADDR | SPI_FLASH_DATA_OUT | SPI_FLASH_DATA_LANES(4) | SPI_FLASH_DUMMY_LEN(0) | \
+		SPI_FLASH_OPCODE(0x32U))
+#define SPI_FLASH_CMD_QUAD_IO_PAGE_PROGRAM                                                           \
+	(SPI_FLASH_OPCODE_3B_ADDR | SPI_FLASH_DATA_OUT | SPI_FLASH_DATA_LANES(4) | SPI_FLASH_ADDR_WIDE | \
+		SPI_FLASH_DUMMY_LEN(0) | SPI_FLASH_OPCODE(0x38U))
 #define SPI_FLASH_CMD_SECTOR_ERASE (SPI_FLASH_OPCODE_3B_ADDR | SPI_FLASH_DUMMY_LEN(0))
 #define SPI_FLASH_CMD_CHIP_ERASE   (SPI_FLASH_OPCODE_ONLY | SPI_FLASH_DUMMY_LEN(0) | SPI_FLASH_OPCODE(0x60U))
 #define SPI_FLASH_CMD_READ_STATUS \
 	(SPI_FLASH_OPCODE_ONLY | SPI_FLASH_DATA_IN | SPI_FLASH_DUMMY_LEN(0) | SPI_FLASH_OPCODE(0x05U))
+#define SPI_FLASH_CMD_WRITE_STATUS \
+	(SPI_FLASH_OPCODE_ONLY | SPI_FLASH_DATA_OUT | SPI_FLASH_DUMMY_LEN(0) | SPI_FLASH_OPCODE(0x01U))
+#define SPI_FLASH_CMD_READ_STATUS2 \
+	(SPI_FLASH_OPCODE_ONLY | SPI_FLASH_DATA_IN | SPI_FLASH_DUMMY_LEN(0) | SPI_FLASH_OPCODE(0x35U))
+#define SPI_FLASH_CMD_WRITE_STATUS2 \
+	(SPI_FLASH_OPCODE_ONLY | SPI_FLASH_DATA_OUT | SPI_FLASH_DUMMY_LEN(0) | SPI_FLASH_OPCODE(0x31U))
+#define SPI_FLASH_CMD_READ_STATUS2_ALT \
+	(SPI_FLASH_OPCODE_ONLY | SPI_FLASH_DATA_IN | SPI_FLASH_DUMMY_LEN(0) | SPI_FLASH_OPCODE(0x3fU))
+#define SPI_FLASH_CMD_WRITE_STATUS2_ALT \
+	(SPI_FLASH_OPCODE_ONLY | SPI_FLASH_DATA_OUT | SPI_FLASH_DUMMY_LEN(0) | SPI_FLASH_OPCODE(0x3eU))
 #define SPI_FLASH_CMD_READ_JEDEC_ID \
 	(SPI_FLASH_OPCODE_ONLY | SPI_FLASH_DATA_IN | SPI_FLASH_DUMMY_LEN(0) | SPI_FLASH_OPCODE(0x9fU))
 #define SPI_FLASH_CMD_READ_SFDP \
@@ -75,24 +99,41 @@ typedef void (*spi_write_func)(
 	target_s *target, uint16_t command, target_addr32_t address, const void *buffer, size_t length);
 typedef void (*spi_run_command_func)(target_s *target, uint16_t command, target_addr32_t address);
 
-typedef struct spi_flash {
+typedef struct spi_flash spi_flash_s;
+/*
+ * Programs length bytes of whole pages starting at address using a page programmer running on the target,
+ * for backends where the Flash sits behind a controller in the target that can drive it without the probe
+ */
+typedef bool (*spi_write_pages_func)(
+	target_s *target, const spi_flash_s *flash, target_addr32_t address, const void *buffer, size_t length);
+
+struct spi_flash {
 	target_flash_s flash;
 	uint32_t page_size;
 	uint8_t sector_erase_opcode;
+	uint8_t block_erase_opcode;
+	uint16_t page_program_command;
+	/* The fastest read the Flash supports, for backends that set up memory mapped reads themselves */
+	spi_read_mode_s fast_read;
+	spi_quad_enable_e quad_enable;
 
 	spi_read_func read;
 	spi_write_func write;
 	spi_run_command_func run_command;
-} spi_flash_s;
+	/* Optional, used to write pages in place of the above when set */
+	spi_write_pages_func write_pages;
+};
 
 void bmp_spi_read(
 	spi_bus_e bus, uint8_t device, uint16_t command, target_addr32_t address, void *buffer, size_t length);
 void bmp_spi_write(
 	spi_bus_e bus, uint8_t device, uint16_t command, target_addr32_t address, const void *buffer, size_t length);
 void bmp_spi_run_command(spi_bus_e bus, uint8_t device, uint16_t command, target_addr32_t address);
+bool bmp_spi_wait_ready(spi_bus_e bus, uint8_t device, uint32_t timeout_ms, uint8_t *status);
 
 spi_flash_s *bmp_spi_add_flash(target_s *target, target_addr_t begin, size_t length, spi_read_func spi_read,
 	spi_write_func spi_write, spi_run_command_func spi_run_command);
 bool bmp_spi_mass_erase(target_flash_s *flash, platform_timeout_s *print_progess);
+bool bmp_spi_enable_quad(target_s *target, spi_flash_s *flash);
 
 #endif /* TARGET_SPI_H */
@@ -57,6 +57,7 @@
 #endif
 #include "jep106.h"
 #include "stm32_common.h"
+#include "flashloader.h"
 
 /* Flash Program ad Erase Controller Register Map */
 #define FPEC_BASE     0x40022000U
@@ -173,6 +174,8 @@ static bool stm32f1_attach(target_s *target);
 static void stm32f1_detach(target_s *target);
 static bool stm32f1_flash_erase(target_flash_s *flash, target_addr_t addr, size_t len);
 static bool stm32f1_flash_write(target_flash_s *flash, target_addr_t dest, const void *src, size_t len);
+static bool stm32f1_flash_write_wait(target_flash_s *flash);
+static bool stm32f1_flash_done(target_flash_s *flash);
 static bool stm32f1_mass_erase(target_s *target, platform_timeout_s *print_progess);
 
 static void stm32f1_add_flash(target_s *target, uint32_t addr, size_t length, size_t erasesize)
@@ -189,6 +192,9 @@ static void stm32f1_add_flash(target_s *target, uint32_t addr, size_t length, si
 	flash->writesize = 1024U;
 	flash->erase = stm32f1_flash_erase;
 	flash->write = stm32f1_flash_write;
+	flash->write_wait = stm32f1_flash_write_wait;
+	flash->write_overlaps = true;
+	flash->done = stm32f1_flash_done;
 	flash->erased = 0xff;
 	target_add_flash(target, flash);
 }
@@ -1122,50 +1128,81 @@ static size_t stm32f1_bank1_length(target_addr_t addr, size_t len)
 	return len;
 }
 
+static bool stm32f1_flash_write_bank(target_s *const target, const uint32_t bank_offset, const target_addr_t dest,
+	const void *const src, const size_t len)
+{
+	/* Allow wider writes on Gigadevices and Arterytek */
+	const align_e psize = (target->target_options & STM32F1_TOPT_32BIT_WRITES) ? ALIGN_32BIT : ALIGN_16BIT;
+
+	/* The resident loader may still be programming the last block, in which case the status flags are its to see */
+	if (!flashloader_server_busy(target))
+		stm32f1_flash_clear_eop(target, bank_offset);
+	target_mem32_write32(target, FLASH_CR + bank_offset, FLASH_CR_PG);
+
+	/* Use the target API instead of a direct Cortex-M call for GD32VF103 parts */
+	if (target->designer_code == JEP106_MANUFACTURER_RV_GIGADEVICE && target->cpuid == 0x80000022U)
+		target_mem32_write(target, dest, src, len);
+	/*
+	 * If there's enough RAM on the target, hand the block to the resident loader to do the programming and
+	 * polling, returning while it's still at it. stm32f1_flash_write_wait() then checks on how it went
+	 */
+	else if (flashloader_server_usable(target, len)) {
+		const flashloader_params_s params = {
+			.status_reg = FLASH_SR + bank_offset,
+			.busy_mask = FLASH_SR_BSY,
+			.error_mask = SR_ERROR_MASK,
+			.access_width = psize == ALIGN_32BIT ? 4U : 2U,
+		};
+		if (!flashloader_server_write(target, &params, dest, src, len)) {
+			DEBUG_ERROR("stm32f1 flash loader failed, status 0x%" PRIx32 "\n",
+				target_mem32_read32(target, FLASH_SR + bank_offset));
+			return false;
+		}
+		return true;
+	} else
+		cortexm_mem_write_aligned(target, dest, src, len, psize);
+
+	/* Wait for completion or an error */
+	return stm32f1_flash_busy_wait(target, bank_offset, NULL);
+}
+
 static bool stm32f1_flash_write(target_flash_s *flash, target_addr_t dest, const void *src, size_t len)
 {
 	target_s *target = flash->t;
 	const size_t offset = stm32f1_bank1_length(dest, len);
 	DEBUG_TARGET("%s: at %08" PRIx32 " for %zu bytes\n", __func__, dest, len);
 
-	/* Allow wider writes on Gigadevices and Arterytek */
-	const align_e psize = (target->target_options & STM32F1_TOPT_32BIT_WRITES) ? ALIGN_32BIT : ALIGN_16BIT;
-
 	/* Start by writing any bank 1 data */
-	if (offset) {
-		stm32f1_flash_clear_eop(target, FLASH_BANK1_OFFSET);
-
-		target_mem32_write32(target, FLASH_CR, FLASH_CR_PG);
-		/* Use the target API instead of a direct Cortex-M call for GD32VF103 parts */
-		if (target->designer_code == JEP106_MANUFACTURER_RV_GIGADEVICE && target->cpuid == 0x80000022U)
-			target_mem32_write(target, dest, src, offset);
-		else
-			cortexm_mem_write_aligned(target, dest, src, offset, psize);
-
-		/* Wait for completion or an error */
-		if (!stm32f1_flash_busy_wait(target, FLASH_BANK1_OFFSET, NULL))
-			return false;
-	}
+	if (offset && !stm32f1_flash_write_bank(target, FLASH_BANK1_OFFSET, dest, src, offset))
+		return false;
 
 	/* If there's anything to write left over and we're on a part with a second bank, write to bank 2 */
 	const size_t remainder = len - offset;
 	if (stm32f1_is_dual_bank(target->part_id) && remainder) {
 		const uint8_t *data = src;
-		stm32f1_flash_clear_eop(target, FLASH_BANK2_OFFSET);
+		return stm32f1_flash_write_bank(target, FLASH_BANK2_OFFSET, dest + offset, data + offset, remainder);
+	}
 
-		target_mem32_write32(target, FLASH_CR + FLASH_BANK2_OFFSET, FLASH_CR_PG);
-		/* Use the target API instead of a direct Cortex-M call for GD32VF103 parts */
-		if (target->designer_code == JEP106_MANUFACTURER_RV_GIGADEVICE && target->cpuid == 0x80000022U)
-			target_mem32_write(target, dest + offset, data + offset, remainder);
-		else
-			cortexm_mem_write_aligned(target, dest + offset, data + offset, remainder, psize);
+	return true;
+}
 
-		/* Wait for completion or an error */
-		if (!stm32f1_flash_busy_wait(target, FLASH_BANK2_OFFSET, NULL))
-			return false;
+static bool stm32f1_flash_write_wait(target_flash_s *const flash)
+{
+	target_s *const target = flash->t;
+	/* A held Flash session hands the target back to GDB between operations, so the loader can't stay running */
+	const bool loader_result =
+		target->flash_mode_held ? flashloader_server_stop(target) : flashloader_server_wait(target);
+	if (!loader_result) {
+		DEBUG_ERROR("stm32f1 flash loader failed\n");
+		return false;
 	}
+	return stm32f1_flash_busy_wait(target, stm32f1_bank_offset_for(flash->start), NULL);
+}
 
-	return true;
+/* The resident loader is left running between writes, so stop it once we're done with the Flash */
+static bool stm32f1_flash_done(target_flash_s *const flash)
+{
+	return flashloader_server_stop(flash->t);
 }
 
 static bool stm32f1_mass_erase_bank(
@@ -167,6 +167,7 @@ static bool gd32f4_attach(target_s *target);
 static void stm32f4_detach(target_s *target);
 static bool stm32f4_flash_erase(target_flash_s *target_flash, target_addr_t addr, size_t len);
 static bool stm32f4_flash_write(target_flash_s *flash, target_addr_t dest, const void *src, size_t len);
+static bool stm32f4_flash_write_wait(target_flash_s *flash);
 static bool stm32f4_mass_erase(target_s *target, platform_timeout_s *print_progess);
 
 static void stm32f4_add_flash(target_s *const target, const uint32_t addr, const size_t length, const size_t blocksize,
@@ -186,7 +187,10 @@ static void stm32f4_add_flash(target_s *const target, const uint32_t addr, const
 	target_flash->length = length;
 	target_flash->blocksize = blocksize;
 	target_flash->erase = stm32f4_flash_erase;
+	/* Erase and program completion are both just a matter of waiting for BSY to clear */
+	target_flash->erase_wait = stm32f4_flash_write_wait;
 	target_flash->write = stm32f4_flash_write;
+	target_flash->write_wait = stm32f4_flash_write_wait;
 	target_flash->writesize = 1024;
 	target_flash->erased = 0xffU;
 	flash->base_sector = base_sector;
@@ -592,16 +596,11 @@ static void stm32f4_flash_unlock(target_s *target)
 
 static bool stm32f4_flash_busy_wait(target_s *const target, platform_timeout_s *const timeout)
 {
-	/* Read FLASH_SR to poll for BSY bit */
-	uint32_t status = FLASH_SR_BSY;
-	while (status & FLASH_SR_BSY) {
-		status = target_mem32_read32(target, FLASH_SR);
-		if ((status & SR_ERROR_MASK) || target_check_error(target)) {
-			DEBUG_ERROR("stm32f4 flash error 0x%" PRIx32 "\n", status);
-			return false;
-		}
-		if (timeout)
-			target_print_progress(timeout);
+	/* Poll FLASH_SR for the BSY bit to clear */
+	uint32_t status = 0U;
+	if (!target_mem32_poll32(target, FLASH_SR, FLASH_SR_BSY, 0U, 0U, timeout, &status) || (status & SR_ERROR_MASK)) {
+		DEBUG_ERROR("stm32f4 flash error 0x%" PRIx32 "\n", status);
+		return false;
 	}
 	return true;
 }
@@ -625,15 +624,15 @@ static bool stm32f4_flash_erase(target_flash_s *target_flash, target_addr_t addr
 		/* write address to FMA */
 		target_mem32_write32(target, FLASH_CR, cr | FLASH_CR_STRT);
 
-		/* Wait for completion or an error */
-		if (!stm32f4_flash_busy_wait(target, NULL))
+		/* Wait for completion or an error, leaving the last sector for stm32f4_flash_write_wait() */
+		if (offset + target_flash->blocksize < len && !stm32f4_flash_busy_wait(target, NULL))
 			return false;
 
 		++sector;
 		if (flash->bank_split && sector == flash->bank_split)
 			sector = 16;
 	}
-	return true;
+	return !target_check_error(target);
 }
 
 static bool stm32f4_flash_write(target_flash_s *flash, target_addr_t dest, const void *src, size_t len)
@@ -647,8 +646,14 @@ static bool stm32f4_flash_write(target_flash_s *flash, target_addr_t dest, const
 	target_mem32_write32(target, FLASH_CR, (psize * FLASH_CR_PSIZE16) | FLASH_CR_PG);
 	cortexm_mem_write_aligned(target, dest, src, len, psize);
 
+	/* Completion is waited on in stm32f4_flash_write_wait() so the next block can be received meanwhile */
+	return !target_check_error(target);
+}
+
+static bool stm32f4_flash_write_wait(target_flash_s *const flash)
+{
 	/* Wait for completion or an error */
-	return stm32f4_flash_busy_wait(target, NULL);
+	return stm32f4_flash_busy_wait(flash->t, NULL);
 }
 
 static bool stm32f4_mass_erase(target_s *const target, platform_timeout_s *const print_progess)
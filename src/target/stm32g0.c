@@ -66,8 +66,9 @@
 #define FLASH_SIZE_MAX_C03 (32U * 1024U) // 32kiB
 
 #define G0_FLASH_BASE   0x40022000U
-#define FLASH_ACR       (G0_FLASH_BASE + 0x000U)
-#define FLASH_ACR_EMPTY (1U << 16U)
+#define FLASH_ACR              (G0_FLASH_BASE + 0x000U)
+#define FLASH_ACR_LATENCY_MASK 7U
+#define FLASH_ACR_EMPTY        (1U << 16U)
 
 #define FLASH_KEYR          (G0_FLASH_BASE + 0x008U)
 #define FLASH_KEYR_KEY1     0x45670123U
@@ -133,9 +134,33 @@
 #define RAM_SIZE_C01 (6U * 1024U)  // 6kiB
 #define RAM_SIZE_C03 (12U * 1024U) // 12kiB
 
-#define G0_RCC_BASE       0x40021000U
-#define RCC_APBENR1       (G0_RCC_BASE + 0x3cU)
-#define RCC_APBENR1_DBGEN (1U << 27U)
+#define G0_RCC_BASE          0x40021000U
+#define RCC_CR               (G0_RCC_BASE + 0x00U)
+#define RCC_CR_PLLON         (1U << 24U)
+#define RCC_CR_PLLRDY        (1U << 25U)
+#define RCC_CFGR             (G0_RCC_BASE + 0x08U)
+#define RCC_CFGR_SW_MASK     (7U << 0U)
+#define RCC_CFGR_SW_PLLRCLK  (2U << 0U)
+#define RCC_CFGR_SWS_MASK    (7U << 3U)
+#define RCC_CFGR_SWS_PLLRCLK (2U << 3U)
+#define RCC_PLLCFGR          (G0_RCC_BASE + 0x0cU)
+#define RCC_PLLCFGR_HSI16    (2U << 0U)
+#define RCC_PLLCFGR_N_SHIFT  8U
+#define RCC_PLLCFGR_REN      (1U << 28U)
+#define RCC_PLLCFGR_R_SHIFT  29U
+#define RCC_APBENR1          (G0_RCC_BASE + 0x3cU)
+#define RCC_APBENR1_DBGEN    (1U << 27U)
+#define RCC_APBENR1_PWREN    (1U << 28U)
+
+#define PWR_CR1            0x40007000U
+#define PWR_CR1_VOS_MASK   (3U << 9U)
+#define PWR_CR1_VOS_RANGE1 (1U << 9U)
+
+/* HSI16 * 8 / 2 gives 64MHz, which needs 2 wait states in range 1 */
+#define G0_BOOST_PLLN           8U
+#define G0_BOOST_PLLR           2U
+#define G0_BOOST_LATENCY        2U
+#define G0_CLOCK_SWITCH_TIMEOUT 10U
 
 #define STM32G0_DBGMCU_BASE       0x40015800U
 #define STM32G0_DBGMCU_IDCODE     (STM32G0_DBGMCU_BASE + 0x000U)
@@ -163,6 +188,12 @@
 
 typedef struct stm32g0_priv {
 	bool irreversible_enabled;
+	/* The clock registers as they were before stm32g0_flash_clock_boost() changed them */
+	bool clock_boosted;
+	uint32_t clock_saved_cr;
+	uint32_t clock_saved_cfgr;
+	uint32_t clock_saved_pllcfgr;
+	uint32_t clock_saved_acr;
 } stm32g0_priv_s;
 
 static bool stm32g0_attach(target_s *target);
@@ -170,6 +201,8 @@ static void stm32g0_detach(target_s *target);
 static bool stm32g0_flash_erase(target_flash_s *flash, target_addr_t addr, size_t len);
 static bool stm32g0_flash_write(target_flash_s *flash, target_addr_t dest, const void *src, size_t len);
 static bool stm32g0_mass_erase(target_s *target, platform_timeout_s *print_progess);
+static bool stm32g0_flash_clock_boost(target_s *target);
+static void stm32g0_flash_clock_restore(target_s *target);
 
 /* Custom commands */
 static bool stm32g0_cmd_erase_bank(target_s *target, int argc, const char **argv);
@@ -303,6 +336,11 @@ bool stm32g0_probe(target_s *target)
 	stm32g0_add_flash(target, FLASH_START, flash_size, FLASH_PAGE_SIZE);
 
 	target->mass_erase = stm32g0_mass_erase;
+	/* The C0 parts have no PLL to speed up with */
+	if (target->part_id != ID_STM32C011 && target->part_id != ID_STM32C031) {
+		target->flash_clock_boost = stm32g0_flash_clock_boost;
+		target->flash_clock_restore = stm32g0_flash_clock_restore;
+	}
 	target_add_commands(target, stm32g0_cmd_list, target->driver);
 
 	/* OTP Flash area */
@@ -352,13 +390,7 @@ static void stm32g0_flash_lock(target_s *target)
 
 static bool stm32g0_wait_busy(target_s *const target, platform_timeout_s *const timeout)
 {
-	while (target_mem32_read32(target, FLASH_SR) & FLASH_SR_BSY_MASK) {
-		if (target_check_error(target))
-			return false;
-		if (timeout)
-			target_print_progress(timeout);
-	}
-	return true;
+	return target_mem32_poll32(target, FLASH_SR, FLASH_SR_BSY_MASK, 0U, 0U, timeout, NULL);
 }
 
 static void stm32g0_flash_op_finish(target_s *target)
@@ -475,6 +507,72 @@ static bool stm32g0_flash_write(target_flash_s *flash, target_addr_t dest, const
 	return true;
 }
 
+/*
+ * Run the core at 64MHz from HSI16 through the PLL while Flashing, rather than the 16MHz HSI16 it comes out of
+ * reset on. This is only done while the clock tree is still as reset left it, in voltage range 1 and running
+ * from HSISYS with the PLL off, so nothing the firmware set up gets trampled on.
+ */
+static bool stm32g0_flash_clock_boost(target_s *const target)
+{
+	stm32g0_priv_s *const priv = (stm32g0_priv_s *)target->target_storage;
+	const uint32_t ctrl = target_mem32_read32(target, RCC_CR);
+	const uint32_t config = target_mem32_read32(target, RCC_CFGR);
+	const uint32_t apb_enable = target_mem32_read32(target, RCC_APBENR1);
+	target_mem32_write32(target, RCC_APBENR1, apb_enable | RCC_APBENR1_PWREN);
+	const uint32_t voltage = target_mem32_read32(target, PWR_CR1) & PWR_CR1_VOS_MASK;
+	target_mem32_write32(target, RCC_APBENR1, apb_enable);
+	if (target_check_error(target))
+		return false;
+	if ((config & (RCC_CFGR_SW_MASK | RCC_CFGR_SWS_MASK)) || (ctrl & RCC_CR_PLLON) || voltage != PWR_CR1_VOS_RANGE1) {
+		DEBUG_TARGET("%s: clock tree not in its reset state, leaving it alone\n", __func__);
+		return true;
+	}
+
+	priv->clock_boosted = true;
+	priv->clock_saved_cr = ctrl;
+	priv->clock_saved_cfgr = config;
+	priv->clock_saved_pllcfgr = target_mem32_read32(target, RCC_PLLCFGR);
+	priv->clock_saved_acr = target_mem32_read32(target, FLASH_ACR);
+
+	/* HSI16 is already running, as HSISYS is what the core is on */
+	target_mem32_write32(target, RCC_PLLCFGR,
+		RCC_PLLCFGR_HSI16 | (G0_BOOST_PLLN << RCC_PLLCFGR_N_SHIFT) | RCC_PLLCFGR_REN |
+			((G0_BOOST_PLLR - 1U) << RCC_PLLCFGR_R_SHIFT));
+	target_mem32_write32(target, RCC_CR, ctrl | RCC_CR_PLLON);
+	bool result =
+		target_mem32_poll32(target, RCC_CR, RCC_CR_PLLRDY, RCC_CR_PLLRDY, G0_CLOCK_SWITCH_TIMEOUT, NULL, NULL);
+	/* The wait states have to go up before the clock does */
+	if (result) {
+		target_mem32_write32(
+			target, FLASH_ACR, (priv->clock_saved_acr & ~FLASH_ACR_LATENCY_MASK) | G0_BOOST_LATENCY);
+		result = target_mem32_poll32(
+			target, FLASH_ACR, FLASH_ACR_LATENCY_MASK, G0_BOOST_LATENCY, G0_CLOCK_SWITCH_TIMEOUT, NULL, NULL);
+	}
+	if (result) {
+		target_mem32_write32(target, RCC_CFGR, config | RCC_CFGR_SW_PLLRCLK);
+		result = target_mem32_poll32(
+			target, RCC_CFGR, RCC_CFGR_SWS_MASK, RCC_CFGR_SWS_PLLRCLK, G0_CLOCK_SWITCH_TIMEOUT, NULL, NULL);
+	}
+	if (!result)
+		stm32g0_flash_clock_restore(target);
+	return result;
+}
+
+static void stm32g0_flash_clock_restore(target_s *const target)
+{
+	stm32g0_priv_s *const priv = (stm32g0_priv_s *)target->target_storage;
+	if (!priv->clock_boosted)
+		return;
+	priv->clock_boosted = false;
+	/* Back onto HSISYS first, then the PLL can go and the wait states come down again */
+	target_mem32_write32(target, RCC_CFGR, priv->clock_saved_cfgr);
+	target_mem32_poll32(target, RCC_CFGR, RCC_CFGR_SWS_MASK, 0U, G0_CLOCK_SWITCH_TIMEOUT, NULL, NULL);
+	target_mem32_write32(target, RCC_CR, priv->clock_saved_cr);
+	target_mem32_poll32(target, RCC_CR, RCC_CR_PLLRDY, 0U, G0_CLOCK_SWITCH_TIMEOUT, NULL, NULL);
+	target_mem32_write32(target, RCC_PLLCFGR, priv->clock_saved_pllcfgr);
+	target_mem32_write32(target, FLASH_ACR, priv->clock_saved_acr);
+}
+
 static bool stm32g0_mass_erase(target_s *const target, platform_timeout_s *const print_progess)
 {
 	const uint32_t ctrl = FLASH_CR_MER1 | FLASH_CR_MER2 | FLASH_CR_START;
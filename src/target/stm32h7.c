@@ -184,6 +184,8 @@ typedef struct stm32h7_flash {
 	target_flash_s target_flash;
 	align_e psize;
 	uint32_t regbase;
+	/* Set while an erase started on this bank is left running so the other bank can get on in the meantime */
+	bool erase_pending;
 } stm32h7_flash_s;
 
 typedef struct stm32h7_priv {
@@ -207,10 +209,13 @@ const command_s stm32h7_cmd_list[] = {
 
 static bool stm32h7_attach(target_s *target);
 static void stm32h7_detach(target_s *target);
+static bool stm32h7_exit_flash_mode(target_s *target);
 static bool stm32h7_flash_erase(target_flash_s *target_flash, target_addr_t addr, size_t len);
 static bool stm32h7_flash_write(target_flash_s *target_flash, target_addr_t dest, const void *src, size_t len);
+static bool stm32h7_flash_write_wait(target_flash_s *target_flash);
 static bool stm32h7_flash_prepare(target_flash_s *target_flash);
 static bool stm32h7_flash_done(target_flash_s *target_flash);
+static bool stm32h7_flash_mass_erase(target_flash_s *target_flash, platform_timeout_s *print_progess);
 static bool stm32h7_mass_erase(target_s *target, platform_timeout_s *print_progess);
 
 static uint32_t stm32h7_flash_bank_base(const uint32_t addr)
@@ -233,7 +238,9 @@ static void stm32h7_add_flash(target_s *target, uint32_t addr, size_t length, si
 	target_flash->length = length;
 	target_flash->blocksize = blocksize;
 	target_flash->erase = stm32h7_flash_erase;
+	target_flash->mass_erase = stm32h7_flash_mass_erase;
 	target_flash->write = stm32h7_flash_write;
+	target_flash->write_wait = stm32h7_flash_write_wait;
 	target_flash->prepare = stm32h7_flash_prepare;
 	target_flash->done = stm32h7_flash_done;
 	target_flash->writesize = 2048;
@@ -299,6 +306,7 @@ bool stm32h7_probe(target_s *target)
 	target->driver = priv->name;
 	target->attach = stm32h7_attach;
 	target->detach = stm32h7_detach;
+	target->exit_flash_mode = stm32h7_exit_flash_mode;
 	target->mass_erase = stm32h7_mass_erase;
 	target_add_commands(target, stm32h7_cmd_list, target->driver);
 
@@ -474,25 +482,60 @@ static bool stm32h7_flash_unlock(target_s *const target, const uint32_t regbase)
 	return !(target_mem32_read32(target, regbase + STM32H7_FLASH_CTRL) & STM32H7_FLASH_CTRL_LOCK);
 }
 
+/* Wait for any erase left running on this bank to finish, reporting how it went */
+static bool stm32h7_flash_erase_wait(stm32h7_flash_s *const flash)
+{
+	if (!flash->erase_pending)
+		return true;
+	flash->erase_pending = false;
+	return stm32h7_flash_wait_complete(flash->target_flash.t, flash->regbase);
+}
+
+static void stm32h7_flash_lock(target_s *const target, const stm32h7_flash_s *const flash)
+{
+	target_mem32_write32(target, flash->regbase + STM32H7_FLASH_CTRL,
+		(flash->psize << STM32H7_FLASH_CTRL_PSIZE_SHIFT) | STM32H7_FLASH_CTRL_LOCK);
+}
+
 static bool stm32h7_flash_prepare(target_flash_s *target_flash)
 {
 	target_s *target = target_flash->t;
-	const stm32h7_flash_s *const flash = (stm32h7_flash_s *)target_flash;
+	stm32h7_flash_s *const flash = (stm32h7_flash_s *)target_flash;
 
-	/* Unlock the Flash controller to prepare it for operations */
-	return stm32h7_flash_unlock(target, flash->regbase);
+	/* Let any erase still running on this bank finish, then unlock the controller to prepare it for operations */
+	return stm32h7_flash_erase_wait(flash) && stm32h7_flash_unlock(target, flash->regbase);
 }
 
 static bool stm32h7_flash_done(target_flash_s *target_flash)
 {
 	target_s *target = target_flash->t;
 	const stm32h7_flash_s *const flash = (stm32h7_flash_s *)target_flash;
-	/* Lock the Flash controller to complete operations */
-	target_mem32_write32(target, flash->regbase + STM32H7_FLASH_CTRL,
-		(flash->psize << STM32H7_FLASH_CTRL_PSIZE_SHIFT) | STM32H7_FLASH_CTRL_LOCK);
+	/*
+	 * Lock the Flash controller to complete operations, unless an erase is still running on it -
+	 * in which case locking waits till that's finished, in either prepare or exiting Flash mode
+	 */
+	if (!flash->erase_pending)
+		stm32h7_flash_lock(target, flash);
 	return true;
 }
 
+/* Finish off any erases left running on either bank and lock them before the core gets reset */
+static bool stm32h7_exit_flash_mode(target_s *const target)
+{
+	bool result = true;
+	for (target_flash_s *target_flash = target->flash; target_flash; target_flash = target_flash->next) {
+		if (target_flash->write != stm32h7_flash_write)
+			continue;
+		stm32h7_flash_s *const flash = (stm32h7_flash_s *)target_flash;
+		if (flash->erase_pending) {
+			result &= stm32h7_flash_erase_wait(flash);
+			stm32h7_flash_lock(target, flash);
+		}
+	}
+	target_reset(target);
+	return result;
+}
+
 /* Helper for offsetting FLASH_CR bits correctly */
 static uint32_t stm32h7_flash_cr(uint32_t sector_size, const uint32_t ctrl, const uint8_t sector_number)
 {
@@ -522,7 +565,10 @@ static bool stm32h7_flash_erase(target_flash_s *const target_flash, target_addr_
 	(void)len;
 	/* Erases are always done one sector at a time - the target Flash API guarantees this */
 	target_s *target = target_flash->t;
-	const stm32h7_flash_s *const flash = (stm32h7_flash_s *)target_flash;
+	stm32h7_flash_s *const flash = (stm32h7_flash_s *)target_flash;
+	/* Make sure the previous sector on this bank has finished erasing */
+	if (!stm32h7_flash_erase_wait(flash))
+		return false;
 
 	/* Calculate the sector to erase and set the operation runnning */
 	const uint32_t sector = (addr - target_flash->start) / target_flash->blocksize;
@@ -532,8 +578,12 @@ static bool stm32h7_flash_erase(target_flash_s *const target_flash, target_addr_
 	target_mem32_write32(target, flash->regbase + STM32H7_FLASH_CTRL,
 		stm32h7_flash_cr(target_flash->blocksize, ctrl | STM32H7_FLASH_CTRL_START, sector));
 
-	/* Wait for the operation to complete and report errors */
-	return stm32h7_flash_wait_complete(target, flash->regbase);
+	/*
+	 * Leave the erase running, the banks have independent controllers so the other one is free to
+	 * be erased or programmed meanwhile. Anything else done to this bank waits for completion first.
+	 */
+	flash->erase_pending = true;
+	return !target_check_error(target);
 }
 
 static bool stm32h7_flash_write(
@@ -562,8 +612,18 @@ static bool stm32h7_flash_write(
 			continue;
 	}
 
+	/*
+	 * The final Flash word is now queued and being programmed, leave waiting for it to
+	 * stm32h7_flash_write_wait() so the next block can be received in the meantime
+	 */
+	return !target_check_error(target);
+}
+
+static bool stm32h7_flash_write_wait(target_flash_s *const target_flash)
+{
+	const stm32h7_flash_s *const flash = (stm32h7_flash_s *)target_flash;
 	/* Wait for the operation to complete and report errors */
-	return stm32h7_flash_wait_complete(target, flash->regbase);
+	return stm32h7_flash_wait_complete(target_flash->t, flash->regbase);
 }
 
 static bool stm32h7_erase_bank(target_s *const target, const align_e psize, const uint32_t reg_base)
@@ -582,12 +642,10 @@ static bool stm32h7_erase_bank(target_s *const target, const align_e psize, cons
 
 static bool stm32h7_wait_erase_bank(target_s *const target, platform_timeout_s *const timeout, const uint32_t reg_base)
 {
-	while (target_mem32_read32(target, reg_base + STM32H7_FLASH_STATUS) & STM32H7_FLASH_STATUS_QUEUE_WAIT) {
-		if (target_check_error(target)) {
-			DEBUG_ERROR("mass erase bank: comm failed\n");
-			return false;
-		}
-		target_print_progress(timeout);
+	if (!target_mem32_poll32(
+			target, reg_base + STM32H7_FLASH_STATUS, STM32H7_FLASH_STATUS_QUEUE_WAIT, 0U, 0U, timeout, NULL)) {
+		DEBUG_ERROR("mass erase bank: comm failed\n");
+		return false;
 	}
 	return true;
 }
@@ -600,6 +658,23 @@ static bool stm32h7_check_bank(target_s *const target, const uint32_t reg_base)
 	return !(status & STM32H7_FLASH_STATUS_ERROR_MASK);
 }
 
+/*
+ * Bank erase just the one bank this Flash region is, letting the erase planner use it for whole-bank reflashes.
+ * When run from the planner, the erase is left running like a sector erase so the next bank's erase overlaps it.
+ */
+static bool stm32h7_flash_mass_erase(target_flash_s *const target_flash, platform_timeout_s *const print_progess)
+{
+	target_s *const target = target_flash->t;
+	stm32h7_flash_s *const flash = (stm32h7_flash_s *)target_flash;
+	if (!stm32h7_flash_erase_wait(flash) || !stm32h7_erase_bank(target, flash->psize, flash->regbase))
+		return false;
+	if (!print_progess) {
+		flash->erase_pending = true;
+		return !target_check_error(target);
+	}
+	return stm32h7_wait_erase_bank(target, print_progess, flash->regbase) && stm32h7_check_bank(target, flash->regbase);
+}
+
 /* Both banks are erased in parallel.*/
 static bool stm32h7_mass_erase(target_s *const target, platform_timeout_s *const print_progess)
 {
@@ -45,6 +45,7 @@
 #include "target_internal.h"
 #include "cortexm.h"
 #include "stm32_common.h"
+#include "flashloader.h"
 
 #define STM32Lx_FLASH_BANK_BASE 0x08000000U
 #define STM32L0_FLASH_BANK_SIZE 0x00010000U
@@ -54,6 +55,9 @@
 #define STM32Lx_SRAM_BASE       0x20000000U
 #define STM32L0_SRAM_SIZE       0x00005000U
 #define STM32L1_SRAM_SIZE       0x00014000U
+/* How much to program in one go when writing - this must divide the Flash and data EEPROM sizes */
+#define STM32Lx_FLASH_WRITE_SIZE  1024U
+#define STM32Lx_EEPROM_WRITE_SIZE 256U
 
 #define STM32Lx_FLASH_PECR(flash_base)    ((flash_base) + 0x04U)
 #define STM32Lx_FLASH_PEKEYR(flash_base)  ((flash_base) + 0x0cU)
@@ -232,7 +236,8 @@ static void stm32l_add_flash(target_s *const target, const uint32_t addr, const
 	flash->blocksize = erasesize;
 	flash->erase = stm32lx_flash_erase;
 	flash->write = stm32lx_flash_write;
-	flash->writesize = erasesize >> 1U;
+	/* Programming is done a half-page at a time regardless, so hand over bigger chunks for the loader's benefit */
+	flash->writesize = STM32Lx_FLASH_WRITE_SIZE;
 	target_add_flash(target, flash);
 }
 
@@ -249,6 +254,7 @@ static void stm32l_add_eeprom(target_s *const target, const uint32_t addr, const
 	flash->blocksize = 4;
 	flash->erase = stm32lx_eeprom_erase;
 	flash->write = stm32lx_eeprom_write;
+	flash->writesize = STM32Lx_EEPROM_WRITE_SIZE;
 	target_add_flash(target, flash);
 }
 
@@ -517,14 +523,10 @@ static bool stm32lx_nvm_opt_unlock(target_s *const target, const target_addr32_t
 static bool stm32lx_nvm_busy_wait(
 	target_s *const target, const target_addr32_t flash_base, platform_timeout_s *const timeout)
 {
-	while (target_mem32_read32(target, STM32Lx_FLASH_SR(flash_base)) & STM32Lx_FLASH_SR_BSY) {
-		if (target_check_error(target))
-			return false;
-		if (timeout)
-			target_print_progress(timeout);
-	}
-	const uint32_t status = target_mem32_read32(target, STM32Lx_FLASH_SR(flash_base));
-	return !target_check_error(target) && !(status & STM32Lx_FLASH_SR_ERR_MASK);
+	uint32_t status = 0U;
+	if (!target_mem32_poll32(target, STM32Lx_FLASH_SR(flash_base), STM32Lx_FLASH_SR_BSY, 0U, 0U, timeout, &status))
+		return false;
+	return !(status & STM32Lx_FLASH_SR_ERR_MASK);
 }
 
 /*
@@ -570,12 +572,16 @@ static bool stm32lx_flash_erase(target_flash_s *const flash, const target_addr_t
 	return stm32lx_nvm_busy_wait(target, flash_base, full_erase ? &timeout : NULL);
 }
 
-/* Write to program flash using operations through the debug interface. */
+/*
+ * Write to program flash in half-page bursts. If there's enough RAM on the target, the RAM-resident loader
+ * does the writes and waits for each half-page to program, otherwise it's done through the debug interface.
+ */
 static bool stm32lx_flash_write(
 	target_flash_s *const flash, const target_addr_t dest, const void *const src, const size_t length)
 {
 	target_s *const target = flash->t;
 	const target_addr32_t flash_base = stm32lx_flash_base(target);
+	const size_t half_page = flash->blocksize >> 1U;
 
 	if (!stm32lx_nvm_prog_data_unlock(target, flash_base))
 		return false;
@@ -585,13 +591,30 @@ static bool stm32lx_flash_write(
 		return false;
 
 	target_mem32_write32(target, STM32Lx_FLASH_PECR(flash_base), STM32Lx_FLASH_PECR_PROG | STM32Lx_FLASH_PECR_FPRG);
-	target_mem32_write(target, dest, src, length);
+	bool result = true;
+	if (flashloader_usable(target, length)) {
+		/* Each half-page has to be written as consecutive words, which then program together */
+		const flashloader_params_s params = {
+			.status_reg = STM32Lx_FLASH_SR(flash_base),
+			.busy_mask = STM32Lx_FLASH_SR_BSY,
+			.error_mask = STM32Lx_FLASH_SR_ERR_MASK,
+			.access_width = 4U,
+			.burst_mask = half_page - 1U,
+		};
+		result = flashloader_write(target, &params, dest, src, length);
+	} else {
+		const uint8_t *const data = (const uint8_t *)src;
+		for (size_t offset = 0; result && offset < length; offset += half_page) {
+			target_mem32_write(target, dest + offset, data + offset, half_page);
+			result = stm32lx_nvm_busy_wait(target, flash_base, NULL);
+		}
+	}
 
 	/* Disable further programming by locking PECR */
 	stm32lx_nvm_lock(target, flash_base);
 
 	/* Wait for completion or an error */
-	return stm32lx_nvm_busy_wait(target, flash_base, NULL);
+	return stm32lx_nvm_busy_wait(target, flash_base, NULL) && result;
 }
 
 /*
@@ -627,7 +650,7 @@ static bool stm32lx_eeprom_erase(target_flash_s *const flash, const target_addr_
 }
 
 /*
- * Write to data flash using operations through the debug interface.
+ * Write to data flash, using the RAM-resident loader if the target has the RAM for it.
  * The FLASH register base is automatically determined based on the target.
  * Unaligned destination writes are supported (though unaligned sources are not).
  */
@@ -643,11 +666,27 @@ static bool stm32lx_eeprom_write(
 
 	target_mem32_write32(target, STM32Lx_FLASH_PECR(flash_base), is_stm32l1 ? 0 : STM32Lx_FLASH_PECR_DATA);
 
-	/* Sling data to the target one uint32_t at a time */
+	/*
+	 * Each word write stalls the bus until it's programmed, so if there's enough RAM on the target have the
+	 * RAM-resident loader wait on each one rather than the debug interface
+	 */
+	if (flashloader_usable(target, length)) {
+		const flashloader_params_s params = {
+			.status_reg = STM32Lx_FLASH_SR(flash_base),
+			.busy_mask = STM32Lx_FLASH_SR_BSY,
+			.error_mask = STM32Lx_FLASH_SR_ERR_MASK,
+			.access_width = 4U,
+		};
+		const bool result = flashloader_write(target, &params, dest, src, length);
+		stm32lx_nvm_lock(target, flash_base);
+		return stm32lx_nvm_busy_wait(target, flash_base, NULL) && result;
+	}
+
+	/* Otherwise sling data to the target one uint32_t at a time */
 	const uint32_t *const data = (const uint32_t *)src;
 	for (size_t offset = 0; offset < length; offset += 4U) {
 		/* XXX: Why is this not able to use target_mem_write()? */
-		if (target_mem32_write32(target, dest + offset, data[offset]))
+		if (target_mem32_write32(target, dest + offset, data[offset / 4U]))
 			return false;
 	}
 
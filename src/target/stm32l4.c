@@ -64,8 +64,11 @@ static bool stm32l4_cmd_uid(target_s *target, int argc, const char **argv);
 static bool stm32l4_attach(target_s *target);
 static void stm32l4_detach(target_s *target);
 static bool stm32l4_flash_erase(target_flash_s *flash, target_addr_t addr, size_t len);
+static bool stm32l4_flash_erase_wait(target_flash_s *flash);
 static bool stm32l4_flash_write(target_flash_s *flash, target_addr_t dest, const void *src, size_t len);
 static bool stm32l4_mass_erase(target_s *target, platform_timeout_s *print_progess);
+static bool stm32l4_flash_clock_boost(target_s *target);
+static void stm32l4_flash_clock_restore(target_s *target);
 
 const command_s stm32l4_cmd_list[] = {
 	{"erase_bank1", stm32l4_cmd_erase_bank1, "Erase entire bank1 flash memory"},
@@ -160,6 +163,33 @@ const command_s stm32l4_cmd_list[] = {
 #define STM32L5_PWR_CR1            0x50007000U
 #define STM32L5_PWR_CR1_VOS        (3U << 9U)
 
+#define STM32L4_RCC_BASE             0x40021000U
+#define STM32L4_RCC_CR               (STM32L4_RCC_BASE + 0x00U)
+#define STM32L4_RCC_CR_HSION         (1U << 8U)
+#define STM32L4_RCC_CR_HSIRDY        (1U << 10U)
+#define STM32L4_RCC_CR_PLLON         (1U << 24U)
+#define STM32L4_RCC_CR_PLLRDY        (1U << 25U)
+#define STM32L4_RCC_CFGR             (STM32L4_RCC_BASE + 0x08U)
+#define STM32L4_RCC_CFGR_SW_MASK     (3U << 0U)
+#define STM32L4_RCC_CFGR_SW_PLL      (3U << 0U)
+#define STM32L4_RCC_CFGR_SWS_MASK    (3U << 2U)
+#define STM32L4_RCC_CFGR_SWS_PLL     (3U << 2U)
+#define STM32L4_RCC_PLLCFGR          (STM32L4_RCC_BASE + 0x0cU)
+#define STM32L4_RCC_PLLCFGR_HSI16    (2U << 0U)
+#define STM32L4_RCC_PLLCFGR_N_SHIFT  8U
+#define STM32L4_RCC_PLLCFGR_REN      (1U << 24U)
+#define STM32L4_RCC_APB1ENR1         (STM32L4_RCC_BASE + 0x58U)
+#define STM32L4_RCC_APB1ENR1_PWREN   (1U << 28U)
+#define STM32L4_PWR_CR1              0x40007000U
+#define STM32L4_PWR_CR1_VOS_MASK     (3U << 9U)
+#define STM32L4_PWR_CR1_VOS_RANGE1   (1U << 9U)
+#define STM32L4_FLASH_ACR            (STM32L4_FPEC_BASE + 0x00U)
+#define STM32L4_FLASH_ACR_LATENCY    0xfU
+/* HSI16 * 10 / 2 gives 80MHz, which needs 4 wait states in range 1 on both L4 and L4+ */
+#define STM32L4_BOOST_PLLN           10U
+#define STM32L4_BOOST_LATENCY        4U
+#define STM32L4_CLOCK_SWITCH_TIMEOUT 10U
+
 #define DUAL_BANK     0x80U
 #define RAM_COUNT_MSK 0x07U
 
@@ -270,6 +300,12 @@ typedef struct stm32l4_flash {
 
 typedef struct stm32l4_priv {
 	const stm32l4_device_info_s *device;
+	/* The clock registers as they were before stm32l4_flash_clock_boost() changed them */
+	bool clock_boosted;
+	uint32_t clock_saved_cr;
+	uint32_t clock_saved_cfgr;
+	uint32_t clock_saved_pllcfgr;
+	uint32_t clock_saved_acr;
 } stm32l4_priv_s;
 
 typedef struct stm32l4_option_bytes_info {
@@ -607,6 +643,7 @@ static void stm32l4_add_flash(target_s *const target, const uint32_t addr, const
 	target_flash->length = length;
 	target_flash->blocksize = blocksize;
 	target_flash->erase = stm32l4_flash_erase;
+	target_flash->erase_wait = stm32l4_flash_erase_wait;
 	target_flash->write = stm32l4_flash_write;
 	target_flash->writesize = 2048;
 	target_flash->erased = 0xffU;
@@ -648,6 +685,11 @@ static bool stm32l4_configure_dbgmcu(target_s *const target, const stm32l4_devic
 
 		target->attach = stm32l4_attach;
 		target->detach = stm32l4_detach;
+		/* Only the L4 and L4+ share this RCC layout and clock limits */
+		if (device->family == STM32L4_FAMILY_L4xx || device->family == STM32L4_FAMILY_L4Rx) {
+			target->flash_clock_boost = stm32l4_flash_clock_boost;
+			target->flash_clock_restore = stm32l4_flash_clock_restore;
+		}
 	}
 
 	const stm32l4_priv_s *const priv = (stm32l4_priv_s *)target->target_storage;
@@ -870,16 +912,14 @@ static void stm32l4_flash_unlock(target_s *const target)
 
 static bool stm32l4_flash_busy_wait(target_s *const target, platform_timeout_s *const print_progess)
 {
-	/* Read FLASH_SR to poll for BSY bit */
-	uint32_t status = FLASH_SR_BSY;
-	while (status & FLASH_SR_BSY) {
-		status = stm32l4_flash_read32(target, FLASH_SR);
-		if ((status & FLASH_SR_ERROR_MASK) || target_check_error(target)) {
-			DEBUG_ERROR("stm32l4 Flash error: status 0x%" PRIx32 "\n", status);
-			return false;
-		}
-		if (print_progess)
-			target_print_progress(print_progess);
+	stm32l4_priv_s *priv = (stm32l4_priv_s *)target->target_storage;
+	/* Poll FLASH_SR for the BSY bit to clear */
+	uint32_t status = 0U;
+	if (!target_mem32_poll32(
+			target, priv->device->flash_regs_map[FLASH_SR], FLASH_SR_BSY, 0U, 0U, print_progess, &status) ||
+		(status & FLASH_SR_ERROR_MASK)) {
+		DEBUG_ERROR("stm32l4 Flash error: status 0x%" PRIx32 "\n", status);
+		return false;
 	}
 	return true;
 }
@@ -907,11 +947,17 @@ static bool stm32l4_flash_erase(target_flash_s *const flash, const target_addr_t
 		/* write address to FMA */
 		stm32l4_flash_write32(target, FLASH_CR, ctrl | FLASH_CR_STRT);
 
-		/* Wait for completion or an error */
-		if (!stm32l4_flash_busy_wait(target, NULL))
+		/* Wait for completion or an error, leaving the last page for stm32l4_flash_erase_wait() */
+		if (offset + flash->blocksize < len && !stm32l4_flash_busy_wait(target, NULL))
 			return false;
 	}
-	return true;
+	return !target_check_error(target);
+}
+
+static bool stm32l4_flash_erase_wait(target_flash_s *const flash)
+{
+	/* Wait for completion or an error */
+	return stm32l4_flash_busy_wait(flash->t, NULL);
 }
 
 static bool stm32l4_flash_write(target_flash_s *flash, target_addr_t dest, const void *src, size_t len)
@@ -924,6 +970,78 @@ static bool stm32l4_flash_write(target_flash_s *flash, target_addr_t dest, const
 	return stm32l4_flash_busy_wait(target, NULL);
 }
 
+/*
+ * Run the core at 80MHz from HSI16 through the PLL while Flashing, rather than the 4MHz MSI it comes out of
+ * reset on. This is only done while the clock tree is still as reset left it, in voltage range 1 and running
+ * from MSI with the PLL off, so nothing the firmware set up gets trampled on.
+ */
+static bool stm32l4_flash_clock_boost(target_s *const target)
+{
+	stm32l4_priv_s *const priv = (stm32l4_priv_s *)target->target_storage;
+	const uint32_t ctrl = target_mem32_read32(target, STM32L4_RCC_CR);
+	const uint32_t config = target_mem32_read32(target, STM32L4_RCC_CFGR);
+	const uint32_t apb1_enable = target_mem32_read32(target, STM32L4_RCC_APB1ENR1);
+	target_mem32_write32(target, STM32L4_RCC_APB1ENR1, apb1_enable | STM32L4_RCC_APB1ENR1_PWREN);
+	const uint32_t voltage = target_mem32_read32(target, STM32L4_PWR_CR1) & STM32L4_PWR_CR1_VOS_MASK;
+	target_mem32_write32(target, STM32L4_RCC_APB1ENR1, apb1_enable);
+	if (target_check_error(target))
+		return false;
+	if ((config & (STM32L4_RCC_CFGR_SW_MASK | STM32L4_RCC_CFGR_SWS_MASK)) || (ctrl & STM32L4_RCC_CR_PLLON) ||
+		voltage != STM32L4_PWR_CR1_VOS_RANGE1) {
+		DEBUG_TARGET("%s: clock tree not in its reset state, leaving it alone\n", __func__);
+		return true;
+	}
+
+	priv->clock_boosted = true;
+	priv->clock_saved_cr = ctrl;
+	priv->clock_saved_cfgr = config;
+	priv->clock_saved_pllcfgr = target_mem32_read32(target, STM32L4_RCC_PLLCFGR);
+	priv->clock_saved_acr = target_mem32_read32(target, STM32L4_FLASH_ACR);
+
+	target_mem32_write32(target, STM32L4_RCC_CR, ctrl | STM32L4_RCC_CR_HSION);
+	bool result = target_mem32_poll32(target, STM32L4_RCC_CR, STM32L4_RCC_CR_HSIRDY, STM32L4_RCC_CR_HSIRDY,
+		STM32L4_CLOCK_SWITCH_TIMEOUT, NULL, NULL);
+	if (result) {
+		target_mem32_write32(target, STM32L4_RCC_PLLCFGR,
+			STM32L4_RCC_PLLCFGR_HSI16 | (STM32L4_BOOST_PLLN << STM32L4_RCC_PLLCFGR_N_SHIFT) |
+				STM32L4_RCC_PLLCFGR_REN);
+		target_mem32_write32(target, STM32L4_RCC_CR, ctrl | STM32L4_RCC_CR_HSION | STM32L4_RCC_CR_PLLON);
+		result = target_mem32_poll32(target, STM32L4_RCC_CR, STM32L4_RCC_CR_PLLRDY, STM32L4_RCC_CR_PLLRDY,
+			STM32L4_CLOCK_SWITCH_TIMEOUT, NULL, NULL);
+	}
+	/* The wait states have to go up before the clock does */
+	if (result) {
+		const uint32_t access_ctrl = (priv->clock_saved_acr & ~STM32L4_FLASH_ACR_LATENCY) | STM32L4_BOOST_LATENCY;
+		target_mem32_write32(target, STM32L4_FLASH_ACR, access_ctrl);
+		result = target_mem32_poll32(target, STM32L4_FLASH_ACR, STM32L4_FLASH_ACR_LATENCY, STM32L4_BOOST_LATENCY,
+			STM32L4_CLOCK_SWITCH_TIMEOUT, NULL, NULL);
+	}
+	if (result) {
+		target_mem32_write32(target, STM32L4_RCC_CFGR, config | STM32L4_RCC_CFGR_SW_PLL);
+		result = target_mem32_poll32(target, STM32L4_RCC_CFGR, STM32L4_RCC_CFGR_SWS_MASK, STM32L4_RCC_CFGR_SWS_PLL,
+			STM32L4_CLOCK_SWITCH_TIMEOUT, NULL, NULL);
+	}
+	if (!result)
+		stm32l4_flash_clock_restore(target);
+	return result;
+}
+
+static void stm32l4_flash_clock_restore(target_s *const target)
+{
+	stm32l4_priv_s *const priv = (stm32l4_priv_s *)target->target_storage;
+	if (!priv->clock_boosted)
+		return;
+	priv->clock_boosted = false;
+	/* Back onto MSI first, then the PLL and HSI16 can go and the wait states come down again */
+	target_mem32_write32(target, STM32L4_RCC_CFGR, priv->clock_saved_cfgr);
+	target_mem32_poll32(target, STM32L4_RCC_CFGR, STM32L4_RCC_CFGR_SWS_MASK, 0U, STM32L4_CLOCK_SWITCH_TIMEOUT,
+		NULL, NULL);
+	target_mem32_write32(target, STM32L4_RCC_CR, priv->clock_saved_cr);
+	target_mem32_poll32(target, STM32L4_RCC_CR, STM32L4_RCC_CR_PLLRDY, 0U, STM32L4_CLOCK_SWITCH_TIMEOUT, NULL, NULL);
+	target_mem32_write32(target, STM32L4_RCC_PLLCFGR, priv->clock_saved_pllcfgr);
+	target_mem32_write32(target, STM32L4_FLASH_ACR, priv->clock_saved_acr);
+}
+
 static bool stm32l4_cmd_erase(target_s *const target, const uint32_t action, platform_timeout_s *const print_progess)
 {
 	stm32l4_flash_unlock(target);
@@ -32,6 +32,7 @@
 #include "target.h"
 #include "target_internal.h"
 #include "cortexm.h"
+#include "cortexar.h"
 #include "stm32_common.h"
 
 /* Memory map constants for STM32MP15x */
@@ -45,6 +46,11 @@
 #define STM32MP15_SYSRAM_SIZE            0x00040000U
 #define STM32MP15_CAN_SRAM_BASE          0x44011000U
 #define STM32MP15_CAN_SRAM_SIZE          0x00002800U
+#define STM32MP15_CA7_DDR_BASE           0xc0000000U
+#define STM32MP15_CA7_DDR_SIZE           0x40000000U /* DDR, up to 1 GiB */
+
+/* The AXI-AP on the DAP that gives access to the system via the AXI interconnect */
+#define STM32MP15_AXI_AP 0U
 
 /* Access from processor address space.
  * Access via the debug APB is at 0xe0081000 over AP1. */
@@ -186,6 +192,9 @@ bool stm32mp15_ca7_probe(target_s *const target)
 	target_add_ram32(target, STM32MP15_CA7_AHBSRAM_ALIAS_BASE, STM32MP15_AHBSRAM_SIZE);
 	target_add_ram32(target, STM32MP15_SYSRAM_BASE, STM32MP15_SYSRAM_SIZE);
 	target_add_ram32(target, STM32MP15_CAN_SRAM_BASE, STM32MP15_CAN_SRAM_SIZE);
+	target_add_ram32(target, STM32MP15_CA7_DDR_BASE, STM32MP15_CA7_DDR_SIZE);
+	/* Load images into DDR over the AXI-AP rather than through the core */
+	cortexar_bus_ap_set(target, STM32MP15_AXI_AP, STM32MP15_CA7_DDR_BASE, STM32MP15_CA7_DDR_SIZE);
 	return true;
 }
 #endif
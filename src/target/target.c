@@ -22,6 +22,8 @@
 #include "target_internal.h"
 #include "gdb_packet.h"
 #include "command.h"
+#include "stats.h"
+#include "buffer_utils.h"
 
 #include <stdarg.h>
 #include <assert.h>
@@ -42,21 +44,85 @@
 target_s *target_list = NULL;
 
 #define FLASH_WRITE_BUFFER_CEILING 1024U
+/* How long an offloaded poll may run before control comes back to check for errors and report progress */
+#define TARGET_MEM_POLL_SLICE_MS 100U
+/* The longest a deferred error check will go without doing the full check, see target_error_defer_begin() */
+#define TARGET_ERROR_DEFER_MS 20U
+/* The pattern buffer ordinary fill writes go from, and how much to hand a target-run fill at a time */
+#define TARGET_FILL_CHUNK_SIZE      256U
+#define TARGET_FILL_STUB_CHUNK_SIZE 65536U
+
+/*
+ * The memory read cache is cheap to have on the host, but firmware builds have to opt in, either at
+ * runtime or by way of the mem_cache_size build option, unless their platform turns it on by default
+ */
+#if !defined(TARGET_MEM_CACHE_DEFAULT_SIZE)
+#if CONFIG_BMDA == 1
+#define TARGET_MEM_CACHE_DEFAULT_SIZE 4096U
+#else
+#define TARGET_MEM_CACHE_DEFAULT_SIZE 0U
+#endif
+#endif
+
+uint32_t target_mem_cache_size = TARGET_MEM_CACHE_DEFAULT_SIZE;
+
+/* After this many reads that each start where the last ended, the cache reads ahead of the next miss */
+#define TARGET_MEM_PREFETCH_THRESHOLD 3U
+/* How far ahead to read in one transfer, capped to half the cache so the prefetch can't evict everything */
+#define TARGET_MEM_PREFETCH_SIZE 1024U
+
+/*
+ * Targets, their command lists and their RAM maps all live exactly as long as the current scan, so
+ * they are carved out of a fixed arena that target_list_free() resets in one go, rather than churning
+ * the heap on every scan. Anything that doesn't fit falls back to the heap as normal.
+ */
+#if CONFIG_BMDA == 1
+#define TARGET_ARENA_SIZE 8192U
+#else
+#define TARGET_ARENA_SIZE 1024U
+#endif
+#define TARGET_ARENA_ALIGN 8U
+
+static uint8_t target_arena[TARGET_ARENA_SIZE] __attribute__((aligned(TARGET_ARENA_ALIGN)));
+static size_t target_arena_used;
 
 static bool target_cmd_mass_erase(target_s *target, int argc, const char **argv);
 static bool target_cmd_range_erase(target_s *target, int argc, const char **argv);
 static bool target_cmd_redirect_output(target_s *target, int argc, const char **argv);
+static bool target_cmd_fill(target_s *target, int argc, const char **argv);
+static void target_mem_cache_stop(target_s *target);
 
 const command_s target_cmd_list[] = {
 	{"erase_mass", target_cmd_mass_erase, "Erase whole device Flash"},
 	{"erase_range", target_cmd_range_erase, "Erase a range of memory on a device"},
 	{"redirect_stdout", target_cmd_redirect_output, "Redirect semihosting output to aux USB serial"},
+	{"fill", target_cmd_fill, "Fill a range of memory with a repeated 32-bit value: <address> <length> [value]"},
 	{NULL, NULL, NULL},
 };
 
+static void *target_arena_alloc(const size_t size)
+{
+	const size_t aligned_size = (size + TARGET_ARENA_ALIGN - 1U) & ~(TARGET_ARENA_ALIGN - 1U);
+	if (aligned_size > TARGET_ARENA_SIZE - target_arena_used)
+		return calloc(1, size);
+	void *const result = target_arena + target_arena_used;
+	target_arena_used += aligned_size;
+	memset(result, 0, size);
+	return result;
+}
+
+static void target_arena_free(void *const ptr)
+{
+	/* Memory from the arena is only given back when the whole arena is reset */
+	const uint8_t *const bytes = (const uint8_t *)ptr;
+	if (bytes >= target_arena && bytes < target_arena + TARGET_ARENA_SIZE)
+		return;
+	free(ptr);
+}
+
 target_s *target_new(void)
 {
-	target_s *target = calloc(1, sizeof(*target));
+	target_s *target = target_arena_alloc(sizeof(*target));
 	if (!target) { /* calloc failed: heap exhaustion */
 		DEBUG_ERROR("calloc: failed in %s\n", __func__);
 		return NULL;
@@ -88,7 +154,7 @@ void target_ram_map_free(target_s *target)
 {
 	while (target->ram) {
 		target_ram_s *next = target->ram->next;
-		free(target->ram);
+		target_arena_free(target->ram);
 		target->ram = next;
 	}
 }
@@ -97,17 +163,27 @@ void target_flash_map_free(target_s *target)
 {
 	while (target->flash) {
 		target_flash_s *next = target->flash->next;
-		if (target->flash->buf)
-			free(target->flash->buf);
+		target_flash_buffers_release(target->flash);
 		free(target->flash);
 		target->flash = next;
 	}
 }
 
+static void target_mem_policy_free(target_s *const target)
+{
+	while (target->mem_policy) {
+		target_mem_policy_s *const next = target->mem_policy->next;
+		target_arena_free(target->mem_policy);
+		target->mem_policy = next;
+	}
+}
+
 void target_mem_map_free(target_s *target)
 {
 	target_ram_map_free(target);
 	target_flash_map_free(target);
+	target_mem_policy_free(target);
+	target_xml_release(target);
 }
 
 void target_list_free(void)
@@ -131,25 +207,29 @@ void target_list_free(void)
 			target->priv_free(target->priv);
 		while (target->commands) {
 			target_command_s *const tc = target->commands->next;
-			free(target->commands);
+			target_arena_free(target->commands);
 			target->commands = tc;
 		}
 		free(target->target_storage);
+		free(target->mem_cache);
+		free(target->mem_cache_data);
+		target_flash_breakpoints_free(target);
 		target_mem_map_free(target);
 		while (target->bw_list) {
 			void *next = target->bw_list->next;
 			free(target->bw_list);
 			target->bw_list = next;
 		}
-		free(target);
+		target_arena_free(target);
 		target = next_target;
 	}
 	target_list = NULL;
+	target_arena_used = 0U;
 }
 
 void target_add_commands(target_s *target, const command_s *cmds, const char *name)
 {
-	target_command_s *command = malloc(sizeof(*command));
+	target_command_s *command = target_arena_alloc(sizeof(*command));
 	if (!command) { /* malloc failed: heap exhaustion */
 		DEBUG_ERROR("malloc: failed in %s\n", __func__);
 		return;
@@ -186,6 +266,8 @@ target_s *target_attach(target_s *target, target_controller_s *controller)
 	target->tc = controller;
 	platform_target_clk_output_enable(true);
 	DEBUG_TARGET("Attaching to target..\n");
+	/* Attaching can change both the register set and the memory map, so regenerate them afterwards */
+	target_xml_release(target);
 
 	if (target->attach && !target->attach(target)) {
 		DEBUG_TARGET("Attach failed\n");
@@ -205,7 +287,7 @@ void target_add_ram32(target_s *const target, const target_addr32_t start, const
 
 void target_add_ram64(target_s *const target, const target_addr64_t start, const uint64_t len)
 {
-	target_ram_s *ram = malloc(sizeof(*ram));
+	target_ram_s *ram = target_arena_alloc(sizeof(*ram));
 	if (!ram) { /* malloc failed: heap exhaustion */
 		DEBUG_ERROR("malloc: failed in %s\n", __func__);
 		return;
@@ -217,6 +299,62 @@ void target_add_ram64(target_s *const target, const target_addr64_t start, const
 	target->ram = ram;
 }
 
+void target_add_mem_policy(
+	target_s *const target, const target_addr32_t start, const uint32_t length, const uint8_t flags)
+{
+	target_mem_policy_s *const policy = target_arena_alloc(sizeof(*policy));
+	if (!policy) { /* calloc failed: heap exhaustion */
+		DEBUG_ERROR("calloc: failed in %s\n", __func__);
+		return;
+	}
+
+	policy->start = start;
+	policy->length = length;
+	policy->flags = flags;
+	policy->next = target->mem_policy;
+	target->mem_policy = policy;
+}
+
+/* Narrow *run_end down to the next boundary of [start, start + length) after addr, returning if addr is inside */
+static bool target_mem_policy_bound(
+	const target_addr32_t addr, const target_addr32_t start, const size_t length, target_addr64_t *const run_end)
+{
+	const target_addr64_t end = (target_addr64_t)start + length;
+	if (addr >= start && addr < end) {
+		*run_end = MIN(*run_end, end);
+		return true;
+	}
+	if (start > addr)
+		*run_end = MIN(*run_end, (target_addr64_t)start);
+	return false;
+}
+
+uint8_t target_mem_policy(target_s *const target, const target_addr32_t addr, target_addr64_t *const run_end)
+{
+	*run_end = UINT64_C(1) << 32U;
+	/* Driver hints come first, the most recently added winning where they overlap */
+	bool hinted = false;
+	uint8_t flags = 0U;
+	for (const target_mem_policy_s *policy = target->mem_policy; policy; policy = policy->next) {
+		if (target_mem_policy_bound(addr, policy->start, policy->length, run_end) && !hinted) {
+			hinted = true;
+			flags = policy->flags;
+		}
+	}
+	/* Otherwise RAM is safe to read and cache, as is Flash which only changes when we write it */
+	for (const target_ram_s *ram = target->ram; ram; ram = ram->next) {
+		if (target_mem_policy_bound(addr, ram->start, ram->length, run_end) && !hinted)
+			flags |= TARGET_MEM_READ_SAFE | TARGET_MEM_CACHEABLE;
+	}
+	for (const target_flash_s *flash = target->flash; flash; flash = flash->next) {
+		if (target_mem_policy_bound(addr, flash->start, flash->length, run_end) && !hinted)
+			flags |= TARGET_MEM_READ_SAFE | TARGET_MEM_CACHEABLE;
+	}
+	if (!hinted && target_mem_access_needs_halt(target))
+		flags |= TARGET_MEM_NEEDS_HALT;
+	return flags;
+}
+
 void target_add_flash(target_s *target, target_flash_s *flash)
 {
 	if (flash->writesize == 0)
@@ -242,37 +380,160 @@ bool target_enter_flash_mode_stub(target_s *target)
 	return true;
 }
 
-static ssize_t map_ram(char *buf, size_t len, target_ram_s *ram)
+/*
+ * Where the next part of a memory map goes and how much room is left there - once the buffer is full,
+ * snprintf() is given no buffer at all, so it carries on counting how much space was needed without writing
+ */
+static char *map_cursor(char *const buf, const size_t len, const size_t offset)
+{
+	return offset < len ? buf + offset : NULL;
+}
+
+static size_t map_space(const size_t len, const size_t offset)
+{
+	return offset < len ? len - offset : 0U;
+}
+
+static size_t map_ram(char *buf, size_t len, target_ram_s *ram)
 {
 	return snprintf(buf, len, "<memory type=\"ram\" start=\"0x%08" PRIx32 "\" length=\"0x%" PRIx32 "\"/>", ram->start,
 		(uint32_t)ram->length);
 }
 
-static ssize_t map_flash(char *buf, size_t len, target_flash_s *flash)
+static size_t map_flash(char *buf, size_t len, target_flash_s *flash)
 {
-	ssize_t offset = 0;
-	offset += snprintf(&buf[offset], len - offset,
+	size_t offset = 0;
+	offset += snprintf(map_cursor(buf, len, offset), map_space(len, offset),
 		"<memory type=\"flash\" start=\"0x%08" PRIx32 "\" length=\"0x%" PRIx32 "\">", flash->start,
 		(uint32_t)flash->length);
-	offset += snprintf(buf + offset, len - offset, "<property name=\"blocksize\">0x%" PRIx32 "</property></memory>",
-		(uint32_t)flash->blocksize);
+	offset += snprintf(map_cursor(buf, len, offset), map_space(len, offset),
+		"<property name=\"blocksize\">0x%" PRIx32 "</property></memory>", (uint32_t)flash->blocksize);
 	return offset;
 }
 
 bool target_mem_map(target_s *target, char *tmp, size_t len)
 {
 	size_t offset = 0;
-	offset = snprintf(tmp + offset, len - offset, "<memory-map>");
+	offset = snprintf(tmp, len, "<memory-map>");
 	/* Map each defined RAM */
 	for (target_ram_s *ram = target->ram; ram; ram = ram->next)
-		offset += map_ram(tmp + offset, len - offset, ram);
+		offset += map_ram(map_cursor(tmp, len, offset), map_space(len, offset), ram);
 	/* Map each defined Flash */
 	for (target_flash_s *flash = target->flash; flash; flash = flash->next)
-		offset += map_flash(tmp + offset, len - offset, flash);
-	offset += snprintf(tmp + offset, len - offset, "</memory-map>");
+		offset += map_flash(map_cursor(tmp, len, offset), map_space(len, offset), flash);
+	offset += snprintf(map_cursor(tmp, len, offset), map_space(len, offset), "</memory-map>");
 	return offset < len - 1U;
 }
 
+/* Start point for sizing the memory map XML buffer, doubled each time the map doesn't fit */
+#define TARGET_MEM_MAP_XML_SIZE 1024U
+
+const char *target_mem_map_xml(target_s *const target, size_t *const length)
+{
+	for (size_t size = TARGET_MEM_MAP_XML_SIZE; !target->mem_map_xml; size *= 2U) {
+		char *const xml = malloc(size);
+		if (!xml) { /* malloc failed: heap exhaustion */
+			DEBUG_ERROR("malloc: failed in %s\n", __func__);
+			return NULL;
+		}
+		if (target_mem_map(target, xml, size)) {
+			target->mem_map_xml = xml;
+			target->mem_map_xml_length = strlen(xml);
+		} else
+			free(xml);
+	}
+	*length = target->mem_map_xml_length;
+	return target->mem_map_xml;
+}
+
+/* Add length characters of a piece to the description, copying out whatever part of it overlaps the window */
+static void target_description_write(
+	target_description_stream_s *const stream, const char *const piece, const size_t length)
+{
+	const size_t window_end = stream->start + stream->length;
+	if (stream->buffer && stream->offset + length > stream->start && stream->offset < window_end) {
+		const size_t begin = stream->start > stream->offset ? stream->start - stream->offset : 0U;
+		const size_t end = MIN(length, window_end - stream->offset);
+		memcpy(stream->buffer + (stream->offset + begin - stream->start), piece + begin, end - begin);
+	}
+	stream->offset += length;
+}
+
+void target_description_puts(target_description_stream_s *const stream, const char *const xml)
+{
+	target_description_write(stream, xml, strlen(xml));
+}
+
+void target_description_pieces(target_description_stream_s *const stream,
+	const target_description_piece_s *const pieces, const size_t count, const uint32_t options)
+{
+	for (size_t idx = 0U; idx < count; ++idx) {
+		if ((options & pieces[idx].options) == pieces[idx].options)
+			target_description_puts(stream, pieces[idx].xml);
+	}
+}
+
+void target_description_printf(target_description_stream_s *const stream, const char *const fmt, ...)
+{
+	char piece[TARGET_DESCRIPTION_PIECE_MAX];
+	va_list args;
+	va_start(args, fmt);
+	const int result = vsnprintf(piece, sizeof(piece), fmt, args);
+	va_end(args);
+	if (result > 0)
+		target_description_write(stream, piece, MIN((size_t)result, sizeof(piece) - 1U));
+}
+
+#if CONFIG_BMDA == 1
+/* The host can afford to keep the whole description around, rather than generating it again for each chunk */
+static bool target_description_cache(target_s *const target)
+{
+	if (target->description_xml)
+		return true;
+	target_description_stream_s stream = {0};
+	target->regs_description(target, &stream);
+	char *const xml = malloc(stream.offset);
+	if (!xml)
+		return false;
+	stream = (target_description_stream_s){.buffer = xml, .length = stream.offset};
+	target->regs_description(target, &stream);
+	target->description_xml = xml;
+	target->description_xml_length = stream.offset;
+	return true;
+}
+#endif
+
+size_t target_description_read(
+	target_s *const target, char *const buffer, const size_t offset, const size_t length, size_t *const total)
+{
+	*total = 0U;
+	if (!target->regs_description)
+		return 0U;
+#if CONFIG_BMDA == 1
+	if (target_description_cache(target)) {
+		*total = target->description_xml_length;
+		const size_t amount = offset < *total ? MIN(length, *total - offset) : 0U;
+		memcpy(buffer, target->description_xml + offset, amount);
+		return amount;
+	}
+#endif
+	/* Otherwise generate the whole document, keeping just the part asked for */
+	target_description_stream_s stream = {.buffer = buffer, .start = offset, .length = length};
+	target->regs_description(target, &stream);
+	*total = stream.offset;
+	return offset < stream.offset ? MIN(length, stream.offset - offset) : 0U;
+}
+
+void target_xml_release(target_s *const target)
+{
+#if CONFIG_BMDA == 1
+	free(target->description_xml);
+	target->description_xml = NULL;
+#endif
+	free(target->mem_map_xml);
+	target->mem_map_xml = NULL;
+}
+
 void target_print_progress(platform_timeout_s *const timeout)
 {
 	if (platform_timeout_is_expired(timeout)) {
@@ -285,6 +546,11 @@ void target_print_progress(platform_timeout_s *const timeout)
 void target_detach(target_s *target)
 {
 	DEBUG_TARGET("Detaching from target\n");
+	if (target->flash_mode_held)
+		target_flash_session_end(target);
+	/* Leave the program in Flash as it was found */
+	target_flash_breakpoints_restore(target);
+	target_mem_cache_stop(target);
 	if (target->detach)
 		target->detach(target);
 	platform_target_clk_output_enable(false);
@@ -296,15 +562,191 @@ void target_detach(target_s *target)
 
 bool target_check_error(target_s *target)
 {
-	if (target && target->check_error)
-		return target->check_error(target);
+	if (!target || !target->check_error)
+		return false;
+	/* In a deferred batch, skip the full check unless the link says something went wrong or it's been a while */
+	if (target->error_defer_depth && target->check_fault && !target->check_fault(target) &&
+		platform_time_ms() - target->error_checked_ms < TARGET_ERROR_DEFER_MS)
+		return false;
+	target->error_checked_ms = platform_time_ms();
+	return target->check_error(target);
+}
+
+void target_error_defer_begin(target_s *const target)
+{
+	if (!target->error_defer_depth++)
+		target->error_checked_ms = platform_time_ms();
+}
+
+bool target_error_defer_end(target_s *const target)
+{
+	--target->error_defer_depth;
+	/*
+	 * The one full check the batch needed. Errors are sticky until checked for, so this picks up any that a
+	 * skipped check would have seen - those a check did see were reported to whatever made that check
+	 */
+	target->error_checked_ms = platform_time_ms();
+	const bool error = target->check_error && target->check_error(target);
+	if (error)
+		DEBUG_WARN("Error in a batch of target operations with deferred checking\n");
+	return error;
+}
+
+/*
+ * Halt-scoped memory read cache
+ *
+ * While the target is halted GDB tends to read the same stack frames, vector table and globals over and over.
+ * Reads that fall entirely within a RAM or Flash region of the memory map are served from a small cache of
+ * TARGET_MEM_CACHE_PAGE_SIZE pages, filled a page at a time. Peripheral space is never part of the memory map
+ * and so is always read from the target. The cache is started when the target is seen to halt, flushed on any
+ * write and by the Flash routines, and stopped again as soon as the target is resumed, reset or detached.
+ */
+void target_mem_cache_flush(target_s *const target)
+{
+	for (size_t idx = 0; idx < target->mem_cache_pages; ++idx)
+		target->mem_cache[idx].valid = false;
+}
+
+static void target_mem_cache_start(target_s *const target)
+{
+	const size_t pages = target_mem_cache_size / TARGET_MEM_CACHE_PAGE_SIZE;
+	/* (Re)allocate the cache if its configured size has changed since it was last used */
+	if (pages != target->mem_cache_pages) {
+		free(target->mem_cache);
+		free(target->mem_cache_data);
+		target->mem_cache = NULL;
+		target->mem_cache_data = NULL;
+		target->mem_cache_pages = 0;
+		target->mem_cache_next = 0;
+		if (!pages)
+			return;
+		target->mem_cache = calloc(pages, sizeof(*target->mem_cache));
+		target->mem_cache_data = malloc(pages * TARGET_MEM_CACHE_PAGE_SIZE);
+		if (!target->mem_cache || !target->mem_cache_data) { /* calloc failed: heap exhaustion */
+			DEBUG_ERROR("calloc: failed in %s\n", __func__);
+			free(target->mem_cache);
+			free(target->mem_cache_data);
+			target->mem_cache = NULL;
+			target->mem_cache_data = NULL;
+			return;
+		}
+		for (size_t idx = 0; idx < pages; ++idx)
+			target->mem_cache[idx].data = target->mem_cache_data + (idx * TARGET_MEM_CACHE_PAGE_SIZE);
+		target->mem_cache_pages = pages;
+	}
+	target_mem_cache_flush(target);
+	target->mem_cache_seq_end = 0U;
+	target->mem_cache_seq_count = 0U;
+	target->mem_cache_active = target->mem_cache_pages != 0U;
+}
+
+static void target_mem_cache_stop(target_s *const target)
+{
+	target_mem_cache_flush(target);
+	target->mem_cache_active = false;
+}
+
+/* Check the whole of a (page aligned) range sits inside a single run of cacheable memory */
+static bool target_mem_cacheable(target_s *const target, const target_addr64_t start, const target_addr64_t end)
+{
+	if (end > UINT64_C(1) << 32U)
+		return false;
+	target_addr64_t run_end = 0U;
+	const uint8_t flags = target_mem_policy(target, (target_addr32_t)start, &run_end);
+	return (flags & TARGET_MEM_CACHEABLE) && end <= run_end;
+}
+
+/* How many pages to read in one go on a miss at addr, more than one only when GDB is walking through memory */
+static size_t target_mem_cache_prefetch_pages(target_s *const target, const target_addr64_t addr)
+{
+	if (target->mem_cache_seq_count < TARGET_MEM_PREFETCH_THRESHOLD)
+		return 1U;
+	target_addr64_t run_end = 0U;
+	target_mem_policy(target, (target_addr32_t)addr, &run_end);
+	const size_t pages = MIN(TARGET_MEM_PREFETCH_SIZE, run_end - addr) / TARGET_MEM_CACHE_PAGE_SIZE;
+	return MAX(MIN(pages, target->mem_cache_pages / 2U), 1U);
+}
+
+static const target_mem_cache_page_s *target_mem_cache_fetch(target_s *const target, const target_addr64_t addr)
+{
+	for (size_t idx = 0; idx < target->mem_cache_pages; ++idx) {
+		const target_mem_cache_page_s *const page = &target->mem_cache[idx];
+		if (page->valid && page->addr == addr)
+			return page;
+	}
+
+	/*
+	 * Not cached, so evict the next pages in round-robin order and read into them. When reading ahead, the
+	 * pages have to be adjacent in the data block, so go back around to the start rather than wrap part way
+	 */
+	size_t count = target_mem_cache_prefetch_pages(target, addr);
+	if (target->mem_cache_next + count > target->mem_cache_pages)
+		target->mem_cache_next = 0U;
+	const size_t first = target->mem_cache_next;
+	const target_addr64_t end = addr + (count * TARGET_MEM_CACHE_PAGE_SIZE);
+	/* Drop any pages further on that are already cached, so the run doesn't leave duplicates of them behind */
+	for (size_t idx = 0; idx < target->mem_cache_pages; ++idx) {
+		target_mem_cache_page_s *const page = &target->mem_cache[idx];
+		if (page->addr >= addr && page->addr < end)
+			page->valid = false;
+	}
+	target->mem_read(target, target->mem_cache[first].data, addr, count * TARGET_MEM_CACHE_PAGE_SIZE);
+	/* If reading ahead ran into trouble, fall back to just the page that was actually asked for */
+	if (target_check_error(target) && count > 1U) {
+		count = 1U;
+		target->mem_read(target, target->mem_cache[first].data, addr, TARGET_MEM_CACHE_PAGE_SIZE);
+	}
+	const bool valid = !target_check_error(target);
+	for (size_t idx = 0; idx < count; ++idx) {
+		target_mem_cache_page_s *const page = &target->mem_cache[first + idx];
+		page->addr = addr + (idx * TARGET_MEM_CACHE_PAGE_SIZE);
+		page->valid = valid;
+	}
+	target->mem_cache_next = (first + count) % target->mem_cache_pages;
+	return valid ? &target->mem_cache[first] : NULL;
+}
+
+static bool target_mem_cache_read(target_s *const target, void *const dest, const target_addr64_t src, const size_t len)
+{
+	const target_addr64_t page_mask = ~(target_addr64_t)(TARGET_MEM_CACHE_PAGE_SIZE - 1U);
+	const target_addr64_t start = src & page_mask;
+	const target_addr64_t end = src + len;
+
+	/* Anything touching memory outside of RAM and Flash gets read straight from the target */
+	if (!target_mem_cacheable(target, start, (end + TARGET_MEM_CACHE_PAGE_SIZE - 1U) & page_mask)) {
+		target->mem_read(target, dest, src, len);
+		return target_check_error(target);
+	}
+
+	/* Keep count of runs of reads that each pick up where the last one left off, as when dumping an array */
+	if (src == target->mem_cache_seq_end) {
+		if (target->mem_cache_seq_count < TARGET_MEM_PREFETCH_THRESHOLD)
+			++target->mem_cache_seq_count;
+	} else
+		target->mem_cache_seq_count = 0U;
+	target->mem_cache_seq_end = end;
+
+	uint8_t *data = (uint8_t *)dest;
+	for (target_addr64_t page_addr = start; page_addr < end; page_addr += TARGET_MEM_CACHE_PAGE_SIZE) {
+		const target_mem_cache_page_s *const page = target_mem_cache_fetch(target, page_addr);
+		if (!page)
+			return true;
+		const target_addr64_t begin = MAX(page_addr, src);
+		const size_t amount = MIN(page_addr + TARGET_MEM_CACHE_PAGE_SIZE, end) - begin;
+		memcpy(data, page->data + (begin - page_addr), amount);
+		data += amount;
+	}
 	return false;
 }
 
 /* Memory access functions */
 bool target_mem32_read(target_s *const target, void *const dest, const target_addr_t src, const size_t len)
 {
-	return target_mem64_read(target, dest, src, len);
+	const uint32_t start = stats_timestamp();
+	const bool result = target_mem64_read(target, dest, src, len);
+	stats_record(STATS_MEM_READ, start);
+	stats_event(STATS_MEM_READ_BYTES, len);
+	return result;
 }
 
 bool target_mem64_read(target_s *const target, void *const dest, const target_addr64_t src, const size_t len)
@@ -317,10 +759,20 @@ bool target_mem64_read(target_s *const target, void *const dest, const target_ad
 		memcpy(dest, target->tc->semihosting_buffer_ptr, amount);
 		return false;
 	}
-	/* Otherwise if the target defines a memory read function, call that instead and check for errors */
-	if (target->mem_read)
-		target->mem_read(target, dest, src, len);
-	return target_check_error(target);
+	bool result;
+	/* Otherwise if the target is halted with the read cache running, try to serve the read from that */
+	if (target->mem_cache_active && target->mem_read && len)
+		result = target_mem_cache_read(target, dest, src, len);
+	else {
+		/* Otherwise if the target defines a memory read function, call that instead and check for errors */
+		if (target->mem_read)
+			target->mem_read(target, dest, src, len);
+		result = target_check_error(target);
+	}
+	/* GDB must only ever see the program's own instructions where there are Flash breakpoints */
+	if (target->flash_breakpoints && !result)
+		target_flash_breakpoints_mask(target, dest, src, len);
+	return result;
 }
 
 bool target_mem32_write(target_s *const target, const target_addr_t dest, const void *const src, const size_t len)
@@ -338,12 +790,53 @@ bool target_mem64_write(target_s *const target, const target_addr64_t dest, cons
 		memcpy(target->tc->semihosting_buffer_ptr, src, amount);
 		return false;
 	}
+	/* Any write may change what's behind the cached pages, so drop them all */
+	target_mem_cache_flush(target);
 	/* Otherwise if the target defines a memory write function, call that instead and check for errors */
 	if (target->mem_write)
 		target->mem_write(target, dest, src, len);
 	return target_check_error(target);
 }
 
+/* Write the pattern to [begin, end) a buffer at a time, keeping its byte lanes lined up with the addresses */
+static bool target_mem32_fill_write(
+	target_s *const target, const uint8_t *const pattern, target_addr_t begin, const target_addr_t end)
+{
+	while (begin < end) {
+		const size_t amount = MIN(end - begin, TARGET_FILL_CHUNK_SIZE - (begin & 3U));
+		if (target_mem32_write(target, begin, pattern + (begin & 3U), amount))
+			return false;
+		begin += amount;
+	}
+	return true;
+}
+
+bool target_mem32_fill(target_s *const target, const target_addr_t dest, const uint32_t value, const size_t len)
+{
+	const target_addr_t end = dest + len;
+	const target_addr_t body = MIN(ALIGN(dest, 4U), end);
+	const target_addr_t body_end = MAX(end & ~3U, body);
+	target_mem_cache_flush(target);
+
+	/* Let the target fill as much of the word aligned middle as it can itself, so none of that crosses the link */
+	target_addr_t filled = body;
+	if (target->mem_fill) {
+		while (filled < body_end) {
+			const size_t amount = MIN(body_end - filled, TARGET_FILL_STUB_CHUNK_SIZE);
+			if (!target->mem_fill(target, filled, value, amount))
+				break;
+			filled += amount;
+		}
+	}
+
+	/* Then write whatever's left, the unaligned ends and anything the target couldn't do, from a pattern buffer */
+	uint8_t pattern[TARGET_FILL_CHUNK_SIZE];
+	for (size_t offset = 0; offset < sizeof(pattern); offset += 4U)
+		write_le4(pattern, offset, value);
+	return target_mem32_fill_write(target, pattern, dest, body) &&
+		target_mem32_fill_write(target, pattern, filled, end);
+}
+
 /* Returns true if the target needs halting to access memory on it */
 bool target_mem_access_needs_halt(target_s *target)
 {
@@ -365,6 +858,14 @@ size_t target_reg_write(target_s *target, uint32_t reg, const void *data, size_t
 	return 0;
 }
 
+bool target_pc_read(target_s *const target, target_addr_t *const pc)
+{
+	if (!target->pc_read)
+		return false;
+	*pc = target->pc_read(target);
+	return true;
+}
+
 void target_regs_read(target_s *target, void *data)
 {
 	if (target->regs_read)
@@ -375,6 +876,14 @@ void target_regs_read(target_s *target, void *data)
 	}
 }
 
+size_t target_regs_read_core(target_s *const target, void *const data)
+{
+	if (target->regs_read_core)
+		return target->regs_read_core(target, data);
+	target_regs_read(target, data);
+	return target->regs_size;
+}
+
 void target_regs_write(target_s *target, const void *data)
 {
 	if (target->regs_write)
@@ -389,6 +898,11 @@ void target_regs_write(target_s *target, const void *data)
 void target_reset(target_s *target)
 {
 	DEBUG_TARGET("Resetting target\n");
+	/* Only a session that's actually in Flash mode, as entering Flash mode can itself reset the target */
+	if (target->flash_mode_held && target->flash_mode)
+		target_flash_session_end(target);
+	target_flash_breakpoints_commit(target);
+	target_mem_cache_stop(target);
 	if (target->reset)
 		target->reset(target);
 }
@@ -432,6 +946,9 @@ target_halt_reason_e target_halt_poll(target_s *target, target_addr64_t *watch)
 		if (reason != TARGET_HALT_RUNNING)
 			DEBUG_TARGET("Target halted: %s\n", target_halt_reason_str(reason));
 #endif
+		/* On an error the target list has been freed, so only start the cache on a real halt */
+		if (reason != TARGET_HALT_RUNNING && reason != TARGET_HALT_ERROR && !target->mem_cache_active)
+			target_mem_cache_start(target);
 		return reason;
 	}
 	/* XXX: Is this actually the desired fallback behaviour? */
@@ -441,6 +958,11 @@ target_halt_reason_e target_halt_poll(target_s *target, target_addr64_t *watch)
 void target_halt_resume(target_s *target, bool step)
 {
 	DEBUG_TARGET("%s target\n", step ? "Single stepping" : "Resuming");
+	if (target->flash_mode_held)
+		target_flash_session_end(target);
+	/* Get the Flash breakpoints the way GDB now wants them before the target gets to run into them */
+	target_flash_breakpoints_commit(target);
+	target_mem_cache_stop(target);
 	if (target->halt_resume)
 		target->halt_resume(target, step);
 }
@@ -553,6 +1075,24 @@ static bool target_cmd_range_erase(target_s *const target, const int argc, const
 	return target_flash_erase(target, addr, length);
 }
 
+static bool target_cmd_fill(target_s *const target, const int argc, const char **const argv)
+{
+	if (argc < 3) {
+		gdb_out("usage: monitor fill <address> <length> [value]\n");
+		gdb_out("\t<value> is a 32-bit value, repeated with its byte lanes following the address, default 0\n");
+		return true;
+	}
+	const uint32_t addr = strtoul(argv[1], NULL, 0);
+	const uint32_t length = strtoul(argv[2], NULL, 0);
+	const uint32_t value = argc > 3 ? strtoul(argv[3], NULL, 0) : 0U;
+
+	if (!target_mem32_fill(target, addr, value, length)) {
+		gdb_outf("Failed to fill 0x%08" PRIx32 "+%" PRIu32 "\n", addr, length);
+		return false;
+	}
+	return true;
+}
+
 static bool target_cmd_redirect_output(target_s *target, int argc, const char **argv)
 {
 	if (argc == 1) {
@@ -568,18 +1108,6 @@ size_t target_regs_size(target_s *target)
 	return target->regs_size;
 }
 
-/*
- * Get an XML description of the target's registers. Called during the attach phase when
- * GDB supplies request `qXfer:features:read:target.xml:`. The pointer returned by this call
- * must be passed to `free()` on conclusion of its use.
- */
-const char *target_regs_description(target_s *target)
-{
-	if (target->regs_description)
-		return target->regs_description(target);
-	return NULL;
-}
-
 uint32_t target_mem32_read32(target_s *target, target_addr32_t addr)
 {
 	uint32_t result = 0;
@@ -587,6 +1115,33 @@ uint32_t target_mem32_read32(target_s *target, target_addr32_t addr)
 	return result;
 }
 
+bool target_mem32_poll32(target_s *const target, const target_addr32_t addr, const uint32_t mask, const uint32_t value,
+	const uint32_t timeout_ms, platform_timeout_s *const print_progress, uint32_t *const status)
+{
+	platform_timeout_s timeout;
+	platform_timeout_set(&timeout, timeout_ms);
+	uint32_t result = 0U;
+	bool matched = false;
+	while (true) {
+		/*
+		 * If the target can offload the poll, hand it slices of the wait so we still get to check
+		 * for comms failures and report progress in between
+		 */
+		if (target->mem_poll32)
+			result = target->mem_poll32(target, addr, mask, value, TARGET_MEM_POLL_SLICE_MS);
+		else
+			result = target_mem32_read32(target, addr);
+		matched = (result & mask) == value;
+		if (matched || target_check_error(target) || (timeout_ms && platform_timeout_is_expired(&timeout)))
+			break;
+		if (print_progress)
+			target_print_progress(print_progress);
+	}
+	if (status)
+		*status = result;
+	return matched;
+}
+
 bool target_mem32_write32(target_s *target, target_addr32_t addr, uint32_t value)
 {
 	return target_mem32_write(target, addr, &value, sizeof(value));
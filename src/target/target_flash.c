@@ -37,8 +37,154 @@
 
 #include "general.h"
 #include "target_internal.h"
+#include "crc32.h"
+#include "stats.h"
+
+/* Whether erase blocks that already hold the data being written should be skipped */
+bool flash_differential;
+bool flash_blank_check;
+bool flash_session_persist;
 
 static bool flash_done(target_flash_s *flash);
+static bool flash_diff_defer_erase(target_flash_s *flash, target_addr_t block_addr);
+static void flash_breakpoints_forget(target_s *target, const target_flash_range_s *ranges, size_t count);
+
+/*
+ * Each Flash operation, from the first erase or write to target_flash_complete(), is broken down into where its
+ * time went. The phases are measured in the stats_timestamp() time base, and the time between calls into the
+ * Flash API is put down to the host - GDB or BMDA getting the next lot of data over. Once the operation is done,
+ * the phases are scaled to the elapsed wall clock time, so the report comes out in milliseconds whatever that
+ * time base is. When the probe runs the Flash drivers itself, all the time it spends ends up under "other".
+ */
+typedef enum flash_phase {
+	FLASH_PHASE_ERASE,
+	FLASH_PHASE_PROGRAM,
+	FLASH_PHASE_WAIT, /* Waiting out erases and writes left running by the driver */
+	FLASH_PHASE_HOST,
+	FLASH_PHASE_BUSY, /* All the time spent inside the Flash API, the erase, program and wait phases included */
+	FLASH_PHASE_COUNT,
+} flash_phase_e;
+
+typedef struct flash_report {
+	bool active;
+	bool valid;
+	uint32_t start_ms;
+	uint32_t elapsed_ms;
+	/* When the current call into the Flash API started, or the last one finished */
+	uint32_t mark;
+	uint64_t time[FLASH_PHASE_COUNT];
+	size_t written;
+	size_t skipped;
+} flash_report_s;
+
+static flash_report_s flash_report;
+
+static void flash_report_enter(void)
+{
+	const uint32_t now = stats_timestamp();
+	if (!flash_report.active) {
+		memset(&flash_report, 0, sizeof(flash_report));
+		flash_report.active = true;
+		flash_report.start_ms = platform_time_ms();
+	} else {
+		flash_report.time[FLASH_PHASE_HOST] += now - flash_report.mark;
+		stats_record(STATS_FLASH_HOST, flash_report.mark);
+	}
+	flash_report.mark = now;
+}
+
+static void flash_report_exit(void)
+{
+	const uint32_t now = stats_timestamp();
+	flash_report.time[FLASH_PHASE_BUSY] += now - flash_report.mark;
+	flash_report.mark = now;
+}
+
+/* Account the time since start to both a phase of the current operation and its stats counter */
+static void flash_report_record(const flash_phase_e phase, const stats_id_e id, const uint32_t start)
+{
+	flash_report.time[phase] += stats_timestamp() - start;
+	stats_record(id, start);
+}
+
+static void flash_report_bytes(const size_t written, const size_t skipped)
+{
+	flash_report.written += written;
+	flash_report.skipped += skipped;
+	stats_event(STATS_FLASH_BYTES_WRITTEN, (uint32_t)written);
+	stats_event(STATS_FLASH_BYTES_SKIPPED, (uint32_t)skipped);
+}
+
+/* Scale a phase's time to the wall clock time of the whole operation */
+static uint32_t flash_report_ms(const uint64_t time)
+{
+	const uint64_t total = flash_report.time[FLASH_PHASE_BUSY] + flash_report.time[FLASH_PHASE_HOST];
+	return total ? (uint32_t)((time * flash_report.elapsed_ms) / total) : 0U;
+}
+
+bool target_flash_report(char *const buffer, const size_t size)
+{
+	if (!flash_report.valid)
+		return false;
+	const uint64_t *const time = flash_report.time;
+	const uint64_t accounted = time[FLASH_PHASE_ERASE] + time[FLASH_PHASE_PROGRAM] + time[FLASH_PHASE_WAIT];
+	const uint64_t other = time[FLASH_PHASE_BUSY] > accounted ? time[FLASH_PHASE_BUSY] - accounted : 0U;
+	const uint32_t ms = MAX(flash_report.elapsed_ms, 1U);
+	snprintf(buffer, size,
+		"flash written=%zu skipped=%zu ms=%" PRIu32 " rate=%" PRIu32 " erase=%" PRIu32 " program=%" PRIu32
+		" wait=%" PRIu32 " host=%" PRIu32 " other=%" PRIu32 "\n",
+		flash_report.written, flash_report.skipped, flash_report.elapsed_ms,
+		(uint32_t)(((uint64_t)(flash_report.written + flash_report.skipped) * 1000U) / ms),
+		flash_report_ms(time[FLASH_PHASE_ERASE]), flash_report_ms(time[FLASH_PHASE_PROGRAM]),
+		flash_report_ms(time[FLASH_PHASE_WAIT]), flash_report_ms(time[FLASH_PHASE_HOST]), flash_report_ms(other));
+	return true;
+}
+
+/*
+ * The write and differential staging buffers are each drawn from a single pool buffer that grows to the
+ * largest size asked for and is then kept, rather than being allocated and freed around every operation.
+ * Only one Flash can hold a pool's buffer at a time - anything else wanting one gets its own from the heap.
+ */
+typedef struct flash_pool {
+	uint8_t *buffer;
+	size_t size;
+	const target_flash_s *owner;
+} flash_pool_s;
+
+static flash_pool_s flash_write_pool;
+static flash_pool_s flash_diff_pool;
+
+static uint8_t *flash_pool_acquire(flash_pool_s *const pool, const target_flash_s *const flash, const size_t size)
+{
+	if (pool->owner && pool->owner != flash)
+		return malloc(size);
+	if (pool->size < size) {
+		/* The old contents don't matter, so don't pay for realloc() copying them */
+		free(pool->buffer);
+		pool->buffer = malloc(size);
+		pool->size = pool->buffer ? size : 0U;
+		if (!pool->buffer)
+			return NULL;
+	}
+	pool->owner = flash;
+	return pool->buffer;
+}
+
+static void flash_pool_release(flash_pool_s *const pool, uint8_t *const buffer)
+{
+	if (buffer && buffer == pool->buffer)
+		pool->owner = NULL;
+	else
+		free(buffer);
+}
+
+void target_flash_buffers_release(target_flash_s *const flash)
+{
+	flash_pool_release(&flash_write_pool, flash->buf);
+	flash->buf = NULL;
+	flash_pool_release(&flash_diff_pool, flash->diff_buf);
+	flash->diff_buf = NULL;
+}
 
 target_flash_s *target_flash_for_addr(target_s *target, uint32_t addr)
 {
@@ -51,6 +197,8 @@ target_flash_s *target_flash_for_addr(target_s *target, uint32_t addr)
 
 static bool target_enter_flash_mode(target_s *target)
 {
+	/* Flash operations change memory behind the read cache's back */
+	target_mem_cache_flush(target);
 	if (target->flash_mode)
 		return true;
 
@@ -62,16 +210,23 @@ static bool target_enter_flash_mode(target_s *target)
 		/* This saves us if we're interrupted in IRQ context */
 		target_reset(target);
 
-	if (result == true)
+	if (result == true) {
 		target->flash_mode = true;
+		/* Failing to raise the clock only makes Flashing slower, so carry on regardless */
+		if (target->flash_clock_boost && !target->flash_clock_boost(target))
+			DEBUG_WARN("Could not raise the target clock for Flashing\n");
+	}
 	return result;
 }
 
 static bool target_exit_flash_mode(target_s *target)
 {
-	if (!target->flash_mode)
+	target_mem_cache_flush(target);
+	if (!target->flash_mode || target->flash_mode_held)
 		return true;
 
+	if (target->flash_clock_restore)
+		target->flash_clock_restore(target);
 	bool result = true;
 	if (target->exit_flash_mode)
 		result = target->exit_flash_mode(target);
@@ -80,6 +235,11 @@ static bool target_exit_flash_mode(target_s *target)
 		target_reset(target);
 
 	target->flash_mode = false;
+	/* Once out of Flash mode the program is free to write to the Flash, so forget what was known to be blank */
+	for (target_flash_s *flash = target->flash; flash; flash = flash->next) {
+		flash->blank_start = 0U;
+		flash->blank_end = 0U;
+	}
 	return result;
 }
 
@@ -98,8 +258,11 @@ static bool flash_prepare(target_flash_s *flash, flash_operation_e operation)
 	if (result) {
 		flash->operation = operation;
 		/* Prepare flash for operation, unless we failed to terminate the previous one */
-		if (flash->prepare)
+		if (flash->prepare) {
+			const uint32_t start = stats_timestamp();
 			result = flash->prepare(flash);
+			stats_record(STATS_FLASH_PREPARE, start);
+		}
 
 		/* If the preparation step failed, revert back to the post-done state */
 		if (!result)
@@ -109,87 +272,418 @@ static bool flash_prepare(target_flash_s *flash, flash_operation_e operation)
 	return result;
 }
 
+/* Wait for any write left in flight by a pipelining-capable Flash driver to complete */
+static bool flash_write_wait(target_flash_s *flash)
+{
+	if (!flash->write_pending)
+		return true;
+	flash->write_pending = false;
+	const uint32_t start = stats_timestamp();
+	const bool result = flash->write_wait(flash);
+	flash_report_record(FLASH_PHASE_WAIT, STATS_FLASH_WAIT, start);
+	return result;
+}
+
+/* Note a range of the Flash as having been erased, merging it into the blank range if it touches it */
+static void flash_blank_add(target_flash_s *const flash, const target_addr_t addr, const size_t len)
+{
+	const target_addr_t end = addr + len;
+	if (flash->blank_start < flash->blank_end && addr <= flash->blank_end && end >= flash->blank_start) {
+		flash->blank_start = MIN(flash->blank_start, addr);
+		flash->blank_end = MAX(flash->blank_end, end);
+	} else {
+		flash->blank_start = addr;
+		flash->blank_end = end;
+	}
+}
+
+/* Trim a range that's about to be programmed out of the blank range, losing what's above it if it's in the middle */
+static void flash_blank_remove(target_flash_s *const flash, const target_addr_t addr, const target_addr_t end)
+{
+	if (end <= flash->blank_start || addr >= flash->blank_end)
+		return;
+	if (addr <= flash->blank_start)
+		flash->blank_start = MIN(end, flash->blank_end);
+	else
+		flash->blank_end = addr;
+}
+
+/* Check whether a chunk about to be written is all the erased value and goes into Flash known to still be blank */
+static bool flash_chunk_blank(const target_flash_s *const flash, const target_addr_t addr, const uint8_t *const data)
+{
+	if (addr < flash->blank_start || addr + flash->writesize > flash->blank_end)
+		return false;
+	/* Compare a word at a time, with the chunks being whole words in all but the most unusual of parts */
+	const uint32_t erased_word = flash->erased * 0x01010101U;
+	size_t offset = 0U;
+	for (; offset + 4U <= flash->writesize; offset += 4U) {
+		uint32_t word;
+		memcpy(&word, data + offset, sizeof(word));
+		if (word != erased_word)
+			return false;
+	}
+	for (; offset < flash->writesize; ++offset) {
+		if (data[offset] != flash->erased)
+			return false;
+	}
+	return true;
+}
+
+/* Wait for any erase left running by an erase-overlapping-capable Flash driver to complete */
+static bool flash_erase_wait(target_flash_s *flash)
+{
+	if (!flash->erase_pending)
+		return true;
+	flash->erase_pending = false;
+	const uint32_t start = stats_timestamp();
+	const bool result = flash->erase_wait(flash);
+	flash_report_record(FLASH_PHASE_WAIT, STATS_FLASH_WAIT, start);
+	/* If the erase didn't work out, there's no telling what's blank any more */
+	if (!result) {
+		flash->blank_start = 0U;
+		flash->blank_end = 0U;
+	}
+	return result;
+}
+
+/* Check whether a range already reads as erased, see the blank check notes in target_internal.h */
+static bool flash_range_blank(target_flash_s *const flash, const target_addr_t addr, const size_t len)
+{
+	bool blank = false;
+	if (flash->blank_check && flash->blank_check(flash, addr, len, &blank))
+		return blank;
+	uint32_t crc = 0;
+	return bmd_crc32(flash->t, &crc, addr, len) && crc == bmd_crc32_fill(flash->erased, len);
+}
+
+/* Erase a block (or span) once everything before it is finished, leaving it running if the driver allows */
+static bool flash_erase_block(target_flash_s *const flash, const target_addr_t addr, const size_t len)
+{
+	if (!flash_write_wait(flash) || !flash_erase_wait(flash))
+		return false;
+	if (flash_blank_check && flash_range_blank(flash, addr, len)) {
+		DEBUG_TARGET("%s: %08" PRIx32 "+%zu already blank, skipping\n", __func__, addr, len);
+		flash_blank_add(flash, addr, len);
+		return true;
+	}
+	const uint32_t start = stats_timestamp();
+	/* Status checks within the erase only need doing properly once it's done */
+	target_error_defer_begin(flash->t);
+	bool result = flash->erase(flash, addr, len);
+	result &= !target_error_defer_end(flash->t);
+	flash_report_record(FLASH_PHASE_ERASE, STATS_FLASH_ERASE, start);
+	if (result)
+		flash_blank_add(flash, addr, len);
+	/* Only successfully started erases are left pending */
+	flash->erase_pending = result && flash->erase_wait;
+	return result;
+}
+
 static bool flash_done(target_flash_s *flash)
 {
 	/* Check if we're already done */
 	if (flash->operation == FLASH_OPERATION_NONE)
 		return true;
 
-	bool result = true;
+	/* Make sure any in-flight write or erase has completed before terminating the operation */
+	bool result = flash_write_wait(flash);
+	result &= flash_erase_wait(flash);
 	/* Terminate flash operation */
-	if (flash->done)
-		result = flash->done(flash);
-
-	/* Free the operation buffer */
-	if (flash->buf) {
-		free(flash->buf);
-		flash->buf = NULL;
+	if (flash->done) {
+		const uint32_t start = stats_timestamp();
+		result &= flash->done(flash);
+		stats_record(STATS_FLASH_DONE, start);
 	}
 
+	/* Hand the operation buffer back */
+	flash_pool_release(&flash_write_pool, flash->buf);
+	flash->buf = NULL;
+
 	/* Mark the Flash as idle again */
 	flash->operation = FLASH_OPERATION_NONE;
 	return result;
 }
 
-bool target_flash_erase(target_s *target, target_addr_t addr, size_t len)
+/* How much erase() can be asked to do in one call, see the erase planner notes in target_internal.h */
+static size_t flash_erase_span(const target_flash_s *const flash)
 {
-	if (!target_enter_flash_mode(target))
-		return false;
+	return flash->erase_span > flash->blocksize ? flash->erase_span : flash->blocksize;
+}
 
-	target_flash_s *active_flash = target_flash_for_addr(target, addr);
-	if (!active_flash)
-		return false;
+/* Work out how large the next erase() call for [addr, end) would be, using the span where it fits */
+static size_t flash_erase_step(const target_flash_s *const flash, const target_addr_t addr, const target_addr_t end)
+{
+	const size_t span = flash_erase_span(flash);
+	if (span != flash->blocksize && (addr - flash->start) % span == 0U && end - addr >= span)
+		return span;
+	return flash->blocksize;
+}
 
-	bool result = true; /* Catch false returns with &= */
-	while (len) {
-		target_flash_s *flash = target_flash_for_addr(target, addr);
-		if (!flash) {
-			DEBUG_ERROR("Requested address is outside the valid range 0x%06" PRIx32 "\n", addr);
+/* The cost of erasing [start, end) a block (or span) at a time, counted in erase() calls */
+static size_t flash_erase_run_cost(
+	const target_flash_s *const flash, const target_addr_t start, const target_addr_t end)
+{
+	size_t cost = 0U;
+	for (target_addr_t addr = start; addr < end; addr += flash_erase_step(flash, addr, end))
+		++cost;
+	return cost;
+}
+
+static size_t flash_mass_erase_cost(const target_flash_s *const flash)
+{
+	/* With no hint from the driver, a mass erase is only worth it when everything would be erased anyway */
+	if (flash->mass_erase_cost)
+		return flash->mass_erase_cost;
+	return flash_erase_run_cost(flash, flash->start, flash->start + flash->length);
+}
+
+/*
+ * Find the next run of whole erase blocks in this Flash touched by the address sorted ranges, merging
+ * ranges that share or sit in neighbouring blocks. index keeps track of where to pick up from next time.
+ */
+static bool flash_next_erase_run(const target_flash_s *const flash, const target_flash_range_s *const ranges,
+	const size_t count, size_t *const index, target_addr_t *const run_start, target_addr_t *const run_end)
+{
+	const target_addr_t flash_end = flash->start + flash->length;
+	bool found = false;
+	for (; *index < count; ++*index) {
+		const target_flash_range_s *const range = &ranges[*index];
+		const target_addr_t range_end = range->addr + range->length;
+		/* Skip over any ranges that don't touch this Flash */
+		if (!range->length || range_end <= flash->start || range->addr >= flash_end)
+			continue;
+		/* Align the range out to the erase block size */
+		const target_addr_t start = MAX(range->addr, flash->start) & ~(flash->blocksize - 1U);
+		const target_addr_t end =
+			MIN((MIN(range_end, flash_end) + flash->blocksize - 1U) & ~(flash->blocksize - 1U), flash_end);
+		if (!found) {
+			*run_start = start;
+			*run_end = end;
+			found = true;
+		} else if (start <= *run_end)
+			*run_end = MAX(*run_end, end);
+		else
+			break;
+	}
+	return found;
+}
+
+static bool flash_erase_run(target_flash_s *const flash, const target_addr_t start, const target_addr_t end)
+{
+	for (target_addr_t addr = start; addr < end;) {
+		const size_t amount = flash_erase_step(flash, addr, end);
+		DEBUG_TARGET("%s: %08" PRIx32 "+%zu\n", __func__, addr, amount);
+		if (!flash_erase_block(flash, addr, amount)) {
+			DEBUG_ERROR("Erase failed at %" PRIx32 "\n", addr);
 			return false;
 		}
+		addr += amount;
+	}
+	return true;
+}
 
-		/* Terminate flash operations if we're not in the same target flash */
-		if (flash != active_flash) {
-			result &= flash_done(active_flash);
-			active_flash = flash;
+/* Erase the blocks put off by target_flash_erase_on_write() that start before end */
+static bool flash_lazy_erase(target_flash_s *const flash, const target_addr_t end)
+{
+	if (flash->lazy_erase_start >= flash->lazy_erase_end || end <= flash->lazy_erase_start)
+		return true;
+	/* Stay prepared for writing, so any data buffered is kept and the erase can overlap with receiving more */
+	bool result = flash_prepare(flash, FLASH_OPERATION_WRITE);
+	while (result && flash->lazy_erase_start < flash->lazy_erase_end && flash->lazy_erase_start < end) {
+		DEBUG_TARGET("%s: %08" PRIx32 "+%zu\n", __func__, flash->lazy_erase_start, flash->blocksize);
+		result = flash_erase_block(flash, flash->lazy_erase_start, flash->blocksize);
+		if (!result)
+			DEBUG_ERROR("Erase failed at %" PRIx32 "\n", flash->lazy_erase_start);
+		flash->lazy_erase_start += flash->blocksize;
+	}
+	/* Don't leave any of the range behind to be erased later over the top of data written since */
+	if (!result || flash->lazy_erase_start >= flash->lazy_erase_end) {
+		flash->lazy_erase_start = 0U;
+		flash->lazy_erase_end = 0U;
+	}
+	return result;
+}
+
+/* Erase everything the ranges touch in this Flash in whichever way costs the fewest erase operations */
+static bool flash_erase_planned(
+	target_flash_s *const flash, const target_flash_range_s *const ranges, const size_t count, const bool lazy)
+{
+	/* Finish off anything left over from a previous erase-on-write before starting on this one */
+	if (flash->lazy_erase_start < flash->lazy_erase_end) {
+		const bool result = flash_lazy_erase(flash, UINT32_MAX);
+		if (!flash_done(flash) || !result)
+			return false;
+	}
+
+	size_t index = 0U;
+	target_addr_t run_start = 0U;
+	target_addr_t run_end = 0U;
+	if (!flash_next_erase_run(flash, ranges, count, &index, &run_start, &run_end))
+		return true;
+
+	/* Cost up erasing just the touched blocks, noting the extent of them for differential mode */
+	const target_addr_t first_block = run_start;
+	target_addr_t last_block_end = run_end;
+	size_t cost = 0U;
+	size_t runs = 0U;
+	do {
+		cost += flash_erase_run_cost(flash, run_start, run_end);
+		last_block_end = run_end;
+		++runs;
+	} while (flash_next_erase_run(flash, ranges, count, &index, &run_start, &run_end));
+
+	bool result = true;
+	/*
+	 * In differential mode, put off erasing until we know what data is to go into each block. The deferral
+	 * only tracks one contiguous range per Flash, so this spans everything from the first to the last
+	 * touched block - any blocks in the gaps are compared against blank and only erased if they aren't.
+	 */
+	if (flash_differential) {
+		for (target_addr_t addr = first_block; result && addr < last_block_end; addr += flash->blocksize) {
+			result = flash_diff_defer_erase(flash, addr);
+			/* If the staging buffer couldn't be had, fall back to erasing normally */
+			if (!flash->diff_buf)
+				break;
 		}
+		if (!result || flash->diff_buf)
+			return flash_done(flash) && result;
+	}
+
+	const bool use_mass_erase = flash->mass_erase != NULL && cost >= flash_mass_erase_cost(flash);
+	/*
+	 * If the driver can leave erases running, a single run of blocks can instead be erased a block at a time
+	 * as the data for each arrives. Just the one range is tracked, so anything more involved is erased now
+	 */
+	if (lazy && flash->erase_wait && !use_mass_erase && runs == 1U) {
+		DEBUG_TARGET("%s: erasing %08" PRIx32 "+%zu as it is written\n", __func__, first_block,
+			(size_t)(last_block_end - first_block));
+		flash->lazy_erase_start = first_block;
+		flash->lazy_erase_end = last_block_end;
+		return true;
+	}
 
-		/* Align the start address to the erase block size */
-		const target_addr_t local_start_addr = addr & ~(flash->blocksize - 1U);
+	if (!flash_prepare(flash, use_mass_erase ? FLASH_OPERATION_MASS_ERASE : FLASH_OPERATION_ERASE))
+		return false;
 
-		/* Check if we can use mass erase, i.e. if the erase range covers the entire flash address space */
-		const bool can_use_mass_erase =
-			flash->mass_erase != NULL && local_start_addr == flash->start && addr + len >= flash->start + flash->length;
+	if (use_mass_erase) {
+		DEBUG_TARGET("%s: mass erasing %08" PRIx32 "+%zu rather than %zu erases\n", __func__, flash->start,
+			flash->length, cost);
+		const uint32_t start = stats_timestamp();
+		result = flash->mass_erase(flash, NULL);
+		flash_report_record(FLASH_PHASE_ERASE, STATS_FLASH_ERASE, start);
+		if (result)
+			flash_blank_add(flash, flash->start, flash->length);
+		else
+			DEBUG_ERROR("Mass erase failed at %" PRIx32 "\n", flash->start);
+	} else {
+		index = 0U;
+		while (result && flash_next_erase_run(flash, ranges, count, &index, &run_start, &run_end))
+			result = flash_erase_run(flash, run_start, run_end);
+	}
+	/* Issue flash done on the last operation */
+	result &= flash_done(flash);
+	return result;
+}
 
-		/* Calculate the address at the end of the erase block */
-		const target_addr_t local_end_addr =
-			can_use_mass_erase ? flash->start + flash->length : local_start_addr + flash->blocksize;
+#if CONFIG_BMDA == 1
+/* Hand the Flash operations over to the probe if it can run this target's drivers, returning whether it has them */
+static bool flash_offload_begin(target_s *const target)
+{
+	if (target->flash_offloaded)
+		return true;
+	if (!target->flash_offload || target->flash_mode)
+		return false;
+	target_mem_cache_flush(target);
+	if (!target->flash_offload->begin(target)) {
+		/* Don't keep asking a probe that can't do this target */
+		DEBUG_WARN("Probe cannot Flash this target itself, programming it from here\n");
+		target->flash_offload = NULL;
+		return false;
+	}
+	target->flash_offloaded = true;
+	/* Flash mode is really held by the probe, but this keeps everything else out of the way meanwhile */
+	target->flash_mode = true;
+	return true;
+}
 
-		if (!flash_prepare(flash, can_use_mass_erase ? FLASH_OPERATION_MASS_ERASE : FLASH_OPERATION_ERASE))
-			return false;
+static bool flash_offload_complete(target_s *const target, const bool release)
+{
+	bool result = target->flash_offload->complete(target, release);
+	if (!release)
+		return result;
+	target->flash_offloaded = false;
+	target_mem_cache_flush(target);
+	/*
+	 * The probe attached to the core its own way behind our back, so bring our view of it back in step. This is
+	 * done still in Flash mode so, as on leaving Flash mode normally, any Flash breakpoints wait for the resume
+	 */
+	if (target->reset)
+		target->reset(target);
+	target->flash_mode = false;
+	return result;
+}
+#endif
 
-		DEBUG_TARGET("%s: %08" PRIx32 "+%" PRIu32 "\n", __func__, local_start_addr, local_end_addr - local_start_addr);
-		/* Erase flash, either a single aligned block size or a full mass erase */
-		result &= can_use_mass_erase ? flash->mass_erase(flash, NULL) :
-									   flash->erase(flash, local_start_addr, flash->blocksize);
-		if (!result) {
-			DEBUG_ERROR("Erase failed at %" PRIx32 "\n", local_start_addr);
-			break;
-		}
+static bool flash_erase_ranges(
+	target_s *const target, const target_flash_range_s *const ranges, const size_t count, const bool lazy)
+{
+	/* Drop the breakpoints in the blocks about to be erased, before entering Flash mode tries committing them */
+	flash_breakpoints_forget(target, ranges, count);
+#if CONFIG_BMDA == 1
+	if (flash_offload_begin(target))
+		return target->flash_offload->erase(target, ranges, count, lazy);
+#endif
+	if (!target_enter_flash_mode(target))
+		return false;
 
-		/* Update the remaining length and address, taking into account the alignment */
-		len -= MIN(local_end_addr - addr, len);
-		addr = local_end_addr;
+	/* Check every part of every range is in some Flash before touching anything */
+	for (size_t idx = 0U; idx < count; ++idx) {
+		const target_addr_t end = ranges[idx].addr + ranges[idx].length;
+		for (target_addr_t addr = ranges[idx].addr; addr < end;) {
+			const target_flash_s *const flash = target_flash_for_addr(target, addr);
+			if (!flash) {
+				DEBUG_ERROR("Requested address is outside the valid range 0x%06" PRIx32 "\n", addr);
+				return false;
+			}
+			addr = flash->start + flash->length;
+		}
 	}
-	/* Issue flash done on last operation */
-	result &= flash_done(active_flash);
+
+	bool result = true;
+	for (target_flash_s *flash = target->flash; result && flash; flash = flash->next)
+		result = flash_erase_planned(flash, ranges, count, lazy);
+	return result;
+}
+
+bool target_flash_erase_ranges(target_s *const target, const target_flash_range_s *const ranges, const size_t count)
+{
+	flash_report_enter();
+	const bool result = flash_erase_ranges(target, ranges, count, false);
+	flash_report_exit();
+	return result;
+}
+
+bool target_flash_erase_on_write(target_s *const target, const target_flash_range_s *const ranges, const size_t count)
+{
+	flash_report_enter();
+	const bool result = flash_erase_ranges(target, ranges, count, true);
+	flash_report_exit();
 	return result;
 }
 
+bool target_flash_erase(target_s *const target, const target_addr_t addr, const size_t len)
+{
+	const target_flash_range_s range = {.addr = addr, .length = len};
+	/* Keep the old behaviour of refusing erases that don't start in Flash, even when empty */
+	if (!target_flash_for_addr(target, addr))
+		return false;
+	return target_flash_erase_ranges(target, &range, 1U);
+}
+
 static inline bool flash_manual_mass_erase(target_flash_s *const flash, platform_timeout_s *const print_progess)
 {
 	for (target_addr_t addr = flash->start; addr < flash->start + flash->length; addr += flash->blocksize) {
-		if (!flash->erase(flash, addr, flash->blocksize))
+		if (!flash_erase_block(flash, addr, flash->blocksize))
 			return false;
 		target_print_progress(print_progess);
 	}
@@ -199,6 +693,13 @@ static inline bool flash_manual_mass_erase(target_flash_s *const flash, platform
 /* Run specialized target mass erase if available, otherwise erase all flash' */
 bool target_flash_mass_erase(target_s *const target)
 {
+	/* Whatever breakpoints were patched in are about to be wiped out along with the rest of the program */
+	target_flash_breakpoints_free(target);
+#if CONFIG_BMDA == 1
+	/* Mass erases are left to us, the probe's session being ended first */
+	if (target->flash_offloaded && !flash_offload_complete(target, true))
+		return false;
+#endif
 	if (!target_enter_flash_mode(target))
 		return false;
 
@@ -233,6 +734,8 @@ bool target_flash_mass_erase(target_s *const target)
 
 			result = can_use_mass_erase ? flash->mass_erase(flash, &print_progess) :
 										  flash_manual_mass_erase(flash, &print_progess);
+			if (result && can_use_mass_erase)
+				flash_blank_add(flash, flash->start, flash->length);
 			result &= flash_done(flash); /* Don't overwrite previous result, AND with it instead */
 			if (!result) {
 				DEBUG_ERROR("Failed to mass erase flash 0x%08" PRIx32 "\n", flash->start);
@@ -248,7 +751,7 @@ bool target_flash_mass_erase(target_s *const target)
 bool flash_buffer_alloc(target_flash_s *flash)
 {
 	/* Allocate buffer */
-	flash->buf = malloc(flash->writebufsize);
+	flash->buf = flash_pool_acquire(&flash_write_pool, flash, flash->writebufsize);
 	if (!flash->buf) { /* malloc failed: heap exhaustion */
 		DEBUG_ERROR("malloc: failed in %s\n", __func__);
 		return false;
@@ -273,8 +776,36 @@ static bool flash_buffered_flush(target_flash_s *flash)
 		const uint8_t *src = flash->buf + (aligned_addr - flash->buf_addr_base);
 		const uint32_t length = flash->buf_addr_high - aligned_addr;
 
-		for (size_t offset = 0; offset < length; offset += flash->writesize)
-			result &= flash->write(flash, aligned_addr + offset, src + offset, flash->writesize);
+		/* The blocks being written to may still be erasing */
+		result &= flash_erase_wait(flash);
+		for (size_t offset = 0; offset < length; offset += flash->writesize) {
+			const target_addr_t chunk_addr = aligned_addr + offset;
+			/* Programming a chunk of nothing but the erased value into Flash that's still blank changes nothing */
+			if (flash_chunk_blank(flash, chunk_addr, src + offset)) {
+				DEBUG_TARGET("%s: %08" PRIx32 " blank, skipping\n", __func__, chunk_addr);
+				flash_report_bytes(0U, flash->writesize);
+				continue;
+			}
+			flash_blank_remove(flash, chunk_addr, chunk_addr + flash->writesize);
+			/*
+			 * If the driver supports pipelined writes, the previous chunk may still be programming,
+			 * so wait for it here - as late as possible - rather than at the end of the previous write.
+			 * Drivers that overlap writes wait for it themselves, later still
+			 */
+			if (!flash->write_overlaps)
+				result &= flash_write_wait(flash);
+			const uint32_t start = stats_timestamp();
+			/* Likewise, the chunk's accesses are checked for errors as a whole once it's been handed over */
+			target_error_defer_begin(flash->t);
+			bool write_result = flash->write(flash, chunk_addr, src + offset, flash->writesize);
+			write_result &= !target_error_defer_end(flash->t);
+			flash_report_record(FLASH_PHASE_PROGRAM, STATS_FLASH_WRITE, start);
+			if (write_result)
+				flash_report_bytes(flash->writesize, 0U);
+			/* Only successfully started writes are left pending */
+			flash->write_pending = write_result && flash->write_wait;
+			result &= write_result;
+		}
 
 		flash->buf_addr_base = UINT32_MAX;
 		flash->buf_addr_low = UINT32_MAX;
@@ -293,6 +824,8 @@ static bool flash_buffered_write(target_flash_s *flash, target_addr_t dest, cons
 		/* Check for base address change */
 		if (base_addr != flash->buf_addr_base) {
 			result &= flash_buffered_flush(flash);
+			/* Start erasing the blocks this buffer goes into, if that was put off until now */
+			result &= flash_lazy_erase(flash, base_addr + flash->writebufsize);
 
 			/* Setup buffer */
 			flash->buf_addr_base = base_addr;
@@ -316,8 +849,115 @@ static bool flash_buffered_write(target_flash_s *flash, target_addr_t dest, cons
 	return result;
 }
 
-bool target_flash_write(target_s *target, target_addr_t dest, const void *src, size_t len)
+/*
+ * Finish staging the first block in the deferred erase range. If the block on the target already matches
+ * what it would contain after being erased and programmed, both steps are skipped; otherwise it's erased
+ * and the staged data written. Either way, the deferred range then moves on to the next block.
+ */
+static bool flash_diff_commit_block(target_flash_s *const flash)
 {
+	const target_addr_t block_addr = flash->diff_erase_start;
+
+	uint32_t crc = 0;
+	bool result = bmd_crc32(flash->t, &crc, block_addr, flash->blocksize);
+	if (result && crc == bmd_crc32_buffer(flash->diff_buf, flash->blocksize)) {
+		DEBUG_TARGET("%s: %08" PRIx32 " unchanged, skipping\n", __func__, block_addr);
+		if (flash->diff_addr_low < flash->diff_addr_high)
+			flash_report_bytes(0U, flash->diff_addr_high - flash->diff_addr_low);
+	} else {
+		/* The block differs (or could not be read back), flush anything buffered and erase it */
+		result = flash_buffered_flush(flash) && flash_prepare(flash, FLASH_OPERATION_ERASE) &&
+			flash_erase_block(flash, block_addr, flash->blocksize);
+		result &= flash_done(flash);
+		/* Then program back just the part of the block that data was actually staged for */
+		if (result && flash->diff_addr_low < flash->diff_addr_high) {
+			result = flash_buffer_alloc(flash) &&
+				flash_buffered_write(flash, flash->diff_addr_low, flash->diff_buf + (flash->diff_addr_low - block_addr),
+					flash->diff_addr_high - flash->diff_addr_low) &&
+				flash_buffered_flush(flash);
+		}
+		if (!result)
+			DEBUG_ERROR("Differential flash failed at %" PRIx32 "\n", block_addr);
+	}
+
+	flash->diff_erase_start += flash->blocksize;
+	memset(flash->diff_buf, flash->erased, flash->blocksize);
+	flash->diff_addr_low = UINT32_MAX;
+	flash->diff_addr_high = 0;
+	return result;
+}
+
+/* Commit every block still in the deferred erase range and release the staging buffer */
+static bool flash_diff_complete(target_flash_s *const flash)
+{
+	bool result = true;
+	while (result && flash->diff_buf && flash->diff_erase_start < flash->diff_erase_end)
+		result = flash_diff_commit_block(flash);
+
+	flash_pool_release(&flash_diff_pool, flash->diff_buf);
+	flash->diff_buf = NULL;
+	flash->diff_erase_start = 0;
+	flash->diff_erase_end = 0;
+	return result;
+}
+
+/* Add an erase block to the deferred range, if that's not possible the staging buffer is left unallocated */
+static bool flash_diff_defer_erase(target_flash_s *const flash, const target_addr_t block_addr)
+{
+	/* Check if this block is already part of, or directly extends, the deferred range */
+	if (flash->diff_buf && block_addr >= flash->diff_erase_start && block_addr <= flash->diff_erase_end) {
+		flash->diff_erase_end = MAX(flash->diff_erase_end, block_addr + flash->blocksize);
+		return true;
+	}
+
+	/* Otherwise commit the old range (if any) and start a new one at this block */
+	const bool result = flash_diff_complete(flash);
+	flash->diff_buf = flash_pool_acquire(&flash_diff_pool, flash, flash->blocksize);
+	if (!flash->diff_buf) { /* malloc failed: heap exhaustion */
+		DEBUG_WARN("malloc: failed in %s, falling back to normal erase\n", __func__);
+		return result;
+	}
+	memset(flash->diff_buf, flash->erased, flash->blocksize);
+	flash->diff_erase_start = block_addr;
+	flash->diff_erase_end = block_addr + flash->blocksize;
+	flash->diff_addr_low = UINT32_MAX;
+	flash->diff_addr_high = 0;
+	return result;
+}
+
+/* Stage data that falls in the deferred erase range, committing blocks as the data moves past them */
+static bool flash_diff_write(target_flash_s *const flash, target_addr_t dest, const uint8_t *src, size_t len)
+{
+	bool result = true;
+	while (result && len) {
+		while (result && dest >= flash->diff_erase_start + flash->blocksize)
+			result = flash_diff_commit_block(flash);
+		if (!result)
+			break;
+
+		const size_t offset = dest - flash->diff_erase_start;
+		const size_t local_len = MIN(flash->blocksize - offset, len);
+		memcpy(flash->diff_buf + offset, src, local_len);
+
+		flash->diff_addr_low = MIN(flash->diff_addr_low, dest);
+		flash->diff_addr_high = MAX(flash->diff_addr_high, dest + local_len);
+
+		dest += local_len;
+		src += local_len;
+		len -= local_len;
+	}
+	return result;
+}
+
+static bool flash_write(target_s *target, target_addr_t dest, const void *src, size_t len)
+{
+#if CONFIG_BMDA == 1
+	if (flash_offload_begin(target)) {
+		/* What the probe then does with the data isn't known here, so it's all counted as written */
+		flash_report_bytes(len, 0U);
+		return target->flash_offload->write(target, dest, src, len);
+	}
+#endif
 	if (!target_enter_flash_mode(target))
 		return false;
 
@@ -346,6 +986,21 @@ bool target_flash_write(target_s *target, target_addr_t dest, const void *src, s
 			result &= flash_done(active_flash);
 			active_flash = flash;
 		}
+
+		/* If this is for a block with a deferred erase, stage it for differential flashing */
+		if (flash->diff_buf && dest >= flash->diff_erase_start && dest < flash->diff_erase_end) {
+			const target_addr_t local_length = MIN(len, flash->diff_erase_end - dest);
+			if (!result || !flash_diff_write(flash, dest, src, local_length)) {
+				DEBUG_ERROR("Write failed at %" PRIx32 "\n", dest);
+				return false;
+			}
+
+			dest += local_length;
+			src = (const uint8_t *)src + local_length;
+			len -= local_length;
+			continue;
+		}
+
 		if (!flash->buf)
 			result &= flash_buffer_alloc(flash);
 
@@ -369,17 +1024,295 @@ bool target_flash_write(target_s *target, target_addr_t dest, const void *src, s
 	return result;
 }
 
-bool target_flash_complete(target_s *target)
+bool target_flash_write(target_s *const target, const target_addr_t dest, const void *const src, const size_t len)
 {
-	if (!target || !target->flash_mode)
-		return false;
+	flash_report_enter();
+	const bool result = flash_write(target, dest, src, len);
+	flash_report_exit();
+	return result;
+}
+
+static bool flash_complete(target_s *const target)
+{
+#if CONFIG_BMDA == 1
+	/* A held session keeps the probe's session going too, ready for the next operation */
+	if (target->flash_offloaded)
+		return flash_offload_complete(target, !target->flash_mode_held);
+#endif
 
 	bool result = true; /* Catch false returns with &= */
 	for (target_flash_s *flash = target->flash; flash; flash = flash->next) {
+		result &= flash_diff_complete(flash);
 		result &= flash_buffered_flush(flash);
-		result &= flash_done(flash);
+		/* Erase any blocks left over from an erase-on-write that no data ended up being written to */
+		result &= flash_lazy_erase(flash, UINT32_MAX);
+		/* A held session leaves the Flash prepared (and so unlocked) for the next operation, just waiting it out */
+		if (target->flash_mode_held) {
+			result &= flash_write_wait(flash);
+			result &= flash_erase_wait(flash);
+		} else
+			result &= flash_done(flash);
 	}
 
 	target_exit_flash_mode(target);
 	return result;
 }
+
+bool target_flash_complete(target_s *const target)
+{
+	if (!target || !target->flash_mode)
+		return false;
+	flash_report_enter();
+	const bool result = flash_complete(target);
+	flash_report_exit();
+	flash_report.active = false;
+	flash_report.valid = true;
+	flash_report.elapsed_ms = platform_time_ms() - flash_report.start_ms;
+	return result;
+}
+
+void target_flash_session_begin(target_s *const target)
+{
+	target->flash_mode_held = true;
+}
+
+bool target_flash_session_end(target_s *const target)
+{
+	target->flash_mode_held = false;
+	/* Finish off anything still pending from the session, such as a bare erase, and leave Flash mode */
+	if (!target->flash_mode)
+		return true;
+	return target_flash_complete(target);
+}
+
+/*
+ * Flash breakpoints
+ *
+ * When a target runs out of hardware breakpoint comparators, breakpoints in Flash can still be had by patching
+ * a breakpoint instruction into the program. Flash can only be changed an erase block at a time, so each block
+ * with breakpoints in it keeps a copy of its original contents along with the breakpoints wanted in it and the
+ * ones actually programmed into it. Setting and clearing breakpoints only updates the wanted list. Just before
+ * the target is resumed, each block whose list no longer matches what's programmed is rebuilt from the copy and
+ * rewritten - once, however many of its breakpoints came and went in the meantime. As GDB removes and reinserts
+ * every breakpoint around each stop, most of the time the lists match and nothing needs rewriting at all.
+ *
+ * A program that rewrites its own Flash in a block with breakpoints in it will see those changes undone the
+ * next time the block is rewritten, as the copy of the block is only taken when its first breakpoint is set.
+ */
+#if CONFIG_BMDA == 1
+#define FLASH_BREAKPOINT_BLOCK_MAX 262144U
+#else
+#define FLASH_BREAKPOINT_BLOCK_MAX 2048U
+#endif
+#define FLASH_BREAKPOINTS_PER_BLOCK 8U
+
+/* The Thumb `BKPT #0` instruction as it's laid out in (little endian) memory */
+static const uint8_t flash_breakpoint_insn[2] = {0x00U, 0xbeU};
+
+struct target_flash_breakpoint_block {
+	target_flash_breakpoint_block_s *next;
+	target_flash_s *flash;
+	target_addr32_t addr;
+	uint8_t wanted_count;
+	uint8_t programmed_count;
+	target_addr32_t wanted[FLASH_BREAKPOINTS_PER_BLOCK];
+	target_addr32_t programmed[FLASH_BREAKPOINTS_PER_BLOCK];
+	uint8_t original[]; /* The block's contents with no breakpoints in it */
+};
+
+static target_flash_breakpoint_block_s *flash_breakpoint_block(target_s *const target, const target_addr_t addr)
+{
+	for (target_flash_breakpoint_block_s *block = target->flash_breakpoints; block; block = block->next) {
+		if (addr >= block->addr && addr < block->addr + block->flash->blocksize)
+			return block;
+	}
+	return NULL;
+}
+
+bool target_flash_breakpoint_set(target_s *const target, const target_addr_t addr)
+{
+	/* GDB inserts breakpoints just before resuming, which is where a held Flash session ends anyway */
+	if (target->flash_mode_held)
+		target_flash_session_end(target);
+	target_flash_s *const flash = target_flash_for_addr(target, addr);
+	/* The instruction is a halfword, and the whole of its erase block has to be held on to for rewriting */
+	if (!flash || (addr & 1U) || flash->blocksize > FLASH_BREAKPOINT_BLOCK_MAX || target->flash_mode)
+		return false;
+
+	target_flash_breakpoint_block_s *block = flash_breakpoint_block(target, addr);
+	if (!block) {
+		block = malloc(sizeof(*block) + flash->blocksize);
+		if (!block) { /* malloc failed: heap exhaustion */
+			DEBUG_ERROR("malloc: failed in %s\n", __func__);
+			return false;
+		}
+		block->flash = flash;
+		block->addr = addr & ~(flash->blocksize - 1U);
+		block->wanted_count = 0U;
+		block->programmed_count = 0U;
+		if (target_mem32_read(target, block->original, block->addr, flash->blocksize)) {
+			free(block);
+			return false;
+		}
+		block->next = target->flash_breakpoints;
+		target->flash_breakpoints = block;
+	}
+
+	if (block->wanted_count == FLASH_BREAKPOINTS_PER_BLOCK)
+		return false;
+	block->wanted[block->wanted_count++] = addr;
+	return true;
+}
+
+void target_flash_breakpoint_clear(target_s *const target, const target_addr_t addr)
+{
+	/* If GDB erased the block since, the breakpoint went with it */
+	target_flash_breakpoint_block_s *const block = flash_breakpoint_block(target, addr);
+	if (!block)
+		return;
+	for (uint8_t idx = 0U; idx < block->wanted_count; ++idx) {
+		if (block->wanted[idx] == addr) {
+			block->wanted[idx] = block->wanted[--block->wanted_count];
+			return;
+		}
+	}
+}
+
+static bool flash_breakpoint_programmed(const target_flash_breakpoint_block_s *const block, const target_addr_t addr)
+{
+	for (uint8_t idx = 0U; idx < block->programmed_count; ++idx) {
+		if (block->programmed[idx] == addr)
+			return true;
+	}
+	return false;
+}
+
+/* Check if the breakpoints wanted in the block are the ones already programmed into it, in any order */
+static bool flash_breakpoint_block_current(const target_flash_breakpoint_block_s *const block)
+{
+	if (block->wanted_count != block->programmed_count)
+		return false;
+	for (uint8_t idx = 0U; idx < block->wanted_count; ++idx) {
+		if (!flash_breakpoint_programmed(block, block->wanted[idx]))
+			return false;
+	}
+	return true;
+}
+
+/* Erase the block and program it back with the original contents and the breakpoints now wanted */
+static bool flash_breakpoint_block_program(target_flash_breakpoint_block_s *const block)
+{
+	target_flash_s *const flash = block->flash;
+	uint8_t *const data = flash_pool_acquire(&flash_diff_pool, flash, flash->blocksize);
+	if (!data) { /* malloc failed: heap exhaustion */
+		DEBUG_ERROR("malloc: failed in %s\n", __func__);
+		return false;
+	}
+	memcpy(data, block->original, flash->blocksize);
+	for (uint8_t idx = 0U; idx < block->wanted_count; ++idx)
+		memcpy(data + (block->wanted[idx] - block->addr), flash_breakpoint_insn, sizeof(flash_breakpoint_insn));
+
+	DEBUG_TARGET("%s: %08" PRIx32 " with %u breakpoints\n", __func__, block->addr, block->wanted_count);
+	bool result =
+		flash_prepare(flash, FLASH_OPERATION_ERASE) && flash_erase_block(flash, block->addr, flash->blocksize);
+	result &= flash_done(flash);
+	if (result)
+		result = flash_buffer_alloc(flash) && flash_buffered_write(flash, block->addr, data, flash->blocksize) &&
+			flash_buffered_flush(flash);
+	result &= flash_done(flash);
+	flash_pool_release(&flash_write_pool, flash->buf);
+	flash->buf = NULL;
+	flash_pool_release(&flash_diff_pool, data);
+
+	/*
+	 * If that failed there's no telling which (if any) of the breakpoints made it, so assume all the ones in
+	 * either list did - masking reads where there might be one is harmless, and the next commit tries again
+	 */
+	if (result) {
+		memcpy(block->programmed, block->wanted, sizeof(block->wanted));
+		block->programmed_count = block->wanted_count;
+	} else {
+		DEBUG_ERROR("Flash breakpoint update failed at %" PRIx32 "\n", block->addr);
+		for (uint8_t idx = 0U; idx < block->wanted_count; ++idx) {
+			if (block->programmed_count < FLASH_BREAKPOINTS_PER_BLOCK &&
+				!flash_breakpoint_programmed(block, block->wanted[idx]))
+				block->programmed[block->programmed_count++] = block->wanted[idx];
+		}
+	}
+	return result;
+}
+
+bool target_flash_breakpoints_commit(target_s *const target)
+{
+	/* Leave everything be while GDB is in the middle of programming the Flash itself */
+	if (!target->flash_breakpoints || target->flash_mode)
+		return true;
+
+	/* Flash drivers that run stubs resume the target, which mustn't come back around to here */
+	target->flash_mode = true;
+	bool result = true;
+	for (target_flash_breakpoint_block_s **link = &target->flash_breakpoints; *link;) {
+		target_flash_breakpoint_block_s *const block = *link;
+		if (!flash_breakpoint_block_current(block))
+			result &= flash_breakpoint_block_program(block);
+		/* Once a block is back to how it started out, there's no need to hang on to it */
+		if (!block->wanted_count && !block->programmed_count) {
+			*link = block->next;
+			free(block);
+		} else
+			link = &block->next;
+	}
+	target->flash_mode = false;
+	/* The Flash may well have changed behind the read cache's back */
+	target_mem_cache_flush(target);
+	return result;
+}
+
+bool target_flash_breakpoints_restore(target_s *const target)
+{
+	for (target_flash_breakpoint_block_s *block = target->flash_breakpoints; block; block = block->next)
+		block->wanted_count = 0U;
+	return target_flash_breakpoints_commit(target);
+}
+
+void target_flash_breakpoints_mask(
+	target_s *const target, void *const dest, const target_addr64_t src, const size_t len)
+{
+	for (const target_flash_breakpoint_block_s *block = target->flash_breakpoints; block; block = block->next) {
+		for (uint8_t idx = 0U; idx < block->programmed_count; ++idx) {
+			const target_addr32_t addr = block->programmed[idx];
+			/* Copy back whichever bytes of the instruction fall within the read */
+			for (size_t offset = 0U; offset < sizeof(flash_breakpoint_insn); ++offset) {
+				if (addr + offset >= src && addr + offset < src + len)
+					((uint8_t *)dest)[addr + offset - src] = block->original[addr + offset - block->addr];
+			}
+		}
+	}
+}
+
+void target_flash_breakpoints_free(target_s *const target)
+{
+	while (target->flash_breakpoints) {
+		target_flash_breakpoint_block_s *const next = target->flash_breakpoints->next;
+		free(target->flash_breakpoints);
+		target->flash_breakpoints = next;
+	}
+}
+
+/* GDB erasing blocks to load something new into them takes the old program's breakpoints away with it */
+static void flash_breakpoints_forget(
+	target_s *const target, const target_flash_range_s *const ranges, const size_t count)
+{
+	for (target_flash_breakpoint_block_s **link = &target->flash_breakpoints; *link;) {
+		target_flash_breakpoint_block_s *const block = *link;
+		bool erased = false;
+		for (size_t idx = 0U; idx < count && !erased; ++idx)
+			erased = ranges[idx].length && ranges[idx].addr < block->addr + block->flash->blocksize &&
+				block->addr < ranges[idx].addr + ranges[idx].length;
+		if (erased) {
+			*link = block->next;
+			free(block);
+		} else
+			link = &block->next;
+	}
+}
@@ -41,6 +41,7 @@ typedef enum flash_operation {
 } flash_operation_e;
 
 typedef struct target_ram target_ram_s;
+typedef struct target_description_stream target_description_stream_s;
 
 struct target_ram {
 	/* XXX: This needs adjusting for 64-bit operations */
@@ -49,13 +50,34 @@ struct target_ram {
 	target_ram_s *next;
 };
 
+/*
+ * Properties of a region of a target's memory map, so bulk operations (RTT scans, core dumps, the read cache)
+ * can decide how, and whether, to touch it. RAM and Flash get sensible defaults, drivers can add hints on top.
+ */
+#define TARGET_MEM_READ_SAFE  (1U << 0U) /* Reads have no side effects and won't fault */
+#define TARGET_MEM_CACHEABLE  (1U << 1U) /* Only changes when the core runs or we write it, so can be cached */
+#define TARGET_MEM_NEEDS_HALT (1U << 2U) /* Can only be accessed with the core halted */
+#define TARGET_MEM_AVOID      (1U << 3U) /* Known to fault or stall, so bulk operations skip it even when asked */
+
+typedef struct target_mem_policy target_mem_policy_s;
+
+struct target_mem_policy {
+	target_addr32_t start;
+	size_t length;
+	uint8_t flags;
+	target_mem_policy_s *next;
+};
+
 typedef struct target_flash target_flash_s;
 
 typedef bool (*flash_prepare_func)(target_flash_s *flash);
 typedef bool (*flash_erase_func)(target_flash_s *flash, target_addr_t addr, size_t len);
 typedef bool (*flash_mass_erase_func)(target_flash_s *flash, platform_timeout_s *print_progess);
 typedef bool (*flash_write_func)(target_flash_s *flash, target_addr_t dest, const void *src, size_t len);
+typedef bool (*flash_write_wait_func)(target_flash_s *flash);
+typedef bool (*flash_erase_wait_func)(target_flash_s *flash);
 typedef bool (*flash_done_func)(target_flash_s *flash);
+typedef bool (*flash_blank_func)(target_flash_s *flash, target_addr_t addr, size_t len, bool *blank);
 
 struct target_flash {
 	/* XXX: This needs adjusting for 64-bit operations */
@@ -67,21 +89,67 @@ struct target_flash {
 	size_t writebufsize;              /* Size of write buffer, this is calculated and not set in target code */
 	uint8_t erased;                   /* Byte erased state */
 	uint8_t operation;                /* Current Flash operation (none means it's idle/unprepared) */
+	bool write_pending;               /* A write has been started and not yet waited on via write_wait */
+	bool erase_pending;               /* An erase has been started and not yet waited on via erase_wait */
+	bool write_overlaps;              /* write() collects the pending write itself after loading its data² */
 	flash_prepare_func prepare;       /* Prepare for flash operations */
 	flash_erase_func erase;           /* Erase a range of flash */
+	flash_erase_wait_func erase_wait; /* Wait for an erase started by erase() to complete (enables overlapping⁵) */
 	flash_mass_erase_func mass_erase; /* Mass erase flash (this flash only¹) */
 	flash_write_func write;           /* Write to flash */
+	flash_write_wait_func write_wait; /* Wait for a write started by write() to complete (enables pipelining²) */
 	flash_done_func done;             /* Finish flash operations */
+	flash_blank_func blank_check;     /* Check if a range reads as erased with the controller's own command⁷ */
 	uint8_t *buf;                     /* Buffer for flash operations */
 	target_addr32_t buf_addr_base;    /* Address of block this buffer is for */
 	target_addr32_t buf_addr_low;     /* Address of lowest byte written */
 	target_addr32_t buf_addr_high;    /* Address of highest byte written */
+	uint8_t *diff_buf;                /* Staging buffer for the erase block being diffed³ */
+	target_addr32_t diff_erase_start; /* Start of the deferred erase range (the block being staged) */
+	target_addr32_t diff_erase_end;   /* End of the deferred erase range */
+	target_addr32_t diff_addr_low;    /* Address of lowest byte staged */
+	target_addr32_t diff_addr_high;   /* Address of highest byte staged */
+	size_t erase_span;                /* Largest run of blocks erase may be asked to do at once (0 for one block)⁴ */
+	size_t mass_erase_cost;           /* What mass_erase costs in erase calls (0 for a whole Flash's worth)⁴ */
+	target_addr32_t lazy_erase_start; /* Start of the blocks still to be erased ahead of incoming data⁵ */
+	target_addr32_t lazy_erase_end;   /* End of the blocks still to be erased ahead of incoming data */
+	target_addr32_t blank_start;      /* Start of the range known to still be blank from being erased⁶ */
+	target_addr32_t blank_end;        /* End of the range known to still be blank */
 	target_flash_s *next;             /* Next flash in list */
 };
 
 /*
  * ¹the mass_erase method must not cause any side effects outside the scope/address space of the flash
  * consider using the target mass_erase method instead for such cases
+ *
+ * ²if write_wait is provided, the write method is allowed to return as soon as the operation has been handed to
+ * the Flash controller (or on-target stub) rather than waiting for it to finish. The flash core then calls
+ * write_wait before the next write, before done, and before switching operation, so the next chunk of data
+ * can be received from the host while the target is still programming the previous one. If write_overlaps is also
+ * set, write is called with the previous write still pending instead, and must wait for it itself - so that it can
+ * load the new chunk onto the target first, while the previous one is still programming
+ *
+ * ³in differential flashing mode, erases are deferred and the incoming data for each erase block is staged in
+ * diff_buf. Once the block is complete, its CRC is compared against that of the block on the target and the
+ * erase and write are skipped entirely if they match
+ *
+ * ⁴erases are planned per Flash across all the ranges being erased. The touched blocks are counted up in
+ * erase calls, each covering one block or, where the driver sets erase_span and the run is aligned to it and
+ * long enough, one span. mass_erase is used instead whenever it costs no more than that. Drivers for parts
+ * with a bank erase that is quicker than erasing the sectors one by one should set mass_erase_cost to match
+ *
+ * ⁵if erase_wait is provided, the erase method is allowed to return with the last erase it started still running.
+ * The flash core calls erase_wait before the next erase or write and before done. Such drivers must also accept
+ * erase being called while prepared for writing, as target_flash_erase_on_write() then puts off erasing each block
+ * until the first data for it arrives, so the erase runs while the host is sending the rest of that data
+ *
+ * ⁶the flash core notes the blocks it has erased in this run of Flash mode, and trims the range back as they are
+ * programmed, so that writes of chunks that are entirely the erased value can be skipped where they fall in it.
+ * Like the other ranges here, just the one is tracked, which suits the address ordered way data arrives
+ *
+ * ⁷with flash_blank_check enabled, each erase is preceded by a check of whether the range is already blank, and
+ * skipped if it is. blank_check returns false if the check itself couldn't be done, and the flash core then falls
+ * back to comparing a CRC32 of the range (computed on the target where it can be) against that of blank Flash
  */
 
 typedef bool (*cmd_handler_fn)(target_s *target, int argc, const char **argv);
@@ -119,8 +187,34 @@ struct breakwatch {
 
 #define MAX_CMDLINE 81
 
+/* Granularity of the halt-scoped memory read cache */
+#define TARGET_MEM_CACHE_PAGE_SIZE 64U
+
+/* The page data lives in one contiguous block alongside, so runs of pages can be filled with a single read */
+typedef struct target_mem_cache_page {
+	target_addr64_t addr;
+	bool valid;
+	uint8_t *data;
+} target_mem_cache_page_s;
+
 typedef void (*priv_free_func)(void *flash);
 
+/* A Flash erase block with breakpoint instructions patched into it, see target_flash.c */
+typedef struct target_flash_breakpoint_block target_flash_breakpoint_block_s;
+
+#if CONFIG_BMDA == 1
+/*
+ * A probe that can run the target's Flash drivers itself, so whole erases and writes are handed over to it.
+ * begin returns whether the probe took the target on, and complete ends the probe's session if release is set.
+ */
+typedef struct target_flash_offload {
+	bool (*begin)(target_s *target);
+	bool (*erase)(target_s *target, const target_flash_range_s *ranges, size_t count, bool lazy);
+	bool (*write)(target_s *target, target_addr_t dest, const void *src, size_t len);
+	bool (*complete)(target_s *target, bool release);
+} target_flash_offload_s;
+#endif
+
 struct target {
 	target_controller_s *tc;
 
@@ -128,18 +222,30 @@ struct target {
 	bool (*attach)(target_s *target);
 	void (*detach)(target_s *target);
 	bool (*check_error)(target_s *target);
+	/* Optional check for a fault the link has already flagged, costing no target access (see target_error_defer) */
+	bool (*check_fault)(target_s *target);
 
 	/* Memory access functions */
 	void (*mem_read)(target_s *target, void *dest, target_addr64_t src, size_t len);
 	void (*mem_write)(target_s *target, target_addr64_t dest, const void *src, size_t len);
+	/* Optional on-target CRC32 of a memory region, updating the running value in *crc (see bmd_crc32) */
+	bool (*crc32)(target_s *target, uint32_t *crc, target_addr_t base, size_t len);
+	/* Optional on-target fill of a word aligned region with a repeated 32-bit value (see target_mem32_fill) */
+	bool (*mem_fill)(target_s *target, target_addr_t dest, uint32_t value, size_t len);
+	/* Optional offloaded poll of a 32-bit location, returning the last value read (see target_mem32_poll32) */
+	uint32_t (*mem_poll32)(target_s *target, target_addr64_t addr, uint32_t mask, uint32_t value, uint32_t timeout_ms);
 
 	/* Register access functions */
 	size_t regs_size;
-	const char *(*regs_description)(target_s *target);
+	void (*regs_description)(target_s *target, target_description_stream_s *stream);
 	void (*regs_read)(target_s *target, void *data);
 	void (*regs_write)(target_s *target, const void *data);
 	size_t (*reg_read)(target_s *target, uint32_t reg, void *data, size_t max);
 	size_t (*reg_write)(target_s *target, uint32_t reg, const void *data, size_t size);
+	/* Optional read of just the registers GDB needs up front for 'g', returning how many bytes of them there are */
+	size_t (*regs_read_core)(target_s *target, void *data);
+	/* Optional read of just the program counter, used to step through address ranges on the probe */
+	target_addr_t (*pc_read)(target_s *target);
 
 	/* Halt/resume functions */
 	void (*reset)(target_s *target);
@@ -159,6 +265,9 @@ struct target {
 	/* Flash functions */
 	bool (*enter_flash_mode)(target_s *target);
 	bool (*exit_flash_mode)(target_s *target);
+	/* Optionally speed the core up once in Flash mode, with restore undoing it again before Flash mode is left */
+	bool (*flash_clock_boost)(target_s *target);
+	void (*flash_clock_restore)(target_s *target);
 
 	/* Target-defined options */
 	uint32_t target_options;
@@ -172,9 +281,41 @@ struct target {
 
 	bool attached;
 	bool flash_mode;
+	/* Set while a Flash session holds the target in Flash mode across operations, see target_flash_session_begin() */
+	bool flash_mode_held;
+
+	/* Deferred error checking state, see target_error_defer_begin() */
+	uint8_t error_defer_depth;
+	uint32_t error_checked_ms;
 
 	target_ram_s *ram;
 	target_flash_s *flash;
+	/* Driver hints overriding the memory map's default region policies, see target_mem_policy() */
+	target_mem_policy_s *mem_policy;
+	target_flash_breakpoint_block_s *flash_breakpoints;
+#if CONFIG_BMDA == 1
+	/* Set when the probe can do this target's Flashing, and the Flash operations are currently handed over to it */
+	const target_flash_offload_s *flash_offload;
+	bool flash_offloaded;
+#endif
+
+	/* Cache of RAM and Flash reads, only used while the target is halted */
+	bool mem_cache_active;
+	size_t mem_cache_pages;
+	size_t mem_cache_next;
+	target_mem_cache_page_s *mem_cache;
+	uint8_t *mem_cache_data;
+	/* Where the last cached read ended, and how many reads in a row have each started right there */
+	target_addr64_t mem_cache_seq_end;
+	uint8_t mem_cache_seq_count;
+
+	/* GDB's XML target description and memory map, generated on first request and kept until read in full */
+#if CONFIG_BMDA == 1
+	char *description_xml;
+	size_t description_xml_length;
+#endif
+	char *mem_map_xml;
+	size_t mem_map_xml_length;
 
 	/* Other stuff */
 	const char *driver;
@@ -202,11 +343,34 @@ struct target {
 void target_print_progress(platform_timeout_s *timeout);
 void target_ram_map_free(target_s *target);
 void target_flash_map_free(target_s *target);
+/* Hand back a Flash's write and differential staging buffers, as when the Flash is freed */
+void target_flash_buffers_release(target_flash_s *flash);
 void target_mem_map_free(target_s *target);
+void target_mem_cache_flush(target_s *target);
+
+/*
+ * Breakpoints patched into Flash, for when the hardware ones run out. Setting and clearing them only notes what's
+ * wanted, the erase blocks affected are then rewritten (at most once each) by target_flash_breakpoints_commit(),
+ * which is done as the target is resumed or reset. Restoring takes them all out again, as on detach.
+ */
+bool target_flash_breakpoint_set(target_s *target, target_addr_t addr);
+void target_flash_breakpoint_clear(target_s *target, target_addr_t addr);
+bool target_flash_breakpoints_commit(target_s *target);
+bool target_flash_breakpoints_restore(target_s *target);
+/* Put the program's own instructions back over any breakpoints in data read from Flash */
+void target_flash_breakpoints_mask(target_s *target, void *dest, target_addr64_t src, size_t len);
+void target_flash_breakpoints_free(target_s *target);
 void target_add_commands(target_s *target, const command_s *cmds, const char *name);
 void target_add_ram32(target_s *target, target_addr32_t start, uint32_t len);
 void target_add_ram64(target_s *target, target_addr64_t start, uint64_t len);
 void target_add_flash(target_s *target, target_flash_s *flash);
+/* Give [start, start + length) the TARGET_MEM_* flags in place of whatever the memory map would imply */
+void target_add_mem_policy(target_s *target, target_addr32_t start, uint32_t length, uint8_t flags);
+/*
+ * Look up the TARGET_MEM_* flags that apply at addr, setting *run_end to where they might next change so
+ * bulk operations can walk a range a run at a time. Anything that isn't RAM, Flash or hinted gets no flags.
+ */
+uint8_t target_mem_policy(target_s *target, target_addr32_t addr, target_addr64_t *run_end);
 
 /* No-op stub for enter flash mode */
 bool target_enter_flash_mode_stub(target_s *target);
@@ -228,6 +392,23 @@ bool target_mem64_write16(target_s *target, target_addr64_t addr, uint16_t value
 bool target_mem64_write8(target_s *target, target_addr64_t addr, uint8_t value);
 bool target_check_error(target_s *target);
 
+/*
+ * Run a batch of target operations with deferred error checking: between begin and end, target_check_error()
+ * only does the full (sticky error) check when the link has flagged a fault or every TARGET_ERROR_DEFER_MS, so
+ * polling loops still notice a failure promptly. The end does the one full check, returning whether anything in
+ * the batch failed that no check along the way reported. Batches nest, each end doing its own full check.
+ */
+void target_error_defer_begin(target_s *target);
+bool target_error_defer_end(target_s *target);
+
+/*
+ * Poll a 32-bit location until (status & mask) == value, giving up after timeout_ms (or only on a comms
+ * failure if that is 0), reporting progress through print_progress if given. Returns whether the value
+ * matched, storing the last value read to status if not NULL.
+ */
+bool target_mem32_poll32(target_s *target, target_addr32_t addr, uint32_t mask, uint32_t value, uint32_t timeout_ms,
+	platform_timeout_s *print_progress, uint32_t *status);
+
 #if defined(__MINGW32__) || defined(__MINGW64__) || defined(__CYGWIN__)
 #define TC_FORMAT_ATTR __attribute__((format(__MINGW_PRINTF_FORMAT, 2, 3)))
 #elif defined(__GNUC__) || defined(__clang__)
@@ -239,4 +420,31 @@ bool target_check_error(target_s *target);
 /* Access to host controller interface */
 void tc_printf(target_s *target, const char *fmt, ...) TC_FORMAT_ATTR;
 
+/*
+ * Register descriptions are generated a piece at a time, with only the pieces that fall in the window
+ * GDB asked for being kept, so the whole XML document never has to be held in memory at once. The offset
+ * counts how much of the document has been generated, which at the end is its total length.
+ */
+struct target_description_stream {
+	char *buffer;  /* Where the window's part of the document goes, NULL to only count */
+	size_t start;  /* Offset of the window into the document */
+	size_t length; /* Size of the window */
+	size_t offset; /* How far through the document generation has got */
+};
+
+/* A fixed piece of a description, included when the target has all of the options it asks for */
+typedef struct target_description_piece {
+	uint32_t options;
+	const char *xml;
+} target_description_piece_s;
+
+/* Each piece formatted by target_description_printf() must come to less than this many characters */
+#define TARGET_DESCRIPTION_PIECE_MAX 128U
+
+void target_description_puts(target_description_stream_s *stream, const char *xml);
+/* Walk a table of fixed pieces, adding each that the target's options call for in turn */
+void target_description_pieces(target_description_stream_s *stream, const target_description_piece_s *pieces,
+	size_t count, uint32_t options);
+void target_description_printf(target_description_stream_s *stream, const char *fmt, ...) TC_FORMAT_ATTR;
+
 #endif /* TARGET_TARGET_INTERNAL_H */
@@ -47,6 +47,7 @@
 #include "target.h"
 #include "target_internal.h"
 #include "cortex_internal.h"
+#include "cortexar.h"
 #include "exception.h"
 
 #define CORTEXA_DBG_IDR 0x000U
@@ -56,6 +57,13 @@
 #define ZYNQ7_OCM_HIGH_BASE  0xfffc0000U
 #define ZYNQ7_OCM_CHUNK_SIZE 0x00010000U
 
+/* DDR as seen by the bus masters other than the CPUs, UG585 §4.1 System Address Map, pg106 */
+#define ZYNQ7_DDR_BASE 0x00100000U
+#define ZYNQ7_DDR_SIZE 0x3ff00000U
+
+/* The AHB-AP on the DAP that gives access to the system via the central interconnect */
+#define ZYNQ7_AHB_AP 0U
+
 /* System Level Control Registers */
 #define ZYNQ7_SLCR_BASE         0xf8000000U
 #define ZYNQ7_SLCR_UNLOCK       (ZYNQ7_SLCR_BASE + 0x008U)
@@ -88,6 +96,9 @@ bool zynq7_probe(target_s *const target)
 		target_add_ram32(
 			target, (chunk_high ? ZYNQ7_OCM_HIGH_BASE : ZYNQ7_OCM_LOW_BASE) + chunk_offset, ZYNQ7_OCM_CHUNK_SIZE);
 	}
+	target_add_ram32(target, ZYNQ7_DDR_BASE, ZYNQ7_DDR_SIZE);
+	/* Load images into DDR over the AHB-AP rather than through the core */
+	cortexar_bus_ap_set(target, ZYNQ7_AHB_AP, ZYNQ7_DDR_BASE, ZYNQ7_DDR_SIZE);
 
 	return true;
 }
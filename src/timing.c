@@ -43,3 +43,15 @@ bool platform_timeout_is_expired(const platform_timeout_s *const t)
 		return false;
 	return counter > t->time;
 }
+
+void platform_timeout_us_set(platform_timeout_us_s *const t, const uint32_t us)
+{
+	t->start = platform_time_us();
+	t->duration = us;
+}
+
+bool platform_timeout_us_is_expired(const platform_timeout_us_s *const t)
+{
+	/* Unsigned subtraction keeps this right across the counter wrapping */
+	return platform_time_us() - t->start > t->duration;
+}